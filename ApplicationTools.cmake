@@ -55,6 +55,26 @@ function(add_shader file)
   add_shader_target(shader_${name})
 endfunction()
 
+# add_shaders(batch_name file1 [file2]...)
+# Same targets as add_shader for each file, built by one shaderc invocation
+function(add_shaders batch)
+  unset(pairs)
+  foreach(file ${ARGN})
+    get_filename_component(name ${file} NAME)
+    get_filename_component(dir ${file} DIRECTORY)
+    list(APPEND pairs ${CMAKE_CURRENT_BINARY_DIR}/${dir}/shader_${name} ${file}.shader)
+  endforeach()
+  shaderc_batch(${batch} ${pairs})
+  foreach(file ${ARGN})
+    get_filename_component(name ${file} NAME)
+    get_filename_component(dir ${file} DIRECTORY)
+    add_stage_rep(shader_${name} ${CMAKE_CURRENT_BINARY_DIR}/${dir}/shader_${name}.hpp)
+    add_pipeline_rep(shader_${name} ${CMAKE_CURRENT_BINARY_DIR}/${dir}/shader_${name}.hpp UNIVERSAL)
+    add_library(shader_${name} ${CMAKE_CURRENT_BINARY_DIR}/${dir}/shader_${name}.hpp ${CMAKE_CURRENT_BINARY_DIR}/${dir}/shader_${name}.cpp)
+    add_shader_target(shader_${name})
+  endforeach()
+endfunction()
+
 function(add_special_shader name)
   add_stage_rep(${name} ${name}.hpp)
   add_pipeline_rep(${name} ${name}.hpp UNIVERSAL)
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "hecl/hecl.hpp"
+#include "hecl/Database.hpp"
+
+namespace hecl::bench {
+
+/**
+ * @brief Scratch project shared by all benchmarks
+ *
+ * A temporary directory holding an initialized project and a generated
+ * tree of DirCount top-level directories, each with SubdirCount
+ * subdirectories of FileCount small files. Removed on destruction.
+ */
+class Fixture {
+  SystemString m_root;
+  SystemString m_treeRoot;
+  std::unique_ptr<Database::Project> m_project;
+  std::vector<SystemString> m_files;
+
+public:
+  static constexpr size_t DirCount = 16;
+  static constexpr size_t SubdirCount = 8;
+  static constexpr size_t FileCount = 16;
+  static constexpr size_t FileSize = 4096;
+
+  Fixture();
+  ~Fixture();
+  Fixture(const Fixture&) = delete;
+  Fixture& operator=(const Fixture&) = delete;
+
+  /** Absolute path of the project root */
+  const SystemString& root() const { return m_root; }
+  /** Absolute path of the generated tree within the project */
+  const SystemString& treeRoot() const { return m_treeRoot; }
+  /** Paths of every generated file relative to the project root */
+  const std::vector<SystemString>& files() const { return m_files; }
+  Database::Project& project() { return *m_project; }
+};
+
+struct Result {
+  std::string_view m_name;
+  size_t m_iterations = 0;
+  uint64_t m_items = 0;
+  double m_minNs = 0.0;
+  double m_medianNs = 0.0;
+  double m_meanNs = 0.0;
+};
+
+/**
+ * @brief Timing loop handed to each benchmark
+ *
+ * Benchmarks perform their setup, then call measure() once with the body of
+ * one iteration. The body is run once untimed to warm caches, then repeated
+ * until both the minimum time and iteration count are reached.
+ */
+class Run {
+  std::string_view m_name;
+  std::chrono::nanoseconds m_minTime;
+  size_t m_minIterations;
+  uint64_t m_items = 0;
+  std::vector<double> m_samples;
+
+public:
+  Run(std::string_view name, std::chrono::nanoseconds minTime, size_t minIterations)
+  : m_name(name), m_minTime(minTime), m_minIterations(minIterations) {}
+
+  /** Number of items (vertices, paths, transactions...) one iteration processes; reported as throughput */
+  void setItems(uint64_t items) { m_items = items; }
+
+  template <typename F>
+  void measure(F&& iteration) {
+    using Clock = std::chrono::steady_clock;
+    iteration();
+    m_samples.clear();
+    Clock::duration total{};
+    while (total < m_minTime || m_samples.size() < m_minIterations) {
+      const Clock::time_point start = Clock::now();
+      iteration();
+      const Clock::duration elapsed = Clock::now() - start;
+      total += elapsed;
+      m_samples.push_back(double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+  }
+
+  /** Summarize collected samples; a benchmark that never called measure() reports no iterations */
+  Result result() {
+    Result ret;
+    ret.m_name = m_name;
+    ret.m_items = m_items;
+    ret.m_iterations = m_samples.size();
+    if (m_samples.empty())
+      return ret;
+    std::sort(m_samples.begin(), m_samples.end());
+    ret.m_minNs = m_samples.front();
+    ret.m_medianNs = m_samples[m_samples.size() / 2];
+    for (double s : m_samples)
+      ret.m_meanNs += s;
+    ret.m_meanNs /= double(m_samples.size());
+    return ret;
+  }
+};
+
+using BenchFunc = void (*)(Run& run, Fixture& fixture);
+struct Benchmark {
+  std::string_view m_name;
+  BenchFunc m_func;
+};
+
+/** Every benchmark linked into the executable, in registration order */
+std::vector<Benchmark>& Registry();
+
+struct Registrar {
+  Registrar(std::string_view name, BenchFunc func) { Registry().push_back({name, func}); }
+};
+
+#define HECL_BENCHMARK(func, name)                                                                                     \
+  static void func(hecl::bench::Run& run, hecl::bench::Fixture& fixture);                                              \
+  static const hecl::bench::Registrar func##Registrar(name, func);                                                     \
+  static void func([[maybe_unused]] hecl::bench::Run& run, [[maybe_unused]] hecl::bench::Fixture& fixture)
+
+} // namespace hecl::bench
@@ -0,0 +1,56 @@
+#include "Bench.hpp"
+
+#include <cstdint>
+#include <random>
+
+#include "hecl/BitVector.hpp"
+
+/* Sizes follow a UniformBufferPool free map with many 32768-element buckets */
+namespace {
+constexpr unsigned BitCount = 1 << 20;
+constexpr unsigned BucketSize = 32768;
+
+hecl::llvm::BitVector RandomBits(unsigned count, double density) {
+  std::mt19937 rng(1234);
+  std::bernoulli_distribution dist(density);
+  hecl::llvm::BitVector ret(count);
+  for (unsigned i = 0; i < count; ++i)
+    if (dist(rng))
+      ret.set(i);
+  return ret;
+}
+
+/* Every third bit set, so no run longer than one exists until the free last bucket */
+hecl::llvm::BitVector SparseWithFreeTail(unsigned count, unsigned bucketSz) {
+  hecl::llvm::BitVector ret(count);
+  for (unsigned i = 0; i < count - bucketSz; i += 3)
+    ret.set(i);
+  ret.set(count - bucketSz, count);
+  return ret;
+}
+
+volatile int Sink;
+} // anonymous namespace
+
+HECL_BENCHMARK(BitVectorFindRunRandom, "bitvector/find-run-random") {
+  const hecl::llvm::BitVector bits = RandomBits(BitCount, 0.3);
+  run.setItems(BitCount);
+  run.measure([&]() { Sink = bits.find_first_run(64); });
+}
+
+HECL_BENCHMARK(BitVectorFindRunBucketed, "bitvector/find-run-bucketed") {
+  const hecl::llvm::BitVector bits = SparseWithFreeTail(BitCount, BucketSize);
+  run.setItems(BitCount);
+  run.measure([&]() { Sink = bits.find_first_contiguous(256, BucketSize); });
+}
+
+HECL_BENCHMARK(BitVectorFindUnset, "bitvector/find-unset") {
+  const hecl::llvm::BitVector bits = RandomBits(BitCount, 0.98);
+  run.setItems(BitCount);
+  run.measure([&]() {
+    int count = 0;
+    for (int i = bits.find_first_unset(); i != -1; i = bits.find_next_unset(i))
+      ++count;
+    Sink = count;
+  });
+}
@@ -0,0 +1,192 @@
+#include "Bench.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include "hecl/Blender/Connection.hpp"
+#include "MeshOptimizer.hpp"
+
+namespace {
+using namespace hecl::blender;
+
+/**
+ * Attribute block of a triangulated, gently rippled grid in the layout written
+ * by HMDLMesh.write_mesh_attrs_soa; one UV layer, no colors or skinning.
+ */
+std::vector<uint8_t> GridAttributes(uint32_t width, uint32_t height) {
+  const uint32_t vertCount = (width + 1) * (height + 1);
+  const uint32_t faceCount = width * height * 2;
+  const uint32_t loopCount = faceCount * 3;
+
+  std::vector<float> vertCo;
+  vertCo.reserve(size_t(vertCount) * 3);
+  for (uint32_t y = 0; y <= height; ++y) {
+    for (uint32_t x = 0; x <= width; ++x) {
+      vertCo.push_back(float(x));
+      vertCo.push_back(std::sin(float(x) * 0.3f) * std::cos(float(y) * 0.2f));
+      vertCo.push_back(float(y));
+    }
+  }
+
+  std::vector<uint32_t> faceVerts;
+  faceVerts.reserve(loopCount);
+  for (uint32_t y = 0; y < height; ++y) {
+    for (uint32_t x = 0; x < width; ++x) {
+      const uint32_t v00 = y * (width + 1) + x;
+      const uint32_t v10 = v00 + 1;
+      const uint32_t v01 = v00 + width + 1;
+      const uint32_t v11 = v01 + 1;
+      faceVerts.insert(faceVerts.end(), {v00, v10, v11, v00, v11, v01});
+    }
+  }
+
+  /* Each loop owns the edge to the next vert of its face */
+  std::unordered_map<uint64_t, uint32_t> edgeIdxs;
+  std::vector<uint32_t> edgeVerts;
+  std::vector<std::vector<uint32_t>> edgeLoops;
+  std::vector<uint32_t> loopEdges(loopCount);
+  for (uint32_t l = 0; l < loopCount; ++l) {
+    const uint32_t a = faceVerts[l];
+    const uint32_t b = faceVerts[l / 3 * 3 + (l + 1) % 3];
+    const uint64_t key = uint64_t(std::min(a, b)) << 32 | std::max(a, b);
+    auto [search, inserted] = edgeIdxs.emplace(key, uint32_t(edgeLoops.size()));
+    if (inserted) {
+      edgeVerts.insert(edgeVerts.end(), {a, b});
+      edgeLoops.emplace_back();
+    }
+    loopEdges[l] = search->second;
+    edgeLoops[search->second].push_back(l);
+  }
+  const uint32_t edgeCount = uint32_t(edgeLoops.size());
+
+  std::vector<uint32_t> loopLinks;
+  loopLinks.reserve(size_t(loopCount) * 7);
+  for (uint32_t l = 0; l < loopCount; ++l) {
+    const uint32_t face = l / 3;
+    const std::vector<uint32_t>& radial = edgeLoops[loopEdges[l]];
+    const size_t r = std::find(radial.begin(), radial.end(), l) - radial.begin();
+    loopLinks.insert(loopLinks.end(), {faceVerts[l], loopEdges[l], face, face * 3 + (l + 1) % 3,
+                                       face * 3 + (l + 2) % 3, radial[(r + 1) % radial.size()],
+                                       radial[(r + radial.size() - 1) % radial.size()]});
+  }
+
+  std::vector<uint8_t> ret;
+  const auto put = [&](const void* data, size_t size) {
+    ret.insert(ret.end(), static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+  };
+  const auto putVec = [&](const auto& vec) { put(vec.data(), vec.size() * sizeof(vec[0])); };
+  const auto putFill = [&](auto value, size_t count) { putVec(std::vector<decltype(value)>(count, value)); };
+
+  /* Every loop links its edge to one face */
+  uint32_t header[9] = {0, 0, 1, vertCount, 0, loopCount, edgeCount, loopCount, faceCount};
+  std::memcpy(&header[0], "HSOA", 4);
+  put(header, sizeof(header));
+
+  putVec(vertCo);
+  putFill(uint32_t(0), vertCount);
+
+  /* Loop normals and UVs follow their vert, so both dedup to one entry per vert */
+  std::vector<float> loopNorm;
+  std::vector<float> loopUv;
+  loopNorm.reserve(size_t(loopCount) * 3);
+  loopUv.reserve(size_t(loopCount) * 2);
+  for (uint32_t l = 0; l < loopCount; ++l) {
+    const uint32_t v = faceVerts[l];
+    const float nx = -std::cos(vertCo[v * 3] * 0.3f) * 0.3f;
+    const float nz = std::sin(vertCo[v * 3 + 2] * 0.2f) * 0.2f;
+    const float len = std::sqrt(nx * nx + 1.f + nz * nz);
+    loopNorm.insert(loopNorm.end(), {nx / len, 1.f / len, nz / len});
+    loopUv.insert(loopUv.end(), {vertCo[v * 3] / float(width), vertCo[v * 3 + 2] / float(height)});
+  }
+  putVec(loopNorm);
+  putVec(loopUv);
+  putVec(loopLinks);
+
+  putVec(edgeVerts);
+  std::vector<uint32_t> edgeFaceCounts;
+  std::vector<uint32_t> edgeFaces;
+  for (const std::vector<uint32_t>& radial : edgeLoops) {
+    edgeFaceCounts.push_back(uint32_t(radial.size()));
+    for (uint32_t l : radial)
+      edgeFaces.push_back(l / 3);
+  }
+  putVec(edgeFaceCounts);
+  putVec(edgeFaces);
+  putFill(uint32_t(1), edgeCount);
+
+  std::vector<float> faceNorm;
+  std::vector<float> faceCentroid;
+  for (uint32_t f = 0; f < faceCount; ++f) {
+    float c[3] = {};
+    for (uint32_t k = 0; k < 3; ++k)
+      for (uint32_t i = 0; i < 3; ++i)
+        c[i] += vertCo[faceVerts[f * 3 + k] * 3 + i] / 3.f;
+    faceNorm.insert(faceNorm.end(), {0.f, 1.f, 0.f});
+    faceCentroid.insert(faceCentroid.end(), {c[0], c[1], c[2]});
+  }
+  putVec(faceNorm);
+  putVec(faceCentroid);
+  putFill(uint32_t(0), faceCount);
+  std::vector<uint32_t> faceLoops(loopCount);
+  for (uint32_t l = 0; l < loopCount; ++l)
+    faceLoops[l] = l;
+  putVec(faceLoops);
+  return ret;
+}
+
+constexpr uint32_t GridSize = 128;
+
+struct GridMesh {
+  std::vector<uint8_t> m_attrs = GridAttributes(GridSize, GridSize);
+  std::vector<Material> m_materials = std::vector<Material>(1);
+
+  GridMesh() { m_materials[0].passIndex = 0; }
+
+  Mesh optimize() const {
+    Mesh mesh(hecl::HMDLTopology::TriStrips);
+    MeshOptimizer opt(m_attrs.data(), m_attrs.size(), m_materials, false);
+    opt.optimize(mesh, 0);
+    /* Assigned by skin banking for rigged meshes; unrigged meshes share bank 0 */
+    for (Mesh::Surface& surf : mesh.surfaces)
+      surf.skinBankIdx = 0;
+    return mesh;
+  }
+};
+} // anonymous namespace
+
+HECL_BENCHMARK(MeshOptimize, "mesh/optimize") {
+  const GridMesh grid;
+  run.setItems(GridSize * GridSize * 2);
+  run.measure([&]() { grid.optimize(); });
+}
+
+HECL_BENCHMARK(MeshHMDL, "mesh/hmdl-buffers") {
+  const Mesh mesh = GridMesh().optimize();
+  run.setItems(GridSize * GridSize * 2);
+  run.measure([&]() {
+    PoolSkinIndex poolSkinIndex;
+    mesh.getHMDLBuffers(false, poolSkinIndex);
+  });
+}
+
+HECL_BENCHMARK(MeshHMDLOptimized, "mesh/hmdl-buffers-ordered") {
+  const Mesh mesh = GridMesh().optimize();
+  HMDLOptions options;
+  options.optimizeOrder = true;
+  run.setItems(GridSize * GridSize * 2);
+  run.measure([&]() {
+    PoolSkinIndex poolSkinIndex;
+    mesh.getHMDLBuffers(false, poolSkinIndex, options);
+  });
+}
+
+HECL_BENCHMARK(MeshLods, "mesh/lods") {
+  const Mesh source = GridMesh().optimize();
+  run.setItems(GridSize * GridSize * 2);
+  run.measure([&]() {
+    Mesh mesh = source;
+    mesh.generateLods();
+  });
+}
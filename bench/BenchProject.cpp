@@ -0,0 +1,110 @@
+#include "Bench.hpp"
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <vector>
+
+#include "hecl/ClientProcess.hpp"
+#include "hecl/DirectoryWalker.hpp"
+#include "hecl/StatCache.hpp"
+
+HECL_BENCHMARK(PathConstruct, "path/construct") {
+  hecl::Database::Project& proj = fixture.project();
+  run.setItems(fixture.files().size());
+  run.measure([&]() {
+    for (const hecl::SystemString& file : fixture.files()) {
+      hecl::ProjectPath path(proj, file);
+      (void)path;
+    }
+  });
+}
+
+HECL_BENCHMARK(PathConstructChild, "path/construct-child") {
+  const hecl::ProjectPath tree(fixture.project(), _SYS_STR("tree"));
+  run.setItems(fixture.files().size());
+  run.measure([&]() {
+    for (const hecl::SystemString& file : fixture.files()) {
+      /* Fixture paths all begin with "tree/" */
+      hecl::ProjectPath path(tree, hecl::SystemStringView(file).substr(5));
+      (void)path;
+    }
+  });
+}
+
+static void PathTypes(hecl::bench::Run& run, hecl::bench::Fixture& fixture, bool statCache) {
+  std::vector<hecl::ProjectPath> paths;
+  paths.reserve(fixture.files().size());
+  for (const hecl::SystemString& file : fixture.files())
+    paths.emplace_back(fixture.project(), file);
+  hecl::StatCache& cache = fixture.project().getStatCache();
+  cache.setEnabled(statCache);
+  run.setItems(paths.size());
+  run.measure([&]() {
+    for (const hecl::ProjectPath& path : paths)
+      (void)path.getPathType();
+  });
+  cache.setEnabled(false);
+}
+
+HECL_BENCHMARK(PathType, "path/type") { PathTypes(run, fixture, false); }
+HECL_BENCHMARK(PathTypeCached, "path/type-statcache") { PathTypes(run, fixture, true); }
+
+static size_t EnumerateRecursive(const hecl::SystemString& dir) {
+  size_t count = 0;
+  for (const hecl::DirectoryEnumerator::Entry& ent : hecl::DirectoryEnumerator(dir)) {
+    ++count;
+    if (ent.m_isDir)
+      count += EnumerateRecursive(ent.m_path);
+  }
+  return count;
+}
+
+HECL_BENCHMARK(DirEnumerate, "dir/enumerate") {
+  run.setItems(EnumerateRecursive(fixture.treeRoot()));
+  run.measure([&]() { EnumerateRecursive(fixture.treeRoot()); });
+}
+
+HECL_BENCHMARK(DirWalk, "dir/walk") {
+  run.setItems(hecl::DirectoryWalker(fixture.treeRoot()).entries().size());
+  run.measure([&]() { hecl::DirectoryWalker walker(fixture.treeRoot()); });
+}
+
+HECL_BENCHMARK(DirWalkSerial, "dir/walk-serial") {
+  run.setItems(hecl::DirectoryWalker(fixture.treeRoot(), true, true, true, nullptr, 1).entries().size());
+  run.measure([&]() { hecl::DirectoryWalker walker(fixture.treeRoot(), true, true, true, nullptr, 1); });
+}
+
+HECL_BENCHMARK(ClientLambda, "client/lambda") {
+  constexpr size_t TransactionCount = 4096;
+  hecl::ClientProcess proc;
+  std::atomic_size_t completed = 0;
+  std::list<std::shared_ptr<hecl::ClientProcess::Transaction>> done;
+  run.setItems(TransactionCount);
+  run.measure([&]() {
+    for (size_t i = 0; i < TransactionCount; ++i)
+      proc.addLambdaTransaction([&](hecl::blender::Token&) { ++completed; });
+    proc.waitUntilComplete();
+    proc.swapCompletedQueue(done);
+    done.clear();
+  });
+}
+
+HECL_BENCHMARK(ClientBuffer, "client/buffer") {
+  constexpr size_t FileSize = hecl::bench::Fixture::FileSize;
+  hecl::ClientProcess proc;
+  std::vector<hecl::ProjectPath> paths;
+  paths.reserve(fixture.files().size());
+  for (const hecl::SystemString& file : fixture.files())
+    paths.emplace_back(fixture.project(), file);
+  std::unique_ptr<uint8_t[]> target(new uint8_t[paths.size() * FileSize]);
+  std::list<std::shared_ptr<hecl::ClientProcess::Transaction>> done;
+  run.setItems(paths.size());
+  run.measure([&]() {
+    for (size_t i = 0; i < paths.size(); ++i)
+      proc.addBufferTransaction(paths[i], target.get() + i * FileSize, FileSize, 0);
+    proc.waitUntilComplete();
+    proc.swapCompletedQueue(done);
+    done.clear();
+  });
+}
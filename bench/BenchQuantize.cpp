@@ -0,0 +1,80 @@
+#include "Bench.hpp"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "hecl/Quantize.hpp"
+
+/* Array sizes are in the range of a large HMDL vertex buffer or a long animation track */
+namespace {
+constexpr size_t QuantizeCount = 1 << 20;
+
+std::vector<float> RandomFloats(size_t count, float lo, float hi) {
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<float> dist(lo, hi);
+  std::vector<float> ret(count);
+  for (float& f : ret)
+    f = dist(rng);
+  return ret;
+}
+} // anonymous namespace
+
+HECL_BENCHMARK(QuantizeFloatToHalf, "quantize/float-to-half") {
+  const std::vector<float> in = RandomFloats(QuantizeCount, -1000.f, 1000.f);
+  std::vector<uint16_t> out(QuantizeCount);
+  run.setItems(QuantizeCount);
+  run.measure([&]() { hecl::FloatToHalf(in.data(), out.data(), QuantizeCount); });
+}
+
+HECL_BENCHMARK(QuantizeHalfToFloat, "quantize/half-to-float") {
+  std::vector<uint16_t> in(QuantizeCount);
+  hecl::FloatToHalf(RandomFloats(QuantizeCount, -1000.f, 1000.f).data(), in.data(), QuantizeCount);
+  std::vector<float> out(QuantizeCount);
+  run.setItems(QuantizeCount);
+  run.measure([&]() { hecl::HalfToFloat(in.data(), out.data(), QuantizeCount); });
+}
+
+HECL_BENCHMARK(QuantizeFloatToUnorm16, "quantize/float-to-unorm16") {
+  const std::vector<float> in = RandomFloats(QuantizeCount, -0.25f, 1.25f);
+  std::vector<uint16_t> out(QuantizeCount);
+  run.setItems(QuantizeCount);
+  run.measure([&]() { hecl::FloatToUnorm16(in.data(), out.data(), QuantizeCount); });
+}
+
+HECL_BENCHMARK(QuantizeFloatToSnorm16, "quantize/float-to-snorm16") {
+  const std::vector<float> in = RandomFloats(QuantizeCount, -1.25f, 1.25f);
+  std::vector<int16_t> out(QuantizeCount);
+  run.setItems(QuantizeCount);
+  run.measure([&]() { hecl::FloatToSnorm16(in.data(), out.data(), QuantizeCount); });
+}
+
+HECL_BENCHMARK(QuantizeFloatToUnorm8, "quantize/float-to-unorm8") {
+  const std::vector<float> in = RandomFloats(QuantizeCount, -0.25f, 1.25f);
+  std::vector<uint8_t> out(QuantizeCount);
+  run.setItems(QuantizeCount);
+  run.measure([&]() { hecl::FloatToUnorm8(in.data(), out.data(), QuantizeCount); });
+}
+
+HECL_BENCHMARK(QuantizeSnorm16ToFloat, "quantize/snorm16-to-float") {
+  std::vector<int16_t> in(QuantizeCount);
+  hecl::FloatToSnorm16(RandomFloats(QuantizeCount, -1.f, 1.f).data(), in.data(), QuantizeCount);
+  std::vector<float> out(QuantizeCount);
+  run.setItems(QuantizeCount);
+  run.measure([&]() { hecl::Snorm16ToFloat(in.data(), out.data(), QuantizeCount); });
+}
+
+HECL_BENCHMARK(QuantizeOctEncode, "quantize/oct-encode") {
+  const std::vector<float> xyz = RandomFloats(QuantizeCount * 3, -1.f, 1.f);
+  std::vector<int16_t> out(QuantizeCount * 2);
+  run.setItems(QuantizeCount);
+  run.measure([&]() { hecl::OctEncodeSnorm16(xyz.data(), out.data(), QuantizeCount); });
+}
+
+HECL_BENCHMARK(QuantizeOctDecode, "quantize/oct-decode") {
+  std::vector<int16_t> in(QuantizeCount * 2);
+  hecl::OctEncodeSnorm16(RandomFloats(QuantizeCount * 3, -1.f, 1.f).data(), in.data(), QuantizeCount);
+  std::vector<float> xyz(QuantizeCount * 3);
+  run.setItems(QuantizeCount);
+  run.measure([&]() { hecl::OctDecodeSnorm16(in.data(), xyz.data(), QuantizeCount); });
+}
@@ -0,0 +1,119 @@
+#include "Bench.hpp"
+
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "hecl/ConcurrentCache.hpp"
+#include "hecl/Pipeline.hpp"
+#include "hecl/RangeAllocator.hpp"
+
+/* GPU buffer pools need a live graphics factory for their buckets, so their
+ * allocators are measured directly; VertexBufferPool sits on RangeAllocator */
+HECL_BENCHMARK(RangeAllocatorChurn, "pool/range-allocator") {
+  constexpr uint32_t BucketSize = 262144;
+  constexpr size_t LiveCount = 4096;
+  constexpr size_t OpCount = 65536;
+  hecl::RangeAllocator alloc(BucketSize);
+  for (uint32_t b = 0; b < 16; ++b)
+    alloc.addRange(b * BucketSize, BucketSize);
+
+  /* Random mix of mesh-sized blocks, released in random order to fragment the space */
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<uint32_t> sizes(16, 2048);
+  std::vector<std::pair<uint32_t, uint32_t>> live;
+  live.reserve(LiveCount);
+  for (size_t i = 0; i < LiveCount; ++i) {
+    const uint32_t size = sizes(rng);
+    live.emplace_back(alloc.allocate(size), size);
+  }
+
+  run.setItems(OpCount * 2);
+  run.measure([&]() {
+    for (size_t i = 0; i < OpCount; ++i) {
+      auto& slot = live[rng() % LiveCount];
+      if (slot.first != hecl::RangeAllocator::InvalidOffset)
+        alloc.release(slot.first, slot.second);
+      slot.second = sizes(rng);
+      slot.first = alloc.allocate(slot.second);
+    }
+  });
+}
+
+/* Stage and pipeline lookups of PipelineConverter go through ConcurrentCache */
+HECL_BENCHMARK(ConcurrentCacheHit, "pipeline/cache-hit") {
+  constexpr size_t KeyCount = 4096;
+  hecl::ConcurrentCache<uint64_t> cache;
+  std::vector<uint64_t> keys(KeyCount);
+  std::mt19937_64 rng(1234);
+  for (uint64_t& key : keys) {
+    key = rng();
+    cache.getOrCompute(key, [&]() { return key; });
+  }
+  run.setItems(KeyCount);
+  run.measure([&]() {
+    for (uint64_t key : keys)
+      cache.getOrCompute(key, [&]() { return key; });
+  });
+}
+
+HECL_BENCHMARK(ConcurrentCacheMiss, "pipeline/cache-miss") {
+  constexpr size_t KeyCount = 4096;
+  std::vector<uint64_t> keys(KeyCount);
+  std::mt19937_64 rng(1234);
+  for (uint64_t& key : keys)
+    key = rng();
+  run.setItems(KeyCount);
+  run.measure([&]() {
+    hecl::ConcurrentCache<uint64_t> cache;
+    for (uint64_t key : keys)
+      cache.getOrCompute(key, [&]() { return key; });
+  });
+}
+
+namespace {
+constexpr size_t ShaderCacheRecords = 512;
+constexpr size_t ShaderBinarySize = 8192;
+
+/* Cache file of pseudo-random, moderately compressible stage binaries */
+hecl::SystemString WriteShaderCache(hecl::bench::Fixture& fixture, std::vector<uint64_t>& hashes) {
+  const hecl::SystemString path = fixture.root() + _SYS_STR("/bench.shadercache");
+  hecl::Unlink(path.c_str());
+  hecl::ShaderCacheFile file;
+  file.open(path.c_str());
+  std::mt19937_64 rng(1234);
+  std::vector<uint8_t> binary(ShaderBinarySize);
+  hashes.resize(ShaderCacheRecords);
+  for (uint64_t& hash : hashes) {
+    hash = rng();
+    for (uint8_t& b : binary)
+      b = uint8_t(rng() % 16);
+    file.append(boo::PipelineStage::Fragment, hash, binary.data(), binary.size());
+  }
+  return path;
+}
+} // anonymous namespace
+
+HECL_BENCHMARK(ShaderCacheOpen, "pipeline/shadercache-open") {
+  std::vector<uint64_t> hashes;
+  const hecl::SystemString path = WriteShaderCache(fixture, hashes);
+  run.setItems(hashes.size());
+  run.measure([&]() {
+    hecl::ShaderCacheFile file;
+    file.open(path.c_str());
+  });
+}
+
+HECL_BENCHMARK(ShaderCacheLoad, "pipeline/shadercache-load") {
+  std::vector<uint64_t> hashes;
+  const hecl::SystemString path = WriteShaderCache(fixture, hashes);
+  run.setItems(hashes.size());
+  run.measure([&]() {
+    hecl::ShaderCacheFile file;
+    file.open(path.c_str());
+    for (uint64_t hash : hashes)
+      if (!file.read(boo::PipelineStage::Fragment, hash))
+        hecl::LogModule.report(logvisor::Fatal, FMT_STRING("shader cache record missing"));
+  });
+}
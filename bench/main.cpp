@@ -0,0 +1,131 @@
+#include "Bench.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "hecl/Database.hpp"
+
+#include <logvisor/logvisor.hpp>
+
+#include "DataSpecRegistry.hpp"
+
+namespace hecl::bench {
+static logvisor::Module Log("hecl-bench");
+
+std::vector<Benchmark>& Registry() {
+  static std::vector<Benchmark> registry;
+  return registry;
+}
+
+Fixture::Fixture() {
+  const auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+  const std::filesystem::path root =
+      std::filesystem::temp_directory_path() / fmt::format(FMT_STRING("hecl-bench-{:x}"), stamp);
+  m_root = root.native();
+  m_treeRoot = (root / "tree").native();
+  hecl::MakeDir(m_root.c_str());
+  hecl::MakeDir(m_treeRoot.c_str());
+  m_project = std::make_unique<Database::Project>(ProjectRootPath(m_root));
+
+  const std::vector<uint8_t> contents(FileSize, 0xa5);
+  m_files.reserve(DirCount * SubdirCount * FileCount);
+  for (size_t d = 0; d < DirCount; ++d) {
+    const SystemString dir = fmt::format(FMT_STRING(_SYS_STR("tree/dir{:02}")), d);
+    hecl::MakeDir((m_root + _SYS_STR('/') + dir).c_str());
+    for (size_t s = 0; s < SubdirCount; ++s) {
+      const SystemString subdir = fmt::format(FMT_STRING(_SYS_STR("{}/sub{:02}")), dir, s);
+      hecl::MakeDir((m_root + _SYS_STR('/') + subdir).c_str());
+      for (size_t f = 0; f < FileCount; ++f) {
+        SystemString file = fmt::format(FMT_STRING(_SYS_STR("{}/file{:02}.bin")), subdir, f);
+        auto fp = hecl::FopenUnique((m_root + _SYS_STR('/') + file).c_str(), _SYS_STR("wb"));
+        if (!fp || std::fwrite(contents.data(), 1, contents.size(), fp.get()) != contents.size())
+          Log.report(logvisor::Fatal, FMT_STRING(_SYS_STR("unable to write fixture file '{}'")), file);
+        m_files.push_back(std::move(file));
+      }
+    }
+  }
+}
+
+Fixture::~Fixture() {
+  m_project.reset();
+  std::error_code ec;
+  std::filesystem::remove_all(m_root, ec);
+}
+
+static void PrintUsage() {
+  std::fputs("Usage: hecl-bench [--list] [--filter <substring>] [--min-time <ms>] [--min-iters <count>] "
+             "[--csv]\n",
+             stderr);
+}
+
+} // namespace hecl::bench
+
+int main(int argc, char** argv) {
+  using namespace hecl::bench;
+  logvisor::RegisterConsoleLogger();
+  logvisor::RegisterStandardExceptions();
+
+  bool list = false;
+  bool csv = false;
+  std::string_view filter;
+  long minTimeMs = 500;
+  long minIterations = 5;
+  for (int i = 1; i < argc; ++i) {
+    const bool hasValue = i + 1 < argc;
+    if (!std::strcmp(argv[i], "--list")) {
+      list = true;
+    } else if (!std::strcmp(argv[i], "--csv")) {
+      csv = true;
+    } else if (!std::strcmp(argv[i], "--filter") && hasValue) {
+      filter = argv[++i];
+    } else if (!std::strcmp(argv[i], "--min-time") && hasValue) {
+      minTimeMs = std::strtol(argv[++i], nullptr, 10);
+    } else if (!std::strcmp(argv[i], "--min-iters") && hasValue) {
+      minIterations = std::max(1l, std::strtol(argv[++i], nullptr, 10));
+    } else {
+      PrintUsage();
+      return 1;
+    }
+  }
+
+  std::vector<Benchmark> selected;
+  for (const Benchmark& bench : Registry())
+    if (bench.m_name.find(filter) != std::string_view::npos)
+      selected.push_back(bench);
+  std::sort(selected.begin(), selected.end(),
+            [](const Benchmark& a, const Benchmark& b) { return a.m_name < b.m_name; });
+
+  if (list) {
+    for (const Benchmark& bench : selected)
+      fmt::print(FMT_STRING("{}\n"), bench.m_name);
+    return 0;
+  }
+
+  /* Results go to stdout one record per line so runs can be diffed or collected by CI */
+  if (csv)
+    fmt::print(FMT_STRING("name,iterations,items,min_ns,median_ns,mean_ns,items_per_sec\n"));
+  Fixture fixture;
+  for (const Benchmark& bench : selected) {
+    Run run(bench.m_name, std::chrono::milliseconds(minTimeMs), size_t(minIterations));
+    bench.m_func(run, fixture);
+    const Result res = run.result();
+    const double itemsPerSec = res.m_medianNs > 0.0 ? double(res.m_items) * 1e9 / res.m_medianNs : 0.0;
+    if (csv)
+      fmt::print(FMT_STRING("{},{},{},{:.0f},{:.0f},{:.0f},{:.0f}\n"), res.m_name, res.m_iterations, res.m_items,
+                 res.m_minNs, res.m_medianNs, res.m_meanNs, itemsPerSec);
+    else
+      fmt::print(FMT_STRING("{{\"name\":\"{}\",\"iterations\":{},\"items\":{},\"min_ns\":{:.0f},\"median_ns\":{:.0f},"
+                            "\"mean_ns\":{:.0f},\"items_per_sec\":{:.0f}}}\n"),
+                 res.m_name, res.m_iterations, res.m_items, res.m_minNs, res.m_medianNs, res.m_meanNs, itemsPerSec);
+    std::fflush(stdout);
+  }
+
+  return 0;
+}
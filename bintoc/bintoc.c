@@ -1,61 +1,215 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 #include <zlib.h>
 
-#define CHUNK 16384
+#define CHUNK (1024 * 1024)
 #define LINE_BREAK 32
+#define STRING_LINE_BREAK 120
 static uint8_t buf[CHUNK];
 static uint8_t zbuf[CHUNK];
 
-void print_usage() { fprintf(stderr, "Usage: bintoc [--compress] <in> <out> <symbol>\n"); }
+enum Mode {
+  /* Array of integer literals; accepted by every compiler */
+  MODE_ARRAY,
+  /* Concatenated narrow string literal; fast for GCC and Clang, too long for MSVC */
+  MODE_STRING,
+  /* Assembler .incbin of the (possibly compressed) payload file; nothing to parse at all */
+  MODE_INCBIN
+};
 
-int main(int argc, char** argv) {
-  if (argc < 4) {
-    print_usage();
-    return 1;
+void print_usage() {
+  fprintf(stderr, "Usage: bintoc [--compress] [--string | --incbin] <in> <out> <symbol>\n");
+}
+
+/* Buffered writer; formatting bytes through fprintf dominates run time on large inputs */
+static char outBuf[4 * CHUNK];
+static size_t outPos = 0;
+static FILE* fout = NULL;
+
+static void out_flush() {
+  fwrite(outBuf, 1, outPos, fout);
+  outPos = 0;
+}
+
+static void out_reserve(size_t sz) {
+  if (outPos + sz > sizeof(outBuf))
+    out_flush();
+}
+
+static void out_str(const char* str) {
+  size_t len = strlen(str);
+  out_reserve(len);
+  memcpy(outBuf + outPos, str, len);
+  outPos += len;
+}
+
+/* Emits payload bytes in the selected literal form; column tracks line breaks across calls */
+static size_t column = 0;
+
+static void emit_array(const uint8_t* data, size_t sz) {
+  for (size_t i = 0; i < sz; ++i) {
+    out_reserve(16);
+    unsigned v = data[i];
+    if (v >= 100)
+      outBuf[outPos++] = (char)('0' + v / 100);
+    if (v >= 10)
+      outBuf[outPos++] = (char)('0' + v / 10 % 10);
+    outBuf[outPos++] = (char)('0' + v % 10);
+    outBuf[outPos++] = ',';
+    if (++column == LINE_BREAK) {
+      memcpy(outBuf + outPos, "\n    ", 5);
+      outPos += 5;
+      column = 0;
+    }
   }
-  char* input = argv[1];
-  char* output = argv[2];
-  char* symbol = argv[3];
+}
+
+static void emit_string(const uint8_t* data, size_t sz) {
+  for (size_t i = 0; i < sz; ++i) {
+    out_reserve(16);
+    uint8_t c = data[i];
+    if (c >= 0x20 && c < 0x7f && c != '\\' && c != '"' && c != '?') {
+      outBuf[outPos++] = (char)c;
+      ++column;
+    } else {
+      /* Three-digit octal escapes can't absorb a following digit */
+      outBuf[outPos++] = '\\';
+      outBuf[outPos++] = (char)('0' + (c >> 6));
+      outBuf[outPos++] = (char)('0' + ((c >> 3) & 7));
+      outBuf[outPos++] = (char)('0' + (c & 7));
+      column += 4;
+    }
+    if (column >= STRING_LINE_BREAK) {
+      memcpy(outBuf + outPos, "\"\n    \"", 7);
+      outPos += 7;
+      column = 0;
+    }
+  }
+}
+
+static enum Mode mode = MODE_ARRAY;
+static FILE* fpayload = NULL;
+
+static bool emit(const uint8_t* data, size_t sz) {
+  switch (mode) {
+  case MODE_ARRAY:
+    emit_array(data, sz);
+    break;
+  case MODE_STRING:
+    emit_string(data, sz);
+    break;
+  case MODE_INCBIN:
+    if (fpayload && fwrite(data, 1, sz, fpayload) != sz)
+      return false;
+    break;
+  }
+  return true;
+}
+
+static void emit_incbin(const char* symbol, const char* payloadPath) {
+  out_str("#if __APPLE__\n"
+          "#define BINTOC_SECTION \".const_data\\n\"\n"
+          "#define BINTOC_ENDSECTION \".text\\n\"\n"
+          "#define BINTOC_SYM(s) \"_\" #s\n"
+          "#else\n"
+          "#define BINTOC_SECTION \".pushsection .rodata\\n\"\n"
+          "#define BINTOC_ENDSECTION \".popsection\\n\"\n"
+          "#define BINTOC_SYM(s) #s\n"
+          "#endif\n");
+  out_str("__asm__(BINTOC_SECTION\n        \".global \" BINTOC_SYM(");
+  out_str(symbol);
+  out_str(") \"\\n\"\n        \".balign 16\\n\"\n        BINTOC_SYM(");
+  out_str(symbol);
+  out_str(") \":\\n\"\n        \".incbin \\\"");
+  /* Escape the path for both the C string and the assembler string */
+  for (const char* p = payloadPath; *p; ++p) {
+    if (*p == '\\' || *p == '"')
+      out_str("\\\\\\");
+    out_reserve(1);
+    outBuf[outPos++] = *p;
+  }
+  out_str("\\\"\\n\"\n        \".byte 0\\n\"\n        BINTOC_ENDSECTION);\n");
+  out_str("extern \"C\" const uint8_t ");
+  out_str(symbol);
+  out_str("[];\n");
+}
+
+int main(int argc, char** argv) {
   bool compress = false;
-  if (strcmp(input, "--compress") == 0) {
-    if (argc < 5) {
+  int argi = 1;
+  for (; argi < argc && strncmp(argv[argi], "--", 2) == 0; ++argi) {
+    if (strcmp(argv[argi], "--compress") == 0)
+      compress = true;
+    else if (strcmp(argv[argi], "--string") == 0)
+      mode = MODE_STRING;
+    else if (strcmp(argv[argi], "--incbin") == 0)
+      mode = MODE_INCBIN;
+    else {
       print_usage();
       return 1;
     }
-    input = argv[2];
-    output = argv[3];
-    symbol = argv[4];
-    compress = true;
   }
+  if (argc - argi < 3) {
+    print_usage();
+    return 1;
+  }
+  char* input = argv[argi];
+  char* output = argv[argi + 1];
+  char* symbol = argv[argi + 2];
+
   FILE* fin = fopen(input, "rb");
   if (!fin) {
     fprintf(stderr, "Unable to open %s for reading\n", input);
     return 1;
   }
-  FILE* fout = fopen(output, "wb");
+  fout = fopen(output, "wb");
   if (!fout) {
     fprintf(stderr, "Unable to open %s for writing\n", output);
     return 1;
   }
-  fprintf(fout, "#include <cstdint>\n#include <cstddef>\n");
-  fprintf(fout, "extern \"C\" const uint8_t %s[] =\n{\n    ", symbol);
-  size_t totalSz = 0;
+
+  /* Uncompressed input can be included as-is; compressed output goes to a sidecar file */
+  char* payloadPath = input;
+  if (mode == MODE_INCBIN && compress) {
+    size_t outLen = strlen(output);
+    payloadPath = malloc(outLen + 5);
+    memcpy(payloadPath, output, outLen);
+    memcpy(payloadPath + outLen, ".bin", 5);
+    fpayload = fopen(payloadPath, "wb");
+    if (!fpayload) {
+      fprintf(stderr, "Unable to open %s for writing\n", payloadPath);
+      return 1;
+    }
+  }
+
+  out_str("#include <cstdint>\n#include <cstddef>\n");
+  if (mode == MODE_INCBIN) {
+    emit_incbin(symbol, payloadPath);
+  } else {
+    out_str("extern \"C\" const uint8_t ");
+    out_str(symbol);
+    out_str(mode == MODE_STRING ? "[] =\n    \"" : "[] =\n{\n    ");
+  }
+
+  unsigned long long totalSz = 0;
+  unsigned long long storedSz = 0;
   size_t readSz;
   if (compress) {
-    size_t compressedSz = 0;
     z_stream strm = {.zalloc = Z_NULL, .zfree = Z_NULL, .opaque = Z_NULL};
     int ret = deflateInit2(&strm, Z_BEST_COMPRESSION, Z_DEFLATED, MAX_WBITS | 16, MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY);
     if (ret != Z_OK) {
       fprintf(stderr, "zlib initialization failed %d\n", ret);
       return 1;
     }
-    while ((strm.avail_in = fread(buf, 1, sizeof(buf), fin))) {
+    int eof;
+    do {
+      strm.avail_in = (uInt)fread(buf, 1, sizeof(buf), fin);
       totalSz += strm.avail_in;
       strm.next_in = buf;
-      int eof = feof(fin);
+      eof = feof(fin) || ferror(fin);
       do {
         strm.next_out = zbuf;
         strm.avail_out = sizeof(zbuf);
@@ -65,31 +219,49 @@ int main(int argc, char** argv) {
           return 1;
         }
         size_t sz = sizeof(zbuf) - strm.avail_out;
-        if (sz > 0) {
-          for (int b = 0; b < sz; ++b) {
-            fprintf(fout, "0x%02X, ", zbuf[b]);
-            if ((compressedSz + b + 1) % LINE_BREAK == 0)
-              fprintf(fout, "\n    ");
-          }
-          compressedSz += sz;
+        if (!emit(zbuf, sz)) {
+          fprintf(stderr, "Unable to write %s\n", payloadPath);
+          return 1;
         }
-      } while (strm.avail_out == 0 || (eof && (ret == Z_OK || ret == Z_BUF_ERROR)));
-    }
+        storedSz += sz;
+      } while (strm.avail_out == 0);
+    } while (!eof);
     deflateEnd(&strm);
-    fprintf(fout, "0x00};\nextern \"C\" const size_t %s_SZ = %zu;\n", symbol, compressedSz);
-    fprintf(fout, "extern \"C\" const size_t %s_DECOMPRESSED_SZ = %zu;\n", symbol, totalSz);
   } else {
     while ((readSz = fread(buf, 1, sizeof(buf), fin))) {
-      for (int b = 0; b < readSz; ++b) {
-        fprintf(fout, "0x%02X, ", buf[b]);
-        if ((totalSz + b + 1) % LINE_BREAK == 0)
-          fprintf(fout, "\n    ");
-      }
+      /* Incbin reads the input directly; only the size is needed */
+      if (mode != MODE_INCBIN)
+        emit(buf, readSz);
       totalSz += readSz;
     }
-    fprintf(fout, "0x0};\nextern \"C\" const size_t %s_SZ = %zu;\n", symbol, totalSz);
+    storedSz = totalSz;
+  }
+  if (ferror(fin)) {
+    fprintf(stderr, "Unable to read %s\n", input);
+    return 1;
+  }
+
+  char tail[256];
+  if (mode == MODE_ARRAY)
+    out_str("0};\n");
+  else if (mode == MODE_STRING)
+    out_str("\";\n");
+  snprintf(tail, sizeof(tail), "extern \"C\" const size_t %s_SZ = %llu;\n", symbol, storedSz);
+  out_str(tail);
+  if (compress) {
+    snprintf(tail, sizeof(tail), "extern \"C\" const size_t %s_DECOMPRESSED_SZ = %llu;\n", symbol, totalSz);
+    out_str(tail);
+  }
+  out_flush();
+
+  if (fpayload && fclose(fpayload)) {
+    fprintf(stderr, "Unable to write %s\n", payloadPath);
+    return 1;
   }
   fclose(fin);
-  fclose(fout);
+  if (fclose(fout)) {
+    fprintf(stderr, "Unable to write %s\n", output);
+    return 1;
+  }
   return 0;
 }
@@ -1,21 +1,30 @@
 import struct
 
 def cook(writebuf, arm):
-    writebuf(struct.pack('I', len(arm.bones)))
-    for bone in arm.bones:
-        writebuf(struct.pack('I', len(bone.name)))
-        writebuf(bone.name.encode())
+    bones = arm.bones
+    writebuf(struct.pack('I', len(bones)))
+    for bone in bones:
+        name = bone.name.encode()
+        writebuf(struct.pack('I', len(name)))
+        writebuf(name)
+    if not len(bones):
+        return
 
-        writebuf(struct.pack('fff', bone.head_local[0], bone.head_local[1], bone.head_local[2]))
-
-        if bone.parent:
-            writebuf(struct.pack('i', arm.bones.find(bone.parent.name)))
-        else:
-            writebuf(struct.pack('i', -1))
-
-        writebuf(struct.pack('I', len(bone.children)))
-        for child in bone.children:
-            writebuf(struct.pack('i', arm.bones.find(child.name)))
+    # Each per-bone attribute goes out packed, so the reader takes it in one call
+    origins = []
+    parents = []
+    child_counts = []
+    children = []
+    for bone in bones:
+        origins.extend(bone.head_local[0:3])
+        parents.append(bones.find(bone.parent.name) if bone.parent else -1)
+        child_counts.append(len(bone.children))
+        children.extend(bones.find(child.name) for child in bone.children)
+    writebuf(struct.pack('%df' % len(origins), *origins))
+    writebuf(struct.pack('%di' % len(parents), *parents))
+    writebuf(struct.pack('%dI' % len(child_counts), *child_counts))
+    writebuf(struct.pack('I', len(children)))
+    writebuf(struct.pack('%di' % len(children), *children))
 
 def draw(layout, context):
     layout.prop_search(context.scene, 'hecl_arm_obj', context.scene, 'objects')
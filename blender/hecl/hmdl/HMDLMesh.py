@@ -1,4 +1,9 @@
 import bpy, bmesh, operator, struct
+from array import array
+try:
+    import numpy
+except ImportError:
+    numpy = None
 
 # Function to quantize normals to 15-bit precision
 def quant_norm(n):
@@ -98,3 +103,242 @@ def write_mesh_attrs(writebuf, bm, rna_loops, use_luv, material_slots):
         for l in f.loops:
             writebuf(struct.pack('I', l.index))
 
+
+# Vertex skin entries sorted by group with normalized weights, as write_mesh_attrs sends them
+def gather_vert_skins(bm, dlay):
+    vert_skin_counts = array('I')
+    skin_groups = array('I')
+    skin_weights = array('f')
+    for v in bm.verts:
+        if dlay:
+            sf = tuple(sorted(v[dlay].items()))
+            vert_skin_counts.append(len(sf))
+            total_len = 0.0
+            for ent in sf:
+                total_len += ent[1]
+            for ent in sf:
+                skin_groups.append(ent[0])
+                skin_weights.append(ent[1] / total_len)
+        else:
+            vert_skin_counts.append(0)
+    return vert_skin_counts, skin_groups, skin_weights
+
+# Gathers the write_mesh_attrs_soa arrays from the mesh datablock bm was created from,
+# using foreach_get for the per-element attributes and numpy for all derived topology.
+# Only valid while bm still matches mesh element for element; the mesh must be triangulated.
+def gather_mesh_arrays_numpy(mesh, bm, rna_loops, use_luv, material_slots):
+    np = numpy
+    vert_count = len(mesh.vertices)
+    edge_count = len(mesh.edges)
+    face_count = len(mesh.polygons)
+    loop_count = len(mesh.loops)
+
+    dlay = None
+    if len(bm.verts.layers.deform):
+        dlay = bm.verts.layers.deform[0]
+
+    # Verts
+    vert_co = np.empty(vert_count * 3, dtype=np.float32)
+    mesh.vertices.foreach_get('co', vert_co)
+    if dlay:
+        vert_skin_counts, skin_groups, skin_weights = gather_vert_skins(bm, dlay)
+    else:
+        vert_skin_counts = np.zeros(vert_count, dtype=np.uint32)
+        skin_groups = np.empty(0, dtype=np.uint32)
+        skin_weights = np.empty(0, dtype=np.float32)
+
+    # Face topology
+    face_loop_start = np.empty(face_count, dtype=np.uint32)
+    mesh.polygons.foreach_get('loop_start', face_loop_start)
+    face_loop_total = np.empty(face_count, dtype=np.uint32)
+    mesh.polygons.foreach_get('loop_total', face_loop_total)
+    if face_count and (face_loop_total != 3).any():
+        raise RuntimeError('%s is not triangulated' % mesh.name)
+    face_materials = np.empty(face_count, dtype=np.uint32)
+    mesh.polygons.foreach_get('material_index', face_materials)
+
+    # Loops
+    loop_vert = np.empty(loop_count, dtype=np.uint32)
+    mesh.loops.foreach_get('vertex_index', loop_vert)
+    loop_edge = np.empty(loop_count, dtype=np.uint32)
+    mesh.loops.foreach_get('edge_index', loop_edge)
+    loop_face = np.repeat(np.arange(face_count, dtype=np.uint32), 3)
+    loop_corner = np.arange(loop_count, dtype=np.uint32) - np.repeat(face_loop_start, 3)
+    loop_base = np.repeat(face_loop_start, 3)
+    loop_next = loop_base + (loop_corner + 1) % 3
+    loop_prev = loop_base + (loop_corner + 2) % 3
+
+    if rna_loops:
+        loop_normals = np.empty(loop_count * 3, dtype=np.float32)
+        rna_loops.foreach_get('normal', loop_normals)
+    else:
+        vert_normals = np.empty(vert_count * 3, dtype=np.float32)
+        mesh.vertices.foreach_get('normal', vert_normals)
+        loop_normals = vert_normals.reshape(-1, 3)[loop_vert].reshape(-1)
+    loop_normals = np.trunc(loop_normals * 16384) / 16384
+
+    # Vertex colors stay on bmesh; its color layers are what write_mesh_attrs has always sent
+    loop_colors = []
+    for clay in bm.loops.layers.color:
+        col = array('f')
+        for f in bm.faces:
+            for l in f.loops:
+                c = l[clay]
+                col.extend((c[0], c[1], c[2]))
+        loop_colors.append(col)
+
+    lightmapped = None
+    if use_luv and len(mesh.uv_layers):
+        # Every slot is evaluated, not just those faces reference, so tolerate empty slots and missing properties
+        slot_lightmapped = np.array([bool(slot.material and slot.material.get('retro_lightmapped', False))
+                                     for slot in material_slots] or [False])
+        lightmapped = np.repeat(slot_lightmapped[face_materials], 3)
+    loop_uvs = []
+    for ul, uv_layer in enumerate(mesh.uv_layers):
+        uv = np.empty(loop_count * 2, dtype=np.float32)
+        uv_layer.data.foreach_get('uv', uv)
+        if ul == 0 and lightmapped is not None:
+            uv = uv.reshape(-1, 2)
+            uv[lightmapped] = np.trunc(uv[lightmapped] * 32768) / 32768
+            uv = uv.reshape(-1)
+        loop_uvs.append(uv)
+
+    # Edges; a contiguous edge joins exactly two faces that wind it in opposite directions
+    edge_verts = np.empty(edge_count * 2, dtype=np.uint32)
+    mesh.edges.foreach_get('vertices', edge_verts)
+    edge_order = np.argsort(loop_edge, kind='stable')
+    edge_face_counts = np.bincount(loop_edge, minlength=edge_count).astype(np.uint32)
+    edge_faces = loop_face[edge_order]
+    edge_first = np.concatenate(([0], np.cumsum(edge_face_counts)[:-1])).astype(np.int64)
+    edge_contiguous = np.zeros(edge_count, dtype=np.uint32)
+    loop_radial_next = np.full(loop_count, 0xffffffff, dtype=np.uint32)
+    loop_radial_prev = np.full(loop_count, 0xffffffff, dtype=np.uint32)
+    pair_edges = np.nonzero(edge_face_counts == 2)[0]
+    if len(pair_edges):
+        la = edge_order[edge_first[pair_edges]]
+        lb = edge_order[edge_first[pair_edges] + 1]
+        contiguous = loop_vert[la] != loop_vert[lb]
+        edge_contiguous[pair_edges[contiguous]] = 1
+        la = la[contiguous]
+        lb = lb[contiguous]
+        loop_radial_next[la] = lb
+        loop_radial_prev[la] = lb
+        loop_radial_next[lb] = la
+        loop_radial_prev[lb] = la
+    loop_links = np.stack((loop_vert, loop_edge, loop_face, loop_next, loop_prev,
+                           loop_radial_next, loop_radial_prev), axis=1).reshape(-1)
+
+    # Faces
+    face_normals = np.empty(face_count * 3, dtype=np.float32)
+    mesh.polygons.foreach_get('normal', face_normals)
+    corner_co = vert_co.reshape(-1, 3)[loop_vert].reshape(-1, 3, 3)
+    face_centroids = ((corner_co.min(axis=1) + corner_co.max(axis=1)) * 0.5).reshape(-1)
+    face_loops = np.arange(loop_count, dtype=np.uint32)
+
+    return (len(loop_colors), len(loop_uvs), vert_count, len(skin_groups), loop_count,
+            edge_count, len(edge_faces), face_count), \
+           (vert_co, vert_skin_counts, skin_groups, skin_weights, loop_normals.astype(np.float32),
+            *loop_colors, *loop_uvs, loop_links, edge_verts, edge_face_counts, edge_faces,
+            edge_contiguous, face_normals, face_centroids.astype(np.float32), face_materials, face_loops)
+
+# Structure-of-arrays variant of write_mesh_attrs; each attribute is gathered
+# into a packed array and the whole block is written to a file that HECL maps
+# directly, keeping bulk geometry off the pipe. Returns the block size in bytes.
+# Given the mesh datablock bm was created from, attributes are gathered in bulk.
+def write_mesh_attrs_soa(path, bm, rna_loops, use_luv, material_slots, mesh=None):
+    if mesh is not None and numpy is not None:
+        counts, arrays = gather_mesh_arrays_numpy(mesh, bm, rna_loops, use_luv, material_slots)
+        with open(path, 'wb') as fp:
+            fp.write(b'HSOA')
+            fp.write(struct.pack('IIIIIIII', *counts))
+            for arr in arrays:
+                arr.tofile(fp)
+            return fp.tell()
+
+    dlay = None
+    if len(bm.verts.layers.deform):
+        dlay = bm.verts.layers.deform[0]
+
+    clays = []
+    for cl in range(len(bm.loops.layers.color)):
+        clays.append(bm.loops.layers.color[cl])
+
+    luvlay = None
+    if use_luv:
+        luvlay = bm.loops.layers.uv[0]
+    ulays = []
+    for ul in range(len(bm.loops.layers.uv)):
+        ulays.append(bm.loops.layers.uv[ul])
+
+    # Verts
+    vert_co = array('f')
+    for v in bm.verts:
+        vert_co.extend((v.co[0], v.co[1], v.co[2]))
+    vert_skin_counts, skin_groups, skin_weights = gather_vert_skins(bm, dlay)
+
+    # Loops
+    loop_normals = array('f')
+    loop_colors = [array('f') for cl in clays]
+    loop_uvs = [array('f') for ul in ulays]
+    loop_links = array('I')
+    for f in bm.faces:
+        lightmapped = luvlay and material_slots[f.material_index].material['retro_lightmapped']
+        for l in f.loops:
+            if rna_loops:
+                nf = quant_norm(rna_loops[l.index].normal)
+            else:
+                nf = quant_norm(l.vert.normal)
+            loop_normals.extend((nf[0], nf[1], nf[2]))
+            for cl in range(len(clays)):
+                col = l[clays[cl]]
+                loop_colors[cl].extend((col[0], col[1], col[2]))
+            for cl in range(len(ulays)):
+                if lightmapped and cl == 0:
+                    uv = quant_luv(l[luvlay].uv)
+                else:
+                    uv = l[ulays[cl]].uv
+                loop_uvs[cl].extend((uv[0], uv[1]))
+            loop_links.extend((l.vert.index, l.edge.index, l.face.index,
+                               l.link_loop_next.index, l.link_loop_prev.index))
+            if l.edge.is_contiguous:
+                loop_links.extend((l.link_loop_radial_next.index, l.link_loop_radial_prev.index))
+            else:
+                loop_links.extend((0xffffffff, 0xffffffff))
+
+    # Edges
+    edge_verts = array('I')
+    edge_face_counts = array('I')
+    edge_faces = array('I')
+    edge_contiguous = array('I')
+    for e in bm.edges:
+        for v in e.verts:
+            edge_verts.append(v.index)
+        edge_face_counts.append(len(e.link_faces))
+        for f in e.link_faces:
+            edge_faces.append(f.index)
+        edge_contiguous.append(1 if e.is_contiguous else 0)
+
+    # Faces
+    face_normals = array('f')
+    face_centroids = array('f')
+    face_materials = array('I')
+    face_loops = array('I')
+    for f in bm.faces:
+        norm = f.normal
+        face_normals.extend((norm[0], norm[1], norm[2]))
+        centroid = f.calc_center_bounds()
+        face_centroids.extend((centroid[0], centroid[1], centroid[2]))
+        face_materials.append(f.material_index)
+        for l in f.loops:
+            face_loops.append(l.index)
+
+    with open(path, 'wb') as fp:
+        fp.write(b'HSOA')
+        fp.write(struct.pack('IIIIIIII', len(clays), len(ulays), len(bm.verts), len(skin_groups),
+                             len(loop_links) // 7, len(bm.edges), len(edge_faces), len(bm.faces)))
+        for arr in (vert_co, vert_skin_counts, skin_groups, skin_weights, loop_normals,
+                    *loop_colors, *loop_uvs, loop_links, edge_verts, edge_face_counts,
+                    edge_faces, edge_contiguous, face_normals, face_centroids,
+                    face_materials, face_loops):
+            arr.tofile(fp)
+        return fp.tell()
@@ -33,7 +33,8 @@ def write_out_material(writebuf, mat, mesh_obj):
 
 # Takes a Blender 'Mesh' object (not the datablock)
 # and performs a one-shot conversion process to HMDL
-def cook(writebuf, mesh_obj, use_luv=False):
+# If attr_path is provided, bulk attributes are written there rather than to writebuf
+def cook(writebuf, mesh_obj, use_luv=False, attr_path=None):
     if mesh_obj.type != 'MESH':
         raise RuntimeError("%s is not a mesh" % mesh_obj.name)
 
@@ -98,7 +99,18 @@ def cook(writebuf, mesh_obj, use_luv=False):
             write_out_material(writebuf, mat, mesh_obj)
 
     # Output attribute lists
-    HMDLMesh.write_mesh_attrs(writebuf, bm_master, rna_loops, use_luv, mesh_obj.material_slots)
+    attr_size = 0
+    if attr_path:
+        try:
+            attr_size = HMDLMesh.write_mesh_attrs_soa(attr_path, bm_master, rna_loops, use_luv,
+                                                      mesh_obj.material_slots, copy_mesh)
+        except OSError:
+            attr_size = 0
+    if attr_size:
+        writebuf(struct.pack('II', 1, attr_size))
+    else:
+        writebuf(struct.pack('I', 0))
+        HMDLMesh.write_mesh_attrs(writebuf, bm_master, rna_loops, use_luv, mesh_obj.material_slots)
 
     # Vertex groups
     writebuf(struct.pack('I', len(mesh_obj.vertex_groups)))
@@ -399,8 +399,8 @@ look_left = Quaternion((0.0, 0.0, 1.0), math.radians(90.0)) @ Quaternion((1.0, 0
 look_right = Quaternion((0.0, 0.0, 1.0), math.radians(-90.0)) @ Quaternion((1.0, 0.0, 0.0), math.radians(90.0))
 look_list = (look_forward, look_backward, look_up, look_down, look_left, look_right)
 
-# Render PVS for location
-def render_pvs(pathOut, location):
+# Scene state shared by every PVS probe; returns the cube camera object
+def _pvs_begin():
     bpy.context.scene.render.resolution_x = 256
     bpy.context.scene.render.resolution_y = 256
     bpy.context.scene.render.resolution_percentage = 100
@@ -432,25 +432,54 @@ def render_pvs(pathOut, location):
                 slot.material = mat
             mat_idx += 1
 
-    cam_obj.location = location
     cam_obj.rotation_mode = 'QUATERNION'
+    return cam_obj
 
+def _pvs_render(cam_obj, pathOut, location):
+    cam_obj.location = location
     for i in range(6):
         cam_obj.rotation_quaternion = look_list[i]
         bpy.context.scene.render.filepath = '%s%d' % (pathOut, i)
         bpy.ops.render.render(write_still=True)
 
+def _pvs_end(cam_obj):
+    cam = cam_obj.data
     bpy.context.scene.camera = None
     #bpy.context.scene.objects.unlink(cam_obj)
     bpy.data.objects.remove(cam_obj)
     bpy.data.cameras.remove(cam)
 
+# Render PVS for location
+def render_pvs(pathOut, location):
+    cam_obj = _pvs_begin()
+    _pvs_render(cam_obj, pathOut, location)
+    _pvs_end(cam_obj)
+
 # Render PVS for light
 def render_pvs_light(pathOut, lightName):
     if lightName not in bpy.context.scene.objects:
         raise RuntimeError('Unable to find light %s' % lightName)
     render_pvs(pathOut, bpy.context.scene.objects[lightName].location)
 
+# Render PVS for (pathOut, location, lightName) probes back to back with one scene setup;
+# a non-empty lightName overrides location. Returns success of each probe
+def render_pvs_batch(probes):
+    results = []
+    cam_obj = _pvs_begin()
+    try:
+        for pathOut, location, lightName in probes:
+            if lightName:
+                if lightName not in bpy.context.scene.objects:
+                    print('Unable to find light %s' % lightName)
+                    results.append(False)
+                    continue
+                location = bpy.context.scene.objects[lightName].location.copy()
+            _pvs_render(cam_obj, pathOut, location)
+            results.append(True)
+    finally:
+        _pvs_end(cam_obj)
+    return results
+
 # Cook
 def cook(writebuffunc, platform, endianchar):
     print('COOKING SREA')
@@ -4,6 +4,8 @@ ARGS_PATTERN = re.compile(r'''(?:"([^"]+)"|'([^']+)'|(\S+))''')
 
 # Background mode seems to require quit() in some 2.80 builds
 def _quitblender():
+    if '_writebuf' in globals():
+        flushpipe()
     bpy.ops.wm.quit_blender()
     quit()
 
@@ -30,24 +32,53 @@ else:
     if 'TMPDIR' in os.environ:
         err_path = os.environ['TMPDIR']
 
-err_path += "/hecl_%016X.derp" % os.getpid()
+tmp_dir = err_path
+mesh_attr_path = tmp_dir + "/hecl_%016X.mesh" % os.getpid()
+err_path = tmp_dir + "/hecl_%016X.derp" % os.getpid()
+
+# If there's a fifth argument, this instance may become a fork server on that socket
+forkserver_fd = int(args[4]) if len(args) >= 5 else -1
+
+# Outgoing data is batched and flushed before every blocking read
+PIPE_BUFFER_SIZE = 64 * 1024
+_writebuf = bytearray()
+
+def flushpipe():
+    pos = 0
+    while pos < len(_writebuf):
+        pos += os.write(writefd, _writebuf[pos:])
+    _writebuf.clear()
+
+def readpipebuf(read_len):
+    flushpipe()
+    read_bytes = bytearray()
+    while len(read_bytes) < read_len:
+        chunk = os.read(readfd, read_len - len(read_bytes))
+        if not len(chunk):
+            break
+        read_bytes += chunk
+    return bytes(read_bytes)
 
 def readpipestr():
-    read_bytes = os.read(readfd, 4)
+    read_bytes = readpipebuf(4)
     if len(read_bytes) != 4:
         print('HECL connection lost or desynchronized')
         _quitblender()
     read_len = struct.unpack('I', read_bytes)[0]
-    return os.read(readfd, read_len)
+    return readpipebuf(read_len)
 
 def writepipestr(linebytes):
     #print('LINE', linebytes)
-    os.write(writefd, struct.pack('I', len(linebytes)))
-    os.write(writefd, linebytes)
+    _writebuf.extend(struct.pack('I', len(linebytes)))
+    _writebuf.extend(linebytes)
+    if len(_writebuf) >= PIPE_BUFFER_SIZE:
+        flushpipe()
 
 def writepipebuf(linebytes):
     #print('BUF', linebytes)
-    os.write(writefd, linebytes)
+    _writebuf.extend(linebytes)
+    if len(_writebuf) >= PIPE_BUFFER_SIZE:
+        flushpipe()
 
 def quitblender():
     writepipestr(b'QUITTING')
@@ -129,10 +160,13 @@ def exec_compbuf(compbuf, globals):
         raise RuntimeError(trace_prefix) from e
 
 # Command loop for writing animation key data to blender
+# Raw value of 'LINEAR' in Keyframe.interpolation
+BEZT_IPO_LIN = 1
+
 def animin_loop(globals):
     writepipestr(b'ANIMREADY')
     while True:
-        crv_type = struct.unpack('b', os.read(readfd, 1))
+        crv_type = struct.unpack('b', readpipebuf(1))
         if crv_type[0] < 0:
             writepipestr(b'ANIMDONE')
             return
@@ -143,22 +177,22 @@ def animin_loop(globals):
         elif crv_type[0] == 2:
             crvs = globals['scaleCurves']
 
-        key_info = struct.unpack('ii', os.read(readfd, 8))
+        key_info = struct.unpack('ii', readpipebuf(8))
         crv = crvs[key_info[0]]
-        crv.keyframe_points.add(count=key_info[1])
-
-        if crv_type[0] == 1:
-            for k in range(key_info[1]):
-                key_data = struct.unpack('if', os.read(readfd, 8))
-                pt = crv.keyframe_points[k]
+        key_count = key_info[1]
+        if key_count <= 0:
+            continue
+
+        # Read the whole curve at once and assign keyframes in bulk rather than per key
+        key_data = struct.unpack('if' * key_count, readpipebuf(8 * key_count))
+        crv.keyframe_points.add(count=key_count)
+        crv.keyframe_points.foreach_set('co', key_data)
+        try:
+            crv.keyframe_points.foreach_set('interpolation', [BEZT_IPO_LIN] * key_count)
+        except (TypeError, AttributeError):
+            for pt in crv.keyframe_points:
                 pt.interpolation = 'LINEAR'
-                pt.co = (key_data[0], key_data[1])
-        else:
-            for k in range(key_info[1]):
-                key_data = struct.unpack('if', os.read(readfd, 8))
-                pt = crv.keyframe_points[k]
-                pt.interpolation = 'LINEAR'
-                pt.co = (key_data[0], key_data[1])
+        crv.update()
 
 def writelight(obj):
     wmtx = obj.matrix_world
@@ -246,7 +280,7 @@ def dataout_loop():
                 continue
 
             writepipestr(b'OK')
-            hecl.hmdl.cook(writepipebuf, bpy.data.objects[meshName])
+            hecl.hmdl.cook(writepipebuf, bpy.data.objects[meshName], attr_path=mesh_attr_path)
 
         elif cmdargs[0] == 'ARMATURECOMPILE':
             armName = bpy.context.scene.hecl_arm_obj
@@ -260,13 +294,17 @@ def dataout_loop():
         elif cmdargs[0] == 'MESHCOMPILENAME':
             meshName = cmdargs[1]
             useLuv = int(cmdargs[2])
+            # Pipelined requests each cook to their own attribute slot
+            attrPath = mesh_attr_path
+            if len(cmdargs) >= 4:
+                attrPath += '.%d' % int(cmdargs[3])
 
             if meshName not in bpy.data.objects:
                 writepipestr(('mesh %s not found' % meshName).encode())
                 continue
 
             writepipestr(b'OK')
-            hecl.hmdl.cook(writepipebuf, bpy.data.objects[meshName], useLuv)
+            hecl.hmdl.cook(writepipebuf, bpy.data.objects[meshName], useLuv, attrPath)
 
         elif cmdargs[0] == 'MESHCOMPILENAMECOLLISION':
             meshName = cmdargs[1]
@@ -415,13 +453,15 @@ def dataout_loop():
                 continue
 
             writepipestr(b'OK')
-            writepipebuf(struct.pack('I', len(armObj.data.bones)))
-            for bone in armObj.data.bones:
-                writepipebuf(struct.pack('I', len(bone.name)))
-                writepipebuf(bone.name.encode())
-                for r in bone.matrix_local.to_3x3():
-                    for c in r:
-                        writepipebuf(struct.pack('f', c))
+            bones = armObj.data.bones
+            writepipebuf(struct.pack('I', len(bones)))
+            for bone in bones:
+                name = bone.name.encode()
+                writepipebuf(struct.pack('I', len(name)))
+                writepipebuf(name)
+            if len(bones):
+                mats = [c for bone in bones for r in bone.matrix_local.to_3x3() for c in r]
+                writepipebuf(struct.pack('%df' % len(mats), *mats))
 
         elif cmdargs[0] == 'RENDERPVS':
             pathOut = cmdargs[1]
@@ -437,6 +477,17 @@ def dataout_loop():
             hecl.srea.render_pvs_light(pathOut, lightName)
             writepipestr(b'OK')
 
+        elif cmdargs[0] == 'RENDERPVSBATCH':
+            probes = []
+            for i in range(int(cmdargs[1])):
+                pathOut = readpipestr().decode()
+                lightName = readpipestr().decode()
+                location = struct.unpack('fff', readpipebuf(12))
+                probes.append((pathOut, location, lightName))
+            writepipestr(b'OK')
+            for result in hecl.srea.render_pvs_batch(probes):
+                writepipebuf(struct.pack('B', result))
+
         elif cmdargs[0] == 'MAPAREACOMPILE':
             if 'MAP' not in bpy.data.objects:
                 writepipestr(('"MAP" object not in .blend').encode())
@@ -454,6 +505,102 @@ def dataout_loop():
 
 loaded_blend = None
 
+# Serve one fork request from sock; the forked child takes over the connection whose pipes came with it.
+# Returns None once the requesting hecl closed sock, and True in the child after its handshake.
+def forkserver_request(sock, others):
+    global readfd, writefd, err_path, mesh_attr_path
+    import socket, signal, array
+    fd_size = array.array('i').itemsize
+    msg, ancdata, flags, addr = sock.recvmsg(1, socket.CMSG_LEN(2 * fd_size))
+    if not msg:
+        return None
+    fds = array.array('i')
+    for level, kind, data in ancdata:
+        if level == socket.SOL_SOCKET and kind == socket.SCM_RIGHTS:
+            fds.frombytes(data[:len(data) - (len(data) % fd_size)])
+    if len(fds) != 2:
+        for fd in fds:
+            os.close(fd)
+        sock.sendall(struct.pack('i', -1))
+        return False
+
+    pid = os.fork()
+    if pid:
+        os.close(fds[0])
+        os.close(fds[1])
+        sock.sendall(struct.pack('i', pid))
+        return False
+
+    for other in others:
+        other.close()
+    sock.close()
+    signal.signal(signal.SIGCHLD, signal.SIG_DFL)
+    if readfd >= 0:
+        os.close(readfd)
+        os.close(writefd)
+    readfd = fds[0]
+    writefd = fds[1]
+    mesh_attr_path = tmp_dir + "/hecl_%016X.mesh" % os.getpid()
+    err_path = tmp_dir + "/hecl_%016X.derp" % os.getpid()
+    _writebuf.clear()
+    writepipestr(b'READY')
+    if readpipestr() != b'ACK':
+        quitblender()
+    return True
+
+# Fork a ready instance per request of the hecl process that launched this one
+def forkserver_loop():
+    import socket, signal
+    sock = socket.socket(fileno=forkserver_fd)
+    # hecl cannot wait on these children, so let the kernel reap them
+    signal.signal(signal.SIGCHLD, signal.SIG_IGN)
+    while True:
+        served = forkserver_request(sock, ())
+        if served is None:
+            sock.close()
+            quitblender()
+        if served:
+            return
+
+# Idle seconds without any connected hecl process before a persistent fork server exits
+FORKDAEMON_IDLE_TIMEOUT = 30 * 60
+
+# Fork ready instances for every hecl process connecting to the listening socket, outliving the one that launched it
+def forkdaemon_loop():
+    global readfd, writefd
+    import socket, signal, select
+    listener = socket.socket(fileno=forkserver_fd)
+    signal.signal(signal.SIGCHLD, signal.SIG_IGN)
+    # Leave the launching terminal's session so its hangup or Ctrl+C doesn't end the server
+    os.setsid()
+    os.close(readfd)
+    os.close(writefd)
+    readfd = writefd = -1
+    daemon_pid = os.getpid()
+    clients = []
+    while True:
+        ready, _, _ = select.select([listener] + clients, [], [], None if clients else FORKDAEMON_IDLE_TIMEOUT)
+        if not ready:
+            listener.close()
+            os._exit(0)
+        for sock in ready:
+            if sock is listener:
+                client, _ = listener.accept()
+                clients.append(client)
+                continue
+            try:
+                served = forkserver_request(sock, [listener] + [c for c in clients if c is not sock])
+            except OSError:
+                # A forked child must never carry on serving as a second server
+                if os.getpid() != daemon_pid:
+                    os._exit(1)
+                served = None
+            if served is None:
+                clients.remove(sock)
+                sock.close()
+            elif served:
+                return
+
 # Main exception handling
 try:
     # Command loop
@@ -464,6 +611,17 @@ try:
         if cmdargs[0] == 'QUIT':
             quitblender()
 
+        elif cmdargs[0] == 'FORKSERVER' or cmdargs[0] == 'FORKDAEMON':
+            if forkserver_fd < 0:
+                writepipestr(b'ERROR')
+            else:
+                writepipestr(b'OK')
+                flushpipe()
+                if cmdargs[0] == 'FORKDAEMON':
+                    forkdaemon_loop()
+                else:
+                    forkserver_loop()
+
         elif cmdargs[0] == 'OPEN':
             if 'FINISHED' in bpy.ops.wm.open_mainfile(filepath=cmdargs[1]):
                 if bpy.ops.object.mode_set.poll():
@@ -584,6 +742,7 @@ try:
             hecl.command(cmdargs, writepipestr, writepipebuf)
 
 except Exception:
+    flushpipe()
     fout = open(err_path, 'w')
     traceback.print_exc(file=fout)
     fout.close()
@@ -1,8 +1,17 @@
 #pragma once
 
 #include "ToolBase.hpp"
+#include <algorithm>
 #include <cstdio>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include "hecl/Blender/SyntheticProject.hpp"
 #include "hecl/ClientProcess.hpp"
+#include "hecl/FileWatcher.hpp"
+#include "hecl/RemoteCookAgent.hpp"
+#include "hecl/Trace.hpp"
 
 class ToolCook final : public ToolBase {
   std::vector<hecl::ProjectPath> m_selectedItems;
@@ -11,6 +20,293 @@ class ToolCook final : public ToolBase {
   const hecl::Database::DataSpecEntry* m_spec = nullptr;
   bool m_recursive = false;
   bool m_fast = false;
+  bool m_progressive = false;
+  bool m_watch = false;
+  bool m_agent = false;
+  hecl::SystemString m_tracePath;
+  bool m_report = false;
+  std::optional<uint64_t> m_gcBudgetMb;
+  std::optional<uint64_t> m_memoryBudgetMb;
+  std::optional<bool> m_store;
+  bool m_bench = false;
+  hecl::blender::SyntheticProjectDesc m_benchDesc;
+  hecl::SystemString m_benchDir;
+
+  /* Watch mode state: reverse cook dependencies of every known working path */
+  std::unique_ptr<hecl::FileWatcher> m_watcher;
+  std::unordered_map<hecl::ProjectPath, std::vector<hecl::ProjectPath>> m_deps;
+  std::unordered_map<hecl::ProjectPath, std::vector<hecl::ProjectPath>> m_dependents;
+
+  bool isSelected(const hecl::ProjectPath& path) const {
+    const hecl::SystemStringView rel = path.getRelativePath();
+    for (const hecl::ProjectPath& item : m_selectedItems) {
+      const hecl::SystemStringView itemRel = item.getRelativePath();
+      if (itemRel == _SYS_STR(".") || rel == itemRel ||
+          (rel.size() > itemRel.size() && !rel.compare(0, itemRel.size(), itemRel) && rel[itemRel.size()] == '/'))
+        return true;
+    }
+    return false;
+  }
+
+  void setDeps(const hecl::ProjectPath& path, std::vector<hecl::ProjectPath>&& deps) {
+    std::vector<hecl::ProjectPath>& oldDeps = m_deps[path];
+    for (const hecl::ProjectPath& dep : oldDeps) {
+      std::vector<hecl::ProjectPath>& users = m_dependents[dep];
+      users.erase(std::remove(users.begin(), users.end(), path), users.end());
+    }
+    oldDeps = std::move(deps);
+    for (const hecl::ProjectPath& dep : oldDeps)
+      m_dependents[dep].push_back(path);
+  }
+
+  void buildDependents() {
+    m_deps.clear();
+    m_dependents.clear();
+    for (const hecl::ProjectPath& item : m_selectedItems) {
+      const hecl::Database::PackageDepsgraph graph = m_useProj->buildPackageDepsgraph(item);
+      for (const hecl::Database::PackageDepsgraph::Node& node : graph.getNodes()) {
+        if (node.type != hecl::Database::PackageDepsgraph::Node::Type::Data)
+          continue;
+        std::vector<hecl::ProjectPath> deps;
+        deps.reserve(node.deps.size());
+        for (const hecl::Database::PackageDepsgraph::Node* dep : node.deps)
+          deps.push_back(dep->path);
+        setDeps(node.path, std::move(deps));
+      }
+    }
+  }
+
+  /* Recook changed paths as they are saved, followed by everything depending on them */
+  void watch(const hecl::MultiProgressPrinter& printer, hecl::ClientProcess& cp) {
+    m_watcher = std::make_unique<hecl::FileWatcher>(m_useProj->getProjectWorkingPath().getAbsolutePath());
+    if (!*m_watcher)
+      return;
+    buildDependents();
+    LogModule.report(logvisor::Info, FMT_STRING(_SYS_STR("watching for changes; press Ctrl+C to stop")));
+
+    std::vector<hecl::SystemString> changed;
+    while (m_watcher->waitForChanges(changed)) {
+      /* Cached metadata predates the change */
+      m_useProj->getStatCache().clear();
+
+      std::vector<hecl::ProjectPath> wave;
+      bool structural = false;
+      for (const hecl::SystemString& absPath : changed) {
+        hecl::ProjectPath path(*m_useProj, absPath);
+        if (!isSelected(path))
+          continue;
+        switch (path.getPathType()) {
+        case hecl::ProjectPath::Type::None:
+          /* Deleted or moved away; nothing to cook, but dependency edges are stale */
+          structural = true;
+          break;
+        case hecl::ProjectPath::Type::Directory:
+          structural = true;
+          wave.push_back(std::move(path));
+          break;
+        default:
+          if (m_deps.find(path) == m_deps.end()) {
+            structural = true;
+          } else {
+            /* Edits may add or drop references, such as a newly linked texture */
+            std::vector<hecl::ProjectPath> deps;
+            m_useProj->getCookDependencies(path, deps, m_spec);
+            setDeps(path, std::move(deps));
+          }
+          wave.push_back(std::move(path));
+          break;
+        }
+      }
+      if (structural)
+        buildDependents();
+
+      /* Each wave finishes before its dependents start, as in a full cook */
+      std::unordered_set<hecl::ProjectPath> visited;
+      while (!wave.empty()) {
+        std::vector<hecl::ProjectPath> nextWave;
+        for (const hecl::ProjectPath& path : wave) {
+          if (!visited.insert(path).second)
+            continue;
+          m_useProj->cookPath(path, printer, path.isDirectory(), false, m_fast || m_progressive, m_spec, &cp);
+          auto search = m_dependents.find(path);
+          if (search != m_dependents.end())
+            nextWave.insert(nextWave.end(), search->second.begin(), search->second.end());
+        }
+        cp.waitUntilComplete();
+        wave = std::move(nextWave);
+      }
+      m_useProj->saveBridgePathCache();
+      printer.startNewLine();
+    }
+  }
+
+  /* Summary of .hecl/cooktimes for --report */
+  void report() {
+    using Entry = hecl::Database::CookTimings::Entry;
+    const std::vector<Entry> entries = m_useProj->getCookTimings().snapshot();
+    if (entries.empty()) {
+      fmt::print(FMT_STRING("no cook times recorded yet\n"));
+      return;
+    }
+    uint32_t latestRun = 0;
+    for (const Entry& ent : entries)
+      latestRun = std::max(latestRun, ent.m_last.m_run);
+    const auto seconds = [](uint64_t ns) { return double(ns) / 1e9; };
+    constexpr size_t ListCount = 20;
+
+    std::vector<const Entry*> latest;
+    for (const Entry& ent : entries)
+      if (ent.m_last.m_run == latestRun)
+        latest.push_back(&ent);
+    std::sort(latest.begin(), latest.end(),
+              [](const Entry* a, const Entry* b) { return a->m_last.m_wallNs > b->m_last.m_wallNs; });
+    fmt::print(FMT_STRING("Slowest assets of run {}:\n{:>10} {:>10} {:>10}  path\n"), latestRun, "wall", "blender",
+               "peak");
+    for (size_t i = 0; i < std::min(ListCount, latest.size()); ++i) {
+      const Entry& ent = *latest[i];
+      fmt::print(FMT_STRING("{:>9.2f}s {:>9.2f}s {:>7}MiB  {} [{}]\n"), seconds(ent.m_last.m_wallNs),
+                 seconds(ent.m_last.m_blenderNs), ent.m_last.m_peakRssKb / 1024, ent.m_path, ent.m_spec);
+    }
+
+    /* Slowdowns within a fifth of the old time (or 50ms) are treated as noise */
+    std::vector<const Entry*> regressions;
+    for (const Entry* ent : latest) {
+      const uint64_t prev = ent->m_previous.m_wallNs;
+      if (ent->m_previous.m_run && ent->m_last.m_wallNs > prev + std::max(prev / 5, uint64_t(50000000)))
+        regressions.push_back(ent);
+    }
+    std::sort(regressions.begin(), regressions.end(), [](const Entry* a, const Entry* b) {
+      return a->m_last.m_wallNs - a->m_previous.m_wallNs > b->m_last.m_wallNs - b->m_previous.m_wallNs;
+    });
+    fmt::print(FMT_STRING("\nRegressions since the previous cook of each asset:\n"));
+    if (regressions.empty())
+      fmt::print(FMT_STRING("  none\n"));
+    for (size_t i = 0; i < std::min(ListCount, regressions.size()); ++i) {
+      const Entry& ent = *regressions[i];
+      fmt::print(FMT_STRING("{:>+9.2f}s  {:.2f}s -> {:.2f}s (run {})  {}\n"),
+                 seconds(ent.m_last.m_wallNs - ent.m_previous.m_wallNs), seconds(ent.m_previous.m_wallNs),
+                 seconds(ent.m_last.m_wallNs), ent.m_previous.m_run, ent.m_path);
+    }
+
+    /* Aggregates use the latest sample of every asset ever cooked */
+    std::unordered_map<std::string, std::pair<uint64_t, size_t>> perSpec;
+    std::unordered_map<std::string, std::pair<uint64_t, size_t>> perType;
+    for (const Entry& ent : entries) {
+      std::string_view name = ent.m_path;
+      name = name.substr(0, name.find('|'));
+      name = name.substr(name.rfind('/') + 1);
+      const size_t dot = name.rfind('.');
+      const std::string type = dot == std::string_view::npos ? "(none)" : std::string(name.substr(dot));
+      for (auto* agg : {&perSpec[ent.m_spec], &perType[type]}) {
+        agg->first += ent.m_last.m_wallNs;
+        ++agg->second;
+      }
+    }
+    const auto printTotals = [&](const char* title, const auto& totals) {
+      std::vector<std::pair<std::string, std::pair<uint64_t, size_t>>> sorted(totals.begin(), totals.end());
+      std::sort(sorted.begin(), sorted.end(),
+                [](const auto& a, const auto& b) { return a.second.first > b.second.first; });
+      fmt::print(FMT_STRING("\n{}:\n"), title);
+      for (const auto& [name, total] : sorted)
+        fmt::print(FMT_STRING("{:>9.2f}s  {:>6} assets  {}\n"), seconds(total.first), total.second, name);
+    };
+    printTotals("Time per DataSpec", perSpec);
+    printTotals("Time per type", perType);
+  }
+
+  /* --bench: generate a fresh synthetic project, then cook and package it with timing */
+  int bench() {
+    hecl::Sstat theStat;
+    if (!hecl::Stat((m_benchDir + _SYS_STR("/.hecl/beacon")).c_str(), &theStat)) {
+      LogModule.report(logvisor::Error,
+                       FMT_STRING(_SYS_STR("project already exists at '{}'; remove it or pass another --bench-dir")),
+                       m_benchDir);
+      return 1;
+    }
+    hecl::MakeDir(m_benchDir.c_str());
+    m_fallbackProj = std::make_unique<hecl::Database::Project>(hecl::ProjectRootPath(m_benchDir));
+    m_useProj = m_fallbackProj.get();
+
+    std::vector<hecl::SystemString> specs;
+    for (const hecl::Database::DataSpecEntry* spec : hecl::Database::DATA_SPEC_REGISTRY)
+      if (spec->m_factory && (!m_spec || spec == m_spec))
+        specs.emplace_back(spec->m_name);
+    if (specs.empty()) {
+      LogModule.report(logvisor::Error, FMT_STRING("this build of hecl has no DataSpec to cook with"));
+      return 1;
+    }
+    m_useProj->enableDataSpecs(specs);
+
+    const hecl::ProjectPath root(*m_useProj, _SYS_STR("synthetic"));
+    const hecl::blender::SyntheticProjectDesc& desc = m_benchDesc;
+    const size_t fileCount = size_t(desc.textureCount) + desc.yamlCount + desc.meshCount;
+    uint64_t begin = hecl::trace::Now();
+    size_t written;
+    {
+      hecl::ClientProcess gen;
+      written = hecl::blender::GenerateSyntheticProject(root, desc, gen);
+    }
+    const uint64_t generateNs = hecl::trace::Now() - begin;
+    if (written != fileCount) {
+      LogModule.report(logvisor::Error, FMT_STRING("generated {} of {} synthetic files"), written, fileCount);
+      return 1;
+    }
+
+    /* Timed as a regular cook; generation workers and their Blenders are gone by now */
+    hecl::MultiProgressPrinter printer(true);
+    hecl::ClientProcess cp(&printer);
+    if (m_memoryBudgetMb)
+      cp.setMemoryBudget(*m_memoryBudgetMb * 1024);
+    m_useProj->getStatCache().setEnabled(true);
+    begin = hecl::trace::Now();
+    m_useProj->cookPath(root, printer, true, false, m_fast, m_spec, &cp);
+    cp.waitUntilComplete();
+    const uint64_t cookNs = hecl::trace::Now() - begin;
+    const hecl::ClientProcess::Totals cookTotals = cp.totals();
+    begin = hecl::trace::Now();
+    const bool packaged = m_useProj->packagePath(root, printer, m_fast, m_spec, &cp);
+    cp.waitUntilComplete();
+    const uint64_t packageNs = hecl::trace::Now() - begin;
+    m_useProj->getStatCache().setEnabled(false);
+    printer.startNewLine();
+
+    /* Every cook of this fresh project belongs to its first run */
+    size_t assets = 0;
+    uint64_t assetNs = 0;
+    uint64_t blenderNs = 0;
+    uint64_t blenderPeakKb = 0;
+    for (const hecl::Database::CookTimings::Entry& ent : m_useProj->getCookTimings().snapshot()) {
+      ++assets;
+      assetNs += ent.m_last.m_wallNs;
+      blenderNs += ent.m_last.m_blenderNs;
+      if (ent.m_last.m_blenderNs)
+        blenderPeakKb = std::max(blenderPeakKb, ent.m_last.m_peakRssKb);
+    }
+
+    const auto seconds = [](uint64_t ns) { return double(ns) / 1e9; };
+    const auto percent = [](uint64_t part, uint64_t whole) { return whole ? 100.0 * double(part) / whole : 0.0; };
+    fmt::print(FMT_STRING("\nSynthetic project at {}\n"
+                          "  {} PNGs of {}px, {} YAMLs of {} entries, {} blends at subdivision {}\n\n"),
+               root.getAbsolutePathUTF8(), desc.textureCount, desc.textureSize, desc.yamlCount, desc.yamlEntries,
+               desc.meshCount, std::min(desc.meshSubdivisions, 8u));
+    fmt::print(FMT_STRING("{:>10} {:>9.2f}s  {} files\n"), "generate", seconds(generateNs), written);
+    fmt::print(FMT_STRING("{:>10} {:>9.2f}s  {} assets, {:.1f} assets/s\n"), "cook", seconds(cookNs), assets,
+               cookNs ? assets / seconds(cookNs) : 0.0);
+    fmt::print(FMT_STRING("{:>10} {:>9.2f}s  {}\n"), "package", seconds(packageNs), packaged ? "ok" : "failed");
+    fmt::print(FMT_STRING("{:>10} {:>9.1f}%  of {} workers busy during cook, {:.1f}% waiting on locks\n"), "workers",
+               percent(cookTotals.busyNs, cookNs * cookTotals.workers), cookTotals.workers,
+               percent(cookTotals.lockWaitNs, cookNs * cookTotals.workers));
+    fmt::print(FMT_STRING("{:>10} {:>9.2f}s  waiting on Blender, {:.1f}% of asset cook time\n"), "ipc",
+               seconds(blenderNs), percent(blenderNs, assetNs));
+    fmt::print(FMT_STRING("{:>10} {:>9.3f}s  mean wait over {} transactions, p50 {:.1f}ms p95 {:.1f}ms, "
+                          "peak depth {}\n"),
+               "queue", cookTotals.transactionsRun ? seconds(cookTotals.queueWaitNs) / cookTotals.transactionsRun : 0.0,
+               cookTotals.transactionsRun, cookTotals.queueLatencyQuantileUs(0.5) / 1000.0,
+               cookTotals.queueLatencyQuantileUs(0.95) / 1000.0, cookTotals.peakPending);
+    fmt::print(FMT_STRING("{:>10} {:>8}MiB  hecl peak, {} MiB largest Blender\n"), "memory",
+               hecl::Database::CookTimings::ProcessPeakRssKb() / 1024, blenderPeakKb / 1024);
+    return packaged ? 0 : 1;
+  }
 
 public:
   explicit ToolCook(const ToolPassInfo& info) : ToolBase(info), m_useProj(info.project) {
@@ -29,6 +325,55 @@ public:
         else if (arg == _SYS_STR("--fast")) {
           m_fast = true;
           continue;
+        } else if (arg == _SYS_STR("--progressive")) {
+          m_progressive = true;
+          continue;
+        } else if (arg == _SYS_STR("--watch")) {
+          m_watch = true;
+          continue;
+        } else if (arg == _SYS_STR("--report")) {
+          m_report = true;
+          continue;
+        } else if (arg == _SYS_STR("--gc")) {
+          m_gcBudgetMb = 0;
+          continue;
+        } else if (arg.size() > 5 && !arg.compare(0, 5, _SYS_STR("--gc="))) {
+          m_gcBudgetMb = hecl::StrToUl(arg.c_str() + 5, nullptr, 0);
+          continue;
+        } else if (arg == _SYS_STR("--agent")) {
+          m_agent = true;
+          continue;
+        } else if (arg == _SYS_STR("--store")) {
+          m_store = true;
+          continue;
+        } else if (arg == _SYS_STR("--no-store")) {
+          m_store = false;
+          continue;
+        } else if (arg == _SYS_STR("--bench")) {
+          m_bench = true;
+          continue;
+        } else if (arg.size() > 12 && !arg.compare(0, 12, _SYS_STR("--bench-dir="))) {
+          m_benchDir = MakePathArgAbsolute(arg.substr(12), info.cwd);
+          continue;
+        } else if (arg.size() > 8 && !arg.compare(0, 8, _SYS_STR("--bench="))) {
+          m_bench = true;
+          uint32_t* const counts[] = {&m_benchDesc.textureCount, &m_benchDesc.yamlCount, &m_benchDesc.meshCount,
+                                      &m_benchDesc.meshSubdivisions};
+          const hecl::SystemChar* str = arg.c_str() + 8;
+          for (uint32_t* count : counts) {
+            hecl::SystemChar* end;
+            *count = uint32_t(hecl::StrToUl(str, &end, 0));
+            if (*end != _SYS_STR(','))
+              break;
+            str = end + 1;
+          }
+          continue;
+        } else if (arg.size() > 9 && !arg.compare(0, 9, _SYS_STR("--memory="))) {
+          m_memoryBudgetMb = hecl::StrToUl(arg.c_str() + 9, nullptr, 0);
+          continue;
+        } else if (arg.size() > 8 && !arg.compare(0, 8, _SYS_STR("--trace="))) {
+          m_tracePath = MakePathArgAbsolute(arg.substr(8), info.cwd);
+          continue;
         } else if (arg.size() >= 8 && !arg.compare(0, 7, _SYS_STR("--spec="))) {
           hecl::SystemString specName(arg.begin() + 7, arg.end());
           for (const hecl::Database::DataSpecEntry* spec : hecl::Database::DATA_SPEC_REGISTRY) {
@@ -59,6 +404,12 @@ public:
         }
       }
     }
+    /* Benchmarks create their own project once running */
+    if (m_bench) {
+      if (m_benchDir.empty())
+        m_benchDir = info.cwd + _SYS_STR("/hecl-bench");
+      return;
+    }
     if (!m_useProj)
       LogModule.report(logvisor::Fatal,
                        FMT_STRING("hecl cook must be ran within a project directory or "
@@ -80,7 +431,9 @@ public:
 
     help.secHead(_SYS_STR("SYNOPSIS"));
     help.beginWrap();
-    help.wrap(_SYS_STR("hecl cook [-rf] [--fast] [--spec=<spec>] [<pathspec>...]\n"));
+    help.wrap(_SYS_STR("hecl cook [-rf] [--fast] [--progressive] [--watch] [--agent] [--memory=<MiB>] [--[no-]store] [--trace=<file>] [--report] [--spec=<spec>] [<pathspec>...]\n"));
+    help.wrap(_SYS_STR("hecl cook --gc[=<MiB>]\n"));
+    help.wrap(_SYS_STR("hecl cook --bench[=<pngs>,<yamls>,<blends>[,<subdivisions>]] [--bench-dir=<dir>] [--fast] [--memory=<MiB>] [--trace=<file>] [--spec=<spec>]\n"));
     help.endWrap();
 
     help.secHead(_SYS_STR("DESCRIPTION"));
@@ -132,6 +485,82 @@ public:
     help.wrap(_SYS_STR("Performs draft-optimization cooking for supported data types.\n"));
     help.endWrap();
 
+    help.optionHead(_SYS_STR("--progressive"), _SYS_STR("draft first, optimized later"));
+    help.beginWrap();
+    help.wrap(_SYS_STR("Cooks drafts as with "));
+    help.wrapBold(_SYS_STR("--fast"));
+    help.wrap(_SYS_STR(" and places each at the regular cooked path as soon as it is done. Fully optimized ")
+                  _SYS_STR("cooks are then queued behind all other work and replace the drafts one by one as ")
+                      _SYS_STR("they finish; the command returns once every draft has been replaced.\n"));
+    help.endWrap();
+
+    help.optionHead(_SYS_STR("--watch"), _SYS_STR("continuous cook"));
+    help.beginWrap();
+    help.wrap(_SYS_STR("After the initial pass, keeps running and recooks working files as they are saved, ")
+                  _SYS_STR("along with any objects depending on them. Cook workers and Blender connections ")
+                      _SYS_STR("stay open between saves.\n"));
+    help.endWrap();
+
+    help.optionHead(_SYS_STR("--agent"), _SYS_STR("cook agent mode"));
+    help.beginWrap();
+    help.wrap(_SYS_STR("Cooks on behalf of another machine: every requested artifact is published to the ")
+                  _SYS_STR("shared cook store, even when already up to date, and no further agents are used. ")
+                      _SYS_STR("Without this flag, cooks of .blend files and other expensive inputs are spread ")
+                          _SYS_STR("over the command prefixes listed in HECL_COOK_AGENTS, which requires ")
+                              _SYS_STR("HECL_COOK_STORE on both ends.\n"));
+    help.endWrap();
+
+    help.optionHead(_SYS_STR("--memory=<MiB>"), _SYS_STR("memory budget"));
+    help.beginWrap();
+    help.wrap(_SYS_STR("Limits the combined memory of the Blender instances cooking at once. Cooks are ")
+                  _SYS_STR("charged the peak recorded in .hecl/cooktimes, or an estimate if never cooked, and ")
+                      _SYS_STR("wait while lighter work keeps the remaining workers busy. Defaults to ")
+                          _SYS_STR("HECL_COOK_MEMORY_MB, else three quarters of physical memory; 0 disables the limit.\n"));
+    help.endWrap();
+
+    help.optionHead(_SYS_STR("--store, --no-store"), _SYS_STR("single-file cooked store"));
+    help.beginWrap();
+    help.wrap(_SYS_STR("Switches the project between cooked artifacts as individual files under .hecl/cooked ")
+                  _SYS_STR("and a single pack at .hecl/cookedstore, which avoids per-file overhead on projects ")
+                      _SYS_STR("with many small artifacts. The choice persists; switching back writes every ")
+                          _SYS_STR("packed artifact out to its own file again.\n"));
+    help.endWrap();
+
+    help.optionHead(_SYS_STR("--trace=<file>"), _SYS_STR("timing trace"));
+    help.beginWrap();
+    help.wrap(_SYS_STR("Records where cook time goes (queue waits, idle workers, Blender calls, mesh ")
+                  _SYS_STR("processing) and writes it to <file> as a Chrome trace, viewable in ")
+                      _SYS_STR("chrome://tracing or ui.perfetto.dev.\n"));
+    help.endWrap();
+
+    help.optionHead(_SYS_STR("--report"), _SYS_STR("cook time report"));
+    help.beginWrap();
+    help.wrap(_SYS_STR("Lists the slowest assets of the most recent cook, assets that got slower since the run ")
+                  _SYS_STR("before, and total cook time per DataSpec and file type, then exits without cooking. ")
+                      _SYS_STR("Times are recorded for every cook in .hecl/cooktimes.\n"));
+    help.endWrap();
+
+    help.optionHead(_SYS_STR("--gc[=<MiB>]"), _SYS_STR("cook cache cleanup"));
+    help.beginWrap();
+    help.wrap(_SYS_STR("Shrinks the copies of cooked artifacts kept in .hecl/cookcache/objects to at most <MiB>, ")
+                  _SYS_STR("then exits without cooking. Copies of the current artifacts are always kept; copies ")
+                      _SYS_STR("that only older revisions of working files would restore go least recently used ")
+                          _SYS_STR("first. Without a size, every copy not current is removed.\n"));
+    help.endWrap();
+
+    help.optionHead(_SYS_STR("--bench[=<pngs>,<yamls>,<blends>[,<subdivisions>]]"), _SYS_STR("end-to-end benchmark"));
+    help.beginWrap();
+    help.wrap(_SYS_STR("Generates a synthetic project of PNG textures, YAML documents and icosphere .blend meshes ")
+                  _SYS_STR("(256, 256 and 32 by default, meshes at subdivision level 5), then cooks and packages it ")
+                      _SYS_STR("without extracting anything. Reports assets cooked per second, worker utilization, ")
+                          _SYS_STR("time spent waiting on Blender, mean queue wait and peak memory. Each run needs ")
+                              _SYS_STR("a directory holding no project, "));
+    help.wrapBold(_SYS_STR("hecl-bench"));
+    help.wrap(_SYS_STR(" in the current directory unless "));
+    help.wrapBold(_SYS_STR("--bench-dir=<dir>"));
+    help.wrap(_SYS_STR(" is given.\n"));
+    help.endWrap();
+
     help.optionHead(_SYS_STR("--spec=<spec>"), _SYS_STR("data specification"));
     help.beginWrap();
     help.wrap(_SYS_STR("Specifies a DataSpec to use when cooking. ")
@@ -148,13 +577,61 @@ public:
   hecl::SystemStringView toolName() const override { return _SYS_STR("cook"sv); }
 
   int run() override {
+    if (m_report) {
+      report();
+      return 0;
+    }
+    if (m_gcBudgetMb) {
+      const hecl::Database::CookCache::GarbageStats stats =
+          m_useProj->getCookCache().collectGarbage(*m_gcBudgetMb * 1024 * 1024);
+      fmt::print(FMT_STRING("Removed {} cached artifacts ({} MiB); kept {} ({} MiB)\n"), stats.m_removed,
+                 stats.m_removedBytes / (1024 * 1024), stats.m_kept, stats.m_keptBytes / (1024 * 1024));
+      return 0;
+    }
+    if (!m_tracePath.empty() && hecl::trace::Start(m_tracePath))
+      hecl::trace::SetThreadName("HECL Main");
+    const int ret = m_bench ? bench() : cook();
+    hecl::trace::Stop();
+    return ret;
+  }
+
+  int cook() {
     hecl::MultiProgressPrinter printer(true);
     hecl::ClientProcess cp(&printer);
+    hecl::Database::CookCache& cache = m_useProj->getCookCache();
+    if (m_store)
+      m_useProj->getCookedStore().setEnabled(*m_store);
+    if (m_agent) {
+      cache.setPublishHits(true);
+    } else if (auto agents = hecl::DefaultRemoteCookAgents(); !agents.empty()) {
+      if (cache.hasRemoteStore()) {
+        for (auto& agent : agents)
+          cp.addRemoteAgent(std::move(agent));
+      } else {
+        LogModule.report(logvisor::Warning,
+                         FMT_STRING("HECL_COOK_AGENTS is set without HECL_COOK_STORE; cooking locally"));
+      }
+    }
+    /* Working files are left alone while cooking, so their metadata only needs fetching once */
+    m_useProj->getStatCache().setEnabled(true);
+    cp.setProgressive(m_progressive);
+    if (m_memoryBudgetMb)
+      cp.setMemoryBudget(*m_memoryBudgetMb * 1024);
     for (const hecl::ProjectPath& path : m_selectedItems)
-      m_useProj->cookPath(path, printer, m_recursive, m_info.force, m_fast, m_spec, &cp);
+      m_useProj->cookPath(path, printer, m_recursive, m_info.force, m_fast || m_progressive, m_spec, &cp);
     cp.waitUntilComplete();
+    m_useProj->saveBridgePathCache();
+    if (m_watch)
+      watch(printer, cp);
+    m_useProj->getStatCache().setEnabled(false);
     return 0;
   }
 
-  void cancel() override { m_useProj->interruptCook(); }
+  void cancel() override {
+    /* A benchmark has no project until generation begins */
+    if (m_useProj)
+      m_useProj->interruptCook();
+    if (m_watcher)
+      m_watcher->stop();
+  }
 };
@@ -9,6 +9,8 @@
 #include <termios.h>
 #endif
 
+#include "hecl/ClientProcess.hpp"
+#include "hecl/ExtractContext.hpp"
 #include "hecl/MultiProgressPrinter.hpp"
 
 class ToolExtract final : public ToolBase {
@@ -156,7 +158,14 @@ public:
         else
           fmt::print(FMT_STRING(_SYS_STR("Using DataSpec {}:\n")), ds.m_entry->m_name);
 
-        ds.m_instance->doExtract(m_einfo, {true});
+        {
+          hecl::MultiProgressPrinter printer(true);
+          hecl::ClientProcess cp(&printer);
+          hecl::Database::ExtractContext ctx(cp, *ds.m_instance, printer);
+          ds.m_instance->doParallelExtract(m_einfo, ctx);
+          ctx.waitUntilComplete();
+        }
+        m_useProj->saveBridgePathCache();
         fmt::print(FMT_STRING(_SYS_STR("\n\n")));
       }
     }
@@ -71,6 +71,56 @@ public:
     help.endWrap();
   }
 
+  /** Lay out the project's out directory as a disc image; shared with `hecl package --image` */
+  static int BuildImage(hecl::Database::Project& proj) {
+    hecl::ProjectPath outPath(proj.getProjectWorkingPath(), _SYS_STR("out"));
+    if (!outPath.isDirectory()) {
+      LogModule.report(logvisor::Error, FMT_STRING(_SYS_STR("{} is not a directory")), outPath.getAbsolutePath());
+      return 1;
+    }
+
+    hecl::ProjectPath bootBinPath(outPath, _SYS_STR("sys/boot.bin"));
+    if (!bootBinPath.isFile()) {
+      LogModule.report(logvisor::Error, FMT_STRING(_SYS_STR("{} is not a file")), bootBinPath.getAbsolutePath());
+      return 1;
+    }
+
+    athena::io::FileReader r(bootBinPath.getAbsolutePath());
+    if (r.hasError()) {
+      LogModule.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to open {}")), bootBinPath.getAbsolutePath());
+      return 1;
+    }
+    std::string id = r.readString(6);
+    r.close();
+
+    hecl::SystemStringConv idView(id);
+    hecl::SystemString fileOut = hecl::SystemString(outPath.getAbsolutePath()) + _SYS_STR('/') + idView.c_str();
+    hecl::MultiProgressPrinter printer(true);
+    auto progFunc = [&printer](float totalProg, nod::SystemStringView fileName, size_t fileBytesXfered) {
+      printer.print(fileName.data(), nullptr, totalProg);
+    };
+    if (id[0] == 'G') {
+      fileOut += _SYS_STR(".gcm");
+      if (nod::DiscBuilderGCN::CalculateTotalSizeRequired(outPath.getAbsolutePath()) == UINT64_MAX)
+        return 1;
+      LogModule.report(logvisor::Info, FMT_STRING(_SYS_STR("Generating {} as GameCube image")), fileOut);
+      nod::DiscBuilderGCN db(fileOut, progFunc);
+      if (db.buildFromDirectory(outPath.getAbsolutePath()) != nod::EBuildResult::Success)
+        return 1;
+    } else {
+      fileOut += _SYS_STR(".iso");
+      bool dualLayer;
+      if (nod::DiscBuilderWii::CalculateTotalSizeRequired(outPath.getAbsolutePath(), dualLayer) == UINT64_MAX)
+        return 1;
+      LogModule.report(logvisor::Info, FMT_STRING(_SYS_STR("Generating {} as {}-layer Wii image")), fileOut,
+                       dualLayer ? _SYS_STR("dual") : _SYS_STR("single"));
+      nod::DiscBuilderWii db(fileOut, dualLayer, progFunc);
+      if (db.buildFromDirectory(outPath.getAbsolutePath()) != nod::EBuildResult::Success)
+        return 1;
+    }
+    return 0;
+  }
+
   hecl::SystemStringView toolName() const override { return _SYS_STR("image"sv); }
 
   int run() override {
@@ -82,53 +132,8 @@ public:
     fmt::print(FMT_STRING(_SYS_STR("  {}\n")), m_useProj->getProjectRootPath().getAbsolutePath());
     fflush(stdout);
 
-    if (continuePrompt()) {
-      hecl::ProjectPath outPath(m_useProj->getProjectWorkingPath(), _SYS_STR("out"));
-      if (!outPath.isDirectory()) {
-        LogModule.report(logvisor::Error, FMT_STRING(_SYS_STR("{} is not a directory")), outPath.getAbsolutePath());
-        return 1;
-      }
-
-      hecl::ProjectPath bootBinPath(outPath, _SYS_STR("sys/boot.bin"));
-      if (!bootBinPath.isFile()) {
-        LogModule.report(logvisor::Error, FMT_STRING(_SYS_STR("{} is not a file")), bootBinPath.getAbsolutePath());
-        return 1;
-      }
-
-      athena::io::FileReader r(bootBinPath.getAbsolutePath());
-      if (r.hasError()) {
-        LogModule.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to open {}")), bootBinPath.getAbsolutePath());
-        return 1;
-      }
-      std::string id = r.readString(6);
-      r.close();
-
-      hecl::SystemStringConv idView(id);
-      hecl::SystemString fileOut = hecl::SystemString(outPath.getAbsolutePath()) + _SYS_STR('/') + idView.c_str();
-      hecl::MultiProgressPrinter printer(true);
-      auto progFunc = [&printer](float totalProg, nod::SystemStringView fileName, size_t fileBytesXfered) {
-        printer.print(fileName.data(), nullptr, totalProg);
-      };
-      if (id[0] == 'G') {
-        fileOut += _SYS_STR(".gcm");
-        if (nod::DiscBuilderGCN::CalculateTotalSizeRequired(outPath.getAbsolutePath()) == UINT64_MAX)
-          return 1;
-        LogModule.report(logvisor::Info, FMT_STRING(_SYS_STR("Generating {} as GameCube image")), fileOut);
-        nod::DiscBuilderGCN db(fileOut, progFunc);
-        if (db.buildFromDirectory(outPath.getAbsolutePath()) != nod::EBuildResult::Success)
-          return 1;
-      } else {
-        fileOut += _SYS_STR(".iso");
-        bool dualLayer;
-        if (nod::DiscBuilderWii::CalculateTotalSizeRequired(outPath.getAbsolutePath(), dualLayer) == UINT64_MAX)
-          return 1;
-        LogModule.report(logvisor::Info, FMT_STRING(_SYS_STR("Generating {} as {}-layer Wii image")), fileOut,
-                         dualLayer ? _SYS_STR("dual") : _SYS_STR("single"));
-        nod::DiscBuilderWii db(fileOut, dualLayer, progFunc);
-        if (db.buildFromDirectory(outPath.getAbsolutePath()) != nod::EBuildResult::Success)
-          return 1;
-      }
-    }
+    if (continuePrompt())
+      return BuildImage(*m_useProj);
 
     return 0;
   }
@@ -1,16 +1,24 @@
 #pragma once
 
+#include <algorithm>
 #include <vector>
 #include <string>
 #include "ToolBase.hpp"
+#include "ToolImage.hpp"
 #include <cstdio>
 
 class ToolPackage final : public ToolBase {
+  /* Each concurrent package holds a Blender instance of its own */
+  static constexpr size_t DefaultParallelPackages = 4;
+
   std::vector<hecl::ProjectPath> m_selectedItems;
   std::unique_ptr<hecl::Database::Project> m_fallbackProj;
   hecl::Database::Project* m_useProj;
   const hecl::Database::DataSpecEntry* m_spec = nullptr;
   bool m_fast = false;
+  bool m_image = false;
+  size_t m_parallel = 1;
+  hecl::SystemString m_accessOrderPath;
 
   void AddSelectedItem(const hecl::ProjectPath& path) {
     for (const hecl::ProjectPath& item : m_selectedItems)
@@ -68,6 +76,18 @@ public:
         else if (arg == _SYS_STR("--fast")) {
           m_fast = true;
           continue;
+        } else if (arg == _SYS_STR("--image")) {
+          m_image = true;
+          continue;
+        } else if (arg == _SYS_STR("--parallel")) {
+          m_parallel = DefaultParallelPackages;
+          continue;
+        } else if (arg.size() > 11 && !arg.compare(0, 11, _SYS_STR("--parallel="))) {
+          m_parallel = std::max(size_t(1), size_t(hecl::StrToUl(arg.c_str() + 11, nullptr, 0)));
+          continue;
+        } else if (arg.size() > 15 && !arg.compare(0, 15, _SYS_STR("--access-order="))) {
+          m_accessOrderPath = MakePathArgAbsolute(arg.substr(15), info.cwd);
+          continue;
         } else if (arg.size() >= 8 && !arg.compare(0, 7, _SYS_STR("--spec="))) {
           hecl::SystemString specName(arg.begin() + 7, arg.end());
           for (const hecl::Database::DataSpecEntry* spec : hecl::Database::DATA_SPEC_REGISTRY) {
@@ -118,7 +138,7 @@ public:
 
     help.secHead(_SYS_STR("SYNOPSIS"));
     help.beginWrap();
-    help.wrap(_SYS_STR("hecl package [--spec=<spec>] [<input-dir>]\n"));
+    help.wrap(_SYS_STR("hecl package [--spec=<spec>] [--parallel[=<count>]] [--access-order=<trace>] [--image] [<input-dir>]\n"));
     help.endWrap();
 
     help.secHead(_SYS_STR("DESCRIPTION"));
@@ -143,6 +163,26 @@ public:
     help.endWrap();
 
     help.secHead(_SYS_STR("OPTIONS"));
+    help.optionHead(_SYS_STR("--parallel[=<count>]"), _SYS_STR("concurrent packages"));
+    help.beginWrap();
+    help.wrap(_SYS_STR("Builds up to <count> packages at once (default 4), each with its own Blender ")
+                  _SYS_STR("connection. Dependencies still cook on the shared worker pool sized by -j.\n"));
+    help.endWrap();
+
+    help.optionHead(_SYS_STR("--access-order=<trace>"), _SYS_STR("captured load order"));
+    help.beginWrap();
+    help.wrap(_SYS_STR("Lays out the resources within each package in the order a captured run first ")
+                  _SYS_STR("requested them, so loads from optical media or slow storage read mostly sequentially. ")
+                      _SYS_STR("Capture <trace> by running the game with HECL_ACCESS_TRACE=<trace> set. Resources ")
+                          _SYS_STR("never requested follow in their usual order.\n"));
+    help.endWrap();
+
+    help.optionHead(_SYS_STR("--image"), _SYS_STR("build disc image"));
+    help.beginWrap();
+    help.wrap(_SYS_STR("Once every package is written, generates the disc image from `out` as ")
+                  _SYS_STR("`hecl image` would, without a separate invocation or prompt.\n"));
+    help.endWrap();
+
     help.optionHead(_SYS_STR("<input-dir>"), _SYS_STR("input directory"));
     help.beginWrap();
     help.wrap(_SYS_STR("Specifies a project subdirectory to root the resulting package from. ")
@@ -164,13 +204,27 @@ public:
     fflush(stdout);
 
     if (continuePrompt()) {
+      if (!m_accessOrderPath.empty() && !m_useProj->getPackageAccessOrder().load(m_accessOrderPath))
+        return 1;
       hecl::MultiProgressPrinter printer(true);
       hecl::ClientProcess cp(&printer);
-      for (const hecl::ProjectPath& path : m_selectedItems) {
-        if (!m_useProj->packagePath(path, printer, m_fast, m_spec, &cp))
-          LogModule.report(logvisor::Error, FMT_STRING(_SYS_STR("Unable to package {}")), path.getAbsolutePath());
+      if (m_parallel > 1) {
+        m_useProj->packagePaths(m_selectedItems, printer, m_fast, m_spec, &cp, m_parallel);
+      } else {
+        for (const hecl::ProjectPath& path : m_selectedItems) {
+          if (!m_useProj->packagePath(path, printer, m_fast, m_spec, &cp))
+            LogModule.report(logvisor::Error, FMT_STRING(_SYS_STR("Unable to package {}")), path.getAbsolutePath());
+        }
       }
       cp.waitUntilComplete();
+      if (m_image) {
+#if HECL_HAS_NOD
+        return ToolImage::BuildImage(*m_useProj);
+#else
+        LogModule.report(logvisor::Error, FMT_STRING("this build of hecl is unable to generate disc images"));
+        return 1;
+#endif
+      }
     }
 
     return 0;
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <unordered_set>
+#include "ToolBase.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include "hecl/Pipeline.hpp"
+
+class ToolShaderCache final : public ToolBase {
+  hecl::SystemString m_cachePath;
+  std::vector<hecl::SystemString> m_statsPaths;
+  /* Stage hashes requested in the recorded sessions, indexed by boo::PipelineStage */
+  std::unordered_set<uint64_t> m_used[6];
+
+  /* Collect stages with any lookups from a pipelineStats dump; the pipeline rows key no binary */
+  bool loadStats(const hecl::SystemString& path) {
+    static constexpr const char* StageNames[] = {"null", "vertex", "fragment", "geometry", "control", "evaluation"};
+    auto fp = hecl::FopenUnique(path.c_str(), _SYS_STR("r"));
+    if (!fp)
+      return false;
+    char line[256];
+    if (!std::fgets(line, sizeof(line), fp.get()) || std::strncmp(line, "cache,hash,hits,misses", 22) != 0)
+      return false;
+    while (std::fgets(line, sizeof(line), fp.get())) {
+      char* hashStr = std::strchr(line, ',');
+      if (!hashStr)
+        continue;
+      *hashStr++ = '\0';
+      char* end;
+      const uint64_t hash = std::strtoull(hashStr, &end, 16);
+      if (*end != ',')
+        continue;
+      const uint64_t hits = std::strtoull(end + 1, &end, 10);
+      if (*end != ',')
+        continue;
+      const uint64_t misses = std::strtoull(end + 1, &end, 10);
+      if (!hits && !misses)
+        continue;
+      for (size_t stage = 1; stage < std::size(StageNames); ++stage)
+        if (!std::strcmp(line, StageNames[stage]))
+          m_used[stage].insert(hash);
+    }
+    return true;
+  }
+
+public:
+  explicit ToolShaderCache(const ToolPassInfo& info) : ToolBase(info) {
+    for (const hecl::SystemString& arg : info.args) {
+      if (arg.empty())
+        continue;
+      if (m_cachePath.empty())
+        m_cachePath = MakePathArgAbsolute(arg, info.cwd);
+      else
+        m_statsPaths.push_back(MakePathArgAbsolute(arg, info.cwd));
+    }
+    if (m_statsPaths.empty())
+      LogModule.report(logvisor::Fatal, FMT_STRING("hecl shadercache requires a cache file and at least one "
+                                                   "pipelineStats dump"));
+  }
+
+  ~ToolShaderCache() override = default;
+
+  static void Help(HelpOutput& help) {
+    help.secHead(_SYS_STR("NAME"));
+    help.beginWrap();
+    help.wrap(_SYS_STR("hecl-shadercache - Prune a shader cache file to the stages a game actually used\n"));
+    help.endWrap();
+
+    help.secHead(_SYS_STR("SYNOPSIS"));
+    help.beginWrap();
+    help.wrap(_SYS_STR("hecl shadercache <cache-file> <stats-csv>...\n"));
+    help.endWrap();
+
+    help.secHead(_SYS_STR("DESCRIPTION"));
+    help.beginWrap();
+    help.wrap(_SYS_STR("This command rewrites a ShaderCacheFile so it holds only the stage binaries requested ")
+                  _SYS_STR("in one or more recorded sessions. Each session is a CSV written by the ")
+                  _SYS_STR("`pipelineStats dump` console command. Shader permutations that differ only in ")
+                  _SYS_STR("pipeline state share their stage binaries, so each binary is kept once. A cache ")
+                  _SYS_STR("pruned this way and shipped alongside the game precompiles exactly the permutations ")
+                  _SYS_STR("its assets use.\n"));
+    help.endWrap();
+
+    help.secHead(_SYS_STR("OPTIONS"));
+    help.optionHead(_SYS_STR("<cache-file>"), _SYS_STR("shader cache"));
+    help.beginWrap();
+    help.wrap(_SYS_STR("ShaderCacheFile to prune in place.\n"));
+    help.endWrap();
+
+    help.optionHead(_SYS_STR("<stats-csv>..."), _SYS_STR("recorded sessions"));
+    help.beginWrap();
+    help.wrap(_SYS_STR("pipelineStats dumps; a stage is kept if any of them looked it up. Sessions that preload ")
+                  _SYS_STR("stages through loadFromFile should be recorded with `pipelineStats detail on`, ")
+                  _SYS_STR("since hits of preloaded stages are otherwise not counted per stage.\n"));
+    help.endWrap();
+  }
+
+  hecl::SystemStringView toolName() const override { return _SYS_STR("shadercache"sv); }
+
+  int run() override {
+    for (const hecl::SystemString& path : m_statsPaths) {
+      if (!loadStats(path)) {
+        LogModule.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to read pipelineStats dump '{}'")), path);
+        return 1;
+      }
+    }
+
+    /* open() would start a fresh cache in place of a missing one */
+    hecl::Sstat st;
+    hecl::ShaderCacheFile cache;
+    if (hecl::Stat(m_cachePath.c_str(), &st) || !S_ISREG(st.st_mode) || !cache.open(m_cachePath.c_str())) {
+      LogModule.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to open shader cache '{}'")), m_cachePath);
+      return 1;
+    }
+    size_t removed;
+    if (!cache.prune([this](boo::PipelineStage stage, uint64_t hash) { return m_used[int(stage)].count(hash) != 0; },
+                     removed)) {
+      LogModule.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to rewrite shader cache '{}'")), m_cachePath);
+      return 1;
+    }
+    fmt::print(FMT_STRING(_SYS_STR("Removed {} unused stage binaries\n")), removed);
+    return 0;
+  }
+};
@@ -16,6 +16,7 @@
 #include <list>
 #include "hecl/Database.hpp"
 #include "hecl/Blender/Connection.hpp"
+#include "hecl/CpuTopology.hpp"
 #include "hecl/Runtime.hpp"
 #include "logvisor/logvisor.hpp"
 #include "../version.h"
@@ -30,6 +31,7 @@ logvisor::Module LogModule("hecl::Driver");
 #include "ToolPackage.hpp"
 #include "ToolImage.hpp"
 #include "ToolInstallAddon.hpp"
+#include "ToolShaderCache.hpp"
 #include "ToolHelp.hpp"
 
 /* Static reference to dataspec additions
@@ -169,6 +171,21 @@ static ToolPassInfo CreateInfo(int argc, const char** argv) {
         it = args.erase(it);
         continue;
       }
+      /* Pins cook workers and their blender instances to NUMA nodes or single processors */
+      if (arg == _SYS_STR("--affinity=node") || arg == _SYS_STR("--affinity=core")) {
+        if (arg == _SYS_STR("--affinity=node"))
+          hecl::WorkerAffinityMode = hecl::WorkerAffinity::Node;
+        else
+          hecl::WorkerAffinityMode = hecl::WorkerAffinity::Core;
+        it = args.erase(it);
+        continue;
+      }
+      /* Sizes the buffer read pool independently of -j */
+      if (arg.size() > 13 && !arg.compare(0, 13, _SYS_STR("--io-threads="))) {
+        hecl::IoThreadCountOverride = int(hecl::StrToUl(arg.c_str() + 13, nullptr, 0));
+        it = args.erase(it);
+        continue;
+      }
       if (arg.size() < 2 || arg[0] != _SYS_STR('-') || arg[1] == _SYS_STR('-')) {
         ++it;
         continue;
@@ -258,6 +275,10 @@ static std::unique_ptr<ToolBase> MakeSelectedTool(hecl::SystemString toolName, T
     return std::make_unique<ToolInstallAddon>(info);
   }
 
+  if (toolNameLower == _SYS_STR("shadercache")) {
+    return std::make_unique<ToolShaderCache>(info);
+  }
+
   if (toolNameLower == _SYS_STR("help")) {
     return std::make_unique<ToolHelp>(info);
   }
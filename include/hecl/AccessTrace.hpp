@@ -0,0 +1,82 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "hecl/SystemChar.hpp"
+
+namespace hecl {
+class ProjectPath;
+
+namespace access {
+
+/**
+ * @brief Process-wide capture of runtime buffer requests
+ *
+ * While a capture is active, every ClientProcess buffer read logs the
+ * requested file, offset and length with a timestamp. Stop() writes the log
+ * as tab-separated text, one request per line in request order, for
+ * AccessOrder to consume at package time. Inactive captures cost a single
+ * relaxed load per read.
+ */
+extern std::atomic_bool Active;
+
+/** Begin capturing into path; false if already active or the file can't be created */
+bool Start(SystemStringView path);
+
+/** Finish the active capture and write its requests */
+void Stop();
+
+/** Log a request for len bytes of path at offset */
+void Record(const ProjectPath& path, uint64_t offset, uint64_t len);
+
+} // namespace access
+
+/**
+ * @brief Order in which a captured run first requested each resource
+ *
+ * Loaded from a capture written by access::Stop(). Packagers sort the
+ * resources of a package by rank() so a level load reads its package mostly
+ * front to back; resources never requested rank after all requested ones
+ * and keep their relative order.
+ */
+class AccessOrder {
+  struct Range {
+    uint64_t m_offset;
+    uint64_t m_end;
+    size_t m_rank;
+  };
+  /* Keyed on a hash of the project-relative path */
+  std::unordered_map<uint64_t, size_t> m_fileRanks;
+  std::unordered_map<uint64_t, std::vector<Range>> m_ranges;
+  size_t m_count = 0;
+
+public:
+  static constexpr size_t Unseen = SIZE_MAX;
+
+  /** Replace the order with the capture at path; false if it can't be read */
+  bool load(SystemStringView path);
+  void clear();
+  bool empty() const { return m_count == 0; }
+
+  /** Index of the first request of any part of path */
+  size_t rank(const ProjectPath& path) const;
+  /** Index of the first request covering offset of path, e.g. a resource within a previously built package */
+  size_t rank(const ProjectPath& path, uint64_t offset) const;
+
+  /** Stable-sort items by rank(pathOf(item)) */
+  template <typename T, typename PathOf>
+  void sort(std::vector<T>& items, PathOf pathOf) const {
+    if (empty())
+      return;
+    std::stable_sort(items.begin(), items.end(),
+                     [&](const T& a, const T& b) { return rank(pathOf(a)) < rank(pathOf(b)); });
+  }
+};
+
+} // namespace hecl
@@ -173,30 +173,83 @@ public:
     return -1;
   }
 
-  /// find_first_contiguous - Returns the index of the first contiguous
-  /// set of bits of "Length", -1 if no contiguous bits found.
-  int find_first_contiguous(unsigned Length, unsigned BucketSz) const {
-    for (int idx = find_first(); idx != -1; idx = find_next(idx)) {
-      if (idx + Length > size())
-        return -1;
-      bool good = true;
-      for (unsigned i = 0; i < Length; ++i) {
-        int ThisIdx = idx + i;
-        if (!test(ThisIdx)) {
-          good = false;
-          idx = ThisIdx;
-          break;
+  /// find_first_unset - Returns the index of the first unset bit, -1 if all
+  /// of the bits are set.
+  int find_first_unset() const {
+    unsigned Idx = find_from(0, Size, false);
+    return Idx < Size ? int(Idx) : -1;
+  }
+
+  /// find_next_unset - Returns the index of the next unset bit following the
+  /// "Prev" bit. Returns -1 if all remaining bits are set.
+  int find_next_unset(unsigned Prev) const {
+    unsigned Idx = find_from(Prev + 1, Size, false);
+    return Idx < Size ? int(Idx) : -1;
+  }
+
+  /// find_first_run - Returns the index of the first run of at least "Length"
+  /// set bits, -1 if there is none. With a nonzero "BucketSz", runs may not
+  /// straddle a multiple of BucketSz.
+  int find_first_run(unsigned Length, unsigned BucketSz = 0) const {
+    assert(Length && (!BucketSz || Length <= BucketSz) && "Run cannot fit in a bucket");
+    if (!BucketSz)
+      return find_run_in(0, Size, Length);
+    for (unsigned B = 0; B < Size; B += BucketSz)
+      if (int Idx = find_run_in(B, std::min(B + BucketSz, Size), Length); Idx != -1)
+        return Idx;
+    return -1;
+  }
+
+  /// find_run_in - Returns the index of the first run of "Length" set bits
+  /// lying entirely within [From, Limit), -1 if there is none.
+  ///
+  /// Works a word at a time: runs entering a word from below are extended by
+  /// its trailing ones, and runs wholly inside it are found by and-ing the
+  /// word with shifted copies of itself, doubling the covered length each step.
+  int find_run_in(unsigned From, unsigned Limit, unsigned Length) const {
+    assert(Length && "Empty run requested");
+    if (From >= Limit || Limit - From < Length)
+      return -1;
+    unsigned FirstWord = From / BITWORD_SIZE;
+    unsigned LastWord = (Limit - 1) / BITWORD_SIZE;
+    unsigned RunLen = 0; // Set bits ending at the previous word boundary
+    for (unsigned W = FirstWord; W <= LastWord; ++W) {
+      BitWord Word = Bits[W];
+      if (W == FirstWord)
+        Word &= ~0UL << (From % BITWORD_SIZE);
+      if (W == LastWord && Limit % BITWORD_SIZE)
+        Word &= (1UL << (Limit % BITWORD_SIZE)) - 1;
+      unsigned Base = W * BITWORD_SIZE;
+
+      if (RunLen) {
+        unsigned Ones = countTrailingOnes(Word);
+        if (RunLen + Ones >= Length)
+          return int(Base - RunLen);
+        if (Ones == BITWORD_SIZE) {
+          RunLen += BITWORD_SIZE;
+          continue;
         }
       }
-      if (good) {
-        unsigned space = BucketSz - (idx % BucketSz);
-        if (space >= Length)
-          return idx;
+
+      if (Length <= BITWORD_SIZE) {
+        BitWord Starts = Word;
+        for (unsigned Len = 1; Len < Length && Starts;) {
+          unsigned Shift = std::min(Len, Length - Len);
+          Starts &= Starts >> Shift;
+          Len += Shift;
+        }
+        if (Starts)
+          return int(Base + countTrailingZeros(Starts));
       }
+      RunLen = countLeadingOnes(Word);
     }
     return -1;
   }
 
+  /// find_first_contiguous - Returns the index of the first contiguous
+  /// set of bits of "Length", -1 if no contiguous bits found.
+  int find_first_contiguous(unsigned Length, unsigned BucketSz) const { return find_first_run(Length, BucketSz); }
+
   /// clear - Clear all bits.
   void clear() { Size = 0; }
 
@@ -506,6 +559,22 @@ public:
   void clearBitsNotInMask(const uint32_t* Mask, unsigned MaskWords = ~0u) { applyMask<false, true>(Mask, MaskWords); }
 
 private:
+  /// find_from - Returns the index of the first bit in [From, Limit) equal
+  /// to "Value", or Limit if there is none.
+  unsigned find_from(unsigned From, unsigned Limit, bool Value) const {
+    if (From >= Limit)
+      return Limit;
+    unsigned WordPos = From / BITWORD_SIZE;
+    unsigned LastWord = (Limit - 1) / BITWORD_SIZE;
+    BitWord Copy = (Value ? Bits[WordPos] : ~Bits[WordPos]) & (~0UL << (From % BITWORD_SIZE));
+    while (Copy == 0) {
+      if (++WordPos > LastWord)
+        return Limit;
+      Copy = Value ? Bits[WordPos] : ~Bits[WordPos];
+    }
+    return std::min(Limit, unsigned(WordPos * BITWORD_SIZE + countTrailingZeros(Copy)));
+  }
+
   unsigned NumBitWords(unsigned S) const { return (S + BITWORD_SIZE - 1) / BITWORD_SIZE; }
 
   // Set the unused bits in the high words.
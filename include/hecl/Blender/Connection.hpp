@@ -17,11 +17,15 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
+#include <deque>
 #include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <ostream>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <variant>
@@ -65,10 +69,18 @@ class ANIMOutStream {
 
 public:
   using CurveType = ANIMCurveType;
+  struct Key {
+    uint32_t frame;
+    float value;
+  };
+
   ANIMOutStream(Connection* parent);
   ~ANIMOutStream();
   void changeCurve(CurveType type, unsigned crvIdx, unsigned keyCount);
   void write(unsigned frame, float val);
+
+  /** Send an entire curve as one block; blender assigns its keyframes in bulk */
+  void writeCurve(CurveType type, unsigned crvIdx, const Key* keys, size_t keyCount);
 };
 
 class PyOutStream : public std::ostream {
@@ -275,6 +287,11 @@ struct Material {
     Additive = 2
   };
 
+  /** Properties derived from iprops once, so hot loops test bits instead of looking up strings */
+  enum Flags : uint32_t {
+    FlagLightmapped = 1u << 0,
+  };
+
   std::string name;
   uint32_t passIndex;
   ShaderType shaderType;
@@ -282,12 +299,73 @@ struct Material {
   std::unordered_map<std::string, int32_t> iprops;
   BlendMode blendMode = BlendMode::Opaque;
 
+  /** Hash of the fields operator== compares; zero until finalize() */
+  uint64_t contentHash = 0;
+  uint32_t flags = 0;
+
+  Material() = default;
   explicit Material(Connection& conn);
+  /** Compute contentHash and flags; materials filled in-process call this once populated */
+  void finalize();
+  bool lightmapped() const { return flags & FlagLightmapped; }
   bool operator==(const Material& other) const {
+    if (contentHash && other.contentHash && contentHash != other.contentHash)
+      return false;
     return chunks == other.chunks && iprops == other.iprops && blendMode == other.blendMode;
   }
 };
 
+/**
+ * @brief Unique materials of every mesh compiled by this process
+ *
+ * Meshes carry their own copies of each material; interning them by content
+ * gives every distinct material one compact ID, so shader and pipeline
+ * generation can run once per unique material rather than once per surface.
+ * IDs stay valid for the lifetime of the process. Safe to use from several threads.
+ */
+class MaterialTable {
+public:
+  static MaterialTable& Shared();
+
+  /** ID of mat's content, adding it if new; mat must be finalized */
+  uint32_t intern(const Material& mat);
+  /** Materials are never removed, so the reference stays valid */
+  const Material& get(uint32_t id) const;
+  std::size_t size() const;
+
+private:
+  mutable std::mutex m_mutex;
+  std::deque<Material> m_materials;
+  std::unordered_multimap<uint64_t, uint32_t> m_lookup;
+};
+
+/** Output options for Mesh::getHMDLBuffers, selected by each DataSpec */
+struct HMDLOptions {
+  /** Reorder strips for overdraw and post-transform cache reuse; leave off for fast cooks */
+  bool optimizeOrder = false;
+  /** Vertex attribute encodings recorded in HMDLMeta */
+  HMDLAttrFormat posFormat = HMDLAttrFormat::Float32;
+  HMDLAttrFormat normFormat = HMDLAttrFormat::Float32;
+  HMDLAttrFormat uvFormat = HMDLAttrFormat::Float32;
+  HMDLAttrFormat weightFormat = HMDLAttrFormat::Float32;
+  /** Emit the mesh's generated tangents after each normal, encoded per normFormat */
+  bool tangents = false;
+  /** When non-zero, split surfaces into clusters of at most this many unique verts */
+  uint32_t clusterMaxVerts = 0;
+  /** Triangle limit of each cluster when clustering is enabled */
+  uint32_t clusterMaxTris = 124;
+};
+
+/** Simplification settings for Mesh::generateLods */
+struct LodOptions {
+  /** Number of reduced levels generated beyond the full-detail surfaces */
+  uint32_t levelCount = 3;
+  /** Fraction of the previous level's triangles targeted by each level */
+  float reduction = 0.5f;
+  /** Tolerated geometric error as a fraction of viewport height */
+  float screenError = 1.f / 1080.f;
+};
+
 /** Intermediate mesh representation prepared by blender from a single mesh object */
 struct Mesh {
   static constexpr std::size_t MaxColorLayers = 4;
@@ -304,6 +382,8 @@ struct Mesh {
   Vector3f aabbMax;
 
   std::vector<std::vector<Material>> materialSets;
+  /** MaterialTable ID of each material in materialSets[0] */
+  std::vector<uint32_t> materialIds;
 
   /* Vertex buffer data */
   std::vector<Vector3f> pos;
@@ -314,6 +394,8 @@ struct Mesh {
   std::vector<Vector2f> uv;
   uint32_t luvLayerCount = 0;
   std::vector<Vector2f> luv;
+  /** Per-corner tangents with the bitangent sign in w; empty unless generated at compile */
+  std::vector<Vector4f> tangent;
 
   /* Skinning data */
   std::vector<std::string> boneNames;
@@ -343,6 +425,8 @@ struct Mesh {
   struct Surface {
     Vector3f centroid;
     uint32_t materialIdx;
+    /** MaterialTable ID of the surface's material */
+    uint32_t materialId = UINT32_MAX;
     Vector3f aabbMin;
     Vector3f aabbMax;
     Vector3f reflectionNormal;
@@ -356,35 +440,175 @@ struct Mesh {
       std::array<uint32_t, 8> iUv = {0xffffffff};
       uint32_t iSkin = 0xffffffff;
       uint32_t iBankSkin = 0xffffffff;
+      uint32_t iTangent = 0xffffffff;
 
       bool operator==(const Vert& other) const;
     };
     std::vector<Vert> verts;
+
+    /** Simplified primitives of each LOD level, in the same form as verts */
+    std::vector<std::vector<Vert>> lodVerts;
   };
   std::vector<Surface> surfaces;
 
+  /** Largest projected radius (fraction of viewport height) at which each LOD level may be drawn */
+  std::vector<float> lodScreenSizes;
+
   std::unordered_map<std::string, std::string> customProps;
 
+  /** Content key of the transferred attributes, materials and compile options; meshes with equal
+   *  keys cook to equal geometry, so DataSpecs may emit one shared copy. Zero when not computed */
+  uint64_t geometryHash = 0;
+
   struct SkinBanks {
     struct Bank {
       std::vector<uint32_t> m_skinIdxs;
       std::vector<uint32_t> m_boneIdxs;
+      /** Position of each skin index within m_skinIdxs */
+      std::unordered_map<uint32_t, uint32_t> m_skinSlots;
 
       void addSkins(const Mesh& parent, const std::vector<uint32_t>& skinIdxs);
     };
     std::vector<Bank> banks;
     std::vector<Bank>::iterator addSkinBank(int skinSlotCount);
     uint32_t addSurface(const Mesh& mesh, const Surface& surf, int skinSlotCount);
-  } skinBanks;
+    /** Assign every surface a bank, placing the largest skin sets first so banks end up fewer and fuller */
+    void addSurfaces(const Mesh& mesh, std::vector<Surface>& surfs, int skinSlotCount);
 
-  Mesh(Connection& conn, HMDLTopology topology, int skinSlotCount, bool useLuvs = false);
+  private:
+    uint32_t addSkinSet(const Mesh& mesh, const std::vector<uint32_t>& skinSet, int skinSlotCount);
+  } skinBanks;
 
-  Mesh getContiguousSkinningVersion() const;
+  /** attrSlot selects which mapped attribute file a pipelined request was cooked to;
+   *  genTangents derives MikkTSpace-style tangents from the first non-lightmap UV layer */
+  Mesh(Connection& conn, HMDLTopology topology, int skinSlotCount, bool useLuvs = false, int attrSlot = -1,
+       bool genTangents = false);
+  /** Empty mesh to be populated in-process, as by MeshOptimizer without a blender connection */
+  explicit Mesh(HMDLTopology topology) : topology(topology) {}
+
+  /** Renumber pos and norm so the verts of each skin are contiguous, filling contiguousSkinVertCounts */
+  void makeSkinningContiguous();
+  Mesh getContiguousSkinningVersion() const&;
+  /** Reuses this mesh's storage; prefer it when the original is no longer needed */
+  Mesh getContiguousSkinningVersion() &&;
+
+  /** Populates Surface::lodVerts and lodScreenSizes by quadric edge collapse.
+   *  Attribute seams, surface borders and dominant skin influences are preserved
+   */
+  void generateLods(const LodOptions& options = {});
 
   /** Prepares mesh representation for indexed access on modern APIs.
    *  Mesh must remain resident for accessing reference members
    */
-  HMDLBuffers getHMDLBuffers(bool absoluteCoords, PoolSkinIndex& poolSkinIndex) const;
+  HMDLBuffers getHMDLBuffers(bool absoluteCoords, PoolSkinIndex& poolSkinIndex,
+                             const HMDLOptions& options = {}) const;
+};
+
+/**
+ * @brief Optimized geometry of previously compiled meshes, keyed by content
+ *
+ * Areas and actors link or duplicate the same props across many blends. When
+ * the attribute block, material set and compile options of a mesh match an
+ * earlier one, Mesh takes a copy of that mesh's optimized geometry instead of
+ * running MeshOptimizer again. One cache serves every connection of the
+ * process; it holds up to a byte budget, evicting the oldest entries first.
+ */
+class MeshGeometryCache {
+public:
+  /** Everything MeshOptimizer::optimize produces */
+  struct Geometry {
+    HMDLTopology topology;
+    std::vector<Vector3f> pos;
+    std::vector<Vector3f> norm;
+    uint32_t colorLayerCount = 0;
+    std::vector<Vector3f> color;
+    uint32_t uvLayerCount = 0;
+    std::vector<Vector2f> uv;
+    std::vector<Vector2f> luv;
+    std::vector<Vector4f> tangent;
+    std::vector<std::array<Mesh::SkinBind, Mesh::MaxSkinEntries>> skins;
+    std::vector<Mesh::Surface> surfaces;
+    std::vector<Material> materials;
+    std::size_t byteSize = 0;
+  };
+
+  static MeshGeometryCache& Shared();
+
+  static uint64_t Key(const uint8_t* attrData, std::size_t attrSize, const std::vector<Material>& materials,
+                      HMDLTopology topology, int skinSlotCount, bool useLuvs, bool genTangents = false);
+
+  /** Fill mesh's geometry from a cached entry; false on a miss */
+  bool restore(uint64_t key, const std::vector<Material>& materials, Mesh& mesh);
+  /** Record the geometry of a freshly optimized mesh */
+  void insert(uint64_t key, const std::vector<Material>& materials, const Mesh& mesh);
+
+  void setBudget(std::size_t bytes);
+  void clear();
+  std::size_t getHitCount() const { return m_hits; }
+  std::size_t getMissCount() const { return m_misses; }
+
+private:
+  mutable std::mutex m_mutex;
+  std::unordered_map<uint64_t, std::shared_ptr<const Geometry>> m_entries;
+  /* Insertion order for eviction */
+  std::deque<uint64_t> m_order;
+  std::size_t m_bytes = 0;
+  std::size_t m_budget = std::size_t(256) << 20;
+  std::atomic_size_t m_hits = 0;
+  std::atomic_size_t m_misses = 0;
+
+  void _evict();
+};
+
+/**
+ * @brief Skin weight sets shared by every mesh of an actor
+ *
+ * An actor's subtypes, overlays and attachments mostly bind the same bones
+ * with the same weights, yet each mesh numbers its bones by its own vertex
+ * groups. Adding each mesh translates its skins to actor-wide bone indices
+ * and deduplicates them by content, so all meshes index one skin table and
+ * one bone list. Skinning matrices are then computed and uploaded once per
+ * pool bone rather than once per mesh.
+ *
+ * Meshes may be added from several threads.
+ */
+class SkinPool {
+public:
+  struct Bind {
+    uint32_t boneIdx = UINT32_MAX;
+    float weight = 0.f;
+    bool operator==(const Bind& other) const { return boneIdx == other.boneIdx && weight == other.weight; }
+  };
+  /** Valid binds first, ordered by bone */
+  using Skin = std::array<Bind, Mesh::MaxSkinEntries>;
+
+  struct MeshBinding {
+    /** Pool skin of each of the mesh's skins */
+    std::vector<uint32_t> skinIdxs;
+    /** Pool bone of each of the mesh's boneNames */
+    std::vector<uint32_t> boneIdxs;
+  };
+
+  MeshBinding addMesh(const Mesh& mesh);
+  /** Make an index filled by Mesh::getHMDLBuffers refer to pool skins */
+  static void Remap(PoolSkinIndex& index, const MeshBinding& binding);
+
+  /** Pool bone of a name, adding it if new */
+  uint32_t addBone(std::string_view name);
+  /** Copies, since other threads may still be adding meshes */
+  std::vector<std::string> getBoneNames() const;
+  std::vector<Skin> getSkins() const;
+  std::size_t getSkinCount() const;
+
+private:
+  mutable std::mutex m_mutex;
+  std::vector<std::string> m_boneNames;
+  std::unordered_map<std::string, uint32_t> m_boneIdxs;
+  std::vector<Skin> m_skins;
+  /* Content hash to the pool skins having it */
+  std::unordered_multimap<uint64_t, uint32_t> m_skinLookup;
+
+  uint32_t _addBone(std::string_view name);
 };
 
 /** Intermediate collision mesh representation prepared by blender from a single mesh object */
@@ -456,6 +680,24 @@ struct ColMesh {
   };
   std::vector<Triangle> trianges;
 
+  /** Flattened bounding volume hierarchy over trianges */
+  struct BVH {
+    /* Depth-first order: an interior node's first child immediately follows it */
+    struct Node {
+      std::array<float, 3> min;
+      /* Leaf: first entry of triIndices; interior: index of the second child */
+      uint32_t offset;
+      std::array<float, 3> max;
+      /* Triangles in a leaf, 0 for interior nodes */
+      uint32_t count;
+    };
+    std::vector<Node> nodes;
+    std::vector<uint32_t> triIndices;
+  };
+
+  /** Binned SAH build, with large subtrees split across the CPU count */
+  BVH buildBVH(uint32_t maxLeafTris = 4) const;
+
   ColMesh(Connection& conn);
 };
 
@@ -546,19 +788,37 @@ struct Bone {
   Vector3f origin;
   int32_t parent = -1;
   std::vector<int32_t> children;
-  Bone(Connection& conn);
 };
 
-/** Intermediate armature representation used in Actor */
+/**
+ * Intermediate armature representation used in Actor
+ *
+ * Sent as a name table followed by packed origin, parent and child arrays,
+ * each arriving in a single read.
+ */
 struct Armature {
   std::vector<Bone> bones;
+  /** Index into bones of each bone name */
+  std::unordered_map<std::string, uint32_t> boneIndices;
   const Bone* lookupBone(const char* name) const;
+  /** Index into bones, or -1 if there is no bone of that name */
+  int32_t lookupBoneIdx(std::string_view name) const;
   const Bone* getParent(const Bone* bone) const;
   const Bone* getChild(const Bone* bone, std::size_t child) const;
   const Bone* getRoot() const;
   Armature(Connection& conn);
 };
 
+/** Key reduction and quantization settings for Action::compress */
+struct CurveCompressionOptions {
+  /** Tolerated deviation of each normalized quaternion component */
+  float rotationTolerance = 0.0005f;
+  /** Tolerated deviation of each position component, in scene units */
+  float positionTolerance = 0.0001f;
+  /** Tolerated deviation of each scale component */
+  float scaleTolerance = 0.0001f;
+};
+
 /** Intermediate action representation used in Actor */
 struct Action {
   std::string name;
@@ -582,6 +842,35 @@ struct Action {
   std::vector<Channel> channels;
   std::vector<std::pair<Vector3f, Vector3f>> subtypeAABBs;
   Action(Connection& conn);
+
+  /** One attribute of a channel with redundant keys removed */
+  struct CompressedCurve {
+    /** Indices into frames of the retained keys, always including the first and last */
+    std::vector<uint32_t> keys;
+    /** componentCount values per key, each decoding to offset + value * scale */
+    std::vector<uint16_t> values;
+    std::array<float, 4> offset = {};
+    std::array<float, 4> scale = {};
+    uint32_t componentCount = 0;
+
+    /** Linearly interpolated value at an index into frames; rotations are renormalized */
+    std::array<float, 4> sample(uint32_t frameIdx) const;
+  };
+  struct CompressedChannel {
+    std::string boneName;
+    uint32_t attrMask;
+    /* Empty where attrMask omits the attribute */
+    CompressedCurve rotation;
+    CompressedCurve position;
+    CompressedCurve scale;
+  };
+
+  /** Drop keys linear interpolation reproduces within tolerance, then quantize to 16 bits */
+  std::vector<CompressedChannel> compress(const CurveCompressionOptions& options = {}) const;
+
+  /** compress() over several actions, split across idle ClientProcess workers when called from one */
+  static std::vector<std::vector<CompressedChannel>> CompressAll(const std::vector<Action>& actions,
+                                                                 const CurveCompressionOptions& options = {});
 };
 
 /** Intermediate actor representation prepared by blender from a single HECL actor blend */
@@ -628,26 +917,53 @@ struct PathMesh {
   PathMesh(Connection& conn);
 };
 
+/** PVS cube render request; six images are written to path suffixed with the face index */
+struct PvsProbe {
+  std::string path;
+  /** Camera location, unless lightName is set */
+  atVec3f location = {};
+  /** When non-empty, the camera is placed at this light instead */
+  std::string lightName;
+};
+
 class DataStream {
   friend class Connection;
   Connection* m_parent;
+  /* Reader servicing queued requests; owns the connection until it finishes */
+  std::thread m_pipeline;
   DataStream(Connection* parent);
+  void _joinPipeline();
+  void _renderPvsBatch(const PvsProbe* probes, size_t count, uint8_t* results);
 
 public:
   DataStream(const DataStream& other) = delete;
-  DataStream(DataStream&& other) : m_parent(other.m_parent) { other.m_parent = nullptr; }
+  DataStream(DataStream&& other) : m_parent(other.m_parent), m_pipeline(std::move(other.m_pipeline)) {
+    other.m_parent = nullptr;
+  }
   ~DataStream() { close(); }
   void close();
+  /** Blend loaded on the connection this stream reads from */
+  const ProjectPath& getBlendPath() const;
   std::vector<std::string> getMeshList();
   std::vector<std::string> getLightList();
   std::pair<atVec3f, atVec3f> getMeshAABB();
   static const char* MeshOutputModeString(HMDLTopology topology);
 
-  /** Compile mesh by context (MESH blends only) */
-  Mesh compileMesh(HMDLTopology topology, int skinSlotCount = 10);
+  /** Compile mesh by context (MESH blends only); genTangents adds a tangent frame per corner */
+  Mesh compileMesh(HMDLTopology topology, int skinSlotCount = 10, bool genTangents = false);
 
   /** Compile mesh by name (AREA blends only) */
-  Mesh compileMesh(std::string_view name, HMDLTopology topology, int skinSlotCount = 10, bool useLuv = false);
+  Mesh compileMesh(std::string_view name, HMDLTopology topology, int skinSlotCount = 10, bool useLuv = false,
+                   bool genTangents = false);
+
+  /** Queue compilation of several meshes by name (AREA blends only).
+   *  A reader thread keeps MeshPipelineDepth requests in flight, so blender cooks the next mesh
+   *  while the last one is optimized and the caller post-processes finished ones. Futures become
+   *  ready in name order; no other call may be made on this stream until all of them are. */
+  std::vector<std::future<Mesh>> compileMeshes(const std::vector<std::string>& names, HMDLTopology topology,
+                                               int skinSlotCount = 10, bool useLuv = false,
+                                               bool genTangents = false);
+  static constexpr size_t MeshPipelineDepth = 4;
 
   /** Compile collision mesh by name (AREA blends only) */
   ColMesh compileColMesh(std::string_view name);
@@ -679,10 +995,25 @@ public:
   std::vector<std::pair<std::string, std::string>> getSubtypeOverlayNames(std::string_view name);
   std::vector<std::pair<std::string, std::string>> getAttachmentNames();
 
+  /** Rest matrices of an armature's bones, addressed by bone index */
+  struct BoneMatrices {
+    std::vector<std::string> names;
+    std::vector<Matrix3f> matrices;
+    std::unordered_map<std::string, uint32_t> indices;
+    /** nullptr if there is no bone of that name */
+    const Matrix3f* lookup(std::string_view name) const;
+  };
+  /** Name table, then every matrix in one packed read */
+  BoneMatrices getBoneMatrixArray(std::string_view name);
   std::unordered_map<std::string, Matrix3f> getBoneMatrices(std::string_view name);
 
   bool renderPvs(std::string_view path, const atVec3f& location);
   bool renderPvsLight(std::string_view path, std::string_view lightName);
+  /** Render all probes with one scene setup and round trip per instance.
+   *  With instanceCount above 1 and called from a ClientProcess worker, idle workers
+   *  load this blend on their own connections and take contiguous shares of the
+   *  probes, within the cook memory budget. Returns whether each probe rendered. */
+  std::vector<bool> renderPvsBatch(const std::vector<PvsProbe>& probes, size_t instanceCount = 1);
 
   MapArea compileMapArea();
   MapUniverse compileMapUniverse();
@@ -725,6 +1056,8 @@ class Connection {
   bool m_consoleThreadRunning = true;
 #else
   pid_t m_blenderProc = 0;
+  /* Forked by the fork server rather than this process, so it can't be waited on */
+  bool m_forkServerChild = false;
 #endif
   std::array<int, 2> m_readpipe{};
   std::array<int, 2> m_writepipe{};
@@ -732,6 +1065,20 @@ class Connection {
   bool m_loadedRigged = false;
   ProjectPath m_loadedBlend;
   hecl::SystemString m_errPath;
+  hecl::SystemString m_meshAttrPath;
+  hecl::SystemString _meshAttrPath(int slot) const;
+
+  /* User-space pipe buffers; pending writes are flushed before any blocking read */
+  static constexpr std::size_t PipeBufferSize = 64 * 1024;
+  std::unique_ptr<uint8_t[]> m_readBuffer = std::make_unique<uint8_t[]>(PipeBufferSize);
+  std::size_t m_readHead = 0;
+  std::size_t m_readTail = 0;
+  uint64_t m_blenderWaitNs = 0;
+  std::vector<uint8_t> m_writeBuffer;
+  bool _readRaw(void* buf, std::size_t len);
+  bool _flushWrite();
+  void _resetPipeBuffers();
+
   uint32_t _readStr(char* buf, uint32_t bufSz);
   uint32_t _writeStr(const char* str, uint32_t len, int wpipe);
   uint32_t _writeStr(const char* str, uint32_t len) { return _writeStr(str, len, m_writepipe[1]); }
@@ -754,9 +1101,9 @@ class Connection {
     for (uint32_t i = 0; i < nItems; ++i)
       enumerator(*this);
   }
-  template<typename T, typename... Args, std::enable_if_t<
+  template<typename T, typename A, typename... Args, std::enable_if_t<
       !std::disjunction_v<std::is_arithmetic<T>, std::is_enum<T>, std::is_same<T, std::string>>, int> = 0>
-  void _readVector(std::vector<T>& container, Args&&... args) {
+  void _readVector(std::vector<T, A>& container, Args&&... args) {
     uint32_t nItems;
     _readBuf(&nItems, 4);
     container.clear();
@@ -764,8 +1111,8 @@ class Connection {
     for (uint32_t i = 0; i < nItems; ++i)
       container.emplace_back(*this, std::forward<Args>(args)...);
   }
-  template<typename T, std::enable_if_t<std::disjunction_v<std::is_arithmetic<T>, std::is_enum<T>>, int> = 0>
-  void _readVector(std::vector<T>& container) {
+  template<typename T, typename A, std::enable_if_t<std::disjunction_v<std::is_arithmetic<T>, std::is_enum<T>>, int> = 0>
+  void _readVector(std::vector<T, A>& container) {
     uint32_t nItems;
     _readBuf(&nItems, 4);
     container.clear();
@@ -783,8 +1130,8 @@ class Connection {
       _readBuf(&container.emplace_back(strSize, ' ')[0], strSize);
     }
   }
-  template<typename T, typename F>
-  void _readVectorFunc(std::vector<T>& container, F func) {
+  template<typename T, typename A, typename F>
+  void _readVectorFunc(std::vector<T, A>& container, F func) {
     uint32_t nItems;
     _readBuf(&nItems, 4);
     container.clear();
@@ -815,8 +1162,15 @@ class Connection {
   void _closePipe();
   void _blenderDied();
 
+  /* forkServerFd >= 0 launches the fork server itself, handing it that socket */
+  Connection(int verbosityLevel, int forkServerFd);
+  static int _spawnFromForkServer(int verbosityLevel, int readFd, int writeFd);
+  static int _startForkServer(int verbosityLevel);
+  static int _connectForkDaemon();
+  static void _shutdownForkServer();
+
 public:
-  Connection(int verbosityLevel = 1);
+  Connection(int verbosityLevel = 1) : Connection(verbosityLevel, -1) {}
   ~Connection();
 
   Connection(const Connection&) = delete;
@@ -847,6 +1201,16 @@ public:
   }
 
   void quitBlender();
+  bool isStreamActive() const { return m_lock; }
+
+  /** Total time spent blocked on replies from Blender */
+  uint64_t getBlenderWaitNs() const { return m_blenderWaitNs; }
+  /** Restart peak memory measurement of the Blender process where supported (Linux) */
+  void resetPeakMemory();
+  /** Peak resident memory of the Blender process in KiB, or 0 if unavailable */
+  uint64_t getPeakMemoryKb() const;
+  /** Current resident memory of the Blender process in KiB, or 0 if unavailable */
+  uint64_t getMemoryKb() const;
 
   void closeStream() {
     if (m_lock)
@@ -854,6 +1218,8 @@ public:
   }
 
   static Connection& SharedConnection();
+
+  /** Quits the shared connection and every warm connection released to the pool */
   static void Shutdown();
 };
 
@@ -871,7 +1237,7 @@ public:
 private:
   friend struct Mesh;
   HMDLBuffers(HMDLMeta&& meta, std::size_t vboSz, const std::vector<atUint32>& iboData, std::vector<Surface>&& surfaces,
-              const Mesh::SkinBanks& skinBanks);
+              std::vector<HMDLCluster>&& clusters, const Mesh::SkinBanks& skinBanks);
 
 public:
   HMDLMeta m_meta;
@@ -886,8 +1252,19 @@ public:
     const Mesh::Surface& m_origSurf;
     atUint32 m_start;
     atUint32 m_count;
+    /** Range of m_clusters covering this surface (empty unless clustering was requested) */
+    atUint32 m_clusterStart = 0;
+    atUint32 m_clusterCount = 0;
+    /** IBO range of each LOD level of this surface */
+    struct Range {
+      atUint32 m_start;
+      atUint32 m_count;
+    };
+    std::vector<Range> m_lods;
   };
   std::vector<Surface> m_surfaces;
+  std::vector<HMDLCluster> m_clusters;
+  std::vector<float> m_lodScreenSizes;
 
   const Mesh::SkinBanks& m_skinBanks;
 };
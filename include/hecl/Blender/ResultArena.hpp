@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace hecl::blender {
+
+/**
+ * @brief Monotonic scratch memory for DataStream results
+ *
+ * While a ResultArena is alive, containers declared with ResultAllocator that
+ * are created on the same thread take their storage from it. Their frees are
+ * no-ops, and the whole arena is released in one go when it is destroyed.
+ * Scope one around a cook so the scratch buffers DataStream readers fill
+ * while deserializing don't each make a heap allocation.
+ *
+ * Only scratch local to a reader may use ResultAllocator. Moving a container
+ * keeps its arena storage, so a result type holding one would dangle once
+ * moved out of the cook; the public result structures use std containers.
+ * Copies allocate from the heap. With no arena in scope, ResultAllocator is
+ * the plain heap. Arenas nest; the innermost one on a thread is used.
+ */
+class ResultArena {
+  struct alignas(std::max_align_t) Block {
+    Block* m_next;
+  };
+  static constexpr size_t BlockSize = 256 * 1024;
+
+  Block* m_blocks = nullptr;
+  uint8_t* m_cur = nullptr;
+  uint8_t* m_end = nullptr;
+  ResultArena* m_prev;
+
+public:
+  ResultArena();
+  ~ResultArena();
+  ResultArena(const ResultArena&) = delete;
+  ResultArena& operator=(const ResultArena&) = delete;
+
+  void* allocate(size_t size, size_t align);
+
+  /** Innermost arena on the calling thread, if any */
+  static ResultArena* Current();
+};
+
+template <typename T>
+class ResultAllocator {
+  template <typename U>
+  friend class ResultAllocator;
+  ResultArena* m_arena;
+
+  explicit ResultAllocator(ResultArena* arena) noexcept : m_arena(arena) {}
+
+public:
+  using value_type = T;
+  /* Assigning into a container keeps its storage where it was */
+  using propagate_on_container_copy_assignment = std::false_type;
+  using propagate_on_container_move_assignment = std::false_type;
+  using is_always_equal = std::false_type;
+
+  ResultAllocator() noexcept : m_arena(ResultArena::Current()) {}
+  template <typename U>
+  ResultAllocator(const ResultAllocator<U>& other) noexcept : m_arena(other.m_arena) {}
+
+  /* Copies go to the heap so they may outlive the arena */
+  ResultAllocator select_on_container_copy_construction() const noexcept { return ResultAllocator(nullptr); }
+
+  T* allocate(size_t n) {
+    if (m_arena)
+      return static_cast<T*>(m_arena->allocate(n * sizeof(T), alignof(T)));
+    return std::allocator<T>().allocate(n);
+  }
+  void deallocate(T* p, size_t n) noexcept {
+    if (!m_arena)
+      std::allocator<T>().deallocate(p, n);
+  }
+
+  template <typename U>
+  bool operator==(const ResultAllocator<U>& other) const noexcept {
+    return m_arena == other.m_arena;
+  }
+  template <typename U>
+  bool operator!=(const ResultAllocator<U>& other) const noexcept {
+    return m_arena != other.m_arena;
+  }
+};
+
+template <typename T>
+using ResultVector = std::vector<T, ResultAllocator<T>>;
+
+template <typename K, typename V, typename H = std::hash<K>, typename E = std::equal_to<K>>
+using ResultUnorderedMap = std::unordered_map<K, V, H, E, ResultAllocator<std::pair<const K, V>>>;
+
+} // namespace hecl::blender
@@ -1,9 +1,11 @@
 #pragma once
 
 #include <functional>
+#include <optional>
 #include <vector>
 
 #include "hecl/FourCC.hpp"
+#include "hecl/MappedFile.hpp"
 #include "hecl/SystemChar.hpp"
 
 #include <athena/DNA.hpp>
@@ -60,17 +62,51 @@ struct FileBlock : public athena::io::DNA<athena::Endian::Little> {
   Value<atUint32> count;
 };
 
+/**
+ * @brief Block-level reader of a .blend
+ *
+ * Uncompressed files are memory mapped and enumerated in place. Gzip files are
+ * inflated into an arena borrowed from a process-wide pool, sized from the gzip
+ * trailer and returned for reuse on destruction.
+ */
 class SDNARead {
-  std::vector<uint8_t> m_data;
+  MappedFile m_mapped;
+  std::vector<uint8_t> m_arena;
+  const uint8_t* m_data = nullptr;
+  size_t m_size = 0;
   SDNABlock m_sdnaBlock;
 
+  bool _inflate(const uint8_t* comp, size_t compSize);
+
 public:
   explicit SDNARead(SystemStringView path);
-  explicit operator bool() const { return !m_data.empty(); }
+  ~SDNARead();
+  SDNARead(const SDNARead&) = delete;
+  SDNARead& operator=(const SDNARead&) = delete;
+  explicit operator bool() const { return m_data != nullptr; }
   const SDNABlock& sdnaBlock() const { return m_sdnaBlock; }
   void enumerate(const std::function<bool(const FileBlock& block, athena::io::MemoryReader& r)>& func) const;
 };
 
+/** HECL type of a .blend and, for meshes, whether it is rigged */
+struct BlendInfo {
+  BlendType type;
+  /** Only known once a Connection has opened the file at its current modtime and size */
+  std::optional<bool> rigged;
+};
+
+/**
+ * @brief Read the HECL type of a .blend without opening it in Blender
+ *
+ * Results are cached on (modtime, size) in the .hecl directory of the enclosing
+ * project, so repeated queries of unchanged files cost a single stat. Otherwise
+ * the file is streamed (inflating gzip blends as it goes) until the first
+ * hecl_type property block is found; the full file is never buffered.
+ */
+BlendInfo GetBlendInfo(SystemStringView path);
 BlendType GetBlendType(SystemStringView path);
 
+/** Store type and rig flag observed by a Connection for the file's current modtime and size */
+void RecordBlendInfo(SystemStringView path, BlendType type, bool rigged);
+
 } // namespace hecl::blender
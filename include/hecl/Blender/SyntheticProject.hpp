@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace hecl {
+class ClientProcess;
+class ProjectPath;
+} // namespace hecl
+
+namespace hecl::blender {
+
+/** Size and complexity of a generated benchmark project */
+struct SyntheticProjectDesc {
+  uint32_t textureCount = 256;
+  /** Edge length of each square RGBA texture in pixels */
+  uint32_t textureSize = 256;
+  uint32_t yamlCount = 256;
+  /** Top-level records per YAML document */
+  uint32_t yamlEntries = 256;
+  uint32_t meshCount = 32;
+  /** Icosphere subdivision level of each mesh; every level quadruples its 20 faces, up to 8 */
+  uint32_t meshSubdivisions = 5;
+};
+
+/**
+ * @brief Populate dir with synthetic working files for end-to-end cook benchmarks
+ *
+ * Writes textures/tex####.png, data/data####.yaml and meshes/mesh####.blend
+ * beneath dir. Contents depend only on desc, so runs against separate
+ * projects are comparable. Each mesh is a UV-mapped icosphere whose material
+ * samples one of the textures, giving the depsgraph a .blend to .png edge.
+ *
+ * Files are written by transactions on cp; meshes are built on the workers'
+ * Blender connections. Textures are complete before any mesh references them.
+ *
+ * @return Number of files written; less than requested if any failed
+ */
+size_t GenerateSyntheticProject(const ProjectPath& dir, const SyntheticProjectDesc& desc, ClientProcess& cp);
+
+} // namespace hecl::blender
@@ -10,6 +10,12 @@ class Token {
 
 public:
   Connection& getBlenderConnection();
+
+  /** Returns the connection if one was already started, without starting one */
+  Connection* peekBlenderConnection() const { return m_conn.get(); }
+
+  /** Returns the connection to the process-wide warm pool instead of quitting blender */
+  void release();
   void shutdown();
 
   Token() = default;
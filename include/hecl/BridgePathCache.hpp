@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "hecl/MappedFile.hpp"
+#include "hecl/hecl.hpp"
+
+namespace hecl::Database {
+class Project;
+
+/**
+ * @brief Persistent map of resource IDs to the working paths bridging them
+ *
+ * Saved at .hecl/bridgecache as an open-addressed table of (id, path)
+ * slots followed by a string table of project-relative UTF-8 paths. The file
+ * is memory mapped on first use, so loading costs the same regardless of
+ * entry count; lookups probe the mapping directly and only materialize
+ * ProjectPaths for IDs actually requested.
+ *
+ * Additions are held in memory and merged into a rewritten table by save(),
+ * which runs on destruction if anything changed. Entries persist across
+ * invocations until clear(), so DataSpecs may skip rescanning the project
+ * when size() shows a populated cache.
+ */
+class BridgePathCache {
+  struct Slot;
+
+  Project& m_project;
+  std::mutex m_mutex;
+  bool m_loaded = false;
+  SystemString m_path;
+  MappedFile m_file;
+  const Slot* m_slots = nullptr;
+  uint32_t m_capacity = 0;
+  uint32_t m_mappedCount = 0;
+  const char* m_strings = nullptr;
+  uint64_t m_stringsSize = 0;
+  /* The mapped table was superseded by clear() */
+  bool m_cleared = false;
+  bool m_dirty = false;
+  std::unordered_map<uint64_t, std::string> m_added;
+  std::unordered_map<uint64_t, ProjectPath> m_resolved;
+
+  void _load();
+  void _map();
+  const Slot* _findMapped(uint64_t id) const;
+  std::string_view _slotPath(const Slot& slot) const;
+
+public:
+  explicit BridgePathCache(Project& project);
+  ~BridgePathCache();
+  BridgePathCache(const BridgePathCache&) = delete;
+  BridgePathCache& operator=(const BridgePathCache&) = delete;
+
+  void add(uint64_t id, const ProjectPath& path);
+  void clear();
+
+  /** Pointer remains valid until clear() */
+  const ProjectPath* lookup(uint64_t id);
+
+  /** Number of IDs mapped, saved or not */
+  size_t size();
+
+  /** Write the table if it changed since it was loaded */
+  void save();
+};
+
+} // namespace hecl::Database
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hecl {
+class Console;
+
+/**
+ * @brief Point-in-time counters of one GPU buffer pool
+ *
+ * Element counts are in pool elements; byte counts include stride rounding.
+ * Cumulative counters run from pool construction.
+ */
+struct BufferPoolStats {
+  std::string m_name;
+  size_t m_stride = 0;
+  size_t m_bucketCount = 0;
+  size_t m_bucketSize = 0;
+  size_t m_liveElements = 0;
+  size_t m_peakLiveElements = 0;
+  size_t m_freeElements = 0;
+  /** Largest contiguous free run within any bucket */
+  size_t m_largestFreeRange = 0;
+  uint64_t m_allocations = 0;
+  uint64_t m_releases = 0;
+  /** Bytes sent by the most recent updateBuffers() */
+  size_t m_lastUploadBytes = 0;
+  uint64_t m_totalUploadBytes = 0;
+
+  size_t capacityBytes() const { return m_bucketCount * m_bucketSize; }
+
+  /** 0 when all free space is one run, approaching 1 as it scatters into small runs */
+  float fragmentation() const {
+    return m_freeElements ? 1.f - float(m_largestFreeRange) / float(m_freeElements) : 0.f;
+  }
+};
+
+/**
+ * @brief Common base of buffer pools, registering each pool for statistics
+ *
+ * Pools register on construction and unregister on destruction, so
+ * SnapshotBufferPools() sees every live pool without explicit setup.
+ */
+class BufferPoolBase {
+  std::string m_name;
+
+protected:
+  explicit BufferPoolBase(std::string_view defaultName);
+  ~BufferPoolBase();
+  void _fillCommon(BufferPoolStats& stats) const { stats.m_name = m_name; }
+
+public:
+  BufferPoolBase(const BufferPoolBase&) = delete;
+  BufferPoolBase& operator=(const BufferPoolBase&) = delete;
+
+  /** Label shown in statistics dumps */
+  void setName(std::string_view name);
+  virtual BufferPoolStats stats() = 0;
+};
+
+/** Stats of every live pool, in registration order */
+std::vector<BufferPoolStats> SnapshotBufferPools();
+
+/** Register the bufferPoolStats command, which prints SnapshotBufferPools() */
+void RegisterBufferPoolCommands(Console& console);
+
+} // namespace hecl
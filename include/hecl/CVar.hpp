@@ -1,7 +1,11 @@
 #pragma once
 
+#include <atomic>
+#include <bit>
+#include <cstdint>
 #include <functional>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include <athena/DNAYaml.hpp>
@@ -48,8 +52,12 @@ struct CVarContainer : public athena::io::DNA<athena::Endian::Big> {
 } // namespace DNACVAR
 
 class CVarManager;
+template <typename T>
+class CVarHandle;
 class CVar : protected DNACVAR::CVar {
   friend class CVarManager;
+  template <typename T>
+  friend class CVarHandle;
   Delete _d;
 
 public:
@@ -159,6 +167,7 @@ private:
   void dispatch();
   void clearModified();
   void setModified();
+  void updateScalar();
   std::string m_help;
   EType m_type;
   std::string m_defaultValue;
@@ -167,6 +176,8 @@ private:
   bool m_unlocked = false;
   bool m_wasDeserialized = false;
   std::vector<ListenerFunc> m_listeners;
+  /* Boolean, integer and real values parsed once per write; doubles are stored as their bit pattern */
+  std::atomic_uint64_t m_scalar = 0;
   bool safeToModify(EType type) const;
   void init(EFlags flags, bool removeColor = true);
 };
@@ -303,6 +314,44 @@ inline bool CVar::fromValue(std::wstring_view val) {
   return fromLiteral(val);
 }
 
+/**
+ * @brief Typed reference to a CVar for hot paths
+ *
+ * Resolve once through CVarManager::findCVarHandle() and read every frame:
+ * get() is a single atomic load of the pre-parsed value, with no name lookup
+ * or string parsing, and may be called from any thread. Reads of an unset
+ * handle or a CVar of another type return T{}.
+ */
+template <typename T>
+class CVarHandle {
+  static_assert(std::is_same_v<T, bool> || std::is_same_v<T, int32_t> || std::is_same_v<T, uint32_t> ||
+                    std::is_same_v<T, double> || std::is_same_v<T, float>,
+                "CVarHandle supports scalar types only");
+  const CVar* m_cvar = nullptr;
+
+public:
+  CVarHandle() = default;
+  explicit CVarHandle(const CVar* cvar) : m_cvar(cvar) {}
+
+  const CVar* cvar() const { return m_cvar; }
+  explicit operator bool() const { return m_cvar != nullptr; }
+
+  T get() const {
+    if (!m_cvar)
+      return T{};
+    const uint64_t bits = m_cvar->m_scalar.load(std::memory_order_relaxed);
+    const CVar::EType type = m_cvar->m_type;
+    if constexpr (std::is_same_v<T, bool>) {
+      return type == CVar::EType::Boolean && bits != 0;
+    } else if constexpr (std::is_floating_point_v<T>) {
+      return type == CVar::EType::Real ? T(std::bit_cast<double>(bits)) : T{};
+    } else {
+      return (type == CVar::EType::Signed || type == CVar::EType::Unsigned) ? T(uint32_t(bits)) : T{};
+    }
+  }
+  T operator*() const { return get(); }
+};
+
 class CVarUnlocker {
   CVar* m_cvar;
 
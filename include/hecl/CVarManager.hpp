@@ -1,7 +1,11 @@
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -82,6 +86,11 @@ public:
   CVar* registerCVar(std::unique_ptr<CVar>&& cvar);
 
   CVar* findCVar(std::string_view name);
+  /** Resolve name once for repeated typed reads; see CVarHandle */
+  template <typename T>
+  CVarHandle<T> findCVarHandle(std::string_view name) {
+    return CVarHandle<T>(findCVar(name));
+  }
   template <class... _Args>
   CVar* findOrMakeCVar(std::string_view name, _Args&&... args) {
     if (CVar* cv = findCVar(name))
@@ -93,7 +102,16 @@ public:
   std::vector<CVar*> cvars(CVar::EFlags filter = CVar::EFlags::Any) const;
 
   void deserialize(CVar* cvar);
+  /**
+   * @brief Schedule a save of archived CVars
+   *
+   * Values are captured immediately; the file is written on a background
+   * thread once no further serialize() arrives for a short debounce period,
+   * so bursts of changes cost one write. The file is replaced atomically.
+   */
   void serialize();
+  /** Block until any scheduled save has been written */
+  void flushSerialize();
 
   static CVarManager* instance();
 
@@ -115,6 +133,23 @@ private:
 
   std::unordered_map<std::string, std::unique_ptr<CVar>> m_cvars;
   std::unordered_map<std::string, std::string> m_deferedCVars;
+
+  /* Config file parsed once into name -> value and shared by every deserialize() */
+  std::unordered_map<std::string, std::string> m_configIndex;
+  SystemString m_configIndexPath;
+  SystemString configPath() const;
+  void loadConfigIndex(const SystemString& path);
+
+  /* Coalescing background writer behind serialize() */
+  struct ConfigSnapshot;
+  std::mutex m_saveMutex;
+  std::condition_variable m_saveCv;
+  std::unique_ptr<ConfigSnapshot> m_pendingSave;
+  std::chrono::steady_clock::time_point m_saveDeadline;
+  bool m_saveBusy = false;
+  bool m_saveQuit = false;
+  std::thread m_saveThread;
+  void saveProc();
 };
 
 } // namespace hecl
@@ -1,12 +1,17 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <condition_variable>
 #include <cstddef>
+#include <deque>
 #include <functional>
 #include <list>
 #include <memory>
 #include <mutex>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "hecl/Blender/Token.hpp"
 #include "hecl/hecl.hpp"
@@ -16,13 +21,21 @@
 
 namespace hecl::Database {
 class IDataSpec;
+enum class Cost;
+}
+
+namespace hecl::blender {
+class DataStream;
 }
 
 namespace hecl {
 class MultiProgressPrinter;
+class RemoteCookAgent;
 
 extern int CpuCountOverride;
 void SetCpuCountOverride(int argc, const SystemChar** argv);
+/** Number of ClientProcess I/O threads; -j only sizes the cook workers */
+extern int IoThreadCountOverride;
 
 class ClientProcess {
   std::mutex m_mutex;
@@ -30,25 +43,84 @@ class ClientProcess {
   std::condition_variable m_initCv;
   std::condition_variable m_waitCv;
   const MultiProgressPrinter* m_progPrinter;
-  int m_completedCooks = 0;
-  int m_addedCooks = 0;
+  std::atomic_int m_completedCooks = 0;
+  std::atomic_int m_addedCooks = 0;
 
 public:
+  /** Activity of one local worker since construction */
+  struct WorkerStats {
+    /** Bucket i counts queue waits of [2^i, 2^(i+1)) microseconds; the first and last are open-ended */
+    static constexpr size_t LatencyBuckets = 24;
+    /** Running transactions */
+    uint64_t busyNs = 0;
+    /** Asleep waiting for work */
+    uint64_t idleNs = 0;
+    /** Blocked on contended queue, completion and pool locks */
+    uint64_t lockWaitNs = 0;
+    /** Enqueue to start of the transactions this worker ran */
+    uint64_t queueWaitNs = 0;
+    uint64_t transactionsRun = 0;
+    std::array<uint64_t, LatencyBuckets> queueLatency = {};
+
+    void add(const WorkerStats& other);
+    /** Activity between earlier and this snapshot of the same counters */
+    WorkerStats since(const WorkerStats& earlier) const;
+    /** Upper bound in microseconds of the bucket holding quantile q of queue waits; 0 if none ran */
+    uint64_t queueLatencyQuantileUs(double q) const;
+  };
+
+  /** WorkerStats summed over local workers */
+  struct Totals : WorkerStats {
+    size_t workers = 0;
+    /** Deepest the pending queues got */
+    int peakPending = 0;
+  };
+
   struct Transaction {
     ClientProcess& m_parent;
     enum class Type { Buffer, Cook, Lambda } m_type;
     bool m_complete = false;
+    /** Trace clock time of the last enqueue; buffer reads are only stamped while tracing */
+    uint64_t m_enqueueTime = 0;
+    /** Expected peak memory of the Blender running this in KiB; 0 for light work */
+    uint64_t m_memoryKb = 0;
     virtual void run(blender::Token& btok) = 0;
     Transaction(ClientProcess& parent, Type tp) : m_parent(parent), m_type(tp) {}
   };
+  /** One destination of a scattered buffer read */
+  struct BufferSegment {
+    void* m_target;
+    size_t m_len;
+    size_t m_offset;
+  };
   struct BufferTransaction final : Transaction {
     ProjectPath m_path;
     void* m_targetBuf;
     size_t m_maxLen;
     size_t m_offset;
-    void run(blender::Token& btok) override;
+    std::vector<BufferSegment> m_segments;
+    std::function<void(const BufferTransaction&)> m_onComplete;
+    /** Total bytes read over all segments; short when the file ends early */
+    size_t m_readLen = 0;
+    void run(blender::Token& btok) override { read(); }
+    /** Reads need no blender connection; I/O threads call this directly */
+    void read();
     BufferTransaction(ClientProcess& parent, const ProjectPath& path, void* target, size_t maxLen, size_t offset)
-    : Transaction(parent, Type::Buffer), m_path(path), m_targetBuf(target), m_maxLen(maxLen), m_offset(offset) {}
+    : Transaction(parent, Type::Buffer)
+    , m_path(path)
+    , m_targetBuf(target)
+    , m_maxLen(maxLen)
+    , m_offset(offset)
+    , m_segments{{target, maxLen, offset}} {}
+    BufferTransaction(ClientProcess& parent, const ProjectPath& path, std::vector<BufferSegment>&& segments,
+                      std::function<void(const BufferTransaction&)>&& onComplete)
+    : Transaction(parent, Type::Buffer)
+    , m_path(path)
+    , m_targetBuf(segments.empty() ? nullptr : segments.front().m_target)
+    , m_maxLen(segments.empty() ? 0 : segments.front().m_len)
+    , m_offset(segments.empty() ? 0 : segments.front().m_offset)
+    , m_segments(std::move(segments))
+    , m_onComplete(std::move(onComplete)) {}
   };
   struct CookTransaction final : Transaction {
     ProjectPath m_path;
@@ -56,9 +128,24 @@ public:
     bool m_returnResult = false;
     bool m_force;
     bool m_fast;
+    /* Set once a remote agent failed this cook; it then only runs locally */
+    bool m_remoteFailed = false;
+    std::function<void()> m_onComplete;
+    /* Cook a progressive draft as a full cook instead when the optimized artifact is current, which it then
+     * only confirms; checked here so keys are hashed on workers, not the enqueueing thread */
+    void skipRedundantDraft();
     void run(blender::Token& btok) override;
-    CookTransaction(ClientProcess& parent, const ProjectPath& path, bool force, bool fast, Database::IDataSpec* spec)
-    : Transaction(parent, Type::Cook), m_path(path), m_dataSpec(spec), m_force(force), m_fast(fast) {}
+    /** Cook through agent; false if the artifact couldn't be obtained that way */
+    bool runRemote(RemoteCookAgent& agent);
+    void finish();
+    CookTransaction(ClientProcess& parent, const ProjectPath& path, bool force, bool fast, Database::IDataSpec* spec,
+                    std::function<void()>&& onComplete)
+    : Transaction(parent, Type::Cook)
+    , m_path(path)
+    , m_dataSpec(spec)
+    , m_force(force)
+    , m_fast(fast)
+    , m_onComplete(std::move(onComplete)) {}
   };
   struct LambdaTransaction final : Transaction {
     std::function<void(blender::Token&)> m_func;
@@ -68,36 +155,199 @@ public:
   };
 
 private:
-  std::list<std::shared_ptr<Transaction>> m_pendingQueue;
+  /* One level per Database::Cost; higher levels are always drained first */
+  static constexpr size_t PriorityLevels = 4;
+
+  /* Per-worker deques pushed at the back; the owner pops from the back, idle workers steal from the front */
+  struct WorkQueue {
+    std::mutex m_mutex;
+    std::deque<std::shared_ptr<Transaction>> m_queue[PriorityLevels];
+  };
+  std::unique_ptr<WorkQueue[]> m_queues;
+  size_t m_queueCount = 0;
+
+  /* One per worker, written only by its owner with relaxed stores; padded apart to avoid false sharing */
+  struct alignas(64) WorkerCounters {
+    std::atomic_uint64_t m_busyNs = 0;
+    std::atomic_uint64_t m_idleNs = 0;
+    std::atomic_uint64_t m_lockWaitNs = 0;
+    std::atomic_uint64_t m_queueWaitNs = 0;
+    std::atomic_uint64_t m_transactionsRun = 0;
+    std::atomic_uint64_t m_queueLatency[WorkerStats::LatencyBuckets] = {};
+    void recordQueueWait(uint64_t ns);
+    WorkerStats snapshot() const;
+  };
+  std::unique_ptr<WorkerCounters[]> m_workerCounters;
+  std::atomic_size_t m_nextQueue = 0;
+  std::atomic_int m_pendingCount = 0;
+  std::atomic_int m_levelCount[PriorityLevels] = {};
+  std::atomic_int m_inProgress = 0;
+  std::atomic_int m_sleepingWorkers = 0;
+  std::atomic_int m_peakPendingCount = 0;
+  std::atomic_bool m_running = true;
+  std::mutex m_completedMutex;
   std::list<std::shared_ptr<Transaction>> m_completedQueue;
-  int m_inProgress = 0;
-  bool m_running = true;
+
+  /* Worker whose blender connection last loaded a given .blend (keyed on absolute path hash) */
+  std::mutex m_affinityMutex;
+  std::unordered_map<uint64_t, int> m_blendAffinity;
+
+  /*
+   * Each worker is charged in m_memoryInUseKb for its running cook's estimate, or for the
+   * resident size of its idle Blender. Cooks with an estimate only start while the budget
+   * holds them, except when no other such cook runs; everything else is never held back.
+   */
+  std::atomic_uint64_t m_memoryBudgetKb;
+  std::atomic_uint64_t m_memoryInUseKb = 0;
+  std::atomic_int m_memoryReservations = 0;
+  /* Bumped on every enqueue and released reservation; workers held back by the budget sleep until it moves */
+  std::atomic_uint64_t m_wakeGeneration = 0;
+
+  void enqueue(std::shared_ptr<Transaction>&& trans, size_t priority = 0, int queueIdx = -1);
+  std::shared_ptr<Transaction> dequeue(int workerIdx);
 
   struct Worker {
     ClientProcess& m_proc;
     int m_idx;
     std::thread m_thr;
+    /* This worker's share of m_memoryInUseKb */
+    uint64_t m_memoryKb = 0;
+    bool m_memoryReserved = false;
+    /* Set by dequeue when it skipped work that doesn't fit the memory budget */
+    bool m_memoryBlocked = false;
+    bool reserveMemory(const Transaction& trans);
+    void releaseMemory(const Transaction& trans);
     blender::Token m_blendTok;
     bool m_didInit = false;
+    WorkerCounters& counters() const { return m_proc.m_workerCounters[m_idx]; }
     Worker(ClientProcess& proc, int idx);
     void proc();
   };
   std::vector<Worker> m_workers;
   static ThreadLocalPtr<ClientProcess::Worker> ThreadWorker;
 
+  /* One thread per remote agent slot, taking only cooks at or above m_remoteMinLevel */
+  struct RemoteWorker {
+    ClientProcess& m_proc;
+    std::shared_ptr<RemoteCookAgent> m_agent;
+    int m_idx;
+    std::thread m_thr;
+    RemoteWorker(ClientProcess& proc, std::shared_ptr<RemoteCookAgent>&& agent, int idx);
+    void proc();
+  };
+  std::list<RemoteWorker> m_remoteWorkers;
+  std::atomic_int m_remoteWorkerCount = 0;
+  std::atomic_size_t m_remoteMinLevel;
+  std::condition_variable m_remoteCv;
+  uint64_t m_remoteGeneration = 0;
+  bool m_progressive = false;
+  std::shared_ptr<CookTransaction> dequeueRemote(size_t& level);
+
+  /*
+   * Buffer reads are serviced by a separate pool of I/O threads holding no blender token,
+   * so a burst of reads never occupies a cook worker and a long cook never delays a read
+   */
+  static constexpr int DefaultIoThreadCount = 2;
+  std::mutex m_ioMutex;
+  std::condition_variable m_ioCv;
+  std::deque<std::shared_ptr<BufferTransaction>> m_ioQueue;
+  std::atomic_int m_ioPending = 0;
+  std::vector<std::thread> m_ioThreads;
+  void enqueueIO(const std::shared_ptr<BufferTransaction>& trans);
+  void ioProc(int idx);
+  /* Set when this instance began the HECL_ACCESS_TRACE capture and ends it on shutdown */
+  bool m_ownsAccessTrace = false;
+
 public:
   ClientProcess(const MultiProgressPrinter* progPrinter = nullptr);
   ~ClientProcess() { shutdown(); }
   std::shared_ptr<const BufferTransaction> addBufferTransaction(const hecl::ProjectPath& path, void* target,
                                                                 size_t maxLen, size_t offset);
+  /**
+   * @brief Queue a scattered read of several file regions
+   * @param path File to read
+   * @param segments Destination, length and file offset of each region
+   * @param onComplete Invoked on an I/O thread once every segment is read
+   */
+  std::shared_ptr<const BufferTransaction>
+  addBufferTransaction(const hecl::ProjectPath& path, std::vector<BufferSegment>&& segments,
+                       std::function<void(const BufferTransaction&)>&& onComplete = {});
   std::shared_ptr<const CookTransaction> addCookTransaction(const hecl::ProjectPath& path, bool force, bool fast,
-                                                            Database::IDataSpec* spec);
+                                                            Database::IDataSpec* spec,
+                                                            std::function<void()>&& onComplete = {});
   std::shared_ptr<const LambdaTransaction> addLambdaTransaction(std::function<void(blender::Token&)>&& func);
+  /** Queue func at the priority of a cook of the given cost */
+  std::shared_ptr<const LambdaTransaction> addLambdaTransaction(std::function<void(blender::Token&)>&& func,
+                                                                Database::Cost cost);
+
+  /**
+   * @brief Dispatch cooks to an agent on another machine alongside the local workers
+   *
+   * Only cooks estimated at or above the minimum remote cost are sent; a cook the
+   * agent fails is requeued for the local workers, and an agent failing several
+   * cooks in a row is dropped for the rest of the session.
+   */
+  void addRemoteAgent(std::shared_ptr<RemoteCookAgent> agent);
+  /** Lowest estimated cost worth sending to a remote agent (default Medium) */
+  void setRemoteMinCost(Database::Cost cost) { m_remoteMinLevel = size_t(cost); }
+
+  /**
+   * @brief Follow each fast cook with an optimized one on idle workers
+   *
+   * Once a fast cook completes, its draft is copied to the regular cooked path so it
+   * is usable at once, and a full cook of the same path is queued below every other
+   * priority. That cook is built beside the draft and renamed over it when done.
+   * Paths whose optimized artifact is already up to date skip the draft.
+   */
+  void setProgressive(bool progressive) { m_progressive = progressive; }
+
+  /**
+   * @brief Cap the combined memory of Blender instances held by workers
+   *
+   * Cooks are charged their last recorded Blender peak, or an estimate from their cost
+   * if never cooked, and one that would exceed the budget waits while lighter work
+   * fills the idle workers. Defaults to HECL_COOK_MEMORY_MB, else three quarters of
+   * physical memory; 0 disables the cap.
+   */
+  void setMemoryBudget(uint64_t kb) { m_memoryBudgetKb = kb; }
+
+  using BlendWorkFunc = std::function<void(blender::DataStream& ds, size_t begin, size_t end)>;
+  /**
+   * @brief Split items [0, count) of the blend loaded on ds across blender connections
+   *
+   * The calling thread processes ranges of at most grain items on ds. When called from a
+   * worker, helper transactions let idle workers join in on their own connections, each
+   * loading the same blend without saving it. Helpers are charged the calling worker's
+   * memory estimate, so they only start while the budget holds them. func must only write
+   * results of its own range; all ranges are complete once this returns.
+   */
+  static void DistributeBlendWork(blender::DataStream& ds, size_t count, size_t grain, const BlendWorkFunc& func);
+
+  using WorkFunc = std::function<void(size_t begin, size_t end)>;
+  /**
+   * @brief Split items [0, count) across idle workers
+   *
+   * DistributeBlendWork for work needing no blender connection. Outside of a worker
+   * the calling thread processes every range itself; all ranges are complete once
+   * this returns.
+   */
+  static void DistributeWork(size_t count, size_t grain, const WorkFunc& func);
   bool syncCook(const hecl::ProjectPath& path, Database::IDataSpec* spec, blender::Token& btok, bool force, bool fast);
   void swapCompletedQueue(std::list<std::shared_ptr<Transaction>>& queue);
   void waitUntilComplete();
   void shutdown();
-  bool isBusy() const { return m_pendingQueue.size() || m_inProgress; }
+
+  /**
+   * @brief Per-worker counters since construction
+   *
+   * Counters are always on; each costs a relaxed store per transaction, sleep or
+   * contended lock. Values of one worker may be mutually inconsistent by up to
+   * the transaction it is running.
+   */
+  std::vector<WorkerStats> workerStats() const;
+  Totals totals() const;
+
+  bool isBusy() const { return m_pendingCount.load() > 0 || m_inProgress.load() > 0 || m_ioPending.load() > 0; }
 
   static int GetThreadWorkerIdx() {
     Worker* w = ThreadWorker.get();
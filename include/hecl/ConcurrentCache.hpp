@@ -0,0 +1,96 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+namespace hecl {
+
+/**
+ * @brief Thread-safe cache of values keyed on 64-bit content hashes
+ *
+ * Entries are spread across independently locked shards by their hash.
+ * A miss inserts a pending entry before computing outside the lock, so
+ * concurrent requests for the same hash wait for that single computation
+ * instead of duplicating it. Entries are never removed.
+ */
+template <typename V>
+class ConcurrentCache {
+  static constexpr size_t ShardCount = 16;
+
+  struct Entry {
+    std::optional<V> m_value;
+  };
+  struct Shard {
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::unordered_map<uint64_t, std::shared_ptr<Entry>> m_map;
+  };
+  Shard m_shards[ShardCount];
+
+  /* XXH64 output is well mixed; the top bits select a shard */
+  Shard& _shard(uint64_t hash) { return m_shards[hash >> 60 & (ShardCount - 1)]; }
+
+public:
+  /**
+   * @brief Return the cached value for hash, computing it on first request
+   * @param hash Content hash of the value
+   * @param compute Callable producing the value; invoked without any lock held
+   */
+  template <typename F>
+  V getOrCompute(uint64_t hash, F&& compute) {
+    Shard& shard = _shard(hash);
+    std::unique_lock lk{shard.m_mutex};
+    auto [search, inserted] = shard.m_map.emplace(hash, nullptr);
+    if (!inserted) {
+      std::shared_ptr<Entry> entry = search->second;
+      shard.m_cv.wait(lk, [&]() { return entry->m_value.has_value(); });
+      return *entry->m_value;
+    }
+    auto entry = std::make_shared<Entry>();
+    search->second = entry;
+    lk.unlock();
+
+    V value = compute();
+    lk.lock();
+    entry->m_value.emplace(value);
+    lk.unlock();
+    shard.m_cv.notify_all();
+    return value;
+  }
+
+  /** Return a copy of the completed value for hash, if any */
+  std::optional<V> find(uint64_t hash) {
+    Shard& shard = _shard(hash);
+    std::unique_lock lk{shard.m_mutex};
+    auto search = shard.m_map.find(hash);
+    if (search == shard.m_map.end())
+      return {};
+    return search->second->m_value;
+  }
+
+  /** True if hash is cached or currently being computed */
+  bool contains(uint64_t hash) {
+    Shard& shard = _shard(hash);
+    std::unique_lock lk{shard.m_mutex};
+    return shard.m_map.find(hash) != shard.m_map.end();
+  }
+
+  /** Store value for hash unless an entry already exists */
+  void insert(uint64_t hash, V&& value) {
+    Shard& shard = _shard(hash);
+    std::unique_lock lk{shard.m_mutex};
+    auto [search, inserted] = shard.m_map.emplace(hash, nullptr);
+    if (!inserted)
+      return;
+    search->second = std::make_shared<Entry>();
+    search->second->m_value.emplace(std::move(value));
+  }
+};
+
+} // namespace hecl
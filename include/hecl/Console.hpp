@@ -1,7 +1,12 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -57,11 +62,65 @@ public:
 
   enum class State { Closed, Closing, Opened, Opening };
 
+  /**
+   * @brief Fixed-capacity log of the most recent console lines
+   *
+   * Lines are copied into preallocated slots, truncated to LineLength, and the
+   * oldest are overwritten once Capacity is reached. Any number of threads may
+   * append concurrently without locking or allocating: each claims a slot
+   * with one atomic increment and publishes it through the slot's sequence
+   * number, which readers also use to skip slots rewritten mid-read.
+   */
+  class LogRing {
+  public:
+    static constexpr size_t Capacity = 4096;
+    static constexpr size_t LineLength = 240;
+
+  private:
+    struct Slot {
+      /* 2 * (index + 1) once line index is complete; odd while being written */
+      std::atomic<uint64_t> m_seq = 0;
+      Level m_level = Level::Info;
+      uint32_t m_len = 0;
+      char m_text[LineLength];
+    };
+    std::unique_ptr<Slot[]> m_slots;
+    std::atomic<uint64_t> m_head = 0;
+
+  public:
+    LogRing() : m_slots(new Slot[Capacity]) {}
+
+    /** Append the concatenation of parts as one line */
+    void append(Level level, std::string_view a, std::string_view b = {}, std::string_view c = {});
+
+    /** Number of lines currently retained */
+    size_t size() const { return size_t(std::min<uint64_t>(m_head.load(std::memory_order_acquire), Capacity)); }
+
+    /** Visit retained lines oldest first as f(std::string_view, Level) */
+    template <typename F>
+    void forEach(F&& f) const {
+      const uint64_t head = m_head.load(std::memory_order_acquire);
+      char text[LineLength];
+      for (uint64_t i = head > Capacity ? head - Capacity : 0; i < head; ++i) {
+        const Slot& slot = m_slots[i % Capacity];
+        const uint64_t seq = 2 * (i + 1);
+        if (slot.m_seq.load(std::memory_order_acquire) != seq)
+          continue;
+        const Level level = slot.m_level;
+        const uint32_t len = std::min<uint32_t>(slot.m_len, LineLength);
+        std::copy(slot.m_text, slot.m_text + len, text);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.m_seq.load(std::memory_order_relaxed) == seq)
+          f(std::string_view(text, len), level);
+      }
+    }
+  };
+
 private:
   CVarManager* m_cvarMgr = nullptr;
   boo::IWindow* m_window = nullptr;
   std::unordered_map<std::string, SConsoleCommand> m_commands;
-  std::vector<std::pair<std::string, Level>> m_log;
+  LogRing m_log;
   int m_logOffset = 0;
   std::string m_commandString;
   std::vector<std::string> m_commandHistory;
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "hecl/hecl.hpp"
+
+namespace hecl::Database {
+class IDataSpec;
+class Project;
+class RemoteCookStore;
+class CookedStore;
+class ExtractDedup;
+struct DataSpecEntry;
+
+/**
+ * @brief Persistent content-addressed record of completed cooks
+ *
+ * Each cooked artifact is keyed on a digest of its source bytes, its
+ * project-relative path and aux info, the DataSpec name, the fast flag and
+ * the digests of any dependencies reported by the DataSpec. Unchanged inputs are therefore recognized
+ * across checkouts and touches, where a plain modtime comparison would
+ * trigger a full recook. Extracted duplicates recorded by ExtractDedup are
+ * keyed on their canonical path, so they share one artifact with it.
+ *
+ * Digests are XXH3 for caches created with an xxHash that provides it and
+ * XXH64 otherwise; the journal header records which, so existing caches keep
+ * matching.
+ *
+ * The index lives in an append-only journal at .hecl/cookcache/index;
+ * copies of cooked artifacts are kept in .hecl/cookcache/objects so that
+ * switching back to a previously cooked revision restores without cooking.
+ * The object store only shrinks through collectGarbage().
+ *
+ * An optional RemoteCookStore extends the object store across machines:
+ * artifacts missing locally are fetched from it before cooking, and every
+ * completed cook is published to it. The store named by HECL_COOK_STORE is
+ * used unless replaced with setRemoteStore().
+ */
+class CookCache {
+  struct SourceEntry {
+    int64_t mtime;
+    uint64_t size;
+    uint64_t hash;
+  };
+
+  const Project& m_project;
+  CookedStore& m_store;
+  ExtractDedup& m_dedup;
+  std::mutex m_mutex;
+  bool m_loaded = false;
+  SystemString m_indexPath;
+  SystemString m_objectsPath;
+  UniqueFilePtr m_journal;
+  size_t m_journalRecords = 0;
+  std::unordered_map<uint64_t, SourceEntry> m_sources;
+  std::unordered_map<uint64_t, uint64_t> m_cooked;
+  std::shared_ptr<RemoteCookStore> m_remote;
+  bool m_publishHits = false;
+  /* Digest of source contents and keys; fixed per cache so recorded keys stay comparable */
+  HashAlgorithm m_hashAlgorithm = HashAlgorithm::XXH64;
+  std::unordered_set<uint64_t> m_claimedKeys;
+  std::condition_variable m_claimCv;
+
+  void _load();
+  void _compact();
+  void _appendRecord(uint32_t type, uint64_t a, uint64_t b, uint64_t c, uint64_t d);
+  HashAlgorithm _getHashAlgorithm();
+  uint64_t _hashFile(const SystemString& absPath);
+  uint64_t _hashSource(const ProjectPath& path);
+  SystemString _objectPath(uint64_t key) const;
+  bool _fetchRemote(const ProjectPath& cooked, uint64_t key);
+  void _publishHit(const ProjectPath& cooked, uint64_t key);
+  /* Write file's contents as the artifact of cooked, into the cooked store when enabled */
+  bool _place(const ProjectPath& cooked, const SystemString& file);
+  void _commitFile(const ProjectPath& cooked, const SystemString& file, const Hash& key);
+
+public:
+  /**
+   * @brief Serializes cooks of identical inputs
+   *
+   * Blocks while another thread holds a claim on the same key, so a path
+   * requested twice, e.g. as a dependency of several cooks, or extracted
+   * duplicates of one resource cook once and the others restore the artifact
+   * in isUpToDate(). Hold it across isUpToDate(), doCook and commit().
+   */
+  class KeyClaim {
+    CookCache& m_cache;
+    uint64_t m_key;
+
+  public:
+    KeyClaim(CookCache& cache, const Hash& key);
+    ~KeyClaim();
+    KeyClaim(const KeyClaim&) = delete;
+    KeyClaim& operator=(const KeyClaim&) = delete;
+  };
+
+  CookCache(const Project& project, CookedStore& store, ExtractDedup& dedup);
+  ~CookCache();
+
+  /** Replace the remote store consulted on local misses; nullptr disables sharing */
+  void setRemoteStore(std::shared_ptr<RemoteCookStore> remote);
+  bool hasRemoteStore();
+
+  /**
+   * @brief Also publish artifacts found up to date to the remote store
+   *
+   * Used by cook agents, whose coordinator expects every requested artifact in
+   * the store even when the agent had nothing to cook.
+   */
+  void setPublishHits(bool publish) {
+    std::unique_lock lk{m_mutex};
+    m_publishHits = publish;
+  }
+
+  /**
+   * @brief Compute the content key of a cook operation
+   * @param path Working source path (may be a glob or AudioGroup directory)
+   * @param spec DataSpec instance that will perform the cook
+   * @param specEntry DataSpec entry selected by IDataSpec::overrideDataSpec
+   * @param fast Draft cook flag
+   * @return Key to pass to isUpToDate() and commit()
+   *
+   * Source digests are memoized on (modtime, size); files are only re-read
+   * when their stat information changes.
+   */
+  Hash computeKey(const ProjectPath& path, IDataSpec& spec, const DataSpecEntry& specEntry, bool fast);
+
+  /**
+   * @brief Determine whether a cooked artifact matches the provided key
+   * @param path Working source path
+   * @param cooked Cooked artifact path
+   * @param key Key returned by computeKey()
+   * @return true if doCook may be skipped
+   *
+   * If the recorded key differs but an artifact with the requested key
+   * exists in the local or remote object store, it is copied into place and
+   * true is returned.
+   */
+  bool isUpToDate(const ProjectPath& path, const ProjectPath& cooked, const Hash& key);
+
+  /**
+   * @brief Record a completed cook and store a copy of its artifact
+   *
+   * The artifact is also published to the remote store, if any.
+   * @param cooked Cooked artifact path
+   * @param key Key returned by computeKey()
+   */
+  void commit(const ProjectPath& cooked, const Hash& key);
+
+  /**
+   * @brief Path doCook writes to in place of cooked
+   *
+   * Cooks only reach the cooked path through commitStaged(), so an
+   * interrupted cook or a dead blender leaves the previous artifact intact
+   * rather than a partial one. Paired with the journal, a rerun resumes with
+   * exactly the cooks that never committed.
+   */
+  static ProjectPath StagingPath(const ProjectPath& cooked);
+
+  /**
+   * @brief Rename the finished artifact at StagingPath(cooked) over cooked, then commit() it
+   *
+   * Does nothing if no artifact was staged, as after a failed cook.
+   */
+  void commitStaged(const ProjectPath& cooked, const Hash& key);
+
+  /**
+   * @brief Copy a draft artifact over a cooked path until its optimized cook finishes
+   *
+   * The copy replaces cooked atomically and is recorded under no key, so
+   * isUpToDate() never mistakes the draft for an optimized artifact.
+   * @param draft Artifact of a fast cook
+   * @param cooked Cooked artifact path of the full cook
+   * @return false if the draft couldn't be copied
+   */
+  bool publishDraft(const ProjectPath& draft, const ProjectPath& cooked);
+
+  /** Outcome of collectGarbage() */
+  struct GarbageStats {
+    size_t m_kept = 0;
+    uint64_t m_keptBytes = 0;
+    size_t m_removed = 0;
+    uint64_t m_removedBytes = 0;
+  };
+
+  /**
+   * @brief Bound the size of the object store
+   *
+   * Objects the journal records as the current artifact of a cooked path are
+   * always kept. The rest only serve switches back to older revisions; the
+   * least recently written or restored are deleted until the store fits.
+   * @param maxBytes Size to shrink the store to; 0 keeps only current artifacts
+   */
+  GarbageStats collectGarbage(uint64_t maxBytes);
+};
+
+} // namespace hecl::Database
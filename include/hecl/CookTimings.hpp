@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "hecl/hecl.hpp"
+
+namespace hecl::blender {
+class Connection;
+class Token;
+}
+
+namespace hecl::Database {
+class Project;
+struct DataSpecEntry;
+enum class Cost;
+
+/**
+ * @brief Persistent per-asset record of cook wall time, Blender time and memory
+ *
+ * Every cook performed by this process is appended to a journal at
+ * .hecl/cooktimes, tagged with a run number that increases with each process
+ * that cooks. The latest two samples of each path are retained, which is
+ * enough to list the slowest assets and regressions against the prior run.
+ *
+ * Historical wall times also replace the extension-based cost estimate when
+ * ClientProcess orders its queues.
+ */
+class CookTimings {
+public:
+  struct Sample {
+    uint32_t m_run = 0;
+    uint64_t m_wallNs = 0;
+    /** Time spent blocked on replies from Blender */
+    uint64_t m_blenderNs = 0;
+    /** Peak resident memory of the cook's Blender process, else of this process; KiB */
+    uint64_t m_peakRssKb = 0;
+  };
+
+  struct Entry {
+    /** Project-relative path including any aux info, UTF-8 */
+    std::string m_path;
+    std::string m_spec;
+    Sample m_last;
+    /** Sample of an earlier run; m_run is 0 if the path was only cooked once */
+    Sample m_previous;
+  };
+
+  /**
+   * @brief Measures one cook performed with a blender token
+   *
+   * Blender memory is measured from construction where the platform allows
+   * resetting a process's peak (Linux); elsewhere it is the process lifetime peak.
+   */
+  class Timer {
+    blender::Token& m_btok;
+    const blender::Connection* m_conn;
+    uint64_t m_begin;
+    uint64_t m_beginWaitNs;
+
+  public:
+    explicit Timer(blender::Token& btok);
+    Sample finish() const;
+  };
+
+private:
+  const Project& m_project;
+  std::mutex m_mutex;
+  bool m_loaded = false;
+  uint32_t m_run = 1;
+  SystemString m_journalPath;
+  UniqueFilePtr m_journal;
+  size_t m_journalRecords = 0;
+  std::unordered_map<uint64_t, Entry> m_entries;
+
+  void _load();
+  void _compact();
+  void _append(FILE* fp, const Entry& ent, const Sample& sample);
+  static void _addSample(Entry& ent, const Sample& sample);
+
+public:
+  explicit CookTimings(const Project& project);
+
+  /** Record a completed cook of path with spec in the current run */
+  void record(const ProjectPath& path, const DataSpecEntry& spec, Sample sample);
+
+  /** Cost class matching the last recorded wall time of path, if it was ever cooked */
+  std::optional<Cost> historicalCost(const ProjectPath& path);
+
+  /**
+   * Last recorded Blender peak of path in KiB, if it was ever cooked;
+   * 0 when that cook didn't use Blender
+   */
+  std::optional<uint64_t> historicalMemoryKb(const ProjectPath& path);
+
+  /** Copy of every recorded entry, in no particular order */
+  std::vector<Entry> snapshot();
+
+  /** Peak resident memory of this process in KiB; 0 if unavailable */
+  static uint64_t ProcessPeakRssKb();
+};
+
+} // namespace hecl::Database
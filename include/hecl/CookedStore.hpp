@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+#include "hecl/hecl.hpp"
+#include "hecl/MappedFile.hpp"
+
+namespace hecl::Database {
+class Project;
+
+/**
+ * @brief Optional single-file store for cooked artifacts
+ *
+ * Instead of one small file per getCookedPath(), committed cooks are
+ * appended to a log-structured pack at .hecl/cookedstore/pack, where later
+ * records of a path supersede earlier ones. An index snapshot written
+ * alongside covers the pack up to a recorded size; only records past it
+ * are scanned when the store opens. Reads are served from a memory mapping
+ * of the pack.
+ *
+ * Artifacts are looked up by their regular cooked path. A path lives in
+ * the pack or as a loose file, never both, and read() falls back to loose
+ * files, so tools that never enable the store keep working. The store is
+ * enabled per project and stays enabled while the pack exists.
+ *
+ * Several hecl processes may share a store. Writes hold an exclusive lock on
+ * .hecl/cookedstore/lock and first take in records other processes appended;
+ * reads only see those once this process next writes.
+ */
+class CookedStore {
+public:
+  /** Artifact bytes; keeps the mapping they point into alive */
+  struct View {
+    std::shared_ptr<const MappedFile> m_file;
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    explicit operator bool() const { return m_file != nullptr; }
+  };
+
+private:
+  struct Entry {
+    uint64_t m_recordOffset;
+    uint64_t m_size;
+    uint32_t m_pathLen;
+    uint64_t dataOffset() const;
+    uint64_t recordSize() const;
+  };
+
+  Project& m_project;
+  std::mutex m_mutex;
+  bool m_loaded = false;
+  SystemString m_packPath;
+  SystemString m_indexPath;
+  /* Locked across processes around every pack and index write */
+  UniqueFilePtr m_lockFile;
+  UniqueFilePtr m_pack;
+  uint64_t m_packSize = 0;
+  /* Bytes of superseded and removed records, reclaimed by compaction */
+  uint64_t m_deadSize = 0;
+  /* Keyed on a hash of the project-relative cooked path */
+  std::unordered_map<uint64_t, Entry> m_entries;
+  std::shared_ptr<const MappedFile> m_mapping;
+  bool m_indexDirty = false;
+
+  void _load();
+  void _scan(const MappedFile& pack, uint64_t begin);
+  void _truncateTail();
+  void _compact();
+  void _writeIndex();
+  bool _refresh();
+  bool _append(uint64_t pathHash, std::string_view relPath, const uint8_t* data, uint64_t size);
+  bool _entryMatches(const Entry& ent, std::string_view relPath);
+  std::shared_ptr<const MappedFile> _mappingCovering(uint64_t end);
+
+public:
+  explicit CookedStore(Project& project);
+  ~CookedStore();
+  CookedStore(const CookedStore&) = delete;
+  CookedStore& operator=(const CookedStore&) = delete;
+
+  bool isEnabled();
+  /**
+   * @brief Create or retire the pack
+   *
+   * Disabling writes every stored artifact back to its loose cooked path;
+   * Views of the pack must be released first.
+   */
+  void setEnabled(bool enabled);
+
+  /** Whether cooked is held in the pack; loose files are not considered */
+  bool contains(const ProjectPath& cooked);
+  /** Bytes of cooked from the pack, else from its loose file; empty if neither exists */
+  View read(const ProjectPath& cooked);
+  /**
+   * @brief Append the contents of file as the artifact of cooked, replacing any loose copy
+   * @return false if the store is disabled or file couldn't be read
+   */
+  bool put(const ProjectPath& cooked, const SystemString& file);
+  /** put() from memory, e.g. a View of another stored artifact */
+  bool put(const ProjectPath& cooked, const uint8_t* data, size_t size);
+  /** Drop cooked from the pack, e.g. before a loose copy is restored in its place */
+  void remove(const ProjectPath& cooked);
+};
+
+} // namespace hecl::Database
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace hecl {
+
+/** Placement of ClientProcess workers and the blender instances they spawn */
+enum class WorkerAffinity {
+  /** Leave scheduling to the OS */
+  None,
+  /** Restrict each worker to the processors of one NUMA node, spreading workers over nodes */
+  Node,
+  /** Pin each worker to a single logical processor, alternating nodes */
+  Core,
+};
+extern WorkerAffinity WorkerAffinityMode;
+
+/**
+ * @brief Logical processors available to this process, grouped by NUMA node
+ *
+ * Discovered once on first use. Systems without NUMA information report
+ * every available processor as a single node.
+ */
+class CpuTopology {
+  std::vector<std::vector<uint32_t>> m_nodes;
+  CpuTopology();
+
+public:
+  static const CpuTopology& Get();
+  const std::vector<std::vector<uint32_t>>& nodes() const { return m_nodes; }
+  /** Processors worker idx runs on under mode; empty for no restriction */
+  std::vector<uint32_t> workerProcessors(WorkerAffinity mode, size_t idx) const;
+};
+
+/** Restrict the calling thread to processors; false only if the OS rejects the set. A no-op returning true
+ *  for an empty set or on platforms without thread affinity */
+bool SetThreadAffinity(const std::vector<uint32_t>& processors);
+
+} // namespace hecl
@@ -5,10 +5,20 @@
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#include "hecl/AccessTrace.hpp"
+#include "hecl/BridgePathCache.hpp"
+#include "hecl/CookCache.hpp"
+#include "hecl/CookTimings.hpp"
+#include "hecl/CookedStore.hpp"
+#include "hecl/ExtractDedup.hpp"
+#include "hecl/StatCache.hpp"
+#include "hecl/TextureService.hpp"
 #include "hecl/hecl.hpp"
 
 #include <logvisor/logvisor.hpp>
@@ -17,6 +27,7 @@ namespace hecl {
 class ClientProcess;
 
 namespace Database {
+class ExtractContext;
 class Project;
 
 extern logvisor::Module LogModule;
@@ -33,6 +44,7 @@ public:
     class ObjectBase* projectObj;
     Node* sub;
     Node* next;
+    std::vector<Node*> deps; /**< Data nodes that must be cooked before this one */
   };
 
 private:
@@ -40,9 +52,18 @@ private:
   std::vector<Node> m_nodes;
 
 public:
-  const Node* getRootNode() const { return &m_nodes[0]; }
+  const Node* getRootNode() const { return m_nodes.empty() ? nullptr : &m_nodes[0]; }
+  const std::vector<Node>& getNodes() const { return m_nodes; }
 };
 
+/**
+ * @brief A rough description of how 'expensive' a given cook operation is
+ *
+ * This is used to provide pretty colors during the cook operation and to
+ * start the most expensive cooks first when cooking in parallel
+ */
+enum class Cost { None, Light, Medium, Heavy };
+
 /**
  * @brief Subclassed by dataspec entries to manage per-game aspects of the data pipeline
  *
@@ -91,6 +112,16 @@ public:
   virtual void doExtract([[maybe_unused]] const ExtractPassInfo& info,
                          [[maybe_unused]] const MultiProgressPrinter& progress) {}
 
+  /**
+   * @brief Extract with a shared worker pool
+   * @param info Extract pass being performed
+   * @param ctx Schedules per-PAK or per-resource jobs across the ClientProcess workers
+   *
+   * The default performs doExtract() on the calling thread. The caller waits
+   * for jobs still queued on ctx after this returns.
+   */
+  virtual void doParallelExtract(const ExtractPassInfo& info, ExtractContext& ctx);
+
   virtual bool canCook([[maybe_unused]] const ProjectPath& path, [[maybe_unused]] blender::Token& btok) {
     LogModule.report(logvisor::Error, FMT_STRING("not implemented"));
     return false;
@@ -103,6 +134,34 @@ public:
                       [[maybe_unused]] bool fast, [[maybe_unused]] blender::Token& btok,
                       [[maybe_unused]] FCookProgress progress) {}
 
+  /**
+   * @brief Report working files outside of path that influence its cooked output
+   * @param path Working source path about to be cooked
+   * @param depsOut Dependency paths to append to
+   *
+   * Digests of the reported paths become part of the path's cook cache key.
+   */
+  virtual void getCookDependencies([[maybe_unused]] const ProjectPath& path,
+                                   [[maybe_unused]] std::vector<ProjectPath>& depsOut) {}
+
+  /**
+   * @brief Version of this DataSpec's cooked formats
+   *
+   * Mixed into every cook cache key when non-zero; bump it when cook output
+   * changes for unchanged inputs so local and shared caches stop matching.
+   */
+  virtual uint32_t getCookVersion() const { return 0; }
+
+  /**
+   * @brief Estimate how expensive cooking path will be
+   * @param path Working source path about to be cooked
+   * @return Cost class used to order parallel cooks
+   *
+   * The default estimates by extension: .blend files are Heavy, images and
+   * directory-backed resources are Medium, everything else is Light.
+   */
+  virtual Cost getCookCost(const ProjectPath& path) const;
+
   virtual bool canPackage([[maybe_unused]] const ProjectPath& path) {
     return false;
   }
@@ -234,12 +293,31 @@ private:
   ProjectPath m_workRoot;
   ProjectPath m_dotPath;
   ProjectPath m_cookedRoot;
-  std::vector<ProjectDataSpec> m_compiledSpecs;
-  std::unordered_map<uint64_t, ProjectPath> m_bridgePathCache;
+  /* Built on first use; entries stay put once built so cooked-path references remain valid */
+  mutable std::vector<ProjectDataSpec> m_compiledSpecs;
+  mutable std::once_flag m_compiledSpecsOnce;
+  mutable bool m_specsScanned = false;
+  mutable BridgePathCache m_bridgePathCache;
   std::vector<std::unique_ptr<IDataSpec>> m_cookSpecs;
   std::unique_ptr<IDataSpec> m_lastPackageSpec;
+  /* One instance per packagePaths() thread; fixed while they run so interruptCook() needn't lock */
+  std::vector<std::unique_ptr<IDataSpec>> m_parallelPackageSpecs;
+  CookedStore m_cookedStore;
+  CookCache m_cookCache;
+  CookTimings m_cookTimings;
+  ExtractDedup m_extractDedup;
+  TextureService m_textureService;
+  AccessOrder m_packageAccessOrder;
+  mutable StatCache m_statCache;
   bool m_valid = false;
 
+  void _buildDataSpecs() const;
+  void _scanDataSpecs() const;
+  void _prepareCookSpecs(const DataSpecEntry* spec);
+  const DataSpecEntry* _selectPackageSpec(const DataSpecEntry* spec) const;
+  PackageDepsgraph _buildDepsgraph(const ProjectPath& path, bool recursive,
+                                   std::vector<std::vector<IDataSpec*>>* nodeSpecs, bool expandWorlds = false);
+
 public:
   Project(const ProjectRootPath& rootPath);
   explicit operator bool() const { return m_valid; }
@@ -249,17 +327,37 @@ public:
    *
    * Holds a path to a line-delimited textual configuration file;
    * opening a locked handle for read/write transactions
+   *
+   * Commits replace the file by rename, so read-only callers never need the
+   * lock: they get an immutable snapshot, cached until the file's modtime or
+   * size changes.
    */
   class ConfigFile {
+  public:
+    struct Snapshot {
+      std::vector<std::string> lines;
+      /* Views into lines */
+      std::unordered_set<std::string_view> lineSet;
+      bool contains(std::string_view line) const { return lineSet.find(line) != lineSet.end(); }
+    };
+
+  private:
     SystemString m_filepath;
     std::vector<std::string> m_lines;
     UniqueFilePtr m_lockedFile;
+    mutable std::mutex m_snapshotMutex;
+    mutable std::shared_ptr<const Snapshot> m_snapshot;
+    mutable int64_t m_snapshotMtime = 0;
+    mutable uint64_t m_snapshotSize = 0;
 
   public:
     ConfigFile(const Project& project, SystemStringView name, SystemStringView subdir = _SYS_STR("/.hecl/"));
     std::vector<std::string>& lockAndRead();
+    /** Current contents without taking the file lock; safe to call from any thread */
+    std::shared_ptr<const Snapshot> read() const;
     void addLine(std::string_view line);
     void removeLine(std::string_view refLine);
+    /** Within a locked transaction, checks its pending lines; otherwise checks read() */
     bool checkForLine(std::string_view refLine) const;
     void unlockAndDiscard();
     bool unlockAndCommit();
@@ -268,12 +366,7 @@ public:
   ConfigFile m_paths;
   ConfigFile m_groups;
 
-  /**
-   * @brief A rough description of how 'expensive' a given cook operation is
-   *
-   * This is used to provide pretty colors during the cook operation
-   */
-  enum class Cost { None, Light, Medium, Heavy };
+  using Cost = Database::Cost;
 
   /**
    * @brief Get the path of the project's root-directory
@@ -298,6 +391,51 @@ public:
    */
   const ProjectPath& getProjectCookedPath(const DataSpecEntry& spec) const;
 
+  /**
+   * @brief Get the content-addressed cache of completed cooks
+   * @return project cook cache
+   */
+  CookCache& getCookCache() { return m_cookCache; }
+
+  /**
+   * @brief Get the optional single-file store of cooked artifacts
+   * @return project cooked store
+   */
+  CookedStore& getCookedStore() { return m_cookedStore; }
+
+  /**
+   * @brief Get the captured access order packaging lays resources out by
+   * @return project package access order; empty unless loaded
+   *
+   * DataSpecs consult it in doPackage() to place the resources of each
+   * package in the order a captured run first requested them.
+   */
+  AccessOrder& getPackageAccessOrder() { return m_packageAccessOrder; }
+
+  /**
+   * @brief Get the per-asset history of cook times
+   * @return project cook timings
+   */
+  CookTimings& getCookTimings() { return m_cookTimings; }
+
+  /**
+   * @brief Get the content-addressed writer for extracted resources
+   * @return project extract deduplicator
+   */
+  ExtractDedup& getExtractDedup() { return m_extractDedup; }
+
+  /**
+   * @brief Get the shared PNG converter and its content-addressed cache
+   * @return project texture service
+   */
+  TextureService& getTextureService() { return m_textureService; }
+
+  /**
+   * @brief Get the filesystem metadata cache consulted by this project's paths
+   * @return project stat cache; disabled unless a cook enables it
+   */
+  StatCache& getStatCache() const { return m_statCache; }
+
   /**
    * @brief Add given file(s) to the database
    * @param paths files or patterns within project
@@ -346,6 +484,9 @@ public:
    *
    * Call periodically in a long-term use of the hecl::Database::Project class.
    * Install filesystem event-hooks if possible.
+   *
+   * Otherwise the preferences are read once, on the first getDataSpecs() call,
+   * and kept for the lifetime of the Project.
    */
   void rescanDataSpecs();
 
@@ -353,7 +494,7 @@ public:
    * @brief Return map populated with dataspecs targetable by this project interface
    * @return Platform map with name-string keys and enable-status values
    */
-  const std::vector<ProjectDataSpec>& getDataSpecs() const { return m_compiledSpecs; }
+  const std::vector<ProjectDataSpec>& getDataSpecs() const;
 
   /**
    * @brief Enable persistent user preference for particular spec string(s)
@@ -382,6 +523,10 @@ public:
    * Object cooking is generally an expensive process for large projects.
    * This method blocks execution during the procedure, with periodic
    * feedback delivered via feedbackCb.
+   *
+   * When cp is provided, a depsgraph of the path is built first and cooks are
+   * submitted in topological order; each object is queued as soon as its own
+   * dependencies finish cooking.
    */
   bool cookPath(const ProjectPath& path, const MultiProgressPrinter& feedbackCb, bool recursive = false,
                 bool force = false, bool fast = false, const DataSpecEntry* spec = nullptr,
@@ -398,6 +543,22 @@ public:
   bool packagePath(const ProjectPath& path, const MultiProgressPrinter& feedbackCb, bool fast = false,
                    const DataSpecEntry* spec = nullptr, ClientProcess* cp = nullptr);
 
+  /**
+   * @brief Package several independent !world.blend files or directories concurrently
+   * @param paths Paths as accepted by packagePath()
+   * @param feedbackCb a callback to run reporting cook-progress
+   * @param fast enables faster (draft) extraction for supported data types
+   * @param spec if non-null, cook using a manually-selected dataspec
+   * @param cp if non-null, cook dependencies asynchronously via the shared ClientProcess
+   * @param concurrency Maximum number of packages built at once
+   * @return false if any path could not be packaged
+   *
+   * Each packaging thread gets its own DataSpec instance and blender token, so
+   * the DataSpec must support concurrent doPackage() calls on separate instances.
+   */
+  bool packagePaths(const std::vector<ProjectPath>& paths, const MultiProgressPrinter& feedbackCb, bool fast,
+                    const DataSpecEntry* spec, ClientProcess* cp, size_t concurrency);
+
   /**
    * @brief Interrupts a cook in progress (call from SIGINT handler)
    *
@@ -428,6 +589,15 @@ public:
    */
   PackageDepsgraph buildPackageDepsgraph(const ProjectPath& path);
 
+  /**
+   * @brief Gather the paths a cook of a single path depends on
+   * @param path Working path to query
+   * @param depsOut Receives the dependencies reported by each DataSpec able to cook path
+   * @param spec if non-null, query only this DataSpec
+   */
+  void getCookDependencies(const ProjectPath& path, std::vector<ProjectPath>& depsOut,
+                           const DataSpecEntry* spec = nullptr);
+
   /** Add ProjectPath to bridge cache */
   void addBridgePathToCache(uint64_t id, const ProjectPath& path);
 
@@ -436,6 +606,12 @@ public:
 
   /** Lookup ProjectPath from bridge cache */
   const ProjectPath* lookupBridgePath(uint64_t id) const;
+
+  /** Number of IDs in the bridge cache, including those persisted by earlier invocations */
+  size_t getBridgePathCacheSize() const;
+
+  /** Persist bridge cache changes to .hecl/bridgecache; also done on destruction */
+  void saveBridgePathCache();
 };
 
 } // namespace Database
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "hecl/SystemChar.hpp"
+
+namespace hecl {
+class StatCache;
+
+/**
+ * @brief Recursive directory scan spread across worker threads
+ *
+ * Subdirectories are handed to idle workers as soon as they are found, so
+ * the round trips of many directory listings overlap instead of adding up;
+ * on network-mounted project roots, latency rather than bandwidth dominates.
+ *
+ * The result is one flat vector in which the children of each directory are
+ * contiguous and follow their parent. Path strings are packed into arena
+ * blocks owned by the walker rather than allocated per entry.
+ */
+class DirectoryWalker {
+public:
+  static constexpr uint32_t NoEntry = UINT32_MAX;
+
+  struct Entry {
+    /* Absolute path, null-terminated */
+    SystemStringView m_path;
+    /* Final component of m_path */
+    SystemStringView m_name;
+    uint64_t m_fileSz = 0;
+    /* Containing directory, or NoEntry directly beneath the root */
+    uint32_t m_parent = NoEntry;
+    /* Children of a directory occupy [m_firstChild, m_firstChild + m_childCount) */
+    uint32_t m_firstChild = 0;
+    uint32_t m_childCount = 0;
+    bool m_isDir = false;
+  };
+
+private:
+  std::vector<std::unique_ptr<SystemChar[]>> m_arena;
+  std::vector<Entry> m_entries;
+  uint32_t m_rootChildCount = 0;
+
+public:
+  /**
+   * @param root Directory to scan
+   * @param recursive Descend into subdirectories; otherwise only root is listed
+   * @param sorted Order each directory's children as DirectoryEnumerator::Mode::DirsThenFilesSorted would;
+   *        otherwise they keep the order the filesystem reports
+   * @param noHidden Skip entries named with a leading '.' (and hidden entries on Windows)
+   * @param statCache When given, metadata of every entry is recorded into this cache
+   * @param threadCount Number of workers including the calling thread, 0 for one per CPU
+   */
+  explicit DirectoryWalker(SystemStringView root, bool recursive = true, bool sorted = true, bool noHidden = true,
+                           StatCache* statCache = nullptr, size_t threadCount = 0);
+  DirectoryWalker(const DirectoryWalker&) = delete;
+  DirectoryWalker& operator=(const DirectoryWalker&) = delete;
+  DirectoryWalker(DirectoryWalker&&) = default;
+  DirectoryWalker& operator=(DirectoryWalker&&) = default;
+
+  const std::vector<Entry>& entries() const { return m_entries; }
+
+  /** Children of the directory entry at index dir, or of the root for NoEntry */
+  std::span<const Entry> children(uint32_t dir = NoEntry) const {
+    if (dir == NoEntry)
+      return {m_entries.data(), m_rootChildCount};
+    const Entry& ent = m_entries[dir];
+    return {m_entries.data() + ent.m_firstChild, ent.m_childCount};
+  }
+
+  /** Index of an entry obtained from entries() or children() */
+  uint32_t indexOf(const Entry& ent) const { return uint32_t(&ent - m_entries.data()); }
+};
+
+} // namespace hecl
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "hecl/Database.hpp"
+#include "hecl/SystemChar.hpp"
+
+namespace hecl {
+class ClientProcess;
+class MultiProgressPrinter;
+} // namespace hecl
+
+namespace hecl::Database {
+
+/**
+ * @brief Worker pool and progress reporting handed to IDataSpec::doParallelExtract
+ *
+ * Jobs run on the ClientProcess workers, each with that worker's blender
+ * token, so Blender-backed imports proceed on several connections at once.
+ * Jobs are grouped for progress display, typically one group per
+ * ExtractReport (i.e. per PAK); each completion advances its group's line and
+ * the overall factor.
+ *
+ * Jobs may add further jobs, e.g. a PAK job queueing one job per resource.
+ */
+class ExtractContext {
+public:
+  using FJob = std::function<void(blender::Token& btok)>;
+
+private:
+  struct Group {
+    SystemString m_name;
+    std::atomic_size_t m_total = 0;
+    std::atomic_size_t m_done = 0;
+  };
+
+  ClientProcess& m_cp;
+  IDataSpec& m_spec;
+  const MultiProgressPrinter& m_progress;
+  std::mutex m_groupMutex;
+  std::vector<std::unique_ptr<Group>> m_groups;
+  std::atomic_size_t m_totalJobs = 0;
+  std::atomic_size_t m_doneJobs = 0;
+
+public:
+  ExtractContext(ClientProcess& cp, IDataSpec& spec, const MultiProgressPrinter& progress)
+  : m_cp(cp), m_spec(spec), m_progress(progress) {}
+  ExtractContext(const ExtractContext&) = delete;
+  ExtractContext& operator=(const ExtractContext&) = delete;
+
+  ClientProcess& getClientProcess() const { return m_cp; }
+  const MultiProgressPrinter& getProgress() const { return m_progress; }
+
+  /** Start a progress group named after e.g. an ExtractReport; returns its index */
+  size_t addGroup(SystemStringView name);
+
+  /**
+   * @brief Queue job on the worker pool
+   * @param group Index returned by addGroup()
+   * @param resName Shown beside the group's name once the job completes
+   * @param cost Heavier jobs start first, as with cooks
+   */
+  void addJob(size_t group, SystemStringView resName, FJob&& job, Cost cost = Cost::Light);
+
+  /** Block until every queued job, including jobs queued by jobs, has finished */
+  void waitUntilComplete();
+};
+
+} // namespace hecl::Database
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "hecl/hecl.hpp"
+
+namespace hecl::Database {
+class Project;
+
+/**
+ * @brief Content-addressed writer for extracted resources
+ *
+ * Decoded output is hashed with hecl::Hash before it is written. The first
+ * path to produce given bytes becomes the canonical copy; later paths with
+ * identical bytes are hardlinked to it instead of written, or receive a
+ * plain copy on filesystems without hardlinks.
+ *
+ * Canonical and duplicate paths are recorded in .hecl/extractdedup, so
+ * DataSpecs resolving resources by ID may point duplicates at one working
+ * file via Project::addBridgePathToCache(). Duplicates share a cook cache
+ * key with their canonical copy, so only one of them is ever cooked; the
+ * rest restore the cook cache artifact.
+ */
+class ExtractDedup {
+  struct ContentKey {
+    uint64_t m_hash;
+    uint64_t m_size;
+    bool operator==(const ContentKey& other) const { return m_hash == other.m_hash && m_size == other.m_size; }
+  };
+  struct ContentKeyHash {
+    size_t operator()(const ContentKey& key) const { return size_t(key.m_hash ^ key.m_size); }
+  };
+
+  Project& m_project;
+  std::mutex m_mutex;
+  std::condition_variable m_pendingCv;
+  bool m_loaded = false;
+  SystemString m_journalPath;
+  UniqueFilePtr m_journal;
+  size_t m_journalRecords = 0;
+  /* Project-relative UTF-8 paths */
+  std::unordered_map<ContentKey, std::string, ContentKeyHash> m_canonical;
+  std::unordered_map<std::string, std::string> m_duplicates;
+  /* Canonical paths whose bytes are still being written */
+  std::unordered_set<std::string> m_pending;
+  uint64_t m_dedupedBytes = 0;
+
+  void _load();
+  void _compact();
+  void _append(FILE* fp, const ContentKey& key, std::string_view path, std::string_view canonical);
+
+public:
+  explicit ExtractDedup(Project& project);
+
+  /**
+   * @brief Write extracted bytes to path, linking to an identical earlier resource if there is one
+   * @return false if the file could not be written
+   */
+  bool write(const ProjectPath& path, const void* data, size_t len);
+
+  /** Path whose bytes path was deduplicated against, else path itself */
+  ProjectPath getCanonicalPath(const ProjectPath& path);
+
+  /** Bytes not written by this process due to deduplication */
+  uint64_t getDedupedBytes();
+};
+
+} // namespace hecl::Database
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+#include "hecl/SystemChar.hpp"
+
+namespace hecl {
+
+/**
+ * @brief Recursive change notification for a directory tree
+ *
+ * Backed by inotify on Linux, FSEvents on macOS and ReadDirectoryChangesW
+ * on Windows. Entries with a leading '.' anywhere in their path (such as the
+ * project's .hecl directory, where cooked output lands) are ignored, so
+ * writing cooked artifacts never retriggers the watch.
+ */
+class FileWatcher {
+public:
+  struct Backend;
+
+private:
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::unordered_set<SystemString> m_changed;
+  bool m_stopped = false;
+  std::unique_ptr<Backend> m_backend;
+
+public:
+  explicit FileWatcher(SystemStringView root);
+  ~FileWatcher();
+  FileWatcher(const FileWatcher&) = delete;
+  FileWatcher& operator=(const FileWatcher&) = delete;
+
+  /** False if the platform facility could not be set up */
+  explicit operator bool() const { return m_backend != nullptr; }
+
+  /**
+   * @brief Block until something changes, then gather the changes
+   * @param changedOut Receives absolute paths of created, modified, moved or deleted entries
+   * @param settle Keep collecting until no further change arrives for this long,
+   *        so a save touching several files is reported as one batch
+   * @return false once stop() was called
+   */
+  bool waitForChanges(std::vector<SystemString>& changedOut,
+                      std::chrono::milliseconds settle = std::chrono::milliseconds(100));
+
+  /** Wake waitForChanges() and make it return false; safe from any thread */
+  void stop();
+
+  /* Called by the backend from its notification thread */
+  void _notify(SystemString&& absPath);
+};
+
+} // namespace hecl
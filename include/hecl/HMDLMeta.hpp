@@ -9,7 +9,16 @@ enum class HMDLTopology : atUint32 {
   TriStrips,
 };
 
-#define HECL_HMDL_META_SZ 32
+/** Storage of a vertex attribute within the HMDL VBO */
+enum class HMDLAttrFormat : atUint8 {
+  Float32, /**< Native float components (all attributes) */
+  Unorm16, /**< Positions relative to posOffset/posScale (padded to 4 components), or UVs in [0,1] */
+  Oct16,   /**< Normals as octahedral-encoded snorm16x2; tangents add a snorm16 sign and pad */
+  Half16,  /**< UVs as IEEE half floats */
+  Unorm8,  /**< Weight vectors as unorm8x4 */
+};
+
+#define HECL_HMDL_META_SZ 76
 
 struct HMDLMeta : athena::io::DNA<athena::Endian::Big> {
   AT_DECL_DNA
@@ -22,6 +31,33 @@ struct HMDLMeta : athena::io::DNA<athena::Endian::Big> {
   Value<atUint32> uvCount;
   Value<atUint16> weightCount;
   Value<atUint16> bankCount;
+  Value<HMDLAttrFormat> posFormat = HMDLAttrFormat::Float32;
+  Value<HMDLAttrFormat> normFormat = HMDLAttrFormat::Float32;
+  Value<HMDLAttrFormat> uvFormat = HMDLAttrFormat::Float32;
+  Value<HMDLAttrFormat> weightFormat = HMDLAttrFormat::Float32;
+  Value<atVec3f> posOffset;
+  Value<atVec3f> posScale;
+  Value<atUint32> indexSize = 4; /**< Bytes per IBO index; 2-byte buffers restart on 0xffff */
+  Value<atUint32> clusterCount = 0; /**< Number of HMDLCluster records emitted with the buffers */
+  Value<atUint32> lodCount = 0; /**< Number of simplified levels following the full-detail surfaces */
+  Value<atUint32> tangentCount = 0; /**< 1 when a tangent (bitangent sign in w) follows the normal, per normFormat */
+};
+
+/**
+ * @brief Culling bounds of one clustered IBO range
+ *
+ * A cluster may be skipped when its sphere is outside the frustum, or when
+ * dot(center - eye, coneAxis) >= coneCutoff * length(center - eye) + radius
+ * (all of its triangles face away). A coneCutoff of 1 disables the cone test.
+ */
+struct HMDLCluster : athena::io::DNA<athena::Endian::Big> {
+  AT_DECL_DNA
+  Value<atUint32> indexStart;
+  Value<atUint32> indexCount;
+  Value<atVec3f> sphereCenter;
+  Value<float> sphereRadius;
+  Value<atVec3f> coneAxis;
+  Value<float> coneCutoff;
 };
 
 } // namespace hecl
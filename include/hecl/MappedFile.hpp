@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "hecl/SystemChar.hpp"
+
+namespace hecl {
+
+/**
+ * @brief Read-only memory mapping of an entire file
+ *
+ * Pages are faulted in on access straight from the OS file cache,
+ * so large blobs may be consumed without an intermediate heap copy.
+ */
+class MappedFile {
+  const uint8_t* m_data = nullptr;
+  std::size_t m_size = 0;
+#if _WIN32
+  void* m_mapping = nullptr;
+#endif
+
+  void _unmap();
+
+public:
+  MappedFile() = default;
+  explicit MappedFile(const SystemChar* path) { open(path); }
+  ~MappedFile() { _unmap(); }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile(MappedFile&& other) noexcept
+  : m_data(std::exchange(other.m_data, nullptr))
+  , m_size(std::exchange(other.m_size, 0))
+#if _WIN32
+  , m_mapping(std::exchange(other.m_mapping, nullptr))
+#endif
+  {
+  }
+  MappedFile& operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+      _unmap();
+      m_data = std::exchange(other.m_data, nullptr);
+      m_size = std::exchange(other.m_size, 0);
+#if _WIN32
+      m_mapping = std::exchange(other.m_mapping, nullptr);
+#endif
+    }
+    return *this;
+  }
+
+  /**
+   * @brief Map the file at path, replacing any existing mapping
+   * @param path Absolute path of file to map
+   * @return true if the file exists, is non-empty and was mapped
+   */
+  bool open(const SystemChar* path);
+  void close() { _unmap(); }
+
+  const uint8_t* data() const { return m_data; }
+  std::size_t size() const { return m_size; }
+  explicit operator bool() const { return m_data != nullptr; }
+};
+
+} // namespace hecl
@@ -1,6 +1,11 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <vector>
@@ -16,9 +21,23 @@
 
 namespace hecl {
 
+/**
+ * @brief Terminal progress display shared by cook and package workers
+ *
+ * Workers only update their thread's status slot; drawing happens on a
+ * dedicated thread at a capped frame rate, and redraws only the
+ * lines that changed since the previous frame. flush() requests a frame
+ * without waiting for it.
+ */
 class MultiProgressPrinter {
+public:
+  using SummaryFunc = std::function<hecl::SystemString()>;
+
+private:
   std::thread m_logThread;
+  /* Held by the log thread while drawing */
   mutable std::mutex m_logLock;
+  mutable std::condition_variable m_logCv;
   bool m_newLineAfter;
 
   struct TermInfo {
@@ -30,26 +49,50 @@ class MultiProgressPrinter {
     bool truncate = false;
   } m_termInfo;
 
-  struct ThreadStat {
+  /* Copy of one thread's status as drawn, compared against the next frame to skip unchanged lines */
+  struct ThreadLine {
     hecl::SystemString m_message, m_submessage;
     float m_factor = 0.f;
-    bool m_active = false;
+    bool operator==(const ThreadLine& other) const {
+      return m_factor == other.m_factor && m_message == other.m_message && m_submessage == other.m_submessage;
+    }
     void print(const TermInfo& tinfo) const;
   };
-  mutable std::vector<ThreadStat> m_threadStats;
 
-  mutable float m_mainFactor = -1.f;
-  mutable int m_indeterminateCounter = 0;
-  mutable int m_curThreadLines = 0;
-  mutable int m_curProgLines = 0;
-  mutable int m_latestThread = -1;
-  mutable bool m_running = false;
-  mutable bool m_dirty = false;
-  mutable bool m_mainIndeterminate = false;
+  /* Status slot written by one worker; the lock is only contended by the log thread's snapshot */
+  struct ThreadStat {
+    std::mutex m_lock;
+    ThreadLine m_line;
+    bool m_active = false;
+  };
+  static constexpr int MaxThreadStats = 256;
+  std::unique_ptr<ThreadStat[]> m_threadStats;
+  mutable std::atomic_int m_threadStatCount = 0;
+
+  /* Owned by the log thread */
+  std::vector<ThreadLine> m_drawnLines;
+  std::vector<ThreadLine> m_frameLines;
+  float m_drawnMainFactor = -1.f;
+  int m_drawnWidth = 0;
+  /* Guarded by m_logLock; the line is drawn below the thread lines, without a bar */
+  mutable SummaryFunc m_summaryFunc;
+  mutable std::chrono::milliseconds m_summaryInterval{0};
+  mutable ThreadLine m_summaryLine;
+  mutable std::chrono::steady_clock::time_point m_lastSummary;
+
+  mutable std::atomic<float> m_mainFactor = -1.f;
+  int m_indeterminateCounter = 0;
+  int m_curThreadLines = 0;
+  int m_curProgLines = 0;
+  mutable std::atomic_int m_latestThread = -1;
+  std::atomic_bool m_running = false;
+  mutable std::atomic_bool m_dirty = false;
+  mutable std::atomic_bool m_mainIndeterminate = false;
   uint64_t m_lastLogCounter = 0;
   void LogProc();
   void DoPrint();
   void DrawIndeterminateBar();
+  void DrawMainBar();
   void MoveCursorUp(int n);
 
 public:
@@ -59,6 +102,13 @@ public:
              int threadIdx = 0) const;
   void setMainFactor(float factor) const;
   void setMainIndeterminate(bool indeterminate) const;
+  /**
+   * @brief Show a status line below the worker lines, refreshed from func every interval
+   *
+   * func runs on the drawing thread and must not report back into this printer.
+   * Only drawn in multi-line mode; an empty func removes the line.
+   */
+  void setSummary(SummaryFunc func, std::chrono::milliseconds interval = std::chrono::seconds(1)) const;
   void startNewLine() const;
   void flush() const;
 };
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "hecl/SystemChar.hpp"
+
+namespace hecl::Database {
+
+/**
+ * @brief Positioned, thread-safe writer for package output files
+ *
+ * Output goes to a sibling .part file which is preallocated to the expected
+ * package size and renamed over the destination by finish(). Every write
+ * carries its own offset, so any number of threads may fill disjoint regions
+ * concurrently without seeking; regions can be claimed with reserve().
+ *
+ * copyFrom() moves bytes of an already cooked (and already compressed)
+ * resource inside the kernel where the platform allows it (copy_file_range),
+ * falling back to large buffered reads otherwise.
+ */
+class PackageWriter {
+public:
+  struct Segment {
+    const void* m_data;
+    size_t m_len;
+  };
+
+private:
+  SystemString m_path;
+  SystemString m_partPath;
+#if _WIN32
+  void* m_handle = nullptr;
+#else
+  int m_fd = -1;
+#endif
+  std::atomic_uint64_t m_reserved = 0;
+  std::atomic_uint64_t m_end = 0;
+  std::atomic_bool m_failed = false;
+
+  void _close();
+  bool _fail(const SystemChar* op);
+  void _extend(uint64_t end);
+
+public:
+  /**
+   * @brief Create package output at path
+   * @param expectedSize Bytes to preallocate; 0 for none. Exceeding it is allowed.
+   */
+  explicit PackageWriter(SystemStringView path, uint64_t expectedSize = 0);
+  ~PackageWriter();
+  PackageWriter(const PackageWriter&) = delete;
+  PackageWriter& operator=(const PackageWriter&) = delete;
+
+  /** False if the file couldn't be created or any write has failed */
+  explicit operator bool() const;
+
+  /** Atomically claim size bytes at the next multiple of alignment; returns the offset */
+  uint64_t reserve(uint64_t size, uint64_t alignment = 1);
+
+  /** Write len bytes at offset */
+  bool write(uint64_t offset, const void* data, size_t len);
+
+  /** Write segments back to back starting at offset in as few system calls as possible */
+  bool write(uint64_t offset, const Segment* segs, size_t count);
+
+  /** Copy len bytes of the file at srcPath from srcOffset to offset */
+  bool copyFrom(SystemStringView srcPath, uint64_t srcOffset, uint64_t len, uint64_t offset);
+
+  /** One past the highest byte written so far */
+  uint64_t size() const { return m_end.load(); }
+
+  /**
+   * @brief Trim the file to size(), flush, and rename it over the destination
+   *
+   * Without a successful finish() the partial output is deleted on destruction.
+   */
+  bool finish();
+};
+
+} // namespace hecl::Database
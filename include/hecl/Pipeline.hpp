@@ -1,13 +1,22 @@
 #pragma once
 
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
 #include <cstdint>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
+#include "hecl/ConcurrentCache.hpp"
 #include "hecl/hecl.hpp"
 #include "hecl/PipelineBase.hpp"
+#include "hecl/PipelineStats.hpp"
 
 #include <boo/BooObject.hpp>
 #include <boo/graphicsdev/IGraphicsDataFactory.hpp>
@@ -153,6 +162,64 @@ SPECIALIZE_OFFLINE_PLATFORM(hecl::PlatformType::NX)
 
 class ShaderCacheZipStream;
 
+/**
+ * @brief Append-only shader binary cache with random access
+ *
+ * Each record holds one stage binary, zlib-compressed on its own and keyed
+ * on (stage, hash). Opening the file only walks the record headers to build
+ * the index; binaries are read and inflated the first time they are
+ * requested, and newly compiled binaries are appended in place.
+ */
+class ShaderCacheFile {
+  struct Entry {
+    uint64_t m_offset;
+    uint32_t m_compSize;
+    uint32_t m_rawSize;
+    uint32_t m_checksum;
+  };
+  std::mutex m_mutex;
+  UniqueFilePtr m_fp;
+  SystemString m_path;
+  uint64_t m_end = 0;
+  std::unordered_map<uint64_t, Entry> m_index[6];
+
+public:
+  using KeepFunc = std::function<bool(boo::PipelineStage stage, uint64_t hash)>;
+
+  /** Open or create the cache file at path */
+  bool open(const SystemChar* path);
+  bool isOpen() const { return m_fp.operator bool(); }
+  /** Inflate the binary stored for (stage, hash), if present and intact */
+  std::optional<std::pair<StageBinaryData, size_t>> read(boo::PipelineStage stage, uint64_t hash);
+  /** Compress and append a binary unless (stage, hash) is already stored */
+  void append(boo::PipelineStage stage, uint64_t hash, const uint8_t* data, size_t size);
+  /**
+   * @brief Rewrite the file with only the binaries keep accepts
+   * @param removed Receives the number of binaries dropped
+   * @return false if the file couldn't be rewritten; it is then left as it was
+   *
+   * Records are copied without being inflated. Used to trim a cache down to
+   * the stages a recorded play session actually requested.
+   */
+  bool prune(const KeepFunc& keep, size_t& removed);
+};
+
+/**
+ * @brief Stage compiles gathered by PipelineConverterBase::convertBatch
+ *
+ * Compile jobs only produce StageBinary objects and may run concurrently;
+ * insert jobs then populate the stage caches on the transaction thread.
+ */
+struct StageCompileBatch {
+  using ProgressFunc = std::function<void(size_t completed, size_t total)>;
+  std::vector<std::function<void()>> m_compiles;
+  std::vector<std::function<void()>> m_inserts;
+  std::unordered_set<uint64_t> m_queued[6];
+
+  /** Runs compile jobs (on worker threads if parallel), then insert jobs in order */
+  void run(bool parallel, const ProgressFunc& progress);
+};
+
 template <typename P, typename S>
 class StageConverter {
   friend class PipelineConverter<P>;
@@ -161,7 +228,8 @@ class StageConverter {
 #else
   using StageTargetTp = StageBinary<P, S>;
 #endif
-  std::unordered_map<uint64_t, StageTargetTp> m_stageCache;
+  ConcurrentCache<StageTargetTp> m_stageCache;
+  ShaderCacheFile* m_cacheFile = nullptr;
 
 #if 0 /* Horrible compiler memory explosion - DO NOT USE! */
     template <typename ToTp, typename FromTp>
@@ -304,30 +372,142 @@ public:
   StageTargetTp convert(FactoryCtx& ctx, const FromTp& in) {
     if constexpr (FromTp::HasStageHash) {
       uint64_t hash = in.template StageHash<S>();
-      auto search = m_stageCache.find(hash);
-      if (search != m_stageCache.end())
-        return search->second;
-      return m_stageCache.insert(std::make_pair(hash, Do<StageTargetTp>(ctx, in))).first->second;
+      PipelineStats::LookupTimer timer(size_t(S::Enum), hash);
+      return m_stageCache.getOrCompute(hash, [&]() {
+        timer.miss();
+#if HECL_RUNTIME
+        if (m_cacheFile)
+          return Do<StageTargetTp>(ctx, binary(ctx, in, hash));
+#endif
+        return Do<StageTargetTp>(ctx, in);
+      });
     }
     return Do<StageTargetTp>(ctx, in);
   }
+
+#if HECL_RUNTIME
+  /* Binary of in from the attached cache file, compiling and appending it on a miss */
+  template <class FromTp>
+  StageBinary<P, S> binary(FactoryCtx& ctx, const FromTp& in, uint64_t hash) {
+    if (m_cacheFile) {
+      auto data = m_cacheFile->read(S::Enum, hash);
+      PipelineStats::RecordCacheFile(size_t(S::Enum), data.has_value());
+      if (data)
+        return StageBinary<P, S>(std::move(data->first), data->second);
+    }
+    StageBinary<P, S> ret = Do<StageBinary<P, S>>(ctx, in);
+    if (m_cacheFile)
+      m_cacheFile->append(S::Enum, hash, ret.data(), ret.size());
+    return ret;
+  }
+
+  /* Queue a compile of this stage of in, unless it is already cached or queued */
+  template <class FromTp>
+  void queueCompile(FactoryCtx& ctx, const FromTp& in, StageCompileBatch& batch) {
+    if constexpr (FromTp::HasStageHash) {
+      const uint64_t hash = in.template StageHash<S>();
+      if (m_stageCache.contains(hash) || !batch.m_queued[int(S::Enum)].insert(hash).second)
+        return;
+      auto result = std::make_shared<std::optional<StageBinary<P, S>>>();
+      batch.m_compiles.push_back([this, &ctx, &in, hash, result]() {
+        PipelineStats::LookupTimer timer(size_t(S::Enum), hash);
+        timer.miss();
+        result->emplace(binary(ctx, in, hash));
+      });
+      batch.m_inserts.push_back([this, &ctx, hash, result]() {
+        m_stageCache.insert(hash, Do<StageTargetTp>(ctx, **result));
+      });
+    }
+  }
+#endif
+};
+
+/**
+ * @brief Pipeline being built by PipelineConverterBase::convertAsync
+ *
+ * Poll isReady() when drawing and skip the draw, or bind a fallback through
+ * pipeline(), until the background compile finishes. get() waits for it.
+ */
+class PipelineToken {
+  friend class PipelineConverterBase;
+  struct State {
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::atomic_bool m_ready = false;
+    boo::ObjToken<boo::IShaderPipeline> m_pipeline;
+  };
+  std::shared_ptr<State> m_state;
+
+public:
+  PipelineToken() = default;
+  explicit operator bool() const { return m_state.operator bool(); }
+  bool isReady() const { return m_state && m_state->m_ready.load(std::memory_order_acquire); }
+
+  /** The built pipeline, or fallback while still compiling */
+  boo::ObjToken<boo::IShaderPipeline> pipeline(const boo::ObjToken<boo::IShaderPipeline>& fallback = {}) const {
+    return isReady() ? m_state->m_pipeline : fallback;
+  }
+
+  /** Block until the pipeline is built */
+  boo::ObjToken<boo::IShaderPipeline> get() const {
+    if (!m_state)
+      return {};
+    std::unique_lock lk{m_state->m_mutex};
+    m_state->m_cv.wait(lk, [this]() { return m_state->m_ready.load(std::memory_order_acquire); });
+    return m_state->m_pipeline;
+  }
 };
 
 class PipelineConverterBase {
+  struct AsyncWorker;
   boo::IGraphicsDataFactory* m_gfxF;
   boo::IGraphicsDataFactory::Platform m_platform;
+  std::mutex m_asyncMutex;
+  std::unique_ptr<AsyncWorker> m_asyncWorker;
+
+  /* Run job on the converter's background thread, started on first use */
+  void _queueAsync(std::function<void()> job);
 
 protected:
   PipelineConverterBase(boo::IGraphicsDataFactory* gfxF, boo::IGraphicsDataFactory::Platform platform)
   : m_gfxF(gfxF), m_platform(platform) {}
+  /* Finish queued async conversions; derived converters call this before their caches are destroyed */
+  void _stopAsync();
 
 public:
-  virtual ~PipelineConverterBase() = default;
+  virtual ~PipelineConverterBase();
 #if HECL_RUNTIME
   template <class FromTp>
   boo::ObjToken<boo::IShaderPipeline> convert(FactoryCtx& ctx, const FromTp& in);
   template <class FromTp>
   boo::ObjToken<boo::IShaderPipeline> convert(const FromTp& in);
+
+  /**
+   * @brief Convert a pipeline on a background thread
+   * @param in Pipeline rep; copied, so it need not outlive the call
+   * @return Token that becomes ready once the pipeline is built
+   *
+   * Conversions run one at a time, in submission order, each in its own
+   * factory transaction. Cached pipelines are resolved just as quickly as
+   * with convert(), only after the conversions queued ahead of them.
+   */
+  template <class FromTp>
+  PipelineToken convertAsync(const FromTp& in);
+
+  /**
+   * @brief Convert many pipelines within one factory transaction
+   * @param in Array of pipeline reps
+   * @param count Number of elements in in and out
+   * @param out Receives the pipeline of each rep
+   * @param progress Optional callback with completed and total stage compiles;
+   *        may be invoked from worker threads
+   *
+   * Stage binaries missing from the caches are compiled in parallel first,
+   * so each pipeline is then assembled from cached stages.
+   */
+  template <class FromTp>
+  void convertBatch(const FromTp* in, size_t count, boo::ObjToken<boo::IShaderPipeline>* out,
+                    const StageCompileBatch::ProgressFunc& progress = {});
 #endif
 };
 
@@ -338,12 +518,13 @@ class PipelineConverter : public PipelineConverterBase {
 #else
   using PipelineTargetTp = StageCollection<StageBinary<P>>;
 #endif
-  std::unordered_map<uint64_t, PipelineTargetTp> m_pipelineCache;
+  ConcurrentCache<PipelineTargetTp> m_pipelineCache;
   StageConverter<P, PipelineStage::Vertex> m_vertexConverter;
   StageConverter<P, PipelineStage::Fragment> m_fragmentConverter;
   StageConverter<P, PipelineStage::Geometry> m_geometryConverter;
   StageConverter<P, PipelineStage::Control> m_controlConverter;
   StageConverter<P, PipelineStage::Evaluation> m_evaluationConverter;
+  std::unique_ptr<ShaderCacheFile> m_cacheFile;
 
   using PipelineTypes = typename ShaderDB<P>::PipelineTypes;
 
@@ -407,22 +588,64 @@ class PipelineConverter : public PipelineConverterBase {
 
 public:
   PipelineConverter(boo::IGraphicsDataFactory* gfxF) : PipelineConverterBase(gfxF, P::Enum) {}
+  ~PipelineConverter() override { _stopAsync(); }
 #if HECL_RUNTIME
   bool loadFromFile(FactoryCtx& ctx, const hecl::SystemChar* path);
+  /**
+   * @brief Attach an indexed ShaderCacheFile, creating it if necessary
+   *
+   * Stage binaries are then loaded lazily on the first convert() of each
+   * stage hash, and binaries compiled on a miss are appended to the file.
+   */
+  bool openCacheFile(const hecl::SystemChar* path);
 #endif
 
   template <class FromTp>
   PipelineTargetTp convert(FactoryCtx& ctx, const FromTp& in) {
     if constexpr (FromTp::HasHash) {
       uint64_t hash = in.Hash();
-      auto search = m_pipelineCache.find(hash);
-      if (search != m_pipelineCache.end())
-        return search->second;
-      return m_pipelineCache.insert(std::make_pair(hash, Do<PipelineTargetTp>(ctx, in))).first->second;
+      PipelineStats::LookupTimer timer(PipelineStats::PipelineSlot, hash);
+      return m_pipelineCache.getOrCompute(hash, [&]() {
+        timer.miss();
+        return Do<PipelineTargetTp>(ctx, in);
+      });
     }
     return Do<PipelineTargetTp>(ctx, in);
   }
 
+#if HECL_RUNTIME
+  template <class FromTp>
+  void convertBatch(FactoryCtx& ctx, const FromTp* in, size_t count, boo::ObjToken<boo::IShaderPipeline>* out,
+                    const StageCompileBatch::ProgressFunc& progress) {
+    StageCompileBatch batch;
+    if constexpr (std::is_base_of_v<GeneralShader, FromTp> || std::is_base_of_v<TessellationShader, FromTp>) {
+      for (size_t i = 0; i < count; ++i) {
+        const FromTp& rep = in[i];
+        if constexpr (FromTp::HasHash) {
+          if (m_pipelineCache.contains(rep.Hash()))
+            continue;
+        }
+        /* Mirrors the stage selection of the StageCollection constructors */
+        bool hasTessellation = false;
+        if constexpr (std::is_base_of_v<TessellationShader, FromTp>)
+          hasTessellation = rep.HasTessellation;
+        if (!std::is_same_v<P, PlatformType::Metal> || !hasTessellation)
+          m_vertexConverter.queueCompile(ctx, rep, batch);
+        m_fragmentConverter.queueCompile(ctx, rep, batch);
+        if (hasTessellation) {
+          m_controlConverter.queueCompile(ctx, rep, batch);
+          m_evaluationConverter.queueCompile(ctx, rep, batch);
+        }
+      }
+    }
+    /* The Metal compiler shares one temporary library path per process */
+    batch.run(!std::is_same_v<P, PlatformType::Metal>, progress);
+
+    for (size_t i = 0; i < count; ++i)
+      out[i] = convert(ctx, in[i]).pipeline();
+  }
+#endif
+
   StageConverter<P, PipelineStage::Vertex>& getVertexConverter() { return m_vertexConverter; }
   StageConverter<P, PipelineStage::Fragment>& getFragmentConverter() { return m_fragmentConverter; }
   StageConverter<P, PipelineStage::Geometry>& getGeometryConverter() { return m_geometryConverter; }
@@ -471,6 +694,60 @@ inline boo::ObjToken<boo::IShaderPipeline> PipelineConverterBase::convert(const
   return ret;
 }
 
+template <class FromTp>
+inline PipelineToken PipelineConverterBase::convertAsync(const FromTp& in) {
+  PipelineToken ret;
+  ret.m_state = std::make_shared<PipelineToken::State>();
+  _queueAsync([this, in, state = ret.m_state]() {
+    boo::ObjToken<boo::IShaderPipeline> pipeline = convert(in);
+    {
+      std::unique_lock lk{state->m_mutex};
+      state->m_pipeline = std::move(pipeline);
+      state->m_ready.store(true, std::memory_order_release);
+    }
+    state->m_cv.notify_all();
+  });
+  return ret;
+}
+
+template <class FromTp>
+inline void PipelineConverterBase::convertBatch(const FromTp* in, size_t count,
+                                                boo::ObjToken<boo::IShaderPipeline>* out,
+                                                const StageCompileBatch::ProgressFunc& progress) {
+  m_gfxF->commitTransaction([&](boo::IGraphicsDataFactory::Context& ctx) {
+    switch (m_platform) {
+#if BOO_HAS_GL
+    case boo::IGraphicsDataFactory::Platform::OpenGL:
+      static_cast<PipelineConverter<PlatformType::OpenGL>&>(*this).convertBatch(ctx, in, count, out, progress);
+      break;
+#endif
+#if BOO_HAS_VULKAN
+    case boo::IGraphicsDataFactory::Platform::Vulkan:
+      static_cast<PipelineConverter<PlatformType::Vulkan>&>(*this).convertBatch(ctx, in, count, out, progress);
+      break;
+#endif
+#if _WIN32
+    case boo::IGraphicsDataFactory::Platform::D3D11:
+      static_cast<PipelineConverter<PlatformType::D3D11>&>(*this).convertBatch(ctx, in, count, out, progress);
+      break;
+#endif
+#if BOO_HAS_METAL
+    case boo::IGraphicsDataFactory::Platform::Metal:
+      static_cast<PipelineConverter<PlatformType::Metal>&>(*this).convertBatch(ctx, in, count, out, progress);
+      break;
+#endif
+#if BOO_HAS_NX
+    case boo::IGraphicsDataFactory::Platform::NX:
+      static_cast<PipelineConverter<PlatformType::NX>&>(*this).convertBatch(ctx, in, count, out, progress);
+      break;
+#endif
+    default:
+      break;
+    }
+    return true;
+  } BooTrace);
+}
+
 inline std::unique_ptr<PipelineConverterBase> NewPipelineConverter(boo::IGraphicsDataFactory* gfxF) {
   switch (gfxF->platform()) {
 #if BOO_HAS_GL
@@ -2,6 +2,8 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string_view>
 #include <type_traits>
 #include <vector>
@@ -69,10 +71,54 @@ public:
   std::string_view text() const { return m_text; }
 };
 
+/** Location of one stage binary within a shaderc-generated blob */
+struct StageBlobEntry {
+  uint32_t offset;
+  /** Stored size; equal to rawSize when the binary is embedded uncompressed */
+  uint32_t size;
+  uint32_t rawSize;
+  /** XXH64 of the uncompressed binary */
+  uint64_t hash;
+};
+
+/**
+ * @brief Deduplicated stage binaries packed by shaderc into one array
+ *
+ * Uncompressed entries are viewed in place; zlib-compressed entries are
+ * inflated once on first access. Nothing is touched at static init, so
+ * blob pages are only faulted in for stages actually used.
+ */
+class StageBlobTable {
+  struct Slot {
+    std::once_flag m_once;
+    StageBinaryData m_data;
+  };
+  const uint8_t* m_blob;
+  const StageBlobEntry* m_entries;
+  size_t m_count;
+  mutable std::unique_ptr<Slot[]> m_slots;
+
+  const uint8_t* _inflate(size_t idx) const;
+
+public:
+  StageBlobTable(const uint8_t* blob, const StageBlobEntry* entries, size_t count)
+  : m_blob(blob), m_entries(entries), m_count(count), m_slots(new Slot[count]) {}
+
+  const uint8_t* data(size_t idx) const {
+    const StageBlobEntry& ent = m_entries[idx];
+    return ent.size == ent.rawSize ? m_blob + ent.offset : _inflate(idx);
+  }
+  size_t size(size_t idx) const { return m_entries[idx].rawSize; }
+  uint64_t hash(size_t idx) const { return m_entries[idx].hash; }
+  size_t count() const { return m_count; }
+};
+
 template <typename P, typename S>
 class StageBinary : public StageRep<P, S> {
   StageBinaryData m_ownedData;
   const uint8_t* m_data = nullptr;
+  const StageBlobTable* m_table = nullptr;
+  size_t m_index = 0;
   size_t m_size = 0;
   uint64_t m_hash = 0;
 
@@ -88,9 +134,12 @@ public:
     m_hash = XXH64(m_data, m_size, 0);
   }
   explicit StageBinary(std::pair<StageBinaryData, size_t> data) : StageBinary(data.first, data.second) {}
+  /** Lazy view of a blob entry; the precomputed hash avoids reading it until data() */
+  StageBinary(const StageBlobTable& table, size_t index)
+  : m_table(&table), m_index(index), m_size(table.size(index)), m_hash(table.hash(index)) {}
   StageBinary(StageConverter<P, S>& conv, FactoryCtx& ctx, const StageSourceText<P, S>& in)
   : StageBinary(CompileShader<P, S>(in.text())) {}
-  const uint8_t* data() const { return m_data; }
+  const uint8_t* data() const { return m_table ? m_table->data(m_index) : m_data; }
   size_t size() const { return m_size; }
 };
 
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "hecl/SystemChar.hpp"
+
+namespace hecl {
+class Console;
+
+/**
+ * @brief Lookup counters of the shader stage and pipeline caches
+ *
+ * Stage caches are indexed by boo::PipelineStage; PipelineSlot covers the
+ * final pipeline cache. Misses are recorded per hash along with the time spent
+ * converting, as is whether loadFromFile preloaded an entry, so hitch-causing
+ * shaders can be found after a play session. Hits only bump a per-slot atomic
+ * counter unless detailed recording is on, since they sit on the cache's hot
+ * path; per-hash hit counts, and with them unused preloaded entries, need it.
+ */
+namespace PipelineStats {
+constexpr size_t PipelineSlot = 6;
+constexpr size_t SlotCount = 7;
+
+struct Entry {
+  uint64_t m_hash = 0;
+  uint64_t m_hits = 0;
+  uint64_t m_misses = 0;
+  uint64_t m_missNs = 0;
+  uint64_t m_slowestMissNs = 0;
+  bool m_loaded = false;
+};
+
+struct Summary {
+  uint64_t m_hits = 0;
+  uint64_t m_misses = 0;
+  uint64_t m_missNs = 0;
+  uint64_t m_slowestMissNs = 0;
+  size_t m_loaded = 0;
+  /** Preloaded entries that no lookup has requested while detailed recording was on */
+  size_t m_loadedUnused = 0;
+  /** Stage binaries found in an attached ShaderCacheFile instead of compiled */
+  uint64_t m_fileHits = 0;
+  uint64_t m_fileMisses = 0;
+};
+
+/** Also count hits per hash; off by default */
+void SetDetailed(bool detailed);
+bool IsDetailed();
+
+void RecordLookup(size_t slot, uint64_t hash, bool miss, uint64_t missNs);
+void RecordLoaded(size_t slot, uint64_t hash);
+void RecordCacheFile(size_t slot, bool hit);
+
+Summary Summarize(size_t slot);
+/** Entries of slot, slowest misses first */
+std::vector<Entry> Entries(size_t slot);
+void Reset();
+
+/** Write every entry as CSV */
+bool Dump(const SystemChar* path);
+
+/** Register the pipelineStats command, which prints summaries or dumps entries */
+void RegisterCommands(Console& console);
+
+/** Times one cache lookup from the start of its compute callback, which calls miss(); hits read no clock */
+class LookupTimer {
+  size_t m_slot;
+  uint64_t m_hash;
+  std::chrono::steady_clock::time_point m_start;
+  bool m_miss = false;
+
+public:
+  LookupTimer(size_t slot, uint64_t hash) : m_slot(slot), m_hash(hash) {}
+  ~LookupTimer() {
+    const uint64_t ns =
+        m_miss ? uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() -
+                                                                                m_start)
+                              .count())
+               : 0;
+    RecordLookup(m_slot, m_hash, m_miss, ns);
+  }
+  LookupTimer(const LookupTimer&) = delete;
+  LookupTimer& operator=(const LookupTimer&) = delete;
+  void miss() {
+    m_miss = true;
+    m_start = std::chrono::steady_clock::now();
+  }
+};
+} // namespace PipelineStats
+
+} // namespace hecl
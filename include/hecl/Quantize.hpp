@@ -0,0 +1,140 @@
+#pragma once
+
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+namespace hecl {
+
+/**
+ * Conversions between float and the packed encodings of vertex, animation
+ * and texture data.
+ *
+ * The scalar forms below are the reference; the array forms in Quantize.cpp
+ * process large buffers with SSE2, AVX2 or NEON as the build targets and
+ * produce bit-identical results, including for NaN, infinities and
+ * subnormals. Normalized encodings round half away from zero and clamp,
+ * with NaN mapping to the low end of the range.
+ */
+
+/** IEEE half, rounded to nearest even; NaNs become the quiet NaN 0x7e00 with the sign kept */
+inline uint16_t FloatToHalf(float f) {
+  uint32_t x;
+  std::memcpy(&x, &f, sizeof(x));
+  const uint32_t sign = x & 0x80000000u;
+  x ^= sign;
+  uint32_t ret;
+  if (x >= (127u + 16u) << 23) {
+    ret = x > 0x7f800000u ? 0x7e00u : 0x7c00u;
+  } else if (x < 113u << 23) {
+    /* Subnormal or zero; float addition performs the rounding */
+    constexpr uint32_t DenormMagic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+    float magic, sum;
+    std::memcpy(&magic, &DenormMagic, sizeof(magic));
+    std::memcpy(&sum, &x, sizeof(sum));
+    sum += magic;
+    std::memcpy(&ret, &sum, sizeof(ret));
+    ret -= DenormMagic;
+  } else {
+    const uint32_t mantOdd = (x >> 13) & 1u;
+    ret = (x + (uint32_t(15 - 127) << 23) + 0xfffu + mantOdd) >> 13;
+  }
+  return uint16_t(ret | (sign >> 16));
+}
+
+/** Exact; NaN payloads are kept */
+inline float HalfToFloat(uint16_t h) {
+  constexpr uint32_t Magic = (254u - 15u) << 23;
+  constexpr uint32_t WasInfNan = (127u + 16u) << 23;
+  uint32_t bits = uint32_t(h & 0x7fffu) << 13;
+  float f, magic, wasInfNan;
+  std::memcpy(&f, &bits, sizeof(f));
+  std::memcpy(&magic, &Magic, sizeof(magic));
+  std::memcpy(&wasInfNan, &WasInfNan, sizeof(wasInfNan));
+  f *= magic;
+  std::memcpy(&bits, &f, sizeof(bits));
+  if (f >= wasInfNan)
+    bits |= 255u << 23;
+  bits |= uint32_t(h & 0x8000u) << 16;
+  std::memcpy(&f, &bits, sizeof(f));
+  return f;
+}
+
+namespace quantize_detail {
+/* Also the NaN handling of SSE/AVX max and min: a NaN v yields lo */
+inline float Clamp(float v, float lo, float hi) {
+  v = v > lo ? v : lo;
+  return v < hi ? v : hi;
+}
+
+/* Same as std::lround for the ranges used here, without a rounding-mode dependency */
+inline int32_t RoundHalfAway(float x) {
+  const float ax = std::fabs(x);
+  int32_t ret = int32_t(ax);
+  ret += ax - float(ret) >= 0.5f;
+  return x < 0.f ? -ret : ret;
+}
+} // namespace quantize_detail
+
+inline uint16_t FloatToUnorm16(float v) {
+  return uint16_t(quantize_detail::RoundHalfAway(quantize_detail::Clamp(v, 0.f, 1.f) * 65535.f));
+}
+inline int16_t FloatToSnorm16(float v) {
+  return int16_t(quantize_detail::RoundHalfAway(quantize_detail::Clamp(v, -1.f, 1.f) * 32767.f));
+}
+inline uint8_t FloatToUnorm8(float v) {
+  return uint8_t(quantize_detail::RoundHalfAway(quantize_detail::Clamp(v, 0.f, 1.f) * 255.f));
+}
+
+inline float Unorm16ToFloat(uint16_t v) { return float(v) / 65535.f; }
+inline float Snorm16ToFloat(int16_t v) {
+  const float f = float(v) / 32767.f;
+  return f > -1.f ? f : -1.f;
+}
+inline float Unorm8ToFloat(uint8_t v) { return float(v) / 255.f; }
+
+/** Octahedral projection of a unit vector onto [-1,1]^2 */
+inline std::pair<float, float> OctEncode(float x, float y, float z) {
+  const float l1 = std::fabs(x) + std::fabs(y) + std::fabs(z);
+  float u = l1 > FLT_EPSILON ? x / l1 : 0.f;
+  float v = l1 > FLT_EPSILON ? y / l1 : 0.f;
+  if (z < 0.f) {
+    const float ou = u;
+    u = (1.f - std::fabs(v)) * (ou >= 0.f ? 1.f : -1.f);
+    v = (1.f - std::fabs(ou)) * (v >= 0.f ? 1.f : -1.f);
+  }
+  return {u, v};
+}
+
+/** Unit vector of an octahedral projection */
+inline std::array<float, 3> OctDecode(float u, float v) {
+  const float z = 1.f - std::fabs(u) - std::fabs(v);
+  const float fold = -z > 0.f ? -z : 0.f;
+  const float x = u + (u >= 0.f ? -fold : fold);
+  const float y = v + (v >= 0.f ? -fold : fold);
+  const float len = std::sqrt(x * x + y * y + z * z);
+  return {x / len, y / len, z / len};
+}
+
+/* Array forms; count is in elements, or in vectors for the octahedral ones */
+void FloatToHalf(const float* in, uint16_t* out, size_t count);
+void HalfToFloat(const uint16_t* in, float* out, size_t count);
+void FloatToUnorm16(const float* in, uint16_t* out, size_t count);
+void FloatToSnorm16(const float* in, int16_t* out, size_t count);
+void FloatToUnorm8(const float* in, uint8_t* out, size_t count);
+void Unorm16ToFloat(const uint16_t* in, float* out, size_t count);
+void Snorm16ToFloat(const int16_t* in, float* out, size_t count);
+void Unorm8ToFloat(const uint8_t* in, float* out, size_t count);
+/** Tightly packed xyz triples to snorm16 (u, v) pairs */
+void OctEncodeSnorm16(const float* xyz, int16_t* out, size_t count);
+/** Snorm16 (u, v) pairs to tightly packed xyz triples */
+void OctDecodeSnorm16(const int16_t* in, float* xyz, size_t count);
+
+/** Instruction set the array forms were built for: "AVX2", "SSE2", "NEON" or "scalar" */
+const char* QuantizeKernelName();
+
+} // namespace hecl
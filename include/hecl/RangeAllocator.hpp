@@ -0,0 +1,212 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace hecl {
+
+/**
+ * @brief Two-level segregated fit allocator of integer ranges
+ *
+ * Free ranges are binned by size into power-of-two classes, each split into
+ * SLCount linear subclasses. Bitmaps of non-empty bins locate a fitting range
+ * with two bit scans, so allocate() and release() take constant time however
+ * fragmented the space is. Only when no larger bin has space is the request's
+ * own bin searched, so an exactly fitting range is still found. Released
+ * ranges coalesce with free neighbours, except across multiples of the
+ * boundary given at construction.
+ *
+ * Not synchronized; owners provide their own locking.
+ */
+class RangeAllocator {
+public:
+  static constexpr uint32_t InvalidOffset = UINT32_MAX;
+
+private:
+  static constexpr uint32_t SLLog2 = 4;
+  static constexpr uint32_t SLCount = 1u << SLLog2;
+  static constexpr uint32_t FLCount = 32 - SLLog2 + 1;
+  static constexpr uint32_t NullNode = UINT32_MAX;
+
+  struct Node {
+    uint32_t m_start;
+    uint32_t m_size;
+    uint32_t m_prev;
+    uint32_t m_next;
+  };
+  std::vector<Node> m_nodes;
+  uint32_t m_recycledNodes = NullNode;
+
+  /* Free ranges by first offset and one-past-last offset, for coalescing */
+  std::unordered_map<uint32_t, uint32_t> m_byStart;
+  std::unordered_map<uint32_t, uint32_t> m_byEnd;
+
+  uint32_t m_heads[FLCount][SLCount];
+  uint32_t m_flBitmap = 0;
+  uint32_t m_slBitmap[FLCount] = {};
+  uint32_t m_boundary;
+  uint64_t m_freeTotal = 0;
+
+  static void _mapping(uint32_t size, uint32_t& fl, uint32_t& sl) {
+    if (size < SLCount) {
+      fl = 0;
+      sl = size;
+      return;
+    }
+    const uint32_t msb = uint32_t(std::bit_width(size)) - 1;
+    fl = msb - SLLog2 + 1;
+    sl = (size >> (msb - SLLog2)) - SLCount;
+  }
+
+  bool _isBoundary(uint32_t offset) const { return m_boundary && offset % m_boundary == 0; }
+
+  void _insertFree(uint32_t start, uint32_t size) {
+    uint32_t idx;
+    if (m_recycledNodes != NullNode) {
+      idx = m_recycledNodes;
+      m_recycledNodes = m_nodes[idx].m_next;
+    } else {
+      idx = uint32_t(m_nodes.size());
+      m_nodes.emplace_back();
+    }
+
+    uint32_t fl, sl;
+    _mapping(size, fl, sl);
+    const uint32_t head = (m_slBitmap[fl] & (1u << sl)) ? m_heads[fl][sl] : NullNode;
+    m_nodes[idx] = Node{start, size, NullNode, head};
+    if (head != NullNode)
+      m_nodes[head].m_prev = idx;
+    m_heads[fl][sl] = idx;
+    m_slBitmap[fl] |= 1u << sl;
+    m_flBitmap |= 1u << fl;
+
+    m_byStart[start] = idx;
+    m_byEnd[start + size] = idx;
+    m_freeTotal += size;
+  }
+
+  void _removeFree(uint32_t idx) {
+    Node& node = m_nodes[idx];
+    uint32_t fl, sl;
+    _mapping(node.m_size, fl, sl);
+    if (node.m_prev != NullNode)
+      m_nodes[node.m_prev].m_next = node.m_next;
+    else if (node.m_next != NullNode)
+      m_heads[fl][sl] = node.m_next;
+    else if (!(m_slBitmap[fl] &= ~(1u << sl)))
+      m_flBitmap &= ~(1u << fl);
+    if (node.m_next != NullNode)
+      m_nodes[node.m_next].m_prev = node.m_prev;
+
+    m_byStart.erase(node.m_start);
+    m_byEnd.erase(node.m_start + node.m_size);
+    m_freeTotal -= node.m_size;
+    node.m_next = m_recycledNodes;
+    m_recycledNodes = idx;
+  }
+
+  uint32_t _findFit(uint32_t size) const {
+    uint32_t fl, sl;
+    if (size < SLCount) {
+      _mapping(size, fl, sl);
+    } else {
+      /* Round up to the next subclass so any range in the chosen bin fits */
+      const uint64_t rounded = uint64_t(size) + (1u << (std::bit_width(size) - 1 - SLLog2)) - 1;
+      if (rounded > UINT32_MAX)
+        return NullNode;
+      _mapping(uint32_t(rounded), fl, sl);
+    }
+
+    uint32_t slMap = m_slBitmap[fl] & (~0u << sl);
+    if (!slMap) {
+      const uint32_t flMap = fl + 1 < FLCount ? m_flBitmap & (~0u << (fl + 1)) : 0;
+      if (!flMap)
+        return _findInBin(size);
+      fl = uint32_t(std::countr_zero(flMap));
+      slMap = m_slBitmap[fl];
+    }
+    return m_heads[fl][std::countr_zero(slMap)];
+  }
+
+  /* Last resort before failing: the request's own bin may hold a range at least as large */
+  uint32_t _findInBin(uint32_t size) const {
+    uint32_t fl, sl;
+    _mapping(size, fl, sl);
+    if (!(m_slBitmap[fl] & (1u << sl)))
+      return NullNode;
+    for (uint32_t idx = m_heads[fl][sl]; idx != NullNode; idx = m_nodes[idx].m_next)
+      if (m_nodes[idx].m_size >= size)
+        return idx;
+    return NullNode;
+  }
+
+public:
+  /**
+   * @param boundary Ranges never span or coalesce across multiples of this
+   *        offset (e.g. separately backed buckets); 0 for no restriction
+   */
+  explicit RangeAllocator(uint32_t boundary = 0) : m_boundary(boundary) {}
+
+  /** Make [start, start + size) available; it must not overlap any range already managed */
+  void addRange(uint32_t start, uint32_t size) { release(start, size); }
+
+  /**
+   * @brief Take a contiguous range of size elements
+   * @return Offset of the range, or InvalidOffset if no free range fits
+   */
+  uint32_t allocate(uint32_t size) {
+    assert(size && "zero-sized allocation");
+    const uint32_t idx = _findFit(size);
+    if (idx == NullNode)
+      return InvalidOffset;
+    const uint32_t start = m_nodes[idx].m_start;
+    const uint32_t remainder = m_nodes[idx].m_size - size;
+    _removeFree(idx);
+    if (remainder)
+      _insertFree(start + size, remainder);
+    return start;
+  }
+
+  /** Return a range obtained from allocate(), merging it with free neighbours */
+  void release(uint32_t start, uint32_t size) {
+    if (!_isBoundary(start)) {
+      auto left = m_byEnd.find(start);
+      if (left != m_byEnd.end()) {
+        const uint32_t idx = left->second;
+        start = m_nodes[idx].m_start;
+        size += m_nodes[idx].m_size;
+        _removeFree(idx);
+      }
+    }
+    if (!_isBoundary(start + size)) {
+      auto right = m_byStart.find(start + size);
+      if (right != m_byStart.end()) {
+        const uint32_t idx = right->second;
+        size += m_nodes[idx].m_size;
+        _removeFree(idx);
+      }
+    }
+    _insertFree(start, size);
+  }
+
+  /** Sum of all free range sizes */
+  uint64_t freeTotal() const { return m_freeTotal; }
+
+  /** Size of the largest free range; scans only the highest occupied bin */
+  uint32_t largestFree() const {
+    if (!m_flBitmap)
+      return 0;
+    const uint32_t fl = uint32_t(std::bit_width(m_flBitmap)) - 1;
+    const uint32_t sl = uint32_t(std::bit_width(m_slBitmap[fl])) - 1;
+    uint32_t ret = 0;
+    for (uint32_t idx = m_heads[fl][sl]; idx != NullNode; idx = m_nodes[idx].m_next)
+      ret = std::max(ret, m_nodes[idx].m_size);
+    return ret;
+  }
+};
+
+} // namespace hecl
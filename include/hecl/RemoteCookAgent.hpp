@@ -0,0 +1,68 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "hecl/hecl.hpp"
+#include "hecl/SystemChar.hpp"
+
+namespace hecl::Database {
+struct DataSpecEntry;
+}
+
+namespace hecl {
+
+/**
+ * @brief Cook executor on another machine with the same project checked out
+ *
+ * Agents deliver their output through the shared RemoteCookStore: a remote cook
+ * publishes its artifact under the same content key the coordinating process
+ * computes, which then restores it through CookCache. The agent machine must
+ * therefore use the same store and have identical working files.
+ *
+ * Each agent receives one cook at a time from a dedicated ClientProcess thread.
+ */
+class RemoteCookAgent {
+public:
+  virtual ~RemoteCookAgent() = default;
+
+  /** Name used in progress output and diagnostics */
+  virtual SystemStringView name() const = 0;
+
+  /**
+   * @brief Cook path on the agent and publish the result to the shared store
+   * @param path Working source path
+   * @param spec DataSpec to cook with; the agent applies its own overrideDataSpec
+   * @param fast Draft cook flag
+   * @param force Recook even if the agent considers its artifact up to date
+   * @return false if the cook could not be carried out; the path is then cooked locally
+   */
+  virtual bool cook(const ProjectPath& path, const Database::DataSpecEntry& spec, bool fast, bool force) = 0;
+};
+
+/**
+ * @brief RemoteCookAgent running hecl through a command prefix
+ *
+ * The prefix is completed with "cook --agent" and the cook arguments, then
+ * executed by the system shell, e.g. "ssh farm03 cd /work/game && hecl".
+ * Arguments are quoted for the local shell only; prefixes reaching the remote
+ * machine through another shell should not be used with paths containing spaces.
+ */
+class CommandCookAgent final : public RemoteCookAgent {
+  SystemString m_command;
+
+public:
+  explicit CommandCookAgent(SystemStringView command) : m_command(command) {}
+  SystemStringView name() const override { return m_command; }
+  bool cook(const ProjectPath& path, const Database::DataSpecEntry& spec, bool fast, bool force) override;
+};
+
+/**
+ * @brief Agents named by the HECL_COOK_AGENTS environment variable
+ *
+ * The variable holds semicolon-separated CommandCookAgent prefixes; listing a
+ * prefix more than once runs that many cooks on it concurrently.
+ */
+std::vector<std::shared_ptr<RemoteCookAgent>> DefaultRemoteCookAgents();
+
+} // namespace hecl
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "hecl/SystemChar.hpp"
+
+namespace hecl::Database {
+
+/**
+ * @brief Backend sharing cooked artifacts between machines
+ *
+ * Artifacts are addressed by CookCache content keys, which already cover the
+ * source digests, DataSpec, cook version and dependencies, so any machine
+ * holding an artifact for a key may serve it to any other. CookCache consults
+ * the store before cooking and publishes to it after each successful cook.
+ *
+ * Implementations are called concurrently from cook workers.
+ */
+class RemoteCookStore {
+public:
+  virtual ~RemoteCookStore() = default;
+
+  /**
+   * @brief Write the artifact stored under key to dest
+   * @return false if the store has no intact artifact for key; dest is then untouched
+   */
+  virtual bool fetch(uint64_t key, const SystemString& dest) = 0;
+
+  /** Publish the artifact at src under key; failures are reported but non-fatal */
+  virtual void store(uint64_t key, const SystemString& src) = 0;
+};
+
+/**
+ * @brief RemoteCookStore in a directory, typically on a network share
+ *
+ * Objects are zlib-compressed and carry the size and XXH64 digest of their
+ * contents, which are verified on fetch. Objects are written under a unique
+ * temporary name and renamed into place, so concurrent publishers of one key
+ * never expose a partial object.
+ */
+class SharedDirCookStore final : public RemoteCookStore {
+  SystemString m_root;
+
+  SystemString _objectPath(uint64_t key) const;
+
+public:
+  explicit SharedDirCookStore(SystemStringView root);
+  bool fetch(uint64_t key, const SystemString& dest) override;
+  void store(uint64_t key, const SystemString& src) override;
+};
+
+/**
+ * @brief Store named by the HECL_COOK_STORE environment variable, if set
+ *
+ * The variable holds the directory of a SharedDirCookStore.
+ */
+std::shared_ptr<RemoteCookStore> DefaultRemoteCookStore();
+
+} // namespace hecl::Database
@@ -1,8 +1,13 @@
 #pragma once
 
+#include <atomic>
 #include <cstddef>
 #include <memory>
+#include <string_view>
+#include <thread>
+#include <vector>
 
+#include "hecl/MappedFile.hpp"
 #include "hecl/SystemChar.hpp"
 
 #include <boo/BooObject.hpp>
@@ -12,6 +17,7 @@ namespace hecl {
 struct HMDLMeta;
 
 namespace Runtime {
+struct HMDLStaging;
 
 /**
  * @brief Per-platform file store resolution
@@ -30,16 +36,58 @@ public:
   SystemStringView getStoreRoot() const { return m_storeRoot; }
 };
 
+/**
+ * @brief Persistent store for an opaque driver pipeline cache blob
+ *
+ * Holds the serialized form of VkPipelineCache data, a Metal binary archive or
+ * a D3D pipeline library between runs. Blobs live under the file store root,
+ * one file per graphics platform and device identity; the identity string
+ * should cover vendor, device and driver version (e.g. pipelineCacheUUID on
+ * Vulkan) so a driver update never feeds a foreign blob back to the driver.
+ */
+class DriverPipelineCache {
+  SystemString m_path;
+  uint64_t m_deviceKey;
+
+public:
+  DriverPipelineCache(const FileStoreManager& store, boo::IGraphicsDataFactory::Platform platform,
+                      std::string_view deviceId);
+  SystemStringView getPath() const { return m_path; }
+
+  /**
+   * @brief Read the stored blob
+   * @return Blob contents, or empty if absent, corrupt or from another device
+   */
+  std::vector<uint8_t> load() const;
+
+  /**
+   * @brief Replace the stored blob
+   * @return true if the blob was written in full
+   *
+   * The file is written beside the original and renamed over it, so an
+   * interrupted save leaves the previous blob intact.
+   */
+  bool save(const void* data, size_t size) const;
+  bool save(const std::vector<uint8_t>& data) const { return save(data.data(), data.size()); }
+};
+
 /**
  * @brief Integrated reader/constructor/container for HMDL data
  */
 struct HMDLData {
   boo::ObjToken<boo::IGraphicsBufferS> m_vbo;
   boo::ObjToken<boo::IGraphicsBufferS> m_ibo;
-  std::unique_ptr<boo::VertexElementDescriptor[]> m_vtxFmtData;
+  /* Shared with every mesh of the same attribute counts; m_vtxFmtId is unique per distinct format */
   boo::VertexFormatInfo m_vtxFmt;
+  uint32_t m_vtxFmtId = 0;
+  /* Offsets of this mesh within buffers shared through an HMDLArena; draws add m_baseIndex to their index start */
+  size_t m_baseVert = 0;
+  size_t m_baseIndex = 0;
 
   HMDLData(boo::IGraphicsDataFactory::Context& ctx, const void* metaData, const void* vbo, const void* ibo);
+  HMDLData(boo::IGraphicsDataFactory::Context& ctx, const HMDLStaging& staging);
+  HMDLData(const HMDLMeta& meta, boo::ObjToken<boo::IGraphicsBufferS> vbo, boo::ObjToken<boo::IGraphicsBufferS> ibo,
+           size_t baseVert, size_t baseIndex);
 
   boo::ObjToken<boo::IShaderDataBinding> newShaderDataBindng(boo::IGraphicsDataFactory::Context& ctx,
                                                              const boo::ObjToken<boo::IShaderPipeline>& shader,
@@ -48,8 +96,93 @@ struct HMDLData {
                                                              const boo::PipelineStage* ubufStages, size_t texCount,
                                                              const boo::ObjToken<boo::ITexture>* texs) {
     return ctx.newShaderDataBinding(shader, m_vbo.get(), nullptr, m_ibo.get(), ubufCount, ubufs, ubufStages, nullptr,
-                                    nullptr, texCount, texs, nullptr, nullptr);
+                                    nullptr, texCount, texs, nullptr, nullptr, m_baseVert);
   }
+
+private:
+  void _buildVtxFmt(const HMDLMeta& meta);
+};
+
+/**
+ * @brief Packs many HMDL meshes into shared static buffers
+ *
+ * Meshes added before build() are grouped by vertex layout, and each group is
+ * uploaded as one vertex and one index buffer. A level's meshes then occupy a
+ * handful of GPU buffers, and draws of the same layout can be batched without
+ * rebinding. The HMDLData returned for each mesh references its group's
+ * buffers along with its own base vertex and index.
+ */
+class HMDLArena {
+  std::vector<std::unique_ptr<HMDLStaging>> m_staged;
+
+public:
+  HMDLArena();
+  ~HMDLArena();
+  HMDLArena(const HMDLArena&) = delete;
+  HMDLArena& operator=(const HMDLArena&) = delete;
+
+  /**
+   * @brief Stage a mesh for upload
+   * @return Index of the mesh within build()'s result
+   *
+   * The data must remain valid until build() returns.
+   */
+  size_t add(const void* metaData, const void* vbo, const void* ibo);
+
+  /** Upload every staged mesh, in add() order, and empty the arena */
+  std::vector<std::unique_ptr<HMDLData>> build(boo::IGraphicsDataFactory::Context& ctx);
+};
+
+/**
+ * @brief Background loader for HMDL data within a cooked file
+ *
+ * The file is memory mapped and a worker thread faults its pages in chunk by
+ * chunk, expanding packed attributes if required. Once staged, upload()
+ * creates the GPU buffers straight from the mapping, so the render thread
+ * neither waits on disk nor needs a second full-size copy of the mesh.
+ */
+class HMDLStream {
+public:
+  enum class State { Pending, Staged, Ready, Failed };
+
+private:
+  MappedFile m_file;
+  std::unique_ptr<HMDLStaging> m_staging;
+  std::unique_ptr<HMDLData> m_data;
+  std::atomic<State> m_state = State::Pending;
+  std::atomic_bool m_cancel = false;
+  std::thread m_thread;
+
+  void _stage(size_t metaOffset, size_t vboOffset, size_t iboOffset);
+
+public:
+  /**
+   * @brief Begin staging HMDL data from a cooked file
+   * @param path Absolute path of cooked file
+   * @param metaOffset File offset of the HMDLMeta record
+   * @param vboOffset File offset of the vertex data
+   * @param iboOffset File offset of the index data
+   */
+  HMDLStream(SystemStringView path, size_t metaOffset, size_t vboOffset, size_t iboOffset);
+  ~HMDLStream();
+  HMDLStream(const HMDLStream&) = delete;
+  HMDLStream& operator=(const HMDLStream&) = delete;
+
+  State state() const { return m_state.load(std::memory_order_acquire); }
+  bool isReady() const { return state() == State::Ready; }
+
+  /**
+   * @brief Create GPU buffers once staging has finished
+   * @param ctx Context of an open graphics data transaction
+   * @return true if buffers exist (now or from an earlier call)
+   *
+   * Safe to call every frame; returns false without blocking while pending.
+   * The file mapping is released after upload.
+   */
+  bool upload(boo::IGraphicsDataFactory::Context& ctx);
+
+  /** Uploaded buffers, or nullptr until isReady() */
+  HMDLData* data() const { return isReady() ? m_data.get() : nullptr; }
 };
 
 } // namespace Runtime
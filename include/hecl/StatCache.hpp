@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+#include "hecl/SystemChar.hpp"
+
+namespace hecl {
+
+/**
+ * @brief Memo of filesystem metadata for the duration of a cook
+ *
+ * Directory enumeration already has the type, size and modtime of every
+ * child in hand; recording it here lets the path type checks, modtime
+ * comparisons and cook cache lookups that follow skip their own stat calls.
+ * Failed lookups are remembered as well.
+ *
+ * Disabled caches forward straight to hecl::Stat. While enabled, files are
+ * assumed not to change behind the cache's back; writers must invalidate()
+ * what they touch, except beneath the excluded prefix, which is never cached
+ * (the project's .hecl directory, where cooked output lands).
+ */
+class StatCache {
+  struct Entry {
+    int m_result;
+    Sstat m_stat;
+  };
+  struct StringViewHash {
+    using is_transparent = void;
+    size_t operator()(SystemStringView str) const { return std::hash<SystemStringView>()(str); }
+  };
+
+  mutable std::shared_mutex m_mutex;
+  std::unordered_map<SystemString, Entry, StringViewHash, std::equal_to<>> m_entries;
+  SystemString m_excludedPrefix;
+  std::atomic_bool m_enabled = false;
+
+  bool _excluded(SystemStringView path) const;
+
+public:
+  StatCache() = default;
+  StatCache(const StatCache&) = delete;
+  StatCache& operator=(const StatCache&) = delete;
+
+  /** Never cache path or anything beneath it */
+  void setExcludedPrefix(SystemStringView path) { m_excludedPrefix = path; }
+
+  /** Start or stop caching; either way, anything previously recorded is dropped */
+  void setEnabled(bool enabled);
+  bool isEnabled() const { return m_enabled; }
+
+  /** Drop-in for hecl::Stat; path must be null-terminated */
+  int stat(SystemStringView path, Sstat* statOut);
+
+  /** Record metadata obtained elsewhere, such as from directory enumeration */
+  void insert(SystemStringView path, const Sstat& st);
+
+  void invalidate(SystemStringView path);
+  void clear();
+};
+
+} // namespace hecl
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+#include "hecl/hecl.hpp"
+
+namespace hecl::Database {
+class Project;
+}
+
+namespace hecl {
+
+/**
+ * @brief PNG to GPU texture conversion shared by DataSpecs
+ *
+ * Decodes a PNG to RGBA8, box-filters a mip chain and encodes every level
+ * to one of the layouts DataSpecs emit. When called from a ClientProcess
+ * worker, rows of tiles are split across idle workers.
+ *
+ * Converted textures are keyed on a digest of the PNG bytes and the
+ * conversion parameters and kept in .hecl/texcache, so an unchanged texture
+ * converts once regardless of how many DataSpecs or cooks request it.
+ */
+class TextureService {
+public:
+  enum class Format : uint32_t {
+    /** Linear RGBA, 4 bytes per pixel */
+    RGBA8,
+    /** GX RGBA8: 4x4 tiles of AR pairs followed by GB pairs */
+    RGBA8GX,
+    /** BC1 blocks, little-endian */
+    DXT1,
+    /** GX CMPR: 8x8 tiles of 2x2 big-endian DXT1 blocks */
+    CMPR,
+  };
+
+  struct Image {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> rgba;
+  };
+
+  struct Texture {
+    Format format = Format::RGBA8;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t mipCount = 0;
+    /** Every mip level, largest first */
+    std::vector<uint8_t> data;
+    std::vector<size_t> mipOffsets;
+  };
+
+  static bool DecodePNG(const uint8_t* data, size_t len, Image& out);
+  /** Half-size box filtered copy; odd edges repeat their last texel */
+  static Image Downsample(const Image& src);
+  /** Bytes of one level, padded to the format's tile size */
+  static size_t EncodedSize(Format fmt, uint32_t width, uint32_t height);
+  /** Encode img into EncodedSize(fmt, img.width, img.height) bytes at out */
+  static void Encode(const Image& img, Format fmt, uint8_t* out);
+
+  explicit TextureService(const Database::Project& project);
+
+  /**
+   * @brief Convert a PNG, restoring from the texture cache when possible
+   * @param pngPath Source PNG
+   * @param fmt Output layout
+   * @param maxMips Upper bound on levels generated; 0 for a full chain
+   * @param out Converted levels
+   * @return false if the PNG couldn't be read or decoded
+   */
+  bool convert(const ProjectPath& pngPath, Format fmt, uint32_t maxMips, Texture& out);
+
+private:
+  const Database::Project& m_project;
+  std::mutex m_mutex;
+  SystemString m_cachePath;
+  std::unordered_set<uint64_t> m_converting;
+  std::condition_variable m_convertCv;
+
+  SystemString _cacheEntryPath(uint64_t key);
+  bool _load(const SystemString& entryPath, Texture& out);
+  void _store(const SystemString& entryPath, const Texture& tex);
+};
+
+} // namespace hecl
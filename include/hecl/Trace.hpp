@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "hecl/SystemChar.hpp"
+
+namespace hecl::trace {
+
+/**
+ * @brief Process-wide recorder of timed spans in Chrome trace format
+ *
+ * While a trace is active, every Scope appends a complete event to a buffer
+ * owned by its thread; Stop() merges all buffers into a JSON file readable by
+ * chrome://tracing, Perfetto or speedscope. Inactive traces cost a single
+ * relaxed load per scope.
+ */
+extern std::atomic_bool Active;
+
+/** Begin recording into path; false if the file can't be created */
+bool Start(SystemStringView path);
+
+/** Finish the active trace and write its events */
+void Stop();
+
+/** Nanoseconds on the trace clock */
+uint64_t Now();
+
+/** Label the calling thread's track in trace viewers */
+void SetThreadName(std::string_view name);
+
+/** Record a span that began at begin and ended now, e.g. time spent queued */
+void Record(const char* name, uint64_t begin, std::string_view detail = {});
+
+/**
+ * @brief RAII span; name must be a string literal
+ *
+ * The optional detail (typically a working path) is shown as an argument of
+ * the event and is only copied while tracing.
+ */
+class Scope {
+  const char* m_name;
+  uint64_t m_begin = 0;
+  std::string m_detail;
+
+public:
+  explicit Scope(const char* name) : m_name(Active.load(std::memory_order_relaxed) ? name : nullptr) {
+    if (m_name)
+      m_begin = Now();
+  }
+  Scope(const char* name, std::string_view detail) : Scope(name) {
+    if (m_name)
+      m_detail = detail;
+  }
+  ~Scope() {
+    if (m_name)
+      Record(m_name, m_begin, m_detail);
+  }
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+};
+
+} // namespace hecl::trace
+
+#define HECL_TRACE_CONCAT2(a, b) a##b
+#define HECL_TRACE_CONCAT(a, b) HECL_TRACE_CONCAT2(a, b)
+#define HECL_TRACE_SCOPE(...) hecl::trace::Scope HECL_TRACE_CONCAT(_heclTraceScope, __LINE__)(__VA_ARGS__)
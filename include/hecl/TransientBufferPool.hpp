@@ -0,0 +1,156 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "hecl/BufferPoolStats.hpp"
+
+#include <boo/BooObject.hpp>
+#include <boo/graphicsdev/IGraphicsDataFactory.hpp>
+
+namespace hecl {
+
+#define HECL_TRANSIENTPOOL_ALLOCATION_BLOCK 262144
+
+/** Companion to UniformBufferPool for uniform data rewritten every frame.
+ *
+ *  Each of FrameCount frame slots owns a list of 256K buckets that are bump
+ *  allocated from the start during a frame. updateBuffers() uploads the used
+ *  extent of the current slot's buckets and then rotates to the next slot, which
+ *  is reused as a whole: its buckets were last bound FrameCount - 1 frames ago.
+ *  Nothing is tracked per element and nothing needs releasing.
+ *
+ *  Allocations are only valid until the next updateBuffers() of their slot;
+ *  bindings may be cached per slot and bucket since bucket buffers persist. */
+template <typename UniformStruct, size_t FrameCount = 3>
+class TransientBufferPool : public BufferPoolBase {
+public:
+  /* Signed index type matching UniformBufferPool */
+#if _WIN32
+  using IndexTp = SSIZE_T;
+#else
+  using IndexTp = ssize_t;
+#endif
+private:
+  static_assert(FrameCount > 0, "at least one frame slot required");
+
+  /** Size of single element, rounded up to 256-multiple */
+  static constexpr IndexTp m_stride = ROUND_UP_256(sizeof(UniformStruct));
+  static_assert(m_stride <= HECL_TRANSIENTPOOL_ALLOCATION_BLOCK, "Stride too large for transient pool");
+
+  /** Number of rounded elements per 256K bucket */
+  static constexpr IndexTp m_countPerBucket = HECL_TRANSIENTPOOL_ALLOCATION_BLOCK / m_stride;
+
+  /** Buffer size per bucket (ideally 256K) */
+  static constexpr IndexTp m_sizePerBucket = m_stride * m_countPerBucket;
+
+  struct Bucket {
+    boo::ObjToken<boo::IGraphicsBufferD> buffer;
+    std::unique_ptr<uint8_t[]> cpuBuffer;
+  };
+
+  struct Frame {
+    std::vector<std::unique_ptr<Bucket>> buckets;
+    /** Elements handed out this frame; doubles as the bump pointer */
+    IndexTp used = 0;
+  };
+  Frame m_frames[FrameCount];
+  size_t m_curFrame = 0;
+
+  /** Running counters; live elements are those handed out this frame */
+  BufferPoolStats m_counters;
+
+public:
+  /** Frame-lifetime element; trivially copyable and never released */
+  class Allocation {
+    friend class TransientBufferPool;
+    Bucket* m_bucket = nullptr;
+    IndexTp m_index = 0;
+    Allocation(Bucket* bucket, IndexTp index) : m_bucket(bucket), m_index(index) {}
+
+  public:
+    Allocation() = default;
+
+    UniformStruct& access() const {
+      return reinterpret_cast<UniformStruct&>(m_bucket->cpuBuffer[m_index * m_stride]);
+    }
+
+    std::pair<boo::ObjToken<boo::IGraphicsBufferD>, IndexTp> getBufferInfo() const {
+      return {m_bucket->buffer, m_index * m_stride};
+    }
+
+    explicit operator bool() const { return m_bucket != nullptr; }
+  };
+
+  TransientBufferPool() : BufferPoolBase("TransientBufferPool") {}
+  TransientBufferPool(const TransientBufferPool& other) = delete;
+  TransientBufferPool& operator=(const TransientBufferPool& other) = delete;
+
+  /** Bump allocate one element from the current frame slot */
+  Allocation allocateBlock(boo::IGraphicsDataFactory* factory) {
+    Frame& frame = m_frames[m_curFrame];
+    const IndexTp bucketIdx = frame.used / m_countPerBucket;
+    const IndexTp index = frame.used % m_countPerBucket;
+    ++frame.used;
+    ++m_counters.m_allocations;
+    m_counters.m_peakLiveElements = std::max(m_counters.m_peakLiveElements, size_t(frame.used));
+    if (bucketIdx == IndexTp(frame.buckets.size())) {
+      auto& bucket = frame.buckets.emplace_back(std::make_unique<Bucket>());
+      bucket->buffer = factory->newPoolBuffer(boo::BufferUse::Uniform, m_stride, m_countPerBucket BooTrace);
+      bucket->cpuBuffer = std::make_unique<uint8_t[]>(m_sizePerBucket);
+    }
+    return Allocation(frame.buckets[bucketIdx].get(), index);
+  }
+
+  /** Load this frame's allocations into GPU and advance to the next frame slot */
+  void updateBuffers() {
+    Frame& frame = m_frames[m_curFrame];
+    IndexTp remaining = frame.used;
+    size_t bytes = 0;
+    for (auto& bucket : frame.buckets) {
+      if (remaining <= 0)
+        break;
+      const IndexTp count = std::min(remaining, m_countPerBucket);
+      bucket->buffer->load(bucket->cpuBuffer.get(), count * m_stride);
+      bytes += count * m_stride;
+      remaining -= count;
+    }
+    m_counters.m_lastUploadBytes = bytes;
+    m_counters.m_totalUploadBytes += bytes;
+    m_curFrame = (m_curFrame + 1) % FrameCount;
+    m_frames[m_curFrame].used = 0;
+  }
+
+  /** Index of the slot currently being allocated from, for per-slot binding caches */
+  size_t currentFrame() const { return m_curFrame; }
+
+  void doDestroy() {
+    for (Frame& frame : m_frames) {
+      frame.buckets.clear();
+      frame.used = 0;
+    }
+  }
+
+  static constexpr IndexTp bucketCapacity() { return m_countPerBucket; }
+
+  BufferPoolStats stats() override {
+    BufferPoolStats ret = m_counters;
+    _fillCommon(ret);
+    ret.m_stride = m_stride;
+    for (const Frame& frame : m_frames)
+      ret.m_bucketCount += frame.buckets.size();
+    ret.m_bucketSize = m_sizePerBucket;
+    const Frame& frame = m_frames[m_curFrame];
+    ret.m_liveElements = frame.used;
+    ret.m_freeElements = frame.buckets.size() * m_countPerBucket - frame.used;
+    /* Bump allocation leaves a single free run per frame slot */
+    ret.m_largestFreeRange = ret.m_freeElements;
+    return ret;
+  }
+};
+
+} // namespace hecl
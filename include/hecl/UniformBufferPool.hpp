@@ -1,13 +1,19 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "hecl/BitVector.hpp"
+#include "hecl/BufferPoolStats.hpp"
 
 #include <boo/BooObject.hpp>
 #include <boo/graphicsdev/IGraphicsDataFactory.hpp>
@@ -21,9 +27,13 @@ namespace hecl {
  *
  *  This results in a space-efficient way of managing GPU data of things like UI
  *  widgets. These can potentially have numerous binding instances, so this avoids
- *  allocating a full GPU buffer object for each. */
+ *  allocating a full GPU buffer object for each.
+ *
+ *  Tokens may be allocated and released from any thread; a ThreadCache lets a
+ *  worker thread do so without taking the pool lock for each token. access()
+ *  and updateBuffers() remain render-thread operations. */
 template <typename UniformStruct>
-class UniformBufferPool {
+class UniformBufferPool : public BufferPoolBase {
 public:
   /* Resolve div_t type using ssize_t as basis */
 #if _WIN32
@@ -31,6 +41,8 @@ public:
 #else
   using IndexTp = ssize_t;
 #endif
+  class ThreadCache;
+
 private:
   struct InvalidTp {};
   using DivTp = std::conditional_t<
@@ -52,135 +64,345 @@ private:
   /** BitVector indicating free allocation blocks */
   hecl::llvm::BitVector m_freeBlocks;
 
+  /** Guards m_freeBlocks, m_buckets, m_counters and bucket buffer lifetime */
+  std::mutex m_mutex;
+
   /** Efficient way to get bucket and block simultaneously */
   DivTp getBucketDiv(IndexTp idx) const { return std::div(idx, m_countPerBucket); }
 
   /** Factory pointer for building additional buffers */
   boo::IGraphicsDataFactory* m_factory = nullptr;
 
+  /** Running counters; stats() fills in the remaining fields */
+  BufferPoolStats m_counters;
+
+  /** Signed live count behind m_counters.m_liveElements; a token from a ThreadCache released on
+   *  another thread is accounted here before its cache reports the allocation, dipping it below zero */
+  int64_t m_live = 0;
+
+  /** Buckets created from now on keep their buffer mapped */
+  bool m_persistentMap = false;
+
   /** Private bucket info */
   struct Bucket {
     boo::ObjToken<boo::IGraphicsBufferD> buffer;
-    uint8_t* cpuBuffer = nullptr;
+    /* CPU copy of the bucket contents; written by tokens, loaded up to dirtyEnd */
+    std::unique_ptr<uint8_t[]> cpuBuffer;
+    /* Standing mapping of buffer written by tokens in place of cpuBuffer */
+    uint8_t* mapped = nullptr;
     std::atomic_size_t useCount = {};
-    bool dirty = false;
+    /** One past the highest element written since the last upload */
+    IndexTp dirtyEnd = 0;
     Bucket() = default;
     Bucket(const Bucket& other) = delete;
     Bucket& operator=(const Bucket& other) = delete;
-    Bucket(Bucket&& other) = default;
-    Bucket& operator=(Bucket&& other) = default;
+    Bucket(Bucket&& other) = delete;
+    Bucket& operator=(Bucket&& other) = delete;
 
-    void updateBuffer() {
+    size_t updateBuffer(UniformBufferPool& pool) {
       if (useCount == 0) {
         destroy();
-        return;
+        return 0;
       }
-      if (dirty && cpuBuffer) {
+      if (!buffer)
+        createBuffer(pool);
+      if (!dirtyEnd)
+        return 0;
+      size_t bytes;
+      if (mapped) {
+        /* Unmapping flushes the whole mapping; it is re-established for the next frame at once */
         buffer->unmap();
-        cpuBuffer = nullptr;
+        mapped = static_cast<uint8_t*>(buffer->map(m_sizePerBucket));
+        bytes = m_sizePerBucket;
+      } else {
+        bytes = dirtyEnd * m_stride;
+        buffer->load(cpuBuffer.get(), bytes);
       }
-      dirty = false;
+      dirtyEnd = 0;
+      return bytes;
+    }
+
+    uint8_t* access(IndexTp begin, IndexTp count) {
+      dirtyEnd = std::max(dirtyEnd, begin + count);
+      if (mapped)
+        return mapped + begin * m_stride;
+      if (!cpuBuffer)
+        cpuBuffer = std::make_unique<uint8_t[]>(m_sizePerBucket);
+      return &cpuBuffer[begin * m_stride];
     }
 
-    void increment(UniformBufferPool& pool) {
-      if (useCount.fetch_add(1) == 0 && !buffer)
-        buffer = pool.m_factory->newPoolBuffer(boo::BufferUse::Uniform, pool.m_stride, pool.m_countPerBucket BooTrace);
+    /* Only the render thread creates buffers; reservations from a ThreadCache leave it to updateBuffers() */
+    void increment(UniformBufferPool& pool, bool create) {
+      if (useCount.fetch_add(1) == 0 && create && !buffer)
+        createBuffer(pool);
+    }
+
+    void createBuffer(UniformBufferPool& pool) {
+      buffer = pool.m_factory->newPoolBuffer(boo::BufferUse::Uniform, pool.m_stride, pool.m_countPerBucket BooTrace);
+      if (pool.m_persistentMap) {
+        mapped = static_cast<uint8_t*>(buffer->map(m_sizePerBucket));
+        /* Carry over what tokens wrote before the buffer existed; dirtyEnd still covers it */
+        if (cpuBuffer) {
+          std::memcpy(mapped, cpuBuffer.get(), dirtyEnd * m_stride);
+          cpuBuffer.reset();
+        }
+      }
     }
 
     void decrement(UniformBufferPool& pool) {
       --useCount;
     }
 
-    void destroy() {
-      if (cpuBuffer) {
+    void releaseBuffer() {
+      if (mapped) {
         buffer->unmap();
-        cpuBuffer = nullptr;
+        mapped = nullptr;
       }
       buffer.reset();
     }
+
+    void destroy() {
+      cpuBuffer.reset();
+      dirtyEnd = 0;
+      releaseBuffer();
+    }
   };
+  /* Buckets are individually heap allocated and never removed, so Bucket pointers stay valid */
   std::vector<std::unique_ptr<Bucket>> m_buckets;
 
+  /** Claim a free block, growing the pool if needed; requires m_mutex */
+  Bucket* _reserve(IndexTp& index, bool createBuffer) {
+    int idx = m_freeBlocks.find_first();
+    if (idx == -1) {
+      m_buckets.push_back(std::make_unique<Bucket>());
+      idx = m_freeBlocks.size();
+      m_freeBlocks.resize(m_freeBlocks.size() + m_countPerBucket, true);
+    }
+    m_freeBlocks.reset(idx);
+    index = idx;
+    Bucket* bucket = m_buckets[getBucketDiv(index).quot].get();
+    bucket->increment(*this, createBuffer);
+    return bucket;
+  }
+
+  /** Return a block claimed by _reserve(); requires m_mutex */
+  void _unreserve(IndexTp index, Bucket* bucket) {
+    m_freeBlocks.set(index);
+    bucket->decrement(*this);
+  }
+
+  /** Fold allocations made or released outside the lock into m_counters; requires m_mutex */
+  void _account(uint64_t allocations, uint64_t releases) {
+    m_counters.m_allocations += allocations;
+    m_counters.m_releases += releases;
+    m_live += int64_t(allocations) - int64_t(releases);
+    m_counters.m_liveElements = size_t(std::max(m_live, int64_t(0)));
+    m_counters.m_peakLiveElements = std::max(m_counters.m_peakLiveElements, m_counters.m_liveElements);
+  }
+
 public:
   /** User block-owning token */
   class Token {
     friend class UniformBufferPool;
     UniformBufferPool* m_pool = nullptr;
+    Bucket* m_bucket = nullptr;
+    /* Cache the block came from; released blocks go back to it when on its thread */
+    ThreadCache* m_cache = nullptr;
+    /* Thread owning m_cache, compared before m_cache is touched since the cache may be gone on others */
+    std::thread::id m_cacheThread;
     IndexTp m_index = -1;
     DivTp m_div;
-    Token(UniformBufferPool* pool) : m_pool(pool) {
-      auto& freeSpaces = pool->m_freeBlocks;
-      int idx = freeSpaces.find_first();
-      if (idx == -1) {
-        pool->m_buckets.push_back(std::make_unique<Bucket>());
-        m_index = freeSpaces.size();
-        freeSpaces.resize(freeSpaces.size() + pool->m_countPerBucket, true);
-      } else {
-        m_index = idx;
-      }
-      freeSpaces.reset(m_index);
-      m_div = pool->getBucketDiv(m_index);
-
-      Bucket& bucket = *m_pool->m_buckets[m_div.quot];
-      bucket.increment(*m_pool);
+    Token(UniformBufferPool* pool, Bucket* bucket, IndexTp index, ThreadCache* cache)
+    : m_pool(pool), m_bucket(bucket), m_cache(cache), m_index(index), m_div(pool->getBucketDiv(index)) {
+      if (cache)
+        m_cacheThread = cache->m_thread;
     }
 
   public:
     Token() = default;
     Token(const Token& other) = delete;
     Token& operator=(const Token& other) = delete;
+    /* Swaps, so any block held before is released along with other */
     Token& operator=(Token&& other) noexcept {
-      m_pool = other.m_pool;
-      m_index = other.m_index;
-      m_div = other.m_div;
-      other.m_index = -1;
+      std::swap(m_pool, other.m_pool);
+      std::swap(m_bucket, other.m_bucket);
+      std::swap(m_cache, other.m_cache);
+      std::swap(m_cacheThread, other.m_cacheThread);
+      std::swap(m_index, other.m_index);
+      std::swap(m_div, other.m_div);
       return *this;
     }
-    Token(Token&& other) noexcept : m_pool(other.m_pool), m_index(other.m_index), m_div(other.m_div) { other.m_index = -1; }
+    Token(Token&& other) noexcept
+    : m_pool(other.m_pool), m_bucket(other.m_bucket), m_cache(other.m_cache), m_cacheThread(other.m_cacheThread)
+    , m_index(other.m_index), m_div(other.m_div) {
+      other.m_index = -1;
+    }
 
     ~Token() {
-      if (m_index != -1) {
-        m_pool->m_freeBlocks.set(m_index);
-        Bucket& bucket = *m_pool->m_buckets[m_div.quot];
-        bucket.decrement(*m_pool);
+      if (m_index == -1)
+        return;
+      if (m_cache && m_cacheThread == std::this_thread::get_id()) {
+        m_cache->_release(m_index, m_bucket);
+        return;
       }
+      std::lock_guard lk{m_pool->m_mutex};
+      m_pool->_unreserve(m_index, m_bucket);
+      m_pool->_account(0, 1);
     }
 
     UniformStruct& access() {
-      Bucket& bucket = *m_pool->m_buckets[m_div.quot];
-      if (!bucket.cpuBuffer)
-        bucket.cpuBuffer = reinterpret_cast<uint8_t*>(bucket.buffer->map(m_sizePerBucket));
-      bucket.dirty = true;
-      return reinterpret_cast<UniformStruct&>(bucket.cpuBuffer[m_div.rem * m_pool->m_stride]);
+      return *reinterpret_cast<UniformStruct*>(m_bucket->access(m_div.rem, 1));
     }
 
+    /** Buffer is null for a ThreadCache block whose bucket is new until the next updateBuffers() */
     std::pair<boo::ObjToken<boo::IGraphicsBufferD>, IndexTp> getBufferInfo() const {
-      Bucket& bucket = *m_pool->m_buckets[m_div.quot];
-      return {bucket.buffer, m_div.rem * m_pool->m_stride};
+      return {m_bucket->buffer, m_div.rem * m_pool->m_stride};
     }
 
     explicit operator bool() const { return m_pool != nullptr && m_index != -1; }
   };
 
-  UniformBufferPool() = default;
+  /**
+   * @brief Per-thread stock of reserved blocks for lock-free allocation
+   *
+   * Owned by one thread, which allocates from it without locking; the pool
+   * lock is only taken to refill or trim the stock a batch at a time. Tokens
+   * released on the owning thread return to the stock, others go straight
+   * back to the pool. The cache must outlive tokens released on its thread.
+   * Pool statistics catch up with a cache's allocations at each refill or trim.
+   * Caches never create GPU buffers; a bucket first reserved through one gets
+   * its buffer from the next updateBuffers() on the render thread, and its
+   * tokens are written through a CPU copy until then.
+   */
+  class ThreadCache {
+    friend class Token;
+    struct Entry {
+      IndexTp m_index;
+      Bucket* m_bucket;
+    };
+    UniformBufferPool& m_pool;
+    boo::IGraphicsDataFactory* m_factory;
+    std::thread::id m_thread = std::this_thread::get_id();
+    size_t m_batch;
+    std::vector<Entry> m_stock;
+    uint64_t m_allocations = 0;
+    uint64_t m_releases = 0;
+
+    /* Requires the pool lock */
+    void _account() {
+      m_pool._account(m_allocations, m_releases);
+      m_allocations = 0;
+      m_releases = 0;
+    }
+
+    void _refill() {
+      std::lock_guard lk{m_pool.m_mutex};
+      m_pool.m_factory = m_factory;
+      for (size_t i = 0; i < m_batch; ++i) {
+        Entry& ent = m_stock.emplace_back();
+        ent.m_bucket = m_pool._reserve(ent.m_index, false);
+      }
+      _account();
+    }
+
+    void _release(IndexTp index, Bucket* bucket) {
+      m_stock.push_back({index, bucket});
+      ++m_releases;
+      if (m_stock.size() <= m_batch * 2)
+        return;
+      std::lock_guard lk{m_pool.m_mutex};
+      while (m_stock.size() > m_batch) {
+        m_pool._unreserve(m_stock.back().m_index, m_stock.back().m_bucket);
+        m_stock.pop_back();
+      }
+      _account();
+    }
+
+  public:
+    ThreadCache(UniformBufferPool& pool, boo::IGraphicsDataFactory* factory, size_t batch = 64)
+    : m_pool(pool), m_factory(factory), m_batch(std::max(batch, size_t(1))) {
+      m_stock.reserve(m_batch * 2 + 1);
+    }
+    ~ThreadCache() {
+      std::lock_guard lk{m_pool.m_mutex};
+      for (const Entry& ent : m_stock)
+        m_pool._unreserve(ent.m_index, ent.m_bucket);
+      _account();
+    }
+    ThreadCache(const ThreadCache& other) = delete;
+    ThreadCache& operator=(const ThreadCache& other) = delete;
+
+    /** Allocate a block into a client-owned Token; only on the thread that created the cache */
+    Token allocateBlock() {
+      if (m_stock.empty())
+        _refill();
+      const Entry ent = m_stock.back();
+      m_stock.pop_back();
+      ++m_allocations;
+      return Token(&m_pool, ent.m_bucket, ent.m_index, this);
+    }
+  };
+
+  UniformBufferPool() : BufferPoolBase("UniformBufferPool") {}
   UniformBufferPool(const UniformBufferPool& other) = delete;
   UniformBufferPool& operator=(const UniformBufferPool& other) = delete;
 
-  /** Load dirty buffer data into GPU */
+  /**
+   * @brief Keep bucket buffers mapped instead of uploading a CPU copy
+   *
+   * Tokens then write through the buffer's mapping and updateBuffers() only
+   * unmaps buckets written since the last update, flushing them. Suits backends
+   * whose dynamic buffer mappings keep their contents across unmap and map,
+   * such as boo's CPU-staged dynamic buffers. Applies to buckets created after
+   * the call; set it before the first allocation.
+   */
+  void setPersistentMapping(bool persistent) {
+    std::lock_guard lk{m_mutex};
+    m_persistentMap = persistent;
+  }
+
+  /**
+   * @brief Load dirty buffer data into GPU
+   *
+   * A bucket's CPU copy is uploaded only up to its highest written element;
+   * a mapped bucket is flushed whole and reported as such in the upload stats.
+   */
   void updateBuffers() {
+    std::lock_guard lk{m_mutex};
+    size_t bytes = 0;
     for (auto& bucket : m_buckets)
-      bucket->updateBuffer();
+      bytes += bucket->updateBuffer(*this);
+    m_counters.m_lastUploadBytes = bytes;
+    m_counters.m_totalUploadBytes += bytes;
   }
 
   /** Allocate free block into client-owned Token */
   Token allocateBlock(boo::IGraphicsDataFactory* factory) {
+    std::lock_guard lk{m_mutex};
     m_factory = factory;
-    return Token(this);
+    IndexTp index;
+    Bucket* bucket = _reserve(index, true);
+    _account(1, 0);
+    return Token(this, bucket, index, nullptr);
   }
 
   void doDestroy() {
+    std::lock_guard lk{m_mutex};
     for (auto& bucket : m_buckets)
-      bucket->buffer.reset();
+      bucket->releaseBuffer();
+  }
+
+  BufferPoolStats stats() override {
+    std::lock_guard lk{m_mutex};
+    BufferPoolStats ret = m_counters;
+    _fillCommon(ret);
+    ret.m_stride = m_stride;
+    ret.m_bucketCount = m_buckets.size();
+    ret.m_bucketSize = m_sizePerBucket;
+    ret.m_freeElements = m_freeBlocks.count();
+    /* Blocks are single elements, so any free block satisfies an allocation */
+    ret.m_largestFreeRange = ret.m_freeElements;
+    return ret;
   }
 };
 
@@ -1,14 +1,17 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <cassert>
 #include <cstdint>
 #include <cstdlib>
 #include <memory>
+#include <mutex>
 #include <type_traits>
 #include <vector>
 
-#include "hecl/BitVector.hpp"
+#include "hecl/BufferPoolStats.hpp"
+#include "hecl/RangeAllocator.hpp"
 
 #include <boo/BooObject.hpp>
 #include <boo/graphicsdev/IGraphicsDataFactory.hpp>
@@ -22,9 +25,12 @@ namespace hecl {
  *
  *  This results in a space-efficient way of managing GPU data of things like UI
  *  widgets. These can potentially have numerous binding instances, so this avoids
- *  allocating a full GPU buffer object for each. */
+ *  allocating a full GPU buffer object for each.
+ *
+ *  Tokens may be allocated and released from any thread; access() and
+ *  updateBuffers() remain render-thread operations. */
 template <typename VertStruct>
-class VertexBufferPool {
+class VertexBufferPool : public BufferPoolBase {
 public:
   /* Resolve div_t type using ssize_t as basis */
 #if _WIN32
@@ -50,8 +56,11 @@ private:
   /** Buffer size per bucket (ideally 256K) */
   static constexpr IndexTp m_sizePerBucket = m_stride * m_countPerBucket;
 
-  /** BitVector indicating free allocation elements */
-  hecl::llvm::BitVector m_freeElements;
+  /** Free element ranges; never coalesced across buckets */
+  RangeAllocator m_freeElements{uint32_t(m_countPerBucket)};
+
+  /** Guards m_freeElements, m_buckets and bucket buffer lifetime */
+  std::mutex m_mutex;
 
   /** Efficient way to get bucket and element simultaneously */
   DivTp getBucketDiv(IndexTp idx) const { return std::div(idx, m_countPerBucket); }
@@ -59,28 +68,41 @@ private:
   /** Factory pointer for building additional buffers */
   boo::IGraphicsDataFactory* m_factory = nullptr;
 
+  /** Running counters; stats() fills in the remaining fields */
+  BufferPoolStats m_counters;
+
   /** Private bucket info */
   struct Bucket {
     boo::ObjToken<boo::IGraphicsBufferD> buffer;
-    uint8_t* cpuBuffer = nullptr;
+    /* CPU copy of the bucket contents; written by tokens, loaded up to dirtyEnd */
+    std::unique_ptr<uint8_t[]> cpuBuffer;
     std::atomic_size_t useCount = {};
-    bool dirty = false;
+    /** One past the highest element written since the last upload */
+    IndexTp dirtyEnd = 0;
     Bucket() = default;
     Bucket(const Bucket& other) = delete;
     Bucket& operator=(const Bucket& other) = delete;
     Bucket(Bucket&& other) = delete;
     Bucket& operator=(Bucket&& other) = delete;
 
-    void updateBuffer() {
+    size_t updateBuffer() {
       if (useCount == 0) {
         destroy();
-        return;
+        return 0;
       }
-      if (dirty && cpuBuffer) {
-        buffer->unmap();
-        cpuBuffer = nullptr;
+      const size_t bytes = dirtyEnd * m_stride;
+      if (bytes) {
+        buffer->load(cpuBuffer.get(), bytes);
+        dirtyEnd = 0;
       }
-      dirty = false;
+      return bytes;
+    }
+
+    uint8_t* access(IndexTp begin, IndexTp count) {
+      if (!cpuBuffer)
+        cpuBuffer = std::make_unique<uint8_t[]>(m_sizePerBucket);
+      dirtyEnd = std::max(dirtyEnd, begin + count);
+      return &cpuBuffer[begin * m_stride];
     }
 
     void increment(VertexBufferPool& pool) {
@@ -93,10 +115,8 @@ private:
     }
 
     void destroy() {
-      if (cpuBuffer) {
-        buffer->unmap();
-        cpuBuffer = nullptr;
-      }
+      cpuBuffer.reset();
+      dirtyEnd = 0;
       buffer.reset();
     }
   };
@@ -107,25 +127,33 @@ public:
   class Token {
     friend class VertexBufferPool;
     VertexBufferPool* m_pool = nullptr;
+    Bucket* m_bucket = nullptr;
     IndexTp m_index = -1;
     IndexTp m_count = 0;
     DivTp m_div;
-    Token(VertexBufferPool* pool, IndexTp count) : m_pool(pool), m_count(count) {
-      assert(count <= pool->m_countPerBucket && "unable to fit in bucket");
+    Token(VertexBufferPool* pool, boo::IGraphicsDataFactory* factory, IndexTp count) : m_pool(pool), m_count(count) {
+      assert(count > 0 && count <= pool->m_countPerBucket && "unable to fit in bucket");
+      std::lock_guard lk{pool->m_mutex};
+      pool->m_factory = factory;
       auto& freeSpaces = pool->m_freeElements;
-      int idx = freeSpaces.find_first_contiguous(count, pool->m_countPerBucket);
-      if (idx == -1) {
+      uint32_t idx = freeSpaces.allocate(uint32_t(count));
+      if (idx == RangeAllocator::InvalidOffset) {
+        const uint32_t bucketStart = uint32_t(pool->m_buckets.size() * pool->m_countPerBucket);
         pool->m_buckets.push_back(std::make_unique<Bucket>());
-        m_index = freeSpaces.size();
-        freeSpaces.resize(freeSpaces.size() + pool->m_countPerBucket, true);
-      } else {
-        m_index = idx;
+        freeSpaces.addRange(bucketStart, uint32_t(pool->m_countPerBucket));
+        idx = freeSpaces.allocate(uint32_t(count));
       }
-      freeSpaces.reset(m_index, m_index + count);
+      m_index = IndexTp(idx);
       m_div = pool->getBucketDiv(m_index);
 
-      Bucket& bucket = *m_pool->m_buckets[m_div.quot];
-      bucket.increment(*pool);
+      /* Buckets are individually heap allocated, so this stays valid as m_buckets grows */
+      m_bucket = pool->m_buckets[m_div.quot].get();
+      m_bucket->increment(*pool);
+
+      auto& counters = pool->m_counters;
+      ++counters.m_allocations;
+      counters.m_liveElements += count;
+      counters.m_peakLiveElements = std::max(counters.m_peakLiveElements, counters.m_liveElements);
     }
 
   public:
@@ -134,62 +162,78 @@ public:
     Token& operator=(const Token& other) = delete;
     Token& operator=(Token&& other) noexcept {
       m_pool = other.m_pool;
+      m_bucket = other.m_bucket;
       m_index = other.m_index;
       m_count = other.m_count;
       m_div = other.m_div;
       other.m_index = -1;
       return *this;
     }
-    Token(Token&& other) noexcept : m_pool(other.m_pool), m_index(other.m_index), m_count(other.m_count), m_div(other.m_div) {
+    Token(Token&& other) noexcept
+    : m_pool(other.m_pool), m_bucket(other.m_bucket), m_index(other.m_index), m_count(other.m_count), m_div(other.m_div) {
       other.m_index = -1;
     }
 
     ~Token() {
       if (m_index != -1) {
-        m_pool->m_freeElements.set(m_index, m_index + m_count);
-        Bucket& bucket = *m_pool->m_buckets[m_div.quot];
-        bucket.decrement(*m_pool);
+        std::lock_guard lk{m_pool->m_mutex};
+        m_pool->m_freeElements.release(uint32_t(m_index), uint32_t(m_count));
+        m_bucket->decrement(*m_pool);
+        ++m_pool->m_counters.m_releases;
+        m_pool->m_counters.m_liveElements -= m_count;
       }
     }
 
     VertStruct* access() {
-      Bucket& bucket = *m_pool->m_buckets[m_div.quot];
-      if (!bucket.cpuBuffer)
-        bucket.cpuBuffer = reinterpret_cast<uint8_t*>(bucket.buffer->map(m_sizePerBucket));
-      bucket.dirty = true;
-      return reinterpret_cast<VertStruct*>(&bucket.cpuBuffer[m_div.rem * m_pool->m_stride]);
+      return reinterpret_cast<VertStruct*>(m_bucket->access(m_div.rem, m_count));
     }
 
     std::pair<boo::ObjToken<boo::IGraphicsBufferD>, IndexTp> getBufferInfo() const {
-      Bucket& bucket = *m_pool->m_buckets[m_div.quot];
+      Bucket& bucket = *m_bucket;
       return {bucket.buffer, m_div.rem};
     }
 
     explicit operator bool() const { return m_pool != nullptr && m_index != -1; }
   };
 
-  VertexBufferPool() = default;
+  VertexBufferPool() : BufferPoolBase("VertexBufferPool") {}
   VertexBufferPool(const VertexBufferPool& other) = delete;
   VertexBufferPool& operator=(const VertexBufferPool& other) = delete;
 
-  /** Load dirty buffer data into GPU */
+  /** Load dirty buffer data into GPU; a bucket is uploaded only up to its highest written element */
   void updateBuffers() {
+    std::lock_guard lk{m_mutex};
+    size_t bytes = 0;
     for (auto& bucket : m_buckets)
-      bucket->updateBuffer();
+      bytes += bucket->updateBuffer();
+    m_counters.m_lastUploadBytes = bytes;
+    m_counters.m_totalUploadBytes += bytes;
   }
 
   /** Allocate free block into client-owned Token */
   Token allocateBlock(boo::IGraphicsDataFactory* factory, IndexTp count) {
-    m_factory = factory;
-    return Token(this, count);
+    return Token(this, factory, count);
   }
 
   void doDestroy() {
+    std::lock_guard lk{m_mutex};
     for (auto& bucket : m_buckets)
       bucket->buffer.reset();
   }
 
   static constexpr IndexTp bucketCapacity() { return m_countPerBucket; }
+
+  BufferPoolStats stats() override {
+    std::lock_guard lk{m_mutex};
+    BufferPoolStats ret = m_counters;
+    _fillCommon(ret);
+    ret.m_stride = m_stride;
+    ret.m_bucketCount = m_buckets.size();
+    ret.m_bucketSize = m_sizePerBucket;
+    ret.m_freeElements = m_freeElements.freeTotal();
+    ret.m_largestFreeRange = m_freeElements.largestFree();
+    return ret;
+  }
 };
 
 } // namespace hecl
@@ -35,6 +35,7 @@ extern "C" int rep_closefrom(int lower);
 #include <functional>
 #include <list>
 #include <map>
+#include <memory>
 #include <regex>
 #include <string>
 
@@ -427,6 +428,7 @@ inline int ConsoleWidth(bool* ok = nullptr) {
 
 class MultiProgressPrinter;
 class ProjectRootPath;
+class StatCache;
 
 using SystemRegex = std::basic_regex<SystemChar>;
 using SystemRegexIterator = std::regex_iterator<SystemString::const_iterator>;
@@ -434,6 +436,22 @@ using SystemRegexMatch = std::match_results<SystemString::const_iterator>;
 using SystemViewRegexMatch = std::match_results<SystemStringView::const_iterator>;
 using SystemRegexTokenIterator = std::regex_token_iterator<SystemString::const_iterator>;
 
+#if defined(XXH_VERSION_NUMBER) && XXH_VERSION_NUMBER >= 800
+#define HECL_HAS_XXH3 1
+#else
+#define HECL_HAS_XXH3 0
+#endif
+
+/**
+ * @brief Digest algorithm behind a Hash
+ *
+ * Persistent formats record which algorithm produced their digests, so
+ * values must never be renumbered. XXH64 remains the default everywhere a
+ * digest is already stored; XXH3 is considerably faster on short keys and
+ * vectorized on large blobs, and requires xxHash 0.8.
+ */
+enum class HashAlgorithm : uint32_t { XXH64 = 0, XXH3 = 1 };
+
 /**
  * @brief Hash representation used for all storable and comparable objects
  *
@@ -452,6 +470,35 @@ public:
   explicit Hash(const void* buf, size_t len) noexcept : hash(XXH64(buf, len, 0)) {}
   explicit Hash(std::string_view str) noexcept : hash(XXH64(str.data(), str.size(), 0)) {}
   explicit Hash(std::wstring_view str) noexcept : hash(XXH64(str.data(), str.size() * 2, 0)) {}
+  Hash(HashAlgorithm alg, const void* buf, size_t len) noexcept : hash(Digest(alg, buf, len)) {}
+
+  /** Preferred algorithm for formats that don't have to match existing digests */
+  static constexpr HashAlgorithm Fastest = HECL_HAS_XXH3 ? HashAlgorithm::XXH3 : HashAlgorithm::XXH64;
+  static constexpr bool IsAvailable(HashAlgorithm alg) noexcept {
+    return alg == HashAlgorithm::XXH64 || (HECL_HAS_XXH3 && alg == HashAlgorithm::XXH3);
+  }
+
+  static uint64_t Digest([[maybe_unused]] HashAlgorithm alg, const void* buf, size_t len) noexcept {
+#if HECL_HAS_XXH3
+    if (alg == HashAlgorithm::XXH3)
+      return XXH3_64bits(buf, len);
+#endif
+    return XXH64(buf, len, 0);
+  }
+
+  /** Hash count small keys into out, dispatching on the algorithm once */
+  static void Batch([[maybe_unused]] HashAlgorithm alg, const std::string_view* keys, size_t count,
+                    Hash* out) noexcept {
+#if HECL_HAS_XXH3
+    if (alg == HashAlgorithm::XXH3) {
+      for (size_t i = 0; i < count; ++i)
+        out[i].hash = XXH3_64bits(keys[i].data(), keys[i].size());
+      return;
+    }
+#endif
+    for (size_t i = 0; i < count; ++i)
+      out[i].hash = XXH64(keys[i].data(), keys[i].size(), 0);
+  }
 
   constexpr uint32_t val32() const noexcept { return uint32_t(hash) ^ uint32_t(hash >> 32); }
   constexpr uint64_t val64() const noexcept { return uint64_t(hash); }
@@ -478,6 +525,53 @@ constexpr uint64_t Hash::valT<uint64_t>() const noexcept {
   return val64();
 }
 
+/**
+ * @brief Incremental digest of data arriving in pieces, e.g. file contents read in chunks
+ *
+ * The result equals Hash(alg, ...) of the concatenated pieces.
+ */
+class Hasher {
+  HashAlgorithm m_alg;
+  XXH64_state_t m_xxh64;
+#if HECL_HAS_XXH3
+  struct XXH3StateDeleter {
+    void operator()(XXH3_state_t* st) const noexcept { XXH3_freeState(st); }
+  };
+  std::unique_ptr<XXH3_state_t, XXH3StateDeleter> m_xxh3;
+#endif
+
+public:
+  explicit Hasher(HashAlgorithm alg = HashAlgorithm::XXH64) : m_alg(alg) {
+#if HECL_HAS_XXH3
+    if (m_alg == HashAlgorithm::XXH3) {
+      m_xxh3.reset(XXH3_createState());
+      XXH3_64bits_reset(m_xxh3.get());
+      return;
+    }
+#endif
+    m_alg = HashAlgorithm::XXH64;
+    XXH64_reset(&m_xxh64, 0);
+  }
+
+  void update(const void* buf, size_t len) noexcept {
+#if HECL_HAS_XXH3
+    if (m_alg == HashAlgorithm::XXH3) {
+      XXH3_64bits_update(m_xxh3.get(), buf, len);
+      return;
+    }
+#endif
+    XXH64_update(&m_xxh64, buf, len);
+  }
+
+  Hash digest() const noexcept {
+#if HECL_HAS_XXH3
+    if (m_alg == HashAlgorithm::XXH3)
+      return Hash(uint64_t(XXH3_64bits_digest(m_xxh3.get())));
+#endif
+    return Hash(uint64_t(XXH64_digest(&m_xxh64)));
+  }
+};
+
 /**
  * @brief Timestamp representation used for comparing modtimes of cooked resources
  */
@@ -541,8 +635,11 @@ private:
   std::vector<Entry> m_entries;
 
 public:
+  /**
+   * @param statCache When given, child metadata is looked up through and recorded into this cache
+   */
   DirectoryEnumerator(SystemStringView path, Mode mode = Mode::DirsThenFilesSorted, bool sizeSort = false,
-                      bool reverse = false, bool noHidden = false);
+                      bool reverse = false, bool noHidden = false, StatCache* statCache = nullptr);
 
   explicit operator bool() const { return m_entries.size() != 0; }
   size_t size() const { return m_entries.size(); }
@@ -685,6 +782,24 @@ class ProjectPath {
 #endif
   }
 
+  /* As above, with the hash of m_relPath alone already known */
+  void ComputeHash(Hash relPathHash) {
+#if HECL_UCS2
+    m_utf8AbsPath = WideToUTF8(m_absPath);
+    m_utf8RelPath = WideToUTF8(m_relPath);
+    m_utf8AuxInfo = WideToUTF8(m_auxInfo);
+    if (m_utf8AuxInfo.size())
+      m_hash = Hash(m_utf8RelPath + '|' + m_utf8AuxInfo);
+    else
+      m_hash = relPathHash;
+#else
+    if (m_auxInfo.size())
+      m_hash = Hash(m_relPath + '|' + m_auxInfo);
+    else
+      m_hash = relPathHash;
+#endif
+  }
+
 public:
   /**
    * @brief Empty constructor
@@ -1154,17 +1269,20 @@ public:
  * @brief Mutex-style centralized resource-path tracking
  *
  * Provides a means to safely parallelize resource processing; detecting when another
- * thread is working on the same resource.
+ * thread is working on the same resource. A thread may hold one lock at a time.
  */
 class ResourceLock {
-  static bool SetThreadRes(const ProjectPath& path);
+  static bool SetThreadRes(const ProjectPath& path, bool wait);
   static void ClearThreadRes();
   bool good;
 
 public:
   explicit operator bool() const { return good; }
   static bool InProgress(const ProjectPath& path);
-  explicit ResourceLock(const ProjectPath& path) : good{SetThreadRes(path)} {}
+  /** Block until no other thread holds path */
+  static void WaitUntilReleased(const ProjectPath& path);
+  /** Take path's lock, failing if another thread holds it; or, if wait, parking until it is released */
+  explicit ResourceLock(const ProjectPath& path, bool wait = false) : good{SetThreadRes(path, wait)} {}
   ~ResourceLock() {
     if (good)
       ClearThreadRes();
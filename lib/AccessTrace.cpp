@@ -0,0 +1,169 @@
+#include "hecl/AccessTrace.hpp"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+
+#include "hecl/Trace.hpp"
+#include "hecl/hecl.hpp"
+
+#include <logvisor/logvisor.hpp>
+
+namespace hecl {
+
+static logvisor::Module Log("hecl::AccessTrace");
+
+/* First line of every capture; bumped if the columns change */
+constexpr std::string_view CaptureHeader = "# hecl access trace 1\n";
+
+namespace access {
+
+std::atomic_bool Active = false;
+
+namespace {
+struct Request {
+  uint64_t m_time;
+  uint64_t m_offset;
+  uint64_t m_len;
+  std::string m_path;
+};
+
+/* Buffer reads are rare relative to the cost of a read, so a single lock suffices */
+struct Capture {
+  std::mutex m_mutex;
+  std::vector<Request> m_requests;
+  UniqueFilePtr m_file;
+  SystemString m_path;
+  uint64_t m_start = 0;
+};
+
+Capture& GetCapture() {
+  static Capture capture;
+  return capture;
+}
+} // anonymous namespace
+
+bool Start(SystemStringView path) {
+  Capture& cap = GetCapture();
+  std::unique_lock lk{cap.m_mutex};
+  if (Active)
+    return false;
+  cap.m_path = path;
+  cap.m_file = hecl::FopenUnique(cap.m_path.c_str(), _SYS_STR("wb"));
+  if (!cap.m_file) {
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to open access trace '{}'")), cap.m_path);
+    return false;
+  }
+  cap.m_requests.clear();
+  cap.m_start = trace::Now();
+  Active = true;
+  return true;
+}
+
+void Stop() {
+  Capture& cap = GetCapture();
+  std::unique_lock lk{cap.m_mutex};
+  if (!Active)
+    return;
+  Active = false;
+
+  /* Nanoseconds from Start(), offset, length, project-relative path */
+  FILE* fp = cap.m_file.get();
+  std::fwrite(CaptureHeader.data(), 1, CaptureHeader.size(), fp);
+  for (const Request& req : cap.m_requests)
+    std::fprintf(fp, "%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%s\n", req.m_time - cap.m_start, req.m_offset, req.m_len,
+                 req.m_path.c_str());
+  if (std::fflush(fp))
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to write access trace '{}'")), cap.m_path);
+  cap.m_file.reset();
+  cap.m_requests = std::vector<Request>();
+}
+
+void Record(const ProjectPath& path, uint64_t offset, uint64_t len) {
+  if (!Active.load(std::memory_order_relaxed))
+    return;
+  const uint64_t time = trace::Now();
+  std::string relPath(path.getRelativePathUTF8());
+  Capture& cap = GetCapture();
+  std::unique_lock lk{cap.m_mutex};
+  if (Active)
+    cap.m_requests.push_back({time, offset, len, std::move(relPath)});
+}
+
+} // namespace access
+
+static uint64_t HashRelPath(std::string_view relPath) { return XXH64(relPath.data(), relPath.size(), 0); }
+
+bool AccessOrder::load(SystemStringView path) {
+  clear();
+  auto fp = hecl::FopenUnique(SystemString(path).c_str(), _SYS_STR("rb"));
+  if (!fp) {
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to open access trace '{}'")), path);
+    return false;
+  }
+
+  char line[4096];
+  if (!std::fgets(line, sizeof(line), fp.get()) || CaptureHeader != line) {
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("'{}' is not an access trace")), path);
+    return false;
+  }
+  while (std::fgets(line, sizeof(line), fp.get())) {
+    char* cur = line;
+    std::strtoull(cur, &cur, 10);
+    const uint64_t offset = std::strtoull(cur, &cur, 10);
+    const uint64_t len = std::strtoull(cur, &cur, 10);
+    if (*cur != '\t')
+      continue;
+    std::string_view relPath(cur + 1);
+    while (!relPath.empty() && (relPath.back() == '\n' || relPath.back() == '\r'))
+      relPath.remove_suffix(1);
+
+    /* Requests are in capture order, so the first one seen for a path or range is its rank */
+    const uint64_t hash = HashRelPath(relPath);
+    const size_t requestRank = m_count++;
+    m_fileRanks.try_emplace(hash, requestRank);
+    if (len)
+      m_ranges[hash].push_back({offset, offset + len, requestRank});
+  }
+
+  /* Keep the earliest request per start offset, ordered for lookup */
+  for (auto& [hash, ranges] : m_ranges) {
+    std::stable_sort(ranges.begin(), ranges.end(),
+                     [](const Range& a, const Range& b) { return a.m_offset < b.m_offset; });
+    ranges.erase(std::unique(ranges.begin(), ranges.end(),
+                             [](const Range& a, const Range& b) { return a.m_offset == b.m_offset; }),
+                 ranges.end());
+  }
+  return true;
+}
+
+void AccessOrder::clear() {
+  m_fileRanks.clear();
+  m_ranges.clear();
+  m_count = 0;
+}
+
+size_t AccessOrder::rank(const ProjectPath& path) const {
+  auto search = m_fileRanks.find(HashRelPath(path.getRelativePathUTF8()));
+  return search != m_fileRanks.end() ? search->second : Unseen;
+}
+
+size_t AccessOrder::rank(const ProjectPath& path, uint64_t offset) const {
+  auto search = m_ranges.find(HashRelPath(path.getRelativePathUTF8()));
+  if (search == m_ranges.end())
+    return Unseen;
+  /* Ranges may overlap; any that starts at or before offset and reaches past it counts */
+  size_t ret = Unseen;
+  for (const Range& range : search->second) {
+    if (range.m_offset > offset)
+      break;
+    if (offset < range.m_end)
+      ret = std::min(ret, range.m_rank);
+  }
+  return ret;
+}
+
+} // namespace hecl
@@ -0,0 +1,178 @@
+#include "hecl/Blender/Connection.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "hecl/ClientProcess.hpp"
+#include "hecl/Quantize.hpp"
+#include "hecl/Trace.hpp"
+
+#undef min
+#undef max
+
+namespace hecl::blender {
+
+namespace {
+using Sample = std::array<float, 4>;
+
+constexpr float QuantMax = 65535.f;
+
+/* Unused components stay zero, so every loop runs the full width and vectorizes */
+Sample Lerp(const Sample& a, const Sample& b, float t, bool normalize) {
+  Sample ret;
+  for (int c = 0; c < 4; ++c)
+    ret[c] = a[c] + (b[c] - a[c]) * t;
+  if (normalize) {
+    float lenSq = 0.f;
+    for (int c = 0; c < 4; ++c)
+      lenSq += ret[c] * ret[c];
+    if (lenSq > 0.f) {
+      const float inv = 1.f / std::sqrt(lenSq);
+      for (int c = 0; c < 4; ++c)
+        ret[c] *= inv;
+    }
+  }
+  return ret;
+}
+
+bool WithinTolerance(const Sample& a, const Sample& b, float tolerance) {
+  float maxDiff = 0.f;
+  for (int c = 0; c < 4; ++c)
+    maxDiff = std::max(maxDiff, std::abs(a[c] - b[c]));
+  return maxDiff <= tolerance;
+}
+
+/* Greedily extend each segment until an interior sample strays from its chord */
+std::vector<uint32_t> ReduceKeys(const std::vector<Sample>& samples, float tolerance, bool normalize) {
+  const uint32_t count = uint32_t(samples.size());
+  std::vector<uint32_t> keys;
+  if (!count)
+    return keys;
+  keys.push_back(0);
+  uint32_t start = 0;
+  for (uint32_t end = 2; end < count; ++end) {
+    const float invLen = 1.f / float(end - start);
+    for (uint32_t i = start + 1; i < end; ++i) {
+      if (!WithinTolerance(Lerp(samples[start], samples[end], float(i - start) * invLen, normalize), samples[i],
+                           tolerance)) {
+        start = end - 1;
+        keys.push_back(start);
+        break;
+      }
+    }
+  }
+  if (count > 1)
+    keys.push_back(count - 1);
+  return keys;
+}
+
+template <typename GetFunc>
+Action::CompressedCurve CompressCurve(const std::vector<Action::Channel::Key>& keys, uint32_t componentCount,
+                                      bool rotation, float tolerance, GetFunc get) {
+  Action::CompressedCurve ret;
+  ret.componentCount = componentCount;
+  std::vector<Sample> samples;
+  samples.reserve(keys.size());
+  for (const auto& key : keys) {
+    const athena::simd_floats f(get(key).simd);
+    Sample s = {};
+    for (uint32_t c = 0; c < componentCount; ++c)
+      s[c] = f[c];
+    /* Keep consecutive quaternions in one hemisphere so interpolation takes the short path */
+    if (rotation && !samples.empty()) {
+      const Sample& prev = samples.back();
+      if (prev[0] * s[0] + prev[1] * s[1] + prev[2] * s[2] + prev[3] * s[3] < 0.f)
+        for (float& v : s)
+          v = -v;
+    }
+    samples.push_back(s);
+  }
+  if (samples.empty())
+    return ret;
+
+  Sample min = samples.front();
+  Sample max = samples.front();
+  for (const Sample& s : samples) {
+    for (int c = 0; c < 4; ++c) {
+      min[c] = std::min(min[c], s[c]);
+      max[c] = std::max(max[c], s[c]);
+    }
+  }
+  for (int c = 0; c < 4; ++c) {
+    ret.offset[c] = min[c];
+    ret.scale[c] = (max[c] - min[c]) / QuantMax;
+  }
+
+  /* Reduce against the quantized curve so retained keys carry no error beyond quantization */
+  std::vector<uint16_t> quantized(samples.size() * componentCount);
+  for (size_t i = 0; i < samples.size(); ++i) {
+    Sample& s = samples[i];
+    for (uint32_t c = 0; c < componentCount; ++c) {
+      const float range = max[c] - min[c];
+      const uint16_t q = range > 0.f ? FloatToUnorm16((s[c] - ret.offset[c]) / range) : 0;
+      quantized[i * componentCount + c] = q;
+      s[c] = ret.offset[c] + float(q) * ret.scale[c];
+    }
+  }
+
+  ret.keys = ReduceKeys(samples, tolerance, rotation);
+  ret.values.reserve(ret.keys.size() * componentCount);
+  for (uint32_t k : ret.keys)
+    ret.values.insert(ret.values.end(), quantized.begin() + k * componentCount,
+                      quantized.begin() + (k + 1) * componentCount);
+  return ret;
+}
+} // anonymous namespace
+
+std::array<float, 4> Action::CompressedCurve::sample(uint32_t frameIdx) const {
+  const auto decode = [&](size_t keyIdx) {
+    Sample ret = {};
+    for (uint32_t c = 0; c < componentCount; ++c)
+      ret[c] = offset[c] + float(values[keyIdx * componentCount + c]) * scale[c];
+    return ret;
+  };
+  if (keys.empty())
+    return {};
+  const auto it = std::upper_bound(keys.begin(), keys.end(), frameIdx);
+  if (it == keys.begin())
+    return decode(0);
+  if (it == keys.end())
+    return decode(keys.size() - 1);
+  const size_t next = size_t(it - keys.begin());
+  const float t = float(frameIdx - keys[next - 1]) / float(keys[next] - keys[next - 1]);
+  return Lerp(decode(next - 1), decode(next), t, componentCount == 4);
+}
+
+std::vector<Action::CompressedChannel> Action::compress(const CurveCompressionOptions& options) const {
+  HECL_TRACE_SCOPE("compressAction", name);
+  std::vector<CompressedChannel> ret;
+  ret.reserve(channels.size());
+  for (const Channel& channel : channels) {
+    CompressedChannel& out = ret.emplace_back();
+    out.boneName = channel.boneName;
+    out.attrMask = channel.attrMask;
+    if (channel.attrMask & 1)
+      out.rotation = CompressCurve(channel.keys, 4, true, options.rotationTolerance,
+                                   [](const Channel::Key& k) -> const atVec4f& { return k.rotation.val; });
+    if (channel.attrMask & 2)
+      out.position = CompressCurve(channel.keys, 3, false, options.positionTolerance,
+                                   [](const Channel::Key& k) -> const atVec3f& { return k.position.val; });
+    if (channel.attrMask & 4)
+      out.scale = CompressCurve(channel.keys, 3, false, options.scaleTolerance,
+                                [](const Channel::Key& k) -> const atVec3f& { return k.scale.val; });
+  }
+  return ret;
+}
+
+std::vector<std::vector<Action::CompressedChannel>> Action::CompressAll(const std::vector<Action>& actions,
+                                                                       const CurveCompressionOptions& options) {
+  std::vector<std::vector<CompressedChannel>> ret(actions.size());
+  ClientProcess::DistributeWork(actions.size(), 1, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i)
+      ret[i] = actions[i].compress(options);
+  });
+  return ret;
+}
+
+} // namespace hecl::blender
@@ -0,0 +1,244 @@
+#include "hecl/Blender/Connection.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <numeric>
+#include <thread>
+
+#include "hecl/ClientProcess.hpp"
+#include "hecl/Trace.hpp"
+
+namespace hecl::blender {
+
+namespace {
+constexpr uint32_t SAHBins = 16;
+
+/* Subtrees smaller than this aren't worth handing to another thread */
+constexpr size_t ParallelSubtreeMinTris = 4096;
+
+/* Node count marking a subtree left for a worker; offset holds its job index */
+constexpr uint32_t DeferredSubtree = UINT32_MAX;
+
+struct Bounds {
+  std::array<float, 3> min = {FLT_MAX, FLT_MAX, FLT_MAX};
+  std::array<float, 3> max = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+
+  void grow(const std::array<float, 3>& p) {
+    for (int c = 0; c < 3; ++c) {
+      min[c] = std::min(min[c], p[c]);
+      max[c] = std::max(max[c], p[c]);
+    }
+  }
+  void grow(const Bounds& other) {
+    grow(other.min);
+    grow(other.max);
+  }
+  float halfArea() const {
+    if (min[0] > max[0])
+      return 0.f;
+    const float d[3] = {max[0] - min[0], max[1] - min[1], max[2] - min[2]};
+    return d[0] * d[1] + d[1] * d[2] + d[2] * d[0];
+  }
+};
+
+class BVHBuilder {
+  const std::vector<Bounds>& m_triBounds;
+  const std::vector<std::array<float, 3>>& m_centroids;
+  std::vector<uint32_t>& m_triIndices;
+  uint32_t m_maxLeafTris;
+
+  uint32_t binOf(uint32_t tri, int axis, float base, float scale) const {
+    return std::min(SAHBins - 1, uint32_t((m_centroids[tri][axis] - base) * scale));
+  }
+
+  /* Returns the partition point of [begin, end), or end to make a leaf */
+  uint32_t split(uint32_t begin, uint32_t end, const Bounds& bounds, const Bounds& centroidBounds) {
+    const uint32_t count = end - begin;
+    if (count <= 1)
+      return end;
+
+    int bestAxis = -1;
+    uint32_t bestBin = 0;
+    float bestCost = FLT_MAX;
+    for (int axis = 0; axis < 3; ++axis) {
+      const float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+      if (extent <= 0.f)
+        continue;
+      const float base = centroidBounds.min[axis];
+      const float scale = SAHBins / extent;
+
+      Bounds bins[SAHBins];
+      uint32_t counts[SAHBins] = {};
+      for (uint32_t i = begin; i < end; ++i) {
+        const uint32_t tri = m_triIndices[i];
+        const uint32_t bin = binOf(tri, axis, base, scale);
+        bins[bin].grow(m_triBounds[tri]);
+        ++counts[bin];
+      }
+
+      /* Sweep from the right recording suffix costs, then from the left evaluating each plane */
+      float rightCost[SAHBins];
+      Bounds right;
+      uint32_t rightCount = 0;
+      for (uint32_t b = SAHBins - 1; b > 0; --b) {
+        right.grow(bins[b]);
+        rightCount += counts[b];
+        rightCost[b] = rightCount ? right.halfArea() * rightCount : 0.f;
+      }
+      Bounds left;
+      uint32_t leftCount = 0;
+      for (uint32_t b = 0; b < SAHBins - 1; ++b) {
+        left.grow(bins[b]);
+        leftCount += counts[b];
+        if (!leftCount || leftCount == count)
+          continue;
+        const float cost = left.halfArea() * leftCount + rightCost[b + 1];
+        if (cost < bestCost) {
+          bestCost = cost;
+          bestAxis = axis;
+          bestBin = b;
+        }
+      }
+    }
+
+    if (bestAxis < 0) {
+      /* Coincident centroids; halve the range only to respect the leaf size */
+      return count <= m_maxLeafTris ? end : begin + count / 2;
+    }
+
+    /* Unit traversal and intersection costs, in units of surface area */
+    const float area = bounds.halfArea();
+    if (count <= m_maxLeafTris && area * count <= area + bestCost)
+      return end;
+
+    const float base = centroidBounds.min[bestAxis];
+    const float scale = SAHBins / (centroidBounds.max[bestAxis] - base);
+    const auto mid = std::partition(m_triIndices.begin() + begin, m_triIndices.begin() + end, [&](uint32_t tri) {
+      return binOf(tri, bestAxis, base, scale) <= bestBin;
+    });
+    return uint32_t(mid - m_triIndices.begin());
+  }
+
+public:
+  struct Job {
+    uint32_t begin;
+    uint32_t end;
+  };
+
+  BVHBuilder(const std::vector<Bounds>& triBounds, const std::vector<std::array<float, 3>>& centroids,
+             std::vector<uint32_t>& triIndices, uint32_t maxLeafTris)
+  : m_triBounds(triBounds), m_centroids(centroids), m_triIndices(triIndices), m_maxLeafTris(maxLeafTris) {}
+
+  /* Subtrees of at most deferTris are handed to jobs rather than built here, when jobs are collected */
+  void build(std::vector<ColMesh::BVH::Node>& nodes, uint32_t begin, uint32_t end, size_t deferTris,
+             std::vector<Job>* jobs) {
+    Bounds bounds;
+    Bounds centroidBounds;
+    for (uint32_t i = begin; i < end; ++i) {
+      const uint32_t tri = m_triIndices[i];
+      bounds.grow(m_triBounds[tri]);
+      centroidBounds.grow(m_centroids[tri]);
+    }
+
+    const size_t nodeIdx = nodes.size();
+    nodes.push_back({bounds.min, begin, bounds.max, end - begin});
+    if (jobs && end - begin <= deferTris && end - begin > m_maxLeafTris) {
+      nodes[nodeIdx].offset = uint32_t(jobs->size());
+      nodes[nodeIdx].count = DeferredSubtree;
+      jobs->push_back({begin, end});
+      return;
+    }
+
+    const uint32_t mid = split(begin, end, bounds, centroidBounds);
+    if (mid == end)
+      return;
+    build(nodes, begin, mid, deferTris, jobs);
+    nodes[nodeIdx].offset = uint32_t(nodes.size());
+    nodes[nodeIdx].count = 0;
+    build(nodes, mid, end, deferTris, jobs);
+  }
+};
+
+/* Copy the top tree depth-first, substituting each deferred leaf with its worker's subtree */
+void Splice(std::vector<ColMesh::BVH::Node>& out, const std::vector<ColMesh::BVH::Node>& top, size_t topIdx,
+            const std::vector<std::vector<ColMesh::BVH::Node>>& subtrees) {
+  const ColMesh::BVH::Node& node = top[topIdx];
+  if (node.count == DeferredSubtree) {
+    const uint32_t base = uint32_t(out.size());
+    for (ColMesh::BVH::Node sub : subtrees[node.offset]) {
+      if (!sub.count)
+        sub.offset += base;
+      out.push_back(sub);
+    }
+    return;
+  }
+
+  const size_t outIdx = out.size();
+  out.push_back(node);
+  if (node.count)
+    return;
+  Splice(out, top, topIdx + 1, subtrees);
+  out[outIdx].offset = uint32_t(out.size());
+  Splice(out, top, node.offset, subtrees);
+}
+} // anonymous namespace
+
+ColMesh::BVH ColMesh::buildBVH(uint32_t maxLeafTris) const {
+  HECL_TRACE_SCOPE("buildBVH");
+  BVH ret;
+  const uint32_t triCount = uint32_t(trianges.size());
+  if (!triCount)
+    return ret;
+  maxLeafTris = std::max(maxLeafTris, 1u);
+
+  std::vector<Bounds> triBounds(triCount);
+  std::vector<std::array<float, 3>> centroids(triCount);
+  for (uint32_t i = 0; i < triCount; ++i) {
+    Bounds& b = triBounds[i];
+    for (uint32_t e : trianges[i].edges) {
+      for (uint32_t v : edges[e].verts) {
+        const athena::simd_floats f(verts[v].val.simd);
+        b.grow(std::array<float, 3>{f[0], f[1], f[2]});
+      }
+    }
+    for (int c = 0; c < 3; ++c)
+      centroids[i][c] = (b.min[c] + b.max[c]) * 0.5f;
+  }
+
+  ret.triIndices.resize(triCount);
+  std::iota(ret.triIndices.begin(), ret.triIndices.end(), 0u);
+  BVHBuilder builder(triBounds, centroids, ret.triIndices, maxLeafTris);
+
+  /* Subtrees are built by idle cook workers, so only split when running on one */
+  size_t threadCount = 1;
+  if (triCount >= ParallelSubtreeMinTris * 2 && ClientProcess::GetThreadWorkerIdx() >= 0) {
+    const size_t cpuCount = CpuCountOverride > 0 ? size_t(CpuCountOverride) : std::thread::hardware_concurrency();
+    threadCount = std::max(cpuCount, size_t(1));
+  }
+  if (threadCount == 1) {
+    ret.nodes.reserve(triCount * 2 / maxLeafTris + 1);
+    builder.build(ret.nodes, 0, triCount, 0, nullptr);
+    return ret;
+  }
+
+  /* Split serially until subtrees are small enough to balance across workers, then build those in parallel */
+  std::vector<BVH::Node> top;
+  std::vector<BVHBuilder::Job> jobs;
+  builder.build(top, 0, triCount, std::max(ParallelSubtreeMinTris, triCount / (threadCount * 4)), &jobs);
+
+  /* Jobs cover disjoint ranges of triIndices, so they partition it without contention */
+  std::vector<std::vector<BVH::Node>> subtrees(jobs.size());
+  ClientProcess::DistributeWork(jobs.size(), 1, [&](size_t begin, size_t end) {
+    for (size_t j = begin; j < end; ++j)
+      builder.build(subtrees[j], jobs[j].begin, jobs[j].end, 0, nullptr);
+  });
+
+  size_t nodeCount = top.size();
+  for (const auto& sub : subtrees)
+    nodeCount += sub.size();
+  ret.nodes.reserve(nodeCount);
+  Splice(ret.nodes, top, 0, subtrees);
+  return ret;
+}
+
+} // namespace hecl::blender
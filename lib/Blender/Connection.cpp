@@ -12,12 +12,19 @@
 #include <system_error>
 #include <thread>
 #include <tuple>
+#include <type_traits>
 
 #include "hecl/Blender/Connection.hpp"
+#include "hecl/Blender/ResultArena.hpp"
+#include "hecl/Blender/SDNARead.hpp"
 #include "hecl/Blender/Token.hpp"
+#include "hecl/ClientProcess.hpp"
+#include "hecl/CpuTopology.hpp"
 #include "hecl/Database.hpp"
 #include "hecl/hecl.hpp"
+#include "hecl/MappedFile.hpp"
 #include "hecl/SteamFinder.hpp"
+#include "hecl/Trace.hpp"
 #include "MeshOptimizer.hpp"
 
 #include <athena/MemoryWriter.hpp>
@@ -26,7 +33,14 @@
 #if _WIN32
 #include <io.h>
 #include <fcntl.h>
+#include <psapi.h>
 #else
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#if __linux__
+#include <sched.h>
+#endif
 #include <sys/wait.h>
 #endif
 
@@ -56,6 +70,47 @@ static const uint32_t MaxBlenderMinorSearch = 92;
 logvisor::Module BlenderLog("hecl::blender::Connection");
 Token SharedBlenderToken;
 
+/* Connections released by their Tokens; reused before spawning another blender */
+static std::mutex WarmPoolMutex;
+static std::vector<std::unique_ptr<Connection>> WarmPool;
+
+#ifndef _WIN32
+/*
+ * With HECL_BLENDER_FORKSERVER set, one blender loads the addon once and forks every later connection.
+ * Set to "persist", that blender outlives hecl and serves later invocations through a socket in the temp
+ * directory until it sits idle for half an hour.
+ */
+static std::mutex ForkServerMutex;
+static std::unique_ptr<Connection> ForkServerConn;
+static int ForkServerSocket = -1;
+static bool ForkServerFailed = false;
+
+static bool ForkServerEnabled() {
+  const char* env = getenv("HECL_BLENDER_FORKSERVER");
+  return env && *env && std::strcmp(env, "0") != 0;
+}
+
+static bool ForkServerPersistent() {
+  const char* env = getenv("HECL_BLENDER_FORKSERVER");
+  return env && !std::strcmp(env, "persist");
+}
+
+/* Waits on a blender this process forked; fork server children are reaped by the server instead */
+static void ReapBlender(pid_t pid) {
+  int status;
+  while (waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR) {
+      BlenderLog.report(logvisor::Warning, FMT_STRING("unable to wait for blender process {}: {}"), pid,
+                        strerror(errno));
+      return;
+    }
+  }
+  if (WIFSIGNALED(status))
+    BlenderLog.report(logvisor::Warning, FMT_STRING("blender process {} terminated by signal {}"), pid,
+                      WTERMSIG(status));
+}
+#endif
+
 #ifdef __APPLE__
 #define DEFAULT_BLENDER_BIN "/Applications/Blender.app/Contents/MacOS/blender"
 #else
@@ -71,6 +126,30 @@ extern "C" size_t HECL_ADDON_SZ;
 extern "C" uint8_t HECL_STARTUP[];
 extern "C" size_t HECL_STARTUP_SZ;
 
+#ifndef _WIN32
+/* Keyed on what a persistent fork server was launched with, so servers of other hecl builds are left alone */
+static std::string ForkDaemonSocketPath() {
+  uint64_t key = XXH64(HECL_BLENDERSHELL, HECL_BLENDERSHELL_SZ, 0);
+  key = XXH64(HECL_ADDON, HECL_ADDON_SZ, key);
+  if (const char* blenderBin = getenv("BLENDER_BIN"))
+    key = XXH64(blenderBin, std::strlen(blenderBin), key);
+  return fmt::format(FMT_STRING("{}/hecl_forkserver_{}_{:016X}"), GetTmpDir(), getuid(), key);
+}
+
+static int ConnectUnixSocket(const sockaddr_un& addr) {
+  const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+  /* Blenders forked directly must not inherit the connection */
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+  if (connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr))) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+#endif
+
 static void InstallBlendershell(const SystemChar* path) {
   auto fp = hecl::FopenUnique(path, _SYS_STR("w"));
 
@@ -129,11 +208,76 @@ static std::size_t BoundedStrLen(const char* buf, std::size_t maxLen) {
   return ret;
 }
 
+/* Only the leading bytes are inspected, bulk transfers are not rescanned */
+static bool IsExceptionMarker(const void* buf, std::size_t len) {
+  constexpr std::string_view exception_str{"EXCEPTION"};
+  const auto* cBuf = static_cast<const char*>(buf);
+  return BoundedStrLen(cBuf, std::min(len, exception_str.size() + 1)) == exception_str.size() &&
+         std::memcmp(cBuf, exception_str.data(), exception_str.size()) == 0;
+}
+
+void Connection::_resetPipeBuffers() {
+  m_readHead = 0;
+  m_readTail = 0;
+  m_writeBuffer.clear();
+  m_writeBuffer.reserve(PipeBufferSize);
+}
+
+bool Connection::_flushWrite() {
+  const uint8_t* cBuf = m_writeBuffer.data();
+  std::size_t len = m_writeBuffer.size();
+  while (len != 0) {
+    const int ret = Write(m_writepipe[1], cBuf, len);
+    if (ret < 0) {
+      m_writeBuffer.clear();
+      return false;
+    }
+    cBuf += ret;
+    len -= ret;
+  }
+  m_writeBuffer.clear();
+  return true;
+}
+
+bool Connection::_readRaw(void* buf, std::size_t len) {
+  /* Blender only answers after receiving the complete request */
+  if (!m_writeBuffer.empty() && !_flushWrite())
+    return false;
+
+  auto* cBuf = static_cast<uint8_t*>(buf);
+  while (len != 0) {
+    if (m_readHead == m_readTail) {
+      /* Blocking here is time spent waiting on Blender */
+      HECL_TRACE_SCOPE("pipe read");
+      const auto waitStart = std::chrono::steady_clock::now();
+      /* Large transfers bypass the buffer and land directly in the destination */
+      const bool direct = len >= PipeBufferSize;
+      const int ret = direct ? Read(m_readpipe[0], cBuf, len) : Read(m_readpipe[0], m_readBuffer.get(), PipeBufferSize);
+      m_blenderWaitNs += uint64_t(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - waitStart).count());
+      if (ret <= 0)
+        return false;
+      if (direct) {
+        cBuf += ret;
+        len -= ret;
+        continue;
+      }
+      m_readHead = 0;
+      m_readTail = ret;
+    }
+    const std::size_t copyLen = std::min(len, m_readTail - m_readHead);
+    std::memcpy(cBuf, m_readBuffer.get() + m_readHead, copyLen);
+    m_readHead += copyLen;
+    cBuf += copyLen;
+    len -= copyLen;
+  }
+  return true;
+}
+
 uint32_t Connection::_readStr(char* buf, uint32_t bufSz) {
   uint32_t readLen;
-  int ret = Read(m_readpipe[0], &readLen, sizeof(readLen));
-  if (ret < 4) {
-    BlenderLog.report(logvisor::Error, FMT_STRING("Pipe error {} {}"), ret, strerror(errno));
+  if (!_readRaw(&readLen, sizeof(readLen))) {
+    BlenderLog.report(logvisor::Error, FMT_STRING("Pipe error {}"), strerror(errno));
     _blenderDied();
     return 0;
   }
@@ -144,19 +288,14 @@ uint32_t Connection::_readStr(char* buf, uint32_t bufSz) {
     return 0;
   }
 
-  ret = Read(m_readpipe[0], buf, readLen);
-  if (ret < 0) {
+  if (!_readRaw(buf, readLen)) {
     BlenderLog.report(logvisor::Fatal, FMT_STRING("{}"), strerror(errno));
     return 0;
   }
 
-  constexpr std::string_view exception_str{"EXCEPTION"};
-  const std::size_t readStrLen = BoundedStrLen(buf, readLen);
-  if (readStrLen >= exception_str.size()) {
-    if (exception_str.compare(0, exception_str.size(), std::string_view(buf, readStrLen)) == 0) {
-      _blenderDied();
-      return 0;
-    }
+  if (IsExceptionMarker(buf, readLen)) {
+    _blenderDied();
+    return 0;
   }
 
   *(buf + readLen) = '\0';
@@ -169,71 +308,54 @@ uint32_t Connection::_writeStr(const char* buf, uint32_t len, int wpipe) {
     return 0U;
   };
 
-  const int nlerr = Write(wpipe, &len, 4);
-  if (nlerr < 4) {
-    return error();
+  if (wpipe != m_writepipe[1]) {
+    /* Unbuffered path for the forked child reporting launch errors */
+    const int nlerr = Write(wpipe, &len, 4);
+    if (nlerr < 4) {
+      return error();
+    }
+
+    const int ret = Write(wpipe, buf, len);
+    if (ret < 0) {
+      return error();
+    }
+
+    return static_cast<uint32_t>(ret);
   }
 
-  const int ret = Write(wpipe, buf, len);
-  if (ret < 0) {
+  const auto* lenBytes = reinterpret_cast<const uint8_t*>(&len);
+  m_writeBuffer.insert(m_writeBuffer.end(), lenBytes, lenBytes + 4);
+  m_writeBuffer.insert(m_writeBuffer.end(), reinterpret_cast<const uint8_t*>(buf),
+                       reinterpret_cast<const uint8_t*>(buf) + len);
+  if (m_writeBuffer.size() >= PipeBufferSize && !_flushWrite()) {
     return error();
   }
 
-  return static_cast<uint32_t>(ret);
+  return len;
 }
 
 std::size_t Connection::_readBuf(void* buf, std::size_t len) {
-  const auto error = [this] {
+  if (!_readRaw(buf, len)) {
     _blenderDied();
-    return 0U;
-  };
-
-  auto* cBuf = static_cast<uint8_t*>(buf);
-  std::size_t readLen = 0;
-
-  do {
-    const int ret = Read(m_readpipe[0], cBuf, len);
-    if (ret < 0) {
-      return error();
-    }
-
-    constexpr std::string_view exception_str{"EXCEPTION"};
-    const std::size_t readStrLen = BoundedStrLen(static_cast<char*>(buf), len);
-    if (readStrLen >= exception_str.size()) {
-      if (exception_str.compare(0, exception_str.size(), std::string_view(static_cast<char*>(buf), readStrLen)) == 0) {
-        _blenderDied();
-      }
-    }
+    return 0;
+  }
 
-    readLen += ret;
-    cBuf += ret;
-    len -= ret;
-  } while (len != 0);
+  if (IsExceptionMarker(buf, len)) {
+    _blenderDied();
+  }
 
-  return readLen;
+  return len;
 }
 
 std::size_t Connection::_writeBuf(const void* buf, std::size_t len) {
-  const auto error = [this] {
-    _blenderDied();
-    return 0U;
-  };
-
   const auto* cBuf = static_cast<const uint8_t*>(buf);
-  std::size_t writeLen = 0;
-
-  do {
-    const int ret = Write(m_writepipe[1], cBuf, len);
-    if (ret < 0) {
-      return error();
-    }
-
-    writeLen += ret;
-    cBuf += ret;
-    len -= ret;
-  } while (len != 0);
+  m_writeBuffer.insert(m_writeBuffer.end(), cBuf, cBuf + len);
+  if (m_writeBuffer.size() >= PipeBufferSize && !_flushWrite()) {
+    _blenderDied();
+    return 0;
+  }
 
-  return writeLen;
+  return len;
 }
 
 ProjectPath Connection::_readPath() {
@@ -247,6 +369,12 @@ ProjectPath Connection::_readPath() {
   return {};
 }
 
+hecl::SystemString Connection::_meshAttrPath(int slot) const {
+  if (slot < 0)
+    return m_meshAttrPath;
+  return m_meshAttrPath + fmt::format(FMT_STRING(_SYS_STR(".{}")), slot);
+}
+
 void Connection::_closePipe() {
   close(m_readpipe[0]);
   close(m_writepipe[1]);
@@ -289,7 +417,140 @@ static bool RegFileExists(const hecl::SystemChar* path) {
 }
 #endif
 
-Connection::Connection(int verbosityLevel) {
+#ifndef _WIN32
+int Connection::_spawnFromForkServer(int verbosityLevel, int readFd, int writeFd) {
+  std::unique_lock lk{ForkServerMutex};
+  if (ForkServerFailed || !ForkServerEnabled())
+    return -1;
+
+  if (ForkServerSocket < 0) {
+    ForkServerSocket = ForkServerPersistent() ? _connectForkDaemon() : _startForkServer(verbosityLevel);
+    if (ForkServerSocket < 0) {
+      ForkServerFailed = true;
+      return -1;
+    }
+    if (hecl::VerbosityLevel >= 1)
+      BlenderLog.report(logvisor::Info, FMT_STRING("Blender fork server started"));
+  }
+
+  /* One request byte carrying the child's pipe ends; the reply is the forked pid */
+  char req = 'F';
+  iovec iov = {&req, 1};
+  alignas(cmsghdr) char ctrl[CMSG_SPACE(sizeof(int) * 2)] = {};
+  msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = ctrl;
+  msg.msg_controllen = sizeof(ctrl);
+  cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int) * 2);
+  const int fds[2] = {readFd, writeFd};
+  std::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+  int32_t pid = -1;
+  size_t got = 0;
+  if (sendmsg(ForkServerSocket, &msg, 0) == 1) {
+    while (got < sizeof(pid)) {
+      const ssize_t ret = read(ForkServerSocket, reinterpret_cast<char*>(&pid) + got, sizeof(pid) - got);
+      if (ret <= 0)
+        break;
+      got += ret;
+    }
+  }
+  if (got != sizeof(pid) || pid <= 0) {
+    BlenderLog.report(logvisor::Warning, FMT_STRING("blender fork server stopped responding; launching blender per connection"));
+    ForkServerFailed = true;
+    return -1;
+  }
+  return pid;
+}
+
+int Connection::_startForkServer(int verbosityLevel) {
+  int sv[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv))
+    return -1;
+  /* Fork children must not inherit the parent's end */
+  fcntl(sv[0], F_SETFD, FD_CLOEXEC);
+  ForkServerConn.reset(new Connection(verbosityLevel, sv[1]));
+  close(sv[1]);
+  ForkServerConn->_writeStr("FORKSERVER");
+  if (!ForkServerConn->_isOk()) {
+    BlenderLog.report(logvisor::Warning, FMT_STRING("blender fork server unavailable; launching blender per connection"));
+    close(sv[0]);
+    ForkServerConn.reset();
+    return -1;
+  }
+  return sv[0];
+}
+
+int Connection::_connectForkDaemon() {
+  const std::string path = ForkDaemonSocketPath();
+  sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path)) {
+    BlenderLog.report(logvisor::Warning, FMT_STRING("temp directory path too long for a persistent fork server"));
+    return -1;
+  }
+  std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+  if (const int fd = ConnectUnixSocket(addr); fd >= 0)
+    return fd;
+
+  /* None is running, or one left a stale socket behind; whoever holds the lock replaces it */
+  auto lockFp = hecl::FopenUnique((path + ".lock").c_str(), "a");
+  if (!lockFp)
+    return -1;
+  while (flock(fileno(lockFp.get()), LOCK_EX) && errno == EINTR) {}
+  if (const int fd = ConnectUnixSocket(addr); fd >= 0)
+    return fd;
+  unlink(path.c_str());
+  const int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listenFd < 0)
+    return -1;
+  /* Anyone able to connect gets blenders running as this user, so the socket is private to it */
+  if (bind(listenFd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) || chmod(path.c_str(), 0600) ||
+      listen(listenFd, 16)) {
+    close(listenFd);
+    unlink(path.c_str());
+    return -1;
+  }
+
+  /* Launched quiet since it outlives this terminal; once serving, its pipes to this process go unused */
+  {
+    Connection daemon(0, listenFd);
+    close(listenFd);
+    daemon._writeStr("FORKDAEMON");
+    if (!daemon._isOk()) {
+      BlenderLog.report(logvisor::Warning,
+                        FMT_STRING("blender fork server unavailable; launching blender per connection"));
+      unlink(path.c_str());
+      daemon.quitBlender();
+      return -1;
+    }
+    daemon.m_blenderQuit = true;
+  }
+  return ConnectUnixSocket(addr);
+}
+
+void Connection::_shutdownForkServer() {
+  std::unique_lock lk{ForkServerMutex};
+  if (ForkServerSocket < 0)
+    return;
+  /* The server quits once its socket closes, unless it persists; children are unaffected */
+  close(ForkServerSocket);
+  ForkServerSocket = -1;
+  if (!ForkServerConn)
+    return;
+  char lineBuf[256];
+  ForkServerConn->_readStr(lineBuf, sizeof(lineBuf));
+  ReapBlender(ForkServerConn->m_blenderProc);
+  ForkServerConn->m_blenderQuit = true;
+  ForkServerConn.reset();
+}
+#endif
+
+Connection::Connection(int verbosityLevel, int forkServerFd) {
 #if !WINDOWS_STORE
   if (hecl::VerbosityLevel >= 1)
     BlenderLog.report(logvisor::Info, FMT_STRING("Establishing BlenderConnection..."));
@@ -314,6 +575,8 @@ Connection::Connection(int verbosityLevel) {
 
   int installAttempt = 0;
   while (true) {
+    _resetPipeBuffers();
+
     /* Construct communication pipes */
 #if _WIN32
     _pipe(m_readpipe.data(), 2048, _O_BINARY);
@@ -417,6 +680,13 @@ Connection::Connection(int verbosityLevel) {
                         messageBuffer);
     }
 
+    /* Keep blender on the processors of the worker it serves */
+    if (WorkerAffinityMode != WorkerAffinity::None) {
+      GROUP_AFFINITY affinity = {};
+      if (GetThreadGroupAffinity(GetCurrentThread(), &affinity))
+        SetProcessAffinityMask(m_pinfo.hProcess, affinity.Mask);
+    }
+
     close(m_writepipe[0]);
     close(m_readpipe[1]);
 
@@ -451,12 +721,15 @@ Connection::Connection(int verbosityLevel) {
     });
 
 #else
-    pid_t pid = fork();
+    pid_t pid = forkServerFd < 0 ? _spawnFromForkServer(verbosityLevel, m_writepipe[0], m_readpipe[1]) : -1;
+    m_forkServerChild = pid > 0;
+    if (pid < 0)
+      pid = fork();
     if (!pid) {
       /* Close all file descriptors besides those this blender instance uses */
-      int upper_fd = std::max(m_writepipe[0], m_readpipe[1]);
+      int upper_fd = std::max({m_writepipe[0], m_readpipe[1], forkServerFd});
       for (int i = 3; i < upper_fd; ++i) {
-        if (i != m_writepipe[0] && i != m_readpipe[1])
+        if (i != m_writepipe[0] && i != m_readpipe[1] && i != forkServerFd)
           close(i);
       }
       closefrom(upper_fd + 1);
@@ -472,11 +745,13 @@ Connection::Connection(int verbosityLevel) {
       std::string readfds = fmt::format(FMT_STRING("{}"), m_writepipe[0]);
       std::string writefds = fmt::format(FMT_STRING("{}"), m_readpipe[1]);
       std::string vLevel = fmt::format(FMT_STRING("{}"), verbosityLevel);
+      std::string forkServerArg = fmt::format(FMT_STRING("{}"), forkServerFd);
+      const char* forkServerArgPtr = forkServerFd >= 0 ? forkServerArg.c_str() : nullptr;
 
       /* Try user-specified blender first */
       if (blenderBin) {
         execlp(blenderBin, blenderBin, "--background", "-P", blenderShellPath.c_str(), "--", readfds.c_str(),
-               writefds.c_str(), vLevel.c_str(), blenderAddonPath.c_str(), nullptr);
+               writefds.c_str(), vLevel.c_str(), blenderAddonPath.c_str(), forkServerArgPtr, nullptr);
         if (errno != ENOENT) {
           errbuf = fmt::format(FMT_STRING("NOLAUNCH {}"), strerror(errno));
           _writeStr(errbuf.c_str(), errbuf.size(), m_readpipe[1]);
@@ -494,7 +769,7 @@ Connection::Connection(int verbosityLevel) {
 #endif
         blenderBin = steamBlender.c_str();
         execlp(blenderBin, blenderBin, "--background", "-P", blenderShellPath.c_str(), "--", readfds.c_str(),
-               writefds.c_str(), vLevel.c_str(), blenderAddonPath.c_str(), nullptr);
+               writefds.c_str(), vLevel.c_str(), blenderAddonPath.c_str(), forkServerArgPtr, nullptr);
         if (errno != ENOENT) {
           errbuf = fmt::format(FMT_STRING("NOLAUNCH {}"), strerror(errno));
           _writeStr(errbuf.c_str(), errbuf.size(), m_readpipe[1]);
@@ -504,7 +779,7 @@ Connection::Connection(int verbosityLevel) {
 
       /* Otherwise default blender */
       execlp(DEFAULT_BLENDER_BIN, DEFAULT_BLENDER_BIN, "--background", "-P", blenderShellPath.c_str(), "--",
-             readfds.c_str(), writefds.c_str(), vLevel.c_str(), blenderAddonPath.c_str(), nullptr);
+             readfds.c_str(), writefds.c_str(), vLevel.c_str(), blenderAddonPath.c_str(), forkServerArgPtr, nullptr);
       if (errno != ENOENT) {
         errbuf = fmt::format(FMT_STRING("NOLAUNCH {}"), strerror(errno));
         _writeStr(errbuf.c_str(), errbuf.size(), m_readpipe[1]);
@@ -518,17 +793,31 @@ Connection::Connection(int verbosityLevel) {
     close(m_writepipe[0]);
     close(m_readpipe[1]);
     m_blenderProc = pid;
+
+#if __linux__
+    /* Direct forks inherit this worker's processors; fork server children are placed here */
+    if (WorkerAffinityMode != WorkerAffinity::None) {
+      cpu_set_t set;
+      if (!sched_getaffinity(0, sizeof(set), &set))
+        sched_setaffinity(pid, sizeof(set), &set);
+    }
+#endif
 #endif
 
     /* Stash error path and unlink existing file */
 #if _WIN32
     m_errPath = hecl::SystemString(TMPDIR) +
                 fmt::format(FMT_STRING(_SYS_STR("/hecl_{:016X}.derp")), (unsigned long long)m_pinfo.dwProcessId);
+    m_meshAttrPath = hecl::SystemString(TMPDIR) +
+                     fmt::format(FMT_STRING(_SYS_STR("/hecl_{:016X}.mesh")), (unsigned long long)m_pinfo.dwProcessId);
 #else
     m_errPath = hecl::SystemString(TMPDIR) +
                 fmt::format(FMT_STRING(_SYS_STR("/hecl_{:016X}.derp")), (unsigned long long)m_blenderProc);
+    m_meshAttrPath = hecl::SystemString(TMPDIR) +
+                     fmt::format(FMT_STRING(_SYS_STR("/hecl_{:016X}.mesh")), (unsigned long long)m_blenderProc);
 #endif
     hecl::Unlink(m_errPath.c_str());
+    hecl::Unlink(m_meshAttrPath.c_str());
 
     /* Handle first response */
     std::string lineStr = _readStdString();
@@ -560,14 +849,16 @@ Connection::Connection(int verbosityLevel) {
         BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("unable to install blender addon using '{}'")),
                           blenderAddonPath.c_str());
 #ifndef _WIN32
-      waitpid(pid, nullptr, 0);
+      if (!m_forkServerChild)
+        ReapBlender(pid);
 #endif
       continue;
     } else if (lineStr == "ADDONINSTALLED") {
       _closePipe();
       blenderAddonPath = _SYS_STR("SKIPINSTALL");
 #ifndef _WIN32
-      waitpid(pid, nullptr, 0);
+      if (!m_forkServerChild)
+        ReapBlender(pid);
 #endif
       continue;
     } else if (lineStr != "READY") {
@@ -673,6 +964,7 @@ bool Connection::openBlend(const ProjectPath& path, bool force) {
   }
   if (!force && path == m_loadedBlend)
     return true;
+  HECL_TRACE_SCOPE("openBlend", path.getRelativePathUTF8());
   _writeStr(fmt::format(FMT_STRING("OPEN \"{}\""), path.getAbsolutePathUTF8()));
   if (_isFinished()) {
     m_loadedBlend = path;
@@ -693,6 +985,7 @@ bool Connection::openBlend(const ProjectPath& path, bool force) {
       if (_isTrue())
         m_loadedRigged = true;
     }
+    RecordBlendInfo(path.getAbsolutePath(), m_loadedType, m_loadedRigged);
     return true;
   }
   return false;
@@ -882,13 +1175,11 @@ void ANIMOutStream::changeCurve(CurveType type, unsigned crvIdx, unsigned keyCou
     BlenderLog.report(logvisor::Fatal, FMT_STRING("incomplete ANIMOutStream for change"));
   m_curCount = 0;
   m_totalCount = keyCount;
-  char tp = char(type);
-  m_parent->_writeBuf(&tp, 1);
-  struct {
-    uint32_t ci;
-    uint32_t kc;
-  } info = {uint32_t(crvIdx), uint32_t(keyCount)};
-  m_parent->_writeBuf(reinterpret_cast<const char*>(&info), 8);
+  char header[9];
+  header[0] = char(type);
+  const uint32_t info[2] = {uint32_t(crvIdx), uint32_t(keyCount)};
+  std::memcpy(header + 1, info, sizeof(info));
+  m_parent->_writeBuf(header, sizeof(header));
   m_inCurve = true;
 }
 
@@ -906,6 +1197,13 @@ void ANIMOutStream::write(unsigned frame, float val) {
     BlenderLog.report(logvisor::Fatal, FMT_STRING("ANIMOutStream keyCount overflow"));
 }
 
+void ANIMOutStream::writeCurve(CurveType type, unsigned crvIdx, const Key* keys, size_t keyCount) {
+  static_assert(sizeof(Key) == 8, "keys are sent as packed (frame, value) pairs");
+  changeCurve(type, crvIdx, unsigned(keyCount));
+  m_parent->_writeBuf(keys, keyCount * sizeof(Key));
+  m_curCount = m_totalCount;
+}
+
 Mesh::SkinBind::SkinBind(Connection& conn) {
   conn._readValue(vg_idx);
   conn._readValue(weight);
@@ -925,17 +1223,49 @@ void Mesh::normalizeSkinBinds() {
   }
 }
 
-Mesh::Mesh(Connection& conn, HMDLTopology topologyIn, int skinSlotCount, bool useLuvs)
+Mesh::Mesh(Connection& conn, HMDLTopology topologyIn, int skinSlotCount, bool useLuvs, int attrSlot,
+           bool genTangents)
 : topology(topologyIn), sceneXf(conn), aabbMin(conn), aabbMax(conn) {
   conn._readVectorFunc(materialSets, [&]() { conn._readVector(materialSets.emplace_back()); });
 
-  MeshOptimizer opt(conn, materialSets[0], useLuvs);
-  opt.optimize(*this, skinSlotCount);
+  /* Bulk attributes arrive either inline or through a file mapped from the blender temp dir */
+  uint32_t attrTransport;
+  conn._readValue(attrTransport);
+  if (attrTransport == 1) {
+    uint32_t attrSize;
+    conn._readValue(attrSize);
+    const hecl::SystemString attrPath = conn._meshAttrPath(attrSlot);
+    MappedFile attrFile(attrPath.c_str());
+    if (!attrFile || attrFile.size() < attrSize)
+      BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("unable to map mesh attributes from '{}'")), attrPath);
+    /* Linked and duplicated props arrive as identical blocks; reuse their optimized geometry */
+    MeshGeometryCache& cache = MeshGeometryCache::Shared();
+    geometryHash = MeshGeometryCache::Key(attrFile.data(), attrSize, materialSets[0], topologyIn, skinSlotCount,
+                                          useLuvs, genTangents);
+    std::optional<MeshOptimizer> opt;
+    if (!cache.restore(geometryHash, materialSets[0], *this))
+      opt.emplace(attrFile.data(), attrSize, materialSets[0], useLuvs, genTangents);
+    attrFile.close();
+    hecl::Unlink(attrPath.c_str());
+    if (opt) {
+      opt->optimize(*this, skinSlotCount);
+      cache.insert(geometryHash, materialSets[0], *this);
+    }
+  } else {
+    MeshOptimizer opt(conn, materialSets[0], useLuvs, genTangents);
+    opt.optimize(*this, skinSlotCount);
+  }
+
+  MaterialTable& materialTable = MaterialTable::Shared();
+  materialIds.reserve(materialSets[0].size());
+  for (const Material& mat : materialSets[0])
+    materialIds.push_back(materialTable.intern(mat));
+  for (Surface& surf : surfaces)
+    surf.materialId = materialIds.at(surf.materialIdx);
 
   conn._readVector(boneNames);
   if (boneNames.size())
-    for (Surface& s : surfaces)
-      s.skinBankIdx = skinBanks.addSurface(*this, s, skinSlotCount);
+    skinBanks.addSurfaces(*this, surfaces, skinSlotCount);
 
   /* Custom properties */
   uint32_t propCount;
@@ -955,53 +1285,88 @@ Mesh::Mesh(Connection& conn, HMDLTopology topologyIn, int skinSlotCount, bool us
       for (Surface::Vert& vert : surf.verts) {
         if (vert.iPos == 0xffffffff)
           continue;
-        for (uint32_t i = 0; i < bank.m_skinIdxs.size(); ++i) {
-          if (bank.m_skinIdxs[i] == vert.iSkin) {
-            vert.iBankSkin = i;
-            break;
-          }
-        }
+        if (auto search = bank.m_skinSlots.find(vert.iSkin); search != bank.m_skinSlots.end())
+          vert.iBankSkin = search->second;
       }
     }
   }
 }
 
-Mesh Mesh::getContiguousSkinningVersion() const {
-  Mesh newMesh = *this;
-  newMesh.pos.clear();
-  newMesh.norm.clear();
-  newMesh.contiguousSkinVertCounts.clear();
-  newMesh.contiguousSkinVertCounts.reserve(skins.size());
-  for (std::size_t i = 0; i < skins.size(); ++i) {
-    std::unordered_map<std::pair<uint32_t, uint32_t>, uint32_t> contigMap;
-    std::size_t vertCount = 0;
-    for (Surface& surf : newMesh.surfaces) {
-      for (Surface::Vert& vert : surf.verts) {
-        if (vert.iPos == 0xffffffff)
-          continue;
-        if (vert.iSkin == i) {
-          auto key = std::make_pair(vert.iPos, vert.iNorm);
-          auto search = contigMap.find(key);
-          if (search != contigMap.end()) {
-            vert.iPos = search->second;
-            vert.iNorm = search->second;
-          } else {
-            uint32_t newIdx = newMesh.pos.size();
-            contigMap[key] = newIdx;
-            newMesh.pos.push_back(pos.at(vert.iPos));
-            newMesh.norm.push_back(norm.at(vert.iNorm));
-            vert.iPos = newIdx;
-            vert.iNorm = newIdx;
-            ++vertCount;
-          }
-        }
-      }
+void Mesh::makeSkinningContiguous() {
+  /*
+   * Each (skin, iPos, iNorm) combination becomes one vertex, numbered by first occurrence within its
+   * skin and with skins laid out back to back. One pass numbers combinations per skin, hashed on
+   * a flat table of chains indexed by iPos; a second adds each skin's base once the counts are known.
+   */
+  struct Combo {
+    uint32_t iPos;
+    uint32_t iNorm;
+    uint32_t iSkin;
+    uint32_t skinLocalIdx;
+    uint32_t next;
+  };
+  constexpr uint32_t NoCombo = UINT32_MAX;
+  std::vector<uint32_t> chainHeads(pos.size(), NoCombo);
+  std::vector<Combo> combos;
+  std::vector<uint32_t> skinBases(skins.size() + 1, 0);
+
+  const auto forEachSkinnedVert = [&](auto&& func) {
+    for (Surface& surf : surfaces) {
+      for (Surface::Vert& vert : surf.verts)
+        if (vert.iPos != 0xffffffff && vert.iSkin < skins.size())
+          func(vert);
+      for (std::vector<Surface::Vert>& lod : surf.lodVerts)
+        for (Surface::Vert& vert : lod)
+          if (vert.iPos != 0xffffffff && vert.iSkin < skins.size())
+            func(vert);
     }
-    newMesh.contiguousSkinVertCounts.push_back(vertCount);
+  };
+
+  /* Verts temporarily hold their combination index in iPos */
+  forEachSkinnedVert([&](Surface::Vert& vert) {
+    uint32_t& head = chainHeads.at(vert.iPos);
+    uint32_t comboIdx = head;
+    while (comboIdx != NoCombo &&
+           (combos[comboIdx].iNorm != vert.iNorm || combos[comboIdx].iSkin != vert.iSkin))
+      comboIdx = combos[comboIdx].next;
+    if (comboIdx == NoCombo) {
+      comboIdx = uint32_t(combos.size());
+      combos.push_back({vert.iPos, vert.iNorm, vert.iSkin, skinBases[vert.iSkin + 1]++, head});
+      head = comboIdx;
+    }
+    vert.iPos = comboIdx;
+  });
+
+  contiguousSkinVertCounts.assign(skinBases.begin() + 1, skinBases.end());
+  for (std::size_t i = 1; i < skinBases.size(); ++i)
+    skinBases[i] += skinBases[i - 1];
+
+  std::vector<Vector3f> newPos(combos.size());
+  std::vector<Vector3f> newNorm(combos.size());
+  for (const Combo& combo : combos) {
+    const uint32_t newIdx = skinBases[combo.iSkin] + combo.skinLocalIdx;
+    newPos[newIdx] = pos[combo.iPos];
+    newNorm[newIdx] = norm.at(combo.iNorm);
   }
+  forEachSkinnedVert([&](Surface::Vert& vert) {
+    const Combo& combo = combos[vert.iPos];
+    vert.iPos = vert.iNorm = skinBases[combo.iSkin] + combo.skinLocalIdx;
+  });
+  pos = std::move(newPos);
+  norm = std::move(newNorm);
+}
+
+Mesh Mesh::getContiguousSkinningVersion() const& {
+  Mesh newMesh = *this;
+  newMesh.makeSkinningContiguous();
   return newMesh;
 }
 
+Mesh Mesh::getContiguousSkinningVersion() && {
+  makeSkinningContiguous();
+  return std::move(*this);
+}
+
 template <typename T>
 static T SwapFourCC(T fcc) {
   return T(hecl::SBig(std::underlying_type_t<T>(fcc)));
@@ -1050,31 +1415,70 @@ Material::Material(Connection& conn) {
   }
 
   conn._readValue(blendMode);
+  finalize();
+}
+
+void Material::finalize() {
+  XXH64_state_t st;
+  XXH64_reset(&st, 0);
+  XXH64_update(&st, &blendMode, sizeof(blendMode));
+  for (const Chunk& chunk : chunks) {
+    chunk.visit([&](const auto& arg) {
+      arg.hash(&st);
+      using T = std::decay_t<decltype(arg)>;
+      if constexpr (std::is_same_v<T, PASS>) {
+        const uint64_t texHash = arg.tex.hash().val64();
+        XXH64_update(&st, &texHash, sizeof(texHash));
+        XXH64_update(&st, arg.uvAnimParms.data(), sizeof(arg.uvAnimParms));
+      } else {
+        const athena::simd_floats f(arg.color.val.simd);
+        const float color[] = {f[0], f[1], f[2], f[3]};
+        XXH64_update(&st, color, sizeof(color));
+      }
+    });
+  }
+  /* Property order is unspecified; combine entries commutatively */
+  uint64_t propsHash = 0;
+  for (const auto& [key, value] : iprops)
+    propsHash += XXH64(key.data(), key.size(), uint64_t(uint32_t(value)));
+  XXH64_update(&st, &propsHash, sizeof(propsHash));
+  contentHash = XXH64_digest(&st);
+
+  flags = 0;
+  if (auto search = iprops.find("retro_lightmapped"); search != iprops.cend() && search->second)
+    flags |= FlagLightmapped;
 }
 
 bool Mesh::Surface::Vert::operator==(const Vert& other) const {
-  return std::tie(iPos, iNorm, iColor, iUv, iSkin) ==
-         std::tie(other.iPos, other.iNorm, other.iColor, other.iUv, other.iSkin);
+  return std::tie(iPos, iNorm, iColor, iUv, iSkin, iTangent) ==
+         std::tie(other.iPos, other.iNorm, other.iColor, other.iUv, other.iSkin, other.iTangent);
 }
 
-static bool VertInBank(const std::vector<uint32_t>& bank, uint32_t sIdx) {
-  return std::any_of(bank.cbegin(), bank.cend(), [sIdx](auto index) { return index == sIdx; });
+/* Distinct skin indices of surf's real verts, in order of first use */
+static std::vector<uint32_t> SurfaceSkinSet(const Mesh& mesh, const Mesh::Surface& surf) {
+  std::vector<bool> seen(mesh.skins.size());
+  std::vector<uint32_t> ret;
+  for (const Mesh::Surface::Vert& v : surf.verts) {
+    if (v.iPos == 0xffffffff)
+      continue;
+    if (v.iSkin >= seen.size())
+      seen.resize(v.iSkin + 1);
+    if (!seen[v.iSkin]) {
+      seen[v.iSkin] = true;
+      ret.push_back(v.iSkin);
+    }
+  }
+  return ret;
 }
 
 void Mesh::SkinBanks::Bank::addSkins(const Mesh& parent, const std::vector<uint32_t>& skinIdxs) {
   for (uint32_t sidx : skinIdxs) {
+    m_skinSlots.emplace(sidx, uint32_t(m_skinIdxs.size()));
     m_skinIdxs.push_back(sidx);
     for (const SkinBind& bind : parent.skins[sidx]) {
       if (!bind.valid())
         break;
-      bool found = false;
-      for (uint32_t bidx : m_boneIdxs) {
-        if (bidx == bind.vg_idx) {
-          found = true;
-          break;
-        }
-      }
-      if (!found)
+      if (std::find(m_boneIdxs.cbegin(), m_boneIdxs.cend(), bind.vg_idx) == m_boneIdxs.cend())
         m_boneIdxs.push_back(bind.vg_idx);
     }
   }
@@ -1087,44 +1491,68 @@ std::vector<Mesh::SkinBanks::Bank>::iterator Mesh::SkinBanks::addSkinBank(int sk
   return banks.end() - 1;
 }
 
-uint32_t Mesh::SkinBanks::addSurface(const Mesh& mesh, const Surface& surf, int skinSlotCount) {
-  if (banks.empty())
-    addSkinBank(skinSlotCount);
-  std::vector<uint32_t> toAdd;
-  if (skinSlotCount > 0)
-    toAdd.reserve(skinSlotCount);
-  std::vector<Bank>::iterator bankIt = banks.begin();
-  for (;;) {
-    bool done = true;
-    for (; bankIt != banks.end(); ++bankIt) {
-      Bank& bank = *bankIt;
-      done = true;
-      for (const Surface::Vert& v : surf.verts) {
-        if (v.iPos == 0xffffffff)
-          continue;
-        if (!VertInBank(bank.m_skinIdxs, v.iSkin) && !VertInBank(toAdd, v.iSkin)) {
-          toAdd.push_back(v.iSkin);
-          if (skinSlotCount > 0 && bank.m_skinIdxs.size() + toAdd.size() > std::size_t(skinSlotCount)) {
-            toAdd.clear();
-            done = false;
-            break;
-          }
-        }
-      }
-      if (toAdd.size()) {
-        bank.addSkins(mesh, toAdd);
-        toAdd.clear();
+uint32_t Mesh::SkinBanks::addSkinSet(const Mesh& mesh, const std::vector<uint32_t>& skinSet, int skinSlotCount) {
+  /* Best fit: the bank already sharing the most of these skins, provided the rest still fit */
+  size_t bestIdx = banks.size();
+  std::vector<uint32_t> bestMissing;
+  std::vector<uint32_t> missing;
+  for (size_t i = 0; i < banks.size(); ++i) {
+    const Bank& bank = banks[i];
+    size_t limit = SIZE_MAX;
+    if (skinSlotCount > 0)
+      limit = size_t(skinSlotCount) > bank.m_skinIdxs.size() ? size_t(skinSlotCount) - bank.m_skinIdxs.size() : 0;
+    /* Only a strictly better fit replaces the current best */
+    if (bestIdx != banks.size())
+      limit = std::min(limit, bestMissing.size() - 1);
+    missing.clear();
+    bool fits = true;
+    for (uint32_t sidx : skinSet) {
+      if (bank.m_skinSlots.count(sidx))
+        continue;
+      if (missing.size() == limit) {
+        fits = false;
+        break;
       }
-      if (done)
-        return uint32_t(bankIt - banks.begin());
+      missing.push_back(sidx);
     }
-    if (!done) {
-      bankIt = addSkinBank(skinSlotCount);
+    if (!fits)
       continue;
-    }
-    break;
+    bestIdx = i;
+    bestMissing.swap(missing);
+    if (bestMissing.empty())
+      break;
   }
-  return uint32_t(-1);
+
+  if (bestIdx == banks.size()) {
+    if (skinSlotCount > 0 && skinSet.size() > size_t(skinSlotCount))
+      BlenderLog.report(logvisor::Error, FMT_STRING("surface uses {} skins; a bank holds at most {}"), skinSet.size(),
+                        skinSlotCount);
+    addSkinBank(skinSlotCount);
+    bestMissing = skinSet;
+  }
+  if (!bestMissing.empty())
+    banks[bestIdx].addSkins(mesh, bestMissing);
+  return uint32_t(bestIdx);
+}
+
+uint32_t Mesh::SkinBanks::addSurface(const Mesh& mesh, const Surface& surf, int skinSlotCount) {
+  return addSkinSet(mesh, SurfaceSkinSet(mesh, surf), skinSlotCount);
+}
+
+void Mesh::SkinBanks::addSurfaces(const Mesh& mesh, std::vector<Surface>& surfs, int skinSlotCount) {
+  std::vector<std::vector<uint32_t>> skinSets;
+  skinSets.reserve(surfs.size());
+  for (const Surface& surf : surfs)
+    skinSets.push_back(SurfaceSkinSet(mesh, surf));
+
+  /* Large sets are the hardest to place, so they seed the banks that smaller sets then fill */
+  std::vector<size_t> order(surfs.size());
+  for (size_t i = 0; i < order.size(); ++i)
+    order[i] = i;
+  std::stable_sort(order.begin(), order.end(),
+                   [&](size_t a, size_t b) { return skinSets[a].size() > skinSets[b].size(); });
+  for (size_t idx : order)
+    surfs[idx].skinBankIdx = addSkinSet(mesh, skinSets[idx], skinSlotCount);
 }
 
 ColMesh::ColMesh(Connection& conn) {
@@ -1223,10 +1651,13 @@ Actor::Actor(Connection& conn) {
 PathMesh::PathMesh(Connection& conn) { conn._readVector(data); }
 
 const Bone* Armature::lookupBone(const char* name) const {
-  for (const Bone& b : bones)
-    if (b.name == name)
-      return &b;
-  return nullptr;
+  const int32_t idx = lookupBoneIdx(name);
+  return idx < 0 ? nullptr : &bones[idx];
+}
+
+int32_t Armature::lookupBoneIdx(std::string_view name) const {
+  const auto search = boneIndices.find(std::string(name));
+  return search == boneIndices.end() ? -1 : int32_t(search->second);
 }
 
 const Bone* Armature::getParent(const Bone* bone) const {
@@ -1251,13 +1682,37 @@ const Bone* Armature::getRoot() const {
   return nullptr;
 }
 
-Armature::Armature(Connection& conn) { conn._readVector(bones); }
+Armature::Armature(Connection& conn) {
+  std::vector<std::string> names;
+  conn._readVector(names);
+  const uint32_t boneCount = uint32_t(names.size());
+  bones.resize(boneCount);
+  boneIndices.reserve(boneCount);
+  if (!boneCount)
+    return;
 
-Bone::Bone(Connection& conn) {
-  name = conn._readStdString();
-  origin.read(conn);
-  conn._readValue(parent);
+  /* Packed arrays are scratch, taken from the cook's ResultArena when it scopes one */
+  ResultVector<std::array<float, 3>> origins(boneCount);
+  conn._readBuf(origins.data(), sizeof(origins[0]) * boneCount);
+  ResultVector<int32_t> parents(boneCount);
+  conn._readBuf(parents.data(), sizeof(int32_t) * boneCount);
+  ResultVector<uint32_t> childCounts(boneCount);
+  conn._readBuf(childCounts.data(), sizeof(uint32_t) * boneCount);
+  ResultVector<int32_t> children;
   conn._readVector(children);
+
+  size_t childBegin = 0;
+  for (uint32_t i = 0; i < boneCount; ++i) {
+    Bone& bone = bones[i];
+    bone.name = std::move(names[i]);
+    for (int c = 0; c < 3; ++c)
+      bone.origin.val.simd[c] = origins[i][c];
+    bone.parent = parents[i];
+    const size_t childEnd = std::min(childBegin + childCounts[i], children.size());
+    bone.children.assign(children.begin() + childBegin, children.begin() + childEnd);
+    childBegin = childEnd;
+    boneIndices.emplace(bone.name, i);
+  }
 }
 
 Actor::ActorArmature::ActorArmature(Connection& conn) {
@@ -1325,7 +1780,10 @@ DataStream::DataStream(Connection* parent) : m_parent(parent) {
   m_parent->_checkReady("unable to open DataStream with blender"sv);
 }
 
+const ProjectPath& DataStream::getBlendPath() const { return m_parent->getBlendPath(); }
+
 void DataStream::close() {
+  _joinPipeline();
   if (m_parent && m_parent->m_lock) {
     m_parent->_writeStr("DATAEND");
     m_parent->_checkDone("unable to close DataStream with blender"sv);
@@ -1366,7 +1824,8 @@ const char* DataStream::MeshOutputModeString(HMDLTopology topology) {
   return STRS[int(topology)];
 }
 
-Mesh DataStream::compileMesh(HMDLTopology topology, int skinSlotCount) {
+Mesh DataStream::compileMesh(HMDLTopology topology, int skinSlotCount, bool genTangents) {
+  HECL_TRACE_SCOPE("compileMesh", m_parent->getBlendPath().getRelativePathUTF8());
   if (m_parent->getBlendType() != BlendType::Mesh)
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not a MESH blend")),
                       m_parent->getBlendPath().getAbsolutePath());
@@ -1374,10 +1833,12 @@ Mesh DataStream::compileMesh(HMDLTopology topology, int skinSlotCount) {
   m_parent->_writeStr("MESHCOMPILE");
   m_parent->_checkOk("unable to cook mesh"sv);
 
-  return Mesh(*m_parent, topology, skinSlotCount);
+  return Mesh(*m_parent, topology, skinSlotCount, false, -1, genTangents);
 }
 
-Mesh DataStream::compileMesh(std::string_view name, HMDLTopology topology, int skinSlotCount, bool useLuv) {
+Mesh DataStream::compileMesh(std::string_view name, HMDLTopology topology, int skinSlotCount, bool useLuv,
+                             bool genTangents) {
+  HECL_TRACE_SCOPE("compileMesh", m_parent->getBlendPath().getRelativePathUTF8());
   if (m_parent->getBlendType() != BlendType::Area)
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not an AREA blend")),
                       m_parent->getBlendPath().getAbsolutePath());
@@ -1385,10 +1846,51 @@ Mesh DataStream::compileMesh(std::string_view name, HMDLTopology topology, int s
   m_parent->_writeStr(fmt::format(FMT_STRING("MESHCOMPILENAME {} {}"), name, int(useLuv)));
   m_parent->_checkOk("unable to cook mesh"sv);
 
-  return Mesh(*m_parent, topology, skinSlotCount, useLuv);
+  return Mesh(*m_parent, topology, skinSlotCount, useLuv, -1, genTangents);
+}
+
+std::vector<std::future<Mesh>> DataStream::compileMeshes(const std::vector<std::string>& names, HMDLTopology topology,
+                                                          int skinSlotCount, bool useLuv, bool genTangents) {
+  if (m_parent->getBlendType() != BlendType::Area)
+    BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not an AREA blend")),
+                      m_parent->getBlendPath().getAbsolutePath());
+  _joinPipeline();
+
+  std::vector<std::promise<Mesh>> promises(names.size());
+  std::vector<std::future<Mesh>> ret;
+  ret.reserve(names.size());
+  for (auto& promise : promises)
+    ret.push_back(promise.get_future());
+
+  m_pipeline = std::thread([conn = m_parent, names, topology, skinSlotCount, useLuv, genTangents,
+                            promises = std::move(promises)]() mutable {
+    HECL_TRACE_SCOPE("compileMeshes", conn->getBlendPath().getRelativePathUTF8());
+    /* Requests sharing an attribute slot are never in flight together */
+    const auto request = [&](size_t i) {
+      conn->_writeStr(
+          fmt::format(FMT_STRING("MESHCOMPILENAME {} {} {}"), names[i], int(useLuv), i % MeshPipelineDepth));
+    };
+    size_t sent = 0;
+    for (; sent < std::min(names.size(), MeshPipelineDepth); ++sent)
+      request(sent);
+    for (size_t i = 0; i < names.size(); ++i) {
+      conn->_checkOk("unable to cook mesh"sv);
+      Mesh mesh(*conn, topology, skinSlotCount, useLuv, int(i % MeshPipelineDepth), genTangents);
+      if (sent < names.size())
+        request(sent++);
+      promises[i].set_value(std::move(mesh));
+    }
+  });
+  return ret;
+}
+
+void DataStream::_joinPipeline() {
+  if (m_pipeline.joinable())
+    m_pipeline.join();
 }
 
 ColMesh DataStream::compileColMesh(std::string_view name) {
+  HECL_TRACE_SCOPE("compileColMesh", m_parent->getBlendPath().getRelativePathUTF8());
   if (m_parent->getBlendType() != BlendType::Area)
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not an AREA blend")),
                       m_parent->getBlendPath().getAbsolutePath());
@@ -1400,6 +1902,7 @@ ColMesh DataStream::compileColMesh(std::string_view name) {
 }
 
 std::vector<ColMesh> DataStream::compileColMeshes() {
+  HECL_TRACE_SCOPE("compileColMeshes", m_parent->getBlendPath().getRelativePathUTF8());
   if (m_parent->getBlendType() != BlendType::ColMesh)
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not a CMESH blend")),
                       m_parent->getBlendPath().getAbsolutePath());
@@ -1413,6 +1916,7 @@ std::vector<ColMesh> DataStream::compileColMeshes() {
 }
 
 std::vector<Light> DataStream::compileLights() {
+  HECL_TRACE_SCOPE("compileLights", m_parent->getBlendPath().getRelativePathUTF8());
   if (m_parent->getBlendType() != BlendType::Area)
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not an AREA blend")),
                       m_parent->getBlendPath().getAbsolutePath());
@@ -1426,6 +1930,7 @@ std::vector<Light> DataStream::compileLights() {
 }
 
 PathMesh DataStream::compilePathMesh() {
+  HECL_TRACE_SCOPE("compilePathMesh", m_parent->getBlendPath().getRelativePathUTF8());
   if (m_parent->getBlendType() != BlendType::PathMesh)
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not a PATH blend")),
                       m_parent->getBlendPath().getAbsolutePath());
@@ -1437,6 +1942,7 @@ PathMesh DataStream::compilePathMesh() {
 }
 
 std::vector<uint8_t> DataStream::compileGuiFrame(int version) {
+  HECL_TRACE_SCOPE("compileGuiFrame", m_parent->getBlendPath().getRelativePathUTF8());
   if (m_parent->getBlendType() != BlendType::Frame)
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not a FRAME blend")),
                       m_parent->getBlendPath().getAbsolutePath());
@@ -1477,6 +1983,7 @@ std::vector<ProjectPath> DataStream::getTextures() {
 }
 
 Actor DataStream::compileActor() {
+  HECL_TRACE_SCOPE("compileActor", m_parent->getBlendPath().getRelativePathUTF8());
   if (m_parent->getBlendType() != BlendType::Actor)
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not an ACTOR blend")),
                       m_parent->getBlendPath().getAbsolutePath());
@@ -1488,6 +1995,7 @@ Actor DataStream::compileActor() {
 }
 
 Actor DataStream::compileActorCharacterOnly() {
+  HECL_TRACE_SCOPE("compileActorCharacterOnly", m_parent->getBlendPath().getRelativePathUTF8());
   if (m_parent->getBlendType() != BlendType::Actor)
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not an ACTOR blend")),
                       m_parent->getBlendPath().getAbsolutePath());
@@ -1499,6 +2007,7 @@ Actor DataStream::compileActorCharacterOnly() {
 }
 
 Armature DataStream::compileArmature() {
+  HECL_TRACE_SCOPE("compileArmature", m_parent->getBlendPath().getRelativePathUTF8());
   if (m_parent->getBlendType() != BlendType::Armature)
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not an ARMATURE blend")),
                       m_parent->getBlendPath().getAbsolutePath());
@@ -1510,6 +2019,7 @@ Armature DataStream::compileArmature() {
 }
 
 Action DataStream::compileActionChannelsOnly(std::string_view name) {
+  HECL_TRACE_SCOPE("compileActionChannelsOnly", m_parent->getBlendPath().getRelativePathUTF8());
   if (m_parent->getBlendType() != BlendType::Actor)
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not an ACTOR blend")),
                       m_parent->getBlendPath().getAbsolutePath());
@@ -1521,6 +2031,7 @@ Action DataStream::compileActionChannelsOnly(std::string_view name) {
 }
 
 World DataStream::compileWorld() {
+  HECL_TRACE_SCOPE("compileWorld", m_parent->getBlendPath().getRelativePathUTF8());
   if (m_parent->getBlendType() != BlendType::World)
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not an WORLD blend")),
                       m_parent->getBlendPath().getAbsolutePath());
@@ -1603,7 +2114,12 @@ std::vector<std::pair<std::string, std::string>> DataStream::getAttachmentNames(
   return ret;
 }
 
-std::unordered_map<std::string, Matrix3f> DataStream::getBoneMatrices(std::string_view name) {
+const Matrix3f* DataStream::BoneMatrices::lookup(std::string_view name) const {
+  const auto search = indices.find(std::string(name));
+  return search == indices.end() ? nullptr : &matrices[search->second];
+}
+
+DataStream::BoneMatrices DataStream::getBoneMatrixArray(std::string_view name) {
   if (name.empty())
     return {};
 
@@ -1614,27 +2130,34 @@ std::unordered_map<std::string, Matrix3f> DataStream::getBoneMatrices(std::strin
   m_parent->_writeStr(fmt::format(FMT_STRING("GETBONEMATRICES {}"), name));
   m_parent->_checkOk("unable to get matrices of armature"sv);
 
-  std::unordered_map<std::string, Matrix3f> ret;
-
-  uint32_t boneCount;
-  m_parent->_readValue(boneCount);
-  ret.reserve(boneCount);
-  for (uint32_t i = 0; i < boneCount; ++i) {
-    std::string mat_name = m_parent->_readStdString();
-
-    Matrix3f matOut;
-    for (int mat_i = 0; mat_i < 3; ++mat_i) {
-      for (int mat_j = 0; mat_j < 3; ++mat_j) {
-        float val;
-        m_parent->_readValue(val);
-        matOut[mat_i].simd[mat_j] = val;
-      }
-      matOut[mat_i].simd[3] = 0.f;
+  BoneMatrices ret;
+  m_parent->_readVector(ret.names);
+  const size_t boneCount = ret.names.size();
+  ret.indices.reserve(boneCount);
+  for (size_t i = 0; i < boneCount; ++i)
+    ret.indices.emplace(ret.names[i], uint32_t(i));
+  if (!boneCount)
+    return ret;
+
+  std::vector<std::array<float, 9>> packed(boneCount);
+  m_parent->_readBuf(packed.data(), sizeof(packed[0]) * boneCount);
+  ret.matrices.resize(boneCount);
+  for (size_t i = 0; i < boneCount; ++i) {
+    for (int r = 0; r < 3; ++r) {
+      for (int c = 0; c < 3; ++c)
+        ret.matrices[i][r].simd[c] = packed[i][r * 3 + c];
+      ret.matrices[i][r].simd[3] = 0.f;
     }
-
-    ret.emplace(std::move(mat_name), std::move(matOut));
   }
+  return ret;
+}
 
+std::unordered_map<std::string, Matrix3f> DataStream::getBoneMatrices(std::string_view name) {
+  BoneMatrices arr = getBoneMatrixArray(name);
+  std::unordered_map<std::string, Matrix3f> ret;
+  ret.reserve(arr.names.size());
+  for (size_t i = 0; i < arr.names.size(); ++i)
+    ret.emplace(std::move(arr.names[i]), arr.matrices[i]);
   return ret;
 }
 
@@ -1667,7 +2190,49 @@ bool DataStream::renderPvsLight(std::string_view path, std::string_view lightNam
   return true;
 }
 
+void DataStream::_renderPvsBatch(const PvsProbe* probes, size_t count, uint8_t* results) {
+  m_parent->_writeStr(fmt::format(FMT_STRING("RENDERPVSBATCH {}"), count));
+  for (size_t i = 0; i < count; ++i) {
+    const PvsProbe& probe = probes[i];
+    m_parent->_writeStr(probe.path);
+    m_parent->_writeStr(probe.lightName);
+    athena::simd_floats f(probe.location.simd);
+    const float location[3] = {f[0], f[1], f[2]};
+    m_parent->_writeBuf(location, sizeof(location));
+  }
+  m_parent->_checkOk("unable to render PVS batch"sv);
+  m_parent->_readBuf(results, count);
+}
+
+std::vector<bool> DataStream::renderPvsBatch(const std::vector<PvsProbe>& probes, size_t instanceCount) {
+  HECL_TRACE_SCOPE("renderPvsBatch", m_parent->getBlendPath().getRelativePathUTF8());
+  std::vector<bool> ret(probes.size(), false);
+  if (probes.empty())
+    return ret;
+
+  if (m_parent->getBlendType() != BlendType::Area)
+    BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not an AREA blend")),
+                      m_parent->getBlendPath().getAbsolutePath());
+
+  /* Each instance pays for blender startup and a blend load, so keep shares substantial */
+  constexpr size_t MinProbesPerInstance = 8;
+  const size_t maxInstances = (probes.size() + MinProbesPerInstance - 1) / MinProbesPerInstance;
+  instanceCount = std::clamp(instanceCount, size_t(1), maxInstances);
+  const size_t share = (probes.size() + instanceCount - 1) / instanceCount;
+
+  /* Shares beyond the first go to idle cook workers, whose blenders count against the memory budget */
+  std::vector<uint8_t> results(probes.size(), 0);
+  ClientProcess::DistributeBlendWork(*this, probes.size(), share, [&](DataStream& ds, size_t begin, size_t end) {
+    ds._renderPvsBatch(probes.data() + begin, end - begin, results.data() + begin);
+  });
+
+  for (size_t i = 0; i < probes.size(); ++i)
+    ret[i] = results[i] != 0;
+  return ret;
+}
+
 MapArea DataStream::compileMapArea() {
+  HECL_TRACE_SCOPE("compileMapArea", m_parent->getBlendPath().getRelativePathUTF8());
   if (m_parent->getBlendType() != BlendType::MapArea)
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not a MAPAREA blend")),
                       m_parent->getBlendPath().getAbsolutePath());
@@ -1679,6 +2244,7 @@ MapArea DataStream::compileMapArea() {
 }
 
 MapUniverse DataStream::compileMapUniverse() {
+  HECL_TRACE_SCOPE("compileMapUniverse", m_parent->getBlendPath().getRelativePathUTF8());
   if (m_parent->getBlendType() != BlendType::MapUniverse)
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not a MAPUNIVERSE blend")),
                       m_parent->getBlendPath().getAbsolutePath());
@@ -1689,6 +2255,63 @@ MapUniverse DataStream::compileMapUniverse() {
   return {*m_parent};
 }
 
+void Connection::resetPeakMemory() {
+#if __linux__
+  /* Writing 5 to clear_refs resets VmHWM to the current resident size */
+  const std::string path = fmt::format(FMT_STRING("/proc/{}/clear_refs"), m_blenderProc);
+  if (FILE* fp = std::fopen(path.c_str(), "w")) {
+    std::fputs("5", fp);
+    std::fclose(fp);
+  }
+#endif
+}
+
+uint64_t Connection::getPeakMemoryKb() const {
+#if _WIN32
+  PROCESS_MEMORY_COUNTERS pmc = {};
+  if (!GetProcessMemoryInfo(m_pinfo.hProcess, &pmc, sizeof(pmc)))
+    return 0;
+  return uint64_t(pmc.PeakWorkingSetSize) / 1024;
+#elif __linux__
+  const std::string path = fmt::format(FMT_STRING("/proc/{}/status"), m_blenderProc);
+  FILE* fp = std::fopen(path.c_str(), "r");
+  if (!fp)
+    return 0;
+  uint64_t ret = 0;
+  char line[256];
+  while (std::fgets(line, sizeof(line), fp))
+    if (std::sscanf(line, "VmHWM: %" SCNu64, &ret) == 1)
+      break;
+  std::fclose(fp);
+  return ret;
+#else
+  return 0;
+#endif
+}
+
+uint64_t Connection::getMemoryKb() const {
+#if _WIN32
+  PROCESS_MEMORY_COUNTERS pmc = {};
+  if (!GetProcessMemoryInfo(m_pinfo.hProcess, &pmc, sizeof(pmc)))
+    return 0;
+  return uint64_t(pmc.WorkingSetSize) / 1024;
+#elif __linux__
+  const std::string path = fmt::format(FMT_STRING("/proc/{}/status"), m_blenderProc);
+  FILE* fp = std::fopen(path.c_str(), "r");
+  if (!fp)
+    return 0;
+  uint64_t ret = 0;
+  char line[256];
+  while (std::fgets(line, sizeof(line), fp))
+    if (std::sscanf(line, "VmRSS: %" SCNu64, &ret) == 1)
+      break;
+  std::fclose(fp);
+  return ret;
+#else
+  return 0;
+#endif
+}
+
 void Connection::quitBlender() {
   if (m_blenderQuit)
     return;
@@ -1709,20 +2332,55 @@ void Connection::quitBlender() {
   _writeStr("QUIT");
   _readStr(lineBuf, sizeof(lineBuf));
 #ifndef _WIN32
-  waitpid(m_blenderProc, nullptr, 0);
+  if (!m_forkServerChild)
+    ReapBlender(m_blenderProc);
 #endif
 }
 
 Connection& Connection::SharedConnection() { return SharedBlenderToken.getBlenderConnection(); }
 
-void Connection::Shutdown() { SharedBlenderToken.shutdown(); }
+void Connection::Shutdown() {
+  SharedBlenderToken.shutdown();
+
+  std::vector<std::unique_ptr<Connection>> pool;
+  {
+    std::unique_lock lk{WarmPoolMutex};
+    pool.swap(WarmPool);
+  }
+  for (auto& conn : pool)
+    conn->quitBlender();
+#ifndef _WIN32
+  _shutdownForkServer();
+#endif
+  if (!pool.empty() && hecl::VerbosityLevel >= 1)
+    BlenderLog.report(logvisor::Info, FMT_STRING("Blender Shutdown Successful"));
+}
 
 Connection& Token::getBlenderConnection() {
-  if (!m_conn)
-    m_conn = std::make_unique<Connection>(hecl::VerbosityLevel);
+  if (!m_conn) {
+    std::unique_lock lk{WarmPoolMutex};
+    if (!WarmPool.empty()) {
+      m_conn = std::move(WarmPool.back());
+      WarmPool.pop_back();
+    } else {
+      lk.unlock();
+      m_conn = std::make_unique<Connection>(hecl::VerbosityLevel);
+    }
+  }
   return *m_conn;
 }
 
+void Token::release() {
+  if (!m_conn)
+    return;
+  if (m_conn->isStreamActive()) {
+    shutdown();
+    return;
+  }
+  std::unique_lock lk{WarmPoolMutex};
+  WarmPool.push_back(std::move(m_conn));
+}
+
 void Token::shutdown() {
   if (m_conn) {
     m_conn->quitBlender();
@@ -1735,17 +2393,24 @@ void Token::shutdown() {
 Token::~Token() { shutdown(); }
 
 HMDLBuffers::HMDLBuffers(HMDLMeta&& meta, std::size_t vboSz, const std::vector<atUint32>& iboData,
-                         std::vector<Surface>&& surfaces, const Mesh::SkinBanks& skinBanks)
+                         std::vector<Surface>&& surfaces, std::vector<HMDLCluster>&& clusters,
+                         const Mesh::SkinBanks& skinBanks)
 : m_meta(std::move(meta))
 , m_vboSz(vboSz)
 , m_vboData(new uint8_t[vboSz])
-, m_iboSz(iboData.size() * 4)
-, m_iboData(new uint8_t[iboData.size() * 4])
+, m_iboSz(iboData.size() * m_meta.indexSize)
+, m_iboData(new uint8_t[m_iboSz])
 , m_surfaces(std::move(surfaces))
+, m_clusters(std::move(clusters))
 , m_skinBanks(skinBanks) {
   if (m_iboSz) {
     athena::io::MemoryWriter w(m_iboData.get(), m_iboSz);
-    w.enumerateLittle(iboData);
+    if (m_meta.indexSize == 2) {
+      for (atUint32 idx : iboData)
+        w.writeUint16Little(idx == 0xffffffff ? 0xffff : atUint16(idx));
+    } else {
+      w.enumerateLittle(iboData);
+    }
   }
 }
 
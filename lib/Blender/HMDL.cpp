@@ -1,10 +1,16 @@
 #include "hecl/Blender/Connection.hpp"
 
+#include <algorithm>
 #include <cfloat>
 #include <cmath>
 #include <cstddef>
+#include <initializer_list>
+#include <unordered_map>
 #include <vector>
 
+#include "hecl/Quantize.hpp"
+#include "hecl/Trace.hpp"
+
 #include <athena/MemoryWriter.hpp>
 
 #undef min
@@ -40,7 +46,325 @@ atVec3f MtxVecMul3RM(const Matrix4f& mtx, const Vector3f& vec) {
   return res;
 }
 
-HMDLBuffers Mesh::getHMDLBuffers(bool absoluteCoords, PoolSkinIndex& poolSkinIndex) const {
+namespace {
+/* Affine columns of a row-major matrix, so a transform is one broadcast multiply-add per component */
+struct AffineColumns {
+  athena::simd<float> m_cols[4];
+
+  explicit AffineColumns(const Matrix4f& mtx) {
+    athena::simd_floats rows[3];
+    for (int i = 0; i < 3; ++i)
+      mtx[i].simd.copy_to(rows[i]);
+    for (int j = 0; j < 4; ++j) {
+      athena::simd_floats col;
+      for (int i = 0; i < 3; ++i)
+        col[i] = rows[i][j];
+      col[3] = 0.f;
+      m_cols[j].copy_from(col);
+    }
+  }
+
+  athena::simd<float> transform3(const athena::simd<float>& vec) const {
+    athena::simd_floats f;
+    vec.copy_to(f);
+    return m_cols[0] * athena::simd<float>(f[0]) + m_cols[1] * athena::simd<float>(f[1]) +
+           m_cols[2] * athena::simd<float>(f[2]);
+  }
+};
+
+/* Whole-array equivalents of MtxVecMul4RM and MtxVecMul3RM, the latter renormalized */
+std::vector<atVec3f> TransformPositions(const Matrix4f& mtx, const std::vector<Vector3f>& in) {
+  const AffineColumns xf(mtx);
+  std::vector<atVec3f> out(in.size());
+  for (size_t i = 0; i < in.size(); ++i)
+    out[i].simd = xf.transform3(in[i].val.simd) + xf.m_cols[3];
+  return out;
+}
+
+std::vector<atVec3f> TransformNormals(const Matrix4f& mtx, const std::vector<Vector3f>& in) {
+  const AffineColumns xf(mtx);
+  std::vector<atVec3f> out(in.size());
+  for (size_t i = 0; i < in.size(); ++i) {
+    athena::simd<float> n = xf.transform3(in[i].val.simd);
+    const athena::simd_floats f(n * n);
+    float mag = f[0] + f[1] + f[2];
+    if (mag > FLT_EPSILON)
+      n *= athena::simd<float>(1.f / std::sqrt(mag));
+    out[i].simd = n;
+  }
+  return out;
+}
+
+/* Tangent xyz rotate with the normals; the bitangent sign in w is kept */
+std::vector<atVec4f> TransformTangents(const Matrix4f& mtx, const std::vector<Vector4f>& in) {
+  const AffineColumns xf(mtx);
+  std::vector<atVec4f> out(in.size());
+  for (size_t i = 0; i < in.size(); ++i) {
+    athena::simd<float> t = xf.transform3(in[i].val.simd);
+    const athena::simd_floats f(t * t);
+    float mag = f[0] + f[1] + f[2];
+    if (mag > FLT_EPSILON)
+      t *= athena::simd<float>(1.f / std::sqrt(mag));
+    t[3] = in[i].val.simd[3];
+    out[i].simd = t;
+  }
+  return out;
+}
+
+/* Unique VBO vertex: index tuple plus the skin bank it is bound through */
+struct PoolKey {
+  const Mesh::Surface::Vert* vert;
+  uint32_t skinBankIdx;
+  bool operator==(const PoolKey& other) const { return *vert == *other.vert && skinBankIdx == other.skinBankIdx; }
+};
+
+struct PoolKeyHash {
+  std::size_t operator()(const PoolKey& key) const noexcept {
+    const Mesh::Surface::Vert& v = *key.vert;
+    std::size_t h = v.iPos;
+    hecl::hash_combine_impl(h, std::size_t(v.iNorm));
+    for (uint32_t c : v.iColor)
+      hecl::hash_combine_impl(h, std::size_t(c));
+    for (uint32_t u : v.iUv)
+      hecl::hash_combine_impl(h, std::size_t(u));
+    hecl::hash_combine_impl(h, std::size_t(v.iSkin));
+    hecl::hash_combine_impl(h, std::size_t(v.iTangent));
+    hecl::hash_combine_impl(h, std::size_t(key.skinBankIdx));
+    return h;
+  }
+};
+
+using VertPoolMap = std::unordered_map<PoolKey, uint32_t, PoolKeyHash>;
+
+/* Modeled FIFO post-transform cache; small enough to hold on all of our targets */
+constexpr std::size_t VertexCacheSize = 24;
+/* Front-to-back strip groups; cache ordering is only applied within a group */
+constexpr std::size_t OverdrawBuckets = 8;
+
+/**
+ * Reorders the restart-separated strips of a surface.
+ * Strips are sorted by how far they face out from the surface centroid (so
+ * outer geometry tends to draw first and occlude the rest), split into
+ * buckets, and each bucket is greedily ordered by hits in a simulated FIFO
+ * vertex cache. Windings are untouched since strips are moved whole.
+ */
+std::vector<const Mesh::Surface::Vert*> OptimizeStripOrder(const Mesh& mesh, const Mesh::Surface& surf,
+                                                           VertPoolMap& ids) {
+  struct Strip {
+    std::size_t begin;
+    std::size_t end;
+    float outwardness = 0.f;
+  };
+  std::vector<Strip> strips;
+  std::vector<uint32_t> stripIds;
+  stripIds.reserve(surf.verts.size());
+  const athena::simd_floats center(surf.centroid.val.simd);
+  for (std::size_t i = 0; i < surf.verts.size();) {
+    Strip strip{stripIds.size(), stripIds.size()};
+    athena::simd<float> centroid(0.f);
+    athena::simd<float> normal(0.f);
+    for (; i < surf.verts.size() && surf.verts[i].iPos != 0xffffffff; ++i) {
+      const Mesh::Surface::Vert& v = surf.verts[i];
+      auto search = ids.emplace(PoolKey{&v, surf.skinBankIdx}, uint32_t(ids.size())).first;
+      stripIds.push_back(search->second);
+      centroid += mesh.pos[v.iPos].val.simd;
+      normal += mesh.norm[v.iNorm].val.simd;
+    }
+    strip.end = stripIds.size();
+    if (strip.end != strip.begin) {
+      centroid /= athena::simd<float>(float(strip.end - strip.begin));
+      const athena::simd_floats c(centroid);
+      const athena::simd_floats n(normal);
+      for (int j = 0; j < 3; ++j)
+        strip.outwardness += (c[j] - center[j]) * n[j];
+      strips.push_back(strip);
+    }
+    ++i;
+  }
+
+  std::stable_sort(strips.begin(), strips.end(),
+                   [](const Strip& a, const Strip& b) { return a.outwardness > b.outwardness; });
+
+  /* Strips reachable from each provisional vertex id, for candidate lookup */
+  std::unordered_map<uint32_t, std::vector<uint32_t>> vertStrips;
+  for (uint32_t s = 0; s < strips.size(); ++s)
+    for (std::size_t i = strips[s].begin; i < strips[s].end; ++i)
+      vertStrips[stripIds[i]].push_back(s);
+
+  std::unordered_map<uint32_t, std::size_t> cacheStamp;
+  std::size_t missCount = 0;
+  const auto inCache = [&](uint32_t id) {
+    auto search = cacheStamp.find(id);
+    return search != cacheStamp.end() && missCount - search->second < VertexCacheSize;
+  };
+
+  std::vector<bool> emitted(strips.size());
+  std::vector<uint32_t> order;
+  order.reserve(strips.size());
+  const std::size_t bucketSize = std::max(strips.size() / OverdrawBuckets, std::size_t(1));
+  for (std::size_t bucketBegin = 0; bucketBegin < strips.size(); bucketBegin += bucketSize) {
+    const std::size_t bucketEnd = std::min(bucketBegin + bucketSize, strips.size());
+    std::size_t nextFallback = bucketBegin;
+    for (std::size_t n = bucketBegin; n < bucketEnd; ++n) {
+      /* Best strip among those touching vertices still resident in the cache */
+      uint32_t best = UINT32_MAX;
+      std::size_t bestHits = 0;
+      for (const auto& [id, stamp] : cacheStamp) {
+        if (missCount - stamp >= VertexCacheSize)
+          continue;
+        for (uint32_t s : vertStrips[id]) {
+          if (emitted[s] || s < bucketBegin || s >= bucketEnd)
+            continue;
+          std::size_t hits = 0;
+          for (std::size_t i = strips[s].begin; i < strips[s].end; ++i)
+            hits += inCache(stripIds[i]);
+          if (hits > bestHits || (hits == bestHits && s < best)) {
+            best = s;
+            bestHits = hits;
+          }
+        }
+      }
+      if (best == UINT32_MAX) {
+        while (emitted[nextFallback])
+          ++nextFallback;
+        best = uint32_t(nextFallback);
+      }
+
+      emitted[best] = true;
+      order.push_back(best);
+      for (std::size_t i = strips[best].begin; i < strips[best].end; ++i) {
+        if (!inCache(stripIds[i]))
+          cacheStamp[stripIds[i]] = missCount++;
+      }
+      /* Drop stale entries so candidate scans stay proportional to the cache size */
+      for (auto it = cacheStamp.begin(); it != cacheStamp.end();) {
+        if (missCount - it->second >= VertexCacheSize)
+          it = cacheStamp.erase(it);
+        else
+          ++it;
+      }
+    }
+  }
+
+  /* Map provisional ids back to vertex records, rejoining strips with restarts */
+  std::vector<const Mesh::Surface::Vert*> stripVerts;
+  stripVerts.reserve(stripIds.size());
+  for (std::size_t i = 0; i < surf.verts.size(); ++i)
+    if (surf.verts[i].iPos != 0xffffffff)
+      stripVerts.push_back(&surf.verts[i]);
+  static const Mesh::Surface::Vert Restart = {};
+  std::vector<const Mesh::Surface::Vert*> ret;
+  ret.reserve(surf.verts.size());
+  for (uint32_t s : order) {
+    if (!ret.empty())
+      ret.push_back(&Restart);
+    for (std::size_t i = strips[s].begin; i < strips[s].end; ++i)
+      ret.push_back(stripVerts[i]);
+  }
+  return ret;
+}
+
+/* Range of clustered surface verts, excluding the restart leading into it */
+struct ClusterRange {
+  std::size_t begin;
+  std::size_t end;
+};
+
+/**
+ * Rewrites the verts of a surface as a run of clusters, each referencing at
+ * most maxVerts unique verts and maxTris triangles. Strips are packed whole
+ * while they fit and are otherwise split at a triangle boundary; a split at an
+ * odd triangle is led by a repeated vert so the remaining windings hold.
+ */
+std::vector<const Mesh::Surface::Vert*> ClusterSurface(const std::vector<const Mesh::Surface::Vert*>& verts,
+                                                       HMDLTopology topology, uint32_t skinBankIdx,
+                                                       uint32_t maxVerts, uint32_t maxTris,
+                                                       std::vector<ClusterRange>& rangesOut) {
+  static const Mesh::Surface::Vert Restart = {};
+  maxVerts = std::max(maxVerts, 3u);
+  maxTris = std::max(maxTris, 1u);
+
+  std::vector<const Mesh::Surface::Vert*> ret;
+  ret.reserve(verts.size());
+  VertPoolMap clusterVerts;
+  uint32_t clusterTris = 0;
+  std::size_t clusterBegin = 0;
+  bool runOpen = false;
+
+  const auto closeCluster = [&]() {
+    if (clusterTris)
+      rangesOut.push_back({clusterBegin, ret.size()});
+    clusterVerts.clear();
+    clusterTris = 0;
+    runOpen = false;
+  };
+  const auto newVertCount = [&](const Mesh::Surface::Vert* const* tri) {
+    std::size_t count = 0;
+    for (int i = 0; i < 3; ++i) {
+      bool seen = clusterVerts.find(PoolKey{tri[i], skinBankIdx}) != clusterVerts.end();
+      for (int j = 0; j < i && !seen; ++j)
+        seen = *tri[j] == *tri[i];
+      count += !seen;
+    }
+    return count;
+  };
+  /* Returns true if the triangle begins a new cluster */
+  const auto addTri = [&](const Mesh::Surface::Vert* const* tri) {
+    if (clusterTris && (clusterTris + 1 > maxTris || clusterVerts.size() + newVertCount(tri) > maxVerts))
+      closeCluster();
+    for (int i = 0; i < 3; ++i)
+      clusterVerts.emplace(PoolKey{tri[i], skinBankIdx}, 0);
+    return ++clusterTris == 1;
+  };
+
+  std::vector<const Mesh::Surface::Vert*> strip;
+  for (std::size_t i = 0; i <= verts.size(); ++i) {
+    if (i < verts.size() && verts[i]->iPos != 0xffffffff) {
+      strip.push_back(verts[i]);
+      continue;
+    }
+
+    if (topology == HMDLTopology::Triangles) {
+      for (std::size_t t = 0; t + 2 < strip.size(); t += 3) {
+        if (addTri(&strip[t]))
+          clusterBegin = ret.size();
+        ret.insert(ret.end(), strip.begin() + t, strip.begin() + t + 3);
+      }
+    } else {
+      for (std::size_t t = 0; t + 2 < strip.size(); ++t) {
+        const bool newCluster = addTri(&strip[t]);
+        if (!runOpen) {
+          if (!ret.empty())
+            ret.push_back(&Restart);
+          if (newCluster)
+            clusterBegin = ret.size();
+          if (t & 1)
+            ret.push_back(strip[t]);
+          ret.push_back(strip[t]);
+          ret.push_back(strip[t + 1]);
+          runOpen = true;
+        }
+        ret.push_back(strip[t + 2]);
+      }
+      runOpen = false;
+    }
+    strip.clear();
+  }
+  closeCluster();
+  return ret;
+}
+
+size_t AttrFormatSize(HMDLAttrFormat fmt, std::initializer_list<HMDLAttrFormat> allowed, size_t floatSize,
+                      size_t packedSize, const char* attrName) {
+  if (std::find(allowed.begin(), allowed.end(), fmt) == allowed.end())
+    BlenderLog.report(logvisor::Fatal, FMT_STRING("unsupported HMDL {} format {}"), attrName, int(fmt));
+  return fmt == HMDLAttrFormat::Float32 ? floatSize : packedSize;
+}
+} // anonymous namespace
+
+HMDLBuffers Mesh::getHMDLBuffers(bool absoluteCoords, PoolSkinIndex& poolSkinIndex,
+                                 const HMDLOptions& options) const {
+  HECL_TRACE_SCOPE("getHMDLBuffers");
   /* If skinned, compute max weight vec count */
   size_t weightCount = 0;
   for (const SkinBanks::Bank& bank : skinBanks.banks)
@@ -52,20 +376,45 @@ HMDLBuffers Mesh::getHMDLBuffers(bool absoluteCoords, PoolSkinIndex& poolSkinInd
   /* Prepare HMDL meta */
   HMDLMeta metaOut;
   metaOut.topology = topology;
-  metaOut.vertStride = (3 + 3 + colorLayerCount + uvLayerCount * 2 + weightVecCount * 4) * 4;
+  const size_t posSize = AttrFormatSize(options.posFormat, {HMDLAttrFormat::Float32, HMDLAttrFormat::Unorm16}, 12, 8,
+                                        "position");
+  const size_t normSize = AttrFormatSize(options.normFormat, {HMDLAttrFormat::Float32, HMDLAttrFormat::Oct16}, 12, 4,
+                                         "normal");
+  const size_t uvSize =
+      AttrFormatSize(options.uvFormat, {HMDLAttrFormat::Float32, HMDLAttrFormat::Unorm16, HMDLAttrFormat::Half16}, 8,
+                     4, "uv");
+  const size_t weightSize = AttrFormatSize(options.weightFormat, {HMDLAttrFormat::Float32, HMDLAttrFormat::Unorm8},
+                                           16, 4, "weight");
+  const bool emitTangents = options.tangents && !tangent.empty();
+  const size_t tangentSize = emitTangents ? (options.normFormat == HMDLAttrFormat::Oct16 ? 8 : 16) : 0;
+  metaOut.vertStride = posSize + normSize + tangentSize + colorLayerCount * 4 + uvLayerCount * uvSize +
+                       weightVecCount * weightSize;
+  metaOut.tangentCount = emitTangents ? 1 : 0;
   metaOut.colorCount = colorLayerCount;
   metaOut.uvCount = uvLayerCount;
   metaOut.weightCount = weightVecCount;
   metaOut.bankCount = skinBanks.banks.size();
+  metaOut.posFormat = options.posFormat;
+  metaOut.normFormat = options.normFormat;
+  metaOut.uvFormat = options.uvFormat;
+  metaOut.weightFormat = options.weightFormat;
+  metaOut.posOffset = {};
+  metaOut.posScale.simd = athena::simd<float>(1.f);
 
   /* Total all verts from all surfaces (for ibo length) */
   size_t boundVerts = 0;
-  for (const Surface& surf : surfaces)
+  for (const Surface& surf : surfaces) {
     boundVerts += surf.verts.size();
+    for (const std::vector<Surface::Vert>& lod : surf.lodVerts)
+      boundVerts += lod.size();
+  }
 
-  /* Maintain unique vert pool for VBO */
+  /* Maintain unique vert pool for VBO; verts are numbered in first-use order */
   std::vector<std::pair<const Surface*, const Surface::Vert*>> vertPool;
   vertPool.reserve(boundVerts);
+  VertPoolMap vertPoolIdxs;
+  vertPoolIdxs.reserve(boundVerts);
+  VertPoolMap provisionalIds;
 
   /* Target surfaces representation */
   std::vector<HMDLBuffers::Surface> outSurfaces;
@@ -75,58 +424,226 @@ HMDLBuffers Mesh::getHMDLBuffers(bool absoluteCoords, PoolSkinIndex& poolSkinInd
   std::vector<atUint32> iboData;
   iboData.reserve(boundVerts);
 
-  for (const Surface& surf : surfaces) {
-    size_t iboStart = iboData.size();
-    for (const Surface::Vert& v : surf.verts) {
-      if (v.iPos == 0xffffffff) {
-        iboData.push_back(0xffffffff);
+  /* Attributes are read several times per vert, so transform each source element exactly once */
+  std::vector<atVec3f> xfPos;
+  std::vector<atVec3f> xfNorm;
+  std::vector<atVec4f> xfTangent;
+  if (absoluteCoords) {
+    xfPos = TransformPositions(sceneXf, pos);
+    xfNorm = TransformNormals(sceneXf, norm);
+    if (emitTangents)
+      xfTangent = TransformTangents(sceneXf, tangent);
+  }
+  const auto vertPosition = [&](const Surface::Vert& v) -> atVec3f {
+    return absoluteCoords ? xfPos[v.iPos] : pos[v.iPos].val;
+  };
+  const auto vertNormal = [&](const Surface::Vert& v) -> atVec3f {
+    return absoluteCoords ? xfNorm[v.iNorm] : norm[v.iNorm].val;
+  };
+
+  /* Sphere about the AABB center; cone from triangle normals oriented by their vert normals */
+  const auto clusterBounds = [&](const Surface::Vert* const* verts, size_t count) {
+    HMDLCluster cluster;
+    athena::simd_floats minf(athena::simd<float>(FLT_MAX));
+    athena::simd_floats maxf(athena::simd<float>(-FLT_MAX));
+    for (size_t i = 0; i < count; ++i) {
+      if (verts[i]->iPos == 0xffffffff)
         continue;
+      const athena::simd_floats p(vertPosition(*verts[i]).simd);
+      for (int c = 0; c < 3; ++c) {
+        minf[c] = std::min(minf[c], p[c]);
+        maxf[c] = std::max(maxf[c], p[c]);
       }
+    }
+    athena::simd_floats center;
+    for (int c = 0; c < 4; ++c)
+      center[c] = c < 3 ? (minf[c] + maxf[c]) * 0.5f : 0.f;
+    float radiusSq = 0.f;
+    for (size_t i = 0; i < count; ++i) {
+      if (verts[i]->iPos == 0xffffffff)
+        continue;
+      const athena::simd_floats p(vertPosition(*verts[i]).simd);
+      float distSq = 0.f;
+      for (int c = 0; c < 3; ++c)
+        distSq += (p[c] - center[c]) * (p[c] - center[c]);
+      radiusSq = std::max(radiusSq, distSq);
+    }
+    cluster.sphereCenter.simd.copy_from(center);
+    cluster.sphereRadius = std::sqrt(radiusSq);
 
-      size_t ti = 0;
-      bool found = false;
-      for (const std::pair<const Surface*, const Surface::Vert*>& tv : vertPool) {
-        if (v == *tv.second && surf.skinBankIdx == tv.first->skinBankIdx) {
-          iboData.push_back(ti);
-          found = true;
-          break;
-        }
-        ++ti;
+    std::vector<athena::simd_floats> triNormals;
+    athena::simd_floats axis(athena::simd<float>(0.f));
+    const size_t triStep = topology == HMDLTopology::Triangles ? 3 : 1;
+    for (size_t i = 0; i + 2 < count; i += triStep) {
+      const Surface::Vert* tri[3] = {verts[i], verts[i + 1], verts[i + 2]};
+      if (tri[0]->iPos == 0xffffffff || tri[1]->iPos == 0xffffffff || tri[2]->iPos == 0xffffffff)
+        continue;
+      athena::simd_floats p[3];
+      athena::simd_floats vn(athena::simd<float>(0.f));
+      for (int j = 0; j < 3; ++j) {
+        p[j] = athena::simd_floats(vertPosition(*tri[j]).simd);
+        const athena::simd_floats n(vertNormal(*tri[j]).simd);
+        for (int c = 0; c < 3; ++c)
+          vn[c] += n[c];
       }
-      if (!found) {
-        iboData.push_back(vertPool.size());
-        vertPool.emplace_back(&surf, &v);
+      const float e1[3] = {p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2]};
+      const float e2[3] = {p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2]};
+      athena::simd_floats n(athena::simd<float>(0.f));
+      n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+      n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+      n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+      const float mag = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+      if (mag <= FLT_EPSILON)
+        continue;
+      const float sign = (n[0] * vn[0] + n[1] * vn[1] + n[2] * vn[2]) < 0.f ? -1.f : 1.f;
+      for (int c = 0; c < 3; ++c) {
+        n[c] *= sign / mag;
+        axis[c] += n[c];
+      }
+      triNormals.push_back(n);
+    }
+    const float axisMag = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    float minDot = -1.f;
+    if (axisMag > FLT_EPSILON) {
+      for (int c = 0; c < 3; ++c)
+        axis[c] /= axisMag;
+      minDot = 1.f;
+      for (const athena::simd_floats& n : triNormals)
+        minDot = std::min(minDot, n[0] * axis[0] + n[1] * axis[1] + n[2] * axis[2]);
+    }
+    cluster.coneAxis.simd.copy_from(axis);
+    /* Cones wider than a hemisphere never face entirely away */
+    cluster.coneCutoff = minDot > 0.f ? std::sqrt(1.f - minDot * minDot) : 1.f;
+    return cluster;
+  };
+
+  const auto emitVerts = [&](const Surface& surf, const std::vector<const Surface::Vert*>& verts) {
+    for (const Surface::Vert* v : verts) {
+      if (v->iPos == 0xffffffff) {
+        iboData.push_back(0xffffffff);
+        continue;
       }
+
+      auto [search, inserted] = vertPoolIdxs.emplace(PoolKey{v, surf.skinBankIdx}, uint32_t(vertPool.size()));
+      iboData.push_back(search->second);
+      if (inserted)
+        vertPool.emplace_back(&surf, v);
+    }
+  };
+
+  std::vector<HMDLCluster> outClusters;
+  std::vector<ClusterRange> clusterRanges;
+  std::vector<const Surface::Vert*> surfVerts;
+  for (const Surface& surf : surfaces) {
+    size_t iboStart = iboData.size();
+    if (options.optimizeOrder) {
+      surfVerts = OptimizeStripOrder(*this, surf, provisionalIds);
+    } else {
+      surfVerts.clear();
+      for (const Surface::Vert& v : surf.verts)
+        surfVerts.push_back(&v);
+    }
+    clusterRanges.clear();
+    if (options.clusterMaxVerts)
+      surfVerts = ClusterSurface(surfVerts, topology, surf.skinBankIdx, options.clusterMaxVerts,
+                                 options.clusterMaxTris, clusterRanges);
+    emitVerts(surf, surfVerts);
+    HMDLBuffers::Surface& outSurf = outSurfaces.emplace_back(surf, iboStart, iboData.size() - iboStart);
+
+    outSurf.m_clusterStart = outClusters.size();
+    outSurf.m_clusterCount = clusterRanges.size();
+    for (const ClusterRange& range : clusterRanges) {
+      HMDLCluster& cluster = outClusters.emplace_back(clusterBounds(&surfVerts[range.begin], range.end - range.begin));
+      cluster.indexStart = iboStart + range.begin;
+      cluster.indexCount = range.end - range.begin;
+    }
+  }
+
+  /* Reduced levels follow all full-detail surfaces, sharing their pooled verts */
+  for (size_t l = 0; l < lodScreenSizes.size(); ++l) {
+    for (size_t s = 0; s < surfaces.size(); ++s) {
+      const Surface& surf = surfaces[s];
+      const size_t iboStart = iboData.size();
+      surfVerts.clear();
+      if (l < surf.lodVerts.size())
+        for (const Surface::Vert& v : surf.lodVerts[l])
+          surfVerts.push_back(&v);
+      emitVerts(surf, surfVerts);
+      outSurfaces[s].m_lods.push_back({atUint32(iboStart), atUint32(iboData.size() - iboStart)});
     }
-    outSurfaces.emplace_back(surf, iboStart, iboData.size() - iboStart);
   }
 
   metaOut.vertCount = vertPool.size();
+  metaOut.clusterCount = outClusters.size();
+  metaOut.lodCount = lodScreenSizes.size();
   metaOut.indexCount = iboData.size();
+  /* 0xffff is reserved for primitive restart */
+  metaOut.indexSize = metaOut.vertCount < 0xffff ? 2 : 4;
+
+  /* Quantized positions are stored relative to the bounds of the emitted verts */
+  athena::simd_floats posMin, posInvScale;
+  if (options.posFormat == HMDLAttrFormat::Unorm16 && !vertPool.empty()) {
+    athena::simd_floats minf(athena::simd<float>(FLT_MAX));
+    athena::simd_floats maxf(athena::simd<float>(-FLT_MAX));
+    for (const auto& sv : vertPool) {
+      const athena::simd_floats p(vertPosition(*sv.second).simd);
+      for (int c = 0; c < 3; ++c) {
+        minf[c] = std::min(minf[c], p[c]);
+        maxf[c] = std::max(maxf[c], p[c]);
+      }
+    }
+    athena::simd_floats scalef;
+    for (int c = 0; c < 4; ++c) {
+      scalef[c] = c < 3 ? std::max(maxf[c] - minf[c], FLT_EPSILON) : 1.f;
+      posInvScale[c] = 1.f / scalef[c];
+      posMin[c] = c < 3 ? minf[c] : 0.f;
+    }
+    metaOut.posOffset.simd.copy_from(posMin);
+    metaOut.posScale.simd.copy_from(scalef);
+  }
 
   size_t vboSz = metaOut.vertCount * metaOut.vertStride;
   poolSkinIndex.allocate(vertPool.size());
-  HMDLBuffers ret(std::move(metaOut), vboSz, iboData, std::move(outSurfaces), skinBanks);
+  HMDLBuffers ret(std::move(metaOut), vboSz, iboData, std::move(outSurfaces), std::move(outClusters), skinBanks);
+  ret.m_lodScreenSizes = lodScreenSizes;
   athena::io::MemoryWriter vboW(ret.m_vboData.get(), vboSz);
   uint32_t curPoolIdx = 0;
   for (const std::pair<const Surface*, const Surface::Vert*>& sv : vertPool) {
     const Surface& s = *sv.first;
     const Surface::Vert& v = *sv.second;
 
-    if (absoluteCoords) {
-      atVec3f preXfPos = MtxVecMul4RM(sceneXf, pos[v.iPos]);
-      vboW.writeVec3fLittle(preXfPos);
-
-      atVec3f preXfNorm = MtxVecMul3RM(sceneXf, norm[v.iNorm]);
-      athena::simd_floats f(preXfNorm.simd * preXfNorm.simd);
-      float mag = f[0] + f[1] + f[2];
-      if (mag > FLT_EPSILON)
-        mag = 1.f / std::sqrt(mag);
-      preXfNorm.simd *= mag;
-      vboW.writeVec3fLittle(preXfNorm);
+    const atVec3f position = vertPosition(v);
+    if (options.posFormat == HMDLAttrFormat::Unorm16) {
+      const athena::simd_floats p(position.simd);
+      for (int c = 0; c < 3; ++c)
+        vboW.writeUint16Little(FloatToUnorm16((p[c] - posMin[c]) * posInvScale[c]));
+      vboW.writeUint16Little(0);
     } else {
-      vboW.writeVec3fLittle(pos[v.iPos]);
-      vboW.writeVec3fLittle(norm[v.iNorm]);
+      vboW.writeVec3fLittle(position);
+    }
+
+    const atVec3f normal = vertNormal(v);
+    if (options.normFormat == HMDLAttrFormat::Oct16) {
+      const athena::simd_floats n(normal.simd);
+      const auto [u, w] = OctEncode(n[0], n[1], n[2]);
+      vboW.writeInt16Little(FloatToSnorm16(u));
+      vboW.writeInt16Little(FloatToSnorm16(w));
+    } else {
+      vboW.writeVec3fLittle(normal);
+    }
+
+    if (emitTangents) {
+      const atVec4f tan = absoluteCoords ? xfTangent[v.iTangent] : tangent[v.iTangent].val;
+      if (options.normFormat == HMDLAttrFormat::Oct16) {
+        const athena::simd_floats t(tan.simd);
+        const auto [u, w] = OctEncode(t[0], t[1], t[2]);
+        vboW.writeInt16Little(FloatToSnorm16(u));
+        vboW.writeInt16Little(FloatToSnorm16(w));
+        vboW.writeInt16Little(FloatToSnorm16(t[3] < 0.f ? -1.f : 1.f));
+        vboW.writeInt16Little(0);
+      } else {
+        vboW.writeVec4fLittle(tan);
+      }
     }
 
     for (size_t i = 0; i < colorLayerCount; ++i) {
@@ -138,8 +655,21 @@ HMDLBuffers Mesh::getHMDLBuffers(bool absoluteCoords, PoolSkinIndex& poolSkinInd
       vboW.writeUByte(255);
     }
 
-    for (size_t i = 0; i < uvLayerCount; ++i)
-      vboW.writeVec2fLittle(uv[v.iUv[i]]);
+    for (size_t i = 0; i < uvLayerCount; ++i) {
+      switch (options.uvFormat) {
+      case HMDLAttrFormat::Unorm16:
+      case HMDLAttrFormat::Half16: {
+        const athena::simd_floats f(uv[v.iUv[i]].val.simd);
+        for (int c = 0; c < 2; ++c)
+          vboW.writeUint16Little(options.uvFormat == HMDLAttrFormat::Half16 ? FloatToHalf(f[c])
+                                                                            : FloatToUnorm16(f[c]));
+        break;
+      }
+      default:
+        vboW.writeVec2fLittle(uv[v.iUv[i]]);
+        break;
+      }
+    }
 
     if (weightVecCount) {
       const SkinBanks::Bank& bank = skinBanks.banks[s.skinBankIdx];
@@ -161,7 +691,13 @@ HMDLBuffers Mesh::getHMDLBuffers(bool absoluteCoords, PoolSkinIndex& poolSkinInd
           }
           ++it;
         }
-        vboW.writeVec4fLittle(vec);
+        if (options.weightFormat == HMDLAttrFormat::Unorm8) {
+          const athena::simd_floats f(vec.simd);
+          for (int c = 0; c < 4; ++c)
+            vboW.writeUByte(FloatToUnorm8(f[c]));
+        } else {
+          vboW.writeVec4fLittle(vec);
+        }
       }
     }
 
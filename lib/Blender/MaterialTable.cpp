@@ -0,0 +1,31 @@
+#include "hecl/Blender/Connection.hpp"
+
+namespace hecl::blender {
+
+MaterialTable& MaterialTable::Shared() {
+  static MaterialTable table;
+  return table;
+}
+
+uint32_t MaterialTable::intern(const Material& mat) {
+  std::unique_lock lk{m_mutex};
+  for (auto [it, end] = m_lookup.equal_range(mat.contentHash); it != end; ++it)
+    if (m_materials[it->second] == mat)
+      return it->second;
+  const auto id = uint32_t(m_materials.size());
+  m_materials.push_back(mat);
+  m_lookup.emplace(mat.contentHash, id);
+  return id;
+}
+
+const Material& MaterialTable::get(uint32_t id) const {
+  std::unique_lock lk{m_mutex};
+  return m_materials.at(id);
+}
+
+std::size_t MaterialTable::size() const {
+  std::unique_lock lk{m_mutex};
+  return m_materials.size();
+}
+
+} // namespace hecl::blender
@@ -0,0 +1,118 @@
+#include "hecl/Blender/Connection.hpp"
+
+#include <algorithm>
+
+namespace hecl::blender {
+
+MeshGeometryCache& MeshGeometryCache::Shared() {
+  static MeshGeometryCache cache;
+  return cache;
+}
+
+uint64_t MeshGeometryCache::Key(const uint8_t* attrData, std::size_t attrSize, const std::vector<Material>& materials,
+                                HMDLTopology topology, int skinSlotCount, bool useLuvs, bool genTangents) {
+  XXH64_state_t st;
+  XXH64_reset(&st, 0);
+  XXH64_update(&st, attrData, attrSize);
+  const uint32_t options[] = {uint32_t(topology), uint32_t(skinSlotCount), uint32_t(useLuvs), uint32_t(genTangents),
+                              uint32_t(materials.size())};
+  XXH64_update(&st, options, sizeof(options));
+  /* Material identity ignores pass order, which decides surface order */
+  for (const Material& mat : materials) {
+    XXH64_update(&st, &mat.contentHash, sizeof(mat.contentHash));
+    XXH64_update(&st, &mat.passIndex, sizeof(mat.passIndex));
+  }
+  return XXH64_digest(&st);
+}
+
+bool MeshGeometryCache::restore(uint64_t key, const std::vector<Material>& materials, Mesh& mesh) {
+  std::shared_ptr<const Geometry> geom;
+  {
+    std::unique_lock lk{m_mutex};
+    if (auto search = m_entries.find(key); search != m_entries.end())
+      geom = search->second;
+  }
+  const auto samePasses = [&]() {
+    return std::equal(materials.begin(), materials.end(), geom->materials.begin(), geom->materials.end(),
+                      [](const Material& a, const Material& b) { return a == b && a.passIndex == b.passIndex; });
+  };
+  if (!geom || !samePasses()) {
+    ++m_misses;
+    return false;
+  }
+  ++m_hits;
+
+  mesh.topology = geom->topology;
+  mesh.pos = geom->pos;
+  mesh.norm = geom->norm;
+  mesh.colorLayerCount = geom->colorLayerCount;
+  mesh.color = geom->color;
+  mesh.uvLayerCount = geom->uvLayerCount;
+  mesh.uv = geom->uv;
+  mesh.luv = geom->luv;
+  mesh.tangent = geom->tangent;
+  mesh.skins = geom->skins;
+  mesh.surfaces = geom->surfaces;
+  return true;
+}
+
+void MeshGeometryCache::insert(uint64_t key, const std::vector<Material>& materials, const Mesh& mesh) {
+  auto geom = std::make_shared<Geometry>();
+  geom->topology = mesh.topology;
+  geom->pos = mesh.pos;
+  geom->norm = mesh.norm;
+  geom->colorLayerCount = mesh.colorLayerCount;
+  geom->color = mesh.color;
+  geom->uvLayerCount = mesh.uvLayerCount;
+  geom->uv = mesh.uv;
+  geom->luv = mesh.luv;
+  geom->tangent = mesh.tangent;
+  geom->skins = mesh.skins;
+  geom->surfaces = mesh.surfaces;
+  geom->materials = materials;
+
+  std::size_t bytes = sizeof(Geometry) +
+                      (geom->pos.size() + geom->norm.size() + geom->color.size()) * sizeof(Vector3f) +
+                      (geom->uv.size() + geom->luv.size()) * sizeof(Vector2f) +
+                      geom->tangent.size() * sizeof(Vector4f) + geom->skins.size() * sizeof(geom->skins[0]) +
+                      geom->surfaces.size() * sizeof(Mesh::Surface);
+  for (const Mesh::Surface& surf : geom->surfaces)
+    bytes += surf.verts.size() * sizeof(Mesh::Surface::Vert);
+  geom->byteSize = bytes;
+
+  std::unique_lock lk{m_mutex};
+  if (bytes > m_budget)
+    return;
+  auto [it, inserted] = m_entries.try_emplace(key, std::move(geom));
+  if (!inserted)
+    return;
+  m_order.push_back(key);
+  m_bytes += bytes;
+  _evict();
+}
+
+void MeshGeometryCache::_evict() {
+  while (m_bytes > m_budget && !m_order.empty()) {
+    auto search = m_entries.find(m_order.front());
+    m_order.pop_front();
+    if (search == m_entries.end())
+      continue;
+    m_bytes -= search->second->byteSize;
+    m_entries.erase(search);
+  }
+}
+
+void MeshGeometryCache::setBudget(std::size_t bytes) {
+  std::unique_lock lk{m_mutex};
+  m_budget = bytes;
+  _evict();
+}
+
+void MeshGeometryCache::clear() {
+  std::unique_lock lk{m_mutex};
+  m_entries.clear();
+  m_order.clear();
+  m_bytes = 0;
+}
+
+} // namespace hecl::blender
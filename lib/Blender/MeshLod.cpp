@@ -0,0 +1,403 @@
+#include "hecl/Blender/Connection.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+#undef min
+#undef max
+
+namespace hecl::blender {
+
+namespace {
+using Vert = Mesh::Surface::Vert;
+using Tri = std::array<uint32_t, 3>;
+
+struct VertHash {
+  std::size_t operator()(const Vert& v) const noexcept {
+    std::size_t h = v.iPos;
+    hecl::hash_combine_impl(h, std::size_t(v.iNorm));
+    for (uint32_t c : v.iColor)
+      hecl::hash_combine_impl(h, std::size_t(c));
+    for (uint32_t u : v.iUv)
+      hecl::hash_combine_impl(h, std::size_t(u));
+    hecl::hash_combine_impl(h, std::size_t(v.iSkin));
+    hecl::hash_combine_impl(h, std::size_t(v.iTangent));
+    return h;
+  }
+};
+
+struct Vec3 {
+  double x, y, z;
+  Vec3 operator-(const Vec3& o) const { return {x - o.x, y - o.y, z - o.z}; }
+  double dot(const Vec3& o) const { return x * o.x + y * o.y + z * o.z; }
+  Vec3 cross(const Vec3& o) const { return {y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x}; }
+};
+
+/* Symmetric 4x4 error quadric of the planes around a vertex */
+struct Quadric {
+  double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0, b2 = 0.0, bc = 0.0, bd = 0.0, c2 = 0.0, cd = 0.0, d2 = 0.0;
+
+  void addPlane(const Vec3& n, double d) {
+    a2 += n.x * n.x;
+    ab += n.x * n.y;
+    ac += n.x * n.z;
+    ad += n.x * d;
+    b2 += n.y * n.y;
+    bc += n.y * n.z;
+    bd += n.y * d;
+    c2 += n.z * n.z;
+    cd += n.z * d;
+    d2 += d * d;
+  }
+  Quadric& operator+=(const Quadric& o) {
+    a2 += o.a2;
+    ab += o.ab;
+    ac += o.ac;
+    ad += o.ad;
+    b2 += o.b2;
+    bc += o.bc;
+    bd += o.bd;
+    c2 += o.c2;
+    cd += o.cd;
+    d2 += o.d2;
+    return *this;
+  }
+  /* Sum of squared distances from p to the accumulated planes */
+  double eval(const Vec3& p) const {
+    return a2 * p.x * p.x + 2.0 * ab * p.x * p.y + 2.0 * ac * p.x * p.z + 2.0 * ad * p.x + b2 * p.y * p.y +
+           2.0 * bc * p.y * p.z + 2.0 * bd * p.y + c2 * p.z * p.z + 2.0 * cd * p.z + d2;
+  }
+};
+
+struct Collapse {
+  double cost;
+  uint32_t from;
+  uint32_t to;
+  uint32_t fromStamp;
+  uint32_t toStamp;
+  bool operator>(const Collapse& other) const { return cost > other.cost; }
+};
+
+/* Strongest bone influence of a skin entry; collapses may not move verts between bones */
+uint32_t DominantBone(const Mesh& mesh, uint32_t iSkin) {
+  if (iSkin >= mesh.skins.size())
+    return UINT32_MAX;
+  uint32_t bone = UINT32_MAX;
+  float weight = -1.f;
+  for (const Mesh::SkinBind& bind : mesh.skins[iSkin]) {
+    if (!bind.valid())
+      break;
+    if (bind.weight > weight) {
+      weight = bind.weight;
+      bone = bind.vg_idx;
+    }
+  }
+  return bone;
+}
+
+/**
+ * Progressive edge-collapse simplifier over the triangles of one surface.
+ * Vertices are the unique index tuples of the surface; positions shared by
+ * more than one tuple (attribute seams), positions on open borders and
+ * positions referenced by other surfaces are locked so levels stay crack-free.
+ */
+class SurfaceSimplifier {
+  HMDLTopology m_topology;
+  std::vector<Vert> m_verts;
+  std::vector<Vec3> m_pos;
+  std::vector<Quadric> m_quadrics;
+  std::vector<uint32_t> m_stamps;
+  std::vector<uint32_t> m_bones;
+  std::vector<bool> m_locked;
+  std::vector<bool> m_dead;
+  std::vector<Tri> m_tris;
+  std::vector<bool> m_triDead;
+  std::vector<std::vector<uint32_t>> m_vertTris;
+  std::priority_queue<Collapse, std::vector<Collapse>, std::greater<>> m_heap;
+  std::size_t m_liveTris = 0;
+  double m_maxCost = 0.0;
+
+  void pushCollapse(uint32_t from, uint32_t to) {
+    if (m_locked[from] || m_bones[from] != m_bones[to])
+      return;
+    Quadric q = m_quadrics[from];
+    q += m_quadrics[to];
+    m_heap.push({std::max(q.eval(m_pos[to]), 0.0), from, to, m_stamps[from], m_stamps[to]});
+  }
+
+  void pushNeighbors(uint32_t v) {
+    for (uint32_t t : m_vertTris[v]) {
+      if (m_triDead[t])
+        continue;
+      for (uint32_t w : m_tris[t]) {
+        if (w == v)
+          continue;
+        pushCollapse(v, w);
+        pushCollapse(w, v);
+      }
+    }
+  }
+
+  /* Rejects collapses that would fold a remaining triangle over */
+  bool flips(uint32_t from, uint32_t to) const {
+    for (uint32_t t : m_vertTris[from]) {
+      if (m_triDead[t])
+        continue;
+      const Tri& tri = m_tris[t];
+      if (tri[0] == to || tri[1] == to || tri[2] == to)
+        continue;
+      std::array<Vec3, 3> p = {m_pos[tri[0]], m_pos[tri[1]], m_pos[tri[2]]};
+      const Vec3 before = (p[1] - p[0]).cross(p[2] - p[0]);
+      for (int i = 0; i < 3; ++i)
+        if (tri[i] == from)
+          p[i] = m_pos[to];
+      const Vec3 after = (p[1] - p[0]).cross(p[2] - p[0]);
+      if (before.dot(after) <= 0.0)
+        return true;
+    }
+    return false;
+  }
+
+  void collapse(uint32_t from, uint32_t to) {
+    m_dead[from] = true;
+    for (uint32_t t : m_vertTris[from]) {
+      if (m_triDead[t])
+        continue;
+      Tri& tri = m_tris[t];
+      if (tri[0] == to || tri[1] == to || tri[2] == to) {
+        m_triDead[t] = true;
+        --m_liveTris;
+        continue;
+      }
+      for (uint32_t& v : tri)
+        if (v == from)
+          v = to;
+      m_vertTris[to].push_back(t);
+    }
+    m_vertTris[from].clear();
+    m_quadrics[to] += m_quadrics[from];
+    ++m_stamps[to];
+    pushNeighbors(to);
+  }
+
+public:
+  SurfaceSimplifier(const Mesh& mesh, const Mesh::Surface& surf, const std::vector<uint32_t>& posSurfaceCounts)
+  : m_topology(mesh.topology) {
+    std::unordered_map<Vert, uint32_t, VertHash> vertIdxs;
+    const auto vertIdx = [&](const Vert& v) {
+      auto [search, inserted] = vertIdxs.emplace(v, uint32_t(m_verts.size()));
+      if (inserted)
+        m_verts.push_back(v);
+      return search->second;
+    };
+
+    /* Gather triangles in their drawn winding */
+    for (std::size_t i = 0; i < surf.verts.size();) {
+      std::size_t end = i;
+      while (end < surf.verts.size() && surf.verts[end].iPos != 0xffffffff)
+        ++end;
+      const std::size_t step = m_topology == HMDLTopology::Triangles ? 3 : 1;
+      for (std::size_t t = i; t + 2 < end; t += step) {
+        Tri tri = {vertIdx(surf.verts[t]), vertIdx(surf.verts[t + 1]), vertIdx(surf.verts[t + 2])};
+        if (m_topology == HMDLTopology::TriStrips && ((t - i) & 1))
+          std::swap(tri[0], tri[1]);
+        if (tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2])
+          continue;
+        m_tris.push_back(tri);
+      }
+      i = end + 1;
+    }
+
+    const std::size_t vertCount = m_verts.size();
+    m_pos.reserve(vertCount);
+    m_bones.reserve(vertCount);
+    for (const Vert& v : m_verts) {
+      const athena::simd_floats f(mesh.pos[v.iPos].val.simd);
+      m_pos.push_back({f[0], f[1], f[2]});
+      m_bones.push_back(DominantBone(mesh, v.iSkin));
+    }
+    m_quadrics.resize(vertCount);
+    m_stamps.resize(vertCount);
+    m_locked.resize(vertCount);
+    m_dead.resize(vertCount);
+    m_triDead.resize(m_tris.size());
+    m_vertTris.resize(vertCount);
+    m_liveTris = m_tris.size();
+
+    /* Seams: positions carried by more than one index tuple */
+    std::unordered_map<uint32_t, uint32_t> posTuples;
+    for (const Vert& v : m_verts)
+      ++posTuples[v.iPos];
+    /* Borders: position edges used by a single triangle */
+    std::unordered_map<uint64_t, uint32_t> edgeUses;
+    const auto edgeKey = [&](uint32_t a, uint32_t b) {
+      uint32_t pa = m_verts[a].iPos, pb = m_verts[b].iPos;
+      if (pa > pb)
+        std::swap(pa, pb);
+      return (uint64_t(pa) << 32) | pb;
+    };
+
+    for (uint32_t t = 0; t < m_tris.size(); ++t) {
+      const Tri& tri = m_tris[t];
+      Vec3 n = (m_pos[tri[1]] - m_pos[tri[0]]).cross(m_pos[tri[2]] - m_pos[tri[0]]);
+      const double mag = std::sqrt(n.dot(n));
+      if (mag > DBL_EPSILON) {
+        n = {n.x / mag, n.y / mag, n.z / mag};
+        const double d = -n.dot(m_pos[tri[0]]);
+        for (uint32_t v : tri)
+          m_quadrics[v].addPlane(n, d);
+      }
+      for (int i = 0; i < 3; ++i) {
+        m_vertTris[tri[i]].push_back(t);
+        ++edgeUses[edgeKey(tri[i], tri[(i + 1) % 3])];
+      }
+    }
+
+    for (uint32_t v = 0; v < vertCount; ++v) {
+      const uint32_t iPos = m_verts[v].iPos;
+      m_locked[v] = posTuples[iPos] > 1 || posSurfaceCounts[iPos] > 1;
+    }
+    for (const Tri& tri : m_tris) {
+      for (int i = 0; i < 3; ++i) {
+        if (edgeUses[edgeKey(tri[i], tri[(i + 1) % 3])] == 1) {
+          m_locked[tri[i]] = true;
+          m_locked[tri[(i + 1) % 3]] = true;
+        }
+      }
+    }
+
+    for (uint32_t v = 0; v < vertCount; ++v)
+      if (!m_locked[v])
+        pushNeighbors(v);
+  }
+
+  std::size_t triCount() const { return m_liveTris; }
+  /* Largest collapse error so far, as a distance in mesh units */
+  float error() const { return float(std::sqrt(m_maxCost)); }
+
+  void reduce(std::size_t targetTris) {
+    while (m_liveTris > targetTris && !m_heap.empty()) {
+      const Collapse c = m_heap.top();
+      m_heap.pop();
+      if (m_dead[c.from] || m_dead[c.to] || c.fromStamp != m_stamps[c.from] || c.toStamp != m_stamps[c.to])
+        continue;
+      if (flips(c.from, c.to))
+        continue;
+      m_maxCost = std::max(m_maxCost, c.cost);
+      collapse(c.from, c.to);
+    }
+  }
+
+  /* Emits the live triangles, greedily chained into strips for strip topology */
+  std::vector<Vert> output() const {
+    std::vector<Vert> ret;
+    std::vector<uint32_t> live;
+    for (uint32_t t = 0; t < m_tris.size(); ++t)
+      if (!m_triDead[t])
+        live.push_back(t);
+
+    if (m_topology == HMDLTopology::Triangles) {
+      for (uint32_t t : live)
+        for (uint32_t v : m_tris[t])
+          ret.push_back(m_verts[v]);
+      return ret;
+    }
+
+    /* Directed edge -> triangle winding through it */
+    std::unordered_map<uint64_t, uint32_t> edgeTris;
+    for (uint32_t t : live)
+      for (int i = 0; i < 3; ++i)
+        edgeTris[(uint64_t(m_tris[t][i]) << 32) | m_tris[t][(i + 1) % 3]] = t;
+
+    std::vector<bool> used(m_tris.size());
+    std::vector<uint32_t> strip;
+    for (uint32_t t : live) {
+      if (used[t])
+        continue;
+      used[t] = true;
+      strip.assign(m_tris[t].begin(), m_tris[t].end());
+      for (;;) {
+        /* Odd strip triangles are wound back through the previous edge */
+        const uint32_t a = strip[strip.size() - 2];
+        const uint32_t b = strip[strip.size() - 1];
+        const bool odd = strip.size() & 1;
+        auto search = edgeTris.find(odd ? (uint64_t(b) << 32) | a : (uint64_t(a) << 32) | b);
+        if (search == edgeTris.end() || used[search->second])
+          break;
+        const Tri& next = m_tris[search->second];
+        used[search->second] = true;
+        for (uint32_t v : next)
+          if (v != a && v != b)
+            strip.push_back(v);
+      }
+      if (!ret.empty())
+        ret.emplace_back();
+      for (uint32_t v : strip)
+        ret.push_back(m_verts[v]);
+    }
+    return ret;
+  }
+};
+} // anonymous namespace
+
+void Mesh::generateLods(const LodOptions& options) {
+  lodScreenSizes.clear();
+  for (Surface& surf : surfaces)
+    surf.lodVerts.clear();
+  if (!options.levelCount || pos.empty())
+    return;
+
+  /* Positions shared between surfaces are locked so material borders stay closed */
+  std::vector<uint32_t> posSurfaceCounts(pos.size());
+  std::vector<uint32_t> posLastSurface(pos.size(), UINT32_MAX);
+  for (uint32_t s = 0; s < surfaces.size(); ++s) {
+    for (const Surface::Vert& v : surfaces[s].verts) {
+      if (v.iPos == 0xffffffff || posLastSurface[v.iPos] == s)
+        continue;
+      posLastSurface[v.iPos] = s;
+      ++posSurfaceCounts[v.iPos];
+    }
+  }
+
+  /* Bounding radius used to turn geometric error into a projected size */
+  athena::simd_floats minf(athena::simd<float>(FLT_MAX));
+  athena::simd_floats maxf(athena::simd<float>(-FLT_MAX));
+  for (const Vector3f& p : pos) {
+    const athena::simd_floats f(p.val.simd);
+    for (int c = 0; c < 3; ++c) {
+      minf[c] = std::min(minf[c], f[c]);
+      maxf[c] = std::max(maxf[c], f[c]);
+    }
+  }
+  float radiusSq = 0.f;
+  for (int c = 0; c < 3; ++c)
+    radiusSq += (maxf[c] - minf[c]) * (maxf[c] - minf[c]) * 0.25f;
+  const float radius = std::sqrt(radiusSq);
+
+  std::vector<float> levelErrors(options.levelCount);
+  for (Surface& surf : surfaces) {
+    SurfaceSimplifier simplifier(*this, surf, posSurfaceCounts);
+    surf.lodVerts.reserve(options.levelCount);
+    float target = float(simplifier.triCount());
+    for (uint32_t l = 0; l < options.levelCount; ++l) {
+      target *= options.reduction;
+      simplifier.reduce(std::size_t(target));
+      surf.lodVerts.push_back(simplifier.output());
+      levelErrors[l] = std::max(levelErrors[l], simplifier.error());
+    }
+  }
+
+  /* Projected error = error * projectedRadius / radius; keep it under screenError */
+  lodScreenSizes.reserve(options.levelCount);
+  for (float error : levelErrors)
+    lodScreenSizes.push_back(error > FLT_EPSILON ? std::min(options.screenError * radius / error, FLT_MAX) : FLT_MAX);
+}
+
+} // namespace hecl::blender
@@ -4,63 +4,33 @@
 #include <cfloat>
 #include <climits>
 #include <cmath>
+#include <cstring>
+#include <iterator>
 #include <numeric>
+#include <unordered_map>
 #include <unordered_set>
 
+#include "hecl/ClientProcess.hpp"
+#include "hecl/Trace.hpp"
+
 namespace hecl::blender {
 
 logvisor::Module Log("MeshOptimizer");
 
-template <typename T>
-static void insert_unique_attr(std::unordered_map<T, uint32_t>& set, const T& attr) {
-  if (set.find(attr) == set.cend()) {
-    size_t sz = set.size();
-    set.insert(std::make_pair(attr, sz));
-  }
-}
-
-template <typename T>
-static std::vector<T> sort_unordered_map(const std::unordered_map<T, uint32_t>& map) {
-  struct SortableIterator {
-    typename std::unordered_map<T, uint32_t>::const_iterator it;
-    bool operator<(const SortableIterator& other) const { return it->second < other.it->second; }
-    explicit SortableIterator(typename std::unordered_map<T, uint32_t>::const_iterator i) : it(i) {}
-  };
-  std::vector<SortableIterator> to_sort;
-  to_sort.reserve(map.size());
-  for (auto I = map.cbegin(), E = map.cend(); I != E; ++I)
-    to_sort.emplace_back(I);
-  std::sort(to_sort.begin(), to_sort.end());
-  std::vector<T> ret;
-  ret.reserve(to_sort.size());
-  for (const auto& sit : to_sort)
-    ret.push_back(sit.it->first);
-  return ret;
-}
-
-static bool material_is_lightmapped(const Material& mat) {
-  auto search = mat.iprops.find("retro_lightmapped");
-  if (search != mat.iprops.cend())
-    return search->second;
-  return false;
-}
-
-MeshOptimizer::Vertex::Vertex(Connection& conn) {
-  co.read(conn);
-  uint32_t skin_count;
-  conn._readValue(skin_count);
-  if (skin_count > MaxSkinEntries)
-    Log.report(logvisor::Fatal, FMT_STRING("Skin entry overflow {}/{}"), skin_count, MaxSkinEntries);
-  for (uint32_t i = 0; i < skin_count; ++i)
-    skin_ents[i] = Mesh::SkinBind(conn);
+/* Below this many faces, handing jobs to other workers outweighs the strip search */
+constexpr size_t ParallelSurfaceMinFaces = 2048;
+
+/* Run job(j) for each j in [0, count) on idle cook workers, or inline for small meshes */
+template <typename F>
+static void DistributeJobs(size_t count, size_t face_count, const F& job) {
+  const size_t grain = face_count >= ParallelSurfaceMinFaces ? 1 : count;
+  ClientProcess::DistributeWork(count, grain, [&](size_t begin, size_t end) {
+    for (size_t j = begin; j < end; ++j)
+      job(j);
+  });
 }
 
-MeshOptimizer::Loop::Loop(Connection& conn, uint32_t color_count, uint32_t uv_count) {
-  normal.read(conn);
-  for (uint32_t i = 0; i < color_count; ++i)
-    colors[i].read(conn);
-  for (uint32_t i = 0; i < uv_count; ++i)
-    uvs[i].read(conn);
+MeshOptimizer::Loop::Loop(Connection& conn) {
   conn._readValue(vert);
   conn._readValue(edge);
   conn._readValue(face);
@@ -90,49 +60,8 @@ MeshOptimizer::Face::Face(Connection& conn) {
     conn._readValue(loops[i]);
 }
 
-uint32_t MeshOptimizer::get_pos_idx(const Vertex& v) const {
-  auto search = b_pos.find(v.co);
-  if (search != b_pos.cend())
-    return search->second;
-  return UINT32_MAX;
-}
-
-uint32_t MeshOptimizer::get_norm_idx(const Loop& l) const {
-  auto search = b_norm.find(l.normal);
-  if (search != b_norm.cend())
-    return search->second;
-  return UINT32_MAX;
-}
-
-uint32_t MeshOptimizer::get_skin_idx(const Vertex& v) const {
-  auto search = b_skin.find(v.skin_ents);
-  if (search != b_skin.cend())
-    return search->second;
-  return UINT32_MAX;
-}
-
-uint32_t MeshOptimizer::get_color_idx(const Loop& l, uint32_t cidx) const {
-  auto search = b_color.find(l.colors[cidx]);
-  if (search != b_color.cend())
-    return search->second;
-  return UINT32_MAX;
-}
-
-uint32_t MeshOptimizer::get_uv_idx(const Loop& l, uint32_t uidx) const {
-  if (use_luvs && uidx == 0 && material_is_lightmapped(materials[faces[l.face].material_index])) {
-    auto search = b_luv.find(l.uvs[0]);
-    if (search != b_luv.cend())
-      return search->second;
-    return UINT32_MAX;
-  }
-  auto search = b_uv.find(l.uvs[uidx]);
-  if (search != b_uv.cend())
-    return search->second;
-  return UINT32_MAX;
-}
-
-bool MeshOptimizer::loops_contiguous(const Loop& la, const Loop& lb) const {
-  if (la.vert != lb.vert)
+bool MeshOptimizer::loops_contiguous(uint32_t la, uint32_t lb) const {
+  if (loops[la].vert != loops[lb].vert)
     return false;
   if (get_norm_idx(la) != get_norm_idx(lb))
     return false;
@@ -142,6 +71,8 @@ bool MeshOptimizer::loops_contiguous(const Loop& la, const Loop& lb) const {
   for (uint32_t i = 0; i < uv_count; ++i)
     if (get_uv_idx(la, i) != get_uv_idx(lb, i))
       return false;
+  if (get_tangent_idx(la) != get_tangent_idx(lb))
+    return false;
   return true;
 }
 
@@ -149,15 +80,15 @@ bool MeshOptimizer::splitable_edge(const Edge& e) const {
   if (!e.is_contiguous)
     return false;
   for (uint32_t vidx : e.verts) {
-    const Loop* found = nullptr;
+    uint32_t found = UINT32_MAX;
     for (uint32_t fidx : e.link_faces) {
       for (uint32_t lidx : faces[fidx].loops) {
         if (loops[lidx].vert == vidx) {
-          if (!found) {
-            found = &loops[lidx];
+          if (found == UINT32_MAX) {
+            found = lidx;
             break;
           } else {
-            if (!loops_contiguous(*found, loops[lidx]))
+            if (!loops_contiguous(found, lidx))
               return true;
             break;
           }
@@ -177,7 +108,7 @@ void MeshOptimizer::sort_faces_by_skin_group(std::vector<uint32_t>& sfaces) cons
     for (uint32_t f : sfaces) {
       bool found = false;
       for (uint32_t l : faces[f].loops) {
-        uint32_t skin_idx = get_skin_idx(verts[loops[l].vert]);
+        uint32_t skin_idx = get_skin_idx(loops[l].vert);
         if (done_sg.find(skin_idx) == done_sg.end()) {
           ref_sg = skin_idx;
           done_sg.insert(skin_idx);
@@ -192,7 +123,7 @@ void MeshOptimizer::sort_faces_by_skin_group(std::vector<uint32_t>& sfaces) cons
       if (std::find(faces_out.begin(), faces_out.end(), f) != faces_out.end())
         continue;
       for (uint32_t l : faces[f].loops) {
-        uint32_t skin_idx = get_skin_idx(verts[loops[l].vert]);
+        uint32_t skin_idx = get_skin_idx(loops[l].vert);
         if (skin_idx == ref_sg) {
           faces_out.push_back(f);
           break;
@@ -235,12 +166,12 @@ Mesh::Surface MeshOptimizer::generate_surface(std::vector<uint32_t>& island_face
   ret.aabbMax.val.simd = athena::simd<float>(-FLT_MAX);
   for (const auto& f : island_faces) {
     for (const auto l : faces[f].loops) {
-      const Vertex& v = verts[loops[l].vert];
+      const Vector3f& co = b_pos.values()[get_pos_idx(loops[l].vert)];
       for (int c = 0; c < 3; ++c) {
-        if (v.co.val.simd[c] < ret.aabbMin.val.simd[c])
-          ret.aabbMin.val.simd[c] = v.co.val.simd[c];
-        if (v.co.val.simd[c] > ret.aabbMax.val.simd[c])
-          ret.aabbMax.val.simd[c] = v.co.val.simd[c];
+        if (co.val.simd[c] < ret.aabbMin.val.simd[c])
+          ret.aabbMin.val.simd[c] = co.val.simd[c];
+        if (co.val.simd[c] > ret.aabbMax.val.simd[c])
+          ret.aabbMax.val.simd[c] = co.val.simd[c];
       }
     }
   }
@@ -299,15 +230,16 @@ Mesh::Surface MeshOptimizer::generate_surface(std::vector<uint32_t>& island_face
       ret.verts.emplace_back();
     for (uint32_t loop : *max_sl) {
       ret.verts.emplace_back();
-      const auto& l = loops[loop];
+      const uint32_t v = loops[loop].vert;
       auto& vert = ret.verts.back();
-      vert.iPos = get_pos_idx(verts[l.vert]);
-      vert.iNorm = get_norm_idx(l);
+      vert.iPos = get_pos_idx(v);
+      vert.iNorm = get_norm_idx(loop);
       for (uint32_t i = 0; i < color_count; ++i)
-        vert.iColor[i] = get_color_idx(l, i);
+        vert.iColor[i] = get_color_idx(loop, i);
       for (uint32_t i = 0; i < uv_count; ++i)
-        vert.iUv[i] = get_uv_idx(l, i);
-      vert.iSkin = get_skin_idx(verts[l.vert]);
+        vert.iUv[i] = get_uv_idx(loop, i);
+      vert.iSkin = get_skin_idx(v);
+      vert.iTangent = get_tangent_idx(loop);
       prev_loop_emit = loop;
     }
   }
@@ -316,16 +248,18 @@ Mesh::Surface MeshOptimizer::generate_surface(std::vector<uint32_t>& island_face
 }
 
 void MeshOptimizer::optimize(Mesh& mesh, int max_skin_banks) const {
+  HECL_TRACE_SCOPE("MeshOptimizer::optimize");
   mesh.topology = HMDLTopology::TriStrips;
 
-  mesh.pos = sort_unordered_map(b_pos);
-  mesh.norm = sort_unordered_map(b_norm);
+  mesh.pos = b_pos.values();
+  mesh.norm = b_norm.values();
   mesh.colorLayerCount = color_count;
-  mesh.color = sort_unordered_map(b_color);
+  mesh.color = b_color.values();
   mesh.uvLayerCount = uv_count;
-  mesh.uv = sort_unordered_map(b_uv);
-  mesh.luv = sort_unordered_map(b_luv);
-  mesh.skins = sort_unordered_map(b_skin);
+  mesh.uv = b_uv.values();
+  mesh.luv = b_luv.values();
+  mesh.tangent = b_tangent.values();
+  mesh.skins = b_skin.values();
 
   /* Sort materials by pass index */
   std::vector<uint32_t> sorted_material_idxs(materials.size());
@@ -333,7 +267,8 @@ void MeshOptimizer::optimize(Mesh& mesh, int max_skin_banks) const {
   std::sort(sorted_material_idxs.begin(), sorted_material_idxs.end(),
   [this](uint32_t a, uint32_t b) { return materials[a].passIndex < materials[b].passIndex; });
 
-  /* Generate island surfaces */
+  /* Partition faces into surfaces serially; strip generation for each one is independent */
+  std::vector<std::pair<uint32_t, std::vector<uint32_t>>> surface_jobs;
   std::vector<uint32_t> mat_faces_rem, the_list;
   mat_faces_rem.reserve(faces.size());
   the_list.reserve(faces.size());
@@ -358,8 +293,7 @@ void MeshOptimizer::optimize(Mesh& mesh, int max_skin_banks) const {
         if (b_skin.size()) {
           bool brk = false;
           for (const auto l : faces[f].loops) {
-            const Vertex& v = verts[loops[l].vert];
-            uint32_t skin_idx = get_skin_idx(v);
+            uint32_t skin_idx = get_skin_idx(loops[l].vert);
             if (skin_slot_set.find(skin_idx) == skin_slot_set.end()) {
               if (max_skin_banks > 0 && skin_slot_set.size() == size_t(max_skin_banks)) {
                 brk = true;
@@ -375,13 +309,50 @@ void MeshOptimizer::optimize(Mesh& mesh, int max_skin_banks) const {
         f = UINT32_MAX;
         --rem_count;
       }
-      mesh.surfaces.push_back(generate_surface(the_list, mat_idx));
+      surface_jobs.emplace_back(mat_idx, the_list);
     }
   }
+
+  /* Fan out surface generation; results land in job order so output is deterministic */
+  std::vector<Mesh::Surface> surfaces(surface_jobs.size());
+  DistributeJobs(surface_jobs.size(), faces.size(), [&](size_t j) {
+    surfaces[j] = generate_surface(surface_jobs[j].second, surface_jobs[j].first);
+  });
+
+  mesh.surfaces.reserve(mesh.surfaces.size() + surfaces.size());
+  std::move(surfaces.begin(), surfaces.end(), std::back_inserter(mesh.surfaces));
 }
 
-MeshOptimizer::MeshOptimizer(Connection& conn, const std::vector<Material>& materials, bool use_luvs)
-: materials(materials), use_luvs(use_luvs) {
+void MeshOptimizer::reserve_vert_attrs(uint32_t vert_count) {
+  vert_pos.reserve(vert_count);
+  vert_skin.reserve(vert_count);
+  b_pos.reserve(vert_count);
+  b_skin.reserve(vert_count);
+}
+
+void MeshOptimizer::reserve_loop_attrs(uint32_t loop_count) {
+  loops.reserve(loop_count);
+  loop_norm.reserve(loop_count);
+  loop_color.reserve(size_t(loop_count) * color_count);
+  loop_uv.reserve(size_t(loop_count) * uv_count);
+  b_norm.reserve(loop_count);
+  b_color.reserve(size_t(loop_count) * color_count);
+  if (use_luvs) {
+    b_uv.reserve(size_t(loop_count) * std::max(int(uv_count) - 1, 0));
+    b_luv.reserve(loop_count);
+  } else {
+    b_uv.reserve(size_t(loop_count) * uv_count);
+  }
+}
+
+void MeshOptimizer::add_vert(const Vector3f& co, const SkinEntries& skin_ents) {
+  vert_pos.push_back(b_pos.insert(co));
+  vert_skin.push_back(skin_ents[0].valid() ? b_skin.insert(skin_ents) : UINT32_MAX);
+}
+
+MeshOptimizer::MeshOptimizer(Connection& conn, const std::vector<Material>& materials, bool use_luvs,
+                             bool gen_tangents)
+: materials(materials), use_luvs(use_luvs), gen_tangents(gen_tangents) {
   conn._readValue(color_count);
   if (color_count > MaxColorLayers)
     Log.report(logvisor::Fatal, FMT_STRING("Color layer overflow {}/{}"), color_count, MaxColorLayers);
@@ -389,48 +360,396 @@ MeshOptimizer::MeshOptimizer(Connection& conn, const std::vector<Material>& mate
   if (uv_count > MaxUVLayers)
     Log.report(logvisor::Fatal, FMT_STRING("UV layer overflow {}/{}"), uv_count, MaxUVLayers);
 
-  /* Simultaneously load topology objects and build unique mapping indices */
-
   uint32_t vert_count;
   conn._readValue(vert_count);
-  verts.reserve(vert_count);
-  b_pos.reserve(vert_count);
-  b_skin.reserve(vert_count * 4);
+  reserve_vert_attrs(vert_count);
   for (uint32_t i = 0; i < vert_count; ++i) {
-    verts.emplace_back(conn);
-    insert_unique_attr(b_pos, verts.back().co);
-    if (verts.back().skin_ents[0].valid())
-      insert_unique_attr(b_skin, verts.back().skin_ents);
+    Vector3f co(conn);
+    uint32_t skin_count;
+    conn._readValue(skin_count);
+    if (skin_count > MaxSkinEntries)
+      Log.report(logvisor::Fatal, FMT_STRING("Skin entry overflow {}/{}"), skin_count, MaxSkinEntries);
+    SkinEntries skin_ents = {};
+    for (uint32_t j = 0; j < skin_count; ++j)
+      skin_ents[j] = Mesh::SkinBind(conn);
+    add_vert(co, skin_ents);
   }
 
+  /* Normals and colors dedup immediately; UVs wait for faces to resolve lightmap materials */
   uint32_t loop_count;
   conn._readValue(loop_count);
-  loops.reserve(loop_count);
-  b_norm.reserve(loop_count);
-  if (use_luvs) {
-    b_uv.reserve(std::max(int(loop_count) - 1, 0) * uv_count);
-    b_luv.reserve(loop_count);
-  } else {
-    b_uv.reserve(loop_count * uv_count);
-  }
+  reserve_loop_attrs(loop_count);
+  std::vector<Vector2f> loop_uvs;
+  loop_uvs.reserve(size_t(loop_count) * uv_count);
   for (uint32_t i = 0; i < loop_count; ++i) {
-    loops.emplace_back(conn, color_count, uv_count);
-    insert_unique_attr(b_norm, loops.back().normal);
-    for (const auto& c : loops.back().colors)
-      insert_unique_attr(b_color, c);
-    if (use_luvs && material_is_lightmapped(materials[faces[loops.back().face].material_index])) {
-      insert_unique_attr(b_luv, loops.back().uvs[0]);
-      for (auto I = std::begin(loops.back().uvs) + 1, E = std::end(loops.back().uvs); I != E; ++I)
-        insert_unique_attr(b_uv, *I);
-    } else {
-      for (const auto& c : loops.back().uvs)
-        insert_unique_attr(b_uv, c);
-    }
+    loop_norm.push_back(b_norm.insert(Vector3f(conn)));
+    for (uint32_t c = 0; c < color_count; ++c)
+      loop_color.push_back(b_color.insert(Vector3f(conn)));
+    for (uint32_t u = 0; u < uv_count; ++u)
+      loop_uvs.emplace_back(conn);
+    loops.emplace_back(conn);
   }
 
   conn._readVector(edges);
   conn._readVector(faces);
 
+  finish_load(loop_uvs);
+}
+
+namespace {
+/* Unaligned view of one packed array within the mesh attribute block */
+template <typename T>
+struct AttrArray {
+  const uint8_t* data = nullptr;
+  T operator[](size_t idx) const {
+    T ret;
+    std::memcpy(&ret, data + idx * sizeof(T), sizeof(T));
+    return ret;
+  }
+  void copy(size_t idx, void* out, size_t count) const { std::memcpy(out, data + idx * sizeof(T), count * sizeof(T)); }
+};
+
+class AttrBlockReader {
+  const uint8_t* m_cur;
+  const uint8_t* m_end;
+
+public:
+  AttrBlockReader(const uint8_t* data, size_t size) : m_cur(data), m_end(data + size) {}
+  template <typename T>
+  AttrArray<T> take(size_t count) {
+    const size_t len = count * sizeof(T);
+    if (size_t(m_end - m_cur) < len)
+      Log.report(logvisor::Fatal, FMT_STRING("Mesh attribute block truncated"));
+    AttrArray<T> ret{m_cur};
+    m_cur += len;
+    return ret;
+  }
+};
+} // anonymous namespace
+
+MeshOptimizer::MeshOptimizer(const uint8_t* attr_data, size_t attr_size, const std::vector<Material>& materials,
+                             bool use_luvs, bool gen_tangents)
+: materials(materials), use_luvs(use_luvs), gen_tangents(gen_tangents) {
+  AttrBlockReader r(attr_data, attr_size);
+  const auto header = r.take<uint32_t>(9);
+  if (std::memcmp(attr_data, "HSOA", 4))
+    Log.report(logvisor::Fatal, FMT_STRING("Invalid mesh attribute block"));
+  color_count = header[1];
+  if (color_count > MaxColorLayers)
+    Log.report(logvisor::Fatal, FMT_STRING("Color layer overflow {}/{}"), color_count, MaxColorLayers);
+  uv_count = header[2];
+  if (uv_count > MaxUVLayers)
+    Log.report(logvisor::Fatal, FMT_STRING("UV layer overflow {}/{}"), uv_count, MaxUVLayers);
+  const uint32_t vert_count = header[3];
+  const uint32_t skin_count = header[4];
+  const uint32_t loop_count = header[5];
+  const uint32_t edge_count = header[6];
+  const uint32_t edge_face_count = header[7];
+  const uint32_t face_count = header[8];
+
+  const auto vert_co = r.take<float>(size_t(vert_count) * 3);
+  const auto vert_skin_counts = r.take<uint32_t>(vert_count);
+  const auto skin_groups = r.take<uint32_t>(skin_count);
+  const auto skin_weights = r.take<float>(skin_count);
+  reserve_vert_attrs(vert_count);
+  for (uint32_t i = 0, s = 0; i < vert_count; ++i) {
+    Vector3f co = {};
+    vert_co.copy(size_t(i) * 3, &co.val, 3);
+    SkinEntries skin_ents = {};
+    const uint32_t vert_skin_count = vert_skin_counts[i];
+    if (vert_skin_count > MaxSkinEntries)
+      Log.report(logvisor::Fatal, FMT_STRING("Skin entry overflow {}/{}"), vert_skin_count, MaxSkinEntries);
+    if (s + vert_skin_count > skin_count)
+      Log.report(logvisor::Fatal, FMT_STRING("Mesh attribute block truncated"));
+    for (uint32_t j = 0; j < vert_skin_count; ++j, ++s) {
+      skin_ents[j].vg_idx = skin_groups[s];
+      skin_ents[j].weight = skin_weights[s];
+    }
+    add_vert(co, skin_ents);
+  }
+
+  const auto loop_normals = r.take<float>(size_t(loop_count) * 3);
+  std::array<AttrArray<float>, MaxColorLayers> loop_colors;
+  for (uint32_t c = 0; c < color_count; ++c)
+    loop_colors[c] = r.take<float>(size_t(loop_count) * 3);
+  std::array<AttrArray<float>, MaxUVLayers> loop_uvs;
+  for (uint32_t u = 0; u < uv_count; ++u)
+    loop_uvs[u] = r.take<float>(size_t(loop_count) * 2);
+  const auto loop_links = r.take<uint32_t>(size_t(loop_count) * 7);
+  reserve_loop_attrs(loop_count);
+  loops.resize(loop_count);
+  std::vector<Vector2f> staged_uvs(size_t(loop_count) * uv_count);
+  for (uint32_t i = 0; i < loop_count; ++i) {
+    Vector3f attr = {};
+    loop_normals.copy(size_t(i) * 3, &attr.val, 3);
+    loop_norm.push_back(b_norm.insert(attr));
+    for (uint32_t c = 0; c < color_count; ++c) {
+      loop_colors[c].copy(size_t(i) * 3, &attr.val, 3);
+      loop_color.push_back(b_color.insert(attr));
+    }
+    for (uint32_t u = 0; u < uv_count; ++u)
+      loop_uvs[u].copy(size_t(i) * 2, &staged_uvs[size_t(i) * uv_count + u].val, 2);
+    Loop& l = loops[i];
+    const size_t link = size_t(i) * 7;
+    l.vert = loop_links[link];
+    l.edge = loop_links[link + 1];
+    l.face = loop_links[link + 2];
+    l.link_loop_next = loop_links[link + 3];
+    l.link_loop_prev = loop_links[link + 4];
+    l.link_loop_radial_next = loop_links[link + 5];
+    l.link_loop_radial_prev = loop_links[link + 6];
+  }
+
+  const auto edge_verts = r.take<uint32_t>(size_t(edge_count) * 2);
+  const auto edge_face_counts = r.take<uint32_t>(edge_count);
+  const auto edge_faces = r.take<uint32_t>(edge_face_count);
+  const auto edge_contiguous = r.take<uint32_t>(edge_count);
+  edges.resize(edge_count);
+  for (uint32_t i = 0, f = 0; i < edge_count; ++i) {
+    Edge& e = edges[i];
+    e.verts[0] = edge_verts[size_t(i) * 2];
+    e.verts[1] = edge_verts[size_t(i) * 2 + 1];
+    const uint32_t link_face_count = edge_face_counts[i];
+    if (link_face_count > Edge::MaxLinkFaces)
+      Log.report(logvisor::Fatal, FMT_STRING("Face overflow {}/{}"), link_face_count, Edge::MaxLinkFaces);
+    if (f + link_face_count > edge_face_count)
+      Log.report(logvisor::Fatal, FMT_STRING("Mesh attribute block truncated"));
+    for (uint32_t j = 0; j < link_face_count; ++j, ++f)
+      e.link_faces[j] = edge_faces[f];
+    e.is_contiguous = edge_contiguous[i] != 0;
+  }
+
+  const auto face_normals = r.take<float>(size_t(face_count) * 3);
+  const auto face_centroids = r.take<float>(size_t(face_count) * 3);
+  const auto face_materials = r.take<uint32_t>(face_count);
+  const auto face_loops = r.take<uint32_t>(size_t(face_count) * 3);
+  faces.resize(face_count);
+  for (uint32_t i = 0; i < face_count; ++i) {
+    Face& f = faces[i];
+    face_normals.copy(size_t(i) * 3, &f.normal.val, 3);
+    face_centroids.copy(size_t(i) * 3, &f.centroid.val, 3);
+    f.material_index = face_materials[i];
+    for (uint32_t j = 0; j < 3; ++j)
+      f.loops[j] = face_loops[size_t(i) * 3 + j];
+  }
+
+  finish_load(staged_uvs);
+}
+
+namespace {
+struct TVec3 {
+  float x = 0.f, y = 0.f, z = 0.f;
+  TVec3() = default;
+  TVec3(float x, float y, float z) : x(x), y(y), z(z) {}
+  explicit TVec3(const Vector3f& v) {
+    const athena::simd_floats f(v.val.simd);
+    x = f[0];
+    y = f[1];
+    z = f[2];
+  }
+  TVec3 operator+(const TVec3& o) const { return {x + o.x, y + o.y, z + o.z}; }
+  TVec3 operator-(const TVec3& o) const { return {x - o.x, y - o.y, z - o.z}; }
+  TVec3 operator*(float s) const { return {x * s, y * s, z * s}; }
+  TVec3& operator+=(const TVec3& o) { return *this = *this + o; }
+  float dot(const TVec3& o) const { return x * o.x + y * o.y + z * o.z; }
+  TVec3 cross(const TVec3& o) const { return {y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x}; }
+  float length() const { return std::sqrt(dot(*this)); }
+  /* Returns false and leaves the vector untouched when it is too short to normalize */
+  bool normalize() {
+    const float len = length();
+    if (!(len > 1e-20f))
+      return false;
+    *this = *this * (1.f / len);
+    return true;
+  }
+  TVec3 project_off(const TVec3& n) const { return *this - n * n.dot(*this); }
+};
+
+/* Corners sharing position, normal, tangent-space UV and handedness share one tangent */
+struct TangentGroupKey {
+  uint32_t pos;
+  uint32_t norm;
+  uint32_t u;
+  uint32_t v;
+  uint32_t flipped;
+  bool operator==(const TangentGroupKey& o) const {
+    return pos == o.pos && norm == o.norm && u == o.u && v == o.v && flipped == o.flipped;
+  }
+};
+struct TangentGroupKeyHash {
+  size_t operator()(const TangentGroupKey& k) const { return hash_words<5>({k.pos, k.norm, k.u, k.v, k.flipped}); }
+};
+
+struct TangentAccum {
+  TVec3 normal;
+  TVec3 tangent;
+  TVec3 bitangent;
+  bool flipped = false;
+};
+
+/* Any unit vector perpendicular to n, for groups whose UVs carry no direction */
+TVec3 PerpendicularTo(const TVec3& n) {
+  const TVec3 axis = std::fabs(n.x) < 0.9f ? TVec3{1.f, 0.f, 0.f} : TVec3{0.f, 1.f, 0.f};
+  TVec3 t = axis.project_off(n);
+  if (!t.normalize())
+    return {1.f, 0.f, 0.f};
+  return t;
+}
+
+float CornerAngle(const TVec3& p, const TVec3& prev, const TVec3& next) {
+  TVec3 a = prev - p;
+  TVec3 b = next - p;
+  if (!a.normalize() || !b.normalize())
+    return 0.f;
+  return std::acos(std::clamp(a.dot(b), -1.f, 1.f));
+}
+} // anonymous namespace
+
+/* MikkTSpace-style per-corner tangent frames: face tangents are projected into each corner's normal plane,
+ * angle-weighted and summed across corners that share position, normal, UV and handedness, so mirrored UV
+ * islands never average into each other. Materials are independent jobs and run in parallel. */
+void MeshOptimizer::generate_tangents(const std::vector<Vector2f>& loop_uvs) {
+  HECL_TRACE_SCOPE("MeshOptimizer::generate_tangents");
+
+  std::vector<std::vector<uint32_t>> material_faces(materials.size());
+  for (uint32_t f = 0; f < faces.size(); ++f)
+    if (faces[f].material_index < materials.size())
+      material_faces[faces[f].material_index].push_back(f);
+
+  struct Job {
+    std::vector<TangentAccum> groups;
+    std::vector<uint32_t> loop_group;
+  };
+  std::vector<Job> jobs(material_faces.size());
+
+  const auto run_job = [&](size_t mat_idx) {
+    const std::vector<uint32_t>& job_faces = material_faces[mat_idx];
+    Job& job = jobs[mat_idx];
+    if (job_faces.empty())
+      return;
+    /* Lightmap coordinates are a poor tangent basis; use the first texture layer where one exists */
+    const uint32_t uv_layer = use_luvs && uv_count > 1 && materials[mat_idx].lightmapped() ? 1 : 0;
+    const auto loop_uv_at = [&](uint32_t loop) -> std::pair<float, float> {
+      const athena::simd_floats f(loop_uvs[size_t(loop) * uv_count + uv_layer].val.simd);
+      return {f[0], f[1]};
+    };
+
+    std::unordered_map<TangentGroupKey, uint32_t, TangentGroupKeyHash> group_map;
+    group_map.reserve(job_faces.size() * 3);
+    job.groups.reserve(job_faces.size() * 3);
+    job.loop_group.reserve(job_faces.size() * 3);
+
+    for (uint32_t f : job_faces) {
+      const Face& face = faces[f];
+      TVec3 p[3];
+      std::pair<float, float> uv[3];
+      for (uint32_t c = 0; c < 3; ++c) {
+        p[c] = TVec3(b_pos.values()[get_pos_idx(loops[face.loops[c]].vert)]);
+        uv[c] = loop_uv_at(face.loops[c]);
+      }
+      const TVec3 e1 = p[1] - p[0];
+      const TVec3 e2 = p[2] - p[0];
+      const float du1 = uv[1].first - uv[0].first, dv1 = uv[1].second - uv[0].second;
+      const float du2 = uv[2].first - uv[0].first, dv2 = uv[2].second - uv[0].second;
+      const float det = du1 * dv2 - du2 * dv1;
+      const bool flipped = det < 0.f;
+      const float sign = flipped ? -1.f : 1.f;
+      TVec3 face_t = (e1 * dv2 - e2 * dv1) * sign;
+      TVec3 face_b = (e2 * du1 - e1 * du2) * sign;
+      const bool has_t = face_t.normalize();
+      const bool has_b = face_b.normalize();
+
+      for (uint32_t c = 0; c < 3; ++c) {
+        const uint32_t loop = face.loops[c];
+        const uint32_t norm_idx = get_norm_idx(loop);
+        const TangentGroupKey key{get_pos_idx(loops[loop].vert), norm_idx, float_bits(uv[c].first),
+                                  float_bits(uv[c].second), uint32_t(flipped)};
+        auto [it, inserted] = group_map.try_emplace(key, uint32_t(job.groups.size()));
+        if (inserted) {
+          TangentAccum& accum = job.groups.emplace_back();
+          accum.normal = TVec3(b_norm.values()[norm_idx]);
+          accum.normal.normalize();
+          accum.flipped = flipped;
+        }
+        job.loop_group.push_back(it->second);
+
+        TangentAccum& accum = job.groups[it->second];
+        const float weight = CornerAngle(p[c], p[(c + 2) % 3], p[(c + 1) % 3]);
+        if (has_t) {
+          TVec3 t = face_t.project_off(accum.normal);
+          if (t.normalize())
+            accum.tangent += t * weight;
+        }
+        if (has_b) {
+          TVec3 b = face_b.project_off(accum.normal);
+          if (b.normalize())
+            accum.bitangent += b * weight;
+        }
+      }
+    }
+  };
+
+  DistributeJobs(jobs.size(), faces.size(), run_job);
+
+  /* Resolve frames and intern them serially in material order so indices are deterministic */
+  b_tangent.reserve(loops.size());
+  loop_tangent.assign(loops.size(), UINT32_MAX);
+  std::vector<uint32_t> group_tangent;
+  for (size_t mat_idx = 0; mat_idx < jobs.size(); ++mat_idx) {
+    const Job& job = jobs[mat_idx];
+    group_tangent.resize(job.groups.size());
+    for (size_t g = 0; g < job.groups.size(); ++g) {
+      const TangentAccum& accum = job.groups[g];
+      TVec3 t = accum.tangent.project_off(accum.normal);
+      if (!t.normalize())
+        t = PerpendicularTo(accum.normal);
+      float w = accum.flipped ? -1.f : 1.f;
+      if (accum.bitangent.length() > 1e-20f)
+        w = accum.normal.cross(t).dot(accum.bitangent) < 0.f ? -1.f : 1.f;
+      Vector4f tangent;
+      tangent.val.simd[0] = t.x;
+      tangent.val.simd[1] = t.y;
+      tangent.val.simd[2] = t.z;
+      tangent.val.simd[3] = w;
+      group_tangent[g] = b_tangent.insert(tangent);
+    }
+    size_t corner = 0;
+    for (uint32_t f : material_faces[mat_idx])
+      for (uint32_t l : faces[f].loops)
+        loop_tangent[l] = group_tangent[job.loop_group[corner++]];
+  }
+
+  /* Faces with an out-of-range material belong to no job; give them a valid frame so every index resolves */
+  uint32_t fallback = UINT32_MAX;
+  for (uint32_t& t : loop_tangent) {
+    if (t != UINT32_MAX)
+      continue;
+    if (fallback == UINT32_MAX) {
+      Vector4f tangent;
+      tangent.val.simd[0] = 1.f;
+      tangent.val.simd[1] = 0.f;
+      tangent.val.simd[2] = 0.f;
+      tangent.val.simd[3] = 1.f;
+      fallback = b_tangent.insert(tangent);
+    }
+    t = fallback;
+  }
+}
+
+void MeshOptimizer::finish_load(const std::vector<Vector2f>& loop_uvs) {
+  /* Lightmapped faces route their first UV layer to the separate lightmap table */
+  for (size_t i = 0; i < loops.size(); ++i) {
+    const Vector2f* uvs = loop_uvs.data() + i * uv_count;
+    uint32_t u = 0;
+    if (use_luvs && uv_count && materials[faces[loops[i].face].material_index].lightmapped())
+      loop_uv.push_back(b_luv.insert(uvs[u++]));
+    for (; u < uv_count; ++u)
+      loop_uv.push_back(b_uv.insert(uvs[u]));
+  }
+
+  if (gen_tangents && uv_count)
+    generate_tangents(loop_uvs);
+
   /* Cache edges that should block tristrip traversal */
   for (auto& e : edges)
     e.tag = splitable_edge(e);
@@ -4,7 +4,7 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
-#include <unordered_map>
+#include <cstring>
 #include <utility>
 #include <vector>
 
@@ -38,28 +38,113 @@ public:
   size_t size() const { return end() - begin(); }
 };
 
+/* Fold -0.f into +0.f so bitwise hashing agrees with operator== */
+inline uint32_t float_bits(float f) {
+  f += 0.f;
+  uint32_t bits;
+  std::memcpy(&bits, &f, sizeof(bits));
+  return bits;
+}
+
+/* Lanes are mixed independently and summed, leaving no serial dependency for the vectorizer */
+template <size_t N>
+inline uint64_t hash_words(const std::array<uint32_t, N>& words) {
+  uint64_t h = 0;
+  for (size_t i = 0; i < N; ++i)
+    h += (uint64_t(words[i]) ^ (uint64_t(i) * 0x9E3779B97F4A7C15ull)) * 0xFF51AFD7ED558CCDull;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ull;
+  h ^= h >> 33;
+  return h;
+}
+
+inline uint64_t attr_hash(const Vector2f& v) {
+  const athena::simd_floats f(v.val.simd);
+  return hash_words<2>({float_bits(f[0]), float_bits(f[1])});
+}
+
+inline uint64_t attr_hash(const Vector3f& v) {
+  const athena::simd_floats f(v.val.simd);
+  return hash_words<3>({float_bits(f[0]), float_bits(f[1]), float_bits(f[2])});
+}
+
+inline uint64_t attr_hash(const Vector4f& v) {
+  const athena::simd_floats f(v.val.simd);
+  return hash_words<4>({float_bits(f[0]), float_bits(f[1]), float_bits(f[2]), float_bits(f[3])});
+}
+
+template <size_t S>
+inline uint64_t attr_hash(const std::array<Mesh::SkinBind, S>& skin) {
+  std::array<uint32_t, S * 2> words;
+  for (size_t i = 0; i < S; ++i) {
+    words[i * 2] = skin[i].vg_idx;
+    words[i * 2 + 1] = float_bits(skin[i].weight);
+  }
+  return hash_words(words);
+}
+
+/* Open-addressing deduplication table; unique values are indexed in insertion order */
+template <typename T>
+class AttrTable {
+  std::vector<T> m_values;
+  std::vector<uint32_t> m_slots;
+  size_t m_mask = 0;
+
+  void _rehash(size_t slot_count) {
+    m_slots.assign(slot_count, UINT32_MAX);
+    m_mask = slot_count - 1;
+    for (uint32_t i = 0; i < m_values.size(); ++i) {
+      size_t slot = attr_hash(m_values[i]) & m_mask;
+      while (m_slots[slot] != UINT32_MAX)
+        slot = (slot + 1) & m_mask;
+      m_slots[slot] = i;
+    }
+  }
+
+public:
+  void reserve(size_t count) {
+    m_values.reserve(count);
+    size_t slot_count = 16;
+    while (slot_count < count * 2)
+      slot_count <<= 1;
+    if (slot_count > m_slots.size())
+      _rehash(slot_count);
+  }
+
+  uint32_t insert(const T& val) {
+    if ((m_values.size() + 1) * 2 > m_slots.size())
+      _rehash(std::max(m_slots.size() * 2, size_t(16)));
+    size_t slot = attr_hash(val) & m_mask;
+    while (m_slots[slot] != UINT32_MAX) {
+      if (m_values[m_slots[slot]] == val)
+        return m_slots[slot];
+      slot = (slot + 1) & m_mask;
+    }
+    const auto idx = uint32_t(m_values.size());
+    m_slots[slot] = idx;
+    m_values.push_back(val);
+    return idx;
+  }
+
+  const std::vector<T>& values() const { return m_values; }
+  size_t size() const { return m_values.size(); }
+};
+
 class MeshOptimizer {
   static constexpr size_t MaxColorLayers = Mesh::MaxColorLayers;
   static constexpr size_t MaxUVLayers = Mesh::MaxUVLayers;
   static constexpr size_t MaxSkinEntries = Mesh::MaxSkinEntries;
+  using SkinEntries = std::array<Mesh::SkinBind, MaxSkinEntries>;
 
   const std::vector<Material>& materials;
   bool use_luvs;
+  bool gen_tangents;
 
   uint32_t color_count;
   uint32_t uv_count;
 
-  struct Vertex {
-    Vector3f co = {};
-    std::array<Mesh::SkinBind, MaxSkinEntries> skin_ents = {};
-    explicit Vertex(Connection& conn);
-  };
-  std::vector<Vertex> verts;
-
+  /* Loop topology only; attributes are stored in the index arrays below */
   struct Loop {
-    Vector3f normal = {};
-    std::array<Vector3f, MaxColorLayers> colors = {};
-    std::array<Vector2f, MaxUVLayers> uvs = {};
     uint32_t vert = UINT32_MAX;
     uint32_t edge = UINT32_MAX;
     uint32_t face = UINT32_MAX;
@@ -67,7 +152,8 @@ class MeshOptimizer {
     uint32_t link_loop_prev = UINT32_MAX;
     uint32_t link_loop_radial_next = UINT32_MAX;
     uint32_t link_loop_radial_prev = UINT32_MAX;
-    explicit Loop(Connection& conn, uint32_t color_count, uint32_t uv_count);
+    Loop() = default;
+    explicit Loop(Connection& conn);
   };
   std::vector<Loop> loops;
 
@@ -77,6 +163,7 @@ class MeshOptimizer {
     IndexArray<MaxLinkFaces> link_faces;
     bool is_contiguous = false;
     bool tag = false;
+    Edge() = default;
     explicit Edge(Connection& conn);
   };
   std::vector<Edge> edges;
@@ -86,31 +173,52 @@ class MeshOptimizer {
     Vector3f centroid = {};
     uint32_t material_index = UINT32_MAX;
     IndexArray<3> loops;
+    Face() = default;
     explicit Face(Connection& conn);
   };
   std::vector<Face> faces;
 
-  std::unordered_map<Vector3f, uint32_t> b_pos;
-  std::unordered_map<Vector3f, uint32_t> b_norm;
-  std::unordered_map<std::array<Mesh::SkinBind, MaxSkinEntries>, uint32_t> b_skin;
-  std::unordered_map<Vector3f, uint32_t> b_color;
-  std::unordered_map<Vector2f, uint32_t> b_uv;
-  std::unordered_map<Vector2f, uint32_t> b_luv;
-
-  uint32_t get_pos_idx(const Vertex& v) const;
-  uint32_t get_norm_idx(const Loop& l) const;
-  uint32_t get_skin_idx(const Vertex& v) const;
-  uint32_t get_color_idx(const Loop& l, uint32_t cidx) const;
-  uint32_t get_uv_idx(const Loop& l, uint32_t uidx) const;
+  AttrTable<Vector3f> b_pos;
+  AttrTable<Vector3f> b_norm;
+  AttrTable<SkinEntries> b_skin;
+  AttrTable<Vector3f> b_color;
+  AttrTable<Vector2f> b_uv;
+  AttrTable<Vector2f> b_luv;
+  AttrTable<Vector4f> b_tangent;
+
+  /* Structure-of-arrays attribute indices; layered arrays hold exactly color_count or uv_count
+   * entries per loop */
+  std::vector<uint32_t> vert_pos;
+  std::vector<uint32_t> vert_skin;
+  std::vector<uint32_t> loop_norm;
+  std::vector<uint32_t> loop_color;
+  std::vector<uint32_t> loop_uv;
+  std::vector<uint32_t> loop_tangent;
+
+  uint32_t get_pos_idx(uint32_t vert) const { return vert_pos[vert]; }
+  uint32_t get_skin_idx(uint32_t vert) const { return vert_skin[vert]; }
+  uint32_t get_norm_idx(uint32_t loop) const { return loop_norm[loop]; }
+  uint32_t get_color_idx(uint32_t loop, uint32_t cidx) const { return loop_color[loop * color_count + cidx]; }
+  uint32_t get_uv_idx(uint32_t loop, uint32_t uidx) const { return loop_uv[loop * uv_count + uidx]; }
+  uint32_t get_tangent_idx(uint32_t loop) const { return loop_tangent.empty() ? UINT32_MAX : loop_tangent[loop]; }
   void sort_faces_by_skin_group(std::vector<uint32_t>& faces) const;
   std::pair<uint32_t, uint32_t> strip_next_loop(uint32_t prev_loop, uint32_t out_count) const;
 
-  bool loops_contiguous(const Loop& la, const Loop& lb) const;
+  bool loops_contiguous(uint32_t la, uint32_t lb) const;
   bool splitable_edge(const Edge& e) const;
   Mesh::Surface generate_surface(std::vector<uint32_t>& island_faces, uint32_t mat_idx) const;
+  void reserve_vert_attrs(uint32_t vert_count);
+  void reserve_loop_attrs(uint32_t loop_count);
+  void add_vert(const Vector3f& co, const SkinEntries& skin_ents);
+  void generate_tangents(const std::vector<Vector2f>& loop_uvs);
+  void finish_load(const std::vector<Vector2f>& loop_uvs);
 
 public:
-  explicit MeshOptimizer(Connection& conn, const std::vector<Material>& materials, bool use_luvs);
+  explicit MeshOptimizer(Connection& conn, const std::vector<Material>& materials, bool use_luvs,
+                         bool gen_tangents = false);
+  /* Load from the structure-of-arrays block written by HMDLMesh.write_mesh_attrs_soa */
+  explicit MeshOptimizer(const uint8_t* attr_data, size_t attr_size, const std::vector<Material>& materials,
+                         bool use_luvs, bool gen_tangents = false);
   void optimize(Mesh& mesh, int max_skin_banks) const;
 };
 
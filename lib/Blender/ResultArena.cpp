@@ -0,0 +1,42 @@
+#include "hecl/Blender/ResultArena.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+namespace hecl::blender {
+
+static thread_local ResultArena* CurrentArena = nullptr;
+
+ResultArena::ResultArena() : m_prev(CurrentArena) { CurrentArena = this; }
+
+ResultArena::~ResultArena() {
+  CurrentArena = m_prev;
+  for (Block* block = m_blocks; block;) {
+    Block* next = block->m_next;
+    std::free(block);
+    block = next;
+  }
+}
+
+ResultArena* ResultArena::Current() { return CurrentArena; }
+
+void* ResultArena::allocate(size_t size, size_t align) {
+  uintptr_t cur = (uintptr_t(m_cur) + align - 1) & ~uintptr_t(align - 1);
+  if (!m_cur || cur + size > uintptr_t(m_end)) {
+    /* Requests larger than a block get a block sized to fit */
+    const size_t blockSize = std::max(BlockSize, sizeof(Block) + size + align);
+    auto* block = static_cast<Block*>(std::malloc(blockSize));
+    if (!block)
+      throw std::bad_alloc();
+    block->m_next = m_blocks;
+    m_blocks = block;
+    m_cur = reinterpret_cast<uint8_t*>(block + 1);
+    m_end = reinterpret_cast<uint8_t*>(block) + blockSize;
+    cur = (uintptr_t(m_cur) + align - 1) & ~uintptr_t(align - 1);
+  }
+  m_cur = reinterpret_cast<uint8_t*>(cur + size);
+  return reinterpret_cast<void*>(cur);
+}
+
+} // namespace hecl::blender
@@ -1,7 +1,11 @@
 #include "hecl/Blender/SDNARead.hpp"
 
+#include <algorithm>
 #include <cstring>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 
 #include "hecl/hecl.hpp"
 
@@ -54,73 +58,124 @@ const SDNABlock::SDNAStruct* SDNABlock::lookupStruct(const char* n, atUint32& id
   return nullptr;
 }
 
+namespace {
+/* Inflate arenas kept between SDNARead instances; area blends inflate to hundreds of MB,
+ * so only a couple are held while idle */
+class ArenaPool {
+  static constexpr size_t MaxIdleArenas = 2;
+  std::mutex m_mutex;
+  std::vector<std::vector<uint8_t>> m_idle;
+
+public:
+  std::vector<uint8_t> take(size_t size) {
+    std::vector<uint8_t> ret;
+    {
+      std::lock_guard lk{m_mutex};
+      /* Prefer the smallest arena that already fits; otherwise grow the largest */
+      auto best = m_idle.end();
+      for (auto it = m_idle.begin(); it != m_idle.end(); ++it) {
+        const bool fits = it->size() >= size;
+        if (best == m_idle.end() || (fits && (best->size() < size || it->size() < best->size())) ||
+            (!fits && best->size() < size && it->size() > best->size()))
+          best = it;
+      }
+      if (best != m_idle.end()) {
+        ret = std::move(*best);
+        m_idle.erase(best);
+      }
+    }
+    if (ret.size() < size)
+      ret.resize(size);
+    return ret;
+  }
+
+  void give(std::vector<uint8_t>&& arena) {
+    std::lock_guard lk{m_mutex};
+    if (m_idle.size() < MaxIdleArenas) {
+      m_idle.push_back(std::move(arena));
+      return;
+    }
+    auto smallest = std::min_element(m_idle.begin(), m_idle.end(),
+                                     [](const auto& a, const auto& b) { return a.size() < b.size(); });
+    if (smallest->size() < arena.size())
+      *smallest = std::move(arena);
+  }
+};
+
+ArenaPool& Arenas() {
+  static ArenaPool pool;
+  return pool;
+}
+} // anonymous namespace
+
 void SDNARead::enumerate(const std::function<bool(const FileBlock& block, athena::io::MemoryReader& r)>& func) const {
-  athena::io::MemoryReader r(m_data.data(), m_data.size());
+  athena::io::MemoryReader r(m_data, m_size);
   r.seek(12);
   while (r.position() < r.length()) {
     FileBlock block;
     block.read(r);
     if (block.type == FOURCC('ENDB'))
       break;
-    athena::io::MemoryReader r2(m_data.data() + r.position(), block.size);
+    athena::io::MemoryReader r2(m_data + r.position(), block.size);
     if (!func(block, r2))
       break;
     r.seek(block.size);
   }
 }
 
-SDNARead::SDNARead(SystemStringView path) {
-  athena::io::FileReader r(path);
-  if (r.hasError())
-    return;
+bool SDNARead::_inflate(const uint8_t* comp, size_t compSize) {
+  /* ISIZE trailer holds the inflated size modulo 2^32; grow by doubling if that proves short */
+  size_t outSize = compSize * 2;
+  if (compSize >= 18) {
+    atUint32 isize;
+    std::memcpy(&isize, comp + compSize - 4, 4);
+    outSize = std::max(size_t(SLittle(isize)), size_t(12));
+  }
+  m_arena = Arenas().take(outSize);
 
-  atUint64 length = r.length();
-  char magicBuf[7];
-  r.readUBytesToBuf(magicBuf, 7);
-  r.seek(0, athena::SeekOrigin::Begin);
-  if (strncmp(magicBuf, "BLENDER", 7)) {
-    /* Try gzip decompression */
-    std::unique_ptr<uint8_t[]> compBuf(new uint8_t[4096]);
-    m_data.resize((length * 2 + 4095) & ~4095);
-    z_stream zstrm = {};
-    inflateInit2(&zstrm, 16 + MAX_WBITS);
-    zstrm.next_out = (Bytef*)m_data.data();
-    zstrm.avail_out = m_data.size();
-    zstrm.total_out = 0;
-
-    atUint64 rs;
-    while ((rs = r.readUBytesToBuf(compBuf.get(), 4096))) {
-      int inflateRet;
-      zstrm.next_in = compBuf.get();
-      zstrm.avail_in = rs;
-      while (zstrm.avail_in) {
-        if (!zstrm.avail_out) {
-          zstrm.avail_out = m_data.size();
-          m_data.resize(zstrm.avail_out * 2);
-          zstrm.next_out = (Bytef*)m_data.data() + zstrm.avail_out;
-        }
-        inflateRet = inflate(&zstrm, Z_NO_FLUSH);
-        if (inflateRet == Z_STREAM_END)
-          break;
-        if (inflateRet != Z_OK) {
-          inflateEnd(&zstrm);
-          m_data = std::vector<uint8_t>();
-          return;
-        }
-      }
-      if (inflateRet == Z_STREAM_END)
-        break;
+  z_stream zstrm = {};
+  if (inflateInit2(&zstrm, 16 + MAX_WBITS) != Z_OK)
+    return false;
+  zstrm.next_in = const_cast<Bytef*>(comp);
+  zstrm.avail_in = uInt(std::min(compSize, size_t(UINT32_MAX)));
+  size_t inRemaining = compSize - zstrm.avail_in;
+  size_t written = 0;
+  int inflateRet;
+  do {
+    if (written == m_arena.size())
+      m_arena.resize(m_arena.size() * 2);
+    zstrm.next_out = m_arena.data() + written;
+    zstrm.avail_out = uInt(std::min(m_arena.size() - written, size_t(UINT32_MAX)));
+    const uInt availOut = zstrm.avail_out;
+    if (!zstrm.avail_in && inRemaining) {
+      zstrm.avail_in = uInt(std::min(inRemaining, size_t(UINT32_MAX)));
+      inRemaining -= zstrm.avail_in;
     }
+    inflateRet = inflate(&zstrm, Z_NO_FLUSH);
+    written += availOut - zstrm.avail_out;
+  } while (inflateRet == Z_OK);
+  inflateEnd(&zstrm);
 
-    inflateEnd(&zstrm);
+  if (inflateRet != Z_STREAM_END || written < 12 || strncmp(reinterpret_cast<const char*>(m_arena.data()), "BLENDER", 7))
+    return false;
+  m_data = m_arena.data();
+  m_size = written;
+  return true;
+}
+
+SDNARead::SDNARead(SystemStringView path) {
+  if (!m_mapped.open(SystemString(path).c_str()) || m_mapped.size() < 12)
+    return;
 
-    if (strncmp((char*)m_data.data(), "BLENDER", 7)) {
-      m_data = std::vector<uint8_t>();
+  if (strncmp(reinterpret_cast<const char*>(m_mapped.data()), "BLENDER", 7)) {
+    /* Try gzip decompression; the mapping is only needed for input */
+    const bool ok = _inflate(m_mapped.data(), m_mapped.size());
+    m_mapped.close();
+    if (!ok)
       return;
-    }
   } else {
-    m_data.resize(length);
-    r.readUBytesToBuf(m_data.data(), length);
+    m_data = m_mapped.data();
+    m_size = m_mapped.size();
   }
 
   enumerate([this](const FileBlock& block, athena::io::MemoryReader& r) {
@@ -134,57 +189,392 @@ SDNARead::SDNARead(SystemStringView path) {
   });
 }
 
-BlendType GetBlendType(SystemStringView path) {
-  SDNARead r(path);
-  if (!r)
-    return BlendType::None;
+SDNARead::~SDNARead() {
+  if (!m_arena.empty())
+    Arenas().give(std::move(m_arena));
+}
 
+namespace {
+/* IDProperty field offsets needed to recognize the hecl_type property */
+struct SDNALayout {
   atUint32 idPropIdx;
-  const auto* idPropStruct = r.sdnaBlock().lookupStruct("IDProperty", idPropIdx);
+  atUint32 typeOffset;
+  atUint32 nameOffset;
+  atUint32 valOffset;
+};
+
+bool ComputeLayout(const SDNABlock& sdna, SDNALayout& layout) {
+  const auto* idPropStruct = sdna.lookupStruct("IDProperty", layout.idPropIdx);
   if (!idPropStruct)
-    return BlendType::None;
-  const auto* typeField = idPropStruct->lookupField(r.sdnaBlock(), "type");
+    return false;
+  const auto* typeField = idPropStruct->lookupField(sdna, "type");
   if (!typeField)
-    return BlendType::None;
-  atUint32 typeOffset = typeField->offset;
-  const auto* nameField = idPropStruct->lookupField(r.sdnaBlock(), "name");
+    return false;
+  layout.typeOffset = typeField->offset;
+  const auto* nameField = idPropStruct->lookupField(sdna, "name");
   if (!nameField)
-    return BlendType::None;
-  atUint32 nameOffset = nameField->offset;
-  const auto* dataField = idPropStruct->lookupField(r.sdnaBlock(), "data");
+    return false;
+  layout.nameOffset = nameField->offset;
+  const auto* dataField = idPropStruct->lookupField(sdna, "data");
   if (!dataField)
-    return BlendType::None;
-  atUint32 dataOffset = dataField->offset;
+    return false;
 
   atUint32 idPropDataIdx;
-  const auto* idPropDataStruct = r.sdnaBlock().lookupStruct("IDPropertyData", idPropDataIdx);
+  const auto* idPropDataStruct = sdna.lookupStruct("IDPropertyData", idPropDataIdx);
   if (!idPropDataStruct)
-    return BlendType::None;
-  const auto* valField = idPropDataStruct->lookupField(r.sdnaBlock(), "val");
+    return false;
+  const auto* valField = idPropDataStruct->lookupField(sdna, "val");
   if (!valField)
-    return BlendType::None;
-  atUint32 valOffset = dataOffset + valField->offset;
-
-  BlendType ret = BlendType::None;
-  r.enumerate(
-      [idPropIdx, typeOffset, nameOffset, valOffset, &ret](const FileBlock& block, athena::io::MemoryReader& r) {
-        if (block.type == FOURCC('DATA') && block.sdnaIdx == idPropIdx) {
-          r.seek(typeOffset, athena::SeekOrigin::Begin);
-          if (r.readUByte() != 1)
-            return true;
-
-          r.seek(nameOffset, athena::SeekOrigin::Begin);
-          if (r.readString() != "hecl_type")
-            return true;
-
-          r.seek(valOffset, athena::SeekOrigin::Begin);
-          ret = BlendType(r.readUint32Little());
+    return false;
+  layout.valOffset = dataField->offset + valField->offset;
+  return true;
+}
+
+constexpr std::string_view HeclTypeName("hecl_type", 10);
+
+/* Data blocks larger than this cannot be a lone IDProperty */
+constexpr atUint32 MaxPropertyBlockSize = 4096;
+
+bool MatchHeclType(const SDNALayout& layout, const FileBlock& block, const uint8_t* data, BlendType& typeOut) {
+  if (block.sdnaIdx != layout.idPropIdx || layout.typeOffset >= block.size ||
+      layout.nameOffset + HeclTypeName.size() > block.size || layout.valOffset + 4 > block.size)
+    return false;
+  if (data[layout.typeOffset] != 1)
+    return false;
+  if (std::memcmp(data + layout.nameOffset, HeclTypeName.data(), HeclTypeName.size()))
+    return false;
+  atUint32 val;
+  std::memcpy(&val, data + layout.valOffset, 4);
+  typeOut = BlendType(SLittle(val));
+  return true;
+}
+
+/* Sequential reader over a raw or gzip-compressed .blend */
+class BlendStream {
+  static constexpr size_t ChunkSize = 16384;
+  athena::io::FileReader m_reader;
+  bool m_gzip = false;
+  z_stream m_zstrm = {};
+  std::unique_ptr<uint8_t[]> m_chunk;
+
+public:
+  explicit BlendStream(SystemStringView path) : m_reader(path) {
+    if (m_reader.hasError())
+      return;
+    char magicBuf[7];
+    if (m_reader.readUBytesToBuf(magicBuf, 7) != 7)
+      return;
+    m_reader.seek(0, athena::SeekOrigin::Begin);
+    m_chunk.reset(new uint8_t[ChunkSize]);
+    if (strncmp(magicBuf, "BLENDER", 7)) {
+      m_gzip = true;
+      if (inflateInit2(&m_zstrm, 16 + MAX_WBITS) != Z_OK) {
+        m_gzip = false;
+        m_chunk.reset();
+      }
+    }
+  }
+  ~BlendStream() {
+    if (m_gzip)
+      inflateEnd(&m_zstrm);
+  }
+  BlendStream(const BlendStream&) = delete;
+  BlendStream& operator=(const BlendStream&) = delete;
+
+  explicit operator bool() const { return m_chunk.operator bool(); }
+
+  bool read(void* buf, size_t len) {
+    if (!m_gzip)
+      return m_reader.readUBytesToBuf(buf, len) == len;
+
+    m_zstrm.next_out = static_cast<Bytef*>(buf);
+    m_zstrm.avail_out = len;
+    while (m_zstrm.avail_out) {
+      if (!m_zstrm.avail_in) {
+        const atUint64 rs = m_reader.readUBytesToBuf(m_chunk.get(), ChunkSize);
+        if (!rs)
           return false;
+        m_zstrm.next_in = m_chunk.get();
+        m_zstrm.avail_in = rs;
+      }
+      const int inflateRet = inflate(&m_zstrm, Z_NO_FLUSH);
+      if (inflateRet == Z_STREAM_END)
+        return m_zstrm.avail_out == 0;
+      if (inflateRet != Z_OK)
+        return false;
+    }
+    return true;
+  }
+
+  bool skip(size_t len) {
+    if (!m_gzip) {
+      m_reader.seek(len, athena::SeekOrigin::Current);
+      return m_reader.position() <= m_reader.length();
+    }
+    /* Inflate into a scratch buffer; avail_in keeps pointing into m_chunk */
+    uint8_t scratch[4096];
+    while (len) {
+      const size_t rs = std::min(len, sizeof(scratch));
+      if (!read(scratch, rs))
+        return false;
+      len -= rs;
+    }
+    return true;
+  }
+};
+
+constexpr uint32_t BlendInfoMagic = 'HBLI';
+constexpr uint32_t BlendInfoVersion = 1;
+constexpr uint32_t RiggedUnknown = 2;
+
+struct BlendInfoHeader {
+  uint32_t magic;
+  uint32_t version;
+};
+
+struct BlendInfoRecord {
+  uint64_t pathHash;
+  int64_t mtime;
+  uint64_t size;
+  uint32_t type;
+  uint32_t rigged;
+};
+
+uint64_t HashAbsPath(SystemStringView path) { return XXH64(path.data(), path.size() * sizeof(SystemChar), 0); }
+
+/* Journal of scan results for one project, kept in .hecl/blendinfo; later records win */
+class BlendInfoStore {
+  SystemString m_path;
+  UniqueFilePtr m_journal;
+  size_t m_records = 0;
+  std::unordered_map<uint64_t, BlendInfoRecord> m_entries;
+
+  void _compact() {
+    const SystemString partPath = m_path + _SYS_STR(".part");
+    auto fp = hecl::FopenUnique(partPath.c_str(), _SYS_STR("wb"));
+    if (!fp)
+      return;
+    const BlendInfoHeader header{BlendInfoMagic, BlendInfoVersion};
+    std::fwrite(&header, 1, sizeof(header), fp.get());
+    for (const auto& [pathHash, rec] : m_entries)
+      std::fwrite(&rec, 1, sizeof(rec), fp.get());
+    fp.reset();
+    hecl::Rename(partPath.c_str(), m_path.c_str());
+    m_records = m_entries.size();
+  }
+
+public:
+  /* An empty path keeps results in memory only, for blends outside any project */
+  explicit BlendInfoStore(SystemString path) : m_path(std::move(path)) {
+    if (m_path.empty())
+      return;
+    if (auto fp = hecl::FopenUnique(m_path.c_str(), _SYS_STR("rb"))) {
+      BlendInfoHeader header;
+      if (std::fread(&header, 1, sizeof(header), fp.get()) == sizeof(header) && header.magic == BlendInfoMagic &&
+          header.version == BlendInfoVersion) {
+        BlendInfoRecord rec;
+        while (std::fread(&rec, 1, sizeof(rec), fp.get()) == sizeof(rec)) {
+          ++m_records;
+          m_entries[rec.pathHash] = rec;
         }
-        return true;
-      });
+      }
+    }
+    if (m_records == 0 || m_records > 2 * m_entries.size() + 1024)
+      _compact();
+    m_journal = hecl::FopenUnique(m_path.c_str(), _SYS_STR("ab"));
+  }
+
+  const BlendInfoRecord* find(uint64_t pathHash, const Sstat& st) const {
+    auto search = m_entries.find(pathHash);
+    if (search == m_entries.end() || search->second.mtime != int64_t(st.st_mtime) ||
+        search->second.size != uint64_t(st.st_size))
+      return nullptr;
+    return &search->second;
+  }
+
+  void put(const BlendInfoRecord& rec) {
+    m_entries[rec.pathHash] = rec;
+    if (!m_journal)
+      return;
+    std::fwrite(&rec, 1, sizeof(rec), m_journal.get());
+    std::fflush(m_journal.get());
+    ++m_records;
+  }
+};
+
+class BlendInfoCache {
+  std::mutex m_mutex;
+  /* Stores by project root, and the store serving each directory seen so far */
+  std::unordered_map<SystemString, std::unique_ptr<BlendInfoStore>> m_stores;
+  std::unordered_map<SystemString, BlendInfoStore*> m_dirStores;
+  BlendInfoStore m_transient{SystemString()};
+  /* DNA layouts by the three-digit Blender version in the file header */
+  std::unordered_map<std::string, SDNALayout> m_layouts;
+
+  BlendInfoStore& _storeFor(SystemStringView absPath) {
+    const SystemStringView dir = absPath.substr(0, absPath.find_last_of(_SYS_STR("/\\")));
+    auto search = m_dirStores.find(SystemString(dir));
+    if (search != m_dirStores.end())
+      return *search->second;
+
+    BlendInfoStore* store = &m_transient;
+    for (SystemStringView test = dir;;) {
+      const SystemString dotPath = SystemString(test) + _SYS_STR("/.hecl");
+      Sstat theStat;
+      if (!hecl::Stat((dotPath + _SYS_STR("/beacon")).c_str(), &theStat) && S_ISREG(theStat.st_mode)) {
+        auto& projStore = m_stores[dotPath];
+        if (!projStore)
+          projStore = std::make_unique<BlendInfoStore>(dotPath + _SYS_STR("/blendinfo"));
+        store = projStore.get();
+        break;
+      }
+      const size_t sep = test.find_last_of(_SYS_STR("/\\"));
+      if (sep == SystemStringView::npos || sep == 0)
+        break;
+      test = test.substr(0, sep);
+    }
+    m_dirStores.emplace(dir, store);
+    return *store;
+  }
+
+public:
+  bool lookup(SystemStringView absPath, const Sstat& st, BlendInfo& out) {
+    std::lock_guard lk{m_mutex};
+    const BlendInfoRecord* rec = _storeFor(absPath).find(HashAbsPath(absPath), st);
+    if (!rec)
+      return false;
+    out.type = BlendType(rec->type);
+    if (rec->rigged != RiggedUnknown)
+      out.rigged = rec->rigged != 0;
+    else
+      out.rigged.reset();
+    return true;
+  }
+
+  void record(SystemStringView absPath, const Sstat& st, BlendType type, uint32_t rigged) {
+    std::lock_guard lk{m_mutex};
+    _storeFor(absPath).put(
+        BlendInfoRecord{HashAbsPath(absPath), int64_t(st.st_mtime), uint64_t(st.st_size), uint32_t(type), rigged});
+  }
 
+  std::optional<SDNALayout> layout(std::string_view version) {
+    std::lock_guard lk{m_mutex};
+    auto search = m_layouts.find(std::string(version));
+    if (search == m_layouts.end())
+      return std::nullopt;
+    return search->second;
+  }
+
+  void setLayout(std::string_view version, const SDNALayout& layout) {
+    std::lock_guard lk{m_mutex};
+    m_layouts[std::string(version)] = layout;
+  }
+};
+
+BlendInfoCache& Cache() {
+  static BlendInfoCache cache;
+  return cache;
+}
+
+/* Stream blocks until a hecl_type property is found. Property blocks usually precede
+ * DNA1, so unless a layout for the file's Blender version is already known, blocks
+ * mentioning hecl_type are held until DNA1 can interpret them. */
+BlendType ScanBlendType(SystemStringView path, BlendInfoCache& cache) {
+  BlendStream s(path);
+  if (!s)
+    return BlendType::None;
+
+  char header[12];
+  if (!s.read(header, 12) || strncmp(header, "BLENDER", 7))
+    return BlendType::None;
+  /* FileBlock assumes 8-byte pointers and little endian, as SDNARead does */
+  if (header[7] != '-' || header[8] != 'v')
+    return BlendType::None;
+  const std::string_view version(header + 9, 3);
+  std::optional<SDNALayout> cachedLayout = cache.layout(version);
+  bool layoutParsed = false;
+
+  std::vector<std::pair<FileBlock, std::vector<uint8_t>>> candidates;
+  std::vector<uint8_t> data;
+  BlendType ret;
+  while (true) {
+    uint8_t blockBuf[24];
+    if (!s.read(blockBuf, sizeof(blockBuf)))
+      return BlendType::None;
+    FileBlock block;
+    {
+      athena::io::MemoryReader r(blockBuf, sizeof(blockBuf));
+      block.read(r);
+    }
+    if (block.type == FOURCC('ENDB'))
+      return BlendType::None;
+
+    if (block.type == FOURCC('DNA1')) {
+      data.resize(block.size);
+      if (!s.read(data.data(), block.size))
+        return BlendType::None;
+      SDNABlock sdna;
+      athena::io::MemoryReader r(data.data(), data.size());
+      sdna.read(r);
+      for (SDNABlock::SDNAStruct& strc : sdna.strcs)
+        strc.computeOffsets(sdna);
+      SDNALayout layout;
+      if (!ComputeLayout(sdna, layout))
+        return BlendType::None;
+      cache.setLayout(version, layout);
+      cachedLayout = layout;
+      layoutParsed = true;
+      for (const auto& [candBlock, candData] : candidates)
+        if (MatchHeclType(layout, candBlock, candData.data(), ret))
+          return ret;
+      candidates.clear();
+      continue;
+    }
+
+    if (block.type != FOURCC('DATA') || block.size > MaxPropertyBlockSize) {
+      if (!s.skip(block.size))
+        return BlendType::None;
+      continue;
+    }
+
+    data.resize(block.size);
+    if (!s.read(data.data(), block.size))
+      return BlendType::None;
+    if (cachedLayout && MatchHeclType(*cachedLayout, block, data.data(), ret))
+      return ret;
+    if (!layoutParsed &&
+        std::string_view(reinterpret_cast<const char*>(data.data()), data.size()).find(HeclTypeName) !=
+            std::string_view::npos)
+      candidates.emplace_back(block, data);
+  }
+}
+
+} // anonymous namespace
+
+BlendInfo GetBlendInfo(SystemStringView path) {
+  const SystemString absPath(path);
+  Sstat theStat;
+  if (hecl::Stat(absPath.c_str(), &theStat) || !S_ISREG(theStat.st_mode))
+    return {BlendType::None, std::nullopt};
+
+  BlendInfoCache& cache = Cache();
+  BlendInfo ret{BlendType::None, std::nullopt};
+  if (cache.lookup(absPath, theStat, ret))
+    return ret;
+
+  ret.type = ScanBlendType(absPath, cache);
+  cache.record(absPath, theStat, ret.type, RiggedUnknown);
   return ret;
 }
 
+BlendType GetBlendType(SystemStringView path) { return GetBlendInfo(path).type; }
+
+void RecordBlendInfo(SystemStringView path, BlendType type, bool rigged) {
+  const SystemString absPath(path);
+  Sstat theStat;
+  if (hecl::Stat(absPath.c_str(), &theStat) || !S_ISREG(theStat.st_mode))
+    return;
+  Cache().record(absPath, theStat, type, rigged ? 1 : 0);
+}
+
 } // namespace hecl::blender
@@ -0,0 +1,82 @@
+#include "hecl/Blender/Connection.hpp"
+
+#include <algorithm>
+
+namespace hecl::blender {
+
+uint32_t SkinPool::_addBone(std::string_view name) {
+  auto [it, inserted] = m_boneIdxs.try_emplace(std::string(name), uint32_t(m_boneNames.size()));
+  if (inserted)
+    m_boneNames.emplace_back(name);
+  return it->second;
+}
+
+uint32_t SkinPool::addBone(std::string_view name) {
+  std::unique_lock lk{m_mutex};
+  return _addBone(name);
+}
+
+SkinPool::MeshBinding SkinPool::addMesh(const Mesh& mesh) {
+  MeshBinding ret;
+  ret.boneIdxs.reserve(mesh.boneNames.size());
+  ret.skinIdxs.reserve(mesh.skins.size());
+
+  std::unique_lock lk{m_mutex};
+  for (const std::string& name : mesh.boneNames)
+    ret.boneIdxs.push_back(_addBone(name));
+
+  for (const auto& meshSkin : mesh.skins) {
+    Skin skin;
+    size_t bindCount = 0;
+    for (const Mesh::SkinBind& bind : meshSkin) {
+      if (!bind.valid())
+        break;
+      if (bind.vg_idx < ret.boneIdxs.size())
+        skin[bindCount++] = {ret.boneIdxs[bind.vg_idx], bind.weight};
+    }
+    /* Meshes list the same influences in their own vertex group order */
+    std::sort(skin.begin(), skin.begin() + bindCount,
+              [](const Bind& a, const Bind& b) { return a.boneIdx < b.boneIdx; });
+
+    const uint64_t hash = XXH64(skin.data(), sizeof(Skin), 0);
+    uint32_t poolIdx = UINT32_MAX;
+    for (auto [it, end] = m_skinLookup.equal_range(hash); it != end; ++it) {
+      if (m_skins[it->second] == skin) {
+        poolIdx = it->second;
+        break;
+      }
+    }
+    if (poolIdx == UINT32_MAX) {
+      poolIdx = uint32_t(m_skins.size());
+      m_skins.push_back(skin);
+      m_skinLookup.emplace(hash, poolIdx);
+    }
+    ret.skinIdxs.push_back(poolIdx);
+  }
+  return ret;
+}
+
+void SkinPool::Remap(PoolSkinIndex& index, const MeshBinding& binding) {
+  for (size_t i = 0; i < index.m_poolSz; ++i) {
+    uint32_t& skinIdx = index.m_poolToSkinIndex[i];
+    if (skinIdx < binding.skinIdxs.size())
+      skinIdx = binding.skinIdxs[skinIdx];
+  }
+}
+
+std::vector<std::string> SkinPool::getBoneNames() const {
+  std::unique_lock lk{m_mutex};
+  return m_boneNames;
+}
+
+std::vector<SkinPool::Skin> SkinPool::getSkins() const {
+  std::unique_lock lk{m_mutex};
+  return m_skins;
+}
+
+std::size_t SkinPool::getSkinCount() const {
+  std::unique_lock lk{m_mutex};
+  return m_skins.size();
+}
+
+} // namespace hecl::blender
@@ -0,0 +1,183 @@
+#include "hecl/Blender/SyntheticProject.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "hecl/Blender/Connection.hpp"
+#include "hecl/Blender/Token.hpp"
+#include "hecl/ClientProcess.hpp"
+#include "hecl/hecl.hpp"
+
+#include <logvisor/logvisor.hpp>
+#include <png.h>
+
+namespace hecl::blender {
+
+static logvisor::Module Log("hecl::blender::SyntheticProject");
+
+namespace {
+/* Deterministic per-file stream so generated content is identical across runs */
+struct XorShift32 {
+  uint32_t m_state;
+  explicit XorShift32(uint32_t seed) : m_state(seed * 0x9E3779B9u + 0x6C8E9CF5u) {
+    if (!m_state)
+      m_state = 1;
+  }
+  uint32_t next() {
+    m_state ^= m_state << 13;
+    m_state ^= m_state >> 17;
+    m_state ^= m_state << 5;
+    return m_state;
+  }
+  float unit() { return float(next() >> 8) / float(1u << 24); }
+};
+
+/* Gradient with noise in the low bits, so PNGs neither compress away nor decode as pure noise */
+bool WriteTexture(const ProjectPath& path, uint32_t size, uint32_t seed) {
+  XorShift32 rng(seed);
+  std::vector<uint8_t> rgba(size_t(size) * size * 4);
+  const uint32_t hue = rng.next();
+  for (uint32_t y = 0; y < size; ++y) {
+    for (uint32_t x = 0; x < size; ++x) {
+      uint8_t* px = &rgba[(size_t(y) * size + x) * 4];
+      const uint32_t noise = rng.next();
+      px[0] = uint8_t((x * 255 / std::max(size - 1, 1u)) ^ (hue & 0xff) ^ (noise & 0x0f));
+      px[1] = uint8_t((y * 255 / std::max(size - 1, 1u)) ^ ((hue >> 8) & 0xff) ^ ((noise >> 4) & 0x0f));
+      px[2] = uint8_t(((x + y) * 127 / std::max(size - 1, 1u)) ^ ((hue >> 16) & 0xff) ^ ((noise >> 8) & 0x0f));
+      px[3] = 255;
+    }
+  }
+
+  auto fp = hecl::FopenUnique(path.getAbsolutePath().data(), _SYS_STR("wb"));
+  if (!fp)
+    return false;
+  png_image image = {};
+  image.version = PNG_IMAGE_VERSION;
+  image.width = size;
+  image.height = size;
+  image.format = PNG_FORMAT_RGBA;
+  const bool ret = png_image_write_to_stdio(&image, fp.get(), 0, rgba.data(), 0, nullptr);
+  png_image_free(&image);
+  return ret;
+}
+
+bool WriteYaml(const ProjectPath& path, uint32_t entries, uint32_t seed) {
+  XorShift32 rng(seed);
+  std::string doc =
+      fmt::format(FMT_STRING("# Synthetic benchmark data\nname: data{:04}\nseed: {}\nentries:\n"), seed, rng.next());
+  doc.reserve(size_t(entries) * 160);
+  for (uint32_t i = 0; i < entries; ++i) {
+    /* Drawn in sequence; argument evaluation order would differ between compilers */
+    float position[3];
+    for (float& c : position)
+      c = rng.unit() * 200.f - 100.f;
+    const float weight = rng.unit();
+    const uint32_t flags = rng.next();
+    const uint32_t tag0 = rng.next() % 64;
+    const uint32_t tag1 = rng.next() % 64;
+    fmt::format_to(std::back_inserter(doc),
+                   FMT_STRING("  - id: {}\n"
+                              "    position: [{:.4f}, {:.4f}, {:.4f}]\n"
+                              "    weight: {:.4f}\n"
+                              "    flags: 0x{:08X}\n"
+                              "    tags: [tag{}, tag{}]\n"),
+                   i, position[0], position[1], position[2], weight, flags, tag0, tag1);
+  }
+
+  auto fp = hecl::FopenUnique(path.getAbsolutePath().data(), _SYS_STR("wb"));
+  if (!fp)
+    return false;
+  return std::fwrite(doc.data(), 1, doc.size(), fp.get()) == doc.size();
+}
+
+/* texture may be null, leaving the material untextured */
+bool WriteMesh(Connection& conn, const ProjectPath& path, const ProjectPath* texture, uint32_t subdivisions) {
+  if (!conn.createBlend(path, BlendType::Mesh))
+    return false;
+  {
+    PyOutStream os = conn.beginPythonOut(true);
+    os.format(FMT_STRING("import bpy, bmesh, math\n"
+                         "bm = bmesh.new()\n"
+                         "bmesh.ops.create_icosphere(bm, subdivisions={}, radius=1.0)\n"
+                         "uv_layer = bm.loops.layers.uv.new()\n"
+                         "for f in bm.faces:\n"
+                         "    for l in f.loops:\n"
+                         "        co = l.vert.co.normalized()\n"
+                         "        l[uv_layer].uv = (0.5 + math.atan2(co.y, co.x) / (2.0 * math.pi),\n"
+                         "                          0.5 + math.asin(max(-1.0, min(1.0, co.z))) / math.pi)\n"
+                         "mesh = bpy.data.meshes.new('synthetic')\n"
+                         "bm.to_mesh(mesh)\n"
+                         "bm.free()\n"
+                         "obj = bpy.data.objects.new('synthetic', mesh)\n"
+                         "bpy.context.scene.collection.objects.link(obj)\n"
+                         "mat = bpy.data.materials.new('synthetic')\n"
+                         "mat.use_nodes = True\n"
+                         "mesh.materials.append(mat)\n"),
+              subdivisions);
+    if (texture)
+      os.format(FMT_STRING("tex = mat.node_tree.nodes.new('ShaderNodeTexImage')\n"
+                           "tex.image = bpy.data.images.load('''{}''', check_existing=True)\n"
+                           "bsdf = mat.node_tree.nodes.get('Principled BSDF')\n"
+                           "if bsdf:\n"
+                           "    mat.node_tree.links.new(tex.outputs['Color'], bsdf.inputs['Base Color'])\n"),
+                texture->getAbsolutePathUTF8());
+  }
+  return conn.saveBlend();
+}
+} // anonymous namespace
+
+size_t GenerateSyntheticProject(const ProjectPath& dir, const SyntheticProjectDesc& desc, ClientProcess& cp) {
+  const ProjectPath texDir(dir, _SYS_STR("textures"));
+  const ProjectPath dataDir(dir, _SYS_STR("data"));
+  const ProjectPath meshDir(dir, _SYS_STR("meshes"));
+  for (const ProjectPath* sub : {&texDir, &dataDir, &meshDir})
+    sub->makeDirChain(true);
+
+  const auto texPath = [&](uint32_t i) {
+    return ProjectPath(texDir, fmt::format(FMT_STRING("tex{:04}.png"), i));
+  };
+
+  std::atomic_size_t written = 0;
+  for (uint32_t i = 0; i < desc.textureCount; ++i) {
+    cp.addLambdaTransaction([&, i](Token&) {
+      if (WriteTexture(texPath(i), desc.textureSize, i))
+        ++written;
+      else
+        Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to write '{}'")), texPath(i).getAbsolutePath());
+    });
+  }
+  /* Meshes link textures, which must exist when Blender loads them */
+  cp.waitUntilComplete();
+
+  for (uint32_t i = 0; i < desc.yamlCount; ++i) {
+    cp.addLambdaTransaction([&, i](Token&) {
+      const ProjectPath path(dataDir, fmt::format(FMT_STRING("data{:04}.yaml"), i));
+      if (WriteYaml(path, desc.yamlEntries, i))
+        ++written;
+      else
+        Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to write '{}'")), path.getAbsolutePath());
+    });
+  }
+
+  const uint32_t subdivisions = std::min(desc.meshSubdivisions, 8u);
+  for (uint32_t i = 0; i < desc.meshCount; ++i) {
+    cp.addLambdaTransaction(
+        [&, i](Token& btok) {
+          const ProjectPath path(meshDir, fmt::format(FMT_STRING("mesh{:04}.blend"), i));
+          const ProjectPath texture = desc.textureCount ? texPath(i % desc.textureCount) : ProjectPath();
+          if (WriteMesh(btok.getBlenderConnection(), path, desc.textureCount ? &texture : nullptr, subdivisions))
+            ++written;
+          else
+            Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to write '{}'")), path.getAbsolutePath());
+        },
+        Database::Cost::Heavy);
+  }
+  cp.waitUntilComplete();
+  return written;
+}
+
+} // namespace hecl::blender
@@ -0,0 +1,214 @@
+#include "hecl/BridgePathCache.hpp"
+
+#include <cstdio>
+#include <vector>
+
+#include "hecl/Database.hpp"
+
+#include <logvisor/logvisor.hpp>
+
+namespace hecl::Database {
+
+static logvisor::Module Log("hecl::BridgePathCache");
+
+constexpr uint32_t BridgePathCacheMagic = 'HBPC';
+constexpr uint32_t BridgePathCacheVersion = 1;
+
+namespace {
+struct TableHeader {
+  uint32_t magic;
+  uint32_t version;
+  /* Power of two, at least twice count */
+  uint32_t capacity;
+  uint32_t count;
+  uint64_t stringsSize;
+};
+
+/* IDs are often sequential or share high bits; spread them before masking */
+uint32_t SlotIndex(uint64_t id, uint32_t capacity) {
+  return uint32_t((id * 0x9E3779B97F4A7C15ull) >> 32) & (capacity - 1);
+}
+
+std::string EncodePath(const ProjectPath& path) {
+  if (path.getAuxInfo().empty())
+    return std::string(path.getRelativePathUTF8());
+  return std::string(path.getRelativePathUTF8()) + '|' + std::string(path.getAuxInfoUTF8());
+}
+} // anonymous namespace
+
+/* A zero length marks an empty slot */
+struct BridgePathCache::Slot {
+  uint64_t id;
+  uint32_t strOffset;
+  uint32_t strLen;
+};
+
+BridgePathCache::BridgePathCache(Project& project) : m_project(project) {}
+
+BridgePathCache::~BridgePathCache() { save(); }
+
+void BridgePathCache::_map() {
+  m_slots = nullptr;
+  m_capacity = 0;
+  m_mappedCount = 0;
+  m_strings = nullptr;
+  m_stringsSize = 0;
+  if (!m_file.open(m_path.c_str()))
+    return;
+
+  const auto* header = reinterpret_cast<const TableHeader*>(m_file.data());
+  if (m_file.size() < sizeof(TableHeader) || header->magic != BridgePathCacheMagic ||
+      header->version != BridgePathCacheVersion || !header->capacity ||
+      (header->capacity & (header->capacity - 1)) || header->count >= header->capacity ||
+      m_file.size() != sizeof(TableHeader) + uint64_t(header->capacity) * sizeof(Slot) + header->stringsSize) {
+    Log.report(logvisor::Warning, FMT_STRING(_SYS_STR("ignoring malformed bridge path cache '{}'")), m_path);
+    m_file.close();
+    return;
+  }
+  m_slots = reinterpret_cast<const Slot*>(m_file.data() + sizeof(TableHeader));
+  m_capacity = header->capacity;
+  m_mappedCount = header->count;
+  m_strings = reinterpret_cast<const char*>(m_slots + m_capacity);
+  m_stringsSize = header->stringsSize;
+}
+
+void BridgePathCache::_load() {
+  m_loaded = true;
+  m_path = SystemString(m_project.getProjectRootPath().getAbsolutePath()) + _SYS_STR("/.hecl/bridgecache");
+  _map();
+}
+
+const BridgePathCache::Slot* BridgePathCache::_findMapped(uint64_t id) const {
+  if (m_cleared || !m_capacity)
+    return nullptr;
+  uint32_t i = SlotIndex(id, m_capacity);
+  for (uint32_t probes = 0; probes < m_capacity; ++probes, i = (i + 1) & (m_capacity - 1)) {
+    const Slot& slot = m_slots[i];
+    if (!slot.strLen)
+      return nullptr;
+    if (slot.id == id)
+      return uint64_t(slot.strOffset) + slot.strLen <= m_stringsSize ? &slot : nullptr;
+  }
+  return nullptr;
+}
+
+std::string_view BridgePathCache::_slotPath(const Slot& slot) const {
+  return std::string_view(m_strings + slot.strOffset, slot.strLen);
+}
+
+void BridgePathCache::add(uint64_t id, const ProjectPath& path) {
+  std::string encoded = EncodePath(path);
+  std::unique_lock lk{m_mutex};
+  if (!m_loaded)
+    _load();
+  if (const Slot* slot = _findMapped(id); slot && _slotPath(*slot) == encoded && !m_added.count(id))
+    return;
+  m_added.insert_or_assign(id, std::move(encoded));
+  m_dirty = true;
+  /* Keep pointers handed out by lookup() valid */
+  if (auto search = m_resolved.find(id); search != m_resolved.end())
+    search->second = path;
+}
+
+void BridgePathCache::clear() {
+  std::unique_lock lk{m_mutex};
+  if (!m_loaded)
+    _load();
+  m_dirty = m_dirty || m_mappedCount || !m_added.empty();
+  m_cleared = true;
+  m_added.clear();
+  m_resolved.clear();
+}
+
+const ProjectPath* BridgePathCache::lookup(uint64_t id) {
+  std::unique_lock lk{m_mutex};
+  if (!m_loaded)
+    _load();
+  if (auto search = m_resolved.find(id); search != m_resolved.end())
+    return &search->second;
+
+  std::string_view encoded;
+  if (auto search = m_added.find(id); search != m_added.end())
+    encoded = search->second;
+  else if (const Slot* slot = _findMapped(id))
+    encoded = _slotPath(*slot);
+  else
+    return nullptr;
+  return &m_resolved.emplace(id, ProjectPath(m_project, encoded)).first->second;
+}
+
+size_t BridgePathCache::size() {
+  std::unique_lock lk{m_mutex};
+  if (!m_loaded)
+    _load();
+  size_t ret = m_cleared ? 0 : m_mappedCount;
+  for (const auto& [id, path] : m_added)
+    if (!_findMapped(id))
+      ++ret;
+  return ret;
+}
+
+void BridgePathCache::save() {
+  std::unique_lock lk{m_mutex};
+  if (!m_dirty)
+    return;
+
+  /* Merge surviving mapped entries with additions, which take precedence */
+  std::vector<std::pair<uint64_t, std::string_view>> entries;
+  entries.reserve(m_added.size() + (m_cleared ? 0 : m_mappedCount));
+  for (const auto& [id, path] : m_added)
+    entries.emplace_back(id, path);
+  if (!m_cleared)
+    for (uint32_t i = 0; i < m_capacity; ++i)
+      if (m_slots[i].strLen && !m_added.count(m_slots[i].id))
+        entries.emplace_back(m_slots[i].id, _slotPath(m_slots[i]));
+
+  uint32_t capacity = 16;
+  while (capacity < entries.size() * 2)
+    capacity *= 2;
+  std::vector<Slot> slots(capacity, Slot{0, 0, 0});
+  std::string strings;
+  uint32_t count = 0;
+  for (const auto& [id, path] : entries) {
+    if (path.empty() || strings.size() + path.size() > UINT32_MAX)
+      continue;
+    uint32_t i = SlotIndex(id, capacity);
+    while (slots[i].strLen)
+      i = (i + 1) & (capacity - 1);
+    slots[i] = Slot{id, uint32_t(strings.size()), uint32_t(path.size())};
+    strings += path;
+    ++count;
+  }
+
+  const SystemString partPath = m_path + _SYS_STR(".part");
+  auto fp = hecl::FopenUnique(partPath.c_str(), _SYS_STR("wb"));
+  if (!fp) {
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to write bridge path cache '{}'")), partPath);
+    return;
+  }
+  const TableHeader header{BridgePathCacheMagic, BridgePathCacheVersion, capacity, count, uint64_t(strings.size())};
+  std::fwrite(&header, 1, sizeof(header), fp.get());
+  std::fwrite(slots.data(), sizeof(Slot), slots.size(), fp.get());
+  std::fwrite(strings.data(), 1, strings.size(), fp.get());
+  if (std::fclose(fp.release())) {
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to write bridge path cache '{}'")), partPath);
+    hecl::Unlink(partPath.c_str());
+    return;
+  }
+
+  /* The old table must be unmapped before Windows will replace it */
+  entries.clear();
+  m_file.close();
+  if (hecl::Rename(partPath.c_str(), m_path.c_str())) {
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to replace bridge path cache '{}'")), m_path);
+    hecl::Unlink(partPath.c_str());
+    _map();
+    return;
+  }
+  _map();
+  m_cleared = false;
+  m_dirty = false;
+  m_added.clear();
+}
+
+} // namespace hecl::Database
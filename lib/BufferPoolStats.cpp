@@ -0,0 +1,69 @@
+#include "hecl/BufferPoolStats.hpp"
+
+#include <algorithm>
+#include <mutex>
+
+#include "hecl/Console.hpp"
+
+namespace hecl {
+
+namespace {
+struct PoolRegistry {
+  std::mutex m_mutex;
+  std::vector<BufferPoolBase*> m_pools;
+};
+
+/* Pools are often globals; construct on first use to sidestep static init order */
+PoolRegistry& Registry() {
+  static PoolRegistry registry;
+  return registry;
+}
+} // anonymous namespace
+
+BufferPoolBase::BufferPoolBase(std::string_view defaultName) : m_name(defaultName) {
+  PoolRegistry& reg = Registry();
+  std::lock_guard lk{reg.m_mutex};
+  reg.m_pools.push_back(this);
+}
+
+BufferPoolBase::~BufferPoolBase() {
+  PoolRegistry& reg = Registry();
+  std::lock_guard lk{reg.m_mutex};
+  reg.m_pools.erase(std::find(reg.m_pools.begin(), reg.m_pools.end(), this));
+}
+
+void BufferPoolBase::setName(std::string_view name) { m_name = name; }
+
+std::vector<BufferPoolStats> SnapshotBufferPools() {
+  PoolRegistry& reg = Registry();
+  std::lock_guard lk{reg.m_mutex};
+  std::vector<BufferPoolStats> ret;
+  ret.reserve(reg.m_pools.size());
+  for (BufferPoolBase* pool : reg.m_pools)
+    ret.push_back(pool->stats());
+  return ret;
+}
+
+void RegisterBufferPoolCommands(Console& console) {
+  console.registerCommand(
+      "bufferPoolStats", "Prints bucket usage, upload volume and fragmentation of GPU buffer pools", "",
+      [](Console* con, const std::vector<std::string>&) {
+        const std::vector<BufferPoolStats> pools = SnapshotBufferPools();
+        if (pools.empty()) {
+          con->report(Console::Level::Info, FMT_STRING("No buffer pools"));
+          return;
+        }
+        for (const BufferPoolStats& st : pools) {
+          con->report(Console::Level::Info,
+                      FMT_STRING("{}: stride {}, {} buckets ({} KiB), {} live (peak {}), {} free, "
+                                 "{:.1f}% fragmented"),
+                      st.m_name, st.m_stride, st.m_bucketCount, st.capacityBytes() / 1024, st.m_liveElements,
+                      st.m_peakLiveElements, st.m_freeElements, st.fragmentation() * 100.f);
+          con->report(Console::Level::Info,
+                      FMT_STRING("  {} allocs, {} releases, {} B uploaded last frame, {} KiB total"),
+                      st.m_allocations, st.m_releases, st.m_lastUploadBytes, st.m_totalUploadBytes / 1024);
+        }
+      });
+}
+
+} // namespace hecl
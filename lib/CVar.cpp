@@ -207,7 +207,7 @@ double CVar::toReal(bool* isValid) const {
   if (isValid != nullptr)
     *isValid = true;
 
-  return strtod(m_value.c_str(), nullptr);
+  return std::bit_cast<double>(m_scalar.load(std::memory_order_relaxed));
 }
 
 bool CVar::toBoolean(bool* isValid) const {
@@ -221,7 +221,7 @@ bool CVar::toBoolean(bool* isValid) const {
   if (isValid != nullptr)
     *isValid = true;
 
-  return athena::utility::parseBool(m_value);
+  return m_scalar.load(std::memory_order_relaxed) != 0;
 }
 
 int32_t CVar::toSigned(bool* isValid) const {
@@ -234,7 +234,7 @@ int32_t CVar::toSigned(bool* isValid) const {
   if (isValid != nullptr)
     *isValid = true;
 
-  return strtol(m_value.c_str(), nullptr, 0);
+  return int32_t(uint32_t(m_scalar.load(std::memory_order_relaxed)));
 }
 
 uint32_t CVar::toUnsigned(bool* isValid) const {
@@ -247,7 +247,7 @@ uint32_t CVar::toUnsigned(bool* isValid) const {
   if (isValid != nullptr)
     *isValid = true;
 
-  return strtoul(m_value.c_str(), nullptr, 0);
+  return uint32_t(m_scalar.load(std::memory_order_relaxed));
 }
 
 std::string CVar::toLiteral(bool* isValid) const {
@@ -339,6 +339,7 @@ bool CVar::fromReal(double val) {
     return false;
 
   m_value.assign(fmt::format(FMT_STRING("{}"), val));
+  updateScalar();
   setModified();
   return true;
 }
@@ -352,6 +353,7 @@ bool CVar::fromBoolean(bool val) {
   else
     m_value = "false"sv;
 
+  updateScalar();
   setModified();
   return true;
 }
@@ -370,6 +372,7 @@ bool CVar::fromInteger(int32_t val) {
 
   // Properly format based on signedness
   m_value = fmt::format(FMT_STRING("{}"), (m_type == EType::Signed ? val : static_cast<uint32_t>(val)));
+  updateScalar();
   setModified();
   return true;
 }
@@ -388,6 +391,7 @@ bool CVar::fromInteger(uint32_t val) {
 
   // Properly format based on signedness
   m_value = fmt::format(FMT_STRING("{}"), (m_type == EType::Unsigned ? val : static_cast<int32_t>(val)));
+  updateScalar();
   setModified();
   return true;
 }
@@ -414,6 +418,7 @@ bool CVar::fromLiteralToType(std::string_view val) {
   if (!safeToModify(m_type) || !isValidInput(val))
     return false;
   m_value = val;
+  updateScalar();
   setModified();
   return true;
 }
@@ -453,6 +458,26 @@ void CVar::clearModified() {
 
 void CVar::setModified() { m_flags |= EFlags::Modified; }
 
+void CVar::updateScalar() {
+  uint64_t bits = 0;
+  switch (m_type) {
+  case EType::Boolean:
+    bits = athena::utility::parseBool(m_value);
+    break;
+  case EType::Signed:
+  case EType::Unsigned:
+    /* Only the low 32 bits are kept, matching both to{Signed,Unsigned} truncations */
+    bits = uint32_t(strtoll(m_value.c_str(), nullptr, 0));
+    break;
+  case EType::Real:
+    bits = std::bit_cast<uint64_t>(strtod(m_value.c_str(), nullptr));
+    break;
+  default:
+    return;
+  }
+  m_scalar.store(bits, std::memory_order_relaxed);
+}
+
 void CVar::unlock() {
   if (isReadOnly() && !m_unlocked) {
     m_oldFlags = m_flags;
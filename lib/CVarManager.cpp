@@ -1,6 +1,7 @@
 #include "hecl/CVarManager.hpp"
 
 #include <algorithm>
+#include <functional>
 #include <memory>
 #include <regex>
 
@@ -38,7 +39,15 @@ CVarManager::CVarManager(hecl::Runtime::FileStoreManager& store, bool useBinary)
                          (CVar::EFlags::Game | CVar::EFlags::ReadOnly | CVar::EFlags::InternalArchivable));
 }
 
-CVarManager::~CVarManager() {}
+CVarManager::~CVarManager() {
+  {
+    std::unique_lock lk{m_saveMutex};
+    m_saveQuit = true;
+  }
+  m_saveCv.notify_all();
+  if (m_saveThread.joinable())
+    m_saveThread.join();
+}
 
 CVar* CVarManager::registerCVar(std::unique_ptr<CVar>&& cvar) {
   std::string tmp(cvar->name());
@@ -108,6 +117,20 @@ void CVarManager::deserialize(CVar* cvar) {
   }
 
   /* We were either unable to find a deferred value or got an invalid value */
+  const hecl::SystemString filename = configPath();
+  if (filename != m_configIndexPath)
+    loadConfigIndex(filename);
+
+  if (const auto serialized = m_configIndex.find(std::string(cvar->name())); serialized != m_configIndex.end()) {
+    if (cvar->m_value != serialized->second) {
+      CVarUnlocker lc(cvar);
+      cvar->fromLiteralToType(serialized->second);
+      cvar->m_wasDeserialized = true;
+    }
+  }
+}
+
+hecl::SystemString CVarManager::configPath() const {
 #if _WIN32
   hecl::SystemString filename =
       hecl::SystemString(m_store.getStoreRoot()) + _SYS_STR('/') + com_configfile->toWideLiteral();
@@ -115,100 +138,137 @@ void CVarManager::deserialize(CVar* cvar) {
   hecl::SystemString filename =
       hecl::SystemString(m_store.getStoreRoot()) + _SYS_STR('/') + com_configfile->toLiteral();
 #endif
+  filename += m_useBinary ? _SYS_STR(".bin") : _SYS_STR(".yaml");
+  return filename;
+}
+
+void CVarManager::loadConfigIndex(const hecl::SystemString& path) {
+  m_configIndex.clear();
+  m_configIndexPath = path;
+
   hecl::Sstat st;
+  if (hecl::Stat(path.c_str(), &st) || !S_ISREG(st.st_mode))
+    return;
+  athena::io::FileReader reader(path);
+  if (!reader.isOpen())
+    return;
 
   if (m_useBinary) {
     CVarContainer container;
-    filename += _SYS_STR(".bin");
-    if (hecl::Stat(filename.c_str(), &st) || !S_ISREG(st.st_mode))
-      return;
-    athena::io::FileReader reader(filename);
-    if (reader.isOpen())
-      container.read(reader);
-
-    if (container.cvars.size() > 0) {
-      auto serialized = std::find_if(container.cvars.begin(), container.cvars.end(),
-                                     [&cvar](const DNACVAR::CVar& c) { return c.m_name == cvar->name(); });
-
-      if (serialized != container.cvars.end()) {
-        DNACVAR::CVar& tmp = *serialized;
-
-        if (cvar->m_value != tmp.m_value) {
-          CVarUnlocker lc(cvar);
-          cvar->fromLiteralToType(tmp.m_value);
-          cvar->m_wasDeserialized = true;
-        }
-      }
-    }
+    container.read(reader);
+    for (DNACVAR::CVar& cvar : container.cvars)
+      m_configIndex.emplace(std::move(cvar.m_name), std::move(cvar.m_value));
   } else {
-    filename += _SYS_STR(".yaml");
-    if (hecl::Stat(filename.c_str(), &st) || !S_ISREG(st.st_mode))
+    athena::io::YAMLDocReader docReader;
+    if (!docReader.parse(&reader))
       return;
-    athena::io::FileReader reader(filename);
-    if (reader.isOpen()) {
-      athena::io::YAMLDocReader docReader;
-      if (docReader.parse(&reader)) {
-        std::unique_ptr<athena::io::YAMLNode> root = docReader.releaseRootNode();
-        auto serialized = std::find_if(root->m_mapChildren.begin(), root->m_mapChildren.end(),
-                                       [&cvar](const auto& c) { return c.first == cvar->name(); });
-
-        if (serialized != root->m_mapChildren.end()) {
-          const std::unique_ptr<athena::io::YAMLNode>& tmp = serialized->second;
-
-          if (cvar->m_value != tmp->m_scalarString) {
-            CVarUnlocker lc(cvar);
-            cvar->fromLiteralToType(tmp->m_scalarString);
-            cvar->m_wasDeserialized = true;
-          }
-        }
-      }
-    }
+    std::unique_ptr<athena::io::YAMLNode> root = docReader.releaseRootNode();
+    for (auto& [name, node] : root->m_mapChildren)
+      m_configIndex.emplace(name, node->m_scalarString);
   }
 }
 
-void CVarManager::serialize() {
-#if _WIN32
-  hecl::SystemString filename =
-      hecl::SystemString(m_store.getStoreRoot()) + _SYS_STR('/') + com_configfile->toWideLiteral();
-#else
-  hecl::SystemString filename =
-      hecl::SystemString(m_store.getStoreRoot()) + _SYS_STR('/') + com_configfile->toLiteral();
-#endif
+struct CVarManager::ConfigSnapshot {
+  hecl::SystemString m_path;
+  bool m_binary;
+  std::vector<std::pair<std::string, std::string>> m_values;
+
+  void write() const {
+    const hecl::SystemString partPath = m_path + _SYS_STR(".part");
+    if (m_binary) {
+      CVarContainer container;
+      container.cvars.reserve(m_values.size());
+      for (const auto& [name, value] : m_values) {
+        DNACVAR::CVar& cvar = container.cvars.emplace_back();
+        cvar.m_name = name;
+        cvar.m_value = value;
+      }
+      container.cvarCount = atUint32(container.cvars.size());
 
-  if (m_useBinary) {
-    CVarContainer container;
-    for (const auto& pair : m_cvars) {
-      const auto& cvar = pair.second;
+      athena::io::FileWriter writer(partPath);
+      if (!writer.isOpen())
+        return;
+      container.write(writer);
+    } else {
+      /* Seed from the existing file so keys of unregistered CVars survive */
+      athena::io::FileReader r(m_path);
+      athena::io::YAMLDocWriter docWriter(r.isOpen() ? &r : nullptr);
+      r.close();
+
+      docWriter.setStyle(athena::io::YAMLNodeStyle::Block);
+      for (const auto& [name, value] : m_values)
+        docWriter.writeString(name.c_str(), value);
+
+      athena::io::FileWriter w(partPath);
+      if (!w.isOpen())
+        return;
+      docWriter.finish(&w);
+    }
+    if (hecl::Rename(partPath.c_str(), m_path.c_str()))
+      CVarLog.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to replace config '{}'")), m_path);
+  }
+};
 
-      if (cvar->isArchive() || (cvar->isInternalArchivable() && cvar->wasDeserialized() && !cvar->hasDefaultValue())) {
-        container.cvars.push_back(*cvar);
-      }
+/* Window in which further serialize() calls fold into the same write */
+constexpr std::chrono::milliseconds SaveDebounce{500};
+
+void CVarManager::serialize() {
+  auto snap = std::make_unique<ConfigSnapshot>();
+  snap->m_path = configPath();
+  snap->m_binary = m_useBinary;
+  for (const auto& pair : m_cvars) {
+    const auto& cvar = pair.second;
+
+    if (cvar->isArchive() || (cvar->isInternalArchivable() && cvar->wasDeserialized() && !cvar->hasDefaultValue())) {
+      snap->m_values.emplace_back(cvar->name(), cvar->value());
     }
-    container.cvarCount = atUint32(container.cvars.size());
+  }
 
-    filename += _SYS_STR(".bin");
-    athena::io::FileWriter writer(filename);
-    if (writer.isOpen())
-      container.write(writer);
+  /* Later deserialize() calls must see what is about to be written, not the file on disk */
+  if (snap->m_path == m_configIndexPath) {
+    for (const auto& [name, value] : snap->m_values)
+      m_configIndex.insert_or_assign(name, value);
   } else {
-    filename += _SYS_STR(".yaml");
+    m_configIndexPath.clear();
+  }
 
-    athena::io::FileReader r(filename);
-    athena::io::YAMLDocWriter docWriter(r.isOpen() ? &r : nullptr);
-    r.close();
+  std::unique_lock lk{m_saveMutex};
+  m_pendingSave = std::move(snap);
+  m_saveDeadline = std::chrono::steady_clock::now() + SaveDebounce;
+  if (!m_saveThread.joinable())
+    m_saveThread = std::thread(std::bind(&CVarManager::saveProc, this));
+  lk.unlock();
+  m_saveCv.notify_all();
+}
 
-    docWriter.setStyle(athena::io::YAMLNodeStyle::Block);
-    for (const auto& pair : m_cvars) {
-      const auto& cvar = pair.second;
+void CVarManager::flushSerialize() {
+  std::unique_lock lk{m_saveMutex};
+  m_saveDeadline = std::chrono::steady_clock::time_point::min();
+  m_saveCv.notify_all();
+  m_saveCv.wait(lk, [this]() { return !m_pendingSave && !m_saveBusy; });
+}
 
-      if (cvar->isArchive() || (cvar->isInternalArchivable() && cvar->wasDeserialized() && !cvar->hasDefaultValue())) {
-        docWriter.writeString(cvar->name().data(), cvar->toLiteral());
+void CVarManager::saveProc() {
+  logvisor::RegisterThreadName("CVar Save Thread");
+  std::unique_lock lk{m_saveMutex};
+  while (true) {
+    if (m_pendingSave) {
+      if (!m_saveQuit && std::chrono::steady_clock::now() < m_saveDeadline) {
+        m_saveCv.wait_until(lk, m_saveDeadline);
+        continue;
       }
+      std::unique_ptr<ConfigSnapshot> snap = std::move(m_pendingSave);
+      m_saveBusy = true;
+      lk.unlock();
+      snap->write();
+      lk.lock();
+      m_saveBusy = false;
+      m_saveCv.notify_all();
+      continue;
     }
-
-    athena::io::FileWriter w(filename);
-    if (w.isOpen())
-      docWriter.finish(&w);
+    if (m_saveQuit)
+      break;
+    m_saveCv.wait(lk);
   }
 }
 
@@ -1,12 +1,20 @@
 #include "hecl/ClientProcess.hpp"
 
 #include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstdlib>
+#include <optional>
+#include <vector>
 
+#include "hecl/AccessTrace.hpp"
 #include "hecl/Blender/Connection.hpp"
+#include "hecl/CpuTopology.hpp"
 #include "hecl/Database.hpp"
 #include "hecl/MultiProgressPrinter.hpp"
+#include "hecl/RemoteCookAgent.hpp"
+#include "hecl/Trace.hpp"
 
-#include <athena/FileReader.hpp>
 #include <boo/IApplication.hpp>
 #include <logvisor/logvisor.hpp>
 
@@ -14,7 +22,9 @@
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
 #else
+#include <fcntl.h>
 #include <sys/wait.h>
+#include <unistd.h>
 #endif
 
 #define HECL_MULTIPROCESSOR 1
@@ -25,6 +35,7 @@ static logvisor::Module CP_Log("hecl::ClientProcess");
 ThreadLocalPtr<ClientProcess::Worker> ClientProcess::ThreadWorker;
 
 int CpuCountOverride = 0;
+int IoThreadCountOverride = 0;
 
 void SetCpuCountOverride(int argc, const SystemChar** argv) {
   bool threadArg = false;
@@ -62,25 +73,190 @@ static int GetCPUCount() {
   return ret;
 }
 
-void ClientProcess::BufferTransaction::run(blender::Token& btok) {
-  athena::io::FileReader r(m_path.getAbsolutePath(), 32 * 1024, false);
-  if (r.hasError()) {
+static uint64_t GetPhysicalMemoryKb() {
+#if _WIN32
+  MEMORYSTATUSEX status = {};
+  status.dwLength = sizeof(status);
+  if (!GlobalMemoryStatusEx(&status))
+    return 0;
+  return status.ullTotalPhys / 1024;
+#else
+  const long pages = sysconf(_SC_PHYS_PAGES);
+  const long pageSize = sysconf(_SC_PAGE_SIZE);
+  if (pages <= 0 || pageSize <= 0)
+    return 0;
+  return uint64_t(pages) * uint64_t(pageSize) / 1024;
+#endif
+}
+
+static uint64_t GetDefaultMemoryBudgetKb() {
+#if _WIN32
+  const wchar_t* budget = _wgetenv(L"HECL_COOK_MEMORY_MB");
+#else
+  const char* budget = std::getenv("HECL_COOK_MEMORY_MB");
+#endif
+  if (budget)
+    return uint64_t(hecl::StrToUl(budget, nullptr, 0)) * 1024;
+  /* Leave headroom for this process, the OS and whatever else is running */
+  return GetPhysicalMemoryKb() / 4 * 3;
+}
+
+/* Runtimes capture their buffer requests for package ordering by setting HECL_ACCESS_TRACE=<file> */
+static bool StartDefaultAccessTrace() {
+#if _WIN32
+  const wchar_t* tracePath = _wgetenv(L"HECL_ACCESS_TRACE");
+#else
+  const char* tracePath = std::getenv("HECL_ACCESS_TRACE");
+#endif
+  if (!tracePath || !*tracePath || access::Active)
+    return false;
+  return access::Start(tracePath);
+}
+
+/* Expected Blender peak of cooks never measured, by cost class */
+constexpr uint64_t MediumCookMemoryKb = 512 * 1024;
+constexpr uint64_t HeavyCookMemoryKb = 2 * 1024 * 1024;
+
+static uint64_t GetCookMemoryKb(const ProjectPath& path, Database::Cost cost) {
+  if (const std::optional<uint64_t> history = path.getProject().getCookTimings().historicalMemoryKb(path))
+    return *history;
+  switch (cost) {
+  case Database::Cost::Heavy:
+    return HeavyCookMemoryKb;
+  case Database::Cost::Medium:
+    return MediumCookMemoryKb;
+  default:
+    return 0;
+  }
+}
+
+void ClientProcess::BufferTransaction::read() {
+  HECL_TRACE_SCOPE("buffer read", m_path.getRelativePathUTF8());
+  /* Positioned reads land directly in each segment's target with no intermediate buffer */
+#if _WIN32
+  HANDLE file = CreateFileW(m_path.getAbsolutePath().data(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+#else
+  int fd = ::open(m_path.getAbsolutePath().data(), O_RDONLY);
+  if (fd < 0) {
+#endif
     CP_Log.report(logvisor::Fatal, FMT_STRING(_SYS_STR("unable to background-buffer '{}'")), m_path.getAbsolutePath());
     return;
   }
-  if (m_offset)
-    r.seek(m_offset, athena::SeekOrigin::Begin);
-  r.readBytesToBuf(m_targetBuf, m_maxLen);
+
+  for (const BufferSegment& seg : m_segments) {
+    auto* target = static_cast<uint8_t*>(seg.m_target);
+    size_t done = 0;
+    while (done < seg.m_len) {
+      const uint64_t offset = uint64_t(seg.m_offset) + done;
+#if _WIN32
+      OVERLAPPED ov = {};
+      ov.Offset = DWORD(offset);
+      ov.OffsetHigh = DWORD(offset >> 32);
+      DWORD readSz = 0;
+      const DWORD request = DWORD(std::min(seg.m_len - done, size_t(0x40000000)));
+      if (!ReadFile(file, target + done, request, &readSz, &ov) || !readSz)
+        break;
+#else
+      const ssize_t readSz = pread(fd, target + done, seg.m_len - done, off_t(offset));
+      if (readSz < 0 && errno == EINTR)
+        continue;
+      if (readSz <= 0)
+        break;
+#endif
+      done += size_t(readSz);
+    }
+    m_readLen += done;
+    if (done < seg.m_len)
+      break;
+  }
+
+#if _WIN32
+  CloseHandle(file);
+#else
+  ::close(fd);
+#endif
   m_complete = true;
+  if (m_onComplete)
+    m_onComplete(*this);
+}
+
+void ClientProcess::CookTransaction::skipRedundantDraft() {
+  if (!m_fast || !m_parent.m_progressive || m_force)
+    return;
+  const Database::DataSpecEntry* specEnt = m_dataSpec->overrideDataSpec(m_path, m_dataSpec->getDataSpecEntry());
+  if (!specEnt)
+    return;
+  Database::CookCache& cache = m_path.getProject().getCookCache();
+  const Hash key = cache.computeKey(m_path, *m_dataSpec, *specEnt, false);
+  if (cache.isUpToDate(m_path, m_path.getCookedPath(*specEnt), key))
+    m_fast = false;
 }
 
 void ClientProcess::CookTransaction::run(blender::Token& btok) {
   m_dataSpec->setThreadProject();
+  skipRedundantDraft();
   m_returnResult = m_parent.syncCook(m_path, m_dataSpec, btok, m_force, m_fast);
-  std::unique_lock lk{m_parent.m_mutex};
-  ++m_parent.m_completedCooks;
-  m_parent.m_progPrinter->setMainFactor(m_parent.m_completedCooks / float(m_parent.m_addedCooks));
+  if (const blender::Connection* conn = btok.peekBlenderConnection()) {
+    if (const ProjectPath& blendPath = conn->getBlendPath()) {
+      std::unique_lock lk{m_parent.m_affinityMutex};
+      m_parent.m_blendAffinity[Hash(blendPath.getAbsolutePath()).val64()] = GetThreadWorkerIdx();
+    }
+  }
+  finish();
+}
+
+bool ClientProcess::CookTransaction::runRemote(RemoteCookAgent& agent) {
+  HECL_TRACE_SCOPE("runRemote", m_path.getRelativePathUTF8());
+  m_dataSpec->setThreadProject();
+  skipRedundantDraft();
+  const Database::DataSpecEntry* specEnt = m_dataSpec->overrideDataSpec(m_path, m_dataSpec->getDataSpecEntry());
+  if (!specEnt) {
+    finish();
+    return true;
+  }
+  ProjectPath cooked = m_path.getCookedPath(*specEnt);
+  if (m_fast)
+    cooked = cooked.getWithExtension(_SYS_STR(".fast"));
+  cooked.makeDirChain(false);
+
+  /* Remote artifacts only come back through the shared store */
+  Database::CookCache& cache = m_path.getProject().getCookCache();
+  if (!cache.hasRemoteStore())
+    return false;
+  const Hash key = cache.computeKey(m_path, *m_dataSpec, *specEnt, m_fast);
+  if (m_force || !cache.isUpToDate(m_path, cooked, key)) {
+    const SystemString str = m_path.getAuxInfo().empty()
+        ? fmt::format(FMT_STRING(_SYS_STR("Cooking {} on {}")), m_path.getRelativePath(), agent.name())
+        : fmt::format(FMT_STRING(_SYS_STR("Cooking {}|{} on {}")), m_path.getRelativePath(), m_path.getAuxInfo(),
+                      agent.name());
+    if (m_parent.m_progPrinter) {
+      m_parent.m_progPrinter->print(str.c_str(), nullptr, -1.f, -1);
+      m_parent.m_progPrinter->flush();
+    } else {
+      LogModule.report(logvisor::Info, FMT_STRING(_SYS_STR("{}")), str);
+    }
+    bool agentCooked;
+    {
+      HECL_TRACE_SCOPE("agent cook", m_path.getRelativePathUTF8());
+      agentCooked = agent.cook(m_path, *m_dataSpec->getDataSpecEntry(), m_fast, m_force);
+    }
+    if (!agentCooked || !cache.isUpToDate(m_path, cooked, key))
+      return false;
+  }
+  m_returnResult = true;
+  finish();
+  return true;
+}
+
+void ClientProcess::CookTransaction::finish() {
+  const int completed = ++m_parent.m_completedCooks;
+  if (m_parent.m_progPrinter)
+    m_parent.m_progPrinter->setMainFactor(completed / float(m_parent.m_addedCooks));
   m_complete = true;
+  if (m_onComplete)
+    m_onComplete();
 }
 
 void ClientProcess::LambdaTransaction::run(blender::Token& btok) {
@@ -88,6 +264,154 @@ void ClientProcess::LambdaTransaction::run(blender::Token& btok) {
   m_complete = true;
 }
 
+namespace {
+/**
+ * Recycles transaction allocations through per-thread free lists.
+ * Blocks released on a different thread than they were allocated on
+ * simply migrate to that thread's list. Transactions released during
+ * thread exit, after the list is gone, go straight to the heap.
+ */
+template <typename T>
+struct TransactionAllocator {
+  using value_type = T;
+  static constexpr size_t MaxPooled = 256;
+
+  struct FreeList {
+    /* Trivially destructible, so it stays readable after the list itself is destroyed */
+    static inline thread_local bool Destroyed = false;
+    std::vector<void*> m_blocks;
+    FreeList() { m_blocks.reserve(MaxPooled); }
+    ~FreeList() {
+      Destroyed = true;
+      for (void* block : m_blocks)
+        ::operator delete(block);
+    }
+  };
+  static FreeList* GetFreeList() {
+    if (FreeList::Destroyed)
+      return nullptr;
+    thread_local FreeList list;
+    return &list;
+  }
+
+  TransactionAllocator() noexcept = default;
+  template <typename U>
+  TransactionAllocator(const TransactionAllocator<U>&) noexcept {}
+
+  T* allocate(size_t n) {
+    if (n == 1) {
+      FreeList* list = GetFreeList();
+      if (list && !list->m_blocks.empty()) {
+        auto& blocks = list->m_blocks;
+        void* block = blocks.back();
+        blocks.pop_back();
+        return static_cast<T*>(block);
+      }
+    }
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T* p, size_t n) noexcept {
+    if (n == 1) {
+      FreeList* list = GetFreeList();
+      if (list && list->m_blocks.size() < MaxPooled) {
+        list->m_blocks.push_back(p);
+        return;
+      }
+    }
+    ::operator delete(p);
+  }
+
+  template <typename U>
+  bool operator==(const TransactionAllocator<U>&) const noexcept {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(const TransactionAllocator<U>&) const noexcept {
+    return false;
+  }
+};
+
+template <typename T, typename... Args>
+std::shared_ptr<T> MakeTransaction(Args&&... args) {
+  return std::allocate_shared<T>(TransactionAllocator<T>{}, std::forward<Args>(args)...);
+}
+
+/* Counters have a single writer, so a relaxed load and store replaces a locked read-modify-write */
+void Bump(std::atomic_uint64_t& counter, uint64_t value) {
+  counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+/* Uncontended acquisitions are not timed, keeping the clock off the fast path */
+std::unique_lock<std::mutex> LockCounted(std::mutex& mutex, std::atomic_uint64_t* waitNs) {
+  std::unique_lock lk{mutex, std::try_to_lock};
+  if (!lk.owns_lock()) {
+    const uint64_t start = trace::Now();
+    lk.lock();
+    if (waitNs)
+      Bump(*waitNs, trace::Now() - start);
+  }
+  return lk;
+}
+} // anonymous namespace
+
+void ClientProcess::WorkerStats::add(const WorkerStats& other) {
+  busyNs += other.busyNs;
+  idleNs += other.idleNs;
+  lockWaitNs += other.lockWaitNs;
+  queueWaitNs += other.queueWaitNs;
+  transactionsRun += other.transactionsRun;
+  for (size_t i = 0; i < LatencyBuckets; ++i)
+    queueLatency[i] += other.queueLatency[i];
+}
+
+ClientProcess::WorkerStats ClientProcess::WorkerStats::since(const WorkerStats& earlier) const {
+  WorkerStats ret = *this;
+  ret.busyNs -= earlier.busyNs;
+  ret.idleNs -= earlier.idleNs;
+  ret.lockWaitNs -= earlier.lockWaitNs;
+  ret.queueWaitNs -= earlier.queueWaitNs;
+  ret.transactionsRun -= earlier.transactionsRun;
+  for (size_t i = 0; i < LatencyBuckets; ++i)
+    ret.queueLatency[i] -= earlier.queueLatency[i];
+  return ret;
+}
+
+uint64_t ClientProcess::WorkerStats::queueLatencyQuantileUs(double q) const {
+  uint64_t total = 0;
+  for (uint64_t count : queueLatency)
+    total += count;
+  if (!total)
+    return 0;
+  const auto target = uint64_t(std::clamp(q, 0.0, 1.0) * double(total - 1));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < LatencyBuckets; ++i) {
+    seen += queueLatency[i];
+    if (seen > target)
+      return uint64_t(2) << i;
+  }
+  return uint64_t(2) << (LatencyBuckets - 1);
+}
+
+void ClientProcess::WorkerCounters::recordQueueWait(uint64_t ns) {
+  Bump(m_queueWaitNs, ns);
+  const uint64_t us = ns / 1000;
+  const size_t bucket = us ? std::min(size_t(std::bit_width(us)) - 1, WorkerStats::LatencyBuckets - 1) : 0;
+  Bump(m_queueLatency[bucket], 1);
+}
+
+ClientProcess::WorkerStats ClientProcess::WorkerCounters::snapshot() const {
+  WorkerStats ret;
+  ret.busyNs = m_busyNs.load(std::memory_order_relaxed);
+  ret.idleNs = m_idleNs.load(std::memory_order_relaxed);
+  ret.lockWaitNs = m_lockWaitNs.load(std::memory_order_relaxed);
+  ret.queueWaitNs = m_queueWaitNs.load(std::memory_order_relaxed);
+  ret.transactionsRun = m_transactionsRun.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < WorkerStats::LatencyBuckets; ++i)
+    ret.queueLatency[i] = m_queueLatency[i].load(std::memory_order_relaxed);
+  return ret;
+}
+
 ClientProcess::Worker::Worker(ClientProcess& proc, int idx) : m_proc(proc), m_idx(idx) {
   m_thr = std::thread(std::bind(&Worker::proc, this));
 }
@@ -97,79 +421,587 @@ void ClientProcess::Worker::proc() {
 
   std::string thrName = fmt::format(FMT_STRING("HECL Worker {}"), m_idx);
   logvisor::RegisterThreadName(thrName.c_str());
+  trace::SetThreadName(thrName);
 
-  std::unique_lock lk{m_proc.m_mutex};
+  /* Set before the first blender launch, which takes over this thread's placement */
+  if (WorkerAffinityMode != WorkerAffinity::None &&
+      !SetThreadAffinity(CpuTopology::Get().workerProcessors(WorkerAffinityMode, m_idx)))
+    CP_Log.report(logvisor::Warning, FMT_STRING("unable to set processor affinity of worker {}"), m_idx);
+
+  {
+    std::unique_lock lk{m_proc.m_mutex};
+    m_proc.m_initCv.notify_one();
+    m_didInit = true;
+  }
+
+  WorkerCounters& ctr = counters();
   while (m_proc.m_running) {
-    if (!m_didInit) {
-      m_proc.m_initCv.notify_one();
-      m_didInit = true;
-    }
-    while (m_proc.m_running && m_proc.m_pendingQueue.size()) {
-      std::shared_ptr<Transaction> trans = std::move(m_proc.m_pendingQueue.front());
-      ++m_proc.m_inProgress;
-      m_proc.m_pendingQueue.pop_front();
-      lk.unlock();
-      trans->run(m_blendTok);
-      lk.lock();
-      m_proc.m_completedQueue.push_back(std::move(trans));
+    const uint64_t wakeGeneration = m_proc.m_wakeGeneration.load();
+    if (std::shared_ptr<Transaction> trans = m_proc.dequeue(m_idx)) {
+      trace::Record("queued", trans->m_enqueueTime);
+      const uint64_t start = trace::Now();
+      ctr.recordQueueWait(start - trans->m_enqueueTime);
+      {
+        HECL_TRACE_SCOPE("transaction");
+        trans->run(m_blendTok);
+      }
+      Bump(ctr.m_busyNs, trace::Now() - start);
+      Bump(ctr.m_transactionsRun, 1);
+      releaseMemory(*trans);
+      {
+        auto lk = LockCounted(m_proc.m_completedMutex, &ctr.m_lockWaitNs);
+        m_proc.m_completedQueue.push_back(std::move(trans));
+      }
       --m_proc.m_inProgress;
+      continue;
     }
-    m_proc.m_waitCv.notify_one();
-    if (!m_proc.m_running)
-      break;
-    m_proc.m_cv.wait(lk);
+
+    /*
+     * Nothing to run or steal, or only cooks the memory budget can't fit yet; sleeping workers
+     * are counted so producers only lock to wake them
+     */
+    auto lk = LockCounted(m_proc.m_mutex, &ctr.m_lockWaitNs);
+    ++m_proc.m_sleepingWorkers;
+    if (m_proc.m_running && (m_proc.m_pendingCount.load() <= 0 ||
+                             (m_memoryBlocked && m_proc.m_wakeGeneration.load() == wakeGeneration))) {
+      m_proc.m_waitCv.notify_all();
+      HECL_TRACE_SCOPE("idle");
+      const uint64_t start = trace::Now();
+      m_proc.m_cv.wait(lk);
+      Bump(ctr.m_idleNs, trace::Now() - start);
+    }
+    --m_proc.m_sleepingWorkers;
   }
-  lk.unlock();
-  m_blendTok.shutdown();
+  m_blendTok.release();
+}
+
+bool ClientProcess::Worker::reserveMemory(const Transaction& trans) {
+  if (!trans.m_memoryKb)
+    return true;
+  const uint64_t budget = m_proc.m_memoryBudgetKb.load();
+  uint64_t inUse = m_proc.m_memoryInUseKb.load();
+  do {
+    /*
+     * A cook larger than the remaining budget still runs once no other reservation is held,
+     * so the pool always makes progress. Workers racing on an empty pool may overshoot once.
+     */
+    if (budget && m_proc.m_memoryReservations.load() > 0 && inUse - m_memoryKb + trans.m_memoryKb > budget)
+      return false;
+  } while (!m_proc.m_memoryInUseKb.compare_exchange_weak(inUse, inUse - m_memoryKb + trans.m_memoryKb));
+  m_memoryKb = trans.m_memoryKb;
+  m_memoryReserved = true;
+  ++m_proc.m_memoryReservations;
+  return true;
 }
 
-ClientProcess::ClientProcess(const MultiProgressPrinter* progPrinter) : m_progPrinter(progPrinter) {
+void ClientProcess::Worker::releaseMemory(const Transaction& trans) {
+  if (!m_memoryReserved && trans.m_type != Transaction::Type::Cook)
+    return;
+
+  /* An idle Blender keeps its last blend loaded; charge its resident size until the next cook */
+  uint64_t residentKb = 0;
+  if (const blender::Connection* conn = m_blendTok.peekBlenderConnection())
+    residentKb = conn->getMemoryKb();
+  m_proc.m_memoryInUseKb += residentKb;
+  m_proc.m_memoryInUseKb -= m_memoryKb;
+  m_memoryKb = residentKb;
+
+  if (!m_memoryReserved)
+    return;
+  m_memoryReserved = false;
+  --m_proc.m_memoryReservations;
+  ++m_proc.m_wakeGeneration;
+  std::unique_lock lk{m_proc.m_mutex};
+  m_proc.m_cv.notify_all();
+}
+
+ClientProcess::RemoteWorker::RemoteWorker(ClientProcess& proc, std::shared_ptr<RemoteCookAgent>&& agent, int idx)
+: m_proc(proc), m_agent(std::move(agent)), m_idx(idx) {
+  m_thr = std::thread(std::bind(&RemoteWorker::proc, this));
+}
+
+void ClientProcess::RemoteWorker::proc() {
+  std::string thrName = fmt::format(FMT_STRING("HECL Remote {}"), m_idx);
+  logvisor::RegisterThreadName(thrName.c_str());
+  trace::SetThreadName(thrName);
+
+  /* Agents that keep failing are most likely unreachable; stop offering them work */
+  constexpr int MaxConsecutiveFailures = 3;
+  int failures = 0;
+  while (m_proc.m_running) {
+    uint64_t generation;
+    {
+      std::unique_lock lk{m_proc.m_mutex};
+      generation = m_proc.m_remoteGeneration;
+    }
+
+    size_t level;
+    if (std::shared_ptr<CookTransaction> trans = m_proc.dequeueRemote(level)) {
+      trace::Record("queued", trans->m_enqueueTime);
+      if (trans->runRemote(*m_agent)) {
+        failures = 0;
+        {
+          std::unique_lock lk{m_proc.m_completedMutex};
+          m_proc.m_completedQueue.push_back(std::move(trans));
+        }
+        --m_proc.m_inProgress;
+        std::unique_lock lk{m_proc.m_mutex};
+        m_proc.m_waitCv.notify_all();
+      } else {
+        /* Requeued before leaving progress so waitUntilComplete never sees the pool idle */
+        trans->m_remoteFailed = true;
+        m_proc.enqueue(std::move(trans), level);
+        --m_proc.m_inProgress;
+        if (++failures == MaxConsecutiveFailures) {
+          CP_Log.report(logvisor::Warning, FMT_STRING(_SYS_STR("dropping cook agent '{}' after {} failed cooks")),
+                        m_agent->name(), failures);
+          break;
+        }
+      }
+      continue;
+    }
+
+    /* Producers bump the generation on every eligible enqueue, so no wakeup is lost */
+    std::unique_lock lk{m_proc.m_mutex};
+    m_proc.m_remoteCv.wait(lk, [&]() { return !m_proc.m_running || m_proc.m_remoteGeneration != generation; });
+  }
+  --m_proc.m_remoteWorkerCount;
+}
+
+void ClientProcess::enqueue(std::shared_ptr<Transaction>&& trans, size_t priority, int queueIdx) {
+  /* Workers keep their own follow-up work local; external producers distribute round-robin */
+  if (queueIdx < 0) {
+    Worker* w = ThreadWorker.get();
+    queueIdx = w && &w->m_proc == this ? w->m_idx : int(m_nextQueue++ % m_queueCount);
+  }
+  priority = std::min(priority, PriorityLevels - 1);
+  trans->m_enqueueTime = trace::Now();
+  const int pending = ++m_pendingCount;
+  int peak = m_peakPendingCount.load(std::memory_order_relaxed);
+  while (pending > peak && !m_peakPendingCount.compare_exchange_weak(peak, pending, std::memory_order_relaxed)) {}
+  ++m_levelCount[priority];
+  {
+    WorkQueue& queue = m_queues[queueIdx];
+    std::unique_lock lk{queue.m_mutex};
+    queue.m_queue[priority].push_back(std::move(trans));
+  }
+  ++m_wakeGeneration;
+  if (m_sleepingWorkers.load() > 0) {
+    std::unique_lock lk{m_mutex};
+    m_cv.notify_one();
+  }
+  if (m_remoteWorkerCount.load() > 0 && priority >= m_remoteMinLevel.load()) {
+    std::unique_lock lk{m_mutex};
+    ++m_remoteGeneration;
+    m_remoteCv.notify_all();
+  }
+}
+
+std::shared_ptr<ClientProcess::Transaction> ClientProcess::dequeue(int workerIdx) {
+  Worker* w = ThreadWorker.get();
+  if (w && &w->m_proc != this)
+    w = nullptr;
+  if (w)
+    w->m_memoryBlocked = false;
+
+  /* Expensive work anywhere in the pool runs before cheap work in the worker's own queue */
+  for (size_t level = PriorityLevels; level-- > 0;) {
+    if (m_levelCount[level].load() <= 0)
+      continue;
+    for (size_t i = 0; i < m_queueCount; ++i) {
+      WorkQueue& queue = m_queues[(workerIdx + i) % m_queueCount];
+      auto lk = LockCounted(queue.m_mutex, w ? &w->counters().m_lockWaitNs : nullptr);
+      auto& levelQueue = queue.m_queue[level];
+      /* Own work is taken newest first and stolen work oldest first, passing over cooks that don't fit */
+      const size_t count = levelQueue.size();
+      for (size_t j = 0; j < count; ++j) {
+        const size_t pos = i == 0 ? count - 1 - j : j;
+        if (w && !w->reserveMemory(*levelQueue[pos])) {
+          w->m_memoryBlocked = true;
+          continue;
+        }
+        std::shared_ptr<Transaction> trans = std::move(levelQueue[pos]);
+        levelQueue.erase(levelQueue.begin() + pos);
+        ++m_inProgress;
+        --m_levelCount[level];
+        --m_pendingCount;
+        return trans;
+      }
+    }
+  }
+  return {};
+}
+
+std::shared_ptr<ClientProcess::CookTransaction> ClientProcess::dequeueRemote(size_t& level) {
+  /* Like dequeue, but skipping everything an agent can't or shouldn't take */
+  const size_t minLevel = m_remoteMinLevel.load();
+  for (level = PriorityLevels; level-- > minLevel;) {
+    if (m_levelCount[level].load() <= 0)
+      continue;
+    for (size_t i = 0; i < m_queueCount; ++i) {
+      WorkQueue& queue = m_queues[i];
+      std::unique_lock lk{queue.m_mutex};
+      auto& levelQueue = queue.m_queue[level];
+      for (auto it = levelQueue.begin(); it != levelQueue.end(); ++it) {
+        if ((*it)->m_type != Transaction::Type::Cook)
+          continue;
+        auto trans = std::static_pointer_cast<CookTransaction>(*it);
+        if (trans->m_remoteFailed)
+          continue;
+        levelQueue.erase(it);
+        ++m_inProgress;
+        --m_levelCount[level];
+        --m_pendingCount;
+        return trans;
+      }
+    }
+  }
+  return {};
+}
+
+void ClientProcess::enqueueIO(const std::shared_ptr<BufferTransaction>& trans) {
+  if (trace::Active.load(std::memory_order_relaxed))
+    trans->m_enqueueTime = trace::Now();
+  /* Logged in request order; I/O threads may complete them in any order */
+  if (access::Active.load(std::memory_order_relaxed))
+    for (const BufferSegment& seg : trans->m_segments)
+      access::Record(trans->m_path, seg.m_offset, seg.m_len);
+  ++m_ioPending;
+  {
+    std::unique_lock lk{m_ioMutex};
+    m_ioQueue.push_back(trans);
+  }
+  m_ioCv.notify_one();
+}
+
+void ClientProcess::ioProc(int idx) {
+  std::string thrName = fmt::format(FMT_STRING("HECL I/O {}"), idx);
+  logvisor::RegisterThreadName(thrName.c_str());
+  trace::SetThreadName(thrName);
+  std::unique_lock lk{m_ioMutex};
+  while (m_running) {
+    if (m_ioQueue.empty()) {
+      m_ioCv.wait(lk);
+      continue;
+    }
+    std::shared_ptr<BufferTransaction> trans = std::move(m_ioQueue.front());
+    m_ioQueue.pop_front();
+    lk.unlock();
+    if (trans->m_enqueueTime)
+      trace::Record("queued", trans->m_enqueueTime);
+    trans->read();
+    {
+      std::unique_lock clk{m_completedMutex};
+      m_completedQueue.push_back(std::move(trans));
+    }
+    if (--m_ioPending == 0) {
+      std::unique_lock wlk{m_mutex};
+      m_waitCv.notify_all();
+    }
+    lk.lock();
+  }
+}
+
+ClientProcess::ClientProcess(const MultiProgressPrinter* progPrinter)
+: m_progPrinter(progPrinter)
+, m_memoryBudgetKb(GetDefaultMemoryBudgetKb())
+, m_remoteMinLevel(size_t(Database::Cost::Medium)) {
 #if HECL_MULTIPROCESSOR
   const int cpuCount = GetCPUCount();
 #else
   constexpr int cpuCount = 1;
 #endif
+  m_queueCount = cpuCount;
+  m_queues = std::make_unique<WorkQueue[]>(m_queueCount);
+  m_workerCounters = std::make_unique<WorkerCounters[]>(cpuCount);
   m_workers.reserve(cpuCount);
   for (int i = 0; i < cpuCount; ++i) {
     std::unique_lock lk{m_mutex};
     m_workers.emplace_back(*this, m_workers.size());
-    m_initCv.wait(lk);
+    m_initCv.wait(lk, [&]() { return m_workers.back().m_didInit; });
+  }
+  const int ioCount = IoThreadCountOverride > 0 ? IoThreadCountOverride : DefaultIoThreadCount;
+  m_ioThreads.reserve(ioCount);
+  for (int i = 0; i < ioCount; ++i)
+    m_ioThreads.emplace_back(&ClientProcess::ioProc, this, i);
+  m_ownsAccessTrace = StartDefaultAccessTrace();
+
+  if (m_progPrinter) {
+    /* Rates are over the interval since the previous summary; runs on the printer's log thread */
+    m_progPrinter->setSummary([this, last = totals(), lastNs = trace::Now()]() mutable {
+      const Totals now = totals();
+      const uint64_t nowNs = trace::Now();
+      const WorkerStats delta = now.since(last);
+      const double wallNs = double(nowNs - lastNs) * double(now.workers);
+      last = now;
+      lastNs = nowNs;
+      if (wallNs <= 0.0)
+        return hecl::SystemString();
+      const auto percent = [&](uint64_t ns) { return 100.0 * double(ns) / wallNs; };
+      return fmt::format(FMT_STRING(_SYS_STR("{} workers: {:.0f}% busy, {:.0f}% idle, {:.1f}% lock wait | "
+                                             "{} queued (peak {}) | {:.1f} txn/s | wait p50 {:.1f}ms p95 {:.1f}ms")),
+                         now.workers, percent(delta.busyNs), percent(delta.idleNs), percent(delta.lockWaitNs),
+                         std::max(m_pendingCount.load(), 0), now.peakPending,
+                         double(delta.transactionsRun) * 1e9 * double(now.workers) / wallNs,
+                         delta.queueLatencyQuantileUs(0.5) / 1000.0, delta.queueLatencyQuantileUs(0.95) / 1000.0);
+    });
   }
 }
 
+std::vector<ClientProcess::WorkerStats> ClientProcess::workerStats() const {
+  std::vector<WorkerStats> ret;
+  ret.reserve(m_workers.size());
+  for (size_t i = 0; i < m_workers.size(); ++i)
+    ret.push_back(m_workerCounters[i].snapshot());
+  return ret;
+}
+
+ClientProcess::Totals ClientProcess::totals() const {
+  Totals ret;
+  ret.workers = m_workers.size();
+  ret.peakPending = m_peakPendingCount.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < ret.workers; ++i)
+    ret.add(m_workerCounters[i].snapshot());
+  return ret;
+}
+
 std::shared_ptr<const ClientProcess::BufferTransaction> ClientProcess::addBufferTransaction(const ProjectPath& path,
                                                                                             void* target, size_t maxLen,
                                                                                             size_t offset) {
-  std::unique_lock lk{m_mutex};
-  auto ret = std::make_shared<BufferTransaction>(*this, path, target, maxLen, offset);
-  m_pendingQueue.emplace_back(ret);
-  m_cv.notify_one();
+  auto ret = MakeTransaction<BufferTransaction>(*this, path, target, maxLen, offset);
+  enqueueIO(ret);
+  return ret;
+}
+
+std::shared_ptr<const ClientProcess::BufferTransaction>
+ClientProcess::addBufferTransaction(const ProjectPath& path, std::vector<BufferSegment>&& segments,
+                                    std::function<void(const BufferTransaction&)>&& onComplete) {
+  auto ret = MakeTransaction<BufferTransaction>(*this, path, std::move(segments), std::move(onComplete));
+  enqueueIO(ret);
   return ret;
 }
 
 std::shared_ptr<const ClientProcess::CookTransaction> ClientProcess::addCookTransaction(const hecl::ProjectPath& path,
                                                                                         bool force, bool fast,
-                                                                                        Database::IDataSpec* spec) {
-  std::unique_lock lk{m_mutex};
-  auto ret = std::make_shared<CookTransaction>(*this, path, force, fast, spec);
-  m_pendingQueue.emplace_back(ret);
-  m_cv.notify_one();
-  ++m_addedCooks;
-  m_progPrinter->setMainFactor(m_completedCooks / float(m_addedCooks));
+                                                                                        Database::IDataSpec* spec,
+                                                                                        std::function<void()>&& onComplete) {
+  if (fast && m_progressive) {
+    /* Dependents proceed on the draft; the optimized cook waits for otherwise idle workers */
+    onComplete = [this, path, force, spec, onComplete = std::move(onComplete)]() {
+      const Database::DataSpecEntry* specEnt = spec->overrideDataSpec(path, spec->getDataSpecEntry());
+      if (specEnt) {
+        const ProjectPath cooked = path.getCookedPath(*specEnt);
+        Database::CookCache& cache = path.getProject().getCookCache();
+        const Hash key = cache.computeKey(path, *spec, *specEnt, false);
+        if (force || !cache.isUpToDate(path, cooked, key)) {
+          const ProjectPath draft = cooked.getWithExtension(_SYS_STR(".fast"));
+          if (draft.isFile() || path.getProject().getCookedStore().contains(draft))
+            cache.publishDraft(draft, cooked);
+          auto full = MakeTransaction<CookTransaction>(*this, path, force, false, spec, std::function<void()>{});
+          full->m_memoryKb = GetCookMemoryKb(path, spec->getCookCost(path));
+          const int added = ++m_addedCooks;
+          if (m_progPrinter)
+            m_progPrinter->setMainFactor(m_completedCooks / float(added));
+          enqueue(std::move(full), 0);
+        }
+      }
+      if (onComplete)
+        onComplete();
+    };
+  }
+  auto ret = MakeTransaction<CookTransaction>(*this, path, force, fast, spec, std::move(onComplete));
+  const int added = ++m_addedCooks;
+  if (m_progPrinter)
+    m_progPrinter->setMainFactor(m_completedCooks / float(added));
+  /* Route to the worker whose blender already has this file loaded to avoid a reload */
+  int affinity = -1;
+  {
+    std::unique_lock lk{m_affinityMutex};
+    auto search = m_blendAffinity.find(Hash(path.getAbsolutePath()).val64());
+    if (search != m_blendAffinity.end())
+      affinity = search->second;
+  }
+  /* Measured cook times from earlier runs beat the DataSpec's estimate */
+  const std::optional<Database::Cost> history = path.getProject().getCookTimings().historicalCost(path);
+  const Database::Cost cost = history ? *history : spec->getCookCost(path);
+  ret->m_memoryKb = GetCookMemoryKb(path, cost);
+  enqueue(ret, size_t(cost), affinity);
   return ret;
 }
 
 std::shared_ptr<const ClientProcess::LambdaTransaction>
 ClientProcess::addLambdaTransaction(std::function<void(blender::Token&)>&& func) {
-  std::unique_lock lk{m_mutex};
-  auto ret = std::make_shared<LambdaTransaction>(*this, std::move(func));
-  m_pendingQueue.emplace_back(ret);
-  m_cv.notify_one();
+  return addLambdaTransaction(std::move(func), Database::Cost::None);
+}
+
+std::shared_ptr<const ClientProcess::LambdaTransaction>
+ClientProcess::addLambdaTransaction(std::function<void(blender::Token&)>&& func, Database::Cost cost) {
+  auto ret = MakeTransaction<LambdaTransaction>(*this, std::move(func));
+  enqueue(ret, size_t(cost));
   return ret;
 }
 
+void ClientProcess::addRemoteAgent(std::shared_ptr<RemoteCookAgent> agent) {
+  std::unique_lock lk{m_mutex};
+  ++m_remoteWorkerCount;
+  m_remoteWorkers.emplace_back(*this, std::move(agent), int(m_remoteWorkers.size()));
+}
+
+namespace {
+/* Ranges shared between the caller of DistributeBlendWork and its helper transactions */
+struct BlendWorkState {
+  ProjectPath m_blendPath;
+  size_t m_count;
+  size_t m_grain;
+  const ClientProcess::BlendWorkFunc* m_func;
+  std::atomic_size_t m_next = 0;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  size_t m_activeHelpers = 0;
+  /* Ranges claimed by helpers whose connection couldn't load the blend */
+  std::vector<size_t> m_returned;
+
+  BlendWorkState(const ProjectPath& blendPath, size_t count, size_t grain, const ClientProcess::BlendWorkFunc& func)
+  : m_blendPath(blendPath), m_count(count), m_grain(grain), m_func(&func) {}
+
+  size_t claim() { return m_next.fetch_add(m_grain); }
+  void process(blender::DataStream& ds, size_t begin) const {
+    (*m_func)(ds, begin, std::min(begin + m_grain, m_count));
+  }
+
+  void runHelper(blender::Token& btok) {
+    /* The caller may only return once no helper can touch func, so register before claiming */
+    {
+      std::unique_lock lk{m_mutex};
+      ++m_activeHelpers;
+    }
+    size_t begin = claim();
+    if (begin < m_count) {
+      blender::Connection& conn = btok.getBlenderConnection();
+      if (conn.getBlendPath() == m_blendPath || conn.openBlend(m_blendPath)) {
+        blender::DataStream ds = conn.beginData();
+        for (; begin < m_count; begin = claim())
+          process(ds, begin);
+      } else {
+        CP_Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to open {} for distributed work")),
+                      m_blendPath.getAbsolutePath());
+        std::unique_lock lk{m_mutex};
+        m_returned.push_back(begin);
+      }
+    }
+    {
+      std::unique_lock lk{m_mutex};
+      --m_activeHelpers;
+    }
+    m_cv.notify_all();
+  }
+};
+
+/* Ranges shared between the caller of DistributeWork and its helper transactions */
+struct WorkState {
+  size_t m_count;
+  size_t m_grain;
+  const ClientProcess::WorkFunc* m_func;
+  std::atomic_size_t m_next = 0;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  size_t m_activeHelpers = 0;
+
+  WorkState(size_t count, size_t grain, const ClientProcess::WorkFunc& func)
+  : m_count(count), m_grain(grain), m_func(&func) {}
+
+  void drain() {
+    for (size_t begin; (begin = m_next.fetch_add(m_grain)) < m_count;)
+      (*m_func)(begin, std::min(begin + m_grain, m_count));
+  }
+
+  void runHelper() {
+    {
+      std::unique_lock lk{m_mutex};
+      ++m_activeHelpers;
+    }
+    drain();
+    {
+      std::unique_lock lk{m_mutex};
+      --m_activeHelpers;
+    }
+    m_cv.notify_all();
+  }
+};
+} // anonymous namespace
+
+void ClientProcess::DistributeBlendWork(blender::DataStream& ds, size_t count, size_t grain,
+                                        const BlendWorkFunc& func) {
+  if (!count)
+    return;
+  grain = std::max(grain, size_t(1));
+  const size_t rangeCount = (count + grain - 1) / grain;
+
+  /* Outside of a worker there is no pool to borrow connections from */
+  Worker* w = ThreadWorker.get();
+  if (!w || rangeCount == 1) {
+    for (size_t begin = 0; begin < count; begin += grain)
+      func(ds, begin, std::min(begin + grain, count));
+    return;
+  }
+
+  auto state = std::make_shared<BlendWorkState>(ds.getBlendPath(), count, grain, func);
+  ClientProcess& proc = w->m_proc;
+  const size_t helperCount = std::min(rangeCount, proc.m_workers.size()) - 1;
+  for (size_t i = 0; i < helperCount; ++i) {
+    auto helper = MakeTransaction<LambdaTransaction>(proc, [state](blender::Token& btok) { state->runHelper(btok); });
+    /* Each helper loads the same blend, so it is charged like the cook that loaded it here */
+    helper->m_memoryKb = w->m_memoryKb;
+    proc.enqueue(std::move(helper), PriorityLevels - 1);
+  }
+
+  for (size_t begin = state->claim(); begin < count; begin = state->claim())
+    state->process(ds, begin);
+
+  /* Helpers still queued find nothing left to claim and never touch func */
+  std::unique_lock lk{state->m_mutex};
+  for (;;) {
+    state->m_cv.wait(lk, [&]() { return state->m_activeHelpers == 0 || !state->m_returned.empty(); });
+    if (state->m_returned.empty())
+      break;
+    const size_t begin = state->m_returned.back();
+    state->m_returned.pop_back();
+    lk.unlock();
+    state->process(ds, begin);
+    lk.lock();
+  }
+}
+
+void ClientProcess::DistributeWork(size_t count, size_t grain, const WorkFunc& func) {
+  if (!count)
+    return;
+  grain = std::max(grain, size_t(1));
+  const size_t rangeCount = (count + grain - 1) / grain;
+
+  Worker* w = ThreadWorker.get();
+  if (!w || rangeCount == 1) {
+    for (size_t begin = 0; begin < count; begin += grain)
+      func(begin, std::min(begin + grain, count));
+    return;
+  }
+
+  auto state = std::make_shared<WorkState>(count, grain, func);
+  ClientProcess& proc = w->m_proc;
+  const size_t helperCount = std::min(rangeCount, proc.m_workers.size()) - 1;
+  for (size_t i = 0; i < helperCount; ++i)
+    proc.enqueue(MakeTransaction<LambdaTransaction>(proc, [state](blender::Token&) { state->runHelper(); }),
+                 PriorityLevels - 1);
+
+  state->drain();
+
+  /* Helpers still queued find nothing left to claim and never touch func */
+  std::unique_lock lk{state->m_mutex};
+  state->m_cv.wait(lk, [&]() { return state->m_activeHelpers == 0; });
+}
+
 bool ClientProcess::syncCook(const hecl::ProjectPath& path, Database::IDataSpec* spec, blender::Token& btok, bool force,
                              bool fast) {
+  HECL_TRACE_SCOPE("syncCook", path.getRelativePathUTF8());
   if (spec->canCook(path, btok)) {
     const Database::DataSpecEntry* specEnt = spec->overrideDataSpec(path, spec->getDataSpecEntry());
     if (specEnt) {
@@ -177,7 +1009,10 @@ bool ClientProcess::syncCook(const hecl::ProjectPath& path, Database::IDataSpec*
       if (fast)
         cooked = cooked.getWithExtension(_SYS_STR(".fast"));
       cooked.makeDirChain(false);
-      if (force || cooked.getPathType() == ProjectPath::Type::None || path.getModtime() > cooked.getModtime()) {
+      Database::CookCache& cache = path.getProject().getCookCache();
+      const Hash key = cache.computeKey(path, *spec, *specEnt, fast);
+      const Database::CookCache::KeyClaim claim(cache, key);
+      if (force || !cache.isUpToDate(path, cooked, key)) {
         if (m_progPrinter) {
           hecl::SystemString str;
           if (path.getAuxInfo().empty())
@@ -192,7 +1027,13 @@ bool ClientProcess::syncCook(const hecl::ProjectPath& path, Database::IDataSpec*
           else
             LogModule.report(logvisor::Info, FMT_STRING(_SYS_STR("Cooking {}|{}")), path.getRelativePath(), path.getAuxInfo());
         }
-        spec->doCook(path, cooked, false, btok, [](const SystemChar*) {});
+        {
+          HECL_TRACE_SCOPE("doCook", path.getRelativePathUTF8());
+          const Database::CookTimings::Timer timer(btok);
+          spec->doCook(path, Database::CookCache::StagingPath(cooked), false, btok, [](const SystemChar*) {});
+          path.getProject().getCookTimings().record(path, *specEnt, timer.finish());
+        }
+        cache.commitStaged(cooked, key);
         if (m_progPrinter) {
           hecl::SystemString str;
           if (path.getAuxInfo().empty())
@@ -210,7 +1051,7 @@ bool ClientProcess::syncCook(const hecl::ProjectPath& path, Database::IDataSpec*
 }
 
 void ClientProcess::swapCompletedQueue(std::list<std::shared_ptr<Transaction>>& queue) {
-  std::unique_lock lk{m_mutex};
+  std::unique_lock lk{m_completedMutex};
   queue.swap(m_completedQueue);
 }
 
@@ -223,14 +1064,42 @@ void ClientProcess::waitUntilComplete() {
 void ClientProcess::shutdown() {
   if (!m_running)
     return;
+  if (m_progPrinter)
+    m_progPrinter->setSummary({});
+  for (size_t i = 0; i < m_queueCount; ++i) {
+    WorkQueue& queue = m_queues[i];
+    std::unique_lock lk{queue.m_mutex};
+    for (size_t level = 0; level < PriorityLevels; ++level) {
+      m_pendingCount -= int(queue.m_queue[level].size());
+      m_levelCount[level] -= int(queue.m_queue[level].size());
+      queue.m_queue[level].clear();
+    }
+  }
+  {
+    std::unique_lock lk{m_ioMutex};
+    m_ioPending -= int(m_ioQueue.size());
+    m_ioQueue.clear();
+  }
   std::unique_lock lk{m_mutex};
-  m_pendingQueue.clear();
   m_running = false;
   m_cv.notify_all();
+  m_remoteCv.notify_all();
   lk.unlock();
+  {
+    std::unique_lock iolk{m_ioMutex};
+    m_ioCv.notify_all();
+  }
   for (Worker& worker : m_workers)
     if (worker.m_thr.joinable())
       worker.m_thr.join();
+  for (RemoteWorker& worker : m_remoteWorkers)
+    if (worker.m_thr.joinable())
+      worker.m_thr.join();
+  for (std::thread& thread : m_ioThreads)
+    if (thread.joinable())
+      thread.join();
+  if (m_ownsAccessTrace)
+    access::Stop();
 }
 
 } // namespace hecl
@@ -19,6 +19,7 @@ extern pD3DCompile D3DCompilePROC;
 #if __APPLE__
 #include <unistd.h>
 #include <memory>
+#include <mutex>
 #endif
 
 namespace hecl {
@@ -103,11 +104,13 @@ struct ShaderCompiler<PlatformType::D3D11> {
 #if __APPLE__
 template <>
 struct ShaderCompiler<PlatformType::Metal> {
-  static bool m_didCompilerSearch;
+  static std::once_flag m_compilerSearch;
   static bool m_hasCompiler;
+  /* Compiles may be issued from several threads; the forked toolchain inherits every open
+   * pipe and the temp metallib is named per process, so one compile runs at a time */
+  static std::mutex m_compileMutex;
 
   static bool SearchForCompiler() {
-    m_didCompilerSearch = true;
     const char* no_metal_compiler = getenv("HECL_NO_METAL_COMPILER");
     if (no_metal_compiler && atoi(no_metal_compiler))
       return false;
@@ -129,8 +132,7 @@ struct ShaderCompiler<PlatformType::Metal> {
 
   template <typename S>
   static std::pair<StageBinaryData, size_t> Compile(std::string_view text) {
-    if (!m_didCompilerSearch)
-      m_hasCompiler = SearchForCompiler();
+    std::call_once(m_compilerSearch, []() { m_hasCompiler = SearchForCompiler(); });
 
     std::string str =
         "#include <metal_stdlib>\n"
@@ -145,6 +147,7 @@ struct ShaderCompiler<PlatformType::Metal> {
       ret.second = str.size() + 2;
       memcpy(&ret.first.get()[1], str.data(), str.size() + 1);
     } else {
+      std::lock_guard lk{m_compileMutex};
       int compilerOut[2];
       int compilerIn[2];
       pipe(compilerOut);
@@ -248,8 +251,9 @@ struct ShaderCompiler<PlatformType::Metal> {
     return ret;
   }
 };
-bool ShaderCompiler<PlatformType::Metal>::m_didCompilerSearch = false;
+std::once_flag ShaderCompiler<PlatformType::Metal>::m_compilerSearch;
 bool ShaderCompiler<PlatformType::Metal>::m_hasCompiler = false;
+std::mutex ShaderCompiler<PlatformType::Metal>::m_compileMutex;
 #endif
 
 #if HECL_NOUVEAU_NX
@@ -5,6 +5,7 @@
 #include <string>
 #include <vector>
 
+#include "hecl/BufferPoolStats.hpp"
 #include "hecl/CVar.hpp"
 #include "hecl/CVarManager.hpp"
 #include "hecl/hecl.hpp"
@@ -30,6 +31,7 @@ Console::Console(CVarManager* cvarMgr) : m_cvarMgr(cvarMgr), m_overwrite(false),
   registerCommand(
       "getCVar", "Prints the value stored in the specified Console Variable", "<cvar>",
       [this](Console* console, const std::vector<std::string>& args) { m_cvarMgr->getCVar(console, args); });
+  RegisterBufferPoolCommands(*this);
   m_conSpeed = cvarMgr->findOrMakeCVar("con_speed",
                                        "Speed at which the console opens and closes, calculated as pixels per second",
                                        1.f, hecl::CVar::EFlags::System | hecl::CVar::EFlags::Archive);
@@ -174,13 +176,43 @@ bool Console::commandExists(std::string_view cmd) const {
   return m_commands.find(cmdName) != m_commands.end();
 }
 
-void Console::vreport(Level level, fmt::string_view fmt, fmt::format_args args) {
-  std::string tmp = fmt::vformat(fmt, args);
-  std::vector<std::string> lines = athena::utility::split(tmp, '\n');
-  for (std::string& line : lines) {
-    m_log.emplace_back(std::move(line), level);
+namespace {
+/* Invoke f on each newline-separated line of text without copying */
+template <typename F>
+void ForEachLine(std::string_view text, F&& f) {
+  while (!text.empty()) {
+    const size_t end = text.find('\n');
+    f(text.substr(0, end));
+    if (end == std::string_view::npos)
+      break;
+    text.remove_prefix(end + 1);
+  }
+}
+} // anonymous namespace
+
+void Console::LogRing::append(Level level, std::string_view a, std::string_view b, std::string_view c) {
+  const uint64_t idx = m_head.fetch_add(1, std::memory_order_relaxed);
+  Slot& slot = m_slots[idx % Capacity];
+  slot.m_seq.store(2 * idx + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  size_t len = 0;
+  for (std::string_view part : {a, b, c}) {
+    const size_t n = std::min(part.size(), LineLength - len);
+    std::copy_n(part.data(), n, slot.m_text + len);
+    len += n;
   }
-  fmt::print(FMT_STRING("{}\n"), tmp);
+  slot.m_level = level;
+  slot.m_len = uint32_t(len);
+  slot.m_seq.store(2 * (idx + 1), std::memory_order_release);
+}
+
+void Console::vreport(Level level, fmt::string_view fmt, fmt::format_args args) {
+  fmt::memory_buffer tmp;
+  fmt::vformat_to(tmp, fmt, args);
+  const std::string_view text(tmp.data(), tmp.size());
+  ForEachLine(text, [&](std::string_view line) { m_log.append(level, line); });
+  fmt::print(FMT_STRING("{}\n"), text);
 }
 
 void Console::init(boo::IWindow* window) {
@@ -383,60 +415,67 @@ void Console::handleSpecialKeyDown(boo::ESpecialKey sp, boo::EModifierKey mod, b
 
 void Console::handleSpecialKeyUp(boo::ESpecialKey /*sp*/, boo::EModifierKey /*mod*/) {}
 
+/* Formatting goes to stack buffers, so logging threads only allocate for unusually long messages */
 void Console::LogVisorAdapter::report(const char* modName, logvisor::Level severity,
                                       fmt::string_view format, fmt::format_args args) {
-  auto tmp = fmt::vformat(format, args);
-  std::vector<std::string> lines = athena::utility::split(tmp, '\n');
-  for (const std::string& line : lines) {
-    auto v = fmt::format(FMT_STRING("[{}] {}"), modName, line);
-    m_con->m_log.emplace_back(std::move(v), Console::Level(severity));
-  }
+  fmt::memory_buffer tmp;
+  fmt::vformat_to(tmp, format, args);
+  fmt::memory_buffer prefix;
+  fmt::format_to(prefix, FMT_STRING("[{}] "), modName);
+  ForEachLine(std::string_view(tmp.data(), tmp.size()), [&](std::string_view line) {
+    m_con->m_log.append(Console::Level(severity), std::string_view(prefix.data(), prefix.size()), line);
+  });
 }
 
 void Console::LogVisorAdapter::report(const char* modName, logvisor::Level severity,
                                       fmt::wstring_view format, fmt::wformat_args args) {
-  auto tmp = fmt::vformat(format, args);
-  std::vector<std::string> lines = athena::utility::split(athena::utility::wideToUtf8(tmp), '\n');
-  for (const std::string& line : lines) {
-    auto v = fmt::format(FMT_STRING("[{}] {}"), modName, line);
-    m_con->m_log.emplace_back(std::move(v), Console::Level(severity));
-  }
+  const std::string tmp = athena::utility::wideToUtf8(fmt::vformat(format, args));
+  fmt::memory_buffer prefix;
+  fmt::format_to(prefix, FMT_STRING("[{}] "), modName);
+  ForEachLine(tmp, [&](std::string_view line) {
+    m_con->m_log.append(Console::Level(severity), std::string_view(prefix.data(), prefix.size()), line);
+  });
 }
 
 void Console::LogVisorAdapter::reportSource(const char* modName, logvisor::Level severity, const char* file,
                                             unsigned linenum, fmt::string_view format, fmt::format_args args) {
-  auto tmp = fmt::vformat(format, args);
-  auto v = fmt::format(FMT_STRING("[{}] {} {}:{}"), modName, tmp, file, linenum);
-  m_con->m_log.emplace_back(std::move(v), Console::Level(severity));
+  fmt::memory_buffer tmp;
+  fmt::format_to(tmp, FMT_STRING("[{}] "), modName);
+  fmt::vformat_to(tmp, format, args);
+  fmt::format_to(tmp, FMT_STRING(" {}:{}"), file, linenum);
+  m_con->m_log.append(Console::Level(severity), std::string_view(tmp.data(), tmp.size()));
 }
 
 void Console::LogVisorAdapter::reportSource(const char* modName, logvisor::Level severity, const char* file,
                                             unsigned linenum, fmt::wstring_view format, fmt::wformat_args args) {
-  auto tmp = fmt::vformat(format, args);
-  std::vector<std::string> lines = athena::utility::split(athena::utility::wideToUtf8(tmp), '\n');
-  for (const std::string& line : lines) {
-    auto v = fmt::format(FMT_STRING("[{}] {} {}:{}"), modName, line, file, linenum);
-    m_con->m_log.emplace_back(std::move(v), Console::Level(severity));
-  }
+  const std::string tmp = athena::utility::wideToUtf8(fmt::vformat(format, args));
+  fmt::memory_buffer prefix;
+  fmt::format_to(prefix, FMT_STRING("[{}] "), modName);
+  fmt::memory_buffer suffix;
+  fmt::format_to(suffix, FMT_STRING(" {}:{}"), file, linenum);
+  ForEachLine(tmp, [&](std::string_view line) {
+    m_con->m_log.append(Console::Level(severity), std::string_view(prefix.data(), prefix.size()), line,
+                        std::string_view(suffix.data(), suffix.size()));
+  });
 }
 
 void Console::dumpLog() {
-  for (const auto& l : m_log) {
-    switch (l.second) {
+  m_log.forEach([](std::string_view line, Level level) {
+    switch (level) {
     case Level::Info:
-      fmt::print(FMT_STRING("{}\n"), l.first);
+      fmt::print(FMT_STRING("{}\n"), line);
       break;
     case Level::Warning:
-      fmt::print(FMT_STRING("[Warning] {}\n"), l.first);
+      fmt::print(FMT_STRING("[Warning] {}\n"), line);
       break;
     case Level::Error:
-      fmt::print(FMT_STRING("[ Error ] {}\n"), l.first);
+      fmt::print(FMT_STRING("[ Error ] {}\n"), line);
       break;
     case Level::Fatal:
-      fmt::print(FMT_STRING("[ Fatal ] {}\n"), l.first);
+      fmt::print(FMT_STRING("[ Fatal ] {}\n"), line);
       break;
     }
-  }
+  });
 }
 
 void Console::RegisterLogger(Console* con) { logvisor::MainLoggers.emplace_back(new LogVisorAdapter(con)); }
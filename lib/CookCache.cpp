@@ -0,0 +1,529 @@
+#include "hecl/CookCache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+
+#include "hecl/CookedStore.hpp"
+#include "hecl/Database.hpp"
+#include "hecl/RemoteCookStore.hpp"
+
+#include <logvisor/logvisor.hpp>
+
+#if _WIN32
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+namespace hecl::Database {
+
+static logvisor::Module Log("hecl::CookCache");
+
+constexpr uint32_t CookCacheMagic = 'HCKC';
+/* Version 2 records the digest algorithm; version 1 journals are XXH64 and still read */
+constexpr uint32_t CookCacheVersion = 2;
+
+/* Journal record types; later records supersede earlier ones with the same path hash */
+constexpr uint32_t RecordSource = 'SRCE';
+constexpr uint32_t RecordCooked = 'COOK';
+
+namespace {
+struct JournalHeader {
+  uint32_t magic;
+  uint32_t version;
+};
+
+/* Follows the header from version 2 on */
+struct JournalHeaderV2 {
+  HashAlgorithm hashAlgorithm;
+  uint32_t reserved;
+};
+
+struct JournalRecord {
+  uint32_t type;
+  uint32_t reserved;
+  uint64_t a;
+  uint64_t b;
+  uint64_t c;
+  uint64_t d;
+};
+
+constexpr size_t CopyChunkSize = 64 * 1024;
+
+uint64_t HashAbsPath(SystemStringView path) { return XXH64(path.data(), path.size() * sizeof(SystemChar), 0); }
+
+bool CopyFileContents(const SystemChar* from, const SystemString& to) {
+  auto in = hecl::FopenUnique(from, _SYS_STR("rb"));
+  if (!in)
+    return false;
+  const SystemString partPath = to + _SYS_STR(".part");
+  auto out = hecl::FopenUnique(partPath.c_str(), _SYS_STR("wb"));
+  if (!out)
+    return false;
+
+  auto buf = std::make_unique<uint8_t[]>(CopyChunkSize);
+  bool fail = false;
+  size_t readSz;
+  while ((readSz = std::fread(buf.get(), 1, CopyChunkSize, in.get()))) {
+    if (std::fwrite(buf.get(), 1, readSz, out.get()) != readSz) {
+      fail = true;
+      break;
+    }
+  }
+  out.reset();
+  if (fail) {
+    hecl::Unlink(partPath.c_str());
+    return false;
+  }
+  return hecl::Rename(partPath.c_str(), to.c_str()) == 0;
+}
+
+/* Object modtimes order collectGarbage's evictions, so reuse counts as a fresh write */
+void TouchFile(const SystemString& path) {
+#if _WIN32
+  _wutime(path.c_str(), nullptr);
+#else
+  utime(path.c_str(), nullptr);
+#endif
+}
+} // anonymous namespace
+
+CookCache::CookCache(const Project& project, CookedStore& store, ExtractDedup& dedup)
+: m_project(project), m_store(store), m_dedup(dedup), m_remote(DefaultRemoteCookStore()) {}
+
+CookCache::~CookCache() = default;
+
+void CookCache::setRemoteStore(std::shared_ptr<RemoteCookStore> remote) {
+  std::unique_lock lk{m_mutex};
+  m_remote = std::move(remote);
+}
+
+bool CookCache::hasRemoteStore() {
+  std::unique_lock lk{m_mutex};
+  return bool(m_remote);
+}
+
+void CookCache::_load() {
+  m_loaded = true;
+
+  const SystemString cacheRoot =
+      SystemString(m_project.getProjectRootPath().getAbsolutePath()) + _SYS_STR("/.hecl/cookcache");
+  hecl::MakeDir(cacheRoot.c_str());
+  m_objectsPath = cacheRoot + _SYS_STR("/objects");
+  hecl::MakeDir(m_objectsPath.c_str());
+  m_indexPath = cacheRoot + _SYS_STR("/index");
+
+  /* New caches use the fastest digest; existing ones keep theirs so their keys stay valid */
+  m_hashAlgorithm = Hash::Fastest;
+  bool upgrade = false;
+  if (auto fp = hecl::FopenUnique(m_indexPath.c_str(), _SYS_STR("rb"))) {
+    JournalHeader header;
+    JournalHeaderV2 headerV2{HashAlgorithm::XXH64, 0};
+    bool valid = std::fread(&header, 1, sizeof(header), fp.get()) == sizeof(header) &&
+                 header.magic == CookCacheMagic && (header.version == 1 || header.version == CookCacheVersion);
+    if (valid && header.version >= 2)
+      valid = std::fread(&headerV2, 1, sizeof(headerV2), fp.get()) == sizeof(headerV2) &&
+              Hash::IsAvailable(headerV2.hashAlgorithm);
+    if (valid) {
+      m_hashAlgorithm = headerV2.hashAlgorithm;
+      upgrade = header.version != CookCacheVersion;
+      JournalRecord rec;
+      while (std::fread(&rec, 1, sizeof(rec), fp.get()) == sizeof(rec)) {
+        ++m_journalRecords;
+        if (rec.type == RecordSource)
+          m_sources[rec.a] = SourceEntry{int64_t(rec.b), rec.c, rec.d};
+        else if (rec.type == RecordCooked)
+          m_cooked[rec.a] = rec.b;
+      }
+    }
+  }
+
+  /* Superseded records accumulate in the journal; rewrite once they dominate or the header is outdated */
+  if (upgrade || m_journalRecords == 0 || m_journalRecords > 2 * (m_sources.size() + m_cooked.size()) + 1024)
+    _compact();
+
+  m_journal = hecl::FopenUnique(m_indexPath.c_str(), _SYS_STR("ab"));
+  if (!m_journal)
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to open cook cache journal '{}'")), m_indexPath);
+}
+
+void CookCache::_compact() {
+  const SystemString partPath = m_indexPath + _SYS_STR(".part");
+  auto fp = hecl::FopenUnique(partPath.c_str(), _SYS_STR("wb"));
+  if (!fp) {
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to write cook cache journal '{}'")), partPath);
+    return;
+  }
+
+  const JournalHeader header{CookCacheMagic, CookCacheVersion};
+  std::fwrite(&header, 1, sizeof(header), fp.get());
+  const JournalHeaderV2 headerV2{m_hashAlgorithm, 0};
+  std::fwrite(&headerV2, 1, sizeof(headerV2), fp.get());
+  for (const auto& [pathHash, ent] : m_sources) {
+    const JournalRecord rec{RecordSource, 0, pathHash, uint64_t(ent.mtime), ent.size, ent.hash};
+    std::fwrite(&rec, 1, sizeof(rec), fp.get());
+  }
+  for (const auto& [pathHash, key] : m_cooked) {
+    const JournalRecord rec{RecordCooked, 0, pathHash, key, 0, 0};
+    std::fwrite(&rec, 1, sizeof(rec), fp.get());
+  }
+  fp.reset();
+
+  hecl::Rename(partPath.c_str(), m_indexPath.c_str());
+  m_journalRecords = m_sources.size() + m_cooked.size();
+}
+
+void CookCache::_appendRecord(uint32_t type, uint64_t a, uint64_t b, uint64_t c, uint64_t d) {
+  if (!m_journal)
+    return;
+  const JournalRecord rec{type, 0, a, b, c, d};
+  std::fwrite(&rec, 1, sizeof(rec), m_journal.get());
+  std::fflush(m_journal.get());
+  ++m_journalRecords;
+}
+
+uint64_t CookCache::_hashFile(const SystemString& absPath) {
+  Sstat theStat;
+  if (m_project.getStatCache().stat(absPath, &theStat) || !S_ISREG(theStat.st_mode))
+    return 0;
+
+  const uint64_t pathHash = HashAbsPath(absPath);
+  {
+    std::unique_lock lk{m_mutex};
+    if (!m_loaded)
+      _load();
+    auto search = m_sources.find(pathHash);
+    if (search != m_sources.end() && search->second.mtime == int64_t(theStat.st_mtime) &&
+        search->second.size == uint64_t(theStat.st_size))
+      return search->second.hash;
+  }
+
+  /* Stat information changed; digest contents outside the lock */
+  auto fp = hecl::FopenUnique(absPath.c_str(), _SYS_STR("rb"));
+  if (!fp)
+    return 0;
+  Hasher hasher(_getHashAlgorithm());
+  auto buf = std::make_unique<uint8_t[]>(CopyChunkSize);
+  size_t readSz;
+  while ((readSz = std::fread(buf.get(), 1, CopyChunkSize, fp.get())))
+    hasher.update(buf.get(), readSz);
+  const uint64_t contentHash = hasher.digest().val64();
+
+  std::unique_lock lk{m_mutex};
+  m_sources[pathHash] = SourceEntry{int64_t(theStat.st_mtime), uint64_t(theStat.st_size), contentHash};
+  _appendRecord(RecordSource, pathHash, uint64_t(theStat.st_mtime), uint64_t(theStat.st_size), contentHash);
+  return contentHash;
+}
+
+HashAlgorithm CookCache::_getHashAlgorithm() {
+  std::unique_lock lk{m_mutex};
+  if (!m_loaded)
+    _load();
+  return m_hashAlgorithm;
+}
+
+uint64_t CookCache::_hashSource(const ProjectPath& path) {
+  Hasher hasher(_getHashAlgorithm());
+  const auto addFile = [&](const SystemString& absPath, SystemStringView name) {
+    const uint64_t fileHash = _hashFile(absPath);
+    hasher.update(name.data(), name.size() * sizeof(SystemChar));
+    hasher.update(&fileHash, sizeof(fileHash));
+  };
+
+  switch (path.getPathType()) {
+  case ProjectPath::Type::File:
+    return _hashFile(SystemString(path.getAbsolutePath()));
+  case ProjectPath::Type::Glob: {
+    std::vector<ProjectPath> globResults;
+    path.getGlobResults(globResults);
+    for (const ProjectPath& result : globResults)
+      if (result.isFile())
+        addFile(SystemString(result.getAbsolutePath()), result.getRelativePath());
+    break;
+  }
+  case ProjectPath::Type::Directory: {
+    /* AudioGroup and similar directory-backed resources */
+    hecl::DirectoryEnumerator de(path.getAbsolutePath(), hecl::DirectoryEnumerator::Mode::FilesSorted, false, false,
+                                 true, &m_project.getStatCache());
+    for (const hecl::DirectoryEnumerator::Entry& ent : de)
+      addFile(ent.m_path, ent.m_name);
+    break;
+  }
+  default:
+    return 0;
+  }
+  return hasher.digest().val64();
+}
+
+SystemString CookCache::_objectPath(uint64_t key) const {
+  return m_objectsPath + fmt::format(FMT_STRING(_SYS_STR("/{:016X}")), key);
+}
+
+bool CookCache::_fetchRemote(const ProjectPath& cooked, uint64_t key) {
+  std::shared_ptr<RemoteCookStore> remote;
+  SystemString objPath;
+  {
+    std::unique_lock lk{m_mutex};
+    if (!m_remote)
+      return false;
+    remote = m_remote;
+    objPath = _objectPath(key);
+  }
+
+  const SystemString cookedPath(cooked.getAbsolutePath());
+  cooked.makeDirChain(false);
+  if (!remote->fetch(key, cookedPath))
+    return false;
+
+  /* Keep a local copy so later revision switches don't go back to the network */
+  Sstat theStat;
+  if (hecl::Stat(objPath.c_str(), &theStat))
+    CopyFileContents(cookedPath.c_str(), objPath);
+  if (m_store.isEnabled())
+    m_store.put(cooked, cookedPath);
+
+  const uint64_t cookedHash = HashAbsPath(cookedPath);
+  std::unique_lock lk{m_mutex};
+  m_cooked[cookedHash] = key;
+  _appendRecord(RecordCooked, cookedHash, key, 0, 0);
+  return true;
+}
+
+void CookCache::_publishHit(const ProjectPath& cooked, uint64_t key) {
+  std::shared_ptr<RemoteCookStore> remote;
+  {
+    std::unique_lock lk{m_mutex};
+    if (!m_publishHits)
+      return;
+    remote = m_remote;
+  }
+  if (!remote)
+    return;
+  /* Artifacts held by the cooked store are published from their cache object */
+  if (cooked.isFile())
+    remote->store(key, SystemString(cooked.getAbsolutePath()));
+  else
+    remote->store(key, _objectPath(key));
+}
+
+bool CookCache::_place(const ProjectPath& cooked, const SystemString& file) {
+  if (m_store.isEnabled())
+    return m_store.put(cooked, file);
+  return CopyFileContents(file.c_str(), SystemString(cooked.getAbsolutePath()));
+}
+
+Hash CookCache::computeKey(const ProjectPath& path, IDataSpec& spec, const DataSpecEntry& specEntry, bool fast) {
+  Hasher hasher(_getHashAlgorithm());
+
+  const uint64_t sourceHash = _hashSource(path);
+  hasher.update(&sourceHash, sizeof(sourceHash));
+  /* Cooks may embed names derived from the path, so identical sources elsewhere never share an artifact,
+   * except extracted duplicates, which stand for their canonical copy and cook once under its path.
+   * UTF-8 keeps keys of one project equal across platforms for the remote store. */
+  const ProjectPath canonical = m_dedup.getCanonicalPath(path);
+  const std::string_view relPath = canonical.getRelativePathUTF8();
+  hasher.update(relPath.data(), relPath.size());
+  const SystemStringView auxInfo = path.getAuxInfo();
+  hasher.update(auxInfo.data(), auxInfo.size() * sizeof(SystemChar));
+  hasher.update(specEntry.m_name.data(), specEntry.m_name.size() * sizeof(SystemChar));
+  const uint8_t fastByte = fast;
+  hasher.update(&fastByte, sizeof(fastByte));
+
+  std::vector<ProjectPath> deps;
+  spec.getCookDependencies(path, deps);
+  for (const ProjectPath& dep : deps) {
+    const uint64_t depHash = _hashSource(dep);
+    hasher.update(&depHash, sizeof(depHash));
+  }
+
+  /* Mixed in only when set so existing caches stay valid for unversioned specs */
+  if (const uint32_t cookVersion = spec.getCookVersion())
+    hasher.update(&cookVersion, sizeof(cookVersion));
+
+  return hasher.digest();
+}
+
+CookCache::KeyClaim::KeyClaim(CookCache& cache, const Hash& key) : m_cache(cache), m_key(key.val64()) {
+  std::unique_lock lk{m_cache.m_mutex};
+  m_cache.m_claimCv.wait(lk, [&]() { return m_cache.m_claimedKeys.count(m_key) == 0; });
+  m_cache.m_claimedKeys.insert(m_key);
+}
+
+CookCache::KeyClaim::~KeyClaim() {
+  {
+    std::unique_lock lk{m_cache.m_mutex};
+    m_cache.m_claimedKeys.erase(m_key);
+  }
+  m_cache.m_claimCv.notify_all();
+}
+
+bool CookCache::isUpToDate(const ProjectPath& path, const ProjectPath& cooked, const Hash& key) {
+  const uint64_t cookedHash = HashAbsPath(cooked.getAbsolutePath());
+  const bool looseExists = cooked.isFile();
+  const bool cookedExists = looseExists || m_store.contains(cooked);
+
+  std::unique_lock lk{m_mutex};
+  if (!m_loaded)
+    _load();
+
+  auto search = m_cooked.find(cookedHash);
+  if (search == m_cooked.end()) {
+    /* Artifacts cooked before the cache existed are adopted if modtimes still agree */
+    if (looseExists && path.getModtime() <= cooked.getModtime()) {
+      lk.unlock();
+      commit(cooked, key);
+      return true;
+    }
+  } else if (search->second == key.val64() && cookedExists) {
+    lk.unlock();
+    _publishHit(cooked, key.val64());
+    return true;
+  }
+
+  /* Restore a previously cooked artifact with a matching key, which may belong to an identical source */
+  const SystemString objPath = _objectPath(key.val64());
+  lk.unlock();
+  if (!_place(cooked, objPath))
+    return _fetchRemote(cooked, key.val64());
+  TouchFile(objPath);
+
+  lk.lock();
+  m_cooked[cookedHash] = key.val64();
+  _appendRecord(RecordCooked, cookedHash, key.val64(), 0, 0);
+  lk.unlock();
+  _publishHit(cooked, key.val64());
+  return true;
+}
+
+void CookCache::commit(const ProjectPath& cooked, const Hash& key) {
+  if (!cooked.isFile())
+    return;
+  _commitFile(cooked, SystemString(cooked.getAbsolutePath()), key);
+  /* Adopted loose artifacts move into the store like fresh cooks */
+  if (m_store.isEnabled())
+    m_store.put(cooked, SystemString(cooked.getAbsolutePath()));
+}
+
+void CookCache::_commitFile(const ProjectPath& cooked, const SystemString& file, const Hash& key) {
+  const uint64_t cookedHash = HashAbsPath(cooked.getAbsolutePath());
+  std::unique_lock lk{m_mutex};
+  if (!m_loaded)
+    _load();
+  const SystemString objPath = _objectPath(key.val64());
+  const std::shared_ptr<RemoteCookStore> remote = m_remote;
+  lk.unlock();
+
+  Sstat theStat;
+  if (!hecl::Stat(objPath.c_str(), &theStat))
+    TouchFile(objPath);
+  else if (!CopyFileContents(file.c_str(), objPath))
+    Log.report(logvisor::Warning, FMT_STRING(_SYS_STR("unable to store '{}' in cook cache")),
+               cooked.getRelativePath());
+  if (remote)
+    remote->store(key.val64(), file);
+
+  lk.lock();
+  m_cooked[cookedHash] = key.val64();
+  _appendRecord(RecordCooked, cookedHash, key.val64(), 0, 0);
+}
+
+CookCache::GarbageStats CookCache::collectGarbage(uint64_t maxBytes) {
+  std::unordered_set<SystemString> live;
+  SystemString objectsPath;
+  {
+    std::unique_lock lk{m_mutex};
+    if (!m_loaded)
+      _load();
+    live.reserve(m_cooked.size());
+    for (const auto& [cookedHash, key] : m_cooked)
+      if (key)
+        live.insert(fmt::format(FMT_STRING(_SYS_STR("{:016X}")), key));
+    objectsPath = m_objectsPath;
+  }
+
+  struct Object {
+    SystemString path;
+    uint64_t size;
+    int64_t mtime;
+  };
+  std::vector<Object> unused;
+  GarbageStats ret;
+  uint64_t totalBytes = 0;
+  /* Other names are partial copies still being written */
+  constexpr size_t ObjectNameLength = 16;
+  const hecl::DirectoryEnumerator de(objectsPath, hecl::DirectoryEnumerator::Mode::FilesSorted);
+  for (const hecl::DirectoryEnumerator::Entry& ent : de) {
+    if (ent.m_name.size() != ObjectNameLength)
+      continue;
+    totalBytes += ent.m_fileSz;
+    if (live.count(ent.m_name)) {
+      ++ret.m_kept;
+      ret.m_keptBytes += ent.m_fileSz;
+      continue;
+    }
+    Sstat theStat;
+    if (!hecl::Stat(ent.m_path.c_str(), &theStat))
+      unused.push_back(Object{ent.m_path, ent.m_fileSz, int64_t(theStat.st_mtime)});
+  }
+
+  std::sort(unused.begin(), unused.end(), [](const Object& a, const Object& b) { return a.mtime < b.mtime; });
+  for (const Object& obj : unused) {
+    if (totalBytes <= maxBytes || hecl::Unlink(obj.path.c_str())) {
+      ++ret.m_kept;
+      ret.m_keptBytes += obj.size;
+      continue;
+    }
+    totalBytes -= obj.size;
+    ++ret.m_removed;
+    ret.m_removedBytes += obj.size;
+  }
+  return ret;
+}
+
+ProjectPath CookCache::StagingPath(const ProjectPath& cooked) { return cooked.getWithExtension(_SYS_STR(".cooking")); }
+
+void CookCache::commitStaged(const ProjectPath& cooked, const Hash& key) {
+  const ProjectPath staged = StagingPath(cooked);
+  /* A failed or empty cook leaves any previous artifact in place, and unrecorded under this key */
+  if (!staged.isFile())
+    return;
+  if (m_store.isEnabled()) {
+    const SystemString stagedPath(staged.getAbsolutePath());
+    _commitFile(cooked, stagedPath, key);
+    if (!m_store.put(cooked, stagedPath))
+      Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to add cooked '{}' to cooked store")),
+                 cooked.getRelativePath());
+    hecl::Unlink(stagedPath.c_str());
+    return;
+  }
+  if (hecl::Rename(staged.getAbsolutePath().data(), cooked.getAbsolutePath().data())) {
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to move cooked '{}' into place")),
+               cooked.getRelativePath());
+    hecl::Unlink(staged.getAbsolutePath().data());
+    return;
+  }
+  commit(cooked, key);
+}
+
+bool CookCache::publishDraft(const ProjectPath& draft, const ProjectPath& cooked) {
+  /* With the store enabled, the draft's own commit moved it into the pack */
+  if (m_store.contains(draft)) {
+    const CookedStore::View view = m_store.read(draft);
+    if (!view || !m_store.put(cooked, view.m_data, view.m_size))
+      return false;
+  } else if (!_place(cooked, SystemString(draft.getAbsolutePath()))) {
+    return false;
+  }
+
+  /* Keys are digests; a zero key stands in for "no cook" */
+  const uint64_t cookedHash = HashAbsPath(cooked.getAbsolutePath());
+  std::unique_lock lk{m_mutex};
+  if (!m_loaded)
+    _load();
+  m_cooked[cookedHash] = 0;
+  _appendRecord(RecordCooked, cookedHash, 0, 0, 0);
+  return true;
+}
+
+} // namespace hecl::Database
@@ -0,0 +1,246 @@
+#include "hecl/CookTimings.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#include "hecl/Blender/Connection.hpp"
+#include "hecl/Blender/Token.hpp"
+#include "hecl/Database.hpp"
+
+#include <logvisor/logvisor.hpp>
+
+#if _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace hecl::Database {
+
+static logvisor::Module Log("hecl::CookTimings");
+
+constexpr uint32_t CookTimingsMagic = 'HCKT';
+constexpr uint32_t CookTimingsVersion = 1;
+
+namespace {
+struct JournalHeader {
+  uint32_t magic;
+  uint32_t version;
+};
+
+/* Followed by pathLen bytes of path and specLen bytes of DataSpec name */
+struct JournalRecord {
+  uint64_t pathHash;
+  uint32_t run;
+  uint16_t pathLen;
+  uint16_t specLen;
+  uint64_t wallNs;
+  uint64_t blenderNs;
+  uint64_t peakRssKb;
+};
+
+uint64_t NowNs() {
+  return uint64_t(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+std::string PathKey(const ProjectPath& path) {
+  if (path.getAuxInfo().empty())
+    return std::string(path.getRelativePathUTF8());
+  return std::string(path.getRelativePathUTF8()) + '|' + std::string(path.getAuxInfoUTF8());
+}
+} // anonymous namespace
+
+CookTimings::Timer::Timer(blender::Token& btok)
+: m_btok(btok), m_conn(btok.peekBlenderConnection()), m_begin(NowNs()), m_beginWaitNs(0) {
+  if (blender::Connection* conn = btok.peekBlenderConnection()) {
+    m_beginWaitNs = conn->getBlenderWaitNs();
+    conn->resetPeakMemory();
+  }
+}
+
+CookTimings::Sample CookTimings::Timer::finish() const {
+  Sample ret;
+  ret.m_wallNs = NowNs() - m_begin;
+  if (const blender::Connection* conn = m_btok.peekBlenderConnection()) {
+    /* A connection started during the cook has only ever waited on this cook */
+    ret.m_blenderNs = conn->getBlenderWaitNs() - (conn == m_conn ? m_beginWaitNs : 0);
+    ret.m_peakRssKb = conn->getPeakMemoryKb();
+  }
+  if (!ret.m_peakRssKb)
+    ret.m_peakRssKb = ProcessPeakRssKb();
+  return ret;
+}
+
+CookTimings::CookTimings(const Project& project) : m_project(project) {}
+
+uint64_t CookTimings::ProcessPeakRssKb() {
+#if _WIN32
+  PROCESS_MEMORY_COUNTERS pmc = {};
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+    return 0;
+  return uint64_t(pmc.PeakWorkingSetSize) / 1024;
+#else
+  rusage usage = {};
+  if (getrusage(RUSAGE_SELF, &usage))
+    return 0;
+#if __APPLE__
+  return uint64_t(usage.ru_maxrss) / 1024;
+#else
+  return uint64_t(usage.ru_maxrss);
+#endif
+#endif
+}
+
+void CookTimings::_addSample(Entry& ent, const Sample& sample) {
+  /* Several cooks of one path in a run (e.g. watch mode) keep comparing against the prior run */
+  if (ent.m_last.m_run != sample.m_run)
+    ent.m_previous = ent.m_last;
+  ent.m_last = sample;
+}
+
+void CookTimings::_load() {
+  m_loaded = true;
+  m_journalPath = SystemString(m_project.getProjectRootPath().getAbsolutePath()) + _SYS_STR("/.hecl/cooktimes");
+
+  uint32_t maxRun = 0;
+  if (auto fp = hecl::FopenUnique(m_journalPath.c_str(), _SYS_STR("rb"))) {
+    JournalHeader header;
+    if (std::fread(&header, 1, sizeof(header), fp.get()) == sizeof(header) && header.magic == CookTimingsMagic &&
+        header.version == CookTimingsVersion) {
+      JournalRecord rec;
+      std::string path;
+      std::string spec;
+      while (std::fread(&rec, 1, sizeof(rec), fp.get()) == sizeof(rec)) {
+        path.resize(rec.pathLen);
+        spec.resize(rec.specLen);
+        if (std::fread(path.data(), 1, rec.pathLen, fp.get()) != rec.pathLen ||
+            std::fread(spec.data(), 1, rec.specLen, fp.get()) != rec.specLen)
+          break;
+        ++m_journalRecords;
+        Entry& ent = m_entries[rec.pathHash];
+        ent.m_path = path;
+        ent.m_spec = spec;
+        _addSample(ent, Sample{rec.run, rec.wallNs, rec.blenderNs, rec.peakRssKb});
+        maxRun = std::max(maxRun, rec.run);
+      }
+    }
+  }
+  m_run = maxRun + 1;
+
+  /* Only two samples per path are used; rewrite once superseded records dominate */
+  if (m_journalRecords == 0 || m_journalRecords > 4 * m_entries.size() + 1024)
+    _compact();
+
+  m_journal = hecl::FopenUnique(m_journalPath.c_str(), _SYS_STR("ab"));
+  if (!m_journal)
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to open cook timing journal '{}'")), m_journalPath);
+}
+
+void CookTimings::_append(FILE* fp, const Entry& ent, const Sample& sample) {
+  const JournalRecord rec{XXH64(ent.m_path.data(), ent.m_path.size(), 0),
+                          sample.m_run,
+                          uint16_t(ent.m_path.size()),
+                          uint16_t(ent.m_spec.size()),
+                          sample.m_wallNs,
+                          sample.m_blenderNs,
+                          sample.m_peakRssKb};
+  std::fwrite(&rec, 1, sizeof(rec), fp);
+  std::fwrite(ent.m_path.data(), 1, ent.m_path.size(), fp);
+  std::fwrite(ent.m_spec.data(), 1, ent.m_spec.size(), fp);
+}
+
+void CookTimings::_compact() {
+  const SystemString partPath = m_journalPath + _SYS_STR(".part");
+  auto fp = hecl::FopenUnique(partPath.c_str(), _SYS_STR("wb"));
+  if (!fp) {
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to write cook timing journal '{}'")), partPath);
+    return;
+  }
+
+  const JournalHeader header{CookTimingsMagic, CookTimingsVersion};
+  std::fwrite(&header, 1, sizeof(header), fp.get());
+  m_journalRecords = 0;
+  for (const auto& [pathHash, ent] : m_entries) {
+    if (ent.m_previous.m_run) {
+      _append(fp.get(), ent, ent.m_previous);
+      ++m_journalRecords;
+    }
+    _append(fp.get(), ent, ent.m_last);
+    ++m_journalRecords;
+  }
+  fp.reset();
+
+  hecl::Rename(partPath.c_str(), m_journalPath.c_str());
+}
+
+void CookTimings::record(const ProjectPath& path, const DataSpecEntry& spec, Sample sample) {
+  std::string key = PathKey(path);
+  if (key.size() > UINT16_MAX)
+    return;
+  const uint64_t pathHash = XXH64(key.data(), key.size(), 0);
+
+  std::unique_lock lk{m_mutex};
+  if (!m_loaded)
+    _load();
+  sample.m_run = m_run;
+  Entry& ent = m_entries[pathHash];
+  ent.m_path = std::move(key);
+  ent.m_spec = std::string(SystemUTF8Conv(spec.m_name).str());
+  _addSample(ent, sample);
+  if (m_journal) {
+    _append(m_journal.get(), ent, sample);
+    std::fflush(m_journal.get());
+    ++m_journalRecords;
+  }
+}
+
+std::optional<Cost> CookTimings::historicalCost(const ProjectPath& path) {
+  const std::string key = PathKey(path);
+  const uint64_t pathHash = XXH64(key.data(), key.size(), 0);
+
+  std::unique_lock lk{m_mutex};
+  if (!m_loaded)
+    _load();
+  auto search = m_entries.find(pathHash);
+  if (search == m_entries.end())
+    return std::nullopt;
+  const uint64_t wallMs = search->second.m_last.m_wallNs / 1000000;
+  if (wallMs < 100)
+    return Cost::Light;
+  if (wallMs < 2000)
+    return Cost::Medium;
+  return Cost::Heavy;
+}
+
+std::optional<uint64_t> CookTimings::historicalMemoryKb(const ProjectPath& path) {
+  const std::string key = PathKey(path);
+  const uint64_t pathHash = XXH64(key.data(), key.size(), 0);
+
+  std::unique_lock lk{m_mutex};
+  if (!m_loaded)
+    _load();
+  auto search = m_entries.find(pathHash);
+  if (search == m_entries.end())
+    return std::nullopt;
+  /* Without Blender the sample holds this process's peak, which says nothing about the cook */
+  const Sample& last = search->second.m_last;
+  return last.m_blenderNs ? last.m_peakRssKb : 0;
+}
+
+std::vector<CookTimings::Entry> CookTimings::snapshot() {
+  std::unique_lock lk{m_mutex};
+  if (!m_loaded)
+    _load();
+  std::vector<Entry> ret;
+  ret.reserve(m_entries.size());
+  for (const auto& [pathHash, ent] : m_entries)
+    ret.push_back(ent);
+  return ret;
+}
+
+} // namespace hecl::Database
@@ -0,0 +1,525 @@
+#include "hecl/CookedStore.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "hecl/Database.hpp"
+
+#include <logvisor/logvisor.hpp>
+
+#if _WIN32
+#include <io.h>
+#endif
+
+namespace hecl::Database {
+
+static logvisor::Module Log("hecl::CookedStore");
+
+constexpr uint32_t PackMagic = 'HCOP';
+constexpr uint32_t PackVersion = 1;
+constexpr uint32_t IndexMagic = 'HCOI';
+constexpr uint32_t IndexVersion = 1;
+constexpr uint32_t RecordMagic = 'OBJT';
+/* Record size marking a removed path */
+constexpr uint64_t Tombstone = UINT64_MAX;
+/* Compaction only pays off once the reclaimable share is large in absolute terms too */
+constexpr uint64_t MinCompactSize = 64 * 1024 * 1024;
+
+namespace {
+struct PackHeader {
+  uint32_t magic;
+  uint32_t version;
+};
+
+/* Followed by the UTF-8 relative path, the artifact bytes and padding to 8 bytes */
+struct RecordHeader {
+  uint32_t magic;
+  uint32_t pathLen;
+  uint64_t pathHash;
+  uint64_t size;
+};
+
+struct IndexHeader {
+  uint32_t magic;
+  uint32_t version;
+  /* Pack bytes the entries account for; records past this are scanned on load */
+  uint64_t packSize;
+  uint64_t deadSize;
+  uint64_t count;
+};
+
+struct IndexEntry {
+  uint64_t pathHash;
+  uint64_t recordOffset;
+  uint64_t size;
+  uint32_t pathLen;
+  uint32_t reserved;
+};
+
+uint64_t RecordSize(uint64_t pathLen, uint64_t size) {
+  const uint64_t unpadded = sizeof(RecordHeader) + pathLen + (size == Tombstone ? 0 : size);
+  return (unpadded + 7) & ~uint64_t(7);
+}
+
+std::string RelativeKey(const ProjectPath& cooked) {
+  return std::string(SystemUTF8Conv(cooked.getRelativePath()).str());
+}
+
+uint64_t HashKey(std::string_view key) { return XXH64(key.data(), key.size(), 0); }
+
+/* Blocking exclusive lock on an open file, held for the lifetime of the object; a null file locks nothing */
+class InterProcessLock {
+  FILE* m_fp;
+
+public:
+  explicit InterProcessLock(FILE* fp) : m_fp(fp) {
+    if (!m_fp)
+      return;
+#if _WIN32
+    OVERLAPPED ov = {};
+    LockFileEx(HANDLE(_get_osfhandle(_fileno(m_fp))), LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &ov);
+#else
+    while (flock(fileno(m_fp), LOCK_EX) && errno == EINTR) {}
+#endif
+  }
+  ~InterProcessLock() {
+    if (!m_fp)
+      return;
+#if _WIN32
+    OVERLAPPED ov = {};
+    UnlockFileEx(HANDLE(_get_osfhandle(_fileno(m_fp))), 0, 1, 0, &ov);
+#else
+    flock(fileno(m_fp), LOCK_UN);
+#endif
+  }
+  InterProcessLock(const InterProcessLock&) = delete;
+  InterProcessLock& operator=(const InterProcessLock&) = delete;
+};
+} // anonymous namespace
+
+uint64_t CookedStore::Entry::dataOffset() const { return m_recordOffset + sizeof(RecordHeader) + m_pathLen; }
+
+uint64_t CookedStore::Entry::recordSize() const { return RecordSize(m_pathLen, m_size); }
+
+CookedStore::CookedStore(Project& project) : m_project(project) {}
+
+CookedStore::~CookedStore() {
+  std::unique_lock lk{m_mutex};
+  if (m_pack && m_indexDirty) {
+    InterProcessLock packLock(m_lockFile.get());
+    if (_refresh())
+      _writeIndex();
+  }
+}
+
+void CookedStore::_load() {
+  m_loaded = true;
+  const SystemString storeRoot =
+      SystemString(m_project.getProjectRootPath().getAbsolutePath()) + _SYS_STR("/.hecl/cookedstore");
+  m_packPath = storeRoot + _SYS_STR("/pack");
+  m_indexPath = storeRoot + _SYS_STR("/index");
+
+  /* Compaction rewrites the pack, so loading waits out other processes' writes */
+  m_lockFile = hecl::FopenUnique((storeRoot + _SYS_STR("/lock")).c_str(), _SYS_STR("a+b"));
+  InterProcessLock packLock(m_lockFile.get());
+
+  MappedFile pack;
+  if (!pack.open(m_packPath.c_str()))
+    return;
+  PackHeader header = {};
+  if (pack.size() >= sizeof(header))
+    std::memcpy(&header, pack.data(), sizeof(header));
+  if (header.magic != PackMagic || header.version != PackVersion) {
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("'{}' is not a cooked store; ignoring it")), m_packPath);
+    return;
+  }
+
+  /* A missing or unreadable index only costs a full scan */
+  uint64_t scanBegin = sizeof(PackHeader);
+  if (auto fp = hecl::FopenUnique(m_indexPath.c_str(), _SYS_STR("rb"))) {
+    IndexHeader indexHeader;
+    if (std::fread(&indexHeader, 1, sizeof(indexHeader), fp.get()) == sizeof(indexHeader) &&
+        indexHeader.magic == IndexMagic && indexHeader.version == IndexVersion &&
+        indexHeader.packSize <= pack.size()) {
+      std::vector<IndexEntry> entries(indexHeader.count);
+      if (std::fread(entries.data(), sizeof(IndexEntry), entries.size(), fp.get()) == entries.size()) {
+        m_entries.reserve(entries.size());
+        for (const IndexEntry& ent : entries)
+          m_entries[ent.pathHash] = Entry{ent.recordOffset, ent.size, ent.pathLen};
+        m_deadSize = indexHeader.deadSize;
+        scanBegin = indexHeader.packSize;
+      }
+    }
+  }
+  _scan(pack, scanBegin);
+  pack.close();
+
+  if (m_deadSize > MinCompactSize && m_deadSize > m_packSize - m_deadSize)
+    _compact();
+
+  m_pack = hecl::FopenUnique(m_packPath.c_str(), _SYS_STR("r+b"));
+  if (!m_pack) {
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to open cooked store '{}'")), m_packPath);
+    return;
+  }
+  _truncateTail();
+}
+
+void CookedStore::_scan(const MappedFile& pack, uint64_t begin) {
+  uint64_t pos = begin;
+  /* Stop at the first malformed record, such as a torn trailing append; callers truncate the pack there */
+  while (pos + sizeof(RecordHeader) <= pack.size()) {
+    RecordHeader rec;
+    std::memcpy(&rec, pack.data() + pos, sizeof(rec));
+    /* Bounded before RecordSize, which a corrupt length would overflow */
+    const uint64_t remaining = pack.size() - pos - sizeof(RecordHeader);
+    if (rec.magic != RecordMagic || rec.pathLen > remaining ||
+        (rec.size != Tombstone && rec.size > remaining - rec.pathLen))
+      break;
+    const uint64_t recSize = RecordSize(rec.pathLen, rec.size);
+    if (pos + recSize > pack.size())
+      break;
+    auto search = m_entries.find(rec.pathHash);
+    if (search != m_entries.end()) {
+      m_deadSize += search->second.recordSize();
+      m_entries.erase(search);
+    }
+    if (rec.size == Tombstone)
+      m_deadSize += recSize;
+    else
+      m_entries[rec.pathHash] = Entry{pos, rec.size, rec.pathLen};
+    pos += recSize;
+  }
+  if (pos != begin)
+    m_indexDirty = true;
+  m_packSize = pos;
+}
+
+/* Caller holds the inter-process lock; drops whatever _scan stopped at so later scans don't parse it again */
+void CookedStore::_truncateTail() {
+  FILE* fp = m_pack.get();
+  hecl::FSeek(fp, 0, SEEK_END);
+  if (hecl::FTell(fp) <= int64_t(m_packSize))
+    return;
+#if _WIN32
+  const bool truncated = !_chsize_s(_fileno(fp), int64_t(m_packSize));
+#else
+  const bool truncated = !ftruncate(fileno(fp), off_t(m_packSize));
+#endif
+  /* Truncation fails e.g. while another process maps the pack on Windows; the next append overwrites them then */
+  if (truncated)
+    Log.report(logvisor::Warning, FMT_STRING(_SYS_STR("discarded malformed records at the end of '{}'")), m_packPath);
+}
+
+void CookedStore::_compact() {
+  MappedFile pack;
+  if (!pack.open(m_packPath.c_str()))
+    return;
+  const SystemString partPath = m_packPath + _SYS_STR(".part");
+  auto fp = hecl::FopenUnique(partPath.c_str(), _SYS_STR("wb"));
+  if (!fp)
+    return;
+
+  const PackHeader header{PackMagic, PackVersion};
+  bool fail = std::fwrite(&header, 1, sizeof(header), fp.get()) != sizeof(header);
+  std::unordered_map<uint64_t, Entry> entries;
+  entries.reserve(m_entries.size());
+  uint64_t pos = sizeof(header);
+  for (const auto& [pathHash, ent] : m_entries) {
+    if (fail)
+      break;
+    const uint64_t recSize = ent.recordSize();
+    fail = std::fwrite(pack.data() + ent.m_recordOffset, 1, recSize, fp.get()) != recSize;
+    entries[pathHash] = Entry{pos, ent.m_size, ent.m_pathLen};
+    pos += recSize;
+  }
+  fp.reset();
+  pack.close();
+  if (fail) {
+    hecl::Unlink(partPath.c_str());
+    return;
+  }
+
+  /* Without an index the next load scans the whole pack, whichever pack survives a crash here */
+  hecl::Unlink(m_indexPath.c_str());
+  if (hecl::Rename(partPath.c_str(), m_packPath.c_str())) {
+    hecl::Unlink(partPath.c_str());
+    return;
+  }
+  m_entries = std::move(entries);
+  m_packSize = pos;
+  m_deadSize = 0;
+  _writeIndex();
+}
+
+void CookedStore::_writeIndex() {
+  const SystemString partPath = m_indexPath + _SYS_STR(".part");
+  auto fp = hecl::FopenUnique(partPath.c_str(), _SYS_STR("wb"));
+  if (!fp)
+    return;
+  const IndexHeader header{IndexMagic, IndexVersion, m_packSize, m_deadSize, m_entries.size()};
+  bool fail = std::fwrite(&header, 1, sizeof(header), fp.get()) != sizeof(header);
+  for (const auto& [pathHash, ent] : m_entries) {
+    const IndexEntry indexEnt{pathHash, ent.m_recordOffset, ent.m_size, ent.m_pathLen, 0};
+    fail |= std::fwrite(&indexEnt, 1, sizeof(indexEnt), fp.get()) != sizeof(indexEnt);
+  }
+  fp.reset();
+  if (fail || hecl::Rename(partPath.c_str(), m_indexPath.c_str())) {
+    hecl::Unlink(partPath.c_str());
+    return;
+  }
+  m_indexDirty = false;
+}
+
+/*
+ * Caller holds the inter-process lock. Takes in records appended by other processes, or rescans
+ * the whole pack if one compacted it into a new file; false if the pack is gone.
+ */
+bool CookedStore::_refresh() {
+#ifndef _WIN32
+  /* Windows can't replace a pack another process has open, so only here may it change underneath */
+  struct stat pathStat, openStat;
+  if (stat(m_packPath.c_str(), &pathStat) || fstat(fileno(m_pack.get()), &openStat))
+    return false;
+  if (pathStat.st_ino != openStat.st_ino || pathStat.st_dev != openStat.st_dev) {
+    m_pack = hecl::FopenUnique(m_packPath.c_str(), _SYS_STR("r+b"));
+    if (!m_pack)
+      return false;
+    m_mapping.reset();
+    m_entries.clear();
+    m_packSize = sizeof(PackHeader);
+    m_deadSize = 0;
+  }
+#endif
+
+  hecl::FSeek(m_pack.get(), 0, SEEK_END);
+  if (hecl::FTell(m_pack.get()) > int64_t(m_packSize)) {
+    {
+      MappedFile pack;
+      if (!pack.open(m_packPath.c_str()))
+        return false;
+      _scan(pack, m_packSize);
+    }
+    _truncateTail();
+  }
+  return true;
+}
+
+bool CookedStore::_append(uint64_t pathHash, std::string_view relPath, const uint8_t* data, uint64_t size) {
+  InterProcessLock packLock(m_lockFile.get());
+  if (!_refresh()) {
+    Log.report(logvisor::Error, FMT_STRING("cooked store changed unexpectedly; unable to append '{}'"), relPath);
+    return false;
+  }
+
+  static constexpr uint8_t Padding[8] = {};
+  const RecordHeader rec{RecordMagic, uint32_t(relPath.size()), pathHash, size};
+  const uint64_t recSize = RecordSize(relPath.size(), size);
+  const uint64_t dataSize = size == Tombstone ? 0 : size;
+  const uint64_t padSize = recSize - sizeof(rec) - relPath.size() - dataSize;
+
+  FILE* fp = m_pack.get();
+  hecl::FSeek(fp, int64_t(m_packSize), SEEK_SET);
+  const bool ok = std::fwrite(&rec, 1, sizeof(rec), fp) == sizeof(rec) &&
+                  std::fwrite(relPath.data(), 1, relPath.size(), fp) == relPath.size() &&
+                  (!dataSize || std::fwrite(data, 1, dataSize, fp) == dataSize) &&
+                  std::fwrite(Padding, 1, padSize, fp) == padSize;
+  std::fflush(fp);
+  if (!ok) {
+    Log.report(logvisor::Error, FMT_STRING("unable to append '{}' to cooked store"), relPath);
+    return false;
+  }
+
+  auto search = m_entries.find(pathHash);
+  if (search != m_entries.end()) {
+    m_deadSize += search->second.recordSize();
+    m_entries.erase(search);
+  }
+  if (size == Tombstone)
+    m_deadSize += recSize;
+  else
+    m_entries[pathHash] = Entry{m_packSize, size, uint32_t(relPath.size())};
+  m_packSize += recSize;
+  m_indexDirty = true;
+  return true;
+}
+
+/* Entries are keyed on a path hash; a colliding path must not be served another path's artifact */
+bool CookedStore::_entryMatches(const Entry& ent, std::string_view relPath) {
+  if (ent.m_pathLen != relPath.size())
+    return false;
+  const std::shared_ptr<const MappedFile> mapping = _mappingCovering(ent.dataOffset());
+  return mapping &&
+         !std::memcmp(mapping->data() + ent.m_recordOffset + sizeof(RecordHeader), relPath.data(), relPath.size());
+}
+
+std::shared_ptr<const MappedFile> CookedStore::_mappingCovering(uint64_t end) {
+  /* Appends land beyond the current mapping; older views keep the mapping they were served from */
+  if (!m_mapping || m_mapping->size() < end) {
+    auto mapping = std::make_shared<MappedFile>();
+    if (!mapping->open(m_packPath.c_str()))
+      return {};
+    m_mapping = std::move(mapping);
+  }
+  return m_mapping->size() >= end ? m_mapping : nullptr;
+}
+
+bool CookedStore::isEnabled() {
+  std::unique_lock lk{m_mutex};
+  if (!m_loaded)
+    _load();
+  return m_pack != nullptr;
+}
+
+void CookedStore::setEnabled(bool enabled) {
+  std::unique_lock lk{m_mutex};
+  if (!m_loaded)
+    _load();
+  if (enabled == (m_pack != nullptr))
+    return;
+
+  if (enabled) {
+    const SystemString storeRoot =
+        SystemString(m_project.getProjectRootPath().getAbsolutePath()) + _SYS_STR("/.hecl/cookedstore");
+    hecl::MakeDir(storeRoot.c_str());
+    if (!m_lockFile)
+      m_lockFile = hecl::FopenUnique((storeRoot + _SYS_STR("/lock")).c_str(), _SYS_STR("a+b"));
+    InterProcessLock packLock(m_lockFile.get());
+    m_pack = hecl::FopenUnique(m_packPath.c_str(), _SYS_STR("w+b"));
+    const PackHeader header{PackMagic, PackVersion};
+    if (!m_pack || std::fwrite(&header, 1, sizeof(header), m_pack.get()) != sizeof(header)) {
+      Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to create cooked store '{}'")), m_packPath);
+      m_pack.reset();
+      return;
+    }
+    std::fflush(m_pack.get());
+    m_entries.clear();
+    m_packSize = sizeof(header);
+    m_deadSize = 0;
+    _writeIndex();
+    return;
+  }
+
+  /* Every artifact goes back to its loose path before the pack is dropped, including other processes' */
+  InterProcessLock packLock(m_lockFile.get());
+  if (!_refresh())
+    return;
+  const std::shared_ptr<const MappedFile> mapping = _mappingCovering(m_packSize);
+  if (!mapping && !m_entries.empty())
+    return;
+  for (const auto& [pathHash, ent] : m_entries) {
+    const std::string_view relPath(reinterpret_cast<const char*>(mapping->data()) + ent.m_recordOffset +
+                                       sizeof(RecordHeader),
+                                   ent.m_pathLen);
+    const ProjectPath loose(m_project, relPath);
+    loose.makeDirChain(false);
+    const SystemString partPath = SystemString(loose.getAbsolutePath()) + _SYS_STR(".part");
+    auto fp = hecl::FopenUnique(partPath.c_str(), _SYS_STR("wb"));
+    const bool ok = fp && std::fwrite(mapping->data() + ent.dataOffset(), 1, ent.m_size, fp.get()) == ent.m_size;
+    fp.reset();
+    if (!ok || hecl::Rename(partPath.c_str(), loose.getAbsolutePath().data())) {
+      hecl::Unlink(partPath.c_str());
+      Log.report(logvisor::Error, FMT_STRING("unable to restore '{}' from cooked store; keeping it enabled"), relPath);
+      return;
+    }
+  }
+  m_mapping.reset();
+  m_pack.reset();
+  m_entries.clear();
+  m_packSize = 0;
+  m_deadSize = 0;
+  m_indexDirty = false;
+  hecl::Unlink(m_packPath.c_str());
+  hecl::Unlink(m_indexPath.c_str());
+}
+
+bool CookedStore::contains(const ProjectPath& cooked) {
+  const std::string relPath = RelativeKey(cooked);
+  const uint64_t pathHash = HashKey(relPath);
+  std::unique_lock lk{m_mutex};
+  if (!m_loaded)
+    _load();
+  if (!m_pack)
+    return false;
+  auto search = m_entries.find(pathHash);
+  return search != m_entries.end() && _entryMatches(search->second, relPath);
+}
+
+CookedStore::View CookedStore::read(const ProjectPath& cooked) {
+  const std::string relPath = RelativeKey(cooked);
+  const uint64_t pathHash = HashKey(relPath);
+  {
+    std::unique_lock lk{m_mutex};
+    if (!m_loaded)
+      _load();
+    if (m_pack) {
+      auto search = m_entries.find(pathHash);
+      if (search != m_entries.end() && _entryMatches(search->second, relPath)) {
+        const Entry& ent = search->second;
+        if (std::shared_ptr<const MappedFile> mapping = _mappingCovering(ent.dataOffset() + ent.m_size))
+          return View{mapping, mapping->data() + ent.dataOffset(), size_t(ent.m_size)};
+        return {};
+      }
+    }
+  }
+
+  auto loose = std::make_shared<MappedFile>();
+  if (!loose->open(cooked.getAbsolutePath().data()))
+    return {};
+  const uint8_t* data = loose->data();
+  const size_t size = loose->size();
+  return View{std::move(loose), data, size};
+}
+
+bool CookedStore::put(const ProjectPath& cooked, const SystemString& file) {
+  MappedFile src;
+  if (!src.open(file.c_str())) {
+    /* MappedFile refuses empty files, which are still valid artifacts */
+    Sstat theStat;
+    if (hecl::Stat(file.c_str(), &theStat) || !S_ISREG(theStat.st_mode) || theStat.st_size != 0)
+      return false;
+  }
+
+  const std::string relPath = RelativeKey(cooked);
+  {
+    std::unique_lock lk{m_mutex};
+    if (!m_loaded)
+      _load();
+    if (!m_pack || !_append(HashKey(relPath), relPath, src.data(), src.size()))
+      return false;
+  }
+  /* file may be the loose copy itself */
+  src.close();
+  hecl::Unlink(cooked.getAbsolutePath().data());
+  return true;
+}
+
+bool CookedStore::put(const ProjectPath& cooked, const uint8_t* data, size_t size) {
+  const std::string relPath = RelativeKey(cooked);
+  {
+    std::unique_lock lk{m_mutex};
+    if (!m_loaded)
+      _load();
+    if (!m_pack || !_append(HashKey(relPath), relPath, data, size))
+      return false;
+  }
+  hecl::Unlink(cooked.getAbsolutePath().data());
+  return true;
+}
+
+void CookedStore::remove(const ProjectPath& cooked) {
+  const std::string relPath = RelativeKey(cooked);
+  const uint64_t pathHash = HashKey(relPath);
+  std::unique_lock lk{m_mutex};
+  if (!m_loaded)
+    _load();
+  if (!m_pack)
+    return;
+  auto search = m_entries.find(pathHash);
+  if (search != m_entries.end() && _entryMatches(search->second, relPath))
+    _append(pathHash, relPath, nullptr, Tombstone);
+}
+
+} // namespace hecl::Database
@@ -0,0 +1,142 @@
+#include "hecl/CpuTopology.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#elif __linux__
+#include <dirent.h>
+#include <sched.h>
+#endif
+
+namespace hecl {
+
+WorkerAffinity WorkerAffinityMode = WorkerAffinity::None;
+
+namespace {
+#if __linux__
+/* Parses sysfs cpu lists such as "0-7,16-23" */
+std::vector<uint32_t> ParseCpuList(const char* list) {
+  std::vector<uint32_t> ret;
+  const char* cur = list;
+  while (*cur >= '0' && *cur <= '9') {
+    char* end;
+    const unsigned long first = std::strtoul(cur, &end, 10);
+    unsigned long last = first;
+    if (*end == '-')
+      last = std::strtoul(end + 1, &end, 10);
+    for (unsigned long cpu = first; cpu <= last; ++cpu)
+      ret.push_back(uint32_t(cpu));
+    cur = *end == ',' ? end + 1 : end;
+  }
+  return ret;
+}
+#endif
+} // anonymous namespace
+
+CpuTopology::CpuTopology() {
+#if _WIN32
+  ULONG highestNode = 0;
+  if (GetNumaHighestNodeNumber(&highestNode)) {
+    for (USHORT node = 0; node <= highestNode; ++node) {
+      GROUP_AFFINITY affinity = {};
+      if (!GetNumaNodeProcessorMaskEx(node, &affinity) || !affinity.Mask)
+        continue;
+      std::vector<uint32_t>& processors = m_nodes.emplace_back();
+      for (uint32_t bit = 0; bit < sizeof(KAFFINITY) * 8; ++bit)
+        if (affinity.Mask & (KAFFINITY(1) << bit))
+          processors.push_back(uint32_t(affinity.Group) * 64 + bit);
+    }
+  }
+#elif __linux__
+  /* Only processors this process may run on, which containers and taskset narrow */
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  const bool haveAllowed = !sched_getaffinity(0, sizeof(allowed), &allowed);
+  if (DIR* dir = opendir("/sys/devices/system/node")) {
+    std::vector<std::pair<unsigned long, std::vector<uint32_t>>> nodes;
+    while (const dirent* ent = readdir(dir)) {
+      if (std::strncmp(ent->d_name, "node", 4) || ent->d_name[4] < '0' || ent->d_name[4] > '9')
+        continue;
+      const std::string path = std::string("/sys/devices/system/node/") + ent->d_name + "/cpulist";
+      FILE* fp = std::fopen(path.c_str(), "r");
+      if (!fp)
+        continue;
+      char line[4096] = {};
+      const bool read = std::fgets(line, sizeof(line), fp) != nullptr;
+      std::fclose(fp);
+      if (!read)
+        continue;
+      std::vector<uint32_t> processors;
+      for (uint32_t cpu : ParseCpuList(line))
+        if (!haveAllowed || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)))
+          processors.push_back(cpu);
+      if (!processors.empty())
+        nodes.emplace_back(std::strtoul(ent->d_name + 4, nullptr, 10), std::move(processors));
+    }
+    closedir(dir);
+    std::sort(nodes.begin(), nodes.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    for (auto& [nodeIdx, processors] : nodes)
+      m_nodes.push_back(std::move(processors));
+  }
+  if (m_nodes.empty() && haveAllowed) {
+    std::vector<uint32_t>& processors = m_nodes.emplace_back();
+    for (uint32_t cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+      if (CPU_ISSET(cpu, &allowed))
+        processors.push_back(cpu);
+  }
+#endif
+  if (m_nodes.empty()) {
+    std::vector<uint32_t>& processors = m_nodes.emplace_back();
+    for (uint32_t cpu = 0; cpu < std::max(std::thread::hardware_concurrency(), 1u); ++cpu)
+      processors.push_back(cpu);
+  }
+}
+
+const CpuTopology& CpuTopology::Get() {
+  static const CpuTopology Topology;
+  return Topology;
+}
+
+std::vector<uint32_t> CpuTopology::workerProcessors(WorkerAffinity mode, size_t idx) const {
+  if (mode == WorkerAffinity::None)
+    return {};
+  /* Consecutive workers land on different nodes so a partial pool still uses every socket */
+  const std::vector<uint32_t>& node = m_nodes[idx % m_nodes.size()];
+  if (mode == WorkerAffinity::Node)
+    return node;
+  return {node[(idx / m_nodes.size()) % node.size()]};
+}
+
+bool SetThreadAffinity(const std::vector<uint32_t>& processors) {
+  if (processors.empty())
+    return true;
+#if _WIN32
+  /* Nodes never span processor groups, so neither does any set workerProcessors returns */
+  GROUP_AFFINITY affinity = {};
+  affinity.Group = WORD(processors.front() / 64);
+  for (uint32_t processor : processors)
+    if (processor / 64 == affinity.Group)
+      affinity.Mask |= KAFFINITY(1) << (processor % 64);
+  return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+#elif __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (uint32_t processor : processors)
+    if (processor < CPU_SETSIZE)
+      CPU_SET(processor, &set);
+  return !sched_setaffinity(0, sizeof(set), &set);
+#else
+  /* No affinity API; threads stay wherever the scheduler puts them */
+  return true;
+#endif
+}
+
+} // namespace hecl
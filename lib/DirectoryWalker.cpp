@@ -0,0 +1,162 @@
+#include "hecl/DirectoryWalker.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <thread>
+
+#include "hecl/ClientProcess.hpp"
+#include "hecl/hecl.hpp"
+
+namespace hecl {
+
+namespace {
+constexpr size_t ArenaBlockSize = 16384;
+constexpr size_t NoResult = SIZE_MAX;
+
+/* Bump allocator of null-terminated strings; blocks never move once allocated */
+class PathArena {
+  std::vector<std::unique_ptr<SystemChar[]>> m_blocks;
+  size_t m_used = ArenaBlockSize;
+
+public:
+  SystemStringView store(SystemStringView str) {
+    const size_t len = str.size() + 1;
+    if (m_used + len > ArenaBlockSize) {
+      m_blocks.push_back(std::make_unique<SystemChar[]>(std::max(len, ArenaBlockSize)));
+      m_used = 0;
+    }
+    SystemChar* out = m_blocks.back().get() + m_used;
+    std::copy(str.begin(), str.end(), out);
+    out[str.size()] = SystemChar(0);
+    m_used += len;
+    return {out, str.size()};
+  }
+
+  void moveBlocks(std::vector<std::unique_ptr<SystemChar[]>>& out) {
+    std::move(m_blocks.begin(), m_blocks.end(), std::back_inserter(out));
+    m_blocks.clear();
+  }
+};
+
+struct ScannedEntry {
+  SystemStringView m_path;
+  SystemStringView m_name;
+  uint64_t m_fileSz;
+  bool m_isDir;
+  /* Listing of this subdirectory, if it is one and is being descended into */
+  size_t m_result = NoResult;
+};
+
+struct WalkState {
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::vector<std::pair<SystemStringView, size_t>> m_queue;
+  /* Listing of each scanned directory; a deque so results stay put while others are added */
+  std::deque<std::vector<ScannedEntry>> m_results;
+  size_t m_pending = 0;
+};
+} // anonymous namespace
+
+DirectoryWalker::DirectoryWalker(SystemStringView root, bool recursive, bool sorted, bool noHidden,
+                                 StatCache* statCache, size_t threadCount) {
+  if (!threadCount)
+    threadCount = CpuCountOverride > 0 ? size_t(CpuCountOverride) : size_t(std::thread::hardware_concurrency());
+  if (!recursive)
+    threadCount = 1;
+  threadCount = std::max(threadCount, size_t(1));
+
+  std::vector<PathArena> arenas(threadCount);
+  WalkState state;
+  state.m_queue.emplace_back(arenas[0].store(root), 0);
+  state.m_results.emplace_back();
+  state.m_pending = 1;
+
+  const auto work = [&](PathArena& arena) {
+    std::unique_lock lk{state.m_mutex};
+    while (true) {
+      state.m_cv.wait(lk, [&]() { return !state.m_queue.empty() || !state.m_pending; });
+      if (state.m_queue.empty())
+        break;
+      const auto [path, resultIdx] = state.m_queue.back();
+      state.m_queue.pop_back();
+      lk.unlock();
+
+      /* Native order lists in one pass; sorting here is cheaper than a second one */
+      const DirectoryEnumerator de(path, DirectoryEnumerator::Mode::Native, false, false, noHidden, statCache);
+      std::vector<ScannedEntry> listing;
+      listing.reserve(de.size());
+      for (const DirectoryEnumerator::Entry& ent : de) {
+        const SystemStringView entPath = arena.store(ent.m_path);
+        listing.push_back(
+            {entPath, entPath.substr(entPath.size() - ent.m_name.size()), ent.m_fileSz, ent.m_isDir});
+      }
+      if (sorted) {
+        std::sort(listing.begin(), listing.end(), [](const ScannedEntry& a, const ScannedEntry& b) {
+          if (a.m_isDir != b.m_isDir)
+            return a.m_isDir;
+          return CaseInsensitiveCompare()(a.m_name, b.m_name);
+        });
+      }
+
+      lk.lock();
+      if (recursive) {
+        for (ScannedEntry& ent : listing) {
+          if (!ent.m_isDir)
+            continue;
+          ent.m_result = state.m_results.size();
+          state.m_results.emplace_back();
+          state.m_queue.emplace_back(ent.m_path, ent.m_result);
+          ++state.m_pending;
+        }
+      }
+      state.m_results[resultIdx] = std::move(listing);
+      --state.m_pending;
+      state.m_cv.notify_all();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(threadCount - 1);
+  for (size_t i = 1; i < threadCount; ++i)
+    threads.emplace_back(work, std::ref(arenas[i]));
+  work(arenas[0]);
+  for (std::thread& thread : threads)
+    thread.join();
+
+  for (PathArena& arena : arenas)
+    arena.moveBlocks(m_arena);
+
+  /* Flatten breadth-first so every directory's children form one run after it */
+  size_t total = 0;
+  for (const auto& listing : state.m_results)
+    total += listing.size();
+  m_entries.reserve(total);
+
+  std::vector<std::pair<size_t, uint32_t>> order{{0, NoEntry}};
+  for (size_t o = 0; o < order.size(); ++o) {
+    const auto [resultIdx, parent] = order[o];
+    const auto& listing = state.m_results[resultIdx];
+    const uint32_t first = uint32_t(m_entries.size());
+    for (const ScannedEntry& ent : listing) {
+      if (ent.m_result != NoResult)
+        order.emplace_back(ent.m_result, uint32_t(m_entries.size()));
+      Entry& out = m_entries.emplace_back();
+      out.m_path = ent.m_path;
+      out.m_name = ent.m_name;
+      out.m_fileSz = ent.m_fileSz;
+      out.m_parent = parent;
+      out.m_isDir = ent.m_isDir;
+    }
+    if (parent == NoEntry) {
+      m_rootChildCount = uint32_t(listing.size());
+    } else {
+      m_entries[parent].m_firstChild = first;
+      m_entries[parent].m_childCount = uint32_t(listing.size());
+    }
+  }
+}
+
+} // namespace hecl
@@ -0,0 +1,47 @@
+#include "hecl/ExtractContext.hpp"
+
+#include "hecl/ClientProcess.hpp"
+#include "hecl/MultiProgressPrinter.hpp"
+#include "hecl/Trace.hpp"
+
+namespace hecl::Database {
+
+void IDataSpec::doParallelExtract(const ExtractPassInfo& info, ExtractContext& ctx) {
+  doExtract(info, ctx.getProgress());
+}
+
+size_t ExtractContext::addGroup(SystemStringView name) {
+  std::unique_lock lk{m_groupMutex};
+  auto& group = m_groups.emplace_back(std::make_unique<Group>());
+  group->m_name = name;
+  return m_groups.size() - 1;
+}
+
+void ExtractContext::addJob(size_t group, SystemStringView resName, FJob&& job, Cost cost) {
+  Group* grp;
+  {
+    std::unique_lock lk{m_groupMutex};
+    grp = m_groups[group].get();
+  }
+  ++grp->m_total;
+  ++m_totalJobs;
+  m_cp.addLambdaTransaction(
+      [this, grp, resName = SystemString(resName), job = std::move(job)](blender::Token& btok) {
+        HECL_TRACE_SCOPE("extract", SystemUTF8Conv(resName).str());
+        m_spec.setThreadProject();
+        job(btok);
+
+        /* Totals may still grow while jobs queue more jobs, so factors are provisional */
+        const size_t done = ++grp->m_done;
+        const size_t allDone = ++m_doneJobs;
+        m_progress.print(grp->m_name.c_str(), resName.c_str(), done / float(grp->m_total.load()),
+                         ClientProcess::GetThreadWorkerIdx());
+        m_progress.setMainFactor(allDone / float(m_totalJobs.load()));
+        m_progress.flush();
+      },
+      cost);
+}
+
+void ExtractContext::waitUntilComplete() { m_cp.waitUntilComplete(); }
+
+} // namespace hecl::Database
@@ -0,0 +1,231 @@
+#include "hecl/ExtractDedup.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#include "hecl/Database.hpp"
+#include "hecl/MappedFile.hpp"
+
+#include <logvisor/logvisor.hpp>
+
+#if _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace hecl::Database {
+
+static logvisor::Module Log("hecl::ExtractDedup");
+
+constexpr uint32_t ExtractDedupMagic = 'HEXD';
+constexpr uint32_t ExtractDedupVersion = 1;
+
+namespace {
+struct JournalHeader {
+  uint32_t magic;
+  uint32_t version;
+};
+
+/* Followed by pathLen bytes of path and canonLen bytes of its canonical path; canonLen 0 marks a canonical path */
+struct JournalRecord {
+  uint64_t hash;
+  uint64_t size;
+  uint16_t pathLen;
+  uint16_t canonLen;
+  uint32_t reserved;
+};
+
+bool WriteBytes(const SystemString& absPath, const void* data, size_t len) {
+  auto fp = hecl::FopenUnique(absPath.c_str(), _SYS_STR("wb"));
+  if (!fp)
+    return false;
+  if (len && std::fwrite(data, 1, len, fp.get()) != len)
+    return false;
+  return std::fclose(fp.release()) == 0;
+}
+
+bool HardLink(const SystemString& target, const SystemString& link) {
+#if _WIN32
+  return CreateHardLinkW(link.c_str(), target.c_str(), nullptr) != 0;
+#else
+  return ::link(target.c_str(), link.c_str()) == 0;
+#endif
+}
+
+/* Guards against hash collisions and canonical copies edited since they were recorded */
+bool SameContents(const SystemString& absPath, const void* data, size_t len) {
+  MappedFile file(absPath.c_str());
+  return file && file.size() == len && std::memcmp(file.data(), data, len) == 0;
+}
+} // anonymous namespace
+
+ExtractDedup::ExtractDedup(Project& project) : m_project(project) {}
+
+void ExtractDedup::_load() {
+  m_loaded = true;
+  m_journalPath = SystemString(m_project.getProjectRootPath().getAbsolutePath()) + _SYS_STR("/.hecl/extractdedup");
+
+  if (auto fp = hecl::FopenUnique(m_journalPath.c_str(), _SYS_STR("rb"))) {
+    JournalHeader header;
+    if (std::fread(&header, 1, sizeof(header), fp.get()) == sizeof(header) && header.magic == ExtractDedupMagic &&
+        header.version == ExtractDedupVersion) {
+      JournalRecord rec;
+      std::string path;
+      std::string canonical;
+      while (std::fread(&rec, 1, sizeof(rec), fp.get()) == sizeof(rec)) {
+        path.resize(rec.pathLen);
+        canonical.resize(rec.canonLen);
+        if (std::fread(path.data(), 1, rec.pathLen, fp.get()) != rec.pathLen ||
+            std::fread(canonical.data(), 1, rec.canonLen, fp.get()) != rec.canonLen)
+          break;
+        ++m_journalRecords;
+        if (canonical.empty()) {
+          m_canonical[ContentKey{rec.hash, rec.size}] = path;
+          m_duplicates.erase(path);
+        } else {
+          m_duplicates[path] = canonical;
+        }
+      }
+    }
+  }
+
+  /* Re-extracting appends a record per resource; rewrite once superseded records dominate */
+  if (m_journalRecords == 0 || m_journalRecords > 2 * (m_canonical.size() + m_duplicates.size()) + 1024)
+    _compact();
+
+  m_journal = hecl::FopenUnique(m_journalPath.c_str(), _SYS_STR("ab"));
+  if (!m_journal)
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to open extract dedup journal '{}'")), m_journalPath);
+}
+
+void ExtractDedup::_append(FILE* fp, const ContentKey& key, std::string_view path, std::string_view canonical) {
+  const JournalRecord rec{key.m_hash, key.m_size, uint16_t(path.size()), uint16_t(canonical.size()), 0};
+  std::fwrite(&rec, 1, sizeof(rec), fp);
+  std::fwrite(path.data(), 1, path.size(), fp);
+  std::fwrite(canonical.data(), 1, canonical.size(), fp);
+}
+
+void ExtractDedup::_compact() {
+  const SystemString partPath = m_journalPath + _SYS_STR(".part");
+  auto fp = hecl::FopenUnique(partPath.c_str(), _SYS_STR("wb"));
+  if (!fp) {
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to write extract dedup journal '{}'")), partPath);
+    return;
+  }
+
+  const JournalHeader header{ExtractDedupMagic, ExtractDedupVersion};
+  std::fwrite(&header, 1, sizeof(header), fp.get());
+  m_journalRecords = 0;
+  for (const auto& [key, path] : m_canonical) {
+    _append(fp.get(), key, path, {});
+    ++m_journalRecords;
+  }
+  for (const auto& [path, canonical] : m_duplicates) {
+    _append(fp.get(), ContentKey{0, 0}, path, canonical);
+    ++m_journalRecords;
+  }
+  fp.reset();
+
+  hecl::Rename(partPath.c_str(), m_journalPath.c_str());
+}
+
+bool ExtractDedup::write(const ProjectPath& path, const void* data, size_t len) {
+  const SystemString absPath(path.getAbsolutePath());
+  std::string relPath(path.getRelativePathUTF8());
+  /* Empty files aren't worth linking, and overlong paths can't be journaled */
+  if (!len || relPath.size() > UINT16_MAX) {
+    hecl::Unlink(absPath.c_str());
+    if (!WriteBytes(absPath, data, len)) {
+      Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to write '{}'")), absPath);
+      return false;
+    }
+    return true;
+  }
+  const ContentKey key{Hash(data, len).val64(), uint64_t(len)};
+
+  std::unique_lock lk{m_mutex};
+  if (!m_loaded)
+    _load();
+
+  /* An identical resource may still be in flight on another worker */
+  auto search = m_canonical.find(key);
+  while (search != m_canonical.end() && m_pending.count(search->second)) {
+    m_pendingCv.wait(lk);
+    search = m_canonical.find(key);
+  }
+
+  if (search != m_canonical.end() && search->second != relPath) {
+    const std::string canonical = search->second;
+    lk.unlock();
+    const SystemString canonAbs(ProjectPath(m_project, canonical).getAbsolutePath());
+    if (SameContents(canonAbs, data, len)) {
+      hecl::Unlink(absPath.c_str());
+      const bool linked = HardLink(canonAbs, absPath);
+      if (!linked && !WriteBytes(absPath, data, len)) {
+        Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to write '{}'")), absPath);
+        return false;
+      }
+      lk.lock();
+      if (linked)
+        m_dedupedBytes += len;
+      m_duplicates[relPath] = canonical;
+      if (m_journal) {
+        _append(m_journal.get(), key, relPath, canonical);
+        std::fflush(m_journal.get());
+        ++m_journalRecords;
+      }
+      return true;
+    }
+    /* The recorded copy no longer holds these bytes; this path takes its place */
+    lk.lock();
+  }
+
+  m_canonical[key] = relPath;
+  m_duplicates.erase(relPath);
+  m_pending.insert(relPath);
+  lk.unlock();
+
+  /* Writing through an earlier extract's hardlink would clobber its canonical copy */
+  hecl::Unlink(absPath.c_str());
+  const bool ok = WriteBytes(absPath, data, len);
+
+  lk.lock();
+  m_pending.erase(relPath);
+  if (ok) {
+    if (m_journal) {
+      _append(m_journal.get(), key, relPath, {});
+      std::fflush(m_journal.get());
+      ++m_journalRecords;
+    }
+  } else {
+    auto failed = m_canonical.find(key);
+    if (failed != m_canonical.end() && failed->second == relPath)
+      m_canonical.erase(failed);
+  }
+  lk.unlock();
+  m_pendingCv.notify_all();
+
+  if (!ok)
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to write '{}'")), absPath);
+  return ok;
+}
+
+ProjectPath ExtractDedup::getCanonicalPath(const ProjectPath& path) {
+  const std::string relPath(path.getRelativePathUTF8());
+  std::unique_lock lk{m_mutex};
+  if (!m_loaded)
+    _load();
+  auto search = m_duplicates.find(relPath);
+  if (search == m_duplicates.end())
+    return path;
+  return ProjectPath(m_project, search->second);
+}
+
+uint64_t ExtractDedup::getDedupedBytes() {
+  std::unique_lock lk{m_mutex};
+  return m_dedupedBytes;
+}
+
+} // namespace hecl::Database
@@ -0,0 +1,298 @@
+#include "hecl/FileWatcher.hpp"
+
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+
+#include "hecl/hecl.hpp"
+
+#if _WIN32
+#elif __APPLE__
+#include <CoreServices/CoreServices.h>
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+#include <logvisor/logvisor.hpp>
+
+namespace hecl {
+static logvisor::Module Log("hecl::FileWatcher");
+
+/* True if any component of path beneath root starts with '.' */
+static bool IsHiddenBeneath(SystemStringView root, SystemStringView path) {
+  if (path.compare(0, root.size(), root) == 0)
+    path.remove_prefix(root.size());
+  for (size_t i = 0; i < path.size(); ++i)
+    if (path[i] == _SYS_STR('.') && (i == 0 || path[i - 1] == _SYS_STR('/')))
+      return true;
+  return false;
+}
+
+#if _WIN32
+
+struct FileWatcher::Backend {
+  FileWatcher& m_watcher;
+  SystemString m_root;
+  HANDLE m_dir = INVALID_HANDLE_VALUE;
+  std::atomic_bool m_quit = false;
+  std::thread m_thread;
+
+  Backend(FileWatcher& watcher, SystemStringView root) : m_watcher(watcher), m_root(root) {}
+
+  bool init() {
+#if HECL_UCS2
+    const std::wstring wroot = m_root;
+#else
+    const std::wstring wroot = UTF8ToWide(m_root);
+#endif
+    m_dir = CreateFileW(wroot.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                        nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+    if (m_dir == INVALID_HANDLE_VALUE)
+      return false;
+    m_thread = std::thread(std::bind(&Backend::proc, this));
+    return true;
+  }
+
+  void proc() {
+    logvisor::RegisterThreadName("HECL File Watcher");
+    alignas(DWORD) uint8_t buf[65536];
+    constexpr DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME |
+                             FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE;
+    while (!m_quit) {
+      DWORD bytes = 0;
+      if (!ReadDirectoryChangesW(m_dir, buf, sizeof(buf), TRUE, filter, &bytes, nullptr, nullptr))
+        break;
+      if (!bytes) {
+        /* Notification buffer overflowed; anything may have changed */
+        m_watcher._notify(SystemString(m_root));
+        continue;
+      }
+      for (const uint8_t* ptr = buf;;) {
+        const auto* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(ptr);
+        std::wstring name(info->FileName, info->FileNameLength / sizeof(WCHAR));
+        std::replace(name.begin(), name.end(), L'\\', L'/');
+#if HECL_UCS2
+        SystemString path = m_root + L'/' + name;
+#else
+        SystemString path = m_root + '/' + WideToUTF8(name);
+#endif
+        if (!IsHiddenBeneath(m_root, path))
+          m_watcher._notify(std::move(path));
+        if (!info->NextEntryOffset)
+          break;
+        ptr += info->NextEntryOffset;
+      }
+    }
+  }
+
+  ~Backend() {
+    m_quit = true;
+    if (m_thread.joinable()) {
+      /* The read blocks until something changes; cancel it until the thread notices */
+      do {
+        CancelSynchronousIo(m_thread.native_handle());
+      } while (WaitForSingleObject(m_thread.native_handle(), 10) == WAIT_TIMEOUT);
+      m_thread.join();
+    }
+    if (m_dir != INVALID_HANDLE_VALUE)
+      CloseHandle(m_dir);
+  }
+};
+
+#elif __APPLE__
+
+struct FileWatcher::Backend {
+  FileWatcher& m_watcher;
+  SystemString m_root;
+  FSEventStreamRef m_stream = nullptr;
+  dispatch_queue_t m_queue = nullptr;
+
+  Backend(FileWatcher& watcher, SystemStringView root) : m_watcher(watcher), m_root(root) {}
+
+  static void Callback(ConstFSEventStreamRef, void* info, size_t numEvents, void* eventPaths,
+                       const FSEventStreamEventFlags eventFlags[], const FSEventStreamEventId[]) {
+    auto* self = static_cast<Backend*>(info);
+    auto** paths = static_cast<char**>(eventPaths);
+    for (size_t i = 0; i < numEvents; ++i) {
+      if (eventFlags[i] & (kFSEventStreamEventFlagMustScanSubDirs | kFSEventStreamEventFlagRootChanged)) {
+        self->m_watcher._notify(SystemString(self->m_root));
+        continue;
+      }
+      SystemString path(paths[i]);
+      if (!IsHiddenBeneath(self->m_root, path))
+        self->m_watcher._notify(std::move(path));
+    }
+  }
+
+  bool init() {
+    CFStringRef cfRoot = CFStringCreateWithCString(nullptr, m_root.c_str(), kCFStringEncodingUTF8);
+    CFArrayRef cfPaths = CFArrayCreate(nullptr, reinterpret_cast<const void**>(&cfRoot), 1, &kCFTypeArrayCallBacks);
+    FSEventStreamContext context = {0, this, nullptr, nullptr, nullptr};
+    m_stream = FSEventStreamCreate(nullptr, &Backend::Callback, &context, cfPaths, kFSEventStreamEventIdSinceNow, 0.05,
+                                   kFSEventStreamCreateFlagFileEvents | kFSEventStreamCreateFlagNoDefer);
+    CFRelease(cfPaths);
+    CFRelease(cfRoot);
+    if (!m_stream)
+      return false;
+    m_queue = dispatch_queue_create("hecl.filewatcher", DISPATCH_QUEUE_SERIAL);
+    FSEventStreamSetDispatchQueue(m_stream, m_queue);
+    return FSEventStreamStart(m_stream);
+  }
+
+  ~Backend() {
+    if (m_stream) {
+      FSEventStreamStop(m_stream);
+      FSEventStreamInvalidate(m_stream);
+      FSEventStreamRelease(m_stream);
+    }
+    if (m_queue)
+      dispatch_release(m_queue);
+  }
+};
+
+#else
+
+struct FileWatcher::Backend {
+  static constexpr uint32_t WatchMask =
+      IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF;
+
+  FileWatcher& m_watcher;
+  SystemString m_root;
+  int m_fd = -1;
+  int m_wake[2] = {-1, -1};
+  /* inotify watches single directories; keep one per directory in the tree */
+  std::unordered_map<int, SystemString> m_dirs;
+  std::thread m_thread;
+
+  Backend(FileWatcher& watcher, SystemStringView root) : m_watcher(watcher), m_root(root) {}
+
+  void addTree(const SystemString& dir) {
+    const int wd = inotify_add_watch(m_fd, dir.c_str(), WatchMask | IN_ONLYDIR);
+    if (wd < 0) {
+      Log.report(logvisor::Warning, FMT_STRING("unable to watch '{}': {}"), dir, strerror(errno));
+      return;
+    }
+    m_dirs[wd] = dir;
+    for (const DirectoryEnumerator::Entry& ent : DirectoryEnumerator(dir, DirectoryEnumerator::Mode::DirsSorted,
+                                                                      false, false, true))
+      addTree(ent.m_path);
+  }
+
+  bool init() {
+    m_fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (m_fd < 0 || pipe2(m_wake, O_CLOEXEC))
+      return false;
+    addTree(m_root);
+    if (m_dirs.empty())
+      return false;
+    m_thread = std::thread(std::bind(&Backend::proc, this));
+    return true;
+  }
+
+  void proc() {
+    logvisor::RegisterThreadName("HECL File Watcher");
+    alignas(inotify_event) char buf[16384];
+    pollfd fds[2] = {{m_fd, POLLIN, 0}, {m_wake[0], POLLIN, 0}};
+    while (poll(fds, 2, -1) >= 0 || errno == EINTR) {
+      if (fds[1].revents)
+        break;
+      if (!(fds[0].revents & POLLIN))
+        continue;
+      ssize_t len;
+      while ((len = read(m_fd, buf, sizeof(buf))) > 0) {
+        for (char* ptr = buf; ptr < buf + len;) {
+          const auto* ev = reinterpret_cast<const inotify_event*>(ptr);
+          ptr += sizeof(inotify_event) + ev->len;
+          handleEvent(*ev);
+        }
+      }
+    }
+  }
+
+  void handleEvent(const inotify_event& ev) {
+    if (ev.mask & IN_Q_OVERFLOW) {
+      /* Events were dropped; anything may have changed */
+      m_watcher._notify(SystemString(m_root));
+      return;
+    }
+    auto search = m_dirs.find(ev.wd);
+    if (search == m_dirs.end())
+      return;
+    if (ev.mask & IN_IGNORED) {
+      m_dirs.erase(search);
+      return;
+    }
+    if (!ev.len)
+      return;
+
+    SystemString path = search->second + '/' + ev.name;
+    if (IsHiddenBeneath(m_root, path))
+      return;
+    /* Contents created before the watch was added are covered by reporting the directory itself */
+    if ((ev.mask & IN_ISDIR) && (ev.mask & (IN_CREATE | IN_MOVED_TO)))
+      addTree(path);
+    m_watcher._notify(std::move(path));
+  }
+
+  ~Backend() {
+    if (m_thread.joinable()) {
+      const char wake = 0;
+      if (write(m_wake[1], &wake, 1) < 0)
+        Log.report(logvisor::Error, FMT_STRING("unable to wake watcher thread: {}"), strerror(errno));
+      m_thread.join();
+    }
+    for (int fd : {m_fd, m_wake[0], m_wake[1]})
+      if (fd >= 0)
+        close(fd);
+  }
+};
+
+#endif
+
+FileWatcher::FileWatcher(SystemStringView root) {
+  auto backend = std::make_unique<Backend>(*this, root);
+  if (!backend->init()) {
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to watch '{}' for changes")), root);
+    return;
+  }
+  m_backend = std::move(backend);
+}
+
+FileWatcher::~FileWatcher() { m_backend.reset(); }
+
+void FileWatcher::_notify(SystemString&& absPath) {
+  {
+    std::lock_guard lk{m_mutex};
+    m_changed.insert(std::move(absPath));
+  }
+  m_cv.notify_all();
+}
+
+bool FileWatcher::waitForChanges(std::vector<SystemString>& changedOut, std::chrono::milliseconds settle) {
+  changedOut.clear();
+  std::unique_lock lk{m_mutex};
+  m_cv.wait(lk, [this]() { return m_stopped || !m_changed.empty(); });
+  /* Let a burst of related writes finish before reporting */
+  for (size_t count = 0; !m_stopped && count != m_changed.size();) {
+    count = m_changed.size();
+    m_cv.wait_for(lk, settle, [&]() { return m_stopped || m_changed.size() != count; });
+  }
+  if (m_stopped)
+    return false;
+  changedOut.reserve(m_changed.size());
+  for (auto it = m_changed.begin(); it != m_changed.end();)
+    changedOut.push_back(std::move(m_changed.extract(it++).value()));
+  return true;
+}
+
+void FileWatcher::stop() {
+  {
+    std::lock_guard lk{m_mutex};
+    m_stopped = true;
+  }
+  m_cv.notify_all();
+}
+
+} // namespace hecl
@@ -0,0 +1,70 @@
+#include "hecl/MappedFile.hpp"
+
+#include "hecl/hecl.hpp"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+namespace hecl {
+
+bool MappedFile::open(const SystemChar* path) {
+  _unmap();
+
+#if _WIN32
+  HANDLE file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+    CloseHandle(file);
+    return false;
+  }
+  HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (!mapping)
+    return false;
+  void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!view) {
+    CloseHandle(mapping);
+    return false;
+  }
+  m_mapping = mapping;
+  m_data = static_cast<const uint8_t*>(view);
+  m_size = std::size_t(fileSize.QuadPart);
+#else
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat theStat;
+  if (fstat(fd, &theStat) || theStat.st_size == 0) {
+    ::close(fd);
+    return false;
+  }
+  void* view = mmap(nullptr, std::size_t(theStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (view == MAP_FAILED)
+    return false;
+  m_data = static_cast<const uint8_t*>(view);
+  m_size = std::size_t(theStat.st_size);
+#endif
+
+  return true;
+}
+
+void MappedFile::_unmap() {
+  if (!m_data)
+    return;
+#if _WIN32
+  UnmapViewOfFile(m_data);
+  CloseHandle(m_mapping);
+  m_mapping = nullptr;
+#else
+  munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+  m_data = nullptr;
+  m_size = 0;
+}
+
+} // namespace hecl
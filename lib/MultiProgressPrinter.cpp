@@ -1,6 +1,7 @@
 #include "hecl/MultiProgressPrinter.hpp"
 
 #include <algorithm>
+#include <chrono>
 #include <cstdio>
 
 #include "hecl/hecl.hpp"
@@ -17,7 +18,12 @@
 
 namespace hecl {
 
-void MultiProgressPrinter::ThreadStat::print(const TermInfo& tinfo) const {
+/* Cap on frames per second while workers report */
+constexpr std::chrono::milliseconds MinFrameInterval{50};
+/* Frame interval of the indeterminate bar animation, and the longest a flush() request waits */
+constexpr std::chrono::milliseconds IdleFrameInterval{100};
+
+void MultiProgressPrinter::ThreadLine::print(const TermInfo& tinfo) const {
   bool blocks = m_factor >= 0.f;
   float factor = std::max(0.f, std::min(1.f, m_factor));
   int iFactor = factor * 100.f;
@@ -143,13 +149,91 @@ void MultiProgressPrinter::MoveCursorUp(int n) {
   }
 }
 
+void MultiProgressPrinter::DrawMainBar() {
+  float factor = std::max(0.0f, std::min(1.0f, m_drawnMainFactor));
+  int iFactor = factor * 100.0;
+  int half = m_termInfo.width - 2;
+
+  int blocks = half - 8;
+  int filled = blocks * factor;
+  int rem = blocks - filled;
+
+  if (m_termInfo.xtermColor) {
+    fmt::print(FMT_STRING(_SYS_STR("" BOLD "  {:3d}% [")), iFactor);
+    for (int b = 0; b < filled; ++b)
+      fmt::print(FMT_STRING(_SYS_STR("#")));
+    for (int b = 0; b < rem; ++b)
+      fmt::print(FMT_STRING(_SYS_STR("-")));
+    fmt::print(FMT_STRING(_SYS_STR("]" NORMAL "")));
+  } else {
+#if _WIN32
+    SetConsoleTextAttribute(m_termInfo.console, FOREGROUND_INTENSITY | FOREGROUND_WHITE);
+#endif
+    fmt::print(FMT_STRING(_SYS_STR("  {:3d}% [")), iFactor);
+    for (int b = 0; b < filled; ++b)
+      fmt::print(FMT_STRING(_SYS_STR("#")));
+    for (int b = 0; b < rem; ++b)
+      fmt::print(FMT_STRING(_SYS_STR("-")));
+    fmt::print(FMT_STRING(_SYS_STR("]")));
+#if _WIN32
+    SetConsoleTextAttribute(m_termInfo.console, FOREGROUND_WHITE);
+#endif
+  }
+}
+
 void MultiProgressPrinter::DoPrint() {
+  const bool dirty = m_dirty.exchange(false);
+#if _WIN32
+  const bool mainIndeterminate = m_mainIndeterminate;
+#else
+  const bool mainIndeterminate = m_mainIndeterminate && m_termInfo.xtermColor;
+#endif
+  if (!dirty && !mainIndeterminate)
+    return;
+
   auto logLk = logvisor::LockLog();
   uint64_t logCounter = logvisor::GetLogCounter();
   if (logCounter != m_lastLogCounter) {
+    /* Other output scrolled our lines away; everything must be drawn anew below it */
     m_curThreadLines = 0;
+    m_drawnLines.clear();
+    m_drawnMainFactor = -1.f;
     m_lastLogCounter = logCounter;
   }
+
+  /* Snapshot worker slots, then compare against what is on screen */
+  m_frameLines.clear();
+  const float mainFactor = m_mainFactor;
+  if (dirty) {
+    const int width = (hecl::GuiMode ? 120 : std::max(80, hecl::ConsoleWidth(&m_termInfo.truncate)));
+    if (width != m_drawnWidth) {
+      m_drawnLines.clear();
+      m_drawnMainFactor = -1.f;
+      m_drawnWidth = width;
+    }
+    m_termInfo.width = width;
+
+    if (m_newLineAfter) {
+      const int count = m_threadStatCount;
+      for (int i = 0; i < count; ++i) {
+        ThreadStat& stat = m_threadStats[i];
+        std::lock_guard lk{stat.m_lock};
+        if (stat.m_active)
+          m_frameLines.push_back(stat.m_line);
+      }
+      if (!m_summaryLine.m_message.empty())
+        m_frameLines.push_back(m_summaryLine);
+    } else if (const int latest = m_latestThread; latest != -1) {
+      ThreadStat& stat = m_threadStats[latest];
+      std::lock_guard lk{stat.m_lock};
+      m_frameLines.push_back(stat.m_line);
+    }
+
+    if (!mainIndeterminate && m_frameLines == m_drawnLines &&
+        (!m_newLineAfter || mainFactor == m_drawnMainFactor || (mainFactor < 0.f && m_drawnMainFactor < 0.f)))
+      return;
+  }
+
 #if _WIN32
   CONSOLE_CURSOR_INFO cursorInfo;
   GetConsoleCursorInfo(m_termInfo.console, &cursorInfo);
@@ -159,73 +243,40 @@ void MultiProgressPrinter::DoPrint() {
   if (m_termInfo.xtermColor)
     fmt::print(FMT_STRING(_SYS_STR("" HIDE_CURSOR "")));
 
-  if (m_dirty) {
-    m_termInfo.width = (hecl::GuiMode ? 120 : std::max(80, hecl::ConsoleWidth(&m_termInfo.truncate)));
+  if (dirty) {
     MoveCursorUp(m_curThreadLines + m_curProgLines);
     m_curThreadLines = m_curProgLines = 0;
 
     if (m_newLineAfter) {
-      for (const ThreadStat& stat : m_threadStats) {
-        if (stat.m_active) {
-          stat.print(m_termInfo);
-          fmt::print(FMT_STRING(_SYS_STR("\n")));
-          ++m_curThreadLines;
-        }
+      /* Lines identical to the ones already at their row are stepped over rather than rewritten */
+      for (size_t i = 0; i < m_frameLines.size(); ++i) {
+        if (i >= m_drawnLines.size() || !(m_frameLines[i] == m_drawnLines[i]))
+          m_frameLines[i].print(m_termInfo);
+        fmt::print(FMT_STRING(_SYS_STR("\n")));
+        ++m_curThreadLines;
       }
+      const bool mainRowMoved = m_frameLines.size() != m_drawnLines.size();
 
-      if (m_mainIndeterminate
-#ifndef _WIN32
-          && m_termInfo.xtermColor
-#endif
-      ) {
+      if (mainIndeterminate) {
         DrawIndeterminateBar();
         fmt::print(FMT_STRING(_SYS_STR("\n")));
         ++m_curProgLines;
-      } else if (m_mainFactor >= 0.f) {
-        float factor = std::max(0.0f, std::min(1.0f, m_mainFactor));
-        int iFactor = factor * 100.0;
-        int half = m_termInfo.width - 2;
-
-        int blocks = half - 8;
-        int filled = blocks * factor;
-        int rem = blocks - filled;
-
-        if (m_termInfo.xtermColor) {
-          fmt::print(FMT_STRING(_SYS_STR("" BOLD "  {:3d}% [")), iFactor);
-          for (int b = 0; b < filled; ++b)
-            fmt::print(FMT_STRING(_SYS_STR("#")));
-          for (int b = 0; b < rem; ++b)
-            fmt::print(FMT_STRING(_SYS_STR("-")));
-          fmt::print(FMT_STRING(_SYS_STR("]" NORMAL "")));
-        } else {
-#if _WIN32
-          SetConsoleTextAttribute(m_termInfo.console, FOREGROUND_INTENSITY | FOREGROUND_WHITE);
-#endif
-          fmt::print(FMT_STRING(_SYS_STR("  {:3d}% [")), iFactor);
-          for (int b = 0; b < filled; ++b)
-            fmt::print(FMT_STRING(_SYS_STR("#")));
-          for (int b = 0; b < rem; ++b)
-            fmt::print(FMT_STRING(_SYS_STR("-")));
-          fmt::print(FMT_STRING(_SYS_STR("]")));
-#if _WIN32
-          SetConsoleTextAttribute(m_termInfo.console, FOREGROUND_WHITE);
-#endif
+      } else if (mainFactor >= 0.f) {
+        if (mainRowMoved || mainFactor != m_drawnMainFactor) {
+          m_drawnMainFactor = mainFactor;
+          DrawMainBar();
         }
-
         fmt::print(FMT_STRING(_SYS_STR("\n")));
         ++m_curProgLines;
       }
-    } else if (m_latestThread != -1) {
-      const ThreadStat& stat = m_threadStats[m_latestThread];
-      stat.print(m_termInfo);
+      if (mainIndeterminate || mainFactor < 0.f)
+        m_drawnMainFactor = -1.f;
+    } else if (!m_frameLines.empty()) {
+      m_frameLines.front().print(m_termInfo);
       fmt::print(FMT_STRING(_SYS_STR("\r")));
     }
-    m_dirty = false;
-  } else if (m_mainIndeterminate
-#ifndef _WIN32
-             && m_termInfo.xtermColor
-#endif
-  ) {
+    std::swap(m_drawnLines, m_frameLines);
+  } else {
     m_termInfo.width = (hecl::GuiMode ? 120 : std::max(80, hecl::ConsoleWidth()));
     MoveCursorUp(m_curProgLines);
     m_curProgLines = 0;
@@ -245,15 +296,32 @@ void MultiProgressPrinter::DoPrint() {
 }
 
 void MultiProgressPrinter::LogProc() {
+  auto lastFrame = std::chrono::steady_clock::now();
+  std::unique_lock lk{m_logLock};
   while (m_running) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    m_logCv.wait_for(lk, IdleFrameInterval, [this]() { return m_dirty || !m_running; });
+    if (!m_running)
+      break;
+
+    if (m_summaryFunc && m_newLineAfter && std::chrono::steady_clock::now() - m_lastSummary >= m_summaryInterval) {
+      m_lastSummary = std::chrono::steady_clock::now();
+      hecl::SystemString summary = m_summaryFunc();
+      if (summary != m_summaryLine.m_message) {
+        m_summaryLine.m_message = std::move(summary);
+        m_dirty = true;
+      }
+    }
 
-    if (!m_dirty && !m_mainIndeterminate) {
-      continue;
+    /* Coalesce bursts of reports into one frame per interval */
+    const auto now = std::chrono::steady_clock::now();
+    if (now - lastFrame < MinFrameInterval) {
+      lk.unlock();
+      std::this_thread::sleep_for(MinFrameInterval - (now - lastFrame));
+      lk.lock();
     }
 
-    std::lock_guard lk{m_logLock};
     DoPrint();
+    lastFrame = std::chrono::steady_clock::now();
   }
 }
 
@@ -275,13 +343,18 @@ MultiProgressPrinter::MultiProgressPrinter(bool activate) {
     }
 #endif
 
+    m_threadStats = std::make_unique<ThreadStat[]>(MaxThreadStats);
     m_running = true;
     m_logThread = std::thread(std::bind(&MultiProgressPrinter::LogProc, this));
   }
 }
 
 MultiProgressPrinter::~MultiProgressPrinter() {
-  m_running = false;
+  {
+    std::lock_guard lk{m_logLock};
+    m_running = false;
+  }
+  m_logCv.notify_one();
   if (m_logThread.joinable())
     m_logThread.join();
 }
@@ -292,28 +365,27 @@ void MultiProgressPrinter::print(const hecl::SystemChar* message, const hecl::Sy
     return;
   }
 
-  std::lock_guard lk{m_logLock};
-  if (threadIdx < 0) {
-    threadIdx = 0;
-  }
-  if (threadIdx >= m_threadStats.size()) {
-    m_threadStats.resize(threadIdx + 1);
-  }
+  threadIdx = std::clamp(threadIdx, 0, MaxThreadStats - 1);
+  int count = m_threadStatCount;
+  while (count <= threadIdx && !m_threadStatCount.compare_exchange_weak(count, threadIdx + 1)) {}
 
   ThreadStat& stat = m_threadStats[threadIdx];
-  if (message) {
-    stat.m_message = message;
-  } else {
-    stat.m_message.clear();
-  }
-  if (submessage) {
-    stat.m_submessage = submessage;
-  } else {
-    stat.m_submessage.clear();
-  }
+  {
+    std::lock_guard lk{stat.m_lock};
+    if (message) {
+      stat.m_line.m_message = message;
+    } else {
+      stat.m_line.m_message.clear();
+    }
+    if (submessage) {
+      stat.m_line.m_submessage = submessage;
+    } else {
+      stat.m_line.m_submessage.clear();
+    }
 
-  stat.m_factor = factor;
-  stat.m_active = true;
+    stat.m_line.m_factor = factor;
+    stat.m_active = true;
+  }
   m_latestThread = threadIdx;
   m_dirty = true;
 }
@@ -323,11 +395,10 @@ void MultiProgressPrinter::setMainFactor(float factor) const {
     return;
   }
 
-  std::lock_guard lk{m_logLock};
+  m_mainFactor = factor;
   if (!m_mainIndeterminate) {
     m_dirty = true;
   }
-  m_mainFactor = factor;
 }
 
 void MultiProgressPrinter::setMainIndeterminate(bool indeterminate) const {
@@ -335,9 +406,23 @@ void MultiProgressPrinter::setMainIndeterminate(bool indeterminate) const {
     return;
   }
 
+  if (m_mainIndeterminate.exchange(indeterminate) != indeterminate) {
+    m_dirty = true;
+  }
+}
+
+void MultiProgressPrinter::setSummary(SummaryFunc func, std::chrono::milliseconds interval) const {
+  if (!m_running) {
+    return;
+  }
+
   std::lock_guard lk{m_logLock};
-  if (m_mainIndeterminate != indeterminate) {
-    m_mainIndeterminate = indeterminate;
+  m_summaryFunc = std::move(func);
+  m_summaryInterval = interval;
+  m_lastSummary = std::chrono::steady_clock::now();
+  m_summaryLine.m_factor = -1.f;
+  if (!m_summaryFunc && !m_summaryLine.m_message.empty()) {
+    m_summaryLine.m_message.clear();
     m_dirty = true;
   }
 }
@@ -347,19 +432,33 @@ void MultiProgressPrinter::startNewLine() const {
     return;
   }
 
+  /* Finish the current frame synchronously so the new line starts below its final state */
   std::lock_guard lk{m_logLock};
-  const_cast<MultiProgressPrinter&>(*this).DoPrint();
-  m_threadStats.clear();
+  auto& self = const_cast<MultiProgressPrinter&>(*this);
+  self.DoPrint();
+  const int count = m_threadStatCount;
+  for (int i = 0; i < count; ++i) {
+    ThreadStat& stat = m_threadStats[i];
+    std::lock_guard statLk{stat.m_lock};
+    stat.m_active = false;
+  }
   m_latestThread = -1;
-  m_curThreadLines = 0;
+  self.m_curThreadLines = 0;
+  self.m_drawnLines.clear();
+  self.m_drawnMainFactor = -1.f;
   m_mainFactor = -1.f;
   auto logLk = logvisor::LockLog();
   fmt::print(FMT_STRING(_SYS_STR("\n")));
 }
 
 void MultiProgressPrinter::flush() const {
-  std::lock_guard lk{m_logLock};
-  const_cast<MultiProgressPrinter&>(*this).DoPrint();
+  if (!m_running) {
+    return;
+  }
+
+  /* Drawing is left to the log thread; this only cuts its wait short */
+  m_dirty = true;
+  m_logCv.notify_one();
 }
 
 } // namespace hecl
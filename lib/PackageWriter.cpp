@@ -0,0 +1,332 @@
+#include "hecl/PackageWriter.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+
+#include "hecl/hecl.hpp"
+#include "hecl/MathExtras.hpp"
+
+#include <logvisor/logvisor.hpp>
+
+#if _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace hecl::Database {
+
+static logvisor::Module Log("hecl::PackageWriter");
+
+namespace {
+/* Large enough that the fallback copy is bound by the device, not by system calls */
+constexpr size_t CopyBufferSize = 1024 * 1024;
+
+#if _WIN32
+bool WriteAt(HANDLE handle, uint64_t offset, const void* data, size_t len) {
+  const uint8_t* ptr = static_cast<const uint8_t*>(data);
+  while (len) {
+    /* An explicit offset makes the write independent of the shared file pointer */
+    OVERLAPPED ov = {};
+    ov.Offset = DWORD(offset);
+    ov.OffsetHigh = DWORD(offset >> 32);
+    const DWORD chunk = DWORD(std::min<size_t>(len, 0x40000000));
+    DWORD written = 0;
+    if (!WriteFile(handle, ptr, chunk, &written, &ov) || written == 0)
+      return false;
+    ptr += written;
+    offset += written;
+    len -= written;
+  }
+  return true;
+}
+#else
+bool WriteAt(int fd, uint64_t offset, const void* data, size_t len) {
+  const uint8_t* ptr = static_cast<const uint8_t*>(data);
+  while (len) {
+    const ssize_t written = pwrite(fd, ptr, len, off_t(offset));
+    if (written < 0 && errno == EINTR)
+      continue;
+    if (written <= 0)
+      return false;
+    ptr += written;
+    offset += uint64_t(written);
+    len -= size_t(written);
+  }
+  return true;
+}
+#endif
+} // anonymous namespace
+
+PackageWriter::PackageWriter(SystemStringView path, uint64_t expectedSize)
+: m_path(path), m_partPath(SystemString(path) + _SYS_STR(".part")) {
+#if _WIN32
+  HANDLE handle = CreateFileW(m_partPath.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (handle == INVALID_HANDLE_VALUE) {
+    _fail(_SYS_STR("create"));
+    return;
+  }
+  m_handle = handle;
+  if (expectedSize) {
+    /* Reserves clusters without moving EOF; SetFileValidData would need SE_MANAGE_VOLUME_NAME */
+    FILE_ALLOCATION_INFO alloc = {};
+    alloc.AllocationSize.QuadPart = LONGLONG(expectedSize);
+    SetFileInformationByHandle(handle, FileAllocationInfo, &alloc, sizeof(alloc));
+  }
+#else
+  m_fd = ::open(m_partPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (m_fd < 0) {
+    _fail(_SYS_STR("create"));
+    return;
+  }
+  if (expectedSize) {
+    /* Preallocation is advisory; filesystems without support simply allocate on write */
+#if __linux__
+    fallocate(m_fd, FALLOC_FL_KEEP_SIZE, 0, off_t(expectedSize));
+#elif __APPLE__
+    fstore_t store = {F_ALLOCATECONTIG, F_PEOFPOSMODE, 0, off_t(expectedSize), 0};
+    if (fcntl(m_fd, F_PREALLOCATE, &store) == -1) {
+      store.fst_flags = F_ALLOCATEALL;
+      fcntl(m_fd, F_PREALLOCATE, &store);
+    }
+#endif
+  }
+#endif
+}
+
+PackageWriter::~PackageWriter() {
+#if _WIN32
+  const bool open = m_handle != nullptr;
+#else
+  const bool open = m_fd >= 0;
+#endif
+  if (open) {
+    _close();
+    hecl::Unlink(m_partPath.c_str());
+  }
+}
+
+PackageWriter::operator bool() const {
+#if _WIN32
+  return m_handle && !m_failed;
+#else
+  return m_fd >= 0 && !m_failed;
+#endif
+}
+
+void PackageWriter::_close() {
+#if _WIN32
+  if (m_handle) {
+    CloseHandle(m_handle);
+    m_handle = nullptr;
+  }
+#else
+  if (m_fd >= 0) {
+    ::close(m_fd);
+    m_fd = -1;
+  }
+#endif
+}
+
+bool PackageWriter::_fail(const SystemChar* op) {
+#if _WIN32
+  const unsigned long err = GetLastError();
+#else
+  const int err = errno;
+#endif
+  /* Only the first failure is reported; later writes on other threads are usually fallout */
+  if (!m_failed.exchange(true))
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to {} package '{}' ({})")), op, m_partPath, err);
+  return false;
+}
+
+void PackageWriter::_extend(uint64_t end) {
+  uint64_t cur = m_end.load();
+  while (cur < end && !m_end.compare_exchange_weak(cur, end)) {}
+}
+
+uint64_t PackageWriter::reserve(uint64_t size, uint64_t alignment) {
+  uint64_t cur = m_reserved.load();
+  uint64_t offset;
+  do {
+    offset = llvm::alignTo(cur, std::max<uint64_t>(alignment, 1));
+  } while (!m_reserved.compare_exchange_weak(cur, offset + size));
+  return offset;
+}
+
+bool PackageWriter::write(uint64_t offset, const void* data, size_t len) {
+  if (!*this)
+    return false;
+#if _WIN32
+  if (!WriteAt(HANDLE(m_handle), offset, data, len))
+#else
+  if (!WriteAt(m_fd, offset, data, len))
+#endif
+    return _fail(_SYS_STR("write"));
+  _extend(offset + len);
+  return true;
+}
+
+bool PackageWriter::write(uint64_t offset, const Segment* segs, size_t count) {
+  if (!*this)
+    return false;
+#if __linux__ || __FreeBSD__
+  /* Gather as many segments per call as the kernel accepts, resuming mid-segment on short writes */
+  std::unique_ptr<iovec[]> iov(new iovec[std::min<size_t>(count, IOV_MAX)]);
+  size_t segIdx = 0;
+  size_t segPos = 0;
+  while (segIdx < count) {
+    int iovCount = 0;
+    size_t total = 0;
+    for (size_t i = segIdx; i < count && iovCount < IOV_MAX; ++i) {
+      const size_t skip = i == segIdx ? segPos : 0;
+      iov[iovCount].iov_base = const_cast<uint8_t*>(static_cast<const uint8_t*>(segs[i].m_data) + skip);
+      iov[iovCount].iov_len = segs[i].m_len - skip;
+      total += iov[iovCount].iov_len;
+      ++iovCount;
+    }
+    if (total == 0) {
+      segIdx += size_t(iovCount);
+      segPos = 0;
+      continue;
+    }
+    const ssize_t written = pwritev(m_fd, iov.get(), iovCount, off_t(offset));
+    if (written < 0 && errno == EINTR)
+      continue;
+    if (written <= 0)
+      return _fail(_SYS_STR("write"));
+    offset += uint64_t(written);
+    size_t remaining = size_t(written);
+    while (segIdx < count && remaining >= segs[segIdx].m_len - segPos) {
+      remaining -= segs[segIdx].m_len - segPos;
+      ++segIdx;
+      segPos = 0;
+    }
+    segPos += remaining;
+  }
+  _extend(offset);
+  return true;
+#else
+  for (size_t i = 0; i < count; ++i) {
+    if (!write(offset, segs[i].m_data, segs[i].m_len))
+      return false;
+    offset += segs[i].m_len;
+  }
+  return true;
+#endif
+}
+
+bool PackageWriter::copyFrom(SystemStringView srcPath, uint64_t srcOffset, uint64_t len, uint64_t offset) {
+  if (!*this)
+    return false;
+  const SystemString src(srcPath);
+
+#if _WIN32
+  HANDLE srcHandle = CreateFileW(src.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                 nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (srcHandle == INVALID_HANDLE_VALUE) {
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to open '{}' for packaging")), src);
+    m_failed = true;
+    return false;
+  }
+  std::unique_ptr<uint8_t[]> buf(new uint8_t[CopyBufferSize]);
+  uint64_t done = 0;
+  while (done < len) {
+    OVERLAPPED ov = {};
+    ov.Offset = DWORD(srcOffset + done);
+    ov.OffsetHigh = DWORD((srcOffset + done) >> 32);
+    DWORD got = 0;
+    if (!ReadFile(srcHandle, buf.get(), DWORD(std::min<uint64_t>(len - done, CopyBufferSize)), &got, &ov) ||
+        got == 0)
+      break;
+    if (!WriteAt(HANDLE(m_handle), offset + done, buf.get(), got)) {
+      CloseHandle(srcHandle);
+      return _fail(_SYS_STR("write"));
+    }
+    done += got;
+  }
+  CloseHandle(srcHandle);
+#else
+  const int srcFd = ::open(src.c_str(), O_RDONLY | O_CLOEXEC);
+  if (srcFd < 0) {
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to open '{}' for packaging")), src);
+    m_failed = true;
+    return false;
+  }
+  uint64_t done = 0;
+#if __linux__
+  /* Both offsets are explicit, so concurrent copies never touch a shared file position */
+  while (done < len) {
+    loff_t inOff = loff_t(srcOffset + done);
+    loff_t outOff = loff_t(offset + done);
+    const ssize_t copied = copy_file_range(srcFd, &inOff, m_fd, &outOff, size_t(len - done), 0);
+    if (copied < 0 && errno == EINTR)
+      continue;
+    if (copied <= 0)
+      break;
+    done += uint64_t(copied);
+  }
+#endif
+  /* Filesystems or kernels that can't copy_file_range fail immediately; finish with buffered I/O */
+  if (done < len) {
+    std::unique_ptr<uint8_t[]> buf(new uint8_t[CopyBufferSize]);
+    while (done < len) {
+      const ssize_t got = pread(srcFd, buf.get(), size_t(std::min<uint64_t>(len - done, CopyBufferSize)),
+                                off_t(srcOffset + done));
+      if (got < 0 && errno == EINTR)
+        continue;
+      if (got <= 0)
+        break;
+      if (!WriteAt(m_fd, offset + done, buf.get(), size_t(got))) {
+        ::close(srcFd);
+        return _fail(_SYS_STR("write"));
+      }
+      done += uint64_t(got);
+    }
+  }
+  ::close(srcFd);
+#endif
+
+  if (done < len) {
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("'{}' is shorter than the {} bytes being packaged")), src, len);
+    m_failed = true;
+    return false;
+  }
+  _extend(offset + len);
+  return true;
+}
+
+bool PackageWriter::finish() {
+  if (!*this)
+    return false;
+
+  /* Drop any preallocation beyond the final extent */
+  const uint64_t end = m_end.load();
+#if _WIN32
+  FILE_END_OF_FILE_INFO eof = {};
+  eof.EndOfFile.QuadPart = LONGLONG(end);
+  if (!SetFileInformationByHandle(HANDLE(m_handle), FileEndOfFileInfo, &eof, sizeof(eof)))
+    return _fail(_SYS_STR("truncate"));
+#else
+  if (ftruncate(m_fd, off_t(end)))
+    return _fail(_SYS_STR("truncate"));
+#endif
+  _close();
+
+  if (hecl::Rename(m_partPath.c_str(), m_path.c_str())) {
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to rename '{}' to '{}'")), m_partPath, m_path);
+    hecl::Unlink(m_partPath.c_str());
+    m_failed = true;
+    return false;
+  }
+  return true;
+}
+
+} // namespace hecl::Database
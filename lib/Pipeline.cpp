@@ -1,10 +1,299 @@
 #include "hecl/Pipeline.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <thread>
+
+#include "hecl/ClientProcess.hpp"
+
 #include <athena/FileReader.hpp>
 #include <zlib.h>
 
 namespace hecl {
 
+void StageCompileBatch::run(bool parallel, const ProgressFunc& progress) {
+  const size_t total = m_compiles.size();
+  std::atomic_size_t next = 0;
+  std::atomic_size_t completed = 0;
+  std::mutex progressMutex;
+  const auto work = [&]() {
+    for (size_t i; (i = next++) < total;) {
+      m_compiles[i]();
+      const size_t done = ++completed;
+      if (progress) {
+        std::unique_lock lk{progressMutex};
+        progress(done, total);
+      }
+    }
+  };
+
+  size_t threadCount = 1;
+  if (parallel) {
+    threadCount = CpuCountOverride > 0 ? size_t(CpuCountOverride) : size_t(std::thread::hardware_concurrency());
+    threadCount = std::max(std::min(threadCount, total), size_t(1));
+  }
+  std::vector<std::thread> threads;
+  threads.reserve(threadCount - 1);
+  for (size_t i = 1; i < threadCount; ++i)
+    threads.emplace_back(work);
+  work();
+  for (std::thread& thread : threads)
+    thread.join();
+
+  for (const auto& insert : m_inserts)
+    insert();
+  m_compiles.clear();
+  m_inserts.clear();
+}
+
+struct PipelineConverterBase::AsyncWorker {
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::deque<std::function<void()>> m_jobs;
+  bool m_stop = false;
+  std::thread m_thread;
+
+  AsyncWorker() : m_thread([this]() { run(); }) {}
+  ~AsyncWorker() {
+    {
+      std::unique_lock lk{m_mutex};
+      m_stop = true;
+    }
+    m_cv.notify_one();
+    m_thread.join();
+  }
+
+  /* Queued jobs still run after a stop, so no token is left waiting forever */
+  void run() {
+    for (;;) {
+      std::function<void()> job;
+      {
+        std::unique_lock lk{m_mutex};
+        m_cv.wait(lk, [this]() { return m_stop || !m_jobs.empty(); });
+        if (m_jobs.empty())
+          return;
+        job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+      }
+      job();
+    }
+  }
+
+  void push(std::function<void()> job) {
+    {
+      std::unique_lock lk{m_mutex};
+      m_jobs.push_back(std::move(job));
+    }
+    m_cv.notify_one();
+  }
+};
+
+PipelineConverterBase::~PipelineConverterBase() { _stopAsync(); }
+
+void PipelineConverterBase::_stopAsync() {
+  std::unique_ptr<AsyncWorker> worker;
+  {
+    std::unique_lock lk{m_asyncMutex};
+    worker = std::move(m_asyncWorker);
+  }
+}
+
+void PipelineConverterBase::_queueAsync(std::function<void()> job) {
+  std::unique_lock lk{m_asyncMutex};
+  if (!m_asyncWorker)
+    m_asyncWorker = std::make_unique<AsyncWorker>();
+  m_asyncWorker->push(std::move(job));
+}
+
+const uint8_t* StageBlobTable::_inflate(size_t idx) const {
+  Slot& slot = m_slots[idx];
+  std::call_once(slot.m_once, [&]() {
+    const StageBlobEntry& ent = m_entries[idx];
+    StageBinaryData data = MakeStageBinaryData(ent.rawSize);
+    uLongf destLen = ent.rawSize;
+    if (uncompress(data.get(), &destLen, m_blob + ent.offset, ent.size) != Z_OK || destLen != ent.rawSize) {
+      LogModule.report(logvisor::Fatal, FMT_STRING("corrupt embedded stage binary {}"), idx);
+      return;
+    }
+    slot.m_data = std::move(data);
+  });
+  return slot.m_data.get();
+}
+
+constexpr uint32_t ShaderCacheFileMagic = 'SHDI';
+constexpr uint32_t ShaderCacheFileVersion = 1;
+
+namespace {
+/* Big-endian record header preceding each compressed binary */
+struct ShaderCacheRecord {
+  uint32_t stage;
+  uint32_t compSize;
+  uint32_t rawSize;
+  uint32_t checksum;
+  uint64_t hash;
+
+  void swap() {
+    stage = SBig(stage);
+    compSize = SBig(compSize);
+    rawSize = SBig(rawSize);
+    checksum = SBig(checksum);
+    hash = SBig(hash);
+  }
+};
+static_assert(sizeof(ShaderCacheRecord) == 24, "unexpected ShaderCacheRecord padding");
+} // anonymous namespace
+
+bool ShaderCacheFile::open(const SystemChar* path) {
+  std::unique_lock lk{m_mutex};
+  for (auto& index : m_index)
+    index.clear();
+  m_path = path;
+  m_fp = FopenUnique(path, _SYS_STR("r+b"));
+
+  uint32_t header[2] = {};
+  if (m_fp && std::fread(header, 1, sizeof(header), m_fp.get()) == sizeof(header) &&
+      SBig(header[0]) == ShaderCacheFileMagic && SBig(header[1]) == ShaderCacheFileVersion) {
+    FSeek(m_fp.get(), 0, SEEK_END);
+    const uint64_t fileSize = uint64_t(FTell(m_fp.get()));
+    uint64_t pos = sizeof(header);
+    FSeek(m_fp.get(), int64_t(pos), SEEK_SET);
+    ShaderCacheRecord rec;
+    /* Stop at the first malformed header; a torn trailing append is overwritten by the next one */
+    while (std::fread(&rec, 1, sizeof(rec), m_fp.get()) == sizeof(rec)) {
+      rec.swap();
+      if (rec.stage >= std::size(m_index) || pos + sizeof(rec) + rec.compSize > fileSize)
+        break;
+      m_index[rec.stage][rec.hash] = Entry{pos + sizeof(rec), rec.compSize, rec.rawSize, rec.checksum};
+      pos += sizeof(rec) + rec.compSize;
+      FSeek(m_fp.get(), int64_t(pos), SEEK_SET);
+    }
+    m_end = pos;
+    return true;
+  }
+
+  /* Missing or foreign file; start a fresh one */
+  m_fp = FopenUnique(path, _SYS_STR("w+b"));
+  if (!m_fp)
+    return false;
+  header[0] = SBig(ShaderCacheFileMagic);
+  header[1] = SBig(ShaderCacheFileVersion);
+  std::fwrite(header, 1, sizeof(header), m_fp.get());
+  std::fflush(m_fp.get());
+  m_end = sizeof(header);
+  return true;
+}
+
+std::optional<std::pair<StageBinaryData, size_t>> ShaderCacheFile::read(boo::PipelineStage stage, uint64_t hash) {
+  std::unique_ptr<uint8_t[]> comp;
+  Entry ent;
+  {
+    std::unique_lock lk{m_mutex};
+    if (!m_fp)
+      return {};
+    auto& index = m_index[int(stage)];
+    auto search = index.find(hash);
+    if (search == index.end())
+      return {};
+    ent = search->second;
+    comp = std::make_unique<uint8_t[]>(ent.m_compSize);
+    FSeek(m_fp.get(), int64_t(ent.m_offset), SEEK_SET);
+    if (std::fread(comp.get(), 1, ent.m_compSize, m_fp.get()) != ent.m_compSize)
+      return {};
+  }
+
+  if (XXH32(comp.get(), ent.m_compSize, 0) != ent.m_checksum)
+    return {};
+  StageBinaryData data = MakeStageBinaryData(ent.m_rawSize);
+  uLongf rawSize = ent.m_rawSize;
+  if (uncompress(data.get(), &rawSize, comp.get(), ent.m_compSize) != Z_OK || rawSize != ent.m_rawSize)
+    return {};
+  return std::make_pair(std::move(data), size_t(ent.m_rawSize));
+}
+
+void ShaderCacheFile::append(boo::PipelineStage stage, uint64_t hash, const uint8_t* data, size_t size) {
+  uLongf compSize = compressBound(uLong(size));
+  auto comp = std::make_unique<uint8_t[]>(compSize);
+  if (compress2(comp.get(), &compSize, data, uLong(size), Z_BEST_SPEED) != Z_OK)
+    return;
+
+  ShaderCacheRecord rec{uint32_t(stage), uint32_t(compSize), uint32_t(size), XXH32(comp.get(), compSize, 0), hash};
+  rec.swap();
+
+  std::unique_lock lk{m_mutex};
+  auto& index = m_index[int(stage)];
+  if (!m_fp || index.find(hash) != index.end())
+    return;
+  FSeek(m_fp.get(), int64_t(m_end), SEEK_SET);
+  if (std::fwrite(&rec, 1, sizeof(rec), m_fp.get()) != sizeof(rec) ||
+      std::fwrite(comp.get(), 1, compSize, m_fp.get()) != compSize)
+    return;
+  std::fflush(m_fp.get());
+  index[hash] = Entry{m_end + sizeof(rec), uint32_t(compSize), uint32_t(size), SBig(rec.checksum)};
+  m_end += sizeof(rec) + compSize;
+}
+
+bool ShaderCacheFile::prune(const KeepFunc& keep, size_t& removed) {
+  removed = 0;
+  std::unique_lock lk{m_mutex};
+  if (!m_fp)
+    return false;
+
+  const SystemString tmpPath = m_path + _SYS_STR(".tmp");
+  auto out = FopenUnique(tmpPath.c_str(), _SYS_STR("wb"));
+  if (!out)
+    return false;
+  const uint32_t header[2] = {SBig(ShaderCacheFileMagic), SBig(ShaderCacheFileVersion)};
+  bool good = std::fwrite(header, 1, sizeof(header), out.get()) == sizeof(header);
+
+  decltype(m_index) index;
+  uint64_t end = sizeof(header);
+  std::vector<uint8_t> comp;
+  for (size_t stage = 0; good && stage < std::size(m_index); ++stage) {
+    for (const auto& [hash, ent] : m_index[stage]) {
+      if (!keep(boo::PipelineStage(stage), hash)) {
+        ++removed;
+        continue;
+      }
+      comp.resize(ent.m_compSize);
+      FSeek(m_fp.get(), int64_t(ent.m_offset), SEEK_SET);
+      ShaderCacheRecord rec{uint32_t(stage), ent.m_compSize, ent.m_rawSize, ent.m_checksum, hash};
+      rec.swap();
+      if (std::fread(comp.data(), 1, comp.size(), m_fp.get()) != comp.size() ||
+          std::fwrite(&rec, 1, sizeof(rec), out.get()) != sizeof(rec) ||
+          std::fwrite(comp.data(), 1, comp.size(), out.get()) != comp.size()) {
+        good = false;
+        break;
+      }
+      index[stage][hash] = Entry{end + sizeof(rec), ent.m_compSize, ent.m_rawSize, ent.m_checksum};
+      end += sizeof(rec) + ent.m_compSize;
+    }
+  }
+  good = std::fclose(out.release()) == 0 && good;
+  if (!good) {
+    Unlink(tmpPath.c_str());
+    removed = 0;
+    return false;
+  }
+
+  /* Windows can't rename over an open file */
+  m_fp.reset();
+  const bool renamed = Rename(tmpPath.c_str(), m_path.c_str()) == 0;
+  m_fp = FopenUnique(m_path.c_str(), _SYS_STR("r+b"));
+  if (!renamed) {
+    Unlink(tmpPath.c_str());
+    removed = 0;
+    return false;
+  }
+  for (size_t stage = 0; stage < std::size(m_index); ++stage)
+    m_index[stage] = std::move(index[stage]);
+  m_end = end;
+  return m_fp.operator bool();
+}
+
 #if HECL_RUNTIME
 
 PipelineConverterBase* conv = nullptr;
@@ -56,7 +345,8 @@ void StageConverter<P, S>::loadFromStream(FactoryCtx& ctx, ShaderCacheZipStream&
     uint32_t size = r.readUint32Big();
     StageBinaryData data = MakeStageBinaryData(size);
     r.readUBytesToBuf(data.get(), size);
-    m_stageCache.insert(std::make_pair(hash, Do<StageTargetTp>(ctx, StageBinary<P, S>(data, size))));
+    m_stageCache.insert(hash, Do<StageTargetTp>(ctx, StageBinary<P, S>(data, size)));
+    PipelineStats::RecordLoaded(size_t(S::Enum), hash);
   }
 }
 
@@ -111,29 +401,43 @@ bool PipelineConverter<P>::loadFromFile(FactoryCtx& ctx, const hecl::SystemChar*
     StageRuntimeObject<P, PipelineStage::Control> control;
     StageRuntimeObject<P, PipelineStage::Evaluation> evaluation;
     if (uint64_t vhash = r.readUint64Big())
-      vertex = m_vertexConverter.m_stageCache.find(vhash)->second;
+      vertex = *m_vertexConverter.m_stageCache.find(vhash);
     if (uint64_t fhash = r.readUint64Big())
-      fragment = m_fragmentConverter.m_stageCache.find(fhash)->second;
+      fragment = *m_fragmentConverter.m_stageCache.find(fhash);
     if (uint64_t ghash = r.readUint64Big())
-      geometry = m_geometryConverter.m_stageCache.find(ghash)->second;
+      geometry = *m_geometryConverter.m_stageCache.find(ghash);
     if (uint64_t chash = r.readUint64Big())
-      control = m_controlConverter.m_stageCache.find(chash)->second;
+      control = *m_controlConverter.m_stageCache.find(chash);
     if (uint64_t ehash = r.readUint64Big())
-      evaluation = m_evaluationConverter.m_stageCache.find(ehash)->second;
+      evaluation = *m_evaluationConverter.m_stageCache.find(ehash);
 
     boo::AdditionalPipelineInfo additionalInfo = ReadAdditionalInfo(r);
     std::vector<boo::VertexElementDescriptor> vtxFmt = ReadVertexFormat(r);
 
-    m_pipelineCache.insert(
-        std::make_pair(hash, FinalPipeline<P>(*this, ctx,
-                                              StageCollection<StageRuntimeObject<P, PipelineStage::Null>>(
-                                                  vertex, fragment, geometry, control, evaluation, additionalInfo,
-                                                  boo::VertexFormatInfo(vtxFmt.size(), vtxFmt.data())))));
+    m_pipelineCache.insert(hash, FinalPipeline<P>(*this, ctx,
+                                                  StageCollection<StageRuntimeObject<P, PipelineStage::Null>>(
+                                                      vertex, fragment, geometry, control, evaluation, additionalInfo,
+                                                      boo::VertexFormatInfo(vtxFmt.size(), vtxFmt.data()))));
+    PipelineStats::RecordLoaded(PipelineStats::PipelineSlot, hash);
   }
 
   return true;
 }
 
+template <typename P>
+bool PipelineConverter<P>::openCacheFile(const hecl::SystemChar* path) {
+  auto file = std::make_unique<ShaderCacheFile>();
+  if (!file->open(path))
+    return false;
+  m_cacheFile = std::move(file);
+  m_vertexConverter.m_cacheFile = m_cacheFile.get();
+  m_fragmentConverter.m_cacheFile = m_cacheFile.get();
+  m_geometryConverter.m_cacheFile = m_cacheFile.get();
+  m_controlConverter.m_cacheFile = m_cacheFile.get();
+  m_evaluationConverter.m_cacheFile = m_cacheFile.get();
+  return true;
+}
+
 #define SPECIALIZE_STAGE_CONVERTER(P)                                                                                  \
   template class StageConverter<P, PipelineStage::Vertex>;                                                             \
   template class StageConverter<P, PipelineStage::Fragment>;                                                           \
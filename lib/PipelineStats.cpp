@@ -0,0 +1,184 @@
+#include "hecl/PipelineStats.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <unordered_map>
+
+#include "hecl/Console.hpp"
+#include "hecl/hecl.hpp"
+
+namespace hecl::PipelineStats {
+
+namespace {
+struct Slot {
+  std::unordered_map<uint64_t, Entry> m_entries;
+  uint64_t m_fileHits = 0;
+  uint64_t m_fileMisses = 0;
+};
+
+/* Bumped on every hit without the registry lock; padded so slots don't share a cache line */
+struct alignas(64) HitCounter {
+  std::atomic_uint64_t m_hits = 0;
+};
+
+struct Registry {
+  std::mutex m_mutex;
+  Slot m_slots[SlotCount];
+  HitCounter m_hits[SlotCount];
+  std::atomic_bool m_detailed = false;
+};
+
+/* Converters are often globals; construct on first use to sidestep static init order */
+Registry& Stats() {
+  static Registry registry;
+  return registry;
+}
+
+constexpr const char* SlotNames[SlotCount] = {"null", "vertex", "fragment", "geometry", "control", "evaluation",
+                                              "pipeline"};
+} // anonymous namespace
+
+void SetDetailed(bool detailed) { Stats().m_detailed.store(detailed, std::memory_order_relaxed); }
+
+bool IsDetailed() { return Stats().m_detailed.load(std::memory_order_relaxed); }
+
+void RecordLookup(size_t slot, uint64_t hash, bool miss, uint64_t missNs) {
+  Registry& reg = Stats();
+  if (!miss) {
+    reg.m_hits[slot].m_hits.fetch_add(1, std::memory_order_relaxed);
+    if (!reg.m_detailed.load(std::memory_order_relaxed))
+      return;
+  }
+  std::lock_guard lk{reg.m_mutex};
+  Entry& entry = reg.m_slots[slot].m_entries[hash];
+  entry.m_hash = hash;
+  if (miss) {
+    ++entry.m_misses;
+    entry.m_missNs += missNs;
+    entry.m_slowestMissNs = std::max(entry.m_slowestMissNs, missNs);
+  } else {
+    ++entry.m_hits;
+  }
+}
+
+void RecordLoaded(size_t slot, uint64_t hash) {
+  Registry& reg = Stats();
+  std::lock_guard lk{reg.m_mutex};
+  Entry& entry = reg.m_slots[slot].m_entries[hash];
+  entry.m_hash = hash;
+  entry.m_loaded = true;
+}
+
+void RecordCacheFile(size_t slot, bool hit) {
+  Registry& reg = Stats();
+  std::lock_guard lk{reg.m_mutex};
+  ++(hit ? reg.m_slots[slot].m_fileHits : reg.m_slots[slot].m_fileMisses);
+}
+
+Summary Summarize(size_t slot) {
+  Registry& reg = Stats();
+  std::lock_guard lk{reg.m_mutex};
+  const Slot& s = reg.m_slots[slot];
+  Summary ret;
+  ret.m_hits = reg.m_hits[slot].m_hits.load(std::memory_order_relaxed);
+  ret.m_fileHits = s.m_fileHits;
+  ret.m_fileMisses = s.m_fileMisses;
+  for (const auto& [hash, entry] : s.m_entries) {
+    ret.m_misses += entry.m_misses;
+    ret.m_missNs += entry.m_missNs;
+    ret.m_slowestMissNs = std::max(ret.m_slowestMissNs, entry.m_slowestMissNs);
+    if (entry.m_loaded) {
+      ++ret.m_loaded;
+      if (!entry.m_hits && !entry.m_misses)
+        ++ret.m_loadedUnused;
+    }
+  }
+  return ret;
+}
+
+std::vector<Entry> Entries(size_t slot) {
+  std::vector<Entry> ret;
+  {
+    Registry& reg = Stats();
+    std::lock_guard lk{reg.m_mutex};
+    ret.reserve(reg.m_slots[slot].m_entries.size());
+    for (const auto& [hash, entry] : reg.m_slots[slot].m_entries)
+      ret.push_back(entry);
+  }
+  std::sort(ret.begin(), ret.end(), [](const Entry& a, const Entry& b) {
+    return a.m_missNs != b.m_missNs ? a.m_missNs > b.m_missNs : a.m_hash < b.m_hash;
+  });
+  return ret;
+}
+
+void Reset() {
+  Registry& reg = Stats();
+  std::lock_guard lk{reg.m_mutex};
+  for (Slot& slot : reg.m_slots)
+    slot = Slot();
+  for (HitCounter& counter : reg.m_hits)
+    counter.m_hits.store(0, std::memory_order_relaxed);
+}
+
+bool Dump(const SystemChar* path) {
+  auto fp = hecl::FopenUnique(path, _SYS_STR("w"));
+  if (!fp)
+    return false;
+  std::fputs("cache,hash,hits,misses,miss_ms,slowest_miss_ms,loaded\n", fp.get());
+  for (size_t slot = 1; slot < SlotCount; ++slot) {
+    for (const Entry& entry : Entries(slot)) {
+      const std::string line =
+          fmt::format(FMT_STRING("{},{:016X},{},{},{:.3f},{:.3f},{}\n"), SlotNames[slot], entry.m_hash, entry.m_hits,
+                      entry.m_misses, entry.m_missNs / 1000000.0, entry.m_slowestMissNs / 1000000.0,
+                      int(entry.m_loaded));
+      std::fputs(line.c_str(), fp.get());
+    }
+  }
+  return std::fclose(fp.release()) == 0;
+}
+
+void RegisterCommands(Console& console) {
+  console.registerCommand(
+      "pipelineStats", "Prints shader stage and pipeline cache hit rates, or dumps every entry as CSV",
+      "[dump <path>|reset|detail <on|off>]", [](Console* con, const std::vector<std::string>& args) {
+        if (!args.empty() && args[0] == "reset") {
+          Reset();
+          con->report(Console::Level::Info, FMT_STRING("Pipeline stats reset"));
+          return;
+        }
+        if (args.size() >= 2 && args[0] == "detail") {
+          SetDetailed(args[1] == "on");
+          con->report(Console::Level::Info, FMT_STRING("Per-hash hit counting {}"), IsDetailed() ? "on" : "off");
+          return;
+        }
+        if (args.size() >= 2 && args[0] == "dump") {
+          if (Dump(SystemStringConv(args[1]).c_str()))
+            con->report(Console::Level::Info, FMT_STRING("Pipeline stats written to '{}'"), args[1]);
+          else
+            con->report(Console::Level::Error, FMT_STRING("Unable to write pipeline stats to '{}'"), args[1]);
+          return;
+        }
+
+        for (size_t slot = 1; slot < SlotCount; ++slot) {
+          const Summary st = Summarize(slot);
+          if (!st.m_hits && !st.m_misses && !st.m_loaded)
+            continue;
+          const uint64_t lookups = st.m_hits + st.m_misses;
+          con->report(Console::Level::Info,
+                      FMT_STRING("{}: {} lookups, {:.1f}% hit, {} misses costing {:.1f} ms (slowest {:.1f} ms)"),
+                      SlotNames[slot], lookups, lookups ? st.m_hits * 100.0 / lookups : 0.0, st.m_misses,
+                      st.m_missNs / 1000000.0, st.m_slowestMissNs / 1000000.0);
+          if (IsDetailed())
+            con->report(Console::Level::Info,
+                        FMT_STRING("  {} preloaded, {} never used; cache file {} hits, {} misses"), st.m_loaded,
+                        st.m_loadedUnused, st.m_fileHits, st.m_fileMisses);
+          else
+            con->report(Console::Level::Info, FMT_STRING("  {} preloaded; cache file {} hits, {} misses"),
+                        st.m_loaded, st.m_fileHits, st.m_fileMisses);
+        }
+      });
+}
+
+} // namespace hecl::PipelineStats
@@ -1,11 +1,17 @@
 #include <sys/stat.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cerrno>
 #include <cstdio>
 #include <cstring>
+#include <limits>
+#include <memory>
 #include <string>
 #include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 
 #if _WIN32
 #else
@@ -14,8 +20,10 @@
 
 #include "hecl/ClientProcess.hpp"
 #include "hecl/Database.hpp"
+#include "hecl/DirectoryWalker.hpp"
 #include "hecl/Blender/Connection.hpp"
 #include "hecl/MultiProgressPrinter.hpp"
+#include "hecl/Trace.hpp"
 
 #include <logvisor/logvisor.hpp>
 
@@ -24,6 +32,23 @@ namespace hecl::Database {
 logvisor::Module LogModule("hecl::Database");
 constexpr hecl::FourCC HECLfcc("HECL");
 
+/**********************************************
+ * IDataSpec
+ **********************************************/
+
+Cost IDataSpec::getCookCost(const ProjectPath& path) const {
+  if (path.getPathType() == ProjectPath::Type::Directory)
+    return Cost::Medium;
+  const SystemStringView ext = path.getLastComponentExt();
+  if (ext.empty())
+    return Cost::Light;
+  if (!hecl::StrCaseCmp(ext.data(), _SYS_STR("blend")))
+    return Cost::Heavy;
+  if (!hecl::StrCaseCmp(ext.data(), _SYS_STR("png")) || !hecl::StrCaseCmp(ext.data(), _SYS_STR("tga")))
+    return Cost::Medium;
+  return Cost::Light;
+}
+
 /**********************************************
  * Project::ConfigFile
  **********************************************/
@@ -43,29 +68,23 @@ static bool CheckNewLineAdvance(std::string::const_iterator& it) {
   return false;
 }
 
-Project::ConfigFile::ConfigFile(const Project& project, SystemStringView name, SystemStringView subdir) {
-  m_filepath = SystemString(project.m_rootPath.getAbsolutePath()) + subdir.data() + name.data();
-}
-
-std::vector<std::string>& Project::ConfigFile::lockAndRead() {
-  if (m_lockedFile != nullptr) {
-    return m_lines;
-  }
-
-  m_lockedFile = hecl::FopenUnique(m_filepath.c_str(), _SYS_STR("a+"), FileLockType::Write);
-  hecl::FSeek(m_lockedFile.get(), 0, SEEK_SET);
-
-  std::string mainString;
-  char readBuf[1024];
-  size_t readSz;
-  while ((readSz = std::fread(readBuf, 1, sizeof(readBuf), m_lockedFile.get()))) {
-    mainString += std::string(readBuf, readSz);
+static std::string ReadConfigContents(FILE* fp) {
+  std::string ret;
+  hecl::FSeek(fp, 0, SEEK_END);
+  const auto size = hecl::FTell(fp);
+  hecl::FSeek(fp, 0, SEEK_SET);
+  if (size > 0) {
+    ret.resize(size_t(size));
+    ret.resize(std::fread(ret.data(), 1, ret.size(), fp));
   }
+  return ret;
+}
 
+static void SplitConfigLines(const std::string& mainString, std::vector<std::string>& lines) {
   auto begin = mainString.cbegin();
   auto end = mainString.cbegin();
 
-  m_lines.clear();
+  lines.clear();
   while (end != mainString.end()) {
     auto origEnd = end;
     if (*end == '\0') {
@@ -73,7 +92,7 @@ std::vector<std::string>& Project::ConfigFile::lockAndRead() {
     }
     if (CheckNewLineAdvance(end)) {
       if (begin != origEnd) {
-        m_lines.emplace_back(begin, origEnd);
+        lines.emplace_back(begin, origEnd);
       }
       begin = end;
       continue;
@@ -81,12 +100,50 @@ std::vector<std::string>& Project::ConfigFile::lockAndRead() {
     ++end;
   }
   if (begin != end) {
-    m_lines.emplace_back(begin, end);
+    lines.emplace_back(begin, end);
   }
+}
+
+Project::ConfigFile::ConfigFile(const Project& project, SystemStringView name, SystemStringView subdir) {
+  m_filepath = SystemString(project.m_rootPath.getAbsolutePath()) + subdir.data() + name.data();
+}
 
+std::vector<std::string>& Project::ConfigFile::lockAndRead() {
+  if (m_lockedFile != nullptr) {
+    return m_lines;
+  }
+
+  m_lockedFile = hecl::FopenUnique(m_filepath.c_str(), _SYS_STR("a+"), FileLockType::Write);
+  SplitConfigLines(ReadConfigContents(m_lockedFile.get()), m_lines);
   return m_lines;
 }
 
+std::shared_ptr<const Project::ConfigFile::Snapshot> Project::ConfigFile::read() const {
+  Sstat theStat;
+  const bool exists = !hecl::Stat(m_filepath.c_str(), &theStat);
+  const int64_t mtime = exists ? int64_t(theStat.st_mtime) : 0;
+  const uint64_t size = exists ? uint64_t(theStat.st_size) : 0;
+
+  std::unique_lock lk{m_snapshotMutex};
+  if (m_snapshot && m_snapshotMtime == mtime && m_snapshotSize == size)
+    return m_snapshot;
+
+  /* Lines are filled in place; lineSet views them, so the snapshot must not move afterwards */
+  auto snapshot = std::make_shared<Snapshot>();
+  if (exists) {
+    if (auto fp = hecl::FopenUnique(m_filepath.c_str(), _SYS_STR("rb")))
+      SplitConfigLines(ReadConfigContents(fp.get()), snapshot->lines);
+  }
+  snapshot->lineSet.reserve(snapshot->lines.size());
+  for (const std::string& line : snapshot->lines)
+    snapshot->lineSet.insert(line);
+
+  m_snapshot = std::move(snapshot);
+  m_snapshotMtime = mtime;
+  m_snapshotSize = size;
+  return m_snapshot;
+}
+
 void Project::ConfigFile::addLine(std::string_view line) {
   if (!checkForLine(line))
     m_lines.emplace_back(line);
@@ -108,10 +165,8 @@ void Project::ConfigFile::removeLine(std::string_view refLine) {
 }
 
 bool Project::ConfigFile::checkForLine(std::string_view refLine) const {
-  if (!m_lockedFile) {
-    LogModule.reportSource(logvisor::Fatal, __FILE__, __LINE__, FMT_STRING("Project::ConfigFile::lockAndRead not yet called"));
-    return false;
-  }
+  if (!m_lockedFile)
+    return read()->contains(refLine);
 
   return std::any_of(m_lines.cbegin(), m_lines.cend(), [&refLine](const auto& line) { return line == refLine; });
 }
@@ -148,6 +203,11 @@ bool Project::ConfigFile::unlockAndCommit() {
   m_lines.clear();
   newFile.reset();
   m_lockedFile.reset();
+  {
+    /* Modtime granularity may hide a same-size rewrite from read(); never serve our own stale copy */
+    std::unique_lock lk{m_snapshotMutex};
+    m_snapshot.reset();
+  }
   if (fail) {
 #if HECL_UCS2
     _wunlink(newPath.c_str());
@@ -175,9 +235,18 @@ Project::Project(const ProjectRootPath& rootPath)
 , m_workRoot(*this, _SYS_STR(""))
 , m_dotPath(m_workRoot, _SYS_STR(".hecl"))
 , m_cookedRoot(m_dotPath, _SYS_STR("cooked"))
+, m_bridgePathCache(*this)
+, m_cookedStore(*this)
+, m_cookCache(*this, m_cookedStore, m_extractDedup)
+, m_cookTimings(*this)
+, m_extractDedup(*this)
+, m_textureService(*this)
 , m_specs(*this, _SYS_STR("specs"))
 , m_paths(*this, _SYS_STR("paths"))
 , m_groups(*this, _SYS_STR("groups")) {
+  /* Cooked output and cache bookkeeping change while cooking; never memoize them */
+  m_statCache.setExcludedPrefix(m_dotPath.getAbsolutePath());
+
   /* Stat for existing project directory (must already exist) */
   Sstat myStat;
   if (hecl::Stat(m_rootPath.getAbsolutePath().data(), &myStat)) {
@@ -216,12 +285,12 @@ Project::Project(const ProjectRootPath& rootPath)
     return;
   }
 
-  /* Compile current dataspec */
-  rescanDataSpecs();
+  /* DataSpecs and their preferences are resolved on first use; most invocations touch few of them */
   m_valid = true;
 }
 
 const ProjectPath& Project::getProjectCookedPath(const DataSpecEntry& spec) const {
+  _buildDataSpecs();
   for (const ProjectDataSpec& sp : m_compiledSpecs)
     if (&sp.spec == &spec)
       return sp.cookedPath;
@@ -267,16 +336,33 @@ bool Project::removeGroup(const ProjectPath& path) {
   return m_groups.unlockAndCommit();
 }
 
-void Project::rescanDataSpecs() {
-  m_compiledSpecs.clear();
-  m_specs.lockAndRead();
-  for (const DataSpecEntry* spec : DATA_SPEC_REGISTRY) {
-    hecl::SystemString specStr(spec->m_name);
+void Project::_buildDataSpecs() const {
+  /* Cooked paths are resolved from worker threads; the registry is fixed by then */
+  std::call_once(m_compiledSpecsOnce, [this]() {
+    m_compiledSpecs.reserve(DATA_SPEC_REGISTRY.size());
+    for (const DataSpecEntry* spec : DATA_SPEC_REGISTRY)
+      m_compiledSpecs.push_back(
+          {*spec, ProjectPath(m_cookedRoot, hecl::SystemString(spec->m_name) + _SYS_STR(".spec")), false});
+  });
+}
+
+void Project::_scanDataSpecs() const {
+  _buildDataSpecs();
+  const auto specs = m_specs.read();
+  for (ProjectDataSpec& spec : m_compiledSpecs) {
+    hecl::SystemString specStr(spec.spec.m_name);
     SystemUTF8Conv specUTF8(specStr);
-    m_compiledSpecs.push_back({*spec, ProjectPath(m_cookedRoot, hecl::SystemString(spec->m_name) + _SYS_STR(".spec")),
-                               m_specs.checkForLine(specUTF8.str())});
+    spec.active = specs->contains(specUTF8.str());
   }
-  m_specs.unlockAndDiscard();
+  m_specsScanned = true;
+}
+
+void Project::rescanDataSpecs() { _scanDataSpecs(); }
+
+const std::vector<Project::ProjectDataSpec>& Project::getDataSpecs() const {
+  if (!m_specsScanned)
+    _scanDataSpecs();
+  return m_compiledSpecs;
 }
 
 bool Project::enableDataSpecs(const std::vector<SystemString>& specs) {
@@ -336,39 +422,43 @@ public:
   void reportDirComplete() { m_progPrinter.print(m_dir, nullptr, 1.f); }
 };
 
+/* Serial cook of a path; cooks through a ClientProcess are scheduled from the depsgraph instead */
 static void VisitFile(const ProjectPath& path, bool force, bool fast,
-                      std::vector<std::unique_ptr<IDataSpec>>& specInsts, CookProgress& progress, ClientProcess* cp) {
+                      std::vector<std::unique_ptr<IDataSpec>>& specInsts, CookProgress& progress) {
   for (auto& spec : specInsts) {
     if (spec->canCook(path, hecl::blender::SharedBlenderToken)) {
-      if (cp) {
-        cp->addCookTransaction(path, force, fast, spec.get());
-      } else {
-        const DataSpecEntry* override = spec->overrideDataSpec(path, spec->getDataSpecEntry());
-        if (!override)
-          continue;
-        ProjectPath cooked = path.getCookedPath(*override);
-        if (fast)
-          cooked = cooked.getWithExtension(_SYS_STR(".fast"));
-        if (force || cooked.getPathType() == ProjectPath::Type::None || path.getModtime() > cooked.getModtime()) {
-          progress.reportFile(override);
-          spec->doCook(path, cooked, fast, hecl::blender::SharedBlenderToken,
+      const DataSpecEntry* override = spec->overrideDataSpec(path, spec->getDataSpecEntry());
+      if (!override)
+        continue;
+      ProjectPath cooked = path.getCookedPath(*override);
+      if (fast)
+        cooked = cooked.getWithExtension(_SYS_STR(".fast"));
+      CookCache& cache = path.getProject().getCookCache();
+      const Hash key = cache.computeKey(path, *spec, *override, fast);
+      if (force || !cache.isUpToDate(path, cooked, key)) {
+        progress.reportFile(override);
+        {
+          HECL_TRACE_SCOPE("doCook", path.getRelativePathUTF8());
+          const CookTimings::Timer timer(hecl::blender::SharedBlenderToken);
+          spec->doCook(path, CookCache::StagingPath(cooked), fast, hecl::blender::SharedBlenderToken,
                        [&](const SystemChar* extra) { progress.reportFile(override, extra); });
+          path.getProject().getCookTimings().record(path, *override, timer.finish());
         }
+        cache.commitStaged(cooked, key);
       }
     }
   }
 }
 
 static void VisitDirectory(const ProjectPath& dir, bool recursive, bool force, bool fast,
-                           std::vector<std::unique_ptr<IDataSpec>>& specInsts, CookProgress& progress,
-                           ClientProcess* cp) {
+                           std::vector<std::unique_ptr<IDataSpec>>& specInsts, CookProgress& progress) {
   if (dir.getLastComponent().size() > 1 && dir.getLastComponent()[0] == _SYS_STR('.'))
     return;
 
   if (hecl::ProjectPath(dir, _SYS_STR("!project.yaml")).isFile() &&
       hecl::ProjectPath(dir, _SYS_STR("!pool.yaml")).isFile()) {
     /* Handle AudioGroup case */
-    VisitFile(dir, force, fast, specInsts, progress, cp);
+    VisitFile(dir, force, fast, specInsts, progress);
     return;
   }
 
@@ -388,7 +478,7 @@ static void VisitDirectory(const ProjectPath& dir, bool recursive, bool force, b
   for (auto& child : children) {
     if (child.second.getPathType() == ProjectPath::Type::File) {
       progress.changeFile(child.first.c_str(), progNum++ / progDenom);
-      VisitFile(child.second, force, fast, specInsts, progress, cp);
+      VisitFile(child.second, force, fast, specInsts, progress);
     }
   }
   progress.reportDirComplete();
@@ -398,7 +488,7 @@ static void VisitDirectory(const ProjectPath& dir, bool recursive, bool force, b
     for (auto& child : children) {
       switch (child.second.getPathType()) {
       case ProjectPath::Type::Directory: {
-        VisitDirectory(child.second, recursive, force, fast, specInsts, progress, cp);
+        VisitDirectory(child.second, recursive, force, fast, specInsts, progress);
         break;
       }
       default:
@@ -408,8 +498,194 @@ static void VisitDirectory(const ProjectPath& dir, bool recursive, bool force, b
   }
 }
 
-bool Project::cookPath(const ProjectPath& path, const hecl::MultiProgressPrinter& progress, bool recursive, bool force,
-                       bool fast, const DataSpecEntry* spec, ClientProcess* cp) {
+namespace {
+/**
+ * Gathers cookable objects beneath a path into PackageDepsgraph nodes.
+ * Links are tracked as indices while m_nodes grows and resolved into
+ * Node pointers by finish().
+ */
+class DepsgraphBuilder {
+  static constexpr size_t NoNode = std::numeric_limits<size_t>::max();
+
+  std::vector<PackageDepsgraph::Node>& m_nodes;
+  std::vector<std::unique_ptr<IDataSpec>>& m_specInsts;
+  std::vector<std::vector<IDataSpec*>>& m_nodeSpecs;
+  std::vector<size_t> m_sub;
+  std::vector<size_t> m_next;
+  std::vector<std::vector<ProjectPath>> m_depPaths;
+  std::unordered_map<ProjectPath, size_t> m_dataIndex;
+  std::vector<size_t> m_worldNodes;
+
+  static bool IsWorldBlend(const ProjectPath& path) {
+    const SystemStringView lastComp = path.getLastComponent();
+    return hecl::StringUtils::BeginsWith(lastComp, _SYS_STR("!world")) &&
+           hecl::StringUtils::EndsWith(lastComp, _SYS_STR(".blend"));
+  }
+
+  size_t addNode(PackageDepsgraph::Node::Type type, const ProjectPath& path, const ProjectPath& cookedPath) {
+    m_nodes.push_back({type, path, cookedPath, nullptr, nullptr, nullptr, {}});
+    m_nodeSpecs.emplace_back();
+    m_sub.push_back(NoNode);
+    m_next.push_back(NoNode);
+    m_depPaths.emplace_back();
+    return m_nodes.size() - 1;
+  }
+
+public:
+  DepsgraphBuilder(std::vector<PackageDepsgraph::Node>& nodes, std::vector<std::unique_ptr<IDataSpec>>& specInsts,
+                   std::vector<std::vector<IDataSpec*>>& nodeSpecs)
+  : m_nodes(nodes), m_specInsts(specInsts), m_nodeSpecs(nodeSpecs) {}
+
+  size_t visitData(const ProjectPath& path) {
+    size_t idx = NoNode;
+    for (auto& spec : m_specInsts) {
+      if (!spec->canCook(path, hecl::blender::SharedBlenderToken))
+        continue;
+      const DataSpecEntry* override = spec->overrideDataSpec(path, spec->getDataSpecEntry());
+      if (!override)
+        continue;
+      if (idx == NoNode) {
+        idx = addNode(PackageDepsgraph::Node::Type::Data, path, path.getCookedPath(*override));
+        m_dataIndex[path] = idx;
+      }
+      m_nodeSpecs[idx].push_back(spec.get());
+      spec->getCookDependencies(path, m_depPaths[idx]);
+    }
+    if (idx != NoNode && IsWorldBlend(path))
+      m_worldNodes.push_back(idx);
+    return idx;
+  }
+
+  /**
+   * Pull everything world blends transitively depend on into the graph, even from outside
+   * the cooked path. Areas and the resources they share then cook once each, spread over
+   * all workers, and the world itself cooks last to assemble its outputs.
+   */
+  void expandWorlds() {
+    std::vector<size_t> pending = m_worldNodes;
+    std::unordered_set<ProjectPath> visited;
+    while (!pending.empty()) {
+      const size_t idx = pending.back();
+      pending.pop_back();
+      /* visitData grows m_depPaths; index afresh each time */
+      for (size_t d = 0; d < m_depPaths[idx].size(); ++d) {
+        const ProjectPath depPath = m_depPaths[idx][d];
+        if (m_dataIndex.count(depPath) || !visited.insert(depPath).second || !depPath.isFile())
+          continue;
+        const size_t depIdx = visitData(depPath);
+        if (depIdx != NoNode)
+          pending.push_back(depIdx);
+      }
+    }
+  }
+
+  size_t visitDirectory(const ProjectPath& dir, bool recursive) {
+    if (dir.getLastComponent().size() > 1 && dir.getLastComponent()[0] == _SYS_STR('.'))
+      return NoNode;
+
+    /* One parallel scan up front; the visit below then works from memory */
+    const DirectoryWalker walker(dir.getAbsolutePath(), recursive, false, true, &dir.getProject().getStatCache());
+    return visitWalkedDirectory(walker, DirectoryWalker::NoEntry, dir, recursive);
+  }
+
+  size_t visitWalkedDirectory(const DirectoryWalker& walker, uint32_t dirIdx, const ProjectPath& dir, bool recursive) {
+    /* Ordered by name as the serial cook enumerates them */
+    std::vector<const DirectoryWalker::Entry*> children;
+    for (const DirectoryWalker::Entry& child : walker.children(dirIdx))
+      children.push_back(&child);
+    std::sort(children.begin(), children.end(),
+              [](const DirectoryWalker::Entry* a, const DirectoryWalker::Entry* b) { return a->m_name < b->m_name; });
+
+    const auto hasFile = [&](SystemStringView name) {
+      return std::any_of(children.begin(), children.end(),
+                         [&](const DirectoryWalker::Entry* child) { return !child->m_isDir && child->m_name == name; });
+    };
+    if (hasFile(_SYS_STR("!project.yaml")) && hasFile(_SYS_STR("!pool.yaml"))) {
+      /* Handle AudioGroup case */
+      return visitData(dir);
+    }
+
+    const size_t groupIdx = addNode(PackageDepsgraph::Node::Type::Group, dir, {});
+
+    size_t lastChild = NoNode;
+    const auto linkChild = [&](size_t childIdx) {
+      if (childIdx == NoNode)
+        return;
+      if (lastChild == NoNode)
+        m_sub[groupIdx] = childIdx;
+      else
+        m_next[lastChild] = childIdx;
+      lastChild = childIdx;
+    };
+
+    /* Files first, then subdirectories; matching the serial cook order */
+    for (const DirectoryWalker::Entry* child : children)
+      if (!child->m_isDir)
+        linkChild(visitData(ProjectPath(dir, child->m_name)));
+    if (recursive)
+      for (const DirectoryWalker::Entry* child : children)
+        if (child->m_isDir)
+          linkChild(visitWalkedDirectory(walker, walker.indexOf(*child), ProjectPath(dir, child->m_name), recursive));
+
+    return groupIdx;
+  }
+
+  void finish() {
+    const auto resolve = [&](size_t idx) { return idx == NoNode ? nullptr : &m_nodes[idx]; };
+    for (size_t i = 0; i < m_nodes.size(); ++i) {
+      PackageDepsgraph::Node& node = m_nodes[i];
+      node.sub = resolve(m_sub[i]);
+      node.next = resolve(m_next[i]);
+      /* Dependencies outside of the graph are not being cooked and impose no ordering */
+      for (const ProjectPath& depPath : m_depPaths[i]) {
+        auto search = m_dataIndex.find(depPath);
+        if (search != m_dataIndex.end() && search->second != i)
+          node.deps.push_back(&m_nodes[search->second]);
+      }
+    }
+  }
+};
+
+/**
+ * Shared state of an asynchronous depsgraph cook; kept alive by the
+ * completion callbacks of the cook transactions it issues.
+ */
+struct CookSchedule {
+  struct Entry {
+    const PackageDepsgraph::Node* node = nullptr;
+    std::vector<IDataSpec*> specs;
+    std::vector<size_t> dependents;
+    std::atomic_int remainingDeps = 0;
+    std::atomic_int remainingCooks = 0;
+  };
+
+  PackageDepsgraph graph;
+  std::vector<Entry> entries;
+  ClientProcess* cp;
+  bool force;
+  bool fast;
+
+  CookSchedule(PackageDepsgraph&& graph, size_t entryCount, ClientProcess* cp, bool force, bool fast)
+  : graph(std::move(graph)), entries(entryCount), cp(cp), force(force), fast(fast) {}
+
+  static void Launch(const std::shared_ptr<CookSchedule>& sched, size_t idx) {
+    Entry& ent = sched->entries[idx];
+    ent.remainingCooks = int(ent.specs.size());
+    for (IDataSpec* spec : ent.specs) {
+      sched->cp->addCookTransaction(ent.node->path, sched->force, sched->fast, spec, [sched, idx]() {
+        Entry& done = sched->entries[idx];
+        if (--done.remainingCooks != 0)
+          return;
+        for (size_t dependent : done.dependents)
+          if (--sched->entries[dependent].remainingDeps == 0)
+            Launch(sched, dependent);
+      });
+    }
+  }
+};
+} // anonymous namespace
+
+void Project::_prepareCookSpecs(const DataSpecEntry* spec) {
   /* Construct DataSpec instances for cooking */
   if (spec) {
     if (m_cookSpecs.size() != 1 || m_cookSpecs[0]->getDataSpecEntry() != spec) {
@@ -418,13 +694,109 @@ bool Project::cookPath(const ProjectPath& path, const hecl::MultiProgressPrinter
         m_cookSpecs.push_back(spec->m_factory(*this, DataSpecTool::Cook));
     }
   } else if (m_cookSpecs.empty()) {
-    m_cookSpecs.reserve(m_compiledSpecs.size());
-    for (const ProjectDataSpec& projectSpec : m_compiledSpecs) {
+    const std::vector<ProjectDataSpec>& specs = getDataSpecs();
+    m_cookSpecs.reserve(specs.size());
+    for (const ProjectDataSpec& projectSpec : specs) {
       if (projectSpec.active && projectSpec.spec.m_factory) {
         m_cookSpecs.push_back(projectSpec.spec.m_factory(*this, DataSpecTool::Cook));
       }
     }
   }
+}
+
+PackageDepsgraph Project::_buildDepsgraph(const ProjectPath& path, bool recursive,
+                                          std::vector<std::vector<IDataSpec*>>* nodeSpecs, bool expandWorlds) {
+  PackageDepsgraph ret;
+  std::vector<std::vector<IDataSpec*>> localNodeSpecs;
+  DepsgraphBuilder builder(ret.m_nodes, m_cookSpecs, nodeSpecs ? *nodeSpecs : localNodeSpecs);
+  switch (path.getPathType()) {
+  case ProjectPath::Type::File:
+  case ProjectPath::Type::Glob:
+    builder.visitData(path);
+    break;
+  case ProjectPath::Type::Directory:
+    builder.visitDirectory(path, recursive);
+    break;
+  default:
+    break;
+  }
+  if (expandWorlds)
+    builder.expandWorlds();
+  builder.finish();
+  return ret;
+}
+
+bool Project::cookPath(const ProjectPath& path, const hecl::MultiProgressPrinter& progress, bool recursive, bool force,
+                       bool fast, const DataSpecEntry* spec, ClientProcess* cp) {
+  _prepareCookSpecs(spec);
+
+  if (cp) {
+    std::vector<std::vector<IDataSpec*>> nodeSpecs;
+    PackageDepsgraph graph = _buildDepsgraph(path, recursive, &nodeSpecs, true);
+    const std::vector<PackageDepsgraph::Node>& nodes = graph.m_nodes;
+
+    /* Compact Data nodes into schedule entries */
+    std::vector<size_t> entryIdx(nodes.size(), SIZE_MAX);
+    size_t entryCount = 0;
+    for (size_t i = 0; i < nodes.size(); ++i)
+      if (nodes[i].type == PackageDepsgraph::Node::Type::Data)
+        entryIdx[i] = entryCount++;
+
+    auto sched = std::make_shared<CookSchedule>(std::move(graph), entryCount, cp, force, fast);
+    const PackageDepsgraph::Node* base = sched->graph.m_nodes.data();
+    std::vector<int> indegree(entryCount, 0);
+    for (size_t i = 0; i < sched->graph.m_nodes.size(); ++i) {
+      if (entryIdx[i] == SIZE_MAX)
+        continue;
+      CookSchedule::Entry& ent = sched->entries[entryIdx[i]];
+      ent.node = &sched->graph.m_nodes[i];
+      ent.specs = std::move(nodeSpecs[i]);
+      for (const PackageDepsgraph::Node* dep : ent.node->deps) {
+        sched->entries[entryIdx[dep - base]].dependents.push_back(entryIdx[i]);
+        ++indegree[entryIdx[i]];
+      }
+    }
+
+    /* Dry-run the topological order; objects left over participate in a cycle */
+    std::vector<size_t> ready;
+    std::vector<int> remaining = indegree;
+    for (size_t i = 0; i < entryCount; ++i)
+      if (remaining[i] == 0)
+        ready.push_back(i);
+    std::vector<bool> ordered(entryCount, false);
+    for (size_t r = 0; r < ready.size(); ++r) {
+      ordered[ready[r]] = true;
+      for (size_t dependent : sched->entries[ready[r]].dependents)
+        if (--remaining[dependent] == 0)
+          ready.push_back(dependent);
+    }
+    if (ready.size() != entryCount) {
+      for (size_t i = 0; i < entryCount; ++i) {
+        if (ordered[i])
+          continue;
+        CookSchedule::Entry& ent = sched->entries[i];
+        LogModule.report(logvisor::Warning, FMT_STRING(_SYS_STR("dependency cycle involving '{}'; cooking unordered")),
+                         ent.node->path.getRelativePath());
+        auto& dependents = ent.dependents;
+        for (auto it = dependents.begin(); it != dependents.end();) {
+          if (!ordered[*it]) {
+            --indegree[*it];
+            it = dependents.erase(it);
+            continue;
+          }
+          ++it;
+        }
+      }
+    }
+
+    for (size_t i = 0; i < entryCount; ++i)
+      sched->entries[i].remainingDeps = indegree[i];
+    for (size_t i = 0; i < entryCount; ++i)
+      if (indegree[i] == 0)
+        CookSchedule::Launch(sched, i);
+
+    return true;
+  }
 
   /* Iterate complete directory/file/glob list */
   CookProgress cookProg(progress);
@@ -432,11 +804,11 @@ bool Project::cookPath(const ProjectPath& path, const hecl::MultiProgressPrinter
   case ProjectPath::Type::File:
   case ProjectPath::Type::Glob: {
     cookProg.changeFile(path.getLastComponent().data(), 0.f);
-    VisitFile(path, force, fast, m_cookSpecs, cookProg, cp);
+    VisitFile(path, force, fast, m_cookSpecs, cookProg);
     break;
   }
   case ProjectPath::Type::Directory: {
-    VisitDirectory(path, recursive, force, fast, m_cookSpecs, cookProg, cp);
+    VisitDirectory(path, recursive, force, fast, m_cookSpecs, cookProg);
     break;
   }
   default:
@@ -446,9 +818,7 @@ bool Project::cookPath(const ProjectPath& path, const hecl::MultiProgressPrinter
   return true;
 }
 
-bool Project::packagePath(const ProjectPath& path, const hecl::MultiProgressPrinter& progress, bool fast,
-                          const DataSpecEntry* spec, ClientProcess* cp) {
-  /* Construct DataSpec instance for packaging */
+const DataSpecEntry* Project::_selectPackageSpec(const DataSpecEntry* spec) const {
   const DataSpecEntry* specEntry = nullptr;
   if (spec) {
     if (spec->m_factory) {
@@ -456,7 +826,7 @@ bool Project::packagePath(const ProjectPath& path, const hecl::MultiProgressPrin
     }
   } else {
     bool foundPC = false;
-    for (const ProjectDataSpec& projectSpec : m_compiledSpecs) {
+    for (const ProjectDataSpec& projectSpec : getDataSpecs()) {
       if (projectSpec.active && projectSpec.spec.m_factory) {
         if (hecl::StringUtils::EndsWith(projectSpec.spec.m_name, _SYS_STR("-PC"))) {
           foundPC = true;
@@ -470,7 +840,13 @@ bool Project::packagePath(const ProjectPath& path, const hecl::MultiProgressPrin
 
   if (!specEntry)
     LogModule.report(logvisor::Fatal, FMT_STRING("No matching DataSpec"));
+  return specEntry;
+}
 
+bool Project::packagePath(const ProjectPath& path, const hecl::MultiProgressPrinter& progress, bool fast,
+                          const DataSpecEntry* spec, ClientProcess* cp) {
+  /* Construct DataSpec instance for packaging */
+  const DataSpecEntry* specEntry = _selectPackageSpec(spec);
   if (!m_lastPackageSpec || m_lastPackageSpec->getDataSpecEntry() != specEntry)
     m_lastPackageSpec = specEntry->m_factory(*this, DataSpecTool::Package);
 
@@ -482,24 +858,81 @@ bool Project::packagePath(const ProjectPath& path, const hecl::MultiProgressPrin
   return false;
 }
 
+bool Project::packagePaths(const std::vector<ProjectPath>& paths, const hecl::MultiProgressPrinter& progress,
+                           bool fast, const DataSpecEntry* spec, ClientProcess* cp, size_t concurrency) {
+  if (paths.empty())
+    return true;
+  const DataSpecEntry* specEntry = _selectPackageSpec(spec);
+  concurrency = std::clamp(concurrency, size_t(1), paths.size());
+
+  m_parallelPackageSpecs.clear();
+  for (size_t i = 0; i < concurrency; ++i)
+    m_parallelPackageSpecs.push_back(specEntry->m_factory(*this, DataSpecTool::Package));
+
+  /* Paths are claimed in order, so the biggest packages should be listed first */
+  std::atomic_size_t nextPath = 0;
+  std::atomic_bool allPackaged = true;
+  const auto packageProc = [&](IDataSpec& dataSpec) {
+    dataSpec.setThreadProject();
+    hecl::blender::Token btok;
+    for (size_t i; (i = nextPath++) < paths.size();) {
+      const ProjectPath& path = paths[i];
+      if (dataSpec.canPackage(path)) {
+        HECL_TRACE_SCOPE("doPackage", path.getRelativePathUTF8());
+        dataSpec.doPackage(path, specEntry, fast, btok, progress, cp);
+      } else {
+        LogModule.report(logvisor::Error, FMT_STRING(_SYS_STR("Unable to package {}")), path.getAbsolutePath());
+        allPackaged = false;
+      }
+    }
+    btok.release();
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(concurrency - 1);
+  for (size_t i = 1; i < concurrency; ++i)
+    threads.emplace_back([&, i]() {
+      const std::string thrName = fmt::format(FMT_STRING("HECL Package {}"), i);
+      logvisor::RegisterThreadName(thrName.c_str());
+      trace::SetThreadName(thrName);
+      packageProc(*m_parallelPackageSpecs[i]);
+    });
+  packageProc(*m_parallelPackageSpecs[0]);
+  for (std::thread& thread : threads)
+    thread.join();
+  return allPackaged;
+}
+
 void Project::interruptCook() {
   if (m_lastPackageSpec)
     m_lastPackageSpec->interruptCook();
+  for (const std::unique_ptr<IDataSpec>& dataSpec : m_parallelPackageSpecs)
+    dataSpec->interruptCook();
 }
 
 bool Project::cleanPath(const ProjectPath& path, bool recursive) { return false; }
 
-PackageDepsgraph Project::buildPackageDepsgraph(const ProjectPath& path) { return PackageDepsgraph(); }
+PackageDepsgraph Project::buildPackageDepsgraph(const ProjectPath& path) {
+  _prepareCookSpecs(nullptr);
+  return _buildDepsgraph(path, true, nullptr);
+}
+
+void Project::getCookDependencies(const ProjectPath& path, std::vector<ProjectPath>& depsOut,
+                                  const DataSpecEntry* spec) {
+  _prepareCookSpecs(spec);
+  for (auto& cookSpec : m_cookSpecs)
+    if (cookSpec->canCook(path, hecl::blender::SharedBlenderToken))
+      cookSpec->getCookDependencies(path, depsOut);
+}
 
-void Project::addBridgePathToCache(uint64_t id, const ProjectPath& path) { m_bridgePathCache[id] = path; }
+void Project::addBridgePathToCache(uint64_t id, const ProjectPath& path) { m_bridgePathCache.add(id, path); }
 
 void Project::clearBridgePathCache() { m_bridgePathCache.clear(); }
 
-const ProjectPath* Project::lookupBridgePath(uint64_t id) const {
-  auto search = m_bridgePathCache.find(id);
-  if (search == m_bridgePathCache.cend())
-    return nullptr;
-  return &search->second;
-}
+const ProjectPath* Project::lookupBridgePath(uint64_t id) const { return m_bridgePathCache.lookup(id); }
+
+size_t Project::getBridgePathCacheSize() const { return m_bridgePathCache.size(); }
+
+void Project::saveBridgePathCache() { m_bridgePathCache.save(); }
 
 } // namespace hecl::Database
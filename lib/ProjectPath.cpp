@@ -1,24 +1,37 @@
 #include "hecl/hecl.hpp"
 
 #include <regex>
+#include <shared_mutex>
+#include <unordered_map>
 
 #include "hecl/Database.hpp"
 #include "hecl/FourCC.hpp"
 
 namespace hecl {
-static const SystemRegex regPATHCOMP(_SYS_STR("[/\\\\]*([^/\\\\]+)"), SystemRegex::ECMAScript | SystemRegex::optimize);
+static bool IsPathSeparator(SystemChar ch) { return ch == _SYS_STR('/') || ch == _SYS_STR('\\'); }
+
+/* Split off the first non-empty component of path, returning what follows it */
+static SystemStringView NextPathComponent(SystemStringView path, SystemStringView& comp) {
+  size_t begin = 0;
+  while (begin < path.size() && IsPathSeparator(path[begin]))
+    ++begin;
+  size_t end = begin;
+  while (end < path.size() && !IsPathSeparator(path[end]))
+    ++end;
+  comp = path.substr(begin, end - begin);
+  return path.substr(end);
+}
 
 static SystemString CanonRelPath(SystemStringView path) {
   /* Tokenize Path */
-  std::vector<SystemString> comps;
-  hecl::SystemRegexMatch matches;
+  std::vector<SystemStringView> comps;
   SystemString in(path);
   SanitizePath(in);
-  for (; std::regex_search(in, matches, regPATHCOMP); in = matches.suffix().str()) {
-    hecl::SystemRegexMatch::const_reference match = matches[1];
-    if (match == _SYS_STR("."))
+  SystemStringView comp;
+  for (SystemStringView rem = NextPathComponent(in, comp); !comp.empty(); rem = NextPathComponent(rem, comp)) {
+    if (comp == _SYS_STR("."))
       continue;
-    else if (match == _SYS_STR("..")) {
+    else if (comp == _SYS_STR("..")) {
       if (comps.empty()) {
         /* Unable to resolve outside project */
         LogModule.report(logvisor::Fatal, FMT_STRING(_SYS_STR("Unable to resolve outside project root in {}")), path);
@@ -27,29 +40,75 @@ static SystemString CanonRelPath(SystemStringView path) {
       comps.pop_back();
       continue;
     }
-    comps.push_back(match.str());
+    comps.push_back(comp);
   }
 
   /* Emit relative path */
   if (comps.size()) {
     auto it = comps.begin();
-    SystemString retval = *it;
+    SystemString retval(*it);
     for (++it; it != comps.end(); ++it) {
-      if ((*it).size()) {
-        retval += _SYS_STR('/');
-        retval += *it;
-      }
+      retval += _SYS_STR('/');
+      retval += *it;
     }
     return retval;
   }
   return _SYS_STR(".");
 }
 
-static SystemString CanonRelPath(SystemStringView path, const ProjectRootPath& projectRoot) {
+namespace {
+struct CanonRelEntry {
+  SystemString m_relPath;
+  Hash m_hash;
+};
+
+struct StringViewHash {
+  using is_transparent = void;
+  size_t operator()(SystemStringView str) const { return std::hash<SystemStringView>()(str); }
+};
+
+/**
+ * Interned results of CanonRelPath for relative inputs, along with the path hash.
+ * The same few thousand relative paths are resolved over and over while cooking,
+ * so hits skip tokenizing, sanitizing and hashing altogether.
+ */
+class CanonRelCache {
+  static constexpr size_t MaxEntries = 1 << 18;
+  std::shared_mutex m_mutex;
+  std::unordered_map<SystemString, CanonRelEntry, StringViewHash, std::equal_to<>> m_entries;
+
+public:
+  CanonRelEntry lookup(SystemStringView path) {
+    {
+      std::shared_lock lk{m_mutex};
+      auto search = m_entries.find(path);
+      if (search != m_entries.end())
+        return search->second;
+    }
+
+    CanonRelEntry entry{CanonRelPath(path), {}};
+#if HECL_UCS2
+    entry.m_hash = Hash(WideToUTF8(entry.m_relPath));
+#else
+    entry.m_hash = Hash(entry.m_relPath);
+#endif
+
+    std::unique_lock lk{m_mutex};
+    /* Bounded by starting over; a project's working set refills it quickly */
+    if (m_entries.size() >= MaxEntries)
+      m_entries.clear();
+    m_entries.emplace(path, entry);
+    return entry;
+  }
+};
+CanonRelCache CanonCache;
+} // anonymous namespace
+
+static CanonRelEntry CanonRelPath(SystemStringView path, const ProjectRootPath& projectRoot) {
   /* Absolute paths not allowed; attempt to make project-relative */
   if (IsAbsolute(path))
-    return CanonRelPath(projectRoot.getProjectRelativeFromAbsolute(path));
-  return CanonRelPath(path);
+    return CanonCache.lookup(projectRoot.getProjectRelativeFromAbsolute(path));
+  return CanonCache.lookup(path);
 }
 
 void ProjectPath::assign(Database::Project& project, SystemStringView path) {
@@ -63,12 +122,12 @@ void ProjectPath::assign(Database::Project& project, SystemStringView path) {
   } else
     usePath = path;
 
-  m_relPath = CanonRelPath(usePath, project.getProjectRootPath());
+  CanonRelEntry canon = CanonRelPath(usePath, project.getProjectRootPath());
+  m_relPath = std::move(canon.m_relPath);
+  /* Both halves are already sanitized */
   m_absPath = SystemString(project.getProjectRootPath().getAbsolutePath()) + _SYS_STR('/') + m_relPath;
-  SanitizePath(m_relPath);
-  SanitizePath(m_absPath);
 
-  ComputeHash();
+  ComputeHash(canon.m_hash);
 }
 
 #if HECL_UCS2
@@ -89,12 +148,11 @@ void ProjectPath::assign(const ProjectPath& parentPath, SystemStringView path) {
   } else
     usePath = path;
 
-  m_relPath = CanonRelPath(parentPath.m_relPath + _SYS_STR('/') + usePath);
+  CanonRelEntry canon = CanonCache.lookup(parentPath.m_relPath + _SYS_STR('/') + usePath);
+  m_relPath = std::move(canon.m_relPath);
   m_absPath = SystemString(m_proj->getProjectRootPath().getAbsolutePath()) + _SYS_STR('/') + m_relPath;
-  SanitizePath(m_relPath);
-  SanitizePath(m_absPath);
 
-  ComputeHash();
+  ComputeHash(canon.m_hash);
 }
 
 #if HECL_UCS2
@@ -147,7 +205,7 @@ ProjectPath::Type ProjectPath::getPathType() const {
   if (m_absPath.find(_SYS_STR('*')) != SystemString::npos)
     return Type::Glob;
   Sstat theStat;
-  if (hecl::Stat(m_absPath.c_str(), &theStat))
+  if (m_proj->getStatCache().stat(m_absPath, &theStat))
     return Type::None;
   if (S_ISDIR(theStat.st_mode))
     return Type::Directory;
@@ -163,20 +221,21 @@ Time ProjectPath::getModtime() const {
     std::vector<ProjectPath> globResults;
     getGlobResults(globResults);
     for (ProjectPath& path : globResults) {
-      if (!hecl::Stat(path.getAbsolutePath().data(), &theStat)) {
+      if (!m_proj->getStatCache().stat(path.getAbsolutePath(), &theStat)) {
         if (S_ISREG(theStat.st_mode) && theStat.st_mtime > latestTime)
           latestTime = theStat.st_mtime;
       }
     }
     return Time(latestTime);
   }
-  if (!hecl::Stat(m_absPath.c_str(), &theStat)) {
+  if (!m_proj->getStatCache().stat(m_absPath, &theStat)) {
     if (S_ISREG(theStat.st_mode)) {
       return Time(theStat.st_mtime);
     } else if (S_ISDIR(theStat.st_mode)) {
-      hecl::DirectoryEnumerator de(m_absPath, hecl::DirectoryEnumerator::Mode::DirsThenFilesSorted, false, false, true);
+      hecl::DirectoryEnumerator de(m_absPath, hecl::DirectoryEnumerator::Mode::DirsThenFilesSorted, false, false, true,
+                                   &m_proj->getStatCache());
       for (const hecl::DirectoryEnumerator::Entry& ent : de) {
-        if (!hecl::Stat(ent.m_path.c_str(), &theStat)) {
+        if (!m_proj->getStatCache().stat(ent.m_path, &theStat)) {
           if (S_ISREG(theStat.st_mode) && theStat.st_mtime > latestTime)
             latestTime = theStat.st_mtime;
         }
@@ -188,13 +247,14 @@ Time ProjectPath::getModtime() const {
   return Time();
 }
 
-static void _recursiveGlob(Database::Project& proj, std::vector<ProjectPath>& outPaths, const SystemString& remPath,
+static void _recursiveGlob(Database::Project& proj, std::vector<ProjectPath>& outPaths, SystemStringView remPath,
                            const SystemString& itStr, bool needSlash) {
-  SystemRegexMatch matches;
-  if (!std::regex_search(remPath, matches, regPATHCOMP))
+  SystemStringView compView;
+  const SystemStringView suffix = NextPathComponent(remPath, compView);
+  if (compView.empty())
     return;
 
-  const SystemString& comp = matches[1];
+  const SystemString comp(compView);
   if (comp.find(_SYS_STR('*')) == SystemString::npos) {
     SystemString nextItStr = itStr;
     if (needSlash)
@@ -202,11 +262,11 @@ static void _recursiveGlob(Database::Project& proj, std::vector<ProjectPath>& ou
     nextItStr += comp;
 
     hecl::Sstat theStat;
-    if (Stat(nextItStr.c_str(), &theStat))
+    if (proj.getStatCache().stat(nextItStr, &theStat))
       return;
 
     if (S_ISDIR(theStat.st_mode))
-      _recursiveGlob(proj, outPaths, matches.suffix().str(), nextItStr, true);
+      _recursiveGlob(proj, outPaths, suffix, nextItStr, true);
     else
       outPaths.emplace_back(proj, nextItStr);
     return;
@@ -215,7 +275,8 @@ static void _recursiveGlob(Database::Project& proj, std::vector<ProjectPath>& ou
   /* Compile component into regex */
   SystemRegex regComp(comp, SystemRegex::ECMAScript);
 
-  hecl::DirectoryEnumerator de(itStr, hecl::DirectoryEnumerator::Mode::DirsThenFilesSorted, false, false, true);
+  hecl::DirectoryEnumerator de(itStr, hecl::DirectoryEnumerator::Mode::DirsThenFilesSorted, false, false, true,
+                               &proj.getStatCache());
   for (const hecl::DirectoryEnumerator::Entry& ent : de) {
     if (std::regex_match(ent.m_name, regComp)) {
       SystemString nextItStr = itStr;
@@ -224,11 +285,11 @@ static void _recursiveGlob(Database::Project& proj, std::vector<ProjectPath>& ou
       nextItStr += ent.m_name;
 
       hecl::Sstat theStat;
-      if (Stat(nextItStr.c_str(), &theStat))
+      if (proj.getStatCache().stat(nextItStr, &theStat))
         continue;
 
       if (ent.m_isDir)
-        _recursiveGlob(proj, outPaths, matches.suffix().str(), nextItStr, true);
+        _recursiveGlob(proj, outPaths, suffix, nextItStr, true);
       else
         outPaths.emplace_back(proj, nextItStr);
     }
@@ -236,13 +297,15 @@ static void _recursiveGlob(Database::Project& proj, std::vector<ProjectPath>& ou
 }
 
 void ProjectPath::getDirChildren(std::map<SystemString, ProjectPath>& outPaths) const {
-  hecl::DirectoryEnumerator de(m_absPath, hecl::DirectoryEnumerator::Mode::DirsThenFilesSorted, false, false, true);
+  hecl::DirectoryEnumerator de(m_absPath, hecl::DirectoryEnumerator::Mode::DirsThenFilesSorted, false, false, true,
+                               &m_proj->getStatCache());
   for (const hecl::DirectoryEnumerator::Entry& ent : de)
     outPaths[ent.m_name] = ProjectPath(*this, ent.m_name);
 }
 
 hecl::DirectoryEnumerator ProjectPath::enumerateDir() const {
-  return hecl::DirectoryEnumerator(m_absPath, hecl::DirectoryEnumerator::Mode::DirsThenFilesSorted, false, false, true);
+  return hecl::DirectoryEnumerator(m_absPath, hecl::DirectoryEnumerator::Mode::DirsThenFilesSorted, false, false, true,
+                                   &m_proj->getStatCache());
 }
 
 void ProjectPath::getGlobResults(std::vector<ProjectPath>& outPaths) const {
@@ -250,39 +313,37 @@ void ProjectPath::getGlobResults(std::vector<ProjectPath>& outPaths) const {
   _recursiveGlob(*m_proj, outPaths, m_relPath, rootPath.data(), rootPath.back() != _SYS_STR('/'));
 }
 
-template <typename T>
-static bool RegexSearchLast(const T& str, std::match_results<typename T::const_iterator>& m,
-                            const std::basic_regex<typename T::value_type>& reg) {
-  using Iterator = std::regex_iterator<typename T::const_iterator>;
-  Iterator begin = Iterator(str.begin(), str.end(), reg);
-  Iterator end = Iterator();
-  if (begin == end)
-    return false;
-  Iterator last_it;
-  for (auto it = begin; it != end; ++it)
-    last_it = it;
-  m = *last_it;
-  return true;
+static bool IsHexDigit(SystemChar ch) {
+  return (ch >= _SYS_STR('0') && ch <= _SYS_STR('9')) || (ch >= _SYS_STR('a') && ch <= _SYS_STR('f')) ||
+         (ch >= _SYS_STR('A') && ch <= _SYS_STR('F'));
 }
 
-static const hecl::SystemRegex regParsedHash32(_SYS_STR(R"(_([0-9a-fA-F]{8}))"),
-                                               std::regex::ECMAScript | std::regex::optimize);
-uint32_t ProjectPath::parsedHash32() const {
-  if (!m_auxInfo.empty()) {
-    hecl::SystemRegexMatch match;
-    if (RegexSearchLast(m_auxInfo, match, regParsedHash32)) {
-      auto hexStr = match[1].str();
-      if (auto val = hecl::StrToUl(hexStr.c_str(), nullptr, 16))
-        return val;
+/* Value of the last '_' followed by 8 hex digits; such matches cannot overlap,
+ * so scanning backwards finds the one a forward search would end on */
+static bool SearchLastParsedHash32(SystemStringView str, uint32_t& valOut) {
+  if (str.size() < 9)
+    return false;
+  for (size_t i = str.size() - 9 + 1; i-- > 0;) {
+    if (str[i] != _SYS_STR('_'))
+      continue;
+    uint32_t val = 0;
+    size_t j = 1;
+    for (; j <= 8 && IsHexDigit(str[i + j]); ++j) {
+      const SystemChar ch = str[i + j];
+      val = (val << 4) | uint32_t(ch <= _SYS_STR('9') ? ch - _SYS_STR('0') : (ch | 0x20) - _SYS_STR('a') + 10);
     }
-  } else {
-    hecl::SystemViewRegexMatch match;
-    if (RegexSearchLast(getLastComponent(), match, regParsedHash32)) {
-      auto hexStr = match[1].str();
-      if (auto val = hecl::StrToUl(hexStr.c_str(), nullptr, 16))
-        return val;
+    if (j == 9) {
+      valOut = val;
+      return true;
     }
   }
+  return false;
+}
+
+uint32_t ProjectPath::parsedHash32() const {
+  uint32_t val;
+  if (SearchLastParsedHash32(!m_auxInfo.empty() ? SystemStringView(m_auxInfo) : getLastComponent(), val) && val)
+    return val;
   return hash().val32();
 }
 
@@ -0,0 +1,450 @@
+#include "hecl/Quantize.hpp"
+
+#include <cfloat>
+#include <cstring>
+
+#if defined(__AVX2__)
+#define HECL_QUANTIZE_AVX2 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HECL_QUANTIZE_SSE2 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define HECL_QUANTIZE_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace hecl {
+
+namespace {
+/*
+ * Each instruction set supplies the same small set of lane-wise operations on
+ * Width floats (F) or 32-bit integers (I), with comparisons producing all-ones
+ * integer masks. The kernels are written once against this interface and
+ * mirror the scalar reference operation for operation, which keeps results
+ * identical across paths. Max and Min follow Clamp(): a > b ? a : b.
+ */
+#if HECL_QUANTIZE_AVX2
+struct Simd {
+  static constexpr size_t Width = 8;
+  static constexpr const char* Name = "AVX2";
+  using F = __m256;
+  using I = __m256i;
+
+  static F LoadF(const float* p) { return _mm256_loadu_ps(p); }
+  static void StoreF(float* p, F v) { _mm256_storeu_ps(p, v); }
+  static F SetF(float v) { return _mm256_set1_ps(v); }
+  static F Add(F a, F b) { return _mm256_add_ps(a, b); }
+  static F Sub(F a, F b) { return _mm256_sub_ps(a, b); }
+  static F Mul(F a, F b) { return _mm256_mul_ps(a, b); }
+  static F Div(F a, F b) { return _mm256_div_ps(a, b); }
+  static F Max(F a, F b) { return _mm256_max_ps(a, b); }
+  static F Min(F a, F b) { return _mm256_min_ps(a, b); }
+  static F Sqrt(F a) { return _mm256_sqrt_ps(a); }
+  static I CmpGt(F a, F b) { return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_GT_OQ)); }
+  static I CmpGe(F a, F b) { return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_GE_OQ)); }
+  static I CmpLt(F a, F b) { return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_LT_OQ)); }
+  static F Select(I mask, F a, F b) { return _mm256_blendv_ps(b, a, _mm256_castsi256_ps(mask)); }
+  static I Cvtt(F a) { return _mm256_cvttps_epi32(a); }
+  static F Cvt(I a) { return _mm256_cvtepi32_ps(a); }
+  static I AsI(F a) { return _mm256_castps_si256(a); }
+  static F AsF(I a) { return _mm256_castsi256_ps(a); }
+
+  static I SetI(int32_t v) { return _mm256_set1_epi32(v); }
+  static I AddI(I a, I b) { return _mm256_add_epi32(a, b); }
+  static I SubI(I a, I b) { return _mm256_sub_epi32(a, b); }
+  static I AndI(I a, I b) { return _mm256_and_si256(a, b); }
+  static I OrI(I a, I b) { return _mm256_or_si256(a, b); }
+  static I XorI(I a, I b) { return _mm256_xor_si256(a, b); }
+  static I CmpGtI(I a, I b) { return _mm256_cmpgt_epi32(a, b); }
+  static I SelectI(I mask, I a, I b) { return _mm256_blendv_epi8(b, a, mask); }
+  template <int N>
+  static I Srli(I a) { return _mm256_srli_epi32(a, N); }
+  template <int N>
+  static I Slli(I a) { return _mm256_slli_epi32(a, N); }
+  template <int N>
+  static I Srai(I a) { return _mm256_srai_epi32(a, N); }
+
+  static I LoadU16(const uint16_t* p) {
+    return _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+  }
+  static I LoadI16(const int16_t* p) {
+    return _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+  }
+  static I LoadU8(const uint8_t* p) {
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+  }
+  /* Packs work within 128-bit lanes; gathering the even quadwords puts both halves in order */
+  static __m128i Pack16(__m256i packed) { return _mm256_castsi256_si128(_mm256_permute4x64_epi64(packed, 0x08)); }
+  static void StoreU16(uint16_t* p, I v) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), Pack16(_mm256_packus_epi32(v, v)));
+  }
+  static void StoreI16(int16_t* p, I v) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), Pack16(_mm256_packs_epi32(v, v)));
+  }
+  static void StoreU8(uint8_t* p, I v) {
+    const __m128i words = Pack16(_mm256_packs_epi32(v, v));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_packus_epi16(words, words));
+  }
+};
+#elif HECL_QUANTIZE_SSE2
+struct Simd {
+  static constexpr size_t Width = 4;
+  static constexpr const char* Name = "SSE2";
+  using F = __m128;
+  using I = __m128i;
+
+  static F LoadF(const float* p) { return _mm_loadu_ps(p); }
+  static void StoreF(float* p, F v) { _mm_storeu_ps(p, v); }
+  static F SetF(float v) { return _mm_set1_ps(v); }
+  static F Add(F a, F b) { return _mm_add_ps(a, b); }
+  static F Sub(F a, F b) { return _mm_sub_ps(a, b); }
+  static F Mul(F a, F b) { return _mm_mul_ps(a, b); }
+  static F Div(F a, F b) { return _mm_div_ps(a, b); }
+  static F Max(F a, F b) { return _mm_max_ps(a, b); }
+  static F Min(F a, F b) { return _mm_min_ps(a, b); }
+  static F Sqrt(F a) { return _mm_sqrt_ps(a); }
+  static I CmpGt(F a, F b) { return _mm_castps_si128(_mm_cmpgt_ps(a, b)); }
+  static I CmpGe(F a, F b) { return _mm_castps_si128(_mm_cmpge_ps(a, b)); }
+  static I CmpLt(F a, F b) { return _mm_castps_si128(_mm_cmplt_ps(a, b)); }
+  static F Select(I mask, F a, F b) {
+    const F m = _mm_castsi128_ps(mask);
+    return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+  }
+  static I Cvtt(F a) { return _mm_cvttps_epi32(a); }
+  static F Cvt(I a) { return _mm_cvtepi32_ps(a); }
+  static I AsI(F a) { return _mm_castps_si128(a); }
+  static F AsF(I a) { return _mm_castsi128_ps(a); }
+
+  static I SetI(int32_t v) { return _mm_set1_epi32(v); }
+  static I AddI(I a, I b) { return _mm_add_epi32(a, b); }
+  static I SubI(I a, I b) { return _mm_sub_epi32(a, b); }
+  static I AndI(I a, I b) { return _mm_and_si128(a, b); }
+  static I OrI(I a, I b) { return _mm_or_si128(a, b); }
+  static I XorI(I a, I b) { return _mm_xor_si128(a, b); }
+  static I CmpGtI(I a, I b) { return _mm_cmpgt_epi32(a, b); }
+  static I SelectI(I mask, I a, I b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+  template <int N>
+  static I Srli(I a) { return _mm_srli_epi32(a, N); }
+  template <int N>
+  static I Slli(I a) { return _mm_slli_epi32(a, N); }
+  template <int N>
+  static I Srai(I a) { return _mm_srai_epi32(a, N); }
+
+  static I LoadU16(const uint16_t* p) {
+    return _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)), _mm_setzero_si128());
+  }
+  static I LoadI16(const int16_t* p) {
+    const __m128i words = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+    return _mm_srai_epi32(_mm_unpacklo_epi16(words, words), 16);
+  }
+  static I LoadU8(const uint8_t* p) {
+    int32_t bytes;
+    std::memcpy(&bytes, p, sizeof(bytes));
+    const __m128i zero = _mm_setzero_si128();
+    return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+  }
+  /* SSE2 only packs with signed saturation; bias unsigned words into the signed range and back */
+  static void StoreU16(uint16_t* p, I v) {
+    const __m128i biased = _mm_sub_epi32(v, _mm_set1_epi32(0x8000));
+    const __m128i words = _mm_xor_si128(_mm_packs_epi32(biased, biased), _mm_set1_epi16(int16_t(0x8000)));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(p), words);
+  }
+  static void StoreI16(int16_t* p, I v) { _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_packs_epi32(v, v)); }
+  static void StoreU8(uint8_t* p, I v) {
+    const __m128i words = _mm_packs_epi32(v, v);
+    const int32_t bytes = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+    std::memcpy(p, &bytes, sizeof(bytes));
+  }
+};
+#elif HECL_QUANTIZE_NEON
+struct Simd {
+  static constexpr size_t Width = 4;
+  static constexpr const char* Name = "NEON";
+  using F = float32x4_t;
+  using I = int32x4_t;
+
+  static F LoadF(const float* p) { return vld1q_f32(p); }
+  static void StoreF(float* p, F v) { vst1q_f32(p, v); }
+  static F SetF(float v) { return vdupq_n_f32(v); }
+  static F Add(F a, F b) { return vaddq_f32(a, b); }
+  static F Sub(F a, F b) { return vsubq_f32(a, b); }
+  static F Mul(F a, F b) { return vmulq_f32(a, b); }
+  static F Div(F a, F b) { return vdivq_f32(a, b); }
+  /* vmaxq/vminq propagate NaN, so select explicitly to match the x86 and scalar paths */
+  static F Max(F a, F b) { return vbslq_f32(vcgtq_f32(a, b), a, b); }
+  static F Min(F a, F b) { return vbslq_f32(vcltq_f32(a, b), a, b); }
+  static F Sqrt(F a) { return vsqrtq_f32(a); }
+  static I CmpGt(F a, F b) { return vreinterpretq_s32_u32(vcgtq_f32(a, b)); }
+  static I CmpGe(F a, F b) { return vreinterpretq_s32_u32(vcgeq_f32(a, b)); }
+  static I CmpLt(F a, F b) { return vreinterpretq_s32_u32(vcltq_f32(a, b)); }
+  static F Select(I mask, F a, F b) { return vbslq_f32(vreinterpretq_u32_s32(mask), a, b); }
+  static I Cvtt(F a) { return vcvtq_s32_f32(a); }
+  static F Cvt(I a) { return vcvtq_f32_s32(a); }
+  static I AsI(F a) { return vreinterpretq_s32_f32(a); }
+  static F AsF(I a) { return vreinterpretq_f32_s32(a); }
+
+  static I SetI(int32_t v) { return vdupq_n_s32(v); }
+  static I AddI(I a, I b) { return vaddq_s32(a, b); }
+  static I SubI(I a, I b) { return vsubq_s32(a, b); }
+  static I AndI(I a, I b) { return vandq_s32(a, b); }
+  static I OrI(I a, I b) { return vorrq_s32(a, b); }
+  static I XorI(I a, I b) { return veorq_s32(a, b); }
+  static I CmpGtI(I a, I b) { return vreinterpretq_s32_u32(vcgtq_s32(a, b)); }
+  static I SelectI(I mask, I a, I b) { return vbslq_s32(vreinterpretq_u32_s32(mask), a, b); }
+  template <int N>
+  static I Srli(I a) { return vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(a), N)); }
+  template <int N>
+  static I Slli(I a) { return vshlq_n_s32(a, N); }
+  template <int N>
+  static I Srai(I a) { return vshrq_n_s32(a, N); }
+
+  static I LoadU16(const uint16_t* p) { return vreinterpretq_s32_u32(vmovl_u16(vld1_u16(p))); }
+  static I LoadI16(const int16_t* p) { return vmovl_s16(vld1_s16(p)); }
+  static I LoadU8(const uint8_t* p) {
+    uint32_t bytes;
+    std::memcpy(&bytes, p, sizeof(bytes));
+    const uint16x8_t words = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(bytes)));
+    return vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(words)));
+  }
+  static void StoreU16(uint16_t* p, I v) { vst1_u16(p, vmovn_u32(vreinterpretq_u32_s32(v))); }
+  static void StoreI16(int16_t* p, I v) { vst1_s16(p, vmovn_s32(v)); }
+  static void StoreU8(uint8_t* p, I v) {
+    const uint16x4_t words = vmovn_u32(vreinterpretq_u32_s32(v));
+    const uint8x8_t bytes = vmovn_u16(vcombine_u16(words, words));
+    vst1_lane_u32(reinterpret_cast<uint32_t*>(p), vreinterpret_u32_u8(bytes), 0);
+  }
+};
+#endif
+
+#if HECL_QUANTIZE_AVX2 || HECL_QUANTIZE_SSE2 || HECL_QUANTIZE_NEON
+#define HECL_QUANTIZE_SIMD 1
+using F = Simd::F;
+using I = Simd::I;
+constexpr size_t Width = Simd::Width;
+
+F Abs(F a) { return Simd::AsF(Simd::AndI(Simd::AsI(a), Simd::SetI(0x7fffffff))); }
+F Neg(F a) { return Simd::AsF(Simd::XorI(Simd::AsI(a), Simd::SetI(int32_t(0x80000000)))); }
+F Clamp(F v, float lo, float hi) { return Simd::Min(Simd::Max(v, Simd::SetF(lo)), Simd::SetF(hi)); }
+
+I RoundHalfAway(F x) {
+  const F ax = Abs(x);
+  I ret = Simd::Cvtt(ax);
+  /* Masks are -1 where the fraction rounds up */
+  ret = Simd::SubI(ret, Simd::CmpGe(Simd::Sub(ax, Simd::Cvt(ret)), Simd::SetF(0.5f)));
+  const I negative = Simd::CmpLt(x, Simd::SetF(0.f));
+  return Simd::SubI(Simd::XorI(ret, negative), negative);
+}
+
+I FloatToHalfLanes(F f) {
+  constexpr int32_t DenormMagic = ((127 - 15) + (23 - 10) + 1) << 23;
+  const I bits = Simd::AsI(f);
+  const I sign = Simd::AndI(bits, Simd::SetI(int32_t(0x80000000)));
+  const I x = Simd::XorI(bits, sign);
+
+  const I infNan = Simd::CmpGtI(x, Simd::SetI(((127 + 16) << 23) - 1));
+  const I nan = Simd::CmpGtI(x, Simd::SetI(0x7f800000));
+  const I infNanHalf = Simd::OrI(Simd::SetI(0x7c00), Simd::AndI(nan, Simd::SetI(0x200)));
+
+  const I subnormal = Simd::CmpGtI(Simd::SetI(113 << 23), x);
+  const I subnormalHalf = Simd::SubI(Simd::AsI(Simd::Add(Simd::AsF(x), Simd::AsF(Simd::SetI(DenormMagic)))),
+                                     Simd::SetI(DenormMagic));
+
+  const I mantOdd = Simd::AndI(Simd::Srli<13>(x), Simd::SetI(1));
+  const I normalHalf =
+      Simd::Srli<13>(Simd::AddI(Simd::AddI(x, Simd::SetI(int32_t(uint32_t(15 - 127) << 23) + 0xfff)), mantOdd));
+
+  const I ret = Simd::SelectI(infNan, infNanHalf, Simd::SelectI(subnormal, subnormalHalf, normalHalf));
+  return Simd::OrI(ret, Simd::Srli<16>(sign));
+}
+
+F HalfToFloatLanes(I h) {
+  constexpr int32_t Magic = (254 - 15) << 23;
+  constexpr int32_t WasInfNan = (127 + 16) << 23;
+  const F f = Simd::Mul(Simd::AsF(Simd::Slli<13>(Simd::AndI(h, Simd::SetI(0x7fff)))), Simd::AsF(Simd::SetI(Magic)));
+  const I infNan = Simd::CmpGe(f, Simd::AsF(Simd::SetI(WasInfNan)));
+  I bits = Simd::OrI(Simd::AsI(f), Simd::AndI(infNan, Simd::SetI(255 << 23)));
+  bits = Simd::OrI(bits, Simd::Slli<16>(Simd::AndI(h, Simd::SetI(0x8000))));
+  return Simd::AsF(bits);
+}
+
+/* Fold of OctEncode() for the lanes; ends in snorm16 like the scalar path */
+void OctEncodeLanes(F x, F y, F z, I& qu, I& qv) {
+  const F zero = Simd::SetF(0.f);
+  const F one = Simd::SetF(1.f);
+  const F minusOne = Simd::SetF(-1.f);
+  const F l1 = Simd::Add(Simd::Add(Abs(x), Abs(y)), Abs(z));
+  const I nonZero = Simd::CmpGt(l1, Simd::SetF(FLT_EPSILON));
+  F u = Simd::Select(nonZero, Simd::Div(x, l1), zero);
+  F v = Simd::Select(nonZero, Simd::Div(y, l1), zero);
+  const F foldU = Simd::Mul(Simd::Sub(one, Abs(v)), Simd::Select(Simd::CmpGe(u, zero), one, minusOne));
+  const F foldV = Simd::Mul(Simd::Sub(one, Abs(u)), Simd::Select(Simd::CmpGe(v, zero), one, minusOne));
+  const I lower = Simd::CmpLt(z, zero);
+  u = Simd::Select(lower, foldU, u);
+  v = Simd::Select(lower, foldV, v);
+  qu = RoundHalfAway(Simd::Mul(Clamp(u, -1.f, 1.f), Simd::SetF(32767.f)));
+  qv = RoundHalfAway(Simd::Mul(Clamp(v, -1.f, 1.f), Simd::SetF(32767.f)));
+}
+
+F Snorm16Lanes(I v) { return Simd::Max(Simd::Div(Simd::Cvt(v), Simd::SetF(32767.f)), Simd::SetF(-1.f)); }
+
+void OctDecodeLanes(F u, F v, F& x, F& y, F& z) {
+  const F zero = Simd::SetF(0.f);
+  z = Simd::Sub(Simd::Sub(Simd::SetF(1.f), Abs(u)), Abs(v));
+  const F fold = Simd::Max(Neg(z), zero);
+  x = Simd::Add(u, Simd::Select(Simd::CmpGe(u, zero), Neg(fold), fold));
+  y = Simd::Add(v, Simd::Select(Simd::CmpGe(v, zero), Neg(fold), fold));
+  const F len = Simd::Sqrt(Simd::Add(Simd::Add(Simd::Mul(x, x), Simd::Mul(y, y)), Simd::Mul(z, z)));
+  x = Simd::Div(x, len);
+  y = Simd::Div(y, len);
+  z = Simd::Div(z, len);
+}
+#endif
+} // anonymous namespace
+
+/* Whole vectors go through the lanes above; the remainder takes the scalar reference */
+
+void FloatToHalf(const float* in, uint16_t* out, size_t count) {
+  size_t i = 0;
+#if HECL_QUANTIZE_SIMD
+  for (; i + Width <= count; i += Width)
+    Simd::StoreU16(out + i, FloatToHalfLanes(Simd::LoadF(in + i)));
+#endif
+  for (; i < count; ++i)
+    out[i] = FloatToHalf(in[i]);
+}
+
+void HalfToFloat(const uint16_t* in, float* out, size_t count) {
+  size_t i = 0;
+#if HECL_QUANTIZE_SIMD
+  for (; i + Width <= count; i += Width)
+    Simd::StoreF(out + i, HalfToFloatLanes(Simd::LoadU16(in + i)));
+#endif
+  for (; i < count; ++i)
+    out[i] = HalfToFloat(in[i]);
+}
+
+void FloatToUnorm16(const float* in, uint16_t* out, size_t count) {
+  size_t i = 0;
+#if HECL_QUANTIZE_SIMD
+  for (; i + Width <= count; i += Width)
+    Simd::StoreU16(out + i, RoundHalfAway(Simd::Mul(Clamp(Simd::LoadF(in + i), 0.f, 1.f), Simd::SetF(65535.f))));
+#endif
+  for (; i < count; ++i)
+    out[i] = FloatToUnorm16(in[i]);
+}
+
+void FloatToSnorm16(const float* in, int16_t* out, size_t count) {
+  size_t i = 0;
+#if HECL_QUANTIZE_SIMD
+  for (; i + Width <= count; i += Width)
+    Simd::StoreI16(out + i, RoundHalfAway(Simd::Mul(Clamp(Simd::LoadF(in + i), -1.f, 1.f), Simd::SetF(32767.f))));
+#endif
+  for (; i < count; ++i)
+    out[i] = FloatToSnorm16(in[i]);
+}
+
+void FloatToUnorm8(const float* in, uint8_t* out, size_t count) {
+  size_t i = 0;
+#if HECL_QUANTIZE_SIMD
+  for (; i + Width <= count; i += Width)
+    Simd::StoreU8(out + i, RoundHalfAway(Simd::Mul(Clamp(Simd::LoadF(in + i), 0.f, 1.f), Simd::SetF(255.f))));
+#endif
+  for (; i < count; ++i)
+    out[i] = FloatToUnorm8(in[i]);
+}
+
+void Unorm16ToFloat(const uint16_t* in, float* out, size_t count) {
+  size_t i = 0;
+#if HECL_QUANTIZE_SIMD
+  for (; i + Width <= count; i += Width)
+    Simd::StoreF(out + i, Simd::Div(Simd::Cvt(Simd::LoadU16(in + i)), Simd::SetF(65535.f)));
+#endif
+  for (; i < count; ++i)
+    out[i] = Unorm16ToFloat(in[i]);
+}
+
+void Snorm16ToFloat(const int16_t* in, float* out, size_t count) {
+  size_t i = 0;
+#if HECL_QUANTIZE_SIMD
+  for (; i + Width <= count; i += Width)
+    Simd::StoreF(out + i, Snorm16Lanes(Simd::LoadI16(in + i)));
+#endif
+  for (; i < count; ++i)
+    out[i] = Snorm16ToFloat(in[i]);
+}
+
+void Unorm8ToFloat(const uint8_t* in, float* out, size_t count) {
+  size_t i = 0;
+#if HECL_QUANTIZE_SIMD
+  for (; i + Width <= count; i += Width)
+    Simd::StoreF(out + i, Simd::Div(Simd::Cvt(Simd::LoadU8(in + i)), Simd::SetF(255.f)));
+#endif
+  for (; i < count; ++i)
+    out[i] = Unorm8ToFloat(in[i]);
+}
+
+void OctEncodeSnorm16(const float* xyz, int16_t* out, size_t count) {
+  size_t i = 0;
+#if HECL_QUANTIZE_SIMD
+  /* Interleaved components are transposed through small stack blocks */
+  for (; i + Width <= count; i += Width) {
+    float comps[3][Width];
+    for (size_t l = 0; l < Width; ++l)
+      for (size_t c = 0; c < 3; ++c)
+        comps[c][l] = xyz[(i + l) * 3 + c];
+    I qu, qv;
+    OctEncodeLanes(Simd::LoadF(comps[0]), Simd::LoadF(comps[1]), Simd::LoadF(comps[2]), qu, qv);
+    int16_t us[Width], vs[Width];
+    Simd::StoreI16(us, qu);
+    Simd::StoreI16(vs, qv);
+    for (size_t l = 0; l < Width; ++l) {
+      out[(i + l) * 2] = us[l];
+      out[(i + l) * 2 + 1] = vs[l];
+    }
+  }
+#endif
+  for (; i < count; ++i) {
+    const auto [u, v] = OctEncode(xyz[i * 3], xyz[i * 3 + 1], xyz[i * 3 + 2]);
+    out[i * 2] = FloatToSnorm16(u);
+    out[i * 2 + 1] = FloatToSnorm16(v);
+  }
+}
+
+void OctDecodeSnorm16(const int16_t* in, float* xyz, size_t count) {
+  size_t i = 0;
+#if HECL_QUANTIZE_SIMD
+  for (; i + Width <= count; i += Width) {
+    int16_t us[Width], vs[Width];
+    for (size_t l = 0; l < Width; ++l) {
+      us[l] = in[(i + l) * 2];
+      vs[l] = in[(i + l) * 2 + 1];
+    }
+    F x, y, z;
+    OctDecodeLanes(Snorm16Lanes(Simd::LoadI16(us)), Snorm16Lanes(Simd::LoadI16(vs)), x, y, z);
+    float comps[3][Width];
+    Simd::StoreF(comps[0], x);
+    Simd::StoreF(comps[1], y);
+    Simd::StoreF(comps[2], z);
+    for (size_t l = 0; l < Width; ++l)
+      for (size_t c = 0; c < 3; ++c)
+        xyz[(i + l) * 3 + c] = comps[c][l];
+  }
+#endif
+  for (; i < count; ++i) {
+    const std::array<float, 3> n = OctDecode(Snorm16ToFloat(in[i * 2]), Snorm16ToFloat(in[i * 2 + 1]));
+    xyz[i * 3] = n[0];
+    xyz[i * 3 + 1] = n[1];
+    xyz[i * 3 + 2] = n[2];
+  }
+}
+
+const char* QuantizeKernelName() {
+#if HECL_QUANTIZE_SIMD
+  return Simd::Name;
+#else
+  return "scalar";
+#endif
+}
+
+} // namespace hecl
@@ -0,0 +1,83 @@
+#include "hecl/RemoteCookAgent.hpp"
+
+#include <cstdlib>
+
+#include "hecl/Database.hpp"
+
+#include <logvisor/logvisor.hpp>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#endif
+
+namespace hecl {
+
+static logvisor::Module Log("hecl::RemoteCookAgent");
+
+namespace {
+void AppendQuoted(SystemString& cmd, SystemStringView arg) {
+  cmd += _SYS_STR(' ');
+#if _WIN32
+  cmd += _SYS_STR('"');
+  cmd += arg;
+  cmd += _SYS_STR('"');
+#else
+  cmd += '\'';
+  for (char ch : arg) {
+    if (ch == '\'')
+      cmd += "'\\''";
+    else
+      cmd += ch;
+  }
+  cmd += '\'';
+#endif
+}
+} // anonymous namespace
+
+bool CommandCookAgent::cook(const ProjectPath& path, const Database::DataSpecEntry& spec, bool fast, bool force) {
+  SystemString cmd = m_command + _SYS_STR(" cook --agent");
+  if (force)
+    cmd += _SYS_STR(" -f");
+  if (fast)
+    cmd += _SYS_STR(" --fast");
+  AppendQuoted(cmd, SystemString(_SYS_STR("--spec=")) + SystemString(spec.m_name));
+  if (path.getAuxInfo().empty())
+    AppendQuoted(cmd, path.getRelativePath());
+  else
+    AppendQuoted(cmd, SystemString(path.getRelativePath()) + _SYS_STR('|') + SystemString(path.getAuxInfo()));
+
+#if _WIN32
+  const int status = _wsystem(cmd.c_str());
+  const bool ok = status == 0;
+#else
+  const int status = std::system(cmd.c_str());
+  const bool ok = status != -1 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+#endif
+  if (!ok)
+    Log.report(logvisor::Warning, FMT_STRING(_SYS_STR("cook agent '{}' failed on '{}' ({})")), m_command,
+               path.getRelativePath(), status);
+  return ok;
+}
+
+std::vector<std::shared_ptr<RemoteCookAgent>> DefaultRemoteCookAgents() {
+  std::vector<std::shared_ptr<RemoteCookAgent>> ret;
+#if _WIN32
+  const wchar_t* agents = _wgetenv(L"HECL_COOK_AGENTS");
+#else
+  const char* agents = std::getenv("HECL_COOK_AGENTS");
+#endif
+  if (!agents)
+    return ret;
+
+  SystemStringView remaining(agents);
+  while (!remaining.empty()) {
+    const size_t sep = remaining.find(_SYS_STR(';'));
+    const SystemString command = StringUtils::TrimWhitespace(remaining.substr(0, sep));
+    remaining = sep == SystemStringView::npos ? SystemStringView() : remaining.substr(sep + 1);
+    if (!command.empty())
+      ret.push_back(std::make_shared<CommandCookAgent>(command));
+  }
+  return ret;
+}
+
+} // namespace hecl
@@ -0,0 +1,207 @@
+#include "hecl/RemoteCookStore.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+
+#include "hecl/hecl.hpp"
+
+#include <logvisor/logvisor.hpp>
+#include <zlib.h>
+
+namespace hecl::Database {
+
+static logvisor::Module Log("hecl::RemoteCookStore");
+
+constexpr uint32_t StoreObjectMagic = 'HCKS';
+constexpr uint32_t StoreObjectVersion = 1;
+
+namespace {
+struct ObjectHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t rawSize;
+  uint64_t digest;
+};
+
+constexpr size_t ChunkSize = 64 * 1024;
+
+/* Sibling of path unique across threads and machines, for writing before an atomic rename */
+SystemString PartPath(const SystemString& path) {
+  static const uint64_t Salt = (uint64_t(std::random_device{}()) << 32) | std::random_device{}();
+  static std::atomic_uint64_t Counter = 0;
+  const uint64_t stamp = uint64_t(std::chrono::steady_clock::now().time_since_epoch().count());
+  return path + fmt::format(FMT_STRING(_SYS_STR(".{:x}-{:x}-{:x}.part")), Salt, stamp, Counter++);
+}
+
+bool MakeDirs(const SystemString& dir) {
+  /* Another machine may create the directory between our stat and mkdir */
+  Sstat theStat;
+  return hecl::RecursiveMakeDir(dir.c_str()) == 0 || (!hecl::Stat(dir.c_str(), &theStat) && S_ISDIR(theStat.st_mode));
+}
+
+/* Deflate in into out, returning the digest and size of in */
+bool DeflateFile(FILE* in, FILE* out, uint64_t& digest, uint64_t& rawSize) {
+  z_stream strm = {};
+  if (deflateInit(&strm, Z_BEST_SPEED) != Z_OK)
+    return false;
+  XXH64_state_t st;
+  XXH64_reset(&st, 0);
+  rawSize = 0;
+
+  auto inBuf = std::make_unique<uint8_t[]>(ChunkSize);
+  auto outBuf = std::make_unique<uint8_t[]>(ChunkSize);
+  bool ok = true;
+  int flush;
+  do {
+    const size_t readSz = std::fread(inBuf.get(), 1, ChunkSize, in);
+    if (std::ferror(in)) {
+      ok = false;
+      break;
+    }
+    XXH64_update(&st, inBuf.get(), readSz);
+    rawSize += readSz;
+    flush = std::feof(in) ? Z_FINISH : Z_NO_FLUSH;
+    strm.next_in = inBuf.get();
+    strm.avail_in = uInt(readSz);
+    do {
+      strm.next_out = outBuf.get();
+      strm.avail_out = uInt(ChunkSize);
+      deflate(&strm, flush);
+      const size_t have = ChunkSize - strm.avail_out;
+      if (std::fwrite(outBuf.get(), 1, have, out) != have) {
+        ok = false;
+        break;
+      }
+    } while (strm.avail_out == 0);
+  } while (ok && flush != Z_FINISH);
+  deflateEnd(&strm);
+  digest = XXH64_digest(&st);
+  return ok;
+}
+
+/* Inflate in into out, verifying the result against the object header */
+bool InflateFile(FILE* in, FILE* out, const ObjectHeader& header) {
+  z_stream strm = {};
+  if (inflateInit(&strm) != Z_OK)
+    return false;
+  XXH64_state_t st;
+  XXH64_reset(&st, 0);
+  uint64_t rawSize = 0;
+
+  auto inBuf = std::make_unique<uint8_t[]>(ChunkSize);
+  auto outBuf = std::make_unique<uint8_t[]>(ChunkSize);
+  int ret = Z_OK;
+  while (ret != Z_STREAM_END) {
+    strm.avail_in = uInt(std::fread(inBuf.get(), 1, ChunkSize, in));
+    if (!strm.avail_in)
+      break;
+    strm.next_in = inBuf.get();
+    do {
+      strm.next_out = outBuf.get();
+      strm.avail_out = uInt(ChunkSize);
+      ret = inflate(&strm, Z_NO_FLUSH);
+      if (ret != Z_OK && ret != Z_STREAM_END) {
+        inflateEnd(&strm);
+        return false;
+      }
+      const size_t have = ChunkSize - strm.avail_out;
+      XXH64_update(&st, outBuf.get(), have);
+      rawSize += have;
+      if (std::fwrite(outBuf.get(), 1, have, out) != have) {
+        inflateEnd(&strm);
+        return false;
+      }
+    } while (strm.avail_out == 0 && ret != Z_STREAM_END);
+  }
+  inflateEnd(&strm);
+  return ret == Z_STREAM_END && rawSize == header.rawSize && XXH64_digest(&st) == header.digest;
+}
+} // anonymous namespace
+
+SharedDirCookStore::SharedDirCookStore(SystemStringView root) : m_root(root) {}
+
+SystemString SharedDirCookStore::_objectPath(uint64_t key) const {
+  /* Fan out by the top byte so no single directory grows unmanageably large */
+  return m_root + fmt::format(FMT_STRING(_SYS_STR("/{:02X}/{:016X}")), key >> 56, key);
+}
+
+bool SharedDirCookStore::fetch(uint64_t key, const SystemString& dest) {
+  const SystemString objPath = _objectPath(key);
+  auto in = hecl::FopenUnique(objPath.c_str(), _SYS_STR("rb"));
+  if (!in)
+    return false;
+  ObjectHeader header;
+  if (std::fread(&header, 1, sizeof(header), in.get()) != sizeof(header) || header.magic != StoreObjectMagic ||
+      header.version != StoreObjectVersion)
+    return false;
+
+  const SystemString partPath = PartPath(dest);
+  auto out = hecl::FopenUnique(partPath.c_str(), _SYS_STR("wb"));
+  if (!out)
+    return false;
+  const bool ok = InflateFile(in.get(), out.get(), header);
+  const bool closed = std::fclose(out.release()) == 0;
+  if (!ok || !closed) {
+    if (!ok)
+      Log.report(logvisor::Warning, FMT_STRING(_SYS_STR("discarding corrupt cook store object '{}'")), objPath);
+    hecl::Unlink(partPath.c_str());
+    return false;
+  }
+  if (hecl::Rename(partPath.c_str(), dest.c_str())) {
+    hecl::Unlink(partPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+void SharedDirCookStore::store(uint64_t key, const SystemString& src) {
+  /* Keys address content; an existing object already holds these bytes */
+  const SystemString objPath = _objectPath(key);
+  Sstat theStat;
+  if (!hecl::Stat(objPath.c_str(), &theStat))
+    return;
+
+  auto in = hecl::FopenUnique(src.c_str(), _SYS_STR("rb"));
+  if (!in)
+    return;
+  if (!MakeDirs(objPath.substr(0, objPath.rfind(_SYS_STR('/'))))) {
+    Log.report(logvisor::Warning, FMT_STRING(_SYS_STR("unable to create cook store directory for '{}'")), objPath);
+    return;
+  }
+
+  const SystemString partPath = PartPath(objPath);
+  auto out = hecl::FopenUnique(partPath.c_str(), _SYS_STR("wb"));
+  if (!out) {
+    Log.report(logvisor::Warning, FMT_STRING(_SYS_STR("unable to write cook store object '{}'")), partPath);
+    return;
+  }
+
+  /* Header is rewritten once the digest is known */
+  ObjectHeader header{StoreObjectMagic, StoreObjectVersion, 0, 0};
+  bool ok = std::fwrite(&header, 1, sizeof(header), out.get()) == sizeof(header) &&
+            DeflateFile(in.get(), out.get(), header.digest, header.rawSize);
+  ok = ok && std::fseek(out.get(), 0, SEEK_SET) == 0 &&
+       std::fwrite(&header, 1, sizeof(header), out.get()) == sizeof(header);
+  ok = std::fclose(out.release()) == 0 && ok;
+  if (!ok || hecl::Rename(partPath.c_str(), objPath.c_str())) {
+    Log.report(logvisor::Warning, FMT_STRING(_SYS_STR("unable to publish cook store object '{}'")), objPath);
+    hecl::Unlink(partPath.c_str());
+  }
+}
+
+std::shared_ptr<RemoteCookStore> DefaultRemoteCookStore() {
+#if _WIN32
+  const wchar_t* root = _wgetenv(L"HECL_COOK_STORE");
+#else
+  const char* root = std::getenv("HECL_COOK_STORE");
+#endif
+  if (!root || !root[0])
+    return {};
+  return std::make_shared<SharedDirCookStore>(root);
+}
+
+} // namespace hecl::Database
@@ -0,0 +1,76 @@
+#include "hecl/Runtime.hpp"
+
+#include <cstdio>
+
+#include "hecl/hecl.hpp"
+
+#include <logvisor/logvisor.hpp>
+
+namespace hecl::Runtime {
+static logvisor::Module Log("DriverPipelineCache");
+
+constexpr uint32_t DriverCacheMagic = 'HDPC';
+constexpr uint32_t DriverCacheVersion = 1;
+
+namespace {
+struct DriverCacheHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t deviceKey;
+  uint64_t size;
+  uint64_t checksum;
+};
+} // anonymous namespace
+
+DriverPipelineCache::DriverPipelineCache(const FileStoreManager& store, boo::IGraphicsDataFactory::Platform platform,
+                                         std::string_view deviceId)
+: m_deviceKey(XXH64(deviceId.data(), deviceId.size(), 0)) {
+  SystemString dir = SystemString(store.getStoreRoot()) + _SYS_STR("/pipelinecache");
+  hecl::MakeDir(dir.c_str());
+  m_path = dir + fmt::format(FMT_STRING(_SYS_STR("/{}_{:016X}.bin")), int(platform), m_deviceKey);
+}
+
+std::vector<uint8_t> DriverPipelineCache::load() const {
+  auto fp = hecl::FopenUnique(m_path.c_str(), _SYS_STR("rb"));
+  if (!fp)
+    return {};
+
+  DriverCacheHeader header;
+  if (std::fread(&header, 1, sizeof(header), fp.get()) != sizeof(header) || header.magic != DriverCacheMagic ||
+      header.version != DriverCacheVersion || header.deviceKey != m_deviceKey)
+    return {};
+
+  /* The file name already encodes the key; a mismatch here means a hash collision or foreign file */
+  if (hecl::FSeek(fp.get(), 0, SEEK_END) || uint64_t(hecl::FTell(fp.get())) != sizeof(header) + header.size ||
+      hecl::FSeek(fp.get(), sizeof(header), SEEK_SET))
+    return {};
+
+  std::vector<uint8_t> ret(header.size);
+  if (std::fread(ret.data(), 1, ret.size(), fp.get()) != ret.size() ||
+      XXH64(ret.data(), ret.size(), 0) != header.checksum) {
+    Log.report(logvisor::Warning, FMT_STRING(_SYS_STR("discarding corrupt pipeline cache '{}'")), m_path);
+    return {};
+  }
+  return ret;
+}
+
+bool DriverPipelineCache::save(const void* data, size_t size) const {
+  const SystemString partPath = m_path + _SYS_STR(".part");
+  auto fp = hecl::FopenUnique(partPath.c_str(), _SYS_STR("wb"));
+  if (!fp) {
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to write pipeline cache '{}'")), partPath);
+    return false;
+  }
+
+  const DriverCacheHeader header{DriverCacheMagic, DriverCacheVersion, m_deviceKey, size, XXH64(data, size, 0)};
+  const bool ok = std::fwrite(&header, 1, sizeof(header), fp.get()) == sizeof(header) &&
+                  std::fwrite(data, 1, size, fp.get()) == size;
+  fp.reset();
+  if (!ok) {
+    hecl::Unlink(partPath.c_str());
+    return false;
+  }
+  return hecl::Rename(partPath.c_str(), m_path.c_str()) == 0;
+}
+
+} // namespace hecl::Runtime
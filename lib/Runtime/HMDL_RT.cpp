@@ -1,48 +1,340 @@
 #include "hecl/HMDLMeta.hpp"
 
+#include "hecl/Quantize.hpp"
 #include "hecl/Runtime.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <initializer_list>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <utility>
+
 #include <athena/MemoryReader.hpp>
+#include <athena/MemoryWriter.hpp>
 #include <logvisor/logvisor.hpp>
 
 namespace hecl::Runtime {
 static logvisor::Module HMDL_Log("HMDL");
 
-HMDLData::HMDLData(boo::IGraphicsDataFactory::Context& ctx, const void* metaData, const void* vbo, const void* ibo) {
+/* Decode an octahedral snorm16x2 unit vector as three floats */
+static void ExpandOct16(athena::io::MemoryReader& r, athena::io::MemoryWriter& w) {
+  const float u = Snorm16ToFloat(r.readInt16Little());
+  const float v = Snorm16ToFloat(r.readInt16Little());
+  for (float c : OctDecode(u, v))
+    w.writeFloatLittle(c);
+}
+
+/* Rewrite a VBO with packed HMDLAttrFormat attributes as the equivalent Float32 layout */
+static std::unique_ptr<uint8_t[]> ExpandPackedVertices(HMDLMeta& meta, const void* vbo) {
+  const size_t floatStride =
+      (3 + 3 + meta.tangentCount * 4 + meta.colorCount + meta.uvCount * 2 + meta.weightCount * 4) * 4;
+  auto ret = std::make_unique<uint8_t[]>(floatStride * meta.vertCount);
+  athena::io::MemoryReader r(vbo, size_t(meta.vertStride) * meta.vertCount);
+  athena::io::MemoryWriter w(ret.get(), floatStride * meta.vertCount);
+  const athena::simd_floats posOffset(meta.posOffset.simd);
+  const athena::simd_floats posScale(meta.posScale.simd);
+  for (atUint32 i = 0; i < meta.vertCount; ++i) {
+    if (meta.posFormat == HMDLAttrFormat::Unorm16) {
+      for (int c = 0; c < 3; ++c)
+        w.writeFloatLittle(posOffset[c] + Unorm16ToFloat(r.readUint16Little()) * posScale[c]);
+      r.readUint16Little();
+    } else {
+      w.writeVec3fLittle(r.readVec3fLittle());
+    }
+
+    if (meta.normFormat == HMDLAttrFormat::Oct16) {
+      ExpandOct16(r, w);
+    } else {
+      w.writeVec3fLittle(r.readVec3fLittle());
+    }
+
+    if (meta.tangentCount) {
+      if (meta.normFormat == HMDLAttrFormat::Oct16) {
+        ExpandOct16(r, w);
+        w.writeFloatLittle(r.readInt16Little() < 0 ? -1.f : 1.f);
+        r.readInt16Little();
+      } else {
+        w.writeVec4fLittle(r.readVec4fLittle());
+      }
+    }
+
+    for (atUint32 c = 0; c < meta.colorCount; ++c)
+      for (int b = 0; b < 4; ++b)
+        w.writeUByte(r.readUByte());
+
+    for (atUint32 u = 0; u < meta.uvCount; ++u) {
+      for (int c = 0; c < 2; ++c) {
+        switch (meta.uvFormat) {
+        case HMDLAttrFormat::Unorm16:
+          w.writeFloatLittle(Unorm16ToFloat(r.readUint16Little()));
+          break;
+        case HMDLAttrFormat::Half16:
+          w.writeFloatLittle(HalfToFloat(r.readUint16Little()));
+          break;
+        default:
+          w.writeFloatLittle(r.readFloatLittle());
+          break;
+        }
+      }
+    }
+
+    for (atUint32 wv = 0; wv < meta.weightCount; ++wv) {
+      for (int c = 0; c < 4; ++c)
+        w.writeFloatLittle(meta.weightFormat == HMDLAttrFormat::Unorm8 ? Unorm8ToFloat(r.readUByte())
+                                                                       : r.readFloatLittle());
+    }
+  }
+
+  meta.vertStride = floatStride;
+  return ret;
+}
+
+/* Upload-ready view of HMDL data; packed attributes and compact indices already expanded */
+struct HMDLStaging {
   HMDLMeta meta;
-  {
-    athena::io::MemoryReader r(metaData, HECL_HMDL_META_SZ);
-    meta.read(r);
+  const void* vbo;
+  const void* ibo;
+  std::unique_ptr<uint8_t[]> expandedVbo;
+  std::unique_ptr<atUint32[]> widenedIbo;
+
+  HMDLStaging(const void* metaData, const void* vboIn, const void* iboIn) : vbo(vboIn), ibo(iboIn) {
+    {
+      athena::io::MemoryReader r(metaData, HECL_HMDL_META_SZ);
+      meta.read(r);
+    }
+    if (meta.magic != 'TACO')
+      HMDL_Log.report(logvisor::Fatal, FMT_STRING("invalid HMDL magic"));
+
+    /* boo vertex element descriptors carry only a semantic, and apart from unorm8 colors
+     * every semantic is float-based; packed attributes are expanded before upload */
+    if (meta.posFormat != HMDLAttrFormat::Float32 || meta.normFormat != HMDLAttrFormat::Float32 ||
+        meta.uvFormat != HMDLAttrFormat::Float32 || meta.weightFormat != HMDLAttrFormat::Float32) {
+      expandedVbo = ExpandPackedVertices(meta, vbo);
+      vbo = expandedVbo.get();
+    }
+
+    /* boo binds index buffers as 32-bit; widen compact indices before upload */
+    if (meta.indexSize == 2) {
+      widenedIbo = std::make_unique<atUint32[]>(meta.indexCount);
+      athena::io::MemoryReader r(ibo, size_t(meta.indexCount) * 2);
+      for (atUint32 i = 0; i < meta.indexCount; ++i) {
+        const atUint16 idx = r.readUint16Little();
+        widenedIbo[i] = idx == 0xffff ? 0xffffffff : idx;
+      }
+      ibo = widenedIbo.get();
+    } else if (meta.indexSize != 4) {
+      HMDL_Log.report(logvisor::Fatal, FMT_STRING("invalid HMDL index size {}"), meta.indexSize);
+    }
   }
-  if (meta.magic != 'TACO')
-    HMDL_Log.report(logvisor::Fatal, FMT_STRING("invalid HMDL magic"));
+};
+
+HMDLData::HMDLData(boo::IGraphicsDataFactory::Context& ctx, const void* metaData, const void* vbo, const void* ibo)
+: HMDLData(ctx, HMDLStaging(metaData, vbo, ibo)) {}
+
+HMDLData::HMDLData(boo::IGraphicsDataFactory::Context& ctx, const HMDLStaging& staging) {
+  const HMDLMeta& meta = staging.meta;
+  m_vbo = ctx.newStaticBuffer(boo::BufferUse::Vertex, staging.vbo, meta.vertStride, meta.vertCount);
+  m_ibo = ctx.newStaticBuffer(boo::BufferUse::Index, staging.ibo, 4, meta.indexCount);
+  _buildVtxFmt(meta);
+}
+
+HMDLData::HMDLData(const HMDLMeta& meta, boo::ObjToken<boo::IGraphicsBufferS> vbo,
+                   boo::ObjToken<boo::IGraphicsBufferS> ibo, size_t baseVert, size_t baseIndex)
+: m_vbo(std::move(vbo)), m_ibo(std::move(ibo)), m_baseVert(baseVert), m_baseIndex(baseIndex) {
+  _buildVtxFmt(meta);
+}
+
+namespace {
+/* Interned descriptor arrays; entries are never freed, so their addresses stay valid for every HMDLData */
+struct VertexFormatEntry {
+  std::unique_ptr<boo::VertexElementDescriptor[]> elements;
+  boo::VertexFormatInfo info;
+  uint32_t id;
+};
 
-  m_vbo = ctx.newStaticBuffer(boo::BufferUse::Vertex, vbo, meta.vertStride, meta.vertCount);
-  m_ibo = ctx.newStaticBuffer(boo::BufferUse::Index, ibo, 4, meta.indexCount);
+std::mutex VertexFormatMutex;
+std::map<std::tuple<atUint32, atUint32, atUint32, atUint32>, std::unique_ptr<VertexFormatEntry>> VertexFormats;
 
-  const size_t elemCount = 2 + meta.colorCount + meta.uvCount + meta.weightCount;
-  m_vtxFmtData = std::make_unique<boo::VertexElementDescriptor[]>(elemCount);
+const VertexFormatEntry& InternVertexFormat(const HMDLMeta& meta) {
+  std::unique_lock lk{VertexFormatMutex};
+  auto& entry = VertexFormats[{meta.tangentCount, meta.colorCount, meta.uvCount, meta.weightCount}];
+  if (entry)
+    return *entry;
 
-  m_vtxFmtData[0].semantic = boo::VertexSemantic::Position3;
-  m_vtxFmtData[1].semantic = boo::VertexSemantic::Normal3;
+  const size_t elemCount = 2 + meta.tangentCount + meta.colorCount + meta.uvCount + meta.weightCount;
+  entry = std::make_unique<VertexFormatEntry>();
+  entry->elements = std::make_unique<boo::VertexElementDescriptor[]>(elemCount);
+  boo::VertexElementDescriptor* elements = entry->elements.get();
+
+  elements[0].semantic = boo::VertexSemantic::Position3;
+  elements[1].semantic = boo::VertexSemantic::Normal3;
   size_t e = 2;
 
+  /* boo has no tangent semantic; tangents bind as the second normal slot with the sign in w */
+  for (size_t i = 0; i < meta.tangentCount; ++i, ++e) {
+    elements[e].semantic = boo::VertexSemantic::Normal4;
+    elements[e].semanticIdx = 1;
+  }
+
   for (size_t i = 0; i < meta.colorCount; ++i, ++e) {
-    m_vtxFmtData[e].semantic = boo::VertexSemantic::ColorUNorm;
-    m_vtxFmtData[e].semanticIdx = i;
+    elements[e].semantic = boo::VertexSemantic::ColorUNorm;
+    elements[e].semanticIdx = i;
   }
 
   for (size_t i = 0; i < meta.uvCount; ++i, ++e) {
-    m_vtxFmtData[e].semantic = boo::VertexSemantic::UV2;
-    m_vtxFmtData[e].semanticIdx = i;
+    elements[e].semantic = boo::VertexSemantic::UV2;
+    elements[e].semanticIdx = i;
   }
 
   for (size_t i = 0; i < meta.weightCount; ++i, ++e) {
-    m_vtxFmtData[e].semantic = boo::VertexSemantic::Weight;
-    m_vtxFmtData[e].semanticIdx = i;
+    elements[e].semantic = boo::VertexSemantic::Weight;
+    elements[e].semanticIdx = i;
+  }
+
+  entry->info = boo::VertexFormatInfo(elemCount, elements);
+  entry->id = uint32_t(VertexFormats.size() - 1);
+  return *entry;
+}
+} // anonymous namespace
+
+void HMDLData::_buildVtxFmt(const HMDLMeta& meta) {
+  const VertexFormatEntry& format = InternVertexFormat(meta);
+  m_vtxFmt = format.info;
+  m_vtxFmtId = format.id;
+}
+
+HMDLArena::HMDLArena() = default;
+HMDLArena::~HMDLArena() = default;
+
+size_t HMDLArena::add(const void* metaData, const void* vbo, const void* ibo) {
+  m_staged.push_back(std::make_unique<HMDLStaging>(metaData, vbo, ibo));
+  return m_staged.size() - 1;
+}
+
+std::vector<std::unique_ptr<HMDLData>> HMDLArena::build(boo::IGraphicsDataFactory::Context& ctx) {
+  /* Staged layouts are all float apart from colors, so stride and attribute counts identify the format */
+  using LayoutKey = std::tuple<atUint32, atUint32, atUint32, atUint32, atUint32>;
+  std::map<LayoutKey, std::vector<size_t>> groups;
+  for (size_t i = 0; i < m_staged.size(); ++i) {
+    const HMDLMeta& meta = m_staged[i]->meta;
+    groups[{meta.vertStride, meta.tangentCount, meta.colorCount, meta.uvCount, meta.weightCount}].push_back(i);
+  }
+
+  std::vector<std::unique_ptr<HMDLData>> ret(m_staged.size());
+  for (const auto& [key, members] : groups) {
+    const size_t stride = std::get<0>(key);
+    size_t vertCount = 0;
+    size_t indexCount = 0;
+    for (size_t i : members) {
+      vertCount += m_staged[i]->meta.vertCount;
+      indexCount += m_staged[i]->meta.indexCount;
+    }
+
+    auto vertData = std::make_unique<uint8_t[]>(stride * vertCount);
+    auto indexData = std::make_unique<atUint32[]>(indexCount);
+    size_t vertOffset = 0;
+    size_t indexOffset = 0;
+    for (size_t i : members) {
+      const HMDLStaging& staging = *m_staged[i];
+      std::memcpy(vertData.get() + vertOffset * stride, staging.vbo, stride * staging.meta.vertCount);
+      std::memcpy(indexData.get() + indexOffset, staging.ibo, 4 * staging.meta.indexCount);
+      vertOffset += staging.meta.vertCount;
+      indexOffset += staging.meta.indexCount;
+    }
+
+    auto vbo = ctx.newStaticBuffer(boo::BufferUse::Vertex, vertData.get(), stride, vertCount);
+    auto ibo = ctx.newStaticBuffer(boo::BufferUse::Index, indexData.get(), 4, indexCount);
+    vertOffset = 0;
+    indexOffset = 0;
+    for (size_t i : members) {
+      const HMDLMeta& meta = m_staged[i]->meta;
+      ret[i] = std::make_unique<HMDLData>(meta, vbo, ibo, vertOffset, indexOffset);
+      vertOffset += meta.vertCount;
+      indexOffset += meta.indexCount;
+    }
+  }
+
+  m_staged.clear();
+  return ret;
+}
+
+/* Pages are faulted in this many bytes at a time so cancellation stays responsive */
+constexpr size_t StreamChunkSize = 256 * 1024;
+constexpr size_t StreamPageSize = 4096;
+
+HMDLStream::HMDLStream(SystemStringView path, size_t metaOffset, size_t vboOffset, size_t iboOffset) {
+  if (!m_file.open(SystemString(path).c_str())) {
+    HMDL_Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to map '{}'")), path);
+    m_state = State::Failed;
+    return;
+  }
+  m_thread = std::thread([this, metaOffset, vboOffset, iboOffset]() { _stage(metaOffset, vboOffset, iboOffset); });
+}
+
+HMDLStream::~HMDLStream() {
+  m_cancel = true;
+  if (m_thread.joinable())
+    m_thread.join();
+}
+
+void HMDLStream::_stage(size_t metaOffset, size_t vboOffset, size_t iboOffset) {
+  const uint8_t* data = m_file.data();
+  const size_t size = m_file.size();
+  const auto fail = [this](const char* reason) {
+    HMDL_Log.report(logvisor::Error, FMT_STRING("unable to stream HMDL: {}"), reason);
+    m_state.store(State::Failed, std::memory_order_release);
+  };
+
+  if (metaOffset > size || size - metaOffset < HECL_HMDL_META_SZ)
+    return fail("truncated meta");
+  HMDLMeta meta;
+  {
+    athena::io::MemoryReader r(data + metaOffset, HECL_HMDL_META_SZ);
+    meta.read(r);
+  }
+  if (meta.magic != 'TACO')
+    return fail("invalid magic");
+  if (meta.indexSize != 2 && meta.indexSize != 4)
+    return fail("invalid index size");
+  const size_t vboSz = size_t(meta.vertStride) * meta.vertCount;
+  const size_t iboSz = size_t(meta.indexSize) * meta.indexCount;
+  if (vboOffset > size || size - vboOffset < vboSz || iboOffset > size || size - iboOffset < iboSz)
+    return fail("truncated buffers");
+
+  /* Touch each page so the later upload reads from memory rather than disk */
+  volatile uint8_t sink = 0;
+  for (const auto& [offset, len] : {std::make_pair(vboOffset, vboSz), std::make_pair(iboOffset, iboSz)}) {
+    for (size_t chunk = 0; chunk < len; chunk += StreamChunkSize) {
+      if (m_cancel.load(std::memory_order_relaxed))
+        return;
+      const size_t chunkEnd = std::min(chunk + StreamChunkSize, len);
+      for (size_t i = chunk; i < chunkEnd; i += StreamPageSize)
+        sink = sink + data[offset + i];
+    }
+  }
+
+  m_staging = std::make_unique<HMDLStaging>(data + metaOffset, data + vboOffset, data + iboOffset);
+  m_state.store(State::Staged, std::memory_order_release);
+}
+
+bool HMDLStream::upload(boo::IGraphicsDataFactory::Context& ctx) {
+  switch (state()) {
+  case State::Ready:
+    return true;
+  case State::Staged:
+    break;
+  default:
+    return false;
   }
 
-  m_vtxFmt = boo::VertexFormatInfo(elemCount, m_vtxFmtData.get());
+  m_thread.join();
+  m_data = std::make_unique<HMDLData>(ctx, *m_staging);
+  m_staging.reset();
+  m_file.close();
+  m_state.store(State::Ready, std::memory_order_release);
+  return true;
 }
 
 } // namespace hecl::Runtime
@@ -0,0 +1,61 @@
+#include "hecl/StatCache.hpp"
+
+#include <mutex>
+
+#include "hecl/hecl.hpp"
+
+namespace hecl {
+
+bool StatCache::_excluded(SystemStringView path) const {
+  if (m_excludedPrefix.empty() || path.compare(0, m_excludedPrefix.size(), m_excludedPrefix))
+    return false;
+  return path.size() == m_excludedPrefix.size() || path[m_excludedPrefix.size()] == _SYS_STR('/');
+}
+
+void StatCache::setEnabled(bool enabled) {
+  std::unique_lock lk{m_mutex};
+  m_entries.clear();
+  m_enabled = enabled;
+}
+
+int StatCache::stat(SystemStringView path, Sstat* statOut) {
+  if (!m_enabled || _excluded(path))
+    return hecl::Stat(path.data(), statOut);
+
+  {
+    std::shared_lock lk{m_mutex};
+    auto search = m_entries.find(path);
+    if (search != m_entries.end()) {
+      *statOut = search->second.m_stat;
+      return search->second.m_result;
+    }
+  }
+
+  Entry entry{};
+  entry.m_result = hecl::Stat(path.data(), &entry.m_stat);
+  *statOut = entry.m_stat;
+  std::unique_lock lk{m_mutex};
+  m_entries.insert_or_assign(SystemString(path), entry);
+  return entry.m_result;
+}
+
+void StatCache::insert(SystemStringView path, const Sstat& st) {
+  if (!m_enabled || _excluded(path))
+    return;
+  std::unique_lock lk{m_mutex};
+  m_entries.insert_or_assign(SystemString(path), Entry{0, st});
+}
+
+void StatCache::invalidate(SystemStringView path) {
+  std::unique_lock lk{m_mutex};
+  auto search = m_entries.find(path);
+  if (search != m_entries.end())
+    m_entries.erase(search);
+}
+
+void StatCache::clear() {
+  std::unique_lock lk{m_mutex};
+  m_entries.clear();
+}
+
+} // namespace hecl
@@ -0,0 +1,456 @@
+#include "hecl/TextureService.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "hecl/ClientProcess.hpp"
+#include "hecl/Database.hpp"
+#include "hecl/MappedFile.hpp"
+#include "hecl/Trace.hpp"
+
+#include <logvisor/logvisor.hpp>
+#include <png.h>
+
+namespace hecl {
+
+static logvisor::Module Log("hecl::TextureService");
+
+constexpr uint32_t TextureCacheMagic = 'HTXC';
+/* Bump whenever filtering or encoding output changes */
+constexpr uint32_t TextureCacheVersion = 1;
+
+/* Texels handed to a worker at once when splitting tile rows */
+constexpr size_t TexelsPerRange = 64 * 1024;
+
+namespace {
+struct CacheHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t format;
+  uint32_t width;
+  uint32_t height;
+  uint32_t mipCount;
+};
+
+struct CacheKey {
+  uint64_t contentHash;
+  uint32_t format;
+  uint32_t maxMips;
+  uint32_t version;
+  uint32_t pad = 0;
+};
+
+using BlockTexels = uint8_t[16][4];
+
+/* Copy the 4x4 block at (bx, by), repeating edge texels past the image bounds */
+void FetchBlock(const TextureService::Image& img, uint32_t bx, uint32_t by, BlockTexels& out) {
+  for (uint32_t y = 0; y < 4; ++y) {
+    const uint32_t sy = std::min(by + y, img.height - 1);
+    for (uint32_t x = 0; x < 4; ++x) {
+      const uint32_t sx = std::min(bx + x, img.width - 1);
+      std::memcpy(out[y * 4 + x], &img.rgba[(size_t(sy) * img.width + sx) * 4], 4);
+    }
+  }
+}
+
+uint16_t To565(const float c[3]) {
+  const auto quant = [](float v, int bits) {
+    const int max = (1 << bits) - 1;
+    return std::clamp(int(v * max / 255.f + 0.5f), 0, max);
+  };
+  return uint16_t(quant(c[0], 5) << 11 | quant(c[1], 6) << 5 | quant(c[2], 5));
+}
+
+void From565(uint16_t c, int out[3]) {
+  const int r = c >> 11 & 0x1f;
+  const int g = c >> 5 & 0x3f;
+  const int b = c & 0x1f;
+  out[0] = r << 3 | r >> 2;
+  out[1] = g << 2 | g >> 4;
+  out[2] = b << 3 | b >> 2;
+}
+
+struct DXT1Block {
+  uint16_t color0;
+  uint16_t color1;
+  /* Two bits per texel, texel 0 lowest */
+  uint32_t indices;
+};
+
+/* Endpoints from the extremes along the principal axis of the opaque texels */
+DXT1Block CompressBlock(const BlockTexels& texels) {
+  float mean[3] = {};
+  int opaqueCount = 0;
+  bool hasTransparent = false;
+  for (const auto& t : texels) {
+    if (t[3] < 128) {
+      hasTransparent = true;
+      continue;
+    }
+    for (int c = 0; c < 3; ++c)
+      mean[c] += t[c];
+    ++opaqueCount;
+  }
+  if (!opaqueCount)
+    return {0, 0, 0xffffffff};
+  for (float& m : mean)
+    m /= float(opaqueCount);
+
+  float cov[6] = {};
+  for (const auto& t : texels) {
+    if (t[3] < 128)
+      continue;
+    const float d[3] = {t[0] - mean[0], t[1] - mean[1], t[2] - mean[2]};
+    cov[0] += d[0] * d[0];
+    cov[1] += d[0] * d[1];
+    cov[2] += d[0] * d[2];
+    cov[3] += d[1] * d[1];
+    cov[4] += d[1] * d[2];
+    cov[5] += d[2] * d[2];
+  }
+  float axis[3] = {1.f, 1.f, 1.f};
+  for (int i = 0; i < 4; ++i) {
+    const float next[3] = {cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+                           cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+                           cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2]};
+    const float len = std::max({std::abs(next[0]), std::abs(next[1]), std::abs(next[2])});
+    if (len <= 0.f)
+      break;
+    for (int c = 0; c < 3; ++c)
+      axis[c] = next[c] / len;
+  }
+
+  float minProj = FLT_MAX;
+  float maxProj = -FLT_MAX;
+  float minColor[3] = {};
+  float maxColor[3] = {};
+  for (const auto& t : texels) {
+    if (t[3] < 128)
+      continue;
+    const float proj = t[0] * axis[0] + t[1] * axis[1] + t[2] * axis[2];
+    if (proj < minProj) {
+      minProj = proj;
+      std::copy(t, t + 3, minColor);
+    }
+    if (proj > maxProj) {
+      maxProj = proj;
+      std::copy(t, t + 3, maxColor);
+    }
+  }
+
+  DXT1Block ret{To565(maxColor), To565(minColor), 0};
+  /* color0 > color1 selects four colors; punch-through alpha needs the three color mode */
+  if ((ret.color0 < ret.color1) != hasTransparent && ret.color0 != ret.color1)
+    std::swap(ret.color0, ret.color1);
+  const bool fourColor = ret.color0 > ret.color1;
+
+  int palette[4][3];
+  From565(ret.color0, palette[0]);
+  From565(ret.color1, palette[1]);
+  for (int c = 0; c < 3; ++c) {
+    if (fourColor) {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    } else {
+      palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+      palette[3][c] = 0;
+    }
+  }
+  const int colorCount = fourColor ? 4 : 3;
+
+  for (int i = 0; i < 16; ++i) {
+    const auto& t = texels[i];
+    uint32_t best = 3;
+    if (t[3] >= 128) {
+      int bestDist = INT_MAX;
+      for (int p = 0; p < colorCount; ++p) {
+        const int d[3] = {t[0] - palette[p][0], t[1] - palette[p][1], t[2] - palette[p][2]};
+        const int dist = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+        if (dist < bestDist) {
+          bestDist = dist;
+          best = uint32_t(p);
+        }
+      }
+    }
+    ret.indices |= best << (i * 2);
+  }
+  return ret;
+}
+
+void WriteDXT1(const DXT1Block& block, uint8_t* out) {
+  out[0] = uint8_t(block.color0);
+  out[1] = uint8_t(block.color0 >> 8);
+  out[2] = uint8_t(block.color1);
+  out[3] = uint8_t(block.color1 >> 8);
+  for (int i = 0; i < 4; ++i)
+    out[4 + i] = uint8_t(block.indices >> (i * 8));
+}
+
+/* GX stores endpoints big-endian with the first texel of each row in the high bits */
+void WriteCMPRBlock(const DXT1Block& block, uint8_t* out) {
+  out[0] = uint8_t(block.color0 >> 8);
+  out[1] = uint8_t(block.color0);
+  out[2] = uint8_t(block.color1 >> 8);
+  out[3] = uint8_t(block.color1);
+  for (int y = 0; y < 4; ++y) {
+    uint8_t row = 0;
+    for (int x = 0; x < 4; ++x)
+      row |= uint8_t(((block.indices >> ((y * 4 + x) * 2)) & 3) << (6 - x * 2));
+    out[4 + y] = row;
+  }
+}
+
+/* Height in texels of one row of tiles, the unit of work handed out by Encode */
+uint32_t TileRowHeight(TextureService::Format fmt) {
+  switch (fmt) {
+  case TextureService::Format::RGBA8:
+    return 1;
+  case TextureService::Format::RGBA8GX:
+  case TextureService::Format::DXT1:
+    return 4;
+  case TextureService::Format::CMPR:
+    return 8;
+  }
+  return 1;
+}
+
+void EncodeRow(const TextureService::Image& img, TextureService::Format fmt, uint32_t row, uint8_t* out) {
+  switch (fmt) {
+  case TextureService::Format::RGBA8:
+    std::memcpy(out, &img.rgba[size_t(row) * img.width * 4], size_t(img.width) * 4);
+    break;
+  case TextureService::Format::RGBA8GX: {
+    BlockTexels texels;
+    for (uint32_t bx = 0; bx < img.width; bx += 4, out += 64) {
+      FetchBlock(img, bx, row * 4, texels);
+      for (int i = 0; i < 16; ++i) {
+        out[i * 2] = texels[i][3];
+        out[i * 2 + 1] = texels[i][0];
+        out[32 + i * 2] = texels[i][1];
+        out[32 + i * 2 + 1] = texels[i][2];
+      }
+    }
+    break;
+  }
+  case TextureService::Format::DXT1: {
+    BlockTexels texels;
+    for (uint32_t bx = 0; bx < img.width; bx += 4, out += 8) {
+      FetchBlock(img, bx, row * 4, texels);
+      WriteDXT1(CompressBlock(texels), out);
+    }
+    break;
+  }
+  case TextureService::Format::CMPR: {
+    BlockTexels texels;
+    for (uint32_t tx = 0; tx < img.width; tx += 8) {
+      for (uint32_t sub = 0; sub < 4; ++sub, out += 8) {
+        FetchBlock(img, tx + (sub & 1) * 4, row * 8 + (sub >> 1) * 4, texels);
+        WriteCMPRBlock(CompressBlock(texels), out);
+      }
+    }
+    break;
+  }
+  }
+}
+
+/* Fills mipOffsets from the dimensions and returns the total size */
+size_t LayoutMips(TextureService::Texture& tex) {
+  tex.mipOffsets.clear();
+  size_t offset = 0;
+  uint32_t width = tex.width;
+  uint32_t height = tex.height;
+  for (uint32_t i = 0; i < tex.mipCount; ++i) {
+    tex.mipOffsets.push_back(offset);
+    offset += TextureService::EncodedSize(tex.format, width, height);
+    width = std::max(width / 2, 1u);
+    height = std::max(height / 2, 1u);
+  }
+  return offset;
+}
+} // anonymous namespace
+
+bool TextureService::DecodePNG(const uint8_t* data, size_t len, Image& out) {
+  png_image image = {};
+  image.version = PNG_IMAGE_VERSION;
+  if (!png_image_begin_read_from_memory(&image, data, len)) {
+    Log.report(logvisor::Error, FMT_STRING("unable to read PNG header: {}"), image.message);
+    return false;
+  }
+  image.format = PNG_FORMAT_RGBA;
+  out.width = image.width;
+  out.height = image.height;
+  out.rgba.resize(PNG_IMAGE_SIZE(image));
+  if (!png_image_finish_read(&image, nullptr, out.rgba.data(), 0, nullptr)) {
+    Log.report(logvisor::Error, FMT_STRING("unable to decode PNG: {}"), image.message);
+    png_image_free(&image);
+    return false;
+  }
+  return out.width && out.height;
+}
+
+TextureService::Image TextureService::Downsample(const Image& src) {
+  Image ret;
+  ret.width = std::max(src.width / 2, 1u);
+  ret.height = std::max(src.height / 2, 1u);
+  ret.rgba.resize(size_t(ret.width) * ret.height * 4);
+  const size_t srcStride = size_t(src.width) * 4;
+  for (uint32_t y = 0; y < ret.height; ++y) {
+    const uint8_t* row0 = &src.rgba[std::min(y * 2, src.height - 1) * srcStride];
+    const uint8_t* row1 = &src.rgba[std::min(y * 2 + 1, src.height - 1) * srcStride];
+    uint8_t* dst = &ret.rgba[size_t(y) * ret.width * 4];
+    if (src.width == ret.width * 2) {
+      /* Branch-free for the common even width so it vectorizes */
+      for (size_t i = 0; i < size_t(ret.width) * 4; ++i) {
+        const size_t s = (i & ~size_t(3)) * 2 + (i & 3);
+        dst[i] = uint8_t((row0[s] + row0[s + 4] + row1[s] + row1[s + 4] + 2) >> 2);
+      }
+      continue;
+    }
+    for (uint32_t x = 0; x < ret.width; ++x) {
+      const size_t s0 = size_t(std::min(x * 2, src.width - 1)) * 4;
+      const size_t s1 = size_t(std::min(x * 2 + 1, src.width - 1)) * 4;
+      for (int c = 0; c < 4; ++c)
+        dst[x * 4 + c] = uint8_t((row0[s0 + c] + row0[s1 + c] + row1[s0 + c] + row1[s1 + c] + 2) >> 2);
+    }
+  }
+  return ret;
+}
+
+size_t TextureService::EncodedSize(Format fmt, uint32_t width, uint32_t height) {
+  switch (fmt) {
+  case Format::RGBA8:
+    return size_t(width) * height * 4;
+  case Format::RGBA8GX:
+    return size_t((width + 3) / 4) * ((height + 3) / 4) * 64;
+  case Format::DXT1:
+    return size_t((width + 3) / 4) * ((height + 3) / 4) * 8;
+  case Format::CMPR:
+    return size_t((width + 7) / 8) * ((height + 7) / 8) * 32;
+  }
+  return 0;
+}
+
+void TextureService::Encode(const Image& img, Format fmt, uint8_t* out) {
+  const uint32_t rowHeight = TileRowHeight(fmt);
+  const uint32_t rowCount = (img.height + rowHeight - 1) / rowHeight;
+  const size_t rowBytes = EncodedSize(fmt, img.width, rowHeight);
+  const size_t grain = std::max(TexelsPerRange / (size_t(img.width) * rowHeight), size_t(1));
+  ClientProcess::DistributeWork(rowCount, grain, [&](size_t begin, size_t end) {
+    for (size_t row = begin; row < end; ++row)
+      EncodeRow(img, fmt, uint32_t(row), out + row * rowBytes);
+  });
+}
+
+TextureService::TextureService(const Database::Project& project) : m_project(project) {}
+
+SystemString TextureService::_cacheEntryPath(uint64_t key) {
+  std::unique_lock lk{m_mutex};
+  if (m_cachePath.empty()) {
+    m_cachePath = SystemString(m_project.getProjectRootPath().getAbsolutePath()) + _SYS_STR("/.hecl/texcache");
+    hecl::MakeDir(m_cachePath.c_str());
+  }
+  return m_cachePath + fmt::format(FMT_STRING(_SYS_STR("/{:016X}")), key);
+}
+
+bool TextureService::_load(const SystemString& entryPath, Texture& out) {
+  MappedFile file;
+  if (!file.open(entryPath.c_str()) || file.size() < sizeof(CacheHeader))
+    return false;
+  CacheHeader header;
+  std::memcpy(&header, file.data(), sizeof(header));
+  if (header.magic != TextureCacheMagic || header.version != TextureCacheVersion ||
+      header.format > uint32_t(Format::CMPR))
+    return false;
+  out.format = Format(header.format);
+  out.width = header.width;
+  out.height = header.height;
+  out.mipCount = header.mipCount;
+  const size_t size = LayoutMips(out);
+  if (file.size() != sizeof(header) + size) {
+    Log.report(logvisor::Warning, FMT_STRING(_SYS_STR("ignoring malformed texture cache entry '{}'")), entryPath);
+    return false;
+  }
+  out.data.assign(file.data() + sizeof(header), file.data() + file.size());
+  return true;
+}
+
+void TextureService::_store(const SystemString& entryPath, const Texture& tex) {
+  const SystemString partPath = entryPath + _SYS_STR(".part");
+  auto fp = hecl::FopenUnique(partPath.c_str(), _SYS_STR("wb"));
+  if (!fp) {
+    Log.report(logvisor::Warning, FMT_STRING(_SYS_STR("unable to write texture cache entry '{}'")), partPath);
+    return;
+  }
+  const CacheHeader header{TextureCacheMagic, TextureCacheVersion, uint32_t(tex.format),
+                           tex.width,         tex.height,          tex.mipCount};
+  std::fwrite(&header, 1, sizeof(header), fp.get());
+  std::fwrite(tex.data.data(), 1, tex.data.size(), fp.get());
+  if (std::fclose(fp.release()) || hecl::Rename(partPath.c_str(), entryPath.c_str())) {
+    Log.report(logvisor::Warning, FMT_STRING(_SYS_STR("unable to write texture cache entry '{}'")), entryPath);
+    hecl::Unlink(partPath.c_str());
+  }
+}
+
+bool TextureService::convert(const ProjectPath& pngPath, Format fmt, uint32_t maxMips, Texture& out) {
+  HECL_TRACE_SCOPE("convertTexture", pngPath.getRelativePathUTF8());
+  MappedFile png;
+  if (!png.open(SystemString(pngPath.getAbsolutePath()).c_str())) {
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to open {}")), pngPath.getAbsolutePath());
+    return false;
+  }
+
+  const CacheKey keyData{XXH64(png.data(), png.size(), 0), uint32_t(fmt), maxMips, TextureCacheVersion};
+  const uint64_t key = XXH64(&keyData, sizeof(keyData), 0);
+
+  /* Identical textures requested concurrently convert once; the rest restore the result */
+  {
+    std::unique_lock lk{m_mutex};
+    m_convertCv.wait(lk, [&]() { return !m_converting.count(key); });
+    m_converting.insert(key);
+  }
+  const auto release = [&]() {
+    {
+      std::unique_lock lk{m_mutex};
+      m_converting.erase(key);
+    }
+    m_convertCv.notify_all();
+  };
+
+  const SystemString entryPath = _cacheEntryPath(key);
+  if (_load(entryPath, out)) {
+    release();
+    return true;
+  }
+
+  Image level;
+  if (!DecodePNG(png.data(), png.size(), level)) {
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to decode {}")), pngPath.getAbsolutePath());
+    release();
+    return false;
+  }
+
+  out.format = fmt;
+  out.width = level.width;
+  out.height = level.height;
+  out.mipCount = 1;
+  for (uint32_t w = level.width, h = level.height; (w > 1 || h > 1) && (!maxMips || out.mipCount < maxMips);
+       w = std::max(w / 2, 1u), h = std::max(h / 2, 1u))
+    ++out.mipCount;
+  out.data.resize(LayoutMips(out));
+
+  for (uint32_t i = 0; i < out.mipCount; ++i) {
+    if (i)
+      level = Downsample(level);
+    Encode(level, fmt, out.data.data() + out.mipOffsets[i]);
+  }
+
+  _store(entryPath, out);
+  release();
+  return true;
+}
+
+} // namespace hecl
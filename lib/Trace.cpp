@@ -0,0 +1,165 @@
+#include "hecl/Trace.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "hecl/hecl.hpp"
+
+#include <logvisor/logvisor.hpp>
+
+namespace hecl::trace {
+
+static logvisor::Module Log("hecl::Trace");
+
+std::atomic_bool Active = false;
+
+namespace {
+struct Event {
+  const char* m_name;
+  uint64_t m_begin;
+  uint64_t m_end;
+  std::string m_detail;
+};
+
+/* Appended to by its own thread only; the mutex is contended solely by Stop() */
+struct ThreadBuffer {
+  std::mutex m_mutex;
+  uint32_t m_tid;
+  std::string m_name;
+  std::vector<Event> m_events;
+};
+
+struct Registry {
+  std::mutex m_mutex;
+  std::vector<std::shared_ptr<ThreadBuffer>> m_buffers;
+  UniqueFilePtr m_file;
+  SystemString m_path;
+  uint64_t m_start = 0;
+};
+
+Registry& GetRegistry() {
+  static Registry registry;
+  return registry;
+}
+
+/* Buffers outlive their threads so workers joined before Stop() keep their events */
+ThreadBuffer& GetThreadBuffer() {
+  thread_local std::shared_ptr<ThreadBuffer> buffer = []() {
+    auto ret = std::make_shared<ThreadBuffer>();
+    Registry& reg = GetRegistry();
+    std::unique_lock lk{reg.m_mutex};
+    ret->m_tid = uint32_t(reg.m_buffers.size() + 1);
+    reg.m_buffers.push_back(ret);
+    return ret;
+  }();
+  return *buffer;
+}
+
+void WriteEscaped(FILE* fp, std::string_view str) {
+  for (char ch : str) {
+    switch (ch) {
+    case '"':
+      std::fputs("\\\"", fp);
+      break;
+    case '\\':
+      std::fputs("\\\\", fp);
+      break;
+    default:
+      if (uint8_t(ch) < 0x20)
+        std::fprintf(fp, "\\u%04x", unsigned(ch));
+      else
+        std::fputc(ch, fp);
+      break;
+    }
+  }
+}
+} // anonymous namespace
+
+uint64_t Now() {
+  return uint64_t(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+bool Start(SystemStringView path) {
+  Registry& reg = GetRegistry();
+  std::unique_lock lk{reg.m_mutex};
+  if (Active)
+    return false;
+  reg.m_path = path;
+  reg.m_file = hecl::FopenUnique(reg.m_path.c_str(), _SYS_STR("wb"));
+  if (!reg.m_file) {
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to open trace file '{}'")), reg.m_path);
+    return false;
+  }
+  reg.m_start = Now();
+  Active = true;
+  return true;
+}
+
+void Stop() {
+  Registry& reg = GetRegistry();
+  std::unique_lock lk{reg.m_mutex};
+  if (!Active)
+    return;
+  Active = false;
+
+  /* Timestamps are microseconds from Start(), as in the Chrome trace event format */
+  FILE* fp = reg.m_file.get();
+  std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", fp);
+  bool first = true;
+  const auto startEvent = [&]() {
+    if (!first)
+      std::fputs(",\n", fp);
+    first = false;
+  };
+  for (const std::shared_ptr<ThreadBuffer>& buffer : reg.m_buffers) {
+    std::unique_lock blk{buffer->m_mutex};
+    if (!buffer->m_name.empty()) {
+      startEvent();
+      std::fprintf(fp, "{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":\"",
+                   buffer->m_tid);
+      WriteEscaped(fp, buffer->m_name);
+      std::fputs("\"}}", fp);
+    }
+    for (const Event& ev : buffer->m_events) {
+      if (ev.m_begin < reg.m_start)
+        continue;
+      startEvent();
+      std::fprintf(fp, "{\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"name\":\"%s\",\"ts\":%.3f,\"dur\":%.3f", buffer->m_tid,
+                   ev.m_name, double(ev.m_begin - reg.m_start) / 1000.0, double(ev.m_end - ev.m_begin) / 1000.0);
+      if (!ev.m_detail.empty()) {
+        std::fputs(",\"args\":{\"detail\":\"", fp);
+        WriteEscaped(fp, ev.m_detail);
+        std::fputs("\"}", fp);
+      }
+      std::fputc('}', fp);
+    }
+    buffer->m_events.clear();
+  }
+  std::fputs("\n]}\n", fp);
+  if (std::fclose(reg.m_file.release()))
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to write trace file '{}'")), reg.m_path);
+  else
+    Log.report(logvisor::Info, FMT_STRING(_SYS_STR("wrote trace to '{}'")), reg.m_path);
+}
+
+void SetThreadName(std::string_view name) {
+  ThreadBuffer& buffer = GetThreadBuffer();
+  std::unique_lock lk{buffer.m_mutex};
+  buffer.m_name = name;
+}
+
+void Record(const char* name, uint64_t begin, std::string_view detail) {
+  if (!Active.load(std::memory_order_relaxed))
+    return;
+  const uint64_t end = Now();
+  ThreadBuffer& buffer = GetThreadBuffer();
+  std::unique_lock lk{buffer.m_mutex};
+  buffer.m_events.push_back(Event{name, begin, end, std::string(detail)});
+}
+
+} // namespace hecl::trace
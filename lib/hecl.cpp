@@ -1,15 +1,21 @@
 #include "hecl/hecl.hpp"
 
 #include <algorithm>
+#include <array>
+#include <condition_variable>
 #include <cstdio>
 #include <cstdlib>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <thread>
 #include <unordered_map>
+#include <unordered_set>
+
+#include "hecl/StatCache.hpp"
 
 #ifdef WIN32
 #include <windows.h>
@@ -129,34 +135,64 @@ SystemString GetcwdStr() {
   return SystemString();
 }
 
-static std::mutex PathsMutex;
-static std::unordered_map<std::thread::id, ProjectPath> PathsInProgress;
+/* Paths in progress are sharded on their hash so unrelated locks never contend */
+struct alignas(64) ResourceLockShard {
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::unordered_set<uint64_t> m_inProgress;
+};
+static constexpr size_t ResourceLockShardCount = 64;
+static std::array<ResourceLockShard, ResourceLockShardCount> ResourceLockShards;
+static thread_local std::optional<uint64_t> ThreadRes;
+
+static ResourceLockShard& GetResourceLockShard(uint64_t hash) {
+  return ResourceLockShards[hash % ResourceLockShardCount];
+}
 
 bool ResourceLock::InProgress(const ProjectPath& path) {
-  std::unique_lock lk{PathsMutex};
-  return std::any_of(PathsInProgress.cbegin(), PathsInProgress.cend(),
-                     [&path](const auto& entry) { return entry.second == path; });
+  const uint64_t hash = path.hash().val64();
+  ResourceLockShard& shard = GetResourceLockShard(hash);
+  std::unique_lock lk{shard.m_mutex};
+  return shard.m_inProgress.count(hash) != 0;
 }
 
-bool ResourceLock::SetThreadRes(const ProjectPath& path) {
-  std::unique_lock lk{PathsMutex};
-  if (PathsInProgress.find(std::this_thread::get_id()) != PathsInProgress.cend()) {
+void ResourceLock::WaitUntilReleased(const ProjectPath& path) {
+  const uint64_t hash = path.hash().val64();
+  if (ThreadRes == hash)
+    return;
+  ResourceLockShard& shard = GetResourceLockShard(hash);
+  std::unique_lock lk{shard.m_mutex};
+  shard.m_cv.wait(lk, [&]() { return shard.m_inProgress.count(hash) == 0; });
+}
+
+bool ResourceLock::SetThreadRes(const ProjectPath& path, bool wait) {
+  if (ThreadRes) {
     LogModule.report(logvisor::Fatal, FMT_STRING("multiple resource locks on thread"));
   }
 
-  const bool isInProgress = std::any_of(PathsInProgress.cbegin(), PathsInProgress.cend(),
-                                        [&path](const auto& entry) { return entry.second == path; });
-  if (isInProgress) {
+  /* Holders never wait on a second lock, so waiting cannot deadlock */
+  const uint64_t hash = path.hash().val64();
+  ResourceLockShard& shard = GetResourceLockShard(hash);
+  std::unique_lock lk{shard.m_mutex};
+  if (wait) {
+    shard.m_cv.wait(lk, [&]() { return shard.m_inProgress.count(hash) == 0; });
+  } else if (shard.m_inProgress.count(hash) != 0) {
     return false;
   }
 
-  PathsInProgress.insert_or_assign(std::this_thread::get_id(), path);
+  shard.m_inProgress.insert(hash);
+  ThreadRes = hash;
   return true;
 }
 
 void ResourceLock::ClearThreadRes() {
-  std::unique_lock lk{PathsMutex};
-  PathsInProgress.erase(std::this_thread::get_id());
+  ResourceLockShard& shard = GetResourceLockShard(*ThreadRes);
+  {
+    std::unique_lock lk{shard.m_mutex};
+    shard.m_inProgress.erase(*ThreadRes);
+  }
+  shard.m_cv.notify_all();
+  ThreadRes.reset();
 }
 
 bool IsPathPNG(const hecl::ProjectPath& path) {
@@ -205,10 +241,32 @@ bool IsPathYAML(const hecl::ProjectPath& path) {
   return lastCompExt == _SYS_STR("yaml") || lastCompExt == _SYS_STR("yml");
 }
 
+#if _WIN32
+/* Find data carries everything a stat would; only reparse points need resolving */
+static int StatEntry(const SystemString& fp, const WIN32_FIND_DATAW& d, Sstat& st, StatCache* statCache) {
+  if (!statCache)
+    return hecl::Stat(fp.c_str(), &st);
+  if (d.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+    return statCache->stat(fp, &st);
+  st = {};
+  st.st_mode = (d.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) ? _S_IFDIR : _S_IFREG;
+  st.st_size = decltype(st.st_size)((uint64_t(d.nFileSizeHigh) << 32) | d.nFileSizeLow);
+  /* FILETIME counts 100ns intervals since 1601 */
+  const uint64_t ft = (uint64_t(d.ftLastWriteTime.dwHighDateTime) << 32) | d.ftLastWriteTime.dwLowDateTime;
+  st.st_mtime = decltype(st.st_mtime)((ft - 116444736000000000ull) / 10000000ull);
+  statCache->insert(fp, st);
+  return 0;
+}
+#else
+static int StatEntry(const SystemString& fp, Sstat& st, StatCache* statCache) {
+  return statCache ? statCache->stat(fp, &st) : hecl::Stat(fp.c_str(), &st);
+}
+#endif
+
 hecl::DirectoryEnumerator::DirectoryEnumerator(SystemStringView path, Mode mode, bool sizeSort, bool reverse,
-                                               bool noHidden) {
+                                               bool noHidden, StatCache* statCache) {
   hecl::Sstat theStat;
-  if (hecl::Stat(path.data(), &theStat) || !S_ISDIR(theStat.st_mode))
+  if ((statCache ? statCache->stat(path, &theStat) : hecl::Stat(path.data(), &theStat)) || !S_ISDIR(theStat.st_mode))
     return;
 
 #if _WIN32
@@ -229,7 +287,7 @@ hecl::DirectoryEnumerator::DirectoryEnumerator(SystemStringView path, Mode mode,
       fp += _SYS_STR('/');
       fp += d.cFileName;
       hecl::Sstat st;
-      if (hecl::Stat(fp.c_str(), &st))
+      if (StatEntry(fp, d, st, statCache))
         continue;
 
       size_t sz = 0;
@@ -256,7 +314,7 @@ hecl::DirectoryEnumerator::DirectoryEnumerator(SystemStringView path, Mode mode,
       fp += _SYS_STR('/');
       fp += d.cFileName;
       hecl::Sstat st;
-      if (hecl::Stat(fp.c_str(), &st) || !S_ISDIR(st.st_mode))
+      if (StatEntry(fp, d, st, statCache) || !S_ISDIR(st.st_mode))
         continue;
       sort.emplace(std::make_pair(d.cFileName, Entry(std::move(fp), d.cFileName, 0, true)));
     } while (FindNextFileW(dir, &d));
@@ -288,7 +346,7 @@ hecl::DirectoryEnumerator::DirectoryEnumerator(SystemStringView path, Mode mode,
         fp += _SYS_STR('/');
         fp += d.cFileName;
         hecl::Sstat st;
-        if (hecl::Stat(fp.c_str(), &st) || !S_ISREG(st.st_mode))
+        if (StatEntry(fp, d, st, statCache) || !S_ISREG(st.st_mode))
           continue;
         sort.emplace(std::make_pair(st.st_size, Entry(std::move(fp), d.cFileName, st.st_size, false)));
       } while (FindNextFileW(dir, &d));
@@ -310,7 +368,7 @@ hecl::DirectoryEnumerator::DirectoryEnumerator(SystemStringView path, Mode mode,
         fp += _SYS_STR('/');
         fp += d.cFileName;
         hecl::Sstat st;
-        if (hecl::Stat(fp.c_str(), &st) || !S_ISREG(st.st_mode))
+        if (StatEntry(fp, d, st, statCache) || !S_ISREG(st.st_mode))
           continue;
         sort.emplace(std::make_pair(d.cFileName, Entry(std::move(fp), d.cFileName, st.st_size, false)));
       } while (FindNextFileW(dir, &d));
@@ -345,7 +403,7 @@ hecl::DirectoryEnumerator::DirectoryEnumerator(SystemStringView path, Mode mode,
       fp += '/';
       fp += d->d_name;
       hecl::Sstat st;
-      if (hecl::Stat(fp.c_str(), &st))
+      if (StatEntry(fp, st, statCache))
         continue;
 
       size_t sz = 0;
@@ -372,7 +430,7 @@ hecl::DirectoryEnumerator::DirectoryEnumerator(SystemStringView path, Mode mode,
       fp += '/';
       fp += d->d_name;
       hecl::Sstat st;
-      if (hecl::Stat(fp.c_str(), &st) || !S_ISDIR(st.st_mode))
+      if (StatEntry(fp, st, statCache) || !S_ISDIR(st.st_mode))
         continue;
       sort.emplace(std::make_pair(d->d_name, Entry(std::move(fp), d->d_name, 0, true)));
     }
@@ -404,7 +462,7 @@ hecl::DirectoryEnumerator::DirectoryEnumerator(SystemStringView path, Mode mode,
         fp += '/';
         fp += d->d_name;
         hecl::Sstat st;
-        if (hecl::Stat(fp.c_str(), &st) || !S_ISREG(st.st_mode))
+        if (StatEntry(fp, st, statCache) || !S_ISREG(st.st_mode))
           continue;
         sort.emplace(std::make_pair(st.st_size, Entry(std::move(fp), d->d_name, st.st_size, false)));
       }
@@ -426,7 +484,7 @@ hecl::DirectoryEnumerator::DirectoryEnumerator(SystemStringView path, Mode mode,
         fp += '/';
         fp += d->d_name;
         hecl::Sstat st;
-        if (hecl::Stat(fp.c_str(), &st) || !S_ISREG(st.st_mode))
+        if (StatEntry(fp, st, statCache) || !S_ISREG(st.st_mode))
           continue;
         sort.emplace(std::make_pair(d->d_name, Entry(std::move(fp), d->d_name, st.st_size, false)));
       }
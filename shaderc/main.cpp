@@ -1,12 +1,119 @@
 #include "shaderc.hpp"
 #include "logvisor/logvisor.hpp"
+#include "athena/FileReader.hpp"
 #include "athena/FileWriter.hpp"
 #include "glslang/Public/ShaderLang.h"
 #include "hecl/hecl.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
 #include <sstream>
+#include <thread>
 
 static logvisor::Module Log("shaderc");
 
+/* Leave unchanged outputs untouched so their timestamps don't trigger rebuilds of includers */
+static bool WriteIfChanged(const hecl::SystemString& path, const std::string& data) {
+  {
+    athena::io::FileReader r(path, 32 * 1024, false);
+    if (!r.hasError() && r.length() == data.size()) {
+      std::unique_ptr<atUint8[]> existing = r.readUBytes(data.size());
+      if (!std::memcmp(existing.get(), data.data(), data.size()))
+        return true;
+    }
+  }
+
+  athena::io::FileWriter w(path);
+  if (w.hasError()) {
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("Error opening '{}' for writing")), path);
+    return false;
+  }
+  w.writeBytes(data.data(), data.size());
+  return true;
+}
+
+struct ShaderOutput {
+  hecl::SystemString outPath;
+  std::vector<hecl::SystemString> inputs;
+};
+
+struct CompileOptions {
+  bool compress = false;
+  std::vector<std::pair<std::string, std::string>> defines;
+};
+
+/* Blocks separated by blank lines; each block's first line is an output base and the rest are its inputs */
+static bool ReadManifest(const hecl::SystemString& path, std::vector<ShaderOutput>& out) {
+  athena::io::FileReader r(path, 32 * 1024, false);
+  if (r.hasError()) {
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("Unable to open manifest '{}'")), path);
+    return false;
+  }
+  const auto len = r.length();
+  std::unique_ptr<atUint8[]> data = r.readUBytes(len);
+  std::string_view text(reinterpret_cast<const char*>(data.get()), len);
+
+  bool blockOpen = false;
+  while (!text.empty()) {
+    const size_t lineEnd = std::min(text.find('\n'), text.size());
+    std::string_view line = text.substr(0, lineEnd);
+    text.remove_prefix(std::min(lineEnd + 1, text.size()));
+    if (!line.empty() && line.back() == '\r')
+      line.remove_suffix(1);
+
+    if (line.empty()) {
+      blockOpen = false;
+      continue;
+    }
+    hecl::SystemStringConv conv(line);
+    if (!blockOpen) {
+      out.push_back({hecl::SystemString(conv.sys_str()), {}});
+      blockOpen = true;
+    } else {
+      out.back().inputs.emplace_back(conv.sys_str());
+    }
+  }
+
+  for (const ShaderOutput& output : out) {
+    if (output.inputs.empty()) {
+      Log.report(logvisor::Error, FMT_STRING(_SYS_STR("Manifest output '{}' has no inputs")), output.outPath);
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool CompileOutput(const ShaderOutput& output, const CompileOptions& options, unsigned threadCount,
+                          const std::shared_ptr<hecl::shaderc::FileCache>& fileCache) {
+  hecl::shaderc::Compiler c;
+  c.setCompress(options.compress);
+  c.setThreadCount(threadCount);
+  c.setFileCache(fileCache);
+  for (const auto& [var, val] : options.defines)
+    c.addDefine(var, val);
+  for (const hecl::SystemString& input : output.inputs)
+    c.addInputFile(input);
+
+  const hecl::SystemString& outPath = output.outPath;
+  hecl::SystemStringView baseName;
+  auto slashPos = outPath.find_last_of(_SYS_STR("/\\"));
+  if (slashPos != hecl::SystemString::npos)
+    baseName = outPath.data() + slashPos + 1;
+  else
+    baseName = outPath;
+
+  c.setCachePath(outPath + _SYS_STR(".shadercache"));
+
+  hecl::SystemUTF8Conv conv(baseName);
+  std::pair<std::stringstream, std::stringstream> ret;
+  if (!c.compile(conv.str(), ret))
+    return false;
+
+  return WriteIfChanged(outPath + _SYS_STR(".hpp"), ret.first.str()) &&
+         WriteIfChanged(outPath + _SYS_STR(".cpp"), ret.second.str());
+}
+
 #if _WIN32
 #include <d3dcompiler.h>
 extern pD3DCompile D3DCompilePROC;
@@ -49,93 +156,103 @@ int main(int argc, const hecl::SystemChar** argv)
 #endif
 
   if (argc == 1) {
-    Log.report(logvisor::Info, FMT_STRING("Usage: shaderc -o <out-base> [-D definevar=defineval]... <in-files>..."));
+    Log.report(logvisor::Info,
+               FMT_STRING("Usage: shaderc -o <out-base> [-z] [-j <threads>] [-D definevar=defineval]... <in-files>...\n"
+                          "       shaderc -m <manifest> [-z] [-j <threads>] [-D definevar=defineval]..."));
     return 0;
   }
 
-  hecl::SystemString outPath;
-  hecl::shaderc::Compiler c;
+  /* Option argument either attached to the flag or following it */
+  const auto flagArg = [&](int& i) -> const hecl::SystemChar* {
+    if (argv[i][2])
+      return &argv[i][2];
+    if (i + 1 < argc)
+      return argv[++i];
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("Invalid -{:c} argument")), argv[i][1]);
+    return nullptr;
+  };
+
+  ShaderOutput single;
+  hecl::SystemString manifestPath;
+  CompileOptions options;
+  unsigned threadCount = 0;
   for (int i = 1; i < argc; ++i) {
     if (argv[i][0] == '-') {
       if (argv[i][1] == 'o') {
-        if (argv[i][2]) {
-          outPath = &argv[i][2];
-        } else if (i + 1 < argc) {
-          ++i;
-          outPath = argv[i];
-        } else {
-          Log.report(logvisor::Error, FMT_STRING("Invalid -o argument"));
+        const hecl::SystemChar* arg = flagArg(i);
+        if (!arg)
           return 1;
-        }
+        single.outPath = arg;
+      } else if (argv[i][1] == 'm') {
+        const hecl::SystemChar* arg = flagArg(i);
+        if (!arg)
+          return 1;
+        manifestPath = arg;
+      } else if (argv[i][1] == 'z') {
+        options.compress = true;
+      } else if (argv[i][1] == 'j') {
+        const hecl::SystemChar* count = flagArg(i);
+        if (!count)
+          return 1;
+        threadCount = unsigned(hecl::StrToUl(count, nullptr, 10));
       } else if (argv[i][1] == 'D') {
-        const hecl::SystemChar* define;
-        if (argv[i][2]) {
-          define = &argv[i][2];
-        } else if (i + 1 < argc) {
-          ++i;
-          define = argv[i];
-        } else {
-          Log.report(logvisor::Error, FMT_STRING("Invalid -D argument"));
+        const hecl::SystemChar* define = flagArg(i);
+        if (!define)
           return 1;
-        }
         hecl::SystemUTF8Conv conv(define);
         const char* defineU8 = conv.c_str();
         if (const char* equals = strchr(defineU8, '='))
-          c.addDefine(std::string(defineU8, equals - defineU8), equals + 1);
+          options.defines.emplace_back(std::string(defineU8, equals - defineU8), equals + 1);
         else
-          c.addDefine(defineU8, "");
+          options.defines.emplace_back(defineU8, "");
       } else {
         Log.report(logvisor::Error, FMT_STRING(_SYS_STR("Unrecognized flag option '{:c}'")), argv[i][1]);
         return 1;
       }
     } else {
-      c.addInputFile(argv[i]);
+      single.inputs.emplace_back(argv[i]);
     }
   }
 
-  if (outPath.empty()) {
+  std::vector<ShaderOutput> outputs;
+  if (!manifestPath.empty()) {
+    if (!single.outPath.empty() || !single.inputs.empty()) {
+      Log.report(logvisor::Error, FMT_STRING("-m may not be combined with -o or input files"));
+      return 1;
+    }
+    if (!ReadManifest(manifestPath, outputs))
+      return 1;
+  } else if (single.outPath.empty()) {
     Log.report(logvisor::Error, FMT_STRING("-o option is required"));
     return 1;
+  } else {
+    outputs.push_back(std::move(single));
   }
 
-  hecl::SystemStringView baseName;
-  auto slashPos = outPath.find_last_of(_SYS_STR("/\\"));
-  if (slashPos != hecl::SystemString::npos)
-    baseName = outPath.data() + slashPos + 1;
-  else
-    baseName = outPath;
-
   if (!glslang::InitializeProcess()) {
     Log.report(logvisor::Error, FMT_STRING("Unable to initialize glslang"));
     return 1;
   }
 
-  hecl::SystemUTF8Conv conv(baseName);
-  std::pair<std::stringstream, std::stringstream> ret;
-  if (!c.compile(conv.str(), ret))
-    return 1;
-
-  {
-    hecl::SystemString headerPath = outPath + _SYS_STR(".hpp");
-    athena::io::FileWriter w(headerPath);
-    if (w.hasError()) {
-      Log.report(logvisor::Error, FMT_STRING(_SYS_STR("Error opening '{}' for writing")), headerPath);
-      return 1;
-    }
-    std::string header = ret.first.str();
-    w.writeBytes(header.data(), header.size());
-  }
-
-  {
-    hecl::SystemString impPath = outPath + _SYS_STR(".cpp");
-    athena::io::FileWriter w(impPath);
-    if (w.hasError()) {
-      Log.report(logvisor::Error, FMT_STRING(_SYS_STR("Error opening '{}' for writing")), impPath);
-      return 1;
-    }
-    std::string source = ret.second.str();
-    w.writeBytes(source.data(), source.size());
-  }
+  /* Outputs are built concurrently, splitting the thread budget between them */
+  const unsigned totalThreads = std::max(threadCount ? threadCount : std::thread::hardware_concurrency(), 1u);
+  const size_t workerCount = std::max(std::min(size_t(totalThreads), outputs.size()), size_t(1));
+  const unsigned compilerThreads = std::max(unsigned(totalThreads / workerCount), 1u);
+  auto fileCache = std::make_shared<hecl::shaderc::FileCache>();
+  std::atomic_size_t next = 0;
+  std::atomic_bool ok = true;
+  const auto work = [&]() {
+    for (size_t i; (i = next++) < outputs.size();)
+      if (!CompileOutput(outputs[i], options, compilerThreads, fileCache))
+        ok = false;
+  };
+  std::vector<std::thread> threads;
+  threads.reserve(workerCount - 1);
+  for (size_t i = 1; i < workerCount; ++i)
+    threads.emplace_back(work);
+  work();
+  for (std::thread& thread : threads)
+    thread.join();
 
-  return 0;
+  return ok ? 0 : 1;
 }
@@ -1,10 +1,12 @@
 #include "shaderc.hpp"
 #include "athena/FileReader.hpp"
+#include "athena/FileWriter.hpp"
 #include "logvisor/logvisor.hpp"
 #include "hecl/hecl.hpp"
 #include "hecl/PipelineBase.hpp"
 #include <algorithm>
-#include <regex>
+#include <atomic>
+#include <iterator>
 #include <unordered_map>
 #include <set>
 #include <bitset>
@@ -12,14 +14,14 @@
 #include <cstdint>
 #include <fmt/ostream.h>
 #include <sstream>
+#include <thread>
+#include <zlib.h>
 
 using namespace std::literals;
 
 namespace hecl::shaderc {
 static logvisor::Module Log("shaderc");
 
-constexpr std::regex::flag_type RegexFlags = std::regex::ECMAScript | std::regex::optimize;
-
 static const char* StageNames[] = {
   "hecl::PipelineStage::Vertex",
   "hecl::PipelineStage::Fragment",
@@ -28,17 +30,19 @@ static const char* StageNames[] = {
   "hecl::PipelineStage::Evaluation"
 };
 
-const std::string* Compiler::getFileContents(SystemStringView path) {
+const std::string* FileCache::get(SystemStringView path) {
+  std::unique_lock lk{m_mutex};
   // TODO: Heterogeneous lookup when C++20 available
-  auto search = m_fileContents.find(path.data());
-  if (search == m_fileContents.end()) {
+  auto search = m_contents.find(path.data());
+  if (search == m_contents.end()) {
     athena::io::FileReader r(path);
     if (r.hasError())
       return nullptr;
     auto len = r.length();
     auto data = r.readBytes(len);
-    search = m_fileContents.insert(std::make_pair(path.data(), std::string((char*)data.get(), len))).first;
+    search = m_contents.insert(std::make_pair(path.data(), std::string((char*)data.get(), len))).first;
   }
+  /* Node-based storage keeps the contents in place as other files are added */
   return &search->second;
 }
 
@@ -77,13 +81,13 @@ constexpr auto StageObjectImplTemplate = FMT_STRING(
     "template<>\n"
     "const hecl::StageBinary<hecl::PlatformType::{}, hecl::PipelineStage::{}>\n"
     "StageObject_{}<hecl::PlatformType::{}, hecl::PipelineStage::{}>::Prototype = \n"
-    "{{{}_{}_{}_data, sizeof({}_{}_{}_data)}};\n\n");
+    "{{StageBlobs, {}_{}_{}_blob}};\n\n");
 
 struct CompileSubStageAction {
   template <typename P, typename S>
-  static bool Do(const std::string& name, const std::string& basename, const std::string& stage, std::stringstream& out) {
-    fmt::print(out, StageObjectImplTemplate, P::Name, S::Name, name, P::Name, S::Name, basename,
-               P::Name, S::Name, basename, P::Name, S::Name);
+  static bool Do(Compiler& c, const std::string& name, const std::string& basename, const std::string& stage,
+                 std::stringstream& out) {
+    fmt::print(out, StageObjectImplTemplate, P::Name, S::Name, name, P::Name, S::Name, basename, P::Name, S::Name);
 
     return true;
   }
@@ -91,22 +95,27 @@ struct CompileSubStageAction {
 
 struct CompileStageAction {
   template <typename P, typename S>
-  static bool Do(const std::string& name, const std::string& basename, const std::string& stage, std::stringstream& out) {
-    std::pair<StageBinaryData, size_t> data = CompileShader<P, S>(stage);
-    if (data.second == 0)
-      return false;
-
-    fmt::print(out, FMT_STRING("static const uint8_t {}_{}_{}_data[] = {{\n"), name, P::Name, S::Name);
-    for (size_t i = 0; i < data.second;) {
-      out << "    ";
-      for (int j = 0; j < 10 && i < data.second; ++i, ++j)
-        fmt::print(out, FMT_STRING("0x{:02X}, "), data.first.get()[i]);
-      out << "\n";
-    }
-    out << "};\n\n";
-    fmt::print(out, StageObjectImplTemplate, P::Name, S::Name, name, P::Name, S::Name, name,
-               P::Name, S::Name, name, P::Name, S::Name);
+  static bool Do(Compiler& c, const std::string& name, const std::string& basename, const std::string& stage,
+                 std::stringstream& out) {
+    /* Defines are already substituted into stage, so its text covers them */
+    const std::string keyHead = fmt::format(FMT_STRING("{}/{}\n"), P::Name, S::Name);
+    XXH64_state_t* state = XXH64_createState();
+    XXH64_reset(state, 0);
+    XXH64_update(state, keyHead.data(), keyHead.size());
+    XXH64_update(state, stage.data(), stage.size());
+    const uint64_t key = XXH64_digest(state);
+    XXH64_freeState(state);
 
+    c.queueStage(out, key, fmt::format(FMT_STRING("{}_{}_{}_blob"), name, P::Name, S::Name),
+                 fmt::format(StageObjectImplTemplate, P::Name, S::Name, name, P::Name, S::Name, name, P::Name,
+                             S::Name),
+                 [stage](std::vector<uint8_t>& binary) {
+                   std::pair<StageBinaryData, size_t> data = CompileShader<P, S>(stage);
+                   if (data.second == 0)
+                     return false;
+                   binary.assign(data.first.get(), data.first.get() + data.second);
+                   return true;
+                 });
     return true;
   }
 };
@@ -116,15 +125,15 @@ bool Compiler::StageAction(StageType type, const std::string& name, const std::s
                            const std::string& stage, std::stringstream& implOut) {
   switch (type) {
   case StageType::Vertex:
-    return Action::template Do<P, PipelineStage::Vertex>(name, basename, stage, implOut);
+    return Action::template Do<P, PipelineStage::Vertex>(*this, name, basename, stage, implOut);
   case StageType::Fragment:
-    return Action::template Do<P, PipelineStage::Fragment>(name, basename, stage, implOut);
+    return Action::template Do<P, PipelineStage::Fragment>(*this, name, basename, stage, implOut);
   case StageType::Geometry:
-    return Action::template Do<P, PipelineStage::Geometry>(name, basename, stage, implOut);
+    return Action::template Do<P, PipelineStage::Geometry>(*this, name, basename, stage, implOut);
   case StageType::Control:
-    return Action::template Do<P, PipelineStage::Control>(name, basename, stage, implOut);
+    return Action::template Do<P, PipelineStage::Control>(*this, name, basename, stage, implOut);
   case StageType::Evaluation:
-    return Action::template Do<P, PipelineStage::Evaluation>(name, basename, stage, implOut);
+    return Action::template Do<P, PipelineStage::Evaluation>(*this, name, basename, stage, implOut);
   default:
     break;
   }
@@ -132,16 +141,204 @@ bool Compiler::StageAction(StageType type, const std::string& name, const std::s
   return false;
 }
 
-static const std::regex regWord(R"((\w+))", RegexFlags);
+namespace {
+constexpr bool IsWordChar(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+constexpr bool IsSpaceChar(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f'; }
+
+/* Cursor over one source line for directive parsing */
+class LineCursor {
+  std::string_view m_line;
+  size_t m_pos;
+
+public:
+  LineCursor(std::string_view line, size_t pos) : m_line(line), m_pos(pos) {}
+
+  /* Returns the number of whitespace characters skipped */
+  size_t skipSpace() {
+    const size_t start = m_pos;
+    while (m_pos < m_line.size() && IsSpaceChar(m_line[m_pos]))
+      ++m_pos;
+    return m_pos - start;
+  }
+
+  std::string_view word() {
+    const size_t start = m_pos;
+    while (m_pos < m_line.size() && IsWordChar(m_line[m_pos]))
+      ++m_pos;
+    return m_line.substr(start, m_pos - start);
+  }
+
+  std::string_view digits() {
+    const size_t start = m_pos;
+    while (m_pos < m_line.size() && m_line[m_pos] >= '0' && m_line[m_pos] <= '9')
+      ++m_pos;
+    return m_line.substr(start, m_pos - start);
+  }
+
+  bool consume(char c) {
+    if (m_pos < m_line.size() && m_line[m_pos] == c) {
+      ++m_pos;
+      return true;
+    }
+    return false;
+  }
+
+  /* Remainder of the line, excluding the newline */
+  std::string_view rest() const {
+    std::string_view ret = m_line.substr(m_pos);
+    if (!ret.empty() && ret.back() == '\n')
+      ret.remove_suffix(1);
+    return ret;
+  }
+
+  size_t pos() const { return m_pos; }
+  void setPos(size_t pos) { m_pos = pos; }
+};
+
+enum class Directive {
+  None,
+  Include,
+  Define,
+  Shader,
+  Attribute,
+  InstAttribute,
+  SrcFac,
+  DstFac,
+  Primitive,
+  DepthTest,
+  DepthWrite,
+  ColorWrite,
+  AlphaWrite,
+  Culling,
+  PatchSize,
+  OverwriteAlpha,
+  DepthAttachment,
+  Vertex,
+  Fragment,
+  Geometry,
+  Control,
+  Evaluation
+};
+
+/* How a directive's arguments are laid out after its keyword */
+enum class DirectiveArgs { Path, Define, Shader, Attribute, Word, Rest };
+
+struct DirectiveInfo {
+  std::string_view keyword;
+  Directive type;
+  DirectiveArgs args;
+};
+
+constexpr DirectiveInfo Directives[] = {
+    {"include"sv, Directive::Include, DirectiveArgs::Path},
+    {"define"sv, Directive::Define, DirectiveArgs::Define},
+    {"shader"sv, Directive::Shader, DirectiveArgs::Shader},
+    {"attribute"sv, Directive::Attribute, DirectiveArgs::Attribute},
+    {"instattribute"sv, Directive::InstAttribute, DirectiveArgs::Attribute},
+    {"srcfac"sv, Directive::SrcFac, DirectiveArgs::Word},
+    {"dstfac"sv, Directive::DstFac, DirectiveArgs::Word},
+    {"primitive"sv, Directive::Primitive, DirectiveArgs::Word},
+    {"depthtest"sv, Directive::DepthTest, DirectiveArgs::Word},
+    {"depthwrite"sv, Directive::DepthWrite, DirectiveArgs::Word},
+    {"colorwrite"sv, Directive::ColorWrite, DirectiveArgs::Word},
+    {"alphawrite"sv, Directive::AlphaWrite, DirectiveArgs::Word},
+    {"culling"sv, Directive::Culling, DirectiveArgs::Word},
+    {"patchsize"sv, Directive::PatchSize, DirectiveArgs::Word},
+    {"overwritealpha"sv, Directive::OverwriteAlpha, DirectiveArgs::Word},
+    {"depthattachment"sv, Directive::DepthAttachment, DirectiveArgs::Word},
+    {"vertex"sv, Directive::Vertex, DirectiveArgs::Rest},
+    {"fragment"sv, Directive::Fragment, DirectiveArgs::Rest},
+    {"geometry"sv, Directive::Geometry, DirectiveArgs::Rest},
+    {"control"sv, Directive::Control, DirectiveArgs::Rest},
+    {"evaluation"sv, Directive::Evaluation, DirectiveArgs::Rest},
+};
+
+/* Directive found on a line; arguments view into the line */
+struct DirectiveLine {
+  Directive type = Directive::None;
+  std::string_view arg0;
+  std::string_view arg1;
+};
+
+/* Recognize `# keyword args` anywhere on the line in a single pass.
+ * Attribute indices, shader bases and #define values are optional. */
+DirectiveLine ParseDirective(std::string_view line) {
+  for (size_t hash = line.find('#'); hash != std::string_view::npos; hash = line.find('#', hash + 1)) {
+    LineCursor c(line, hash + 1);
+    c.skipSpace();
+    const std::string_view keyword = c.word();
+    const auto info = std::find_if(std::cbegin(Directives), std::cend(Directives),
+                                   [keyword](const DirectiveInfo& i) { return i.keyword == keyword; });
+    if (info == std::cend(Directives) || !c.skipSpace())
+      continue;
+
+    DirectiveLine ret;
+    ret.type = info->type;
+    switch (info->args) {
+    case DirectiveArgs::Path: {
+      const std::string_view rest = c.rest();
+      const size_t closeQuote = rest.rfind('"');
+      if (rest.empty() || rest.front() != '"' || closeQuote == 0)
+        continue;
+      ret.arg0 = rest.substr(1, closeQuote - 1);
+      return ret;
+    }
+    case DirectiveArgs::Define:
+      ret.arg0 = c.word();
+      if (ret.arg0.empty())
+        continue;
+      c.skipSpace();
+      ret.arg1 = c.rest();
+      return ret;
+    case DirectiveArgs::Shader: {
+      ret.arg0 = c.word();
+      if (ret.arg0.empty())
+        continue;
+      const size_t afterName = c.pos();
+      c.skipSpace();
+      if (c.consume(':')) {
+        c.skipSpace();
+        ret.arg1 = c.word();
+      }
+      if (ret.arg1.empty())
+        c.setPos(afterName);
+      return ret;
+    }
+    case DirectiveArgs::Attribute:
+      ret.arg0 = c.word();
+      if (ret.arg0.empty())
+        continue;
+      if (c.skipSpace())
+        ret.arg1 = c.digits();
+      return ret;
+    case DirectiveArgs::Word:
+      ret.arg0 = c.word();
+      if (ret.arg0.empty())
+        continue;
+      return ret;
+    case DirectiveArgs::Rest:
+      ret.arg0 = c.rest();
+      return ret;
+    }
+  }
+  return {};
+}
+} // anonymous namespace
 
 template <typename Action>
 bool Compiler::StageAction(const std::string& platforms, StageType type, const std::string& name,
                            const std::string& basename, const std::string& stage, std::stringstream& implOut) {
-  std::smatch match;
-  auto begin = platforms.cbegin();
-  auto end = platforms.cend();
-  while (std::regex_search(begin, end, match, regWord)) {
-    std::string plat = match[1].str();
+  LineCursor c(platforms, 0);
+  while (c.pos() < platforms.size()) {
+    const std::string_view word = c.word();
+    if (word.empty()) {
+      c.setPos(c.pos() + 1);
+      continue;
+    }
+    std::string plat(word);
     std::transform(plat.begin(), plat.end(), plat.begin(), ::tolower);
     if (plat == "glsl") {
       if (!StageAction<Action, PlatformType::OpenGL>(type, name, basename, stage, implOut) ||
@@ -176,37 +373,11 @@ bool Compiler::StageAction(const std::string& platforms, StageType type, const s
       Log.report(logvisor::Error, FMT_STRING("Unknown platform '{}'"), plat);
       return false;
     }
-    begin = match.suffix().first;
   }
 
   return true;
 }
 
-static const std::regex regInclude(R"(#\s*include\s+\"(.*)\")", RegexFlags);
-static const std::regex regDefine(R"(#\s*define\s+(\w+)\s*(.*))", RegexFlags);
-static const std::regex regShaderEx(R"(#\s*shader\s+(\w+)\s*:\s*(\w+))", RegexFlags);
-static const std::regex regShader(R"(#\s*shader\s+(\w+))", RegexFlags);
-static const std::regex regAttributeEx(R"(#\s*attribute\s+(\w+)\s+([0-9]+))", RegexFlags);
-static const std::regex regAttribute(R"(#\s*attribute\s+(\w+))", RegexFlags);
-static const std::regex regInstAttributeEx(R"(#\s*instattribute\s+(\w+)\s+([0-9]+))", RegexFlags);
-static const std::regex regInstAttribute(R"(#\s*instattribute\s+(\w+))", RegexFlags);
-static const std::regex regSrcFac(R"(#\s*srcfac\s+(\w+))", RegexFlags);
-static const std::regex regDstFac(R"(#\s*dstfac\s+(\w+))", RegexFlags);
-static const std::regex regPrim(R"(#\s*primitive\s+(\w+))", RegexFlags);
-static const std::regex regZTest(R"(#\s*depthtest\s+(\w+))", RegexFlags);
-static const std::regex regDepthWrite(R"(#\s*depthwrite\s+(\w+))", RegexFlags);
-static const std::regex regColorWrite(R"(#\s*colorwrite\s+(\w+))", RegexFlags);
-static const std::regex regAlphaWrite(R"(#\s*alphawrite\s+(\w+))", RegexFlags);
-static const std::regex regCulling(R"(#\s*culling\s+(\w+))", RegexFlags);
-static const std::regex regPatchSize(R"(#\s*patchsize\s+(\w+))", RegexFlags);
-static const std::regex regOverwriteAlpha(R"(#\s*overwritealpha\s+(\w+))", RegexFlags);
-static const std::regex regDepthAttachment(R"(#\s*depthattachment\s+(\w+))", RegexFlags);
-static const std::regex regVertex(R"(#\s*vertex\s+(.*))", RegexFlags);
-static const std::regex regFragment(R"(#\s*fragment\s+(.*))", RegexFlags);
-static const std::regex regGeometry(R"(#\s*geometry\s+(.*))", RegexFlags);
-static const std::regex regControl(R"(#\s*control\s+(.*))", RegexFlags);
-static const std::regex regEvaluation(R"(#\s*evaluation\s+(.*))", RegexFlags);
-
 bool Compiler::includeFile(SystemStringView file, std::string& out, int depth) {
   if (depth > 32) {
     Log.report(logvisor::Error, FMT_STRING(_SYS_STR("Too many levels of includes (>32) at '{}'")), file);
@@ -237,9 +408,9 @@ bool Compiler::includeFile(SystemStringView file, std::string& out, int depth) {
     else
       nextBegin = sdata.begin() + findPos + 1;
 
-    std::smatch subMatch;
-    if (std::regex_search(begin, nextBegin, subMatch, regInclude)) {
-      std::string path = subMatch[1].str();
+    const DirectiveLine directive = ParseDirective(std::string_view(&*begin, nextBegin - begin));
+    if (directive.type == Directive::Include) {
+      std::string path(directive.arg0);
       if (path.empty()) {
         Log.report(logvisor::Error, FMT_STRING(_SYS_STR("Empty path provided to include in '{}'")), file);
         return false;
@@ -649,7 +820,8 @@ bool Compiler::compileFile(SystemStringView file, std::string_view baseName,
     else
       nextBegin = includesPass.cbegin() + findPos + 1;
 
-    std::smatch subMatch;
+    const DirectiveLine directive =
+        defineContinue ? DirectiveLine{} : ParseDirective(std::string_view(&*begin, nextBegin - begin));
     if (defineContinue) {
       std::string extraLine;
       if (findPos == std::string::npos)
@@ -663,97 +835,113 @@ bool Compiler::compileFile(SystemStringView file, std::string_view baseName,
         defineContinue->pop_back();
       else
         defineContinue = nullptr;
-    } else if (std::regex_search(begin, nextBegin, subMatch, regDefine)) {
-      std::string& defOut = m_defines[subMatch[1].str()];
-      defOut = subMatch[2].str();
-      if (!defOut.empty() && defOut.back() == '\r')
-        defOut.pop_back();
-      if (!defOut.empty() && defOut.back() == '\\') {
-        defOut.pop_back();
-        defineContinue = &defOut;
+    } else {
+      const std::string arg0(directive.arg0);
+      const std::string arg1(directive.arg1);
+      switch (directive.type) {
+      case Directive::None:
+      case Directive::Include:
+        break;
+      case Directive::Define: {
+        std::string& defOut = m_defines[arg0];
+        defOut = arg1;
+        if (!defOut.empty() && defOut.back() == '\r')
+          defOut.pop_back();
+        if (!defOut.empty() && defOut.back() == '\\') {
+          defOut.pop_back();
+          defineContinue = &defOut;
+        }
+        break;
       }
-    } else if (std::regex_search(begin, nextBegin, subMatch, regShaderEx)) {
-      stageEnd = begin;
-      if (!_DoCompile() || !DoShader())
-        return false;
-      shaderName = subMatch[1].str();
-      shaderBase = subMatch[2].str();
-      shaderAttributesReset = true;
-      // shaderAttributes.clear();
-      // shaderInfo = boo::AdditionalPipelineInfo();
-    } else if (std::regex_search(begin, nextBegin, subMatch, regShader)) {
-      stageEnd = begin;
-      if (!_DoCompile() || !DoShader())
-        return false;
-      shaderName = subMatch[1].str();
-      shaderAttributesReset = true;
-      // shaderAttributes.clear();
-      // shaderInfo = boo::AdditionalPipelineInfo();
-    } else if (std::regex_search(begin, nextBegin, subMatch, regAttributeEx)) {
-      if (!AddAttribute(subMatch[1].str(), subMatch[2].str(), false))
-        return false;
-    } else if (std::regex_search(begin, nextBegin, subMatch, regAttribute)) {
-      if (!AddAttribute(subMatch[1].str(), "0", false))
-        return false;
-    } else if (std::regex_search(begin, nextBegin, subMatch, regInstAttributeEx)) {
-      if (!AddAttribute(subMatch[1].str(), subMatch[2].str(), true))
-        return false;
-    } else if (std::regex_search(begin, nextBegin, subMatch, regInstAttribute)) {
-      if (!AddAttribute(subMatch[1].str(), "0", true))
-        return false;
-    } else if (std::regex_search(begin, nextBegin, subMatch, regSrcFac)) {
-      if (!StrToBlendFactor(subMatch[1].str(), shaderInfo.srcFac))
-        return false;
-    } else if (std::regex_search(begin, nextBegin, subMatch, regDstFac)) {
-      if (!StrToBlendFactor(subMatch[1].str(), shaderInfo.dstFac))
-        return false;
-    } else if (std::regex_search(begin, nextBegin, subMatch, regPrim)) {
-      if (!StrToPrimitive(subMatch[1].str(), shaderInfo.prim))
-        return false;
-    } else if (std::regex_search(begin, nextBegin, subMatch, regZTest)) {
-      if (!StrToZTest(subMatch[1].str(), shaderInfo.depthTest))
-        return false;
-    } else if (std::regex_search(begin, nextBegin, subMatch, regDepthWrite)) {
-      if (!StrToBool(subMatch[1].str(), shaderInfo.depthWrite))
-        return false;
-    } else if (std::regex_search(begin, nextBegin, subMatch, regColorWrite)) {
-      if (!StrToBool(subMatch[1].str(), shaderInfo.colorWrite))
-        return false;
-    } else if (std::regex_search(begin, nextBegin, subMatch, regAlphaWrite)) {
-      if (!StrToBool(subMatch[1].str(), shaderInfo.alphaWrite))
-        return false;
-    } else if (std::regex_search(begin, nextBegin, subMatch, regCulling)) {
-      if (!StrToCullMode(subMatch[1].str(), shaderInfo.culling))
-        return false;
-    } else if (std::regex_search(begin, nextBegin, subMatch, regPatchSize)) {
-      auto str = subMatch[1].str();
-      char* endptr;
-      shaderInfo.patchSize = uint32_t(strtoul(str.c_str(), &endptr, 0));
-      if (endptr == str.c_str()) {
-        Log.report(logvisor::Error, FMT_STRING("Non-unsigned-integer value for #patchsize directive"));
-        return false;
+      case Directive::Shader:
+        stageEnd = begin;
+        if (!_DoCompile() || !DoShader())
+          return false;
+        shaderName = arg0;
+        if (!arg1.empty())
+          shaderBase = arg1;
+        shaderAttributesReset = true;
+        // shaderAttributes.clear();
+        // shaderInfo = boo::AdditionalPipelineInfo();
+        break;
+      case Directive::Attribute:
+        if (!AddAttribute(arg0, arg1.empty() ? "0" : arg1, false))
+          return false;
+        break;
+      case Directive::InstAttribute:
+        if (!AddAttribute(arg0, arg1.empty() ? "0" : arg1, true))
+          return false;
+        break;
+      case Directive::SrcFac:
+        if (!StrToBlendFactor(arg0, shaderInfo.srcFac))
+          return false;
+        break;
+      case Directive::DstFac:
+        if (!StrToBlendFactor(arg0, shaderInfo.dstFac))
+          return false;
+        break;
+      case Directive::Primitive:
+        if (!StrToPrimitive(arg0, shaderInfo.prim))
+          return false;
+        break;
+      case Directive::DepthTest:
+        if (!StrToZTest(arg0, shaderInfo.depthTest))
+          return false;
+        break;
+      case Directive::DepthWrite:
+        if (!StrToBool(arg0, shaderInfo.depthWrite))
+          return false;
+        break;
+      case Directive::ColorWrite:
+        if (!StrToBool(arg0, shaderInfo.colorWrite))
+          return false;
+        break;
+      case Directive::AlphaWrite:
+        if (!StrToBool(arg0, shaderInfo.alphaWrite))
+          return false;
+        break;
+      case Directive::Culling:
+        if (!StrToCullMode(arg0, shaderInfo.culling))
+          return false;
+        break;
+      case Directive::PatchSize: {
+        char* endptr;
+        shaderInfo.patchSize = uint32_t(strtoul(arg0.c_str(), &endptr, 0));
+        if (endptr == arg0.c_str()) {
+          Log.report(logvisor::Error, FMT_STRING("Non-unsigned-integer value for #patchsize directive"));
+          return false;
+        }
+        break;
+      }
+      case Directive::OverwriteAlpha:
+        if (!StrToBool(arg0, shaderInfo.overwriteAlpha))
+          return false;
+        break;
+      case Directive::DepthAttachment:
+        if (!StrToBool(arg0, shaderInfo.depthAttachment))
+          return false;
+        break;
+      case Directive::Vertex:
+        if (!DoCompile(arg0, StageType::Vertex, begin, nextBegin))
+          return false;
+        break;
+      case Directive::Fragment:
+        if (!DoCompile(arg0, StageType::Fragment, begin, nextBegin))
+          return false;
+        break;
+      case Directive::Geometry:
+        if (!DoCompile(arg0, StageType::Geometry, begin, nextBegin))
+          return false;
+        break;
+      case Directive::Control:
+        if (!DoCompile(arg0, StageType::Control, begin, nextBegin))
+          return false;
+        break;
+      case Directive::Evaluation:
+        if (!DoCompile(arg0, StageType::Evaluation, begin, nextBegin))
+          return false;
+        break;
       }
-    } else if (std::regex_search(begin, nextBegin, subMatch, regOverwriteAlpha)) {
-      if (!StrToBool(subMatch[1].str(), shaderInfo.overwriteAlpha))
-        return false;
-    } else if (std::regex_search(begin, nextBegin, subMatch, regDepthAttachment)) {
-      if (!StrToBool(subMatch[1].str(), shaderInfo.depthAttachment))
-        return false;
-    } else if (std::regex_search(begin, nextBegin, subMatch, regVertex)) {
-      if (!DoCompile(subMatch[1].str(), StageType::Vertex, begin, nextBegin))
-        return false;
-    } else if (std::regex_search(begin, nextBegin, subMatch, regFragment)) {
-      if (!DoCompile(subMatch[1].str(), StageType::Fragment, begin, nextBegin))
-        return false;
-    } else if (std::regex_search(begin, nextBegin, subMatch, regGeometry)) {
-      if (!DoCompile(subMatch[1].str(), StageType::Geometry, begin, nextBegin))
-        return false;
-    } else if (std::regex_search(begin, nextBegin, subMatch, regControl)) {
-      if (!DoCompile(subMatch[1].str(), StageType::Control, begin, nextBegin))
-        return false;
-    } else if (std::regex_search(begin, nextBegin, subMatch, regEvaluation)) {
-      if (!DoCompile(subMatch[1].str(), StageType::Evaluation, begin, nextBegin))
-        return false;
     }
 
     begin = nextBegin;
@@ -798,15 +986,221 @@ bool Compiler::compileFile(SystemStringView file, std::string_view baseName,
   return true;
 }
 
+void Compiler::queueStage(std::stringstream& implOut, uint64_t key, std::string dataSymbol, std::string suffix,
+                          std::function<bool(std::vector<uint8_t>& binary)>&& compile) {
+  StageJob& job = m_stageJobs.emplace_back();
+  job.prefix = implOut.str();
+  job.key = key;
+  job.compile = std::move(compile);
+  job.dataSymbol = std::move(dataSymbol);
+  job.suffix = std::move(suffix);
+  implOut.str(std::string());
+}
+
+/* Entries start 16-byte aligned so SPIR-V and DXBC may be consumed in place */
+constexpr size_t StageBlobAlignment = 16;
+
+static void EmitBytes(const std::vector<uint8_t>& bytes, std::string& out) {
+  static constexpr char Hex[] = "0123456789ABCDEF";
+  out.reserve(out.size() + bytes.size() * 6 + bytes.size() / 10 * 5);
+  for (size_t i = 0; i < bytes.size();) {
+    out += "    ";
+    for (int j = 0; j < 10 && i < bytes.size(); ++i, ++j) {
+      const uint8_t byte = bytes[i];
+      const char chars[] = {'0', 'x', Hex[byte >> 4], Hex[byte & 0xf], ',', ' '};
+      out.append(chars, sizeof(chars));
+    }
+    out += "\n";
+  }
+}
+
+bool Compiler::runStageJobs(std::stringstream& implOut) {
+  const size_t total = m_stageJobs.size();
+  std::atomic_size_t next = 0;
+  std::atomic_size_t compiled = 0;
+  const auto work = [&]() {
+    for (size_t i; (i = next++) < total;) {
+      StageJob& job = m_stageJobs[i];
+      auto search = m_stageCache.find(job.key);
+      if (search != m_stageCache.end()) {
+        job.binary = search->second;
+        job.ok = true;
+      } else {
+        job.ok = job.compile(job.binary);
+        ++compiled;
+      }
+    }
+  };
+
+  size_t threadCount = m_threadCount ? m_threadCount : std::thread::hardware_concurrency();
+  threadCount = std::max(std::min(threadCount, total), size_t(1));
+  std::vector<std::thread> threads;
+  threads.reserve(threadCount - 1);
+  for (size_t i = 1; i < threadCount; ++i)
+    threads.emplace_back(work);
+  work();
+  for (std::thread& thread : threads)
+    thread.join();
+
+  bool ret = true;
+  for (const StageJob& job : m_stageJobs)
+    ret &= job.ok;
+  if (!ret) {
+    m_stageJobs.clear();
+    return false;
+  }
+
+  /* Identical binaries across shaders and platforms share one entry */
+  struct UniqueBinary {
+    const std::vector<uint8_t>* binary;
+    uint64_t hash;
+  };
+  std::vector<UniqueBinary> uniques;
+  std::unordered_multimap<uint64_t, uint32_t> uniqueByHash;
+  for (StageJob& job : m_stageJobs) {
+    const uint64_t hash = XXH64(job.binary.data(), job.binary.size(), 0);
+    uint32_t index = uint32_t(uniques.size());
+    const auto range = uniqueByHash.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (*uniques[it->second].binary == job.binary) {
+        index = it->second;
+        break;
+      }
+    }
+    if (index == uniques.size()) {
+      uniques.push_back({&job.binary, hash});
+      uniqueByHash.emplace(hash, index);
+    }
+    job.result = fmt::format(FMT_STRING("static constexpr size_t {} = {};\n"), job.dataSymbol, index);
+    job.result += job.suffix;
+  }
+
+  /* Compress unique entries in parallel, keeping only those that shrink */
+  std::vector<std::vector<uint8_t>> packed(uniques.size());
+  if (m_compress) {
+    next = 0;
+    const auto compress = [&]() {
+      for (size_t i; (i = next++) < uniques.size();) {
+        const std::vector<uint8_t>& raw = *uniques[i].binary;
+        uLongf compSize = compressBound(uLong(raw.size()));
+        packed[i].resize(compSize);
+        if (compress2(packed[i].data(), &compSize, raw.data(), uLong(raw.size()), Z_BEST_COMPRESSION) != Z_OK ||
+            compSize >= raw.size())
+          packed[i].clear();
+        else
+          packed[i].resize(compSize);
+      }
+    };
+    threads.clear();
+    for (size_t i = 1; i < threadCount; ++i)
+      threads.emplace_back(compress);
+    compress();
+    for (std::thread& thread : threads)
+      thread.join();
+  }
+
+  std::string blob;
+  std::string entries;
+  std::vector<uint8_t> blobBytes;
+  for (size_t i = 0; i < uniques.size(); ++i) {
+    const std::vector<uint8_t>& raw = *uniques[i].binary;
+    const std::vector<uint8_t>& stored = packed[i].empty() ? raw : packed[i];
+    blobBytes.resize((blobBytes.size() + StageBlobAlignment - 1) & ~(StageBlobAlignment - 1));
+    fmt::format_to(std::back_inserter(entries), FMT_STRING("    {{{}, {}, {}, 0x{:016X}}},\n"), blobBytes.size(),
+                   stored.size(), raw.size(), uniques[i].hash);
+    blobBytes.insert(blobBytes.end(), stored.begin(), stored.end());
+  }
+  if (!uniques.empty()) {
+    blob = fmt::format(FMT_STRING("alignas({}) static const uint8_t StageBlobData[] = {{\n"), StageBlobAlignment);
+    EmitBytes(blobBytes, blob);
+    blob += "};\n\nstatic const hecl::StageBlobEntry StageBlobEntries[] = {\n";
+    blob += entries;
+    fmt::format_to(std::back_inserter(blob),
+                   FMT_STRING("}};\n\nstatic hecl::StageBlobTable StageBlobs(StageBlobData, StageBlobEntries, {});\n\n"),
+                   uniques.size());
+  } else {
+    blob = "static hecl::StageBlobTable StageBlobs(nullptr, nullptr, 0);\n\n";
+  }
+
+  /* Stitch job output back between the text emitted around it, after the blob */
+  const std::string tail = implOut.str();
+  implOut.str(std::string());
+  implOut << blob;
+  for (const StageJob& job : m_stageJobs)
+    implOut << job.prefix << job.result;
+  implOut << tail;
+
+  /* Keep only binaries referenced by this run so stale stages drop out of the cache */
+  std::unordered_map<uint64_t, std::vector<uint8_t>> used;
+  for (StageJob& job : m_stageJobs)
+    used.emplace(job.key, std::move(job.binary));
+  if (compiled || used.size() != m_stageCache.size()) {
+    m_stageCache = std::move(used);
+    saveStageCache();
+  }
+  m_stageJobs.clear();
+  return true;
+}
+
+constexpr uint32_t StageCacheMagic = 'SHCC';
+constexpr uint32_t StageCacheVersion = 1;
+
+void Compiler::loadStageCache() {
+  m_stageCache.clear();
+  if (m_cachePath.empty())
+    return;
+  athena::io::FileReader r(m_cachePath, 32 * 1024, false);
+  if (r.hasError() || r.length() < 12)
+    return;
+  if (r.readUint32Little() != StageCacheMagic || r.readUint32Little() != StageCacheVersion)
+    return;
+  const uint32_t count = r.readUint32Little();
+  for (uint32_t i = 0; i < count; ++i) {
+    if (r.position() + 16 > r.length())
+      break;
+    const uint64_t key = r.readUint64Little();
+    const uint64_t size = r.readUint64Little();
+    if (r.position() + size > r.length())
+      break;
+    std::vector<uint8_t>& binary = m_stageCache[key];
+    binary.resize(size);
+    r.readUBytesToBuf(binary.data(), size);
+  }
+}
+
+void Compiler::saveStageCache() const {
+  if (m_cachePath.empty())
+    return;
+  athena::io::FileWriter w(m_cachePath);
+  if (w.hasError()) {
+    Log.report(logvisor::Warning, FMT_STRING(_SYS_STR("Unable to write stage cache '{}'")), m_cachePath);
+    return;
+  }
+  w.writeUint32Little(StageCacheMagic);
+  w.writeUint32Little(StageCacheVersion);
+  w.writeUint32Little(uint32_t(m_stageCache.size()));
+  for (const auto& [key, binary] : m_stageCache) {
+    w.writeUint64Little(key);
+    w.writeUint64Little(binary.size());
+    w.writeUBytes(binary.data(), binary.size());
+  }
+}
+
 bool Compiler::compile(std::string_view baseName, std::pair<std::stringstream, std::stringstream>& out) {
   out.first << "#pragma once\n"
                "#include \"hecl/PipelineBase.hpp\"\n\n";
-  fmt::print(out.second, FMT_STRING("#include \"{}.hpp\"\n\n"), baseName);
+  loadStageCache();
 
   for (const auto& file : m_inputFiles)
     if (!compileFile(file, baseName, out))
       return false;
 
+  if (!runStageJobs(out.second))
+    return false;
+  const std::string impl = out.second.str();
+  out.second.str(std::string());
+  fmt::print(out.second, FMT_STRING("#include \"{}.hpp\"\n\n"), baseName);
+  out.second << impl;
   return true;
 }
 
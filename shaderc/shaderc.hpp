@@ -1,23 +1,65 @@
 #pragma once
 #include "hecl/SystemChar.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <unordered_map>
 
 namespace hecl::shaderc {
+struct CompileStageAction;
+
+/** Contents of shader and #include files, shared by the compilers of a batch run */
+class FileCache {
+  std::mutex m_mutex;
+  std::unordered_map<SystemString, std::string> m_contents;
+
+public:
+  /** Read path on first request; nullptr if unreadable */
+  const std::string* get(SystemStringView path);
+};
 
 class Compiler {
+  friend struct CompileStageAction;
   enum class StageType { Vertex, Fragment, Geometry, Control, Evaluation };
 
+  /* Stage compiles are deferred until all inputs are parsed, then run in parallel;
+   * prefix holds the generated source emitted before the job's output, which references the
+   * binary's blob entry through an index constant named dataSymbol */
+  struct StageJob {
+    std::string prefix;
+    uint64_t key;
+    std::function<bool(std::vector<uint8_t>& binary)> compile;
+    std::string dataSymbol;
+    std::string suffix;
+    std::vector<uint8_t> binary;
+    std::string result;
+    bool ok = false;
+  };
+  std::vector<StageJob> m_stageJobs;
+  unsigned m_threadCount = 0;
+  bool m_compress = false;
+  void queueStage(std::stringstream& implOut, uint64_t key, std::string dataSymbol, std::string suffix,
+                  std::function<bool(std::vector<uint8_t>& binary)>&& compile);
+  bool runStageJobs(std::stringstream& implOut);
+
+  /* Stage binaries of the previous run by key of platform, stage and preprocessed text */
+  SystemString m_cachePath;
+  std::unordered_map<uint64_t, std::vector<uint8_t>> m_stageCache;
+  void loadStageCache();
+  void saveStageCache() const;
+
   std::vector<SystemString> m_inputFiles;
-  std::unordered_map<SystemString, std::string> m_fileContents;
-  const std::string* getFileContents(SystemStringView path);
+  std::shared_ptr<FileCache> m_fileCache = std::make_shared<FileCache>();
+  const std::string* getFileContents(SystemStringView path) { return m_fileCache->get(path); }
   std::unordered_map<std::string, std::string> m_defines;
   template <typename Action, typename P>
-  static bool StageAction(StageType type, const std::string& name, const std::string& basename,
+  bool StageAction(StageType type, const std::string& name, const std::string& basename,
                           const std::string& stage, std::stringstream& implOut);
   template <typename Action>
-  static bool StageAction(const std::string& platforms, StageType type, const std::string& name,
+  bool StageAction(const std::string& platforms, StageType type, const std::string& name,
                           const std::string& basename, const std::string& stage, std::stringstream& implOut);
   bool includeFile(SystemStringView file, std::string& out, int depth = 0);
   bool compileFile(SystemStringView file, std::string_view baseName,
@@ -26,6 +68,14 @@ class Compiler {
 public:
   void addInputFile(SystemStringView file);
   void addDefine(std::string_view var, std::string_view val);
+  /** Worker threads for stage compiles; 0 uses every hardware thread */
+  void setThreadCount(unsigned count) { m_threadCount = count; }
+  /** zlib-compress embedded stage binaries, inflated by StageBlobTable on first use */
+  void setCompress(bool compress) { m_compress = compress; }
+  /** Sidecar file holding stage binaries between runs; empty disables caching */
+  void setCachePath(SystemStringView path) { m_cachePath = path; }
+  /** Share file reads with other compilers, so common includes are loaded once per process */
+  void setFileCache(std::shared_ptr<FileCache> cache) { m_fileCache = std::move(cache); }
   bool compile(std::string_view baseName, std::pair<std::stringstream, std::stringstream>& out);
 };
 